@@ -0,0 +1,87 @@
+#ifndef BIAS_ESTIMATOR_H
+#define BIAS_ESTIMATOR_H
+
+#include "config.h"
+#include <stdint.h>
+
+#define BIAS_MODEL_VERSION 1
+#define BIAS_TEMP_BINS 26   // BIAS_TEMP_BIN_C wide from BIAS_TEMP_MIN_C (-20 .. 84 C)
+
+// Average zero-rate reading of the stationary windows seen near one temperature
+struct BiasBin {
+  float temperatureC;
+  float gyro[3];
+  float weight;             // windows averaged, up to BIAS_BIN_MAX_WEIGHT; 0: empty
+};
+
+// Learned calibration of one IMU, stored in NVS as is
+struct BiasModel {
+  uint32_t version;
+  uint32_t windows;         // stationary windows learned from; 0: uncalibrated
+  float accel[3];           // level offsets in g: the still reading minus (0, 0, 1)
+  float gyro[3];            // zero-rate offsets in dps at BIAS_REFERENCE_C
+  float gyroSlope[3];       // dps per degree C
+  BiasBin bins[BIAS_TEMP_BINS];
+};
+
+// Background calibration of one MPU6050 from the readings it already
+// delivers. Readings are tested in BIAS_WINDOW_MS windows: a window with
+// low accel and gyro variance, gravity-sized acceleration, and a mean rate
+// close to the current bias is stationary, and its mean rate is that
+// bias. Means are averaged per temperature bin, and a line through the
+// bins gives the bias at any die temperature, so a warm-up drift learned
+// at one stop corrects the readings at the next. Until the temperatures
+// seen span BIAS_MIN_SPREAD_C the slope is kept and only the offset moves.
+//
+// Accel offsets cannot be told from a tilted mounting without knowing the
+// orientation; they are learned once, from the first stationary window,
+// as the old boot calibration did.
+class BiasEstimator {
+private:
+  BiasModel model;
+  float temperatureC;        // last reading's
+
+  // Current window: sums of the offsets from its first reading
+  uint64_t windowStart;
+  uint64_t lastMicros;
+  uint32_t samples;
+  float first[6];
+  float sums[6];
+  float squares[6];
+  float temperatureSum;
+
+  bool stationary;           // verdict on the last complete window
+  uint32_t rejectedWindows;  // still ones in a row too far from the model
+
+  void resetWindow();
+  bool finishWindow();
+  void learn(const float* accel, const float* gyro, float windowC);
+  void fit();
+
+public:
+  BiasEstimator();
+
+  // Forget everything: uncalibrated, zero offsets
+  void begin();
+
+  // A stored model; false (and nothing changes) when it is not valid
+  bool load(const BiasModel& stored);
+  const BiasModel& getModel() const;
+
+  // One uncorrected reading in g, dps and degrees C. True when it closed
+  // a stationary window and the model was updated.
+  bool update(const float* accel, const float* gyro, float tempC, uint64_t nowMicros);
+
+  // Offsets to subtract at a die temperature
+  void getOffsets(float tempC, float* accel, float* gyro) const;
+
+  // Explicit calibration measured at tempC, e.g. a still-device routine.
+  // The slope learned so far is kept.
+  void setOffsets(const float* accel, const float* gyro, float tempC);
+
+  bool isCalibrated() const;
+  bool isStationary() const;
+  float getTemperature() const;
+};
+
+#endif // BIAS_ESTIMATOR_H
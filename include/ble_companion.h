@@ -0,0 +1,67 @@
+#ifndef BLE_COMPANION_H
+#define BLE_COMPANION_H
+
+#include "ble_stream.h"
+#include "config.h"
+#include <Arduino.h>
+#include <BLEDevice.h>
+#include <BLEServer.h>
+
+#define BLE_COMMAND_SIZE 96
+
+// GATT service for a phone or laptop in the workshop (see ble_stream.h for
+// the layout). While a client is subscribed and the stream is on, every
+// reading goes out as a StreamFrame, batched to the negotiated MTU.
+// Command lines written to the control characteristic are queued for the
+// main loop, which answers through respond(); the BLE stack's task only
+// copies them.
+class BleCompanion : private BLEServerCallbacks, private BLECharacteristicCallbacks {
+private:
+  BLEServer* server;
+  BLECharacteristic* streamCharacteristic;
+  BLECharacteristic* responseCharacteristic;
+  StreamBatcher batcher;
+  uint16_t mtu;
+  bool streaming;
+  uint32_t batchesSent;
+  uint32_t framesSent;
+
+  // Set by the BLE task, cleared by the loop
+  volatile bool connected;
+  volatile bool commandPending;
+  char command[BLE_COMMAND_SIZE];
+
+  void onConnect(BLEServer* server) override;
+  void onDisconnect(BLEServer* server) override;
+  void onWrite(BLECharacteristic* characteristic) override;
+  void sendBatch();
+
+public:
+  BleCompanion();
+
+  // Start the service and advertise as name
+  bool begin(const char* name = BLE_DEVICE_NAME);
+
+  bool isConnected() const;
+  bool isStreaming() const;
+  void setStreaming(bool on);
+
+  // Queue a reading for the stream; sends the batch once it is full
+  void publish(const SensorData& reading, int score, uint8_t flags, uint32_t nowMs);
+
+  // Once per loop pass: follows MTU changes, sends a batch left open for
+  // BLE_BATCH_MAX_MS
+  void poll(uint32_t nowMs);
+
+  // The command line written since the last call, if any
+  bool takeCommand(char* line, size_t size);
+
+  // A reply line, split to fit the MTU and ended with '\n'
+  void respond(const char* line);
+
+  uint16_t getMtu() const;
+  uint32_t getFramesSent() const;
+  uint32_t getBatchesSent() const;
+};
+
+#endif // BLE_COMPANION_H
@@ -0,0 +1,134 @@
+#ifndef BLE_STREAM_H
+#define BLE_STREAM_H
+
+#include "config.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// GATT layout of the companion service
+#define BLE_SERVICE_UUID "8c1a0001-5d3e-4f6b-9a52-3c7e0d4b2a10"
+#define BLE_STREAM_UUID "8c1a0002-5d3e-4f6b-9a52-3c7e0d4b2a10"    // notify: frame batches
+#define BLE_CONTROL_UUID "8c1a0003-5d3e-4f6b-9a52-3c7e0d4b2a10"   // write: a command line
+#define BLE_RESPONSE_UUID "8c1a0004-5d3e-4f6b-9a52-3c7e0d4b2a10"  // notify: reply lines
+
+// Wire format, little-endian throughout. A notification carries one batch:
+//
+//   magic (0xC5), frame count, batch sequence (u16), frames
+//
+// and each frame is STREAM_FRAME_SIZE bytes:
+//
+//   frame sequence u16, sample time u32 (us, wraps), accel i16[3] (mg),
+//   gyro i16[3] (0.1 dps), distance i16 (cm, -1 without an echo),
+//   missing u8 (SENSOR_*), quality u8 (QUALITY_*), score u8, flags u8
+//
+// Batches are self-delimiting, so a recording is just the payloads back to
+// back. The ATT header takes 3 bytes of the MTU: MTU 23 (the BLE default)
+// fits no frame, 185 fits 7 and 247 fits 10.
+#define STREAM_MAGIC 0xC5
+#define STREAM_HEADER_SIZE 4
+#define STREAM_FRAME_SIZE 24
+#define STREAM_ATT_OVERHEAD 3
+#define STREAM_MAX_PAYLOAD 512
+
+#define STREAM_FLAG_VIBRATION 0x01
+#define STREAM_FLAG_CRASH 0x02      // a crash is pending or confirmed
+
+// One reading as it goes over the air
+struct StreamFrame {
+  uint16_t sequence;
+  uint32_t sampleMicros;
+  int16_t accelMg[3];
+  int16_t gyroDeciDps[3];
+  int16_t distanceCm;
+  uint8_t missing;
+  uint8_t quality;
+  uint8_t score;
+  uint8_t flags;
+};
+
+StreamFrame makeStreamFrame(const SensorData& reading, uint16_t sequence, int score, uint8_t flags);
+void encodeStreamFrame(const StreamFrame& frame, uint8_t* out);
+void decodeStreamFrame(const uint8_t* in, StreamFrame& frame);
+
+// Frames per notification at this MTU; 0 when not even one fits
+uint32_t streamFramesPerBatch(uint16_t mtu);
+
+// Packs frames into batches sized to the negotiated MTU. A batch is ready
+// when full, or BLE_BATCH_MAX_MS after its first frame so a slow stream
+// still arrives promptly.
+class StreamBatcher {
+private:
+  uint8_t payload[STREAM_MAX_PAYLOAD];
+  uint32_t capacity;           // frames per batch
+  uint32_t count;
+  uint16_t batchSequence;
+  uint16_t frameSequence;
+  uint32_t firstFrameMs;
+
+public:
+  StreamBatcher();
+
+  // Frames per batch from the MTU; an open batch is dropped
+  void setMtu(uint16_t mtu);
+  uint32_t getCapacity() const;
+
+  // Numbers and appends the frame; false when no frame fits the MTU
+  bool add(StreamFrame& frame, uint32_t nowMs);
+
+  // A batch to send: full, or open for BLE_BATCH_MAX_MS
+  bool isReady(uint32_t nowMs) const;
+  bool isEmpty() const;
+
+  // The batch as a notification payload; the next one starts empty
+  size_t take(uint8_t* out, size_t size);
+};
+
+typedef void (*StreamFrameHandler)(const StreamFrame& frame, uint64_t sampleMicros, void* context);
+
+// Receiving end: takes notification payloads, or a recording of them in
+// arbitrary chunks, and hands out each frame with its time unwrapped to 64
+// bits. Gaps in the frame sequence count as lost frames; bytes that are not
+// a batch are skipped until the next one.
+class StreamDecoder {
+private:
+  uint8_t buffer[STREAM_MAX_PAYLOAD];
+  size_t buffered;
+  bool started;
+  uint16_t lastSequence;
+  uint32_t lastMicros;
+  uint64_t unwrappedMicros;
+
+public:
+  uint64_t frames;
+  uint64_t batches;
+  uint64_t lostFrames;
+  uint64_t skippedBytes;
+  uint64_t firstMicros;        // unwrapped time of the first frame
+  uint64_t lastFrameMicros;    // and of the newest
+
+  StreamDecoder();
+  void reset();
+  void feed(const uint8_t* data, size_t length, StreamFrameHandler handler, void* context);
+
+  // Frames per second of sample time between the first and newest frame
+  double getFramesPerSecond() const;
+};
+
+// Console commands, over serial or the BLE control characteristic:
+//
+//   get                      thresholds, one "name=value" per line
+//   set <name>=<value> ...   change thresholds until the next reboot
+//   calibrate                measure IMU offsets now (device still, ~5 s)
+//   stream on|off            BLE frame stream
+//   events [...]             the event log (see parseEventQuery)
+//
+// Names are the CrashDetectionConfig fields the scoring uses. Returns false
+// for an unknown name or a value outside its range, leaving config as is.
+bool applyConfigSetting(CrashDetectionConfig& config, const char* name, float value);
+bool applyConfigSettings(CrashDetectionConfig& config, const char* arguments);
+
+// Visits "name=value" for each setting
+typedef void (*ConfigLineHandler)(const char* line, void* context);
+void formatConfigSettings(const CrashDetectionConfig& config, ConfigLineHandler handler, void* context);
+
+#endif // BLE_STREAM_H
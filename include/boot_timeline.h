@@ -0,0 +1,54 @@
+#ifndef BOOT_TIMELINE_H
+#define BOOT_TIMELINE_H
+
+#include <stdint.h>
+
+// Boot stages. Detection needs only the first three; calibration and the
+// network stages come up behind it from loop().
+enum BootStage {
+  BOOT_SENSORS = 0,     // I2C up, IMUs configured
+  BOOT_DETECTOR,        // filter and crash detector configured
+  BOOT_ARMED,           // first sample through detectCrash()
+  BOOT_CALIBRATED,      // IMU offsets known: stored, or learned at a stop
+  BOOT_WIFI,            // associated, with an address
+  BOOT_UTC,             // UTC from SNTP or GPS
+  BOOT_CLOUD,           // Firebase authenticated
+  BOOT_FIRST_UPLOAD,    // first telemetry frame written
+  BOOT_STAGE_COUNT
+};
+
+// Give up waiting for the remaining stages and print what was reached
+#define BOOT_REPORT_TIMEOUT_MS 60000
+
+// When each boot stage was first reached, in Clock::micros64() (time since
+// the application started; the ROM and second-stage bootloaders before it
+// are not counted)
+class BootTimeline {
+private:
+  uint64_t stageMicros[BOOT_STAGE_COUNT];
+  bool reached[BOOT_STAGE_COUNT];
+  bool reported;
+
+public:
+  BootTimeline();
+  void begin();
+
+  // Record the stage at its first call; true then, false on repeats
+  bool mark(BootStage stage, uint64_t nowMicros);
+  bool isReached(BootStage stage) const;
+  uint64_t getMicros(BootStage stage) const;
+  uint32_t getMillis(BootStage stage) const;
+
+  // Every reached stage came after the ones it depends on; above all,
+  // detection was armed before any network stage
+  bool isInOrder() const;
+  bool isComplete() const;
+
+  // Prints the timeline once, when every stage is reached or
+  // BOOT_REPORT_TIMEOUT_MS has passed; true when it printed
+  bool report(uint64_t nowMicros);
+  void print() const;
+  static const char* stageName(BootStage stage);
+};
+
+#endif // BOOT_TIMELINE_H
@@ -0,0 +1,78 @@
+#ifndef CLOCK_DISCIPLINE_H
+#define CLOCK_DISCIPLINE_H
+
+#include "config.h"
+#include <stdint.h>
+
+// Where the current mapping came from, best last
+enum TimeSource {
+  TIME_SOURCE_NONE = 0,
+  TIME_SOURCE_NTP,
+  TIME_SOURCE_GPS_NMEA,
+  TIME_SOURCE_GPS_PPS
+};
+
+// Maps the monotonic microsecond clock (Clock::micros64()) to UTC.
+//
+// Each reference is a (monotonic, UTC) pair from NTP or GPS together with
+// its uncertainty. The first one sets the mapping; after that the offset to
+// the prediction is slewed out at up to CLOCK_MAX_SLEW_PPM, so converted
+// timestamps never jump or run backwards, and the oscillator's frequency
+// error is learned from successive offsets. Offsets beyond
+// CLOCK_STEP_THRESHOLD_US are stepped instead. A reference less certain than
+// the current error estimate is ignored, so NTP does not pull a
+// PPS-disciplined clock around; it takes over again once holdover has let
+// the estimate grow past its uncertainty.
+//
+// toUtcMicros() is a few integer multiplies, cheap enough to run per sample.
+class ClockDiscipline {
+private:
+  bool synced;
+  uint64_t anchorMono;       // mapping is linear from here
+  int64_t anchorUtc;
+  int32_t frequencyPpb;      // learned oscillator error
+  int32_t slewPpb;           // extra rate while a correction is applied
+  uint64_t slewDuration;     // microseconds after anchorMono the slew lasts
+  uint64_t lastReferenceMono;
+  uint32_t referenceUncertainty;
+  int64_t lastOffset;
+  uint32_t referenceCount;
+  uint32_t stepCount;
+  uint32_t rejectedCount;
+  TimeSource source;
+  uint64_t frequencyBaseline; // reference time the estimate is built on
+
+  void anchor(uint64_t monoMicros, int64_t utcMicros);
+  int64_t remainingSlew(uint64_t monoMicros) const;
+
+public:
+  ClockDiscipline();
+
+  // Forget all references
+  void reset();
+
+  // Feed a reference: UTC at the monotonic instant monoMicros. False if it
+  // was rejected as less accurate than the current mapping.
+  bool addReference(uint64_t monoMicros, int64_t utcMicros, uint32_t uncertaintyMicros,
+                    TimeSource referenceSource);
+
+  bool isSynced() const;
+
+  // UTC microseconds at a monotonic instant; 0 until synced
+  int64_t toUtcMicros(uint64_t monoMicros) const;
+
+  // Estimated error bound of toUtcMicros() at that instant
+  uint32_t getErrorMicros(uint64_t monoMicros) const;
+
+  // Diagnostics
+  int32_t getFrequencyPpb() const;
+  int64_t getLastOffsetMicros() const;
+  uint32_t getReferenceCount() const;
+  uint32_t getStepCount() const;
+  uint32_t getRejectedCount() const;
+  TimeSource getSource() const;
+
+  static const char* getSourceName(TimeSource timeSource);
+};
+
+#endif // CLOCK_DISCIPLINE_H
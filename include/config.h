@@ -1,6 +1,8 @@
 #ifndef CONFIG_H
 #define CONFIG_H
 
+#include <stdint.h>
+
 // Firebase credentials - CHANGE THESE TO YOUR VALUES
 #define API_KEY "<Replace_with_the_API_Key>"
 #define DATABASE_URL "<Replace_with_the_URL>"
@@ -15,6 +17,8 @@
 #define ECHO_PIN 18
 #define GPS_RX_PIN 16
 #define GPS_TX_PIN 17
+#define MPU_INT_PIN 4     // MPU6050 INT (data ready); -1 if not wired
+#define GPS_PPS_PIN 35    // GPS 1PPS output; -1 if not wired
 
 // I2C pins (default for ESP32)
 #define SDA_PIN 21
@@ -28,15 +32,22 @@ struct CrashDetectionConfig {
   int consecutiveReadings = 3;     // number of consecutive high readings
   float recoveryTime = 5000;       // milliseconds before reset
   float proximityThreshold = 30.0; // cm for obstacle detection
-  float jerkThreshold = 10.0;      // threshold for jerk detection
-  float severeJerkThreshold = 20.0; // threshold for severe jerk
+  float jerkThreshold = 40.0;      // threshold for jerk detection
+  float severeJerkThreshold = 80.0; // threshold for severe jerk
   float severeAccelThreshold = 5.0; // threshold for severe acceleration
   float severeGyroThreshold = 400.0; // threshold for severe rotation
+  int jerkWindow = 2;              // readings per jerk estimate: 2 = difference with the
+                                   // previous one, 3..15 = Savitzky-Golay derivative
+  float vibrationFlatness = 0;     // > 0: the vibration pin only scores when the accel
+                                   // spectrum is at least this flat (impact, not engine tone)
+  float impactEnergy = 0;          // > 0: broadband accel energy (g^2) that scores like the pin
 };
 
 // Timing configuration
 #define SENSOR_READ_INTERVAL 100    // milliseconds
 #define FIREBASE_SEND_INTERVAL 5000 // milliseconds
+#define FIREBASE_CRASH_SEND_INTERVAL 1000 // milliseconds, while a moderate or severe crash is confirmed
+#define EMERGENCY_ALERT_QUEUE 4 // alerts held while offline; more are refused and counted
 #define DEBUG_PRINT_INTERVAL 2000   // milliseconds
 #define GPS_BAUD_RATE 9600
 #define SERIAL_BAUD_RATE 115200
@@ -44,20 +55,188 @@ struct CrashDetectionConfig {
 // NTP configuration
 #define NTP_SERVER "pool.ntp.org"
 #define TIME_OFFSET 19800  // GMT+5:30 for India (in seconds)
+#define MIN_VALID_EPOCH 1600000000UL  // earlier clock readings are unsynced
+
+// Connection state machine timeouts (milliseconds)
+#define WIFI_ASSOCIATE_TIMEOUT 10000
+#define DHCP_TIMEOUT 5000
+#define TIME_SYNC_TIMEOUT 10000   // on expiry auth proceeds on uptime timestamps
+#define AUTH_TIMEOUT 15000
+#define RECONNECT_BACKOFF_MIN 1000
+#define RECONNECT_BACKOFF_MAX 60000
+
+// Clock discipline (monotonic esp_timer -> UTC)
+#define NTP_UNCERTAINTY_US 10000       // assumed SNTP error after round-trip compensation
+#define CLOCK_STEP_THRESHOLD_US 128000 // larger offsets are stepped, smaller ones slewed
+#define CLOCK_MAX_SLEW_PPM 500         // slew rate limit, keeps UTC monotonic
+#define CLOCK_MIN_SLEW_US 500000       // shortest period a correction is spread over
+#define CLOCK_MAX_FREQ_PPM 500         // bound on the estimated oscillator error
+#define CLOCK_HOLDOVER_PPM 50          // assumed drift before the frequency is learned
+#define CLOCK_TRACKING_PPM 10          // assumed drift once it is
+
+// GPS time references. The PPS edge marks the start of the UTC second named
+// by the NMEA sentences that follow it; without PPS the start of the burst
+// is used, which the receiver emits some tens of ms after the second.
+#define GPS_PPS_UNCERTAINTY_US 10      // receiver PPS accuracy plus ISR latency
+#define GPS_PPS_MAX_AGE_US 900000      // NMEA later than this after the edge is unpaired
+#define GPS_NMEA_LATENCY_US 50000      // typical start of the burst after the second
+#define GPS_NMEA_UNCERTAINTY_US 100000 // spread of that latency across receivers
+
+// Position estimator: IMU mounted with X forward and Z up
+#define POSITION_GPS_SIGMA_M 3.0f     // GPS fix noise, per axis
+#define POSITION_ACCEL_SIGMA 0.5f     // forward acceleration noise (m/s^2), tilt and bias included
+#define POSITION_GYRO_SIGMA 0.035f    // yaw rate noise (rad/s)
+#define POSITION_RECENTRE_M 5000.0f   // move the local origin beyond this distance
 
-// Firebase paths
-#define FB_SENSORS_PATH "Servo1/sensors/"
-#define FB_EMERGENCY_PATH "Servo1/emergency/"
-#define FB_CRASH_STATUS_PATH "Servo1/crashStatus"
-#define FB_EMERGENCY_ACTIVE_PATH "Servo1/emergencyActive"
+// Firebase paths - each unit writes under FB_DEVICES_ROOT/<device id>/,
+// where the device id is DEVICE_ID_PREFIX + the eFuse MAC in hex
+#define FB_DEVICES_ROOT "devices/"
+#define DEVICE_ID_PREFIX "esp32-"
+#define FB_SENSORS_NODE "sensors"
+#define FB_SENSORS_PATH FB_SENSORS_NODE "/"
+#define FB_EMERGENCY_PATH "emergency/"
+#define FB_CRASH_STATUS_PATH "crashStatus"
+#define FB_EMERGENCY_ACTIVE_PATH "emergencyActive"
 
 // MPU6050 configuration
 #define MPU6050_ACCEL_RANGE MPU6050_ACCEL_FS_8  // ±8g
 #define MPU6050_GYRO_RANGE MPU6050_GYRO_FS_500  // ±500°/s
 #define MPU6050_DLPF_MODE MPU6050_DLPF_BW_42    // 42Hz filter
+// With the DLPF on, the MPU6050 samples at 1 kHz / (1 + divider): one output
+// (and one data-ready edge) per SENSOR_READ_INTERVAL
+#define MPU6050_RATE_DIVIDER (SENSOR_READ_INTERVAL - 1)
+#define MPU6050_ACCEL_LSB_PER_G 4096.0          // sensitivity at ±8g
+#define MPU6050_GYRO_LSB_PER_DPS 65.5           // sensitivity at ±500°/s
+
+// Redundant IMUs on the I2C bus, one per AD0 address (0x68 low, 0x69 high),
+// all mounted in the same orientation. A missing one is skipped at begin().
+#ifndef IMU_COUNT
+#define IMU_COUNT 2
+#endif
+#define IMU_ADDRESSES {0x68, 0x69}
+#define IMU_STUCK_READINGS 20         // identical raw frames in a row: stuck sensor
+#define IMU_FAILED_READINGS 5         // failed reads in a row: detached sensor
+#define IMU_SATURATION_COUNTS 32000   // |raw| at or above this is clipped by the range
+#define IMU_SAMPLE_BUDGET_US 1000     // all IMU reads within 1 ms of the data-ready edge
+
+// I2C bus. 400 kHz is the MPU6050's limit; the ESP32 controller also runs
+// 1 MHz (Fast-mode Plus) for parts rated for it.
+#define I2C_CLOCK_HZ 400000
+#define I2C_TRANSACTION_OVERHEAD_US 50 // driver setup and completion interrupt
+#define I2C_TIMEOUT_MS 2              // per transaction; a 14-byte burst takes 0.4 ms
+#define I2C_RECOVERY_PULSES 9         // SCL pulses to free SDA: one byte plus ACK
+#define I2C_REINIT_FAILURES 3         // failed transactions in a row before a restart
+
+// Background IMU calibration. Gyro zero-rate offsets are learned from the
+// stationary stretches of a drive (traffic lights, parking) and modelled
+// against the MPU's die temperature; the model is kept in NVS.
+#define BIAS_WINDOW_MS 2000            // readings tested together for stillness
+#define BIAS_MIN_SAMPLES 10            // fewer in a window: not tested
+#define BIAS_GYRO_STILL_DPS 1.5f       // per-axis std dev limits while still: an
+#define BIAS_ACCEL_STILL_G 0.02f       // idling engine passes, rolling on a road does not
+#define BIAS_GRAVITY_TOLERANCE_G 0.1f  // |accel| this close to 1 g
+#define BIAS_MAX_INITIAL_DPS 20.0f     // datasheet zero-rate tolerance
+#define BIAS_MAX_JUMP_DPS 3.0f         // further from the model is a slow turn, not bias
+#define BIAS_RELEARN_WINDOWS 15        // still windows in a row that far off: start over
+#define BIAS_TEMP_MIN_C -20.0f         // temperature bins from here up
+#define BIAS_TEMP_BIN_C 4.0f
+#define BIAS_BIN_MAX_WEIGHT 10.0f      // windows a bin averages; newer ones replace older
+#define BIAS_MIN_SPREAD_C 2.0f         // temperature std dev before a slope is fitted
+#define BIAS_MAX_SLOPE_DPS_PER_C 0.2f
+#define BIAS_REFERENCE_C 25.0f
+#define BIAS_NVS_NAMESPACE "imu_bias"
+#define BIAS_SAVE_INTERVAL_MS 600000   // NVS writes at most this often
+
+// Health supervision of the main loop (see HealthMonitor). Budgets are per
+// step; the hardware task watchdog resets the chip when the loop stops
+// feeding it for WATCHDOG_TIMEOUT_S.
+#define WATCHDOG_TIMEOUT_S 5
+#define HEALTH_HEARTBEAT_TIMEOUT_MS 2000  // critical tasks complete a step at least this often
+#define HEALTH_STRIKES 3                  // overruns in a row before a task is suspended
+#define HEALTH_RETRY_MIN_MS 10000         // first suspension; doubles on each relapse
+#define HEALTH_RETRY_MAX_MS 600000
+#define TASK_BUDGET_IMU_MS 10
+#define TASK_BUDGET_DETECTION_MS 20
+#define TASK_BUDGET_ULTRASONIC_MS 40      // pulseIn gives up after 30 ms
+#define TASK_BUDGET_GPS_MS 120            // readGPS stops draining after 100 ms
+#define TASK_BUDGET_NETWORK_MS 3000       // TLS handshakes and RTDB round trips
+
+// Sensor rates (see RateScheduler). The IMU is read on its data-ready edge,
+// the others on their own periods, the most frequent first; each deadline
+// is the period. The budgets are what a read should cost, well inside the
+// TASK_BUDGET_* that suspend a sensor; a read over its budget is counted.
+#define ULTRASONIC_PERIOD_MS 100          // the HC-SR04 wants >= 60 ms between pings
+#define GPS_PERIOD_MS 50                  // drain before the 64-byte UART buffer fills (67 ms at 9600 baud)
+#define SOURCE_BUDGET_IMU_US 2000
+#define SOURCE_BUDGET_ULTRASONIC_US 31000 // echo timeout plus trigger
+#define SOURCE_BUDGET_GPS_US 5000
+#define ULTRASONIC_MAX_AGE_MS 250         // older distances are reported missing
 
-// Sensor history size
-#define SENSOR_HISTORY_SIZE 10
+// Crash confirmation (see CrashConfirmer). A detection opens a window in
+// which what the vehicle does next decides whether it is escalated.
+#define CONFIRM_MIN_MS 1000            // earliest decision after the trigger
+#define CONFIRM_WINDOW_MS 4000         // latest decision after the trigger
+#define CONFIRM_REST_MS 800            // quiet this long: the vehicle has come to rest
+#define CONFIRM_REST_ACCEL_G 0.1f      // |accel| this close to 1 g...
+#define CONFIRM_REST_GYRO_DPS 6.0f     // ...and |gyro| below this
+#define CONFIRM_TILT_DEG 35.0f         // orientation change from before the impact
+#define CONFIRM_MOVING_MPS 3.0f        // GPS ground speed that counts as driving
+#define CONFIRM_PARKED_MS 3000         // below it this long before the impact: parked
+#define CONFIRM_FIX_MAX_AGE_MS 2500    // speed unknown once the last fix is older
+#define CONFIRM_FREEFALL_G 0.35f       // |accel| below this: the unit itself is falling
+#define CONFIRM_FREEFALL_MS 150        // at least this long, ending within
+#define CONFIRM_FREEFALL_GAP_MS 300    // this of the impact: dropped, not crashed
+
+// On-device event log (see EventLog): scored readings and confirmation
+// decisions, kept in the "events" flash partition
+#define EVENT_LOG_PARTITION "events"
+#define EVENT_LOG_BUDGET_BYTES (256 * 1024) // flash used; the oldest segments are pruned
+#define EVENT_LOG_MIN_SCORE 1               // readings scoring this or more are logged...
+#define EVENT_LOG_HOLDOFF_MS 1000           // ...unless one scoring as much was within this
+#define EVENT_LOG_KEEP_SEVERITY MODERATE_CRASH // segments holding this or worse are pruned last
+
+// BLE companion for workshop diagnostics (see BleCompanion): binary sensor
+// frames batched into notifications, and the console commands over GATT
+#define BLE_DEVICE_NAME "CrashDetect"
+#define BLE_REQUESTED_MTU 247        // ESP32 maximum is 517; phones settle on 185-247
+#define BLE_BATCH_MAX_MS 50          // a partly filled batch goes out after this
+
+// Binary telemetry on the serial console (see Telemetry): COBS-framed
+// records in place of the formatted status dump, turned back into CSV by
+// tools/telemetry_decoder. Records above TELEMETRY_LEVEL are compiled out;
+// TELEMETRY_OFF brings back the text dump.
+#define TELEMETRY_OFF 0
+#define TELEMETRY_INFO 1             // state changes and periodic stats
+#define TELEMETRY_DEBUG 2            // plus every sample and score
+#ifndef TELEMETRY_LEVEL
+#define TELEMETRY_LEVEL TELEMETRY_INFO
+#endif
+#define TELEMETRY_RING_SIZE 2048     // frames waiting for the UART; full: new ones dropped
+#define TELEMETRY_UART_TX_BUFFER 1024 // UART driver ring, sent from its interrupt
+
+// Digital pre-filter between SensorManager and CrashDetector (0 Hz = off).
+// The defaults pass readings through unchanged: the crash thresholds are
+// tuned on unfiltered data, so retune them when enabling a stage.
+struct FilterConfig {
+  float sampleRateHz = 1000.0f / SENSOR_READ_INTERVAL;
+  float accelLowPassHz = 0;   // Butterworth low-pass on each accel axis
+  float gyroLowPassHz = 0;    // same on each gyro axis
+  int lowPassOrder = 2;       // even, 2..8
+  float highPassHz = 0;       // accel and gyro; removes gravity and bias
+  float notchHz = 0;          // engine or road resonance
+  float notchQ = 5.0;
+  bool fixedPoint = false;    // integer cascades on raw sensor counts
+};
+
+// Readings CrashDetector keeps (1.6 s at 10 Hz). Must be a power of two;
+// high-rate builds can raise it with -DSENSOR_HISTORY_SIZE=4096
+#ifndef SENSOR_HISTORY_SIZE
+#define SENSOR_HISTORY_SIZE 16
+#endif
+
+// Spectral vibration features over the newest readings in that history
+#define SPECTRUM_WINDOW 16   // readings per FFT: power of two, at most SENSOR_HISTORY_SIZE
+#define SPECTRUM_BANDS 4     // equal-width energy bands from 0 Hz to Nyquist
 
 // Crash severity levels
 enum CrashSeverity {
@@ -67,6 +246,19 @@ enum CrashSeverity {
   SEVERE_CRASH = 3
 };
 
+// Sensors behind the fields of a reading
+#define SENSOR_IMU 0x01         // accel and gyro
+#define SENSOR_ULTRASONIC 0x02  // distance
+#define SENSOR_VIBRATION 0x04   // vibration
+#define SENSOR_GPS 0x08         // latitude and longitude
+#define SENSOR_ALL 0x0F
+
+// Fields that hold a reading but a weaker one
+#define QUALITY_IMU_REDUCED 0x01     // voted from fewer IMUs than answered at begin()
+#define QUALITY_IMU_CLIPPED 0x02     // an axis at full scale on every IMU
+#define QUALITY_NO_ECHO 0x04         // nothing within ultrasonic range (distance -1)
+#define QUALITY_POSITION_ESTIMATED 0x08 // no new fix: position dead-reckoned
+
 // Sensor data structure
 struct SensorData {
   float accelX, accelY, accelZ;
@@ -74,7 +266,18 @@ struct SensorData {
   float distance;
   int vibration;
   float latitude, longitude;
-  unsigned long timestamp;
+  float positionErrorM; // 1-sigma horizontal error of the estimate; 0 if none
+  uint32_t timestamp;   // Clock::millis() at the sample, wraps with the counter
+  uint64_t sampleMicros; // Clock::micros64() at IMU data ready; 0 if unknown
+  uint64_t gpsFixMicros; // Clock::micros64() a new GPS fix refers to; 0 if none
+  uint8_t missing;      // SENSOR_* whose fields are zero-filled, not read
+  uint8_t quality;      // QUALITY_* flags
 };
 
+// The sensors that contributed to a reading. Recorded and hand-built
+// readings leave missing at zero and count as complete.
+inline uint8_t sensorSet(const SensorData& data) {
+  return SENSOR_ALL & ~data.missing;
+}
+
 #endif // CONFIG_H
\ No newline at end of file
@@ -0,0 +1,94 @@
+#ifndef CONNECTION_STATE_H
+#define CONNECTION_STATE_H
+
+#include "config.h"
+#include <stdint.h>
+
+// Connectivity stages, in the order a healthy link walks through them
+enum ConnectionState {
+  CONN_IDLE = 0,
+  CONN_ASSOCIATING,
+  CONN_DHCP,
+  CONN_TIME_SYNC,
+  CONN_AUTH,
+  CONN_READY,
+  CONN_BACKOFF
+};
+
+enum AuthStatus {
+  AUTH_PENDING = 0,
+  AUTH_OK,
+  AUTH_FAILED
+};
+
+// What the state machine needs from the network stack. Every call must
+// return immediately: start*() kick work off, the queries report progress.
+class ConnectionLink {
+public:
+  virtual ~ConnectionLink() {}
+  virtual void startAssociation() = 0;
+  virtual bool isAssociated() = 0;
+  virtual bool hasAddress() = 0;
+  virtual void startTimeSync() = 0;
+  virtual bool isTimeSynced() = 0;
+  virtual void startAuth() = 0;
+  virtual AuthStatus getAuthStatus() = 0;
+  virtual void disconnect() = 0;
+};
+
+struct ConnectionTimings {
+  uint32_t associateTimeout = WIFI_ASSOCIATE_TIMEOUT;
+  uint32_t dhcpTimeout = DHCP_TIMEOUT;
+  uint32_t timeSyncTimeout = TIME_SYNC_TIMEOUT;
+  uint32_t authTimeout = AUTH_TIMEOUT;
+  uint32_t backoffMin = RECONNECT_BACKOFF_MIN;
+  uint32_t backoffMax = RECONNECT_BACKOFF_MAX;
+};
+
+// IDLE -> ASSOCIATING -> DHCP -> TIME_SYNC -> AUTH -> READY. A timeout,
+// failed auth or lost association drops the link and waits in BACKOFF
+// (doubling up to backoffMax, with up to 25% jitter so a fleet does not
+// retry in lockstep) before associating again. poll() does a bounded amount
+// of work and never waits, so it can run on every pass of the main loop.
+class ConnectionStateMachine {
+private:
+  ConnectionLink* link;
+  ConnectionTimings timings;
+  ConnectionState state;
+  uint32_t stateSince;
+  uint32_t backoffDelay;
+  uint32_t currentBackoff;
+  uint32_t jitterState;
+  uint32_t attempts;
+  uint32_t failures;
+  bool timeSynced;
+
+  void enter(ConnectionState next, uint32_t now);
+  void fail(uint32_t now);
+  uint32_t nextJitter(uint32_t range);
+
+public:
+  ConnectionStateMachine();
+
+  // Bind the link; jitterSeed should differ per unit (e.g. the MAC)
+  void begin(ConnectionLink* connectionLink, const ConnectionTimings& connectionTimings,
+             uint32_t jitterSeed);
+
+  // Advance by at most one transition
+  void poll(uint32_t now);
+
+  // Drop the link and start over from IDLE with the minimum backoff
+  void restart();
+
+  ConnectionState getState() const;
+  bool isReady() const;
+  bool isTimeSynced() const;
+  uint32_t getStateSince() const;
+  uint32_t getBackoffDelay() const;
+  uint32_t getAttempts() const;
+  uint32_t getFailures() const;
+
+  static const char* getStateName(ConnectionState connectionState);
+};
+
+#endif // CONNECTION_STATE_H
@@ -0,0 +1,109 @@
+#ifndef CRASH_CONFIRMER_H
+#define CRASH_CONFIRMER_H
+
+#include "config.h"
+#include <stdint.h>
+
+enum ConfirmState {
+  CONFIRM_IDLE = 0,
+  CONFIRM_PENDING,     // triggered, watching what the vehicle does next
+  CONFIRM_CONFIRMED    // escalated; held until reset()
+};
+
+// What one update() changed
+enum ConfirmEvent {
+  CONFIRM_NONE = 0,
+  CONFIRM_TRIGGER,     // window opened: send the pre-warning
+  CONFIRM_UPDATE,      // pending severity rose
+  CONFIRM_ESCALATE,    // confirmed: send the emergency alert
+  CONFIRM_DISMISS      // not a crash: clear the pre-warning
+};
+
+enum ConfirmReason {
+  REASON_NONE = 0,
+  REASON_REST,         // came to rest after driving
+  REASON_TILT,         // ended up on its side or roof
+  REASON_SEVERITY,     // severe enough without further evidence
+  REASON_DRIVING,      // dismissed: driving on at speed
+  REASON_DROPPED,      // dismissed: the unit fell from its mount
+  REASON_NO_EVIDENCE   // dismissed: window over, nothing to back it up
+};
+
+// Post-impact motion analysis between CrashDetector and the emergency
+// alert. The first detection opens a window of up to CONFIRM_WINDOW_MS;
+// the detector's per-reading severities raise the pending severity, and
+// from CONFIRM_MIN_MS on the first of these decides:
+//   tilted by CONFIRM_TILT_DEG          -> confirmed one level up
+//   GPS speed still at driving speed    -> one level down, dismissed below moderate
+//   at rest after driving               -> confirmed as is
+//   window over                         -> one level down, dismissed below moderate
+// Speeds only count from fixes taken after the impact. At rest means a
+// still IMU plus, when GPS was tracking before the impact, a low speed
+// from those fixes; if none arrive, the still IMU alone decides at the end
+// of the window. Free fall just before the impact means the unit was
+// knocked off its mount, and dismisses at once. Time is passed in; no I/O.
+class CrashConfirmer {
+private:
+  ConfirmState state;
+  ConfirmReason reason;
+  int severity;               // pending, then confirmed
+  uint32_t triggerMs;
+  uint64_t triggerMicros;
+  uint32_t decisionMs;
+
+  // Before the trigger
+  float gravity[3];           // slow average of accel while near 1 g
+  bool hasGravity;
+  bool falling;
+  uint32_t fallStartMs;
+  uint32_t fallEndMs;         // end of the last long enough fall
+  bool hasFall;
+
+  // GPS ground speed from consecutive fixes
+  float lastFixLatitude;
+  float lastFixLongitude;
+  uint64_t lastFixMicros;
+  uint32_t speedMs;           // reading time of the fix that completed the pair
+  uint64_t speedFromMicros;   // the earlier fix of the pair
+  float speedMps;
+  bool hasSpeed;
+  uint32_t movingMs;          // last speed at or above CONFIRM_MOVING_MPS
+  bool hasMoved;
+
+  // In the window
+  bool movingBefore;          // driving shortly before the trigger, or speed unknown
+  bool trackedBefore;         // GPS speed known at the trigger
+  bool resting;
+  uint32_t restSinceMs;
+  float maxTiltDegrees;
+
+  void trackFall(float magnitude, uint32_t nowMs);
+  void trackGravity(const SensorData& reading, float magnitude);
+  float tiltDegrees(const SensorData& reading) const;
+  ConfirmEvent escalate(int newSeverity, ConfirmReason why, uint32_t nowMs);
+  ConfirmEvent dismiss(ConfirmReason why, uint32_t nowMs);
+
+public:
+  CrashConfirmer();
+
+  void reset();
+
+  // A reading with a new GPS fix, before PositionEstimator replaces its
+  // latitude/longitude with the estimate
+  void observeFix(const SensorData& raw);
+
+  // Every reading, with the severity detectCrash() gave it
+  ConfirmEvent update(const SensorData& reading, int detectedSeverity, uint32_t nowMs);
+
+  ConfirmState getState() const;
+  int getSeverity() const;
+  ConfirmReason getReason() const;
+  uint32_t getTriggerMs() const;
+  uint32_t getDecisionMs() const;
+  float getMaxTiltDegrees() const;
+  // < 0 when there is no recent fix
+  float getSpeed(uint32_t nowMs) const;
+  static const char* reasonName(ConfirmReason reason);
+};
+
+#endif // CRASH_CONFIRMER_H
@@ -2,27 +2,41 @@
 #define CRASH_DETECTOR_H
 
 #include "config.h"
+#include "dsp_filter.h"
+#include "hal.h"
+#include "sensor_history.h"
+#include "spectral_features.h"
 #include <Arduino.h>
 
 class CrashDetector {
 private:
   CrashDetectionConfig config;
-  SensorData* sensorHistory;
-  int historySize;
-  int currentIndex;
+  DetectorHistory history;
   bool crashDetected;
-  unsigned long crashDetectionTime;
+  uint32_t crashDetectionTime;
   int currentSeverity;
+  int lastScore;
+  uint8_t lastSensors;                   // sensor set behind lastScore
+  uint32_t sinceImuGap;                  // readings since the last one without the IMU
+  // Score for SEVERE, MODERATE and MINOR per available sensor set, worked
+  // out once per configuration so a degraded reading costs no more
+  int severityCutoffs[SENSOR_ALL + 1][3];
+  int jerkWindow;                        // readings per jerk estimate
+  float jerkWeights[FILTER_MAX_TAPS];    // Savitzky-Golay slope weights, newest first
+  SpectralFeatures spectrum;             // latest from SpectralAnalyzer, if any
 
   // Helper functions
+  void designJerk();
+  void designCutoffs();
   float calculateMagnitude(float x, float y, float z);
-  float calculateJerk(const SensorData& current, const SensorData& previous);
+  uint32_t currentInHistory(const SensorData& current);
+  float calculateJerk(const SensorData& current, uint32_t previousIndex);
+  bool calculateSmoothedJerk(const SensorData& current, float& jerk);
   int calculateConsecutiveHighReadings();
-  int calculateCrashScore(const SensorData& currentReading);
+  int calculateCrashScore(const SensorData& currentReading, uint8_t& sensors);
 
 public:
   CrashDetector();
-  ~CrashDetector();
   
   // Initialize the crash detector
   void begin(const CrashDetectionConfig& detectorConfig);
@@ -33,12 +47,27 @@ public:
   // Add sensor reading to history
   void addToHistory(const SensorData& data);
   
+  // Accel spectrum for the next detectCrash(); see vibrationFlatness and
+  // impactEnergy in CrashDetectionConfig
+  void setSpectralFeatures(const SpectralFeatures& features);
+  
   // Check if crash is currently detected
   bool isCrashDetected() const;
   
   // Get current crash severity
   int getCrashSeverity() const;
   
+  // Score behind the last detectCrash() result, and the sensors it drew
+  // on. Severity cutoffs are scaled to the most those sensors can score;
+  // without the IMU nothing is detected.
+  int getLastScore() const;
+  uint8_t getLastSensorSet() const;
+  static int maxScore(uint8_t sensors);
+  
+  // Hold the latched detection at the severity CrashConfirmer settled on;
+  // the recovery time runs from here
+  void confirmCrash(int severity);
+  
   // Reset crash detection state
   void resetCrashDetection();
   
@@ -52,7 +81,7 @@ public:
   CrashDetectionConfig getConfig() const;
   
   // Get sensor history for debugging
-  SensorData* getHistory() const;
+  const DetectorHistory& getHistory() const;
   int getHistoryIndex() const;
 };
 
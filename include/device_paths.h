@@ -0,0 +1,56 @@
+#ifndef DEVICE_PATHS_H
+#define DEVICE_PATHS_H
+
+#include "firebase_paths.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Paths that are written on every send, resolved once per device
+enum DevicePath {
+  PATH_SENSORS = 0,
+  PATH_ACCEL_X,
+  PATH_ACCEL_Y,
+  PATH_ACCEL_Z,
+  PATH_GYRO_X,
+  PATH_GYRO_Y,
+  PATH_GYRO_Z,
+  PATH_DISTANCE,
+  PATH_VIBRATION,
+  PATH_LATITUDE,
+  PATH_LONGITUDE,
+  PATH_CRASH_SEVERITY,
+  PATH_CRASH_DETECTED,
+  PATH_TIMESTAMP,
+  PATH_TEST,
+  PATH_CRASH_STATUS,
+  PATH_EMERGENCY_ACTIVE,
+  DEVICE_PATH_COUNT
+};
+
+// Device-scoped Firebase paths. All absolute paths are built into fixed
+// buffers once in begin(), so per-frame lookups are a table index.
+class DevicePaths {
+private:
+  char deviceId[DEVICE_ID_SIZE];
+  char paths[DEVICE_PATH_COUNT][DEVICE_PATH_SIZE];
+
+public:
+  DevicePaths();
+
+  // Derive the device id from the eFuse MAC (as returned by ESP.getEfuseMac())
+  void begin(uint64_t efuseMac);
+
+  // Use an explicit device id (simulators, bench rigs)
+  void begin(const char* id);
+
+  const char* getDeviceId() const;
+  const char* get(DevicePath path) const;
+
+  // Build FB_DEVICES_ROOT/<id>/FB_EMERGENCY_PATH<timestamp>
+  size_t formatEmergencyPath(char* buffer, size_t bufferSize, unsigned long timestamp) const;
+
+  // Format the device id for a MAC; MAC byte 0 is the low byte of efuseMac
+  static size_t formatDeviceId(char* buffer, size_t bufferSize, uint64_t efuseMac);
+};
+
+#endif // DEVICE_PATHS_H
@@ -0,0 +1,126 @@
+#ifndef DSP_FILTER_H
+#define DSP_FILTER_H
+
+#include <stdint.h>
+
+// Filter building blocks for the sensor pre-filter stage. Coefficients are
+// designed once (RBJ audio-EQ cookbook biquads, Butterworth cascades,
+// Savitzky-Golay least-squares derivatives); processing a sample is then a
+// handful of multiply-adds with fixed-size state and no allocation.
+
+#define FILTER_MAX_BIQUADS 6   // high-pass + notch + 8th-order low-pass
+#define FILTER_MAX_TAPS 15     // longest FIR / Savitzky-Golay window
+
+// y = (b0 x + b1 x1 + b2 x2 - a1 y1 - a2 y2), a0 normalised to 1
+struct BiquadCoefficients {
+  float b0, b1, b2;
+  float a1, a2;
+};
+
+// Second-order sections; frequencies must lie in (0, sampleRate / 2)
+BiquadCoefficients designLowPass(float cutoffHz, float sampleRateHz, float q);
+BiquadCoefficients designHighPass(float cutoffHz, float sampleRateHz, float q);
+BiquadCoefficients designNotch(float centreHz, float sampleRateHz, float q);
+
+// Q of section index of an order-th Butterworth filter built from order/2
+// biquads (order even)
+float butterworthQ(int order, int index);
+
+// Floating-point cascade, direct form II transposed
+class BiquadCascade {
+private:
+  BiquadCoefficients sections[FILTER_MAX_BIQUADS];
+  float state[FILTER_MAX_BIQUADS][2];
+  int count;
+
+public:
+  BiquadCascade();
+
+  void clear();                                  // remove all sections
+  bool add(const BiquadCoefficients& section);   // false when full
+  int size() const;
+
+  // Settle every section at the steady state for a constant input, so a
+  // filter started mid-signal does not ring
+  void reset(float value = 0.0f);
+
+  float process(float x) {
+    for (int i = 0; i < count; i++) {
+      const BiquadCoefficients& c = sections[i];
+      float* s = state[i];
+      float y = c.b0 * x + s[0];
+      s[0] = c.b1 * x - c.a1 * y + s[1];
+      s[1] = c.b2 * x - c.a2 * y;
+      x = y;
+    }
+    return x;
+  }
+
+  // |H(f)| of the whole cascade, from the coefficients
+  float magnitudeAt(float frequencyHz, float sampleRateHz) const;
+};
+
+// Fixed-point cascade, direct form I: Q2.30 coefficients, 64-bit
+// accumulators, samples as int32 in any fixed scale (the sensor filter uses
+// raw sensor counts with 12 fractional bits). Inputs up to 2^28 in
+// magnitude leave the accumulator headroom for five products.
+class BiquadCascadeFixed {
+private:
+  int32_t coefficients[FILTER_MAX_BIQUADS][5];   // b0 b1 b2 a1 a2
+  int32_t state[FILTER_MAX_BIQUADS][4];          // x1 x2 y1 y2
+  int count;
+
+public:
+  static const int FRACTION_BITS = 30;
+
+  BiquadCascadeFixed();
+
+  void clear();
+  bool add(const BiquadCoefficients& section);
+  int size() const;
+  void reset(int32_t value = 0);
+
+  int32_t process(int32_t x) {
+    for (int i = 0; i < count; i++) {
+      const int32_t* c = coefficients[i];
+      int32_t* s = state[i];
+      int64_t acc = (int64_t)c[0] * x + (int64_t)c[1] * s[0] + (int64_t)c[2] * s[1] -
+                    (int64_t)c[3] * s[2] - (int64_t)c[4] * s[3];
+      acc = (acc + ((int64_t)1 << (FRACTION_BITS - 1))) >> FRACTION_BITS;
+      int32_t y = acc > INT32_MAX ? INT32_MAX : (acc < INT32_MIN ? INT32_MIN : (int32_t)acc);
+      s[1] = s[0];
+      s[0] = x;
+      s[3] = s[2];
+      s[2] = y;
+      x = y;
+    }
+    return x;
+  }
+};
+
+// Streaming FIR; taps[0] applies to the newest sample
+class FirFilter {
+private:
+  float taps[FILTER_MAX_TAPS];
+  float history[FILTER_MAX_TAPS];
+  int length;
+  int newest;
+
+public:
+  FirFilter();
+
+  bool setTaps(const float* coefficients, int count);
+  int size() const;
+  void reset(float value = 0.0f);
+  float process(float x);
+};
+
+// Savitzky-Golay first-derivative weights: fit a polynomial of the given
+// order to the last window samples and differentiate it at the newest one.
+// coefficients[i] weights the sample i steps back (0 = newest); the sum is
+// the derivative per sample step, so divide by the step in seconds.
+// Returns false for an unusable window/order (window > order, window up
+// to FILTER_MAX_TAPS, order 1..3).
+bool savitzkyGolayDerivative(int window, int order, float* coefficients);
+
+#endif // DSP_FILTER_H
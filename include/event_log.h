@@ -0,0 +1,163 @@
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include "config.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Raw NOR flash as the log sees it: erasing a sector sets every byte to
+// 0xFF, and writes can only clear bits. Offsets are from the start of the
+// region. Implemented over an ESP32 partition (PartitionFlash) and, on the
+// host, over RAM or an image file (SimFlash).
+class FlashRegion {
+public:
+  virtual ~FlashRegion() {}
+  virtual uint32_t size() const = 0;
+  virtual uint32_t sectorSize() const = 0;
+  virtual bool read(uint32_t offset, void* data, uint32_t length) = 0;
+  virtual bool write(uint32_t offset, const void* data, uint32_t length) = 0;
+  virtual bool eraseSector(uint32_t offset) = 0;
+};
+
+enum EventKind {
+  EVENT_SCORED = 0,    // a reading with a crash score, whether or not it triggered
+  EVENT_TRIGGER,       // CrashConfirmer opened a window
+  EVENT_CONFIRMED,
+  EVENT_DISMISSED
+};
+
+// One logged event: 64 bytes in flash, the reading's feature vector
+// quantised. sequence counts up across the whole log and is 0xFFFFFFFF in
+// an erased slot.
+#define EVENT_RECORD_SIZE 64
+struct EventRecord {
+  uint32_t sequence;
+  uint32_t utcSeconds;     // 0 when the clock was not synced
+  uint32_t uptimeMs;       // Clock::millis() at the reading
+  uint16_t boot;           // ResetRecord::bootCount, low 16 bits
+  uint8_t kind;            // EventKind
+  uint8_t severity;        // CrashSeverity
+  uint8_t score;
+  uint8_t sensors;         // SENSOR_* the score drew on
+  uint8_t quality;         // QUALITY_* of the reading
+  uint8_t reason;          // ConfirmReason, for confirmation events
+  int16_t accelMg[3];
+  int16_t gyroDeciDps[3];  // 0.1 degrees/second
+  int16_t distanceCm;      // -1 without an echo
+  uint8_t vibration;
+  uint8_t reserved;
+  float latitude;
+  float longitude;
+  float spectralEnergy;    // g^2, 0 without a full window
+  float spectralFlatness;
+  float peakG;             // |accel|
+  uint16_t delayMs;        // confirmation events: time since the trigger
+  uint16_t reserved2;
+  uint32_t crc;            // CRC-32 of everything before it
+};
+
+// Filters for query(); every record matching all of them is visited
+struct EventQuery {
+  uint32_t fromUtc = 0;        // 0: from the start, including records without UTC
+  uint32_t toUtc = UINT32_MAX;
+  uint8_t minSeverity = NO_CRASH;
+  uint8_t minScore = 0;
+  uint32_t limit = UINT32_MAX;
+};
+
+// What the directory keeps per segment, and a sealed segment's footer holds
+struct EventSegmentSummary {
+  uint32_t sequence;       // segment sequence from 1, higher is newer; 0 = free
+  uint32_t firstRecord;    // record sequence of its first slot
+  uint16_t records;
+  uint8_t maxSeverity;
+  uint8_t maxScore;
+  uint32_t minUtc;         // over records with UTC; UINT32_MAX if none
+  uint32_t maxUtc;
+  uint8_t unsynced;        // holds records without UTC
+  uint8_t sealed;
+  uint16_t sector;
+  uint64_t notableSlots;   // bit per record slot holding MINOR_CRASH or worse
+};
+
+// Returns false to stop the query
+typedef bool (*EventVisitor)(const EventRecord& record, void* context);
+
+// Append-only event store with a time- and severity-indexed directory.
+//
+// Every flash sector is one segment: a header slot, then record slots, then
+// a footer slot, each EVENT_RECORD_SIZE bytes (62 records in 4 KB). The footer
+// is written when the segment fills and summarises it (record count, UTC
+// range, worst severity and score, which slots hold detections), so begin()
+// rebuilds the directory from one header and one footer read per sector and
+// only scans the open segment. Queries walk the directory, oldest segment
+// first, and read only the segments whose summary can match; asking for
+// MINOR_CRASH or worse reads only the slots holding one. Sectors are at most
+// 4 KB, so a segment's slots fit the 64-bit mask. Segments form a ring within
+// EVENT_LOG_BUDGET_BYTES; when it is full the oldest is erased, passing
+// over ones holding EVENT_LOG_KEEP_SEVERITY or worse while any other is
+// left. A write torn by a reset fails its CRC and is skipped.
+#ifndef EVENT_LOG_MAX_SEGMENTS
+#define EVENT_LOG_MAX_SEGMENTS 128   // directory entries (32 bytes each) held in RAM
+#endif
+class EventLog {
+private:
+  FlashRegion* flash;
+  uint32_t segmentCount;
+  uint32_t recordsPerSegment;
+  EventSegmentSummary directory[EVENT_LOG_MAX_SEGMENTS];  // by sector
+  int activeSector;                  // -1 when none is open
+  uint32_t nextSegment;
+  uint32_t nextRecord;
+  uint32_t prunedSegments;
+  uint32_t lastQueryReads;           // slots read by the last query
+
+  uint32_t slotOffset(uint32_t sector, uint32_t slot) const;
+  bool readSegment(uint32_t sector);
+  bool seal(uint32_t sector);
+  bool openSegment();
+  int pickVictim() const;
+  static void include(EventSegmentSummary& summary, const EventRecord& record);
+  static bool matches(const EventSegmentSummary& summary, const EventQuery& query);
+  static bool matches(const EventRecord& record, const EventQuery& query);
+
+public:
+  EventLog();
+
+  // Mount the log on the region, within budgetBytes of it (and at most
+  // EVENT_LOG_MAX_SEGMENTS sectors); sectors without a valid header are
+  // treated as free
+  bool begin(FlashRegion* region, uint32_t budgetBytes = EVENT_LOG_BUDGET_BYTES);
+
+  // Stamp the record with the next sequence and its CRC and write it
+  bool append(EventRecord& record);
+
+  // Visit matching records in the order they were logged; returns how many
+  uint32_t query(const EventQuery& query, EventVisitor visit, void* context);
+
+  // Erase every segment
+  bool clear();
+
+  uint32_t getRecordCount() const;   // records currently held
+  uint32_t getSegmentCount() const;  // segments in the budget
+  uint32_t getUsedSegments() const;
+  uint32_t getRecordsPerSegment() const;
+  uint32_t getPrunedSegments() const;
+  uint32_t getLastQueryReads() const;
+  const EventSegmentSummary* getSegment(uint32_t sector) const;  // nullptr when free
+};
+
+// A record for one reading; the caller fills in time, boot and spectrum
+EventRecord makeEventRecord(EventKind kind, const SensorData& reading, int severity, int score,
+                            uint8_t sensors);
+
+// False for an erased slot or a write torn by a reset
+bool isValidEventRecord(const EventRecord& record);
+
+// Serial retrieval: "events [from=<utc>] [to=<utc>] [severity=<n>]
+// [score=<n>] [limit=<n>]", answered with one CSV line per record
+bool parseEventQuery(const char* line, EventQuery& query);
+extern const char* const EVENT_CSV_HEADER;
+int formatEventRecord(char* buffer, size_t size, const EventRecord& record);
+
+#endif // EVENT_LOG_H
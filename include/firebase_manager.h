@@ -1,45 +1,82 @@
 #ifndef FIREBASE_MANAGER_H
 #define FIREBASE_MANAGER_H
 
+#include "clock_discipline.h"
 #include "config.h"
+#include "connection_state.h"
+#include "device_paths.h"
+#include "hal.h"
 #include <Arduino.h>
 #include <WiFi.h>
 #include <Firebase_ESP_Client.h>
-#include <NTPClient.h>
-#include <WiFiUdp.h>
+#include <esp_sntp.h>
 #include <addons/TokenHelper.h>
 #include <addons/RTDBHelper.h>
 
-class FirebaseManager {
+class FirebaseManager : private ConnectionLink {
 private:
   FirebaseData fbdo;
   FirebaseAuth auth;
   FirebaseConfig config;
-  WiFiUDP ntpUDP;
-  NTPClient* timeClient;
+  DevicePaths paths;
+  ConnectionStateMachine connection;
+  ClockDiscipline* timeBase;
   
-  bool isConnected;
-  bool signupOK;
-  unsigned long lastConnectionCheck;
-  unsigned long lastDataSend;
+  // Written by the auth task on the target, polled by the main loop
+  volatile AuthStatus authResult;
+  volatile bool authRunning;
+  volatile bool signedUp;
+  uint32_t lastDataSend;
 
-  // Helper functions
-  bool connectToWiFi();
-  bool initializeFirebase();
-  void checkConnection();
+  // Crash status and emergency alert waiting for flushPending()
+  bool statusPending;
+  int pendingSeverity;
+  bool pendingEmergencyActive;
+  struct PendingAlert {
+    SensorData data;
+    int severity;
+    unsigned long timestamp;
+  };
+  PendingAlert alerts[EMERGENCY_ALERT_QUEUE];  // oldest at alertHead
+  uint8_t alertHead;
+  uint8_t alertCount;
+  uint32_t droppedAlerts;
+
+  // ConnectionLink: each step only starts or checks work, never waits
+  void startAssociation() override;
+  bool isAssociated() override;
+  bool hasAddress() override;
+  void startTimeSync() override;
+  bool isTimeSynced() override;
+  void startAuth() override;
+  AuthStatus getAuthStatus() override;
+  void disconnect() override;
+
+  // Anonymous sign-up and Firebase client start; blocks on HTTPS
+  void runAuth();
+  static void authTask(void* parameter);
+
+  bool writeEmergencyAlert(const SensorData& data, int severity, unsigned long timestamp);
 
 public:
   FirebaseManager();
   ~FirebaseManager();
   
-  // Initialize WiFi and Firebase
-  bool begin();
+  // Start connecting; handleConnection() completes it in the background
+  // and feeds each SNTP sync to timeBase, if given
+  void begin(ClockDiscipline* utcClock = nullptr);
+  
+  // Device id used to scope all Firebase paths
+  const char* getDeviceId() const;
   
   // Connection status
   bool isReady() const;
   bool isWiFiConnected() const;
   bool isFirebaseConnected() const;
   
+  // Writes below are sent without waiting for the server's reply, which
+  // takes longer than a sample period; false means a request was not sent
+  
   // Send sensor data
   bool sendSensorData(const SensorData& data, int crashSeverity, bool crashDetected);
   
@@ -49,24 +86,37 @@ public:
   // Update crash status
   bool updateCrashStatus(int severity, bool emergencyActive);
   
+  // Hold a crash status or emergency alert for flushPending(), so detection
+  // never waits on the network. A newer status replaces one not yet sent.
+  // Alerts are stamped with the time of data, the impact sample, and sent
+  // oldest first once connected; with EMERGENCY_ALERT_QUEUE unsent the
+  // new one is refused (false) and counted, never one already held.
+  void queueCrashStatus(int severity, bool emergencyActive);
+  bool queueEmergencyAlert(const SensorData& data, int severity);
+  bool hasPending() const;
+  void flushPending();
+  uint8_t getPendingAlerts() const;
+  uint32_t getDroppedAlerts() const;
+  
   // Send individual sensor values
-  bool sendFloat(const String& path, float value);
-  bool sendInt(const String& path, int value);
-  bool sendBool(const String& path, bool value);
-  bool sendString(const String& path, const String& value);
+  bool sendFloat(const char* path, float value);
+  bool sendInt(const char* path, int value);
+  bool sendBool(const char* path, bool value);
+  bool sendString(const char* path, const char* value);
   
-  // Get current timestamp
+  // Get current timestamp (UTC seconds + TIME_OFFSET, uptime until synced)
   unsigned long getCurrentTimestamp();
+  // Same, for the moment a sample was taken
+  unsigned long getSampleTimestamp(const SensorData& data);
   
-  // Update NTP time
-  void updateTime();
-  
-  // Connection management
+  // Connection management: handleConnection() advances the state machine
+  // and returns within microseconds; reconnect() starts over from IDLE
   void reconnect();
   void handleConnection();
+  ConnectionState getConnectionState() const;
   
-  // Get connection info
-  String getConnectionInfo();
+  // Get connection info (written into buffer, CONNECTION_INFO_SIZE fits)
+  size_t getConnectionInfo(char* buffer, size_t bufferSize);
   String getLastError();
   
   // Test functions
@@ -0,0 +1,40 @@
+#ifndef FIREBASE_PATHS_H
+#define FIREBASE_PATHS_H
+
+#include "config.h"
+
+// Firebase RTDB paths relative to the device root, concatenated at compile
+// time from the FB_*_PATH prefixes so that sending a frame never builds a
+// String per field
+namespace FirebasePaths {
+  constexpr char SENSORS[]         = FB_SENSORS_NODE;
+  constexpr char ACCEL_X[]         = FB_SENSORS_PATH "accelX";
+  constexpr char ACCEL_Y[]         = FB_SENSORS_PATH "accelY";
+  constexpr char ACCEL_Z[]         = FB_SENSORS_PATH "accelZ";
+  constexpr char GYRO_X[]          = FB_SENSORS_PATH "gyroX";
+  constexpr char GYRO_Y[]          = FB_SENSORS_PATH "gyroY";
+  constexpr char GYRO_Z[]          = FB_SENSORS_PATH "gyroZ";
+  constexpr char DISTANCE[]        = FB_SENSORS_PATH "distance";
+  constexpr char VIBRATION[]       = FB_SENSORS_PATH "vibration";
+  constexpr char LATITUDE[]        = FB_SENSORS_PATH "latitude";
+  constexpr char LONGITUDE[]       = FB_SENSORS_PATH "longitude";
+  constexpr char CRASH_SEVERITY[]  = FB_SENSORS_PATH "crashSeverity";
+  constexpr char CRASH_DETECTED[]  = FB_SENSORS_PATH "crashDetected";
+  constexpr char TIMESTAMP[]       = FB_SENSORS_PATH "timestamp";
+  constexpr char TEST[]            = FB_SENSORS_PATH "test";
+  constexpr char CRASH_STATUS[]    = FB_CRASH_STATUS_PATH;
+  constexpr char EMERGENCY_ACTIVE[] = FB_EMERGENCY_ACTIVE_PATH;
+}
+
+// "esp32-" + 12 hex digits of the MAC
+#define DEVICE_ID_SIZE (sizeof(DEVICE_ID_PREFIX) + 12)
+
+// Longest absolute path: root + id + '/' + longest relative path, or the
+// emergency node followed by a 10-digit epoch timestamp
+#define DEVICE_PATH_SIZE (sizeof(FB_DEVICES_ROOT) + DEVICE_ID_SIZE + 24)
+
+// Buffer sizes for the fixed-size status strings
+#define CONNECTION_INFO_SIZE 80
+#define SENSOR_STATUS_SIZE 48
+
+#endif // FIREBASE_PATHS_H
@@ -0,0 +1,126 @@
+#ifndef FIRMWARE_H
+#define FIRMWARE_H
+
+#include "ble_companion.h"
+#include "boot_timeline.h"
+#include "clock_discipline.h"
+#include "config.h"
+#include "crash_confirmer.h"
+#include "crash_detector.h"
+#include "event_log.h"
+#include "firebase_manager.h"
+#include "health_monitor.h"
+#include "partition_flash.h"
+#include "position_estimator.h"
+#include "rate_scheduler.h"
+#include "sample_scheduler.h"
+#include "sensor_filter.h"
+#include "sensor_manager.h"
+#include "seqlock.h"
+#include "spectral_features.h"
+#include "telemetry.h"
+#include <stdint.h>
+
+// The latest sample and what detection made of it, published once per
+// sample for code on another task or core, which could catch the loop's
+// state halfway through an update
+struct DetectorState {
+  int severity;            // currentCrashSeverity
+  int score;
+  uint8_t sensorSet;       // SENSOR_* the score was out of
+  uint8_t confirmState;    // ConfirmState
+};
+
+// What the last loop() pass did, for a harness watching the firmware
+struct LoopPass {
+  bool sampled;              // an IMU sample was taken and scored
+  int detectedSeverity;      // detectCrash() on it
+  bool newDetection;         // the detector fired with no crash being handled
+  ConfirmEvent confirmEvent;
+};
+
+// The device's setup() and loop(), with everything they keep between
+// passes. src/main.cpp runs one; tools/fleet_sim runs one per virtual unit
+// on the shims in sim/include, so both execute the same code. The parts are
+// public for the simulator to inspect; only loop() should drive them.
+class Firmware {
+public:
+  SensorManager sensors;
+  SensorFilter sensorFilter;
+  CrashDetector crashDetector;
+  CrashConfirmer crashConfirmer;
+  SpectralAnalyzer spectrum;
+  FirebaseManager firebase;
+  ClockDiscipline utcClock;
+  PositionEstimator position;
+  BootTimeline bootTimeline;
+  HealthMonitor health;
+  PartitionFlash eventFlash;
+  EventLog eventLog;
+  BleCompanion ble;
+  Telemetry telemetry;
+  SampleScheduler sampler;
+  RateScheduler sources;
+  Seqlock<SensorData> sensorSnapshot;
+  Seqlock<DetectorState> detectorSnapshot;
+
+  CrashDetectionConfig crashConfig;
+  FilterConfig filterConfig;
+  SensorData currentData;
+  bool eventLogReady;
+
+  // Poll millis() and read every sensor each period, with a 10 ms delay per
+  // pass, as the loop did before data-ready sampling; set before setup()
+  bool pollSampling;
+
+  Firmware();
+
+  // Bring the sensors up and arm detection; the network comes up from
+  // loop(). resetRecord must survive resets (RTC_NOINIT_ATTR on the target).
+  // Returns false if the sensors failed: the target restarts and never
+  // returns.
+  bool setup(ResetRecord* resetRecord, ResetReason resetReason);
+
+  // One pass: wait for the next sample or sensor read, then detection,
+  // confirmation, uploads and the console
+  void loop();
+
+  const LoopPass& getLastPass() const;
+  void printDebugInfo();
+
+private:
+  enum ReplyTo { REPLY_SERIAL, REPLY_BLE };
+  struct ReplyContext {
+    Firmware* firmware;
+    ReplyTo to;
+  };
+
+  uint32_t lastSensorRead;   // poll sampling only
+  uint32_t lastFirebaseSend;
+  uint32_t lastDebugPrint;
+  int currentCrashSeverity;
+  bool sendImmediately;      // a crash state change to report with this pass
+  SensorData triggerData;    // the impact sample the confirmer is deciding on
+  uint32_t lastEventLogMs;
+  int lastEventLogScore;
+  HealthMode lastHealthMode;
+  char commandLine[BLE_COMMAND_SIZE];
+  size_t commandLength;
+  LoopPass lastPass;
+
+  bool waitForSample();
+  void detect(uint32_t currentMillis);
+  void logEvent(EventKind kind, int severity, ConfirmReason reason, uint32_t delayMs);
+  void logScoredReading(int severity);
+  void reply(ReplyTo to, const char* line);
+  static bool replyEventRecord(const EventRecord& record, void* context);
+  static void replyConfigLine(const char* line, void* context);
+  void runCommand(char* line, ReplyTo to);
+  void handleCommands();
+  void recordDetection(bool wasDetected, int detectedSeverity);
+  void recordStats();
+  void drainTelemetry();
+  void trackBoot();
+};
+
+#endif // FIRMWARE_H
@@ -0,0 +1,45 @@
+#ifndef GPS_TIME_H
+#define GPS_TIME_H
+
+#include "clock_discipline.h"
+#include "config.h"
+#include <stdint.h>
+
+// Turns GPS time into ClockDiscipline references, so crash timestamps stay
+// on UTC without a network. The caller reports PPS edges and the UTC
+// seconds decoded from NMEA, each with its monotonic time.
+//
+// A decoded second is paired with the PPS edge before its burst, if that
+// edge is at most GPS_PPS_MAX_AGE_US old, and fed at GPS_PPS_UNCERTAINTY_US.
+// Otherwise the burst start less GPS_NMEA_LATENCY_US is fed at
+// GPS_NMEA_UNCERTAINTY_US. GGA and RMC of one burst name the same second;
+// only the first is used.
+class GpsTimeSync {
+private:
+  ClockDiscipline* discipline;
+  uint64_t lastPpsMono;
+  bool havePps;
+  int64_t lastUtcSecond;
+  uint32_t ppsReferences;
+  uint32_t nmeaReferences;
+
+public:
+  GpsTimeSync();
+
+  void begin(ClockDiscipline* utcClock);
+
+  // Monotonic time of a PPS rising edge
+  void onPpsEdge(uint64_t monoMicros);
+
+  // UTC second named by a sentence of the burst whose first byte arrived at
+  // burstStartMicros (monotonic)
+  void onTime(int64_t utcSeconds, uint8_t centiseconds, uint64_t burstStartMicros);
+
+  uint32_t getPpsReferenceCount() const;
+  uint32_t getNmeaReferenceCount() const;
+
+  // Seconds since 1970-01-01 for a proleptic Gregorian UTC date and time
+  static int64_t toUnixSeconds(int year, int month, int day, int hour, int minute, int second);
+};
+
+#endif // GPS_TIME_H
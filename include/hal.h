@@ -0,0 +1,49 @@
+#ifndef HAL_H
+#define HAL_H
+
+#include <stdint.h>
+
+// Time source for the managers and the main loop, selected at compile time
+// so that on the target every call inlines straight into the Arduino core:
+//   ArduinoClock - millis()/delay() of the Arduino core (default)
+//   SimClock     - per-device virtual clock from sim/ (build with -DHAL_SIM)
+//
+// All timestamps are uint32_t milliseconds, the width of the ESP32 counter,
+// so interval arithmetic wraps after ~49.7 days identically on the target and
+// on the host (where unsigned long is 64 bits). Compare intervals with
+// elapsedMillis(), never with absolute times.
+
+#ifdef HAL_SIM
+#include "sim_clock.h"
+typedef SimClock Clock;
+#else
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <sys/time.h>
+#include <time.h>
+
+struct ArduinoClock {
+  static inline uint32_t millis() { return ::millis(); }
+  static inline uint32_t micros() { return ::micros(); }
+  // Monotonic microseconds since boot, never wraps; safe in ISRs
+  static inline uint64_t micros64() { return (uint64_t)esp_timer_get_time(); }
+  static inline void delay(uint32_t ms) { ::delay(ms); }
+  static inline void delayMicroseconds(uint32_t us) { ::delayMicroseconds(us); }
+  // UTC seconds from the system clock; seconds since boot until SNTP syncs
+  static inline uint32_t unixTime() { return (uint32_t)::time(nullptr); }
+  static inline int64_t utcMicros() {
+    struct timeval now;
+    gettimeofday(&now, nullptr);
+    return (int64_t)now.tv_sec * 1000000 + now.tv_usec;
+  }
+};
+
+typedef ArduinoClock Clock;
+#endif
+
+// Milliseconds from since to now, correct across the counter wrap
+inline uint32_t elapsedMillis(uint32_t since, uint32_t now) {
+  return now - since;
+}
+
+#endif // HAL_H
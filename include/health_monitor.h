@@ -0,0 +1,116 @@
+#ifndef HEALTH_MONITOR_H
+#define HEALTH_MONITOR_H
+
+#include "config.h"
+#include <stdint.h>
+
+// The steps of one pass of the main loop, supervised separately
+enum HealthTask {
+  TASK_IMU = 0,        // MPU6050 burst reads (critical)
+  TASK_DETECTION,      // filter, history and scoring (critical)
+  TASK_ULTRASONIC,     // HC-SR04 ping
+  TASK_GPS,            // UART drain and NMEA parsing
+  TASK_NETWORK,        // connection state machine and RTDB writes
+  HEALTH_TASK_COUNT
+};
+#define TASK_NONE -1
+
+enum TaskHealth {
+  TASK_OK = 0,
+  TASK_SLOW,           // over budget on the last step
+  TASK_SUSPENDED       // skipped until its retry time
+};
+
+enum HealthMode {
+  HEALTH_NORMAL = 0,
+  HEALTH_DEGRADED,     // a non-critical task is suspended; detection runs on
+                       // the IMU and whatever else still works
+  HEALTH_STALLED       // a critical task has missed its heartbeat: the
+                       // watchdog is no longer fed
+};
+
+// Why the chip last started, from esp_reset_reason()
+enum ResetReason {
+  RESET_POWER_ON = 0,
+  RESET_SOFTWARE,      // ESP.restart()
+  RESET_WATCHDOG,      // task or interrupt watchdog
+  RESET_PANIC,         // exception or abort
+  RESET_BROWNOUT,
+  RESET_OTHER
+};
+
+// Survives every reset but a power cycle, in RTC memory the startup code
+// leaves alone (RTC_NOINIT_ATTR). runningTask is written at the start and
+// end of every supervised step, so after a watchdog or panic reset it
+// names the step that never finished.
+#define RESET_RECORD_MAGIC 0x544C4548UL   // "HELT"
+struct ResetRecord {
+  uint32_t magic;
+  uint32_t bootCount;
+  int32_t runningTask;                  // HealthTask, or TASK_NONE between steps
+  uint32_t lastReason;                  // ResetReason of this boot
+  uint32_t watchdogResets;
+  uint32_t taskHangs[HEALTH_TASK_COUNT]; // watchdog/panic resets inside each task
+  uint32_t initFailures;                // boots in a row whose sensors did not start
+  uint32_t checksum;
+};
+
+// Per-task heartbeats and time budgets for the cooperative main loop.
+// Each supervised step is bracketed by startTask()/endTask(). A
+// non-critical task that overruns its budget HEALTH_STRIKES times in a row,
+// or that was running when the watchdog reset the chip, is suspended:
+// shouldRun() is false until its retry time, which doubles on each relapse
+// up to HEALTH_RETRY_MAX_MS. Critical tasks are never skipped; when one
+// misses its heartbeat for HEALTH_HEARTBEAT_TIMEOUT_MS, isAlive() turns
+// false and the caller stops feeding the hardware watchdog, which resets
+// the chip. A step that hangs outright also ends in that reset, and the
+// reset record then isolates the task that hung.
+class HealthMonitor {
+private:
+  ResetRecord* record;
+  uint32_t budgetMs[HEALTH_TASK_COUNT];
+  TaskHealth health[HEALTH_TASK_COUNT];
+  uint32_t strikes[HEALTH_TASK_COUNT];     // consecutive overruns
+  uint32_t lastBeat[HEALTH_TASK_COUNT];    // millis at the last completed step
+  uint32_t lastDuration[HEALTH_TASK_COUNT];
+  uint32_t retryDelay[HEALTH_TASK_COUNT];  // next suspension length
+  uint32_t retryAt[HEALTH_TASK_COUNT];
+  uint32_t suspensions[HEALTH_TASK_COUNT];
+  uint32_t stepStart;
+
+  void suspend(int task, uint32_t nowMs);
+  void seal();
+
+public:
+  HealthMonitor();
+
+  // Validate (or initialise) the RTC record and learn from the last reset
+  void begin(ResetRecord* resetRecord, ResetReason reason, uint32_t nowMs);
+
+  void setBudget(HealthTask task, uint32_t milliseconds);
+  static bool isCritical(HealthTask task);
+
+  // False while the task is suspended; the first call after its retry
+  // time lets it run once on probation
+  bool shouldRun(HealthTask task, uint32_t nowMs);
+  void startTask(HealthTask task, uint32_t nowMs);
+  void endTask(HealthTask task, uint32_t nowMs);
+
+  // Critical tasks have all beaten within HEALTH_HEARTBEAT_TIMEOUT_MS
+  bool isAlive(uint32_t nowMs) const;
+  HealthMode getMode(uint32_t nowMs) const;
+
+  // Sensor start-up failed: how long to wait before restarting to try
+  // again, doubling with each failed boot
+  uint32_t recordInitFailure();
+  void recordInitSuccess();
+
+  TaskHealth getHealth(HealthTask task) const;
+  uint32_t getLastDuration(HealthTask task) const;
+  uint32_t getSuspensions(HealthTask task) const;
+  const ResetRecord& getRecord() const;
+  static const char* taskName(HealthTask task);
+  static const char* reasonName(ResetReason reason);
+};
+
+#endif // HEALTH_MONITOR_H
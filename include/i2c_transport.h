@@ -0,0 +1,131 @@
+#ifndef I2C_TRANSPORT_H
+#define I2C_TRANSPORT_H
+
+#include "config.h"
+#include "imu_voter.h"
+#include <stdint.h>
+
+// MPU6050 register burst: ACCEL_XOUT_H .. GYRO_ZOUT_L, big-endian, with
+// TEMP_OUT in the middle
+#define MPU6050_REG_ACCEL_XOUT_H 0x3B
+#define MPU6050_BURST_BYTES 14
+
+enum I2cResult {
+  I2C_OK = 0,
+  I2C_NACK,        // no device at the address, or a byte was refused
+  I2C_TIMEOUT,     // the transaction did not complete in time
+  I2C_BUS_ERROR    // arbitration lost or controller fault
+};
+
+// What the transport needs from an I2C controller and its two pins.
+// Transfers block for at most the controller timeout.
+class I2cPort {
+public:
+  virtual ~I2cPort() {}
+
+  // Attach the controller to the pins at clockHz; also used to re-init
+  virtual void begin(uint32_t clockHz) = 0;
+  // Detach it, leaving both lines released (pulled up) under GPIO control
+  virtual void end() = 0;
+
+  // Register address write, repeated start, length-byte read
+  virtual I2cResult readRegisters(uint8_t address, uint8_t reg, uint8_t* data, uint8_t length) = 0;
+  virtual I2cResult writeRegister(uint8_t address, uint8_t reg, uint8_t value) = 0;
+
+  // Split-phase reads for controllers that queue transfers. The default
+  // refuses, and the transport falls back to readRegisters().
+  virtual bool startRead(uint8_t, uint8_t, uint8_t*, uint8_t) { return false; }
+  virtual bool isReadDone() { return true; }
+  virtual I2cResult finishRead() { return I2C_BUS_ERROR; }
+
+  // Line levels, and open-drain drive for bus recovery (controller ended)
+  virtual bool readSda() = 0;
+  virtual bool readScl() = 0;
+  virtual void driveSda(bool high) = 0;
+  virtual void driveScl(bool high) = 0;
+};
+
+struct I2cStats {
+  uint32_t transactions;
+  uint32_t failures;
+  uint32_t nacks;
+  uint32_t timeouts;
+  uint32_t busErrors;
+  uint32_t hangs;              // failures with a line held low
+  uint32_t recoveries;         // bus clears that freed the lines
+  uint32_t failedRecoveries;
+  uint32_t reinits;            // controller restarts, with or without a clear
+  uint32_t lastMicros;         // duration of the last transaction
+  uint32_t maxMicros;
+  uint64_t totalMicros;
+};
+
+// Raw counts from an MPU6050 burst
+void decodeMotionBurst(const uint8_t* burst, ImuFrame& frame);
+
+// I2C transactions with timing, hang detection and recovery. A failed
+// transaction whose lines are left low is a hung bus: some device is
+// mid-byte (typically after a brown-out or a jolt on the connector) and
+// holds SDA. The transport then detaches the controller, clocks SCL until
+// SDA is released (at most I2C_RECOVERY_PULSES), sends a STOP and restarts
+// the controller. I2C_REINIT_FAILURES failures in a row restart it even
+// with the lines high, for a controller that has wedged on its own.
+class I2cTransport {
+private:
+  I2cPort* port;
+  uint32_t clockHz;
+  I2cStats stats;
+  uint32_t consecutiveFailures;
+
+  // The one split-phase read in flight
+  bool pending;
+  bool pendingAsync;
+  uint64_t pendingStart;
+  I2cResult pendingResult;
+  uint8_t burst[MPU6050_BURST_BYTES];
+
+  void record(I2cResult result, uint64_t startMicros);
+  void handleFailure();
+  void reinit();
+
+public:
+  I2cTransport();
+
+  // Clears a bus left hung by a reset mid-transaction before starting
+  void begin(I2cPort* i2cPort, uint32_t busClockHz);
+
+  I2cResult readRegisters(uint8_t address, uint8_t reg, uint8_t* data, uint8_t length);
+  I2cResult writeRegister(uint8_t address, uint8_t reg, uint8_t value);
+
+  // One 14-byte burst from an MPU6050, decoded. frame.status is
+  // IMU_FRAME_FAILED when the read did not complete.
+  I2cResult readMotion(uint8_t address, ImuFrame& frame);
+
+  // Same, split: start the burst, do other work, then finish. Controllers
+  // without queued transfers complete the read in startMotion().
+  void startMotion(uint8_t address);
+  I2cResult finishMotion(ImuFrame& frame);
+
+  // Bus clear and controller restart; true when both lines end up high
+  bool recover();
+  bool isBusHung();
+
+  uint32_t getClockHz() const;
+  const I2cStats& getStats() const;
+  void resetStats();
+};
+
+// I2cPort on the Arduino Wire controller and SDA_PIN / SCL_PIN
+class WirePort : public I2cPort {
+public:
+  void begin(uint32_t clockHz) override;
+  void end() override;
+  I2cResult readRegisters(uint8_t address, uint8_t reg, uint8_t* data, uint8_t length) override;
+  I2cResult writeRegister(uint8_t address, uint8_t reg, uint8_t value) override;
+  bool readSda() override;
+  bool readScl() override;
+  void driveSda(bool high) override;
+  void driveScl(bool high) override;
+};
+
+#endif // I2C_TRANSPORT_H
@@ -0,0 +1,96 @@
+#ifndef IMU_VOTER_H
+#define IMU_VOTER_H
+
+#include "config.h"
+#include <stdint.h>
+
+#define IMU_MAX_COUNT 4
+
+static_assert(IMU_COUNT >= 1 && IMU_COUNT <= IMU_MAX_COUNT, "IMU_COUNT must be 1..IMU_MAX_COUNT");
+
+enum ImuHealth {
+  IMU_HEALTHY = 0,
+  IMU_ABSENT,      // never answered at begin()
+  IMU_DETACHED,    // IMU_FAILED_READINGS failed reads in a row
+  IMU_STUCK        // IMU_STUCK_READINGS identical frames in a row
+};
+
+enum ImuFrameStatus {
+  IMU_FRAME_SKIPPED = 0,   // not read this sample (absent, or left out by the schedule)
+  IMU_FRAME_OK,
+  IMU_FRAME_FAILED         // the read was attempted and returned nothing usable
+};
+
+// One 14-byte burst from an MPU6050: raw counts at the configured
+// full-scale ranges, and the die temperature word
+struct ImuFrame {
+  ImuFrameStatus status;
+  int16_t accel[3];
+  int16_t gyro[3];
+  int16_t temperature;   // see imuTemperatureC()
+};
+
+// TEMP_OUT in degrees C (datasheet: counts / 340 + 36.53)
+float imuTemperatureC(int16_t raw);
+
+// Time of one 14-byte register burst (address + register, repeated start,
+// address + 14 data bytes, 9 bits each) at clockHz, plus driver overhead
+uint32_t imuBurstMicros(uint32_t clockHz);
+
+// How many of count IMUs can be read back to back within budgetMicros;
+// at least one, so the primary is always read
+uint32_t imuReadsPerSample(uint32_t count, uint32_t clockHz, uint32_t budgetMicros);
+
+// Redundant IMU voting. Each sample takes one frame per IMU, tracks every
+// sensor's health from the raw counts, and fuses the usable ones per axis:
+// the median of three or more, the mean of two, the value of one. An axis
+// clipped at the full-scale rail is left out while another sensor still
+// has it in range; when all are clipped the largest reading is the best
+// lower bound. The IMUs must share one mounting orientation.
+class ImuVoter {
+private:
+  uint32_t count;
+  uint32_t fittedCount;                 // answered at begin()
+  ImuHealth health[IMU_MAX_COUNT];
+  ImuFrame last[IMU_MAX_COUNT];
+  uint32_t repeats[IMU_MAX_COUNT];      // consecutive identical frames
+  uint32_t failures[IMU_MAX_COUNT];     // consecutive failed reads
+  uint32_t faultCounts[IMU_MAX_COUNT];  // transitions out of IMU_HEALTHY
+  float accelOffsets[IMU_MAX_COUNT][3];
+  float gyroOffsets[IMU_MAX_COUNT][3];
+
+  bool usable[IMU_MAX_COUNT];           // contributed to the last fuse
+  uint32_t usedCount;
+  uint32_t clippedAxes;                 // axes fused from clipped values only
+
+  void setHealth(uint32_t index, ImuHealth state);
+  void track(uint32_t index, const ImuFrame& frame);
+  float vote(const float* values, const bool* clipped, uint32_t valueCount, bool& allClipped) const;
+
+public:
+  ImuVoter();
+
+  // present[i]: IMU i answered at startup
+  void begin(uint32_t imuCount, const bool* present);
+
+  // Update health from this sample's frames (imuCount of them) and fuse
+  // into g and degrees/second. False when no IMU was usable; the outputs
+  // are then zero.
+  bool update(const ImuFrame* frames, float& accelX, float& accelY, float& accelZ,
+              float& gyroX, float& gyroY, float& gyroZ);
+
+  // Calibration offsets in g and degrees/second, subtracted per IMU
+  void setOffsets(uint32_t index, const float* accel, const float* gyro);
+  void getOffsets(uint32_t index, float* accel, float* gyro) const;
+
+  uint32_t getCount() const;
+  uint32_t getFittedCount() const;      // IMUs that answered at begin()
+  ImuHealth getHealth(uint32_t index) const;
+  uint32_t getFaultCount(uint32_t index) const;
+  uint32_t getHealthyCount() const;
+  uint32_t getUsedCount() const;        // IMUs in the last fused sample
+  uint32_t getClippedAxes() const;      // bit per axis (accel X..Z, gyro X..Z)
+  static const char* healthName(ImuHealth state);
+};
+
+#endif // IMU_VOTER_H
@@ -0,0 +1,25 @@
+#ifndef PARTITION_FLASH_H
+#define PARTITION_FLASH_H
+
+#include "event_log.h"
+#include <esp_partition.h>
+
+// FlashRegion over an ESP32 data partition from partitions.csv
+class PartitionFlash : public FlashRegion {
+private:
+  const esp_partition_t* partition;
+
+public:
+  PartitionFlash();
+
+  // Find the data partition with this label
+  bool begin(const char* label);
+
+  uint32_t size() const override;
+  uint32_t sectorSize() const override;
+  bool read(uint32_t offset, void* data, uint32_t length) override;
+  bool write(uint32_t offset, const void* data, uint32_t length) override;
+  bool eraseSector(uint32_t offset) override;
+};
+
+#endif // PARTITION_FLASH_H
@@ -0,0 +1,53 @@
+#ifndef POSITION_ESTIMATOR_H
+#define POSITION_ESTIMATOR_H
+
+#include "config.h"
+#include <stdint.h>
+
+// Dead reckoning between GPS fixes: an extended Kalman filter over
+// [east, north, speed, heading] in metres around a local origin at the
+// first fix. Every IMU sample predicts with forward acceleration (accelX)
+// and yaw rate (gyroZ); each new fix corrects, shifted forward by the
+// distance covered since the second it refers to. Fixed-size state, no
+// allocation, a few hundred float operations per sample.
+class PositionEstimator {
+private:
+  bool hasOrigin;
+  bool headingKnown;
+  double originLatitude;
+  double originLongitude;
+  double metresPerDegreeLongitude;
+
+  float state[4];       // east (m), north (m), speed (m/s), heading (rad, CCW from east)
+  float covariance[4][4];
+
+  uint64_t lastMicros;
+  uint64_t lastFixMicros;
+  float lastFixEast;
+  float lastFixNorth;
+  uint32_t fixCount;
+
+  void predict(float dt, float accel, float yawRate);
+  void correct(float east, float north);
+  void startAt(double latitude, double longitude);
+  void recentre();
+  void toLocal(double latitude, double longitude, float& east, float& north) const;
+
+public:
+  PositionEstimator();
+
+  void reset();
+
+  // Advance to the sample, apply its GPS fix if it has a new one, and
+  // replace its latitude/longitude/positionErrorM with the estimate
+  void update(SensorData& data);
+
+  bool hasPosition() const;
+  void getPosition(double& latitude, double& longitude) const;
+  float getErrorMetres() const;   // 1-sigma horizontal
+  float getSpeed() const;         // m/s
+  float getHeadingDegrees() const; // clockwise from north
+  uint32_t getFixCount() const;
+};
+
+#endif // POSITION_ESTIMATOR_H
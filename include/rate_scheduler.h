@@ -0,0 +1,90 @@
+#ifndef RATE_SCHEDULER_H
+#define RATE_SCHEDULER_H
+
+#include <stdint.h>
+
+#define RATE_TASK_MAX 8
+
+enum RateRelease {
+  RATE_PERIODIC = 0,     // released every period on the CPU clock
+  RATE_SPORADIC          // released by release(), e.g. from an interrupt;
+                         // the period is the least time between releases
+};
+
+struct RateTaskStats {
+  uint32_t runs;
+  uint32_t overruns;          // ran longer than the budget
+  uint32_t deadlineMisses;    // finished later than release + deadline
+  uint32_t skipped;           // releases that came and went before a run
+  uint32_t lastRunMicros;
+  uint32_t maxRunMicros;
+  uint32_t maxResponseMicros; // release to finish
+};
+
+// Cooperative rate-monotonic scheduling for the work one task (loop())
+// does at different rates: the most frequent task that is due runs first,
+// ties going to the one added first. Nothing is preempted, so a task is
+// late when a longer one ahead of it, or the caller, holds the CPU; each
+// late finish and each run over budget is counted. A release that passes
+// while its task waits or runs is dropped, not queued, since a sensor
+// read twice in a row gives nothing new.
+//
+// Pure logic: times are passed in, so the schedule can be tested on a
+// virtual clock.
+class RateScheduler {
+private:
+  struct Task {
+    const char* name;
+    RateRelease kind;
+    uint32_t periodMicros;
+    uint32_t deadlineMicros;
+    uint32_t budgetMicros;
+    uint32_t phaseMicros;
+    uint64_t releaseMicros;   // of the pending run, or the next periodic one
+    bool pending;             // sporadic: released, not yet run
+    RateTaskStats stats;
+  };
+  Task tasks[RATE_TASK_MAX];
+  uint8_t order[RATE_TASK_MAX];   // by priority
+  uint32_t count;
+  bool started;
+
+  bool isDue(const Task& task, uint64_t nowMicros) const;
+
+public:
+  RateScheduler();
+  void begin();
+
+  // Returns the task's id (the order of the calls, from 0), or -1 when
+  // RATE_TASK_MAX are already added or the schedule has started
+  int add(const char* name, RateRelease kind, uint32_t periodMicros, uint32_t deadlineMicros,
+          uint32_t budgetMicros, uint32_t phaseMicros = 0);
+  // Periodic tasks are first released phaseMicros after this
+  void start(uint64_t nowMicros);
+  bool isStarted() const;
+
+  // A sporadic task's release; if the previous one has not run yet it is
+  // replaced and counted skipped
+  void release(int task, uint64_t releaseMicros);
+
+  // The highest-priority task released by now and not yet run, or -1
+  int next(uint64_t nowMicros);
+  void complete(int task, uint64_t startMicros, uint64_t endMicros);
+
+  // Until the next periodic release (0 if a task is due); UINT32_MAX
+  // with nothing periodic
+  uint32_t getWaitMicros(uint64_t nowMicros) const;
+
+  // Sum of budget / period, and whether it is within the Liu & Layland
+  // bound n(2^(1/n) - 1) under which rate-monotonic priorities meet every
+  // deadline (with preemption; here a lower-priority run can still block)
+  float getUtilization() const;
+  bool fitsRateMonotonicBound() const;
+
+  uint32_t getTaskCount() const;
+  const char* getName(int task) const;
+  uint32_t getPeriodMicros(int task) const;
+  const RateTaskStats& getStats(int task) const;
+};
+
+#endif // RATE_SCHEDULER_H
@@ -0,0 +1,48 @@
+#ifndef SAMPLE_SCHEDULER_H
+#define SAMPLE_SCHEDULER_H
+
+#include <stdint.h>
+
+// Decides, each time loop() wakes, whether a sensor sample is due.
+//
+// Interrupt-driven, the MPU6050's data-ready edge wakes the loop task once
+// per output period and every wake with an edge is a sample. Should no edge
+// arrive within half a period past its time (INT not wired, IMU reset to
+// its default rate), the scheduler falls back to sampling on a timer at the
+// same period until edges come back. Without the interrupt it is that
+// timer alone: sleep until the next period, rather than polling.
+class SampleScheduler {
+private:
+  uint32_t periodMicros;
+  bool interruptDriven;
+  bool interruptAlive;        // an edge came within the last period and a half
+  uint64_t lastSampleMicros;  // when the last sample was taken (or was due, polling)
+  uint32_t samples;
+  uint32_t missed;            // edges that passed while the loop was busy
+  uint32_t fallbacks;         // samples taken on the timer while expecting an edge
+  uint32_t wakeups;
+
+public:
+  SampleScheduler();
+  void begin(uint32_t periodMicros, bool interruptDriven, uint64_t nowMicros);
+
+  // How long the loop task may sleep before it has to look again; in
+  // interrupt mode the edge normally ends the sleep well before this
+  uint32_t getWaitMicros(uint64_t nowMicros) const;
+  // Same in whole milliseconds (FreeRTOS ticks), rounded up
+  uint32_t getWaitMillis(uint64_t nowMicros) const;
+
+  // The loop task woke with this many data-ready edges pending; true when
+  // it should sample now
+  bool onWake(uint32_t edges, uint64_t nowMicros);
+
+  bool isInterruptDriven() const;
+  bool isInterruptAlive() const;
+  uint32_t getPeriodMicros() const;
+  uint32_t getSamples() const;
+  uint32_t getMissed() const;
+  uint32_t getFallbacks() const;
+  uint32_t getWakeups() const;
+};
+
+#endif // SAMPLE_SCHEDULER_H
@@ -0,0 +1,40 @@
+#ifndef SENSOR_FILTER_H
+#define SENSOR_FILTER_H
+
+#include "config.h"
+#include "dsp_filter.h"
+#include <Arduino.h>
+
+// Pre-filter stage between SensorManager and CrashDetector: the same
+// high-pass / notch / low-pass cascade on each accel and gyro axis,
+// designed from a FilterConfig in begin(). The fixed-point path runs the
+// cascades on raw sensor counts (12 fractional bits). Other fields pass
+// through untouched.
+class SensorFilter {
+private:
+  FilterConfig config;
+  BiquadCascade cascades[6];         // accel X Y Z, gyro X Y Z
+  BiquadCascadeFixed fixedCascades[6];
+  bool primed;
+
+  void design(int axis, float lowPassHz);
+  float step(int axis, float value, float lsbPerUnit);
+
+public:
+  SensorFilter();
+
+  void begin(const FilterConfig& filterConfig);
+
+  // Filter a reading in place
+  void process(SensorData& data);
+
+  // Restart from the next reading (after a gap or recalibration)
+  void reset();
+
+  // True when any section is configured
+  bool isActive() const;
+
+  FilterConfig getConfig() const;
+};
+
+#endif // SENSOR_FILTER_H
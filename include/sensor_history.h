@@ -0,0 +1,136 @@
+#ifndef SENSOR_HISTORY_H
+#define SENSOR_HISTORY_H
+
+#include "config.h"
+#include <stdint.h>
+#include <string.h>
+
+// Fields of a SensorData that detection never reads back from history;
+// kept apart so scans over the hot columns do not pull them into cache
+struct SensorColdFields {
+  float distance;
+  int vibration;
+  float latitude, longitude;
+  float positionErrorM;
+  uint64_t gpsFixMicros;
+  uint8_t missing;
+  uint8_t quality;
+};
+
+// Ring of the last Depth readings, stored column-wise. Depth is a power of
+// two so slots are found with a mask; the storage lives inside the object,
+// so a global instance sits in static memory with no heap allocation.
+//
+// Slots are addressed relative to the write position: slot(1) is the newest
+// reading, slot(Depth) the oldest one still held. Slots not yet written
+// read as zero.
+template <uint32_t Depth>
+class SensorHistory {
+  static_assert(Depth > 0 && (Depth & (Depth - 1)) == 0,
+                "SensorHistory depth must be a power of two");
+
+private:
+  // Hot columns: everything detection reads back
+  float accelXs[Depth];
+  float accelYs[Depth];
+  float accelZs[Depth];
+  float gyroXs[Depth];
+  float gyroYs[Depth];
+  float gyroZs[Depth];
+  uint32_t timestamps[Depth];
+  uint64_t sampleMicrosValues[Depth];
+
+  SensorColdFields cold[Depth];
+  uint32_t writeCount;   // wraps; Depth divides 2^32, so masking stays valid
+
+public:
+  static const uint32_t DEPTH = Depth;
+  static const uint32_t MASK = Depth - 1;
+
+  SensorHistory() {
+    clear();
+  }
+
+  void clear() {
+    memset(accelXs, 0, sizeof(accelXs));
+    memset(accelYs, 0, sizeof(accelYs));
+    memset(accelZs, 0, sizeof(accelZs));
+    memset(gyroXs, 0, sizeof(gyroXs));
+    memset(gyroYs, 0, sizeof(gyroYs));
+    memset(gyroZs, 0, sizeof(gyroZs));
+    memset(timestamps, 0, sizeof(timestamps));
+    memset(sampleMicrosValues, 0, sizeof(sampleMicrosValues));
+    memset(cold, 0, sizeof(cold));
+    writeCount = 0;
+  }
+
+  void push(const SensorData& data) {
+    uint32_t index = writeCount & MASK;
+    accelXs[index] = data.accelX;
+    accelYs[index] = data.accelY;
+    accelZs[index] = data.accelZ;
+    gyroXs[index] = data.gyroX;
+    gyroYs[index] = data.gyroY;
+    gyroZs[index] = data.gyroZ;
+    timestamps[index] = data.timestamp;
+    sampleMicrosValues[index] = data.sampleMicros;
+
+    SensorColdFields& fields = cold[index];
+    fields.distance = data.distance;
+    fields.vibration = data.vibration;
+    fields.latitude = data.latitude;
+    fields.longitude = data.longitude;
+    fields.positionErrorM = data.positionErrorM;
+    fields.gpsFixMicros = data.gpsFixMicros;
+    fields.missing = data.missing;
+    fields.quality = data.quality;
+    writeCount++;
+  }
+
+  // Index the next push() writes
+  uint32_t head() const { return writeCount & MASK; }
+
+  // Readings held, up to Depth
+  uint32_t size() const { return writeCount < Depth ? writeCount : Depth; }
+
+  // Index of the reading back places before the head (1 = newest)
+  uint32_t slot(uint32_t back) const { return (writeCount - back) & MASK; }
+
+  // Column access by index, for scans
+  const float* accelX() const { return accelXs; }
+  const float* accelY() const { return accelYs; }
+  const float* accelZ() const { return accelZs; }
+  const float* gyroX() const { return gyroXs; }
+  const float* gyroY() const { return gyroYs; }
+  const float* gyroZ() const { return gyroZs; }
+  const uint32_t* timestamp() const { return timestamps; }
+  const uint64_t* sampleMicros() const { return sampleMicrosValues; }
+  const SensorColdFields& coldFields(uint32_t index) const { return cold[index]; }
+
+  // Whole reading at an index, reassembled (debugging, event dumps)
+  SensorData get(uint32_t index) const {
+    SensorData data;
+    data.accelX = accelXs[index];
+    data.accelY = accelYs[index];
+    data.accelZ = accelZs[index];
+    data.gyroX = gyroXs[index];
+    data.gyroY = gyroYs[index];
+    data.gyroZ = gyroZs[index];
+    data.distance = cold[index].distance;
+    data.vibration = cold[index].vibration;
+    data.latitude = cold[index].latitude;
+    data.longitude = cold[index].longitude;
+    data.positionErrorM = cold[index].positionErrorM;
+    data.timestamp = timestamps[index];
+    data.sampleMicros = sampleMicrosValues[index];
+    data.gpsFixMicros = cold[index].gpsFixMicros;
+    data.missing = cold[index].missing;
+    data.quality = cold[index].quality;
+    return data;
+  }
+};
+
+// The history CrashDetector keeps
+typedef SensorHistory<SENSOR_HISTORY_SIZE> DetectorHistory;
+
+#endif // SENSOR_HISTORY_H
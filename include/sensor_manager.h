@@ -1,7 +1,15 @@
 #ifndef SENSOR_MANAGER_H
 #define SENSOR_MANAGER_H
 
+#include "bias_estimator.h"
+#include "clock_discipline.h"
 #include "config.h"
+#include "gps_time.h"
+#include "hal.h"
+#include "health_monitor.h"
+#include "i2c_transport.h"
+#include "imu_voter.h"
+#include "rate_scheduler.h"
 #include <Arduino.h>
 #include <Wire.h>
 #include <I2Cdev.h>
@@ -9,34 +17,106 @@
 #include <TinyGPSPlus.h>
 #include <SoftwareSerial.h>
 
+// Sources read at their own rates (see scheduleSources()); the order is
+// their RateScheduler ids
+enum SensorSource {
+  SOURCE_IMU = 0,        // with the vibration switch, on the data-ready edge
+  SOURCE_ULTRASONIC,
+  SOURCE_GPS,
+  SENSOR_SOURCE_COUNT
+};
+
 class SensorManager {
 private:
-  MPU6050 mpu;
+  WirePort i2cPort;
+  I2cTransport i2c;
+  uint32_t busResets;          // recoveries + reinits already acted on
+  MPU6050* imus[IMU_COUNT];
+  ImuVoter imuVoter;
+  BiasEstimator biasEstimators[IMU_COUNT];
+  bool biasChanged;            // learned since the last NVS save
+  uint32_t lastBiasSave;
+  uint32_t imuReadsPerRound;   // IMUs read per sample within IMU_SAMPLE_BUDGET_US
+  uint32_t imuNextRead;        // round-robin start when they do not all fit
   TinyGPSPlus gps;
   SoftwareSerial* gpsSerial;
+  GpsTimeSync gpsTime;
+  HealthMonitor* health;       // supervises the reads in readAllSensors()
   
   bool mpuInitialized;
   bool gpsInitialized;
-  unsigned long lastSensorRead;
+  uint32_t lastSensorRead;
+  uint64_t gpsBurstMicros;     // first byte of the current NMEA burst
+  uint64_t gpsLastByteMicros;
+  uint64_t gpsFixMicros;       // set by readGPS() when a new fix is decoded
+  uint32_t lastPpsCount;
+  
+  // Latest reading of each source, for takeSample() to put together
+  SensorData imuSlot;          // motion, vibration, sample time, IMU flags
+  float rangeSlot;             // cm, -1 without an echo
+  uint64_t rangeSlotMicros;    // when it was read; 0 if the source is skipped
+  float fixSlotLatitude;
+  float fixSlotLongitude;
+  bool fixSlotFresh;           // located since the last takeSample()
+  uint64_t fixSlotMicros;      // a new fix since then; 0 if none
+  
+  // Low 32 bits of Clock::micros64() at the last MPU data-ready edge, and
+  // the task the edge wakes. Kept per instance (the ISR gets this), so
+  // simulated units sharing a process keep their edges apart.
+  volatile uint32_t dataReadyMicros;
+  volatile uint32_t dataReadyCount;
+  TaskHandle_t dataReadyTask;
+  bool dataReadyAttached;
+  static void IRAM_ATTR onDataReady(void* manager);
   
-  // Calibration values
-  float accelOffsetX, accelOffsetY, accelOffsetZ;
-  float gyroOffsetX, gyroOffsetY, gyroOffsetZ;
+  // Low 32 bits of Clock::micros64() at the GPS PPS edge
+  static volatile uint32_t ppsMicros;
+  static volatile uint32_t ppsCount;
+  static void IRAM_ATTR onPpsEdge();
   
   // Helper functions
   float readUltrasonicDistance();
+  uint64_t imuSampleMicros(uint64_t readMicros);
+  bool configureImu(uint32_t index);
+  void readImuFrame(uint32_t index, ImuFrame& frame);
+  void updateGpsTime();
+  void trackBias(const ImuFrame* frames, uint64_t nowMicros);
+  void loadCalibration();
   void calibrateMPU6050();
 
 public:
   SensorManager();
   ~SensorManager();
   
-  // Initialize all sensors
-  bool begin();
+  // Initialize all sensors; GPS time disciplines utcClock when given
+  bool begin(ClockDiscipline* utcClock = nullptr);
+  
+  // Give the task a notification at every data-ready edge (one per
+  // SENSOR_READ_INTERVAL), for it to sleep on with ulTaskNotifyTake()
+  void notifyOnDataReady(TaskHandle_t task);
+  // The data-ready interrupt is attached: samples can wait on the edge
+  bool hasDataReadyInterrupt() const;
+  uint32_t getDataReadyCount() const;
+  
+  // Time each read against its budget; a suspended sensor is skipped
+  // (ultrasonic reads -1, GPS has no fix) until its retry time
+  void setHealthMonitor(HealthMonitor* monitor);
   
   // Read all sensors and return data
   SensorData readAllSensors();
   
+  // Multi-rate reading: readSource() reads one source into its slot, and
+  // takeSample() returns the IMU reading with the distance (if no older
+  // than ULTRASONIC_MAX_AGE_MS) and any GPS fix since the last call.
+  // readAllSensors() is all three, then takeSample().
+  void readSource(SensorSource source);
+  SensorData takeSample();
+  // Add the sources to scheduler with their periods and budgets, then read
+  // the ones it has due, most frequent first; true when the IMU was read.
+  // The IMU is sporadic: release it at each data-ready edge.
+  static void scheduleSources(RateScheduler& scheduler);
+  bool readDueSources(RateScheduler& scheduler);
+  
   // Individual sensor reading functions
   bool readMPU6050(float& accelX, float& accelY, float& accelZ, 
                    float& gyroX, float& gyroY, float& gyroZ);
@@ -47,9 +127,17 @@ public:
   // Sensor status functions
   bool isMPUReady() const;
   bool isGPSReady() const;
+  const ImuVoter& getImuVoter() const;
+  const I2cStats& getI2cStats() const;
   
-  // Calibration functions
+  // Calibration. Offsets are learned in the background whenever the
+  // vehicle stands still and kept in NVS, so none of these is needed at
+  // boot; performCalibration() measures them now, on a still device.
+  bool isCalibrated() const;
+  const BiasEstimator& getBiasEstimator(uint32_t index) const;
+  void saveCalibration();
   void performCalibration();
+  // Offsets apply to every IMU, at the current temperature
   void setCalibrationOffsets(float axOff, float ayOff, float azOff,
                            float gxOff, float gyOff, float gzOff);
   
@@ -61,7 +149,7 @@ public:
   
   // Get sensor information
   void printSensorInfo();
-  String getSensorStatus();
+  size_t getSensorStatus(char* buffer, size_t bufferSize);
 };
 
 #endif // SENSOR_MANAGER_H
\ No newline at end of file
@@ -0,0 +1,88 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+// Latest value of a T, written by one task and read by any number of others
+// (another task, the other core) without locks: a reader never sees half of
+// one write and half of another, nor an older value after a newer one.
+//
+// Two buffers, written in turn, each with a sequence number that is odd
+// while it is written and twice the version it holds once done. A write
+// goes to the buffer readers are not directed to, then publishes it; a read
+// copies the published buffer and keeps the copy if it still holds that
+// version. So a write never makes a reader wait. A read only retries when
+// two writes land while it copies, which at one write per sample needs the
+// reader to be preempted for a whole sample period.
+//
+// The value is kept as relaxed atomic words, so the copies race by design
+// without the undefined behaviour of a plain memcpy; T must be trivially
+// copyable. Only one task may call publish().
+template <typename T>
+class Seqlock {
+  static_assert(std::is_trivially_copyable<T>::value, "Seqlock copies T as raw words");
+
+private:
+  static const size_t WORDS = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+  struct Buffer {
+    std::atomic<uint32_t> sequence;
+    std::atomic<uint32_t> words[WORDS];
+  };
+  Buffer buffers[2];
+  std::atomic<uint32_t> version;   // writes published; buffers[version & 1] holds the last
+
+public:
+  // Reads a zeroed T until the first publish()
+  Seqlock() {
+    for (int b = 0; b < 2; b++) {
+      buffers[b].sequence.store(0, std::memory_order_relaxed);
+      for (size_t i = 0; i < WORDS; i++) buffers[b].words[i].store(0, std::memory_order_relaxed);
+    }
+    version.store(0, std::memory_order_release);
+  }
+
+  void publish(const T& value) {
+    uint32_t words[WORDS];
+    words[WORDS - 1] = 0;
+    memcpy(words, &value, sizeof(T));
+
+    uint32_t next = version.load(std::memory_order_relaxed) + 1;
+    Buffer& buffer = buffers[next & 1];
+    buffer.sequence.store(2 * next - 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < WORDS; i++) {
+      buffer.words[i].store(words[i], std::memory_order_relaxed);
+    }
+    buffer.sequence.store(2 * next, std::memory_order_release);
+    version.store(next, std::memory_order_release);
+  }
+
+  T read() const {
+    uint32_t words[WORDS];
+    for (;;) {
+      uint32_t current = version.load(std::memory_order_acquire);
+      const Buffer& buffer = buffers[current & 1];
+      uint32_t sequence = buffer.sequence.load(std::memory_order_acquire);
+      if (sequence != 2 * current) continue;   // the writer came round to it again
+      for (size_t i = 0; i < WORDS; i++) {
+        words[i] = buffer.words[i].load(std::memory_order_relaxed);
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (buffer.sequence.load(std::memory_order_relaxed) == sequence) break;
+    }
+    T value;
+    memcpy(&value, words, sizeof(T));
+    return value;
+  }
+
+  // Writes published so far; a reader can tell a new value from this
+  uint32_t getVersion() const {
+    return version.load(std::memory_order_acquire);
+  }
+};
+
+#endif // SEQLOCK_H
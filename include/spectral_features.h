@@ -0,0 +1,78 @@
+#ifndef SPECTRAL_FEATURES_H
+#define SPECTRAL_FEATURES_H
+
+#include "config.h"
+#include "sensor_history.h"
+#include <stdint.h>
+
+static_assert((SPECTRUM_WINDOW & (SPECTRUM_WINDOW - 1)) == 0 && SPECTRUM_WINDOW >= 8,
+              "SPECTRUM_WINDOW must be a power of two, at least 8");
+static_assert(SPECTRUM_WINDOW <= SENSOR_HISTORY_SIZE,
+              "SPECTRUM_WINDOW cannot exceed SENSOR_HISTORY_SIZE");
+
+// The ESP-DSP component ships with the Arduino-ESP32 core; its FFT uses the
+// ESP32's optimised assembly. Host builds use the portable kernels below.
+#if defined(ESP_PLATFORM) && defined(__has_include)
+#if __has_include(<esp_dsp.h>)
+#define SPECTRUM_USE_ESP_DSP 1
+#endif
+#endif
+
+// Summary of the accel spectrum over the last SPECTRUM_WINDOW readings. An
+// impact is a broadband burst (flat spectrum); engine and road vibration is
+// periodic and concentrates in a few bins.
+struct SpectralFeatures {
+  bool valid;                        // false until the history holds a full window
+  float energy;                      // AC accel power summed over axes, g^2
+  float bandEnergy[SPECTRUM_BANDS];  // energy split into equal-width bands
+  float flatness;                    // geometric / arithmetic mean power: 0 tonal .. 1 white
+  float peakHz;                      // strongest non-DC bin
+};
+
+// Portable radix-2 kernels. Twiddles hold size/2 complex factors
+// e^{-2 pi i k / size} as (re, im) pairs.
+void fftTwiddles(float* twiddles, uint32_t size);
+
+// In-place complex FFT of size points (interleaved re, im). twiddleStride
+// lets a half-size transform reuse a table built for twice its size.
+void fftComplex(float* data, uint32_t size, const float* twiddles, uint32_t twiddleStride = 1);
+
+// |X_k|^2 for k = 0..size/2 of size real samples, through one size/2
+// complex FFT. data (size floats) is overwritten; twiddles are for size.
+void realFftPower(float* data, uint32_t size, const float* twiddles, float* power);
+
+// Windowed real FFT of each accel axis over the newest readings in the
+// detector history. All buffers are members, so a global instance lives in
+// static memory; analyze() allocates nothing. A Hann window limits leakage
+// between bins, at the cost of weighting the oldest and newest readings
+// down: an impact reaches full weight a few readings after it happens.
+class SpectralAnalyzer {
+private:
+  float sampleRateHz;
+  float window[SPECTRUM_WINDOW];
+  float windowPower;                          // sum of window^2
+  float twiddles[SPECTRUM_WINDOW];            // SPECTRUM_WINDOW / 2 complex
+  float work[2 * SPECTRUM_WINDOW];
+  float axisPower[SPECTRUM_WINDOW / 2 + 1];
+  float power[SPECTRUM_WINDOW / 2 + 1];       // one-sided, g^2 per bin
+  SpectralFeatures features;
+
+  void transformAxis(const float* column, const DetectorHistory& history);
+
+public:
+  SpectralAnalyzer();
+
+  void begin(float readingRateHz);
+
+  // Recompute the features from the newest readings; false (and invalid
+  // features) until the history holds SPECTRUM_WINDOW of them
+  bool analyze(const DetectorHistory& history);
+
+  const SpectralFeatures& getFeatures() const;
+
+  // One-sided power per bin (bin k is k * rate / SPECTRUM_WINDOW Hz)
+  const float* getPowerSpectrum() const;
+  float getBinHz() const;
+};
+
+#endif // SPECTRAL_FEATURES_H
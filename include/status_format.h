@@ -0,0 +1,22 @@
+#ifndef STATUS_FORMAT_H
+#define STATUS_FORMAT_H
+
+#include "config.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Formatting helpers that write into caller-provided buffers instead of
+// returning Arduino Strings. Each returns the number of characters written
+// (excluding the terminator), truncating to fit bufferSize.
+
+size_t formatConnectionInfo(char* buffer, size_t bufferSize,
+                            bool wifiConnected, bool firebaseConnected, bool ready);
+
+size_t formatSensorStatus(char* buffer, size_t bufferSize,
+                          bool mpuOk, bool gpsOk, bool gpsValid);
+
+// UTC microseconds since 1970 as ISO 8601, e.g. 2023-11-14T22:13:20.123456Z
+#define UTC_TIMESTAMP_SIZE 28
+size_t formatUtcTimestamp(char* buffer, size_t bufferSize, int64_t utcMicros);
+
+#endif // STATUS_FORMAT_H
@@ -0,0 +1,191 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include "config.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Records at level above TELEMETRY_LEVEL compile to nothing: the condition
+// is a constant, so the call and its arguments are dropped.
+//
+//   TELEMETRY(TELEMETRY_DEBUG, telemetry.sample(data, now));
+#define TELEMETRY(level, call) \
+  do { \
+    if ((level) <= TELEMETRY_LEVEL) { call; } \
+  } while (0)
+
+enum TelemetryType {
+  TELEMETRY_TEXT = 0,      // decoder only: console text between frames
+  TELEMETRY_SAMPLE,
+  TELEMETRY_SCORE,
+  TELEMETRY_STATE,
+  TELEMETRY_STATS,
+  TELEMETRY_TYPE_COUNT
+};
+
+// State machines whose transitions are recorded
+enum TelemetryMachine {
+  MACHINE_DETECTOR = 0,    // CrashDetector: to = severity detected, detail = score
+  MACHINE_CONFIRMER,       // ConfirmState; reason = ConfirmReason, detail = ms since trigger
+  MACHINE_HEALTH           // HealthMode
+};
+
+// Wire format, little-endian:
+//
+//   0x00, COBS(header, payload, CRC-16/CCITT of both), 0x00
+//
+// COBS leaves no zero inside a frame, so a receiver syncs on the next zero.
+// The leading one keeps console text printed between frames out of them.
+struct TelemetryHeader {
+  uint8_t type;            // TelemetryType
+  uint8_t reserved;
+  uint16_t sequence;       // per record; gaps are records dropped
+  uint32_t micros;         // Clock::micros64() at the event, low 32 bits
+};
+
+// TELEMETRY_SAMPLE: a reading as the detector sees it
+struct TelemetrySample {
+  float accel[3];          // g
+  float gyro[3];           // degrees/second
+  float distance;          // cm, -1 without an echo
+  float latitude;
+  float longitude;
+  uint8_t vibration;
+  uint8_t missing;         // SENSOR_*
+  uint8_t quality;         // QUALITY_*
+  uint8_t reserved;
+};
+
+// TELEMETRY_SCORE
+struct TelemetryScore {
+  uint8_t score;
+  uint8_t maxScore;        // reachable with the sensors present
+  uint8_t severity;        // CrashSeverity
+  uint8_t sensors;         // SENSOR_* scored
+};
+
+// TELEMETRY_STATE
+struct TelemetryState {
+  uint8_t machine;         // TelemetryMachine
+  uint8_t from;
+  uint8_t to;
+  uint8_t reason;
+  uint32_t detail;
+};
+
+#define LINK_WIFI 0x01
+#define LINK_FIREBASE 0x02
+#define LINK_BLE 0x04
+#define LINK_UTC 0x08
+
+// TELEMETRY_STATS: what the status dump printed, every DEBUG_PRINT_INTERVAL
+struct TelemetryStats {
+  uint32_t uptimeMs;
+  uint32_t freeHeap;
+  uint32_t eventRecords;
+  uint32_t dropped;        // telemetry records lost to a full ring
+  uint8_t health;          // HealthMode
+  uint8_t links;           // LINK_*
+  uint8_t severity;        // current CrashSeverity
+  uint8_t confirmState;    // ConfirmState
+};
+
+#define TELEMETRY_MAX_PAYLOAD sizeof(TelemetrySample)
+// Zero, COBS overhead byte, header, payload, CRC, zero
+#define TELEMETRY_MAX_FRAME (3 + sizeof(TelemetryHeader) + TELEMETRY_MAX_PAYLOAD + 2)
+
+uint16_t telemetryCrc(const uint8_t* data, size_t length);
+
+// COBS; out needs length + length / 254 + 1 bytes. Returns the encoded length
+size_t cobsEncode(const uint8_t* in, size_t length, uint8_t* out);
+// Returns the decoded length, or 0 if in is not valid COBS or out too small
+size_t cobsDecode(const uint8_t* in, size_t length, uint8_t* out, size_t size);
+
+// Producer side: encodes records into a TX ring that the loop drains into
+// the UART as room allows, so logging never waits on the wire. Frames are
+// kept whole in the ring (wrapping early rather than splitting one), and a
+// frame that does not fit is dropped and counted.
+class Telemetry {
+private:
+  uint8_t ring[TELEMETRY_RING_SIZE];
+  size_t head;             // next byte written
+  size_t tail;             // next byte sent
+  size_t wrapAt;           // end of the data before head went back to 0
+  bool wrapped;
+  uint16_t sequence;
+  uint32_t records;
+  uint32_t dropped;
+
+public:
+  Telemetry();
+
+  void sample(const SensorData& data, uint64_t nowMicros);
+  void score(int score, int maxScore, int severity, uint8_t sensors, uint64_t nowMicros);
+  void state(TelemetryMachine machine, int from, int to, int reason, uint32_t detail, uint64_t nowMicros);
+  void stats(const TelemetryStats& stats, uint64_t nowMicros);
+
+  // Frames and queues one record; false when the ring is full
+  bool record(TelemetryType type, const void* payload, size_t length, uint64_t nowMicros);
+
+  // Whole frames ready to send: at most maxLength bytes, contiguous, ending
+  // on a frame boundary. Returns 0 if not even one frame fits maxLength.
+  size_t peek(const uint8_t** data, size_t maxLength) const;
+  void consume(size_t length);
+
+  size_t getPending() const;
+  uint32_t getRecords() const;
+  uint32_t getDropped() const;
+};
+
+// One record off the wire. For TELEMETRY_TEXT, text holds a line of
+// console output (not terminated) and textLength its length.
+struct TelemetryRecord {
+  uint8_t type;
+  uint16_t sequence;
+  uint64_t micros;         // unwrapped across the 32-bit rollover
+  union {
+    TelemetrySample sample;
+    TelemetryScore score;
+    TelemetryState state;
+    TelemetryStats stats;
+  };
+  const char* text;
+  size_t textLength;
+};
+
+typedef void (*TelemetryRecordHandler)(const TelemetryRecord& record, void* context);
+
+// Receiving end: splits a captured byte stream on zeros, checks each frame
+// and hands out the records. Printable runs between frames are console text.
+class TelemetryDecoder {
+private:
+  uint8_t buffer[256];
+  size_t buffered;
+  bool overflow;
+  bool started;
+  uint16_t lastSequence;
+  uint32_t lastMicros;
+  uint64_t unwrappedMicros;
+
+  void finishChunk(TelemetryRecordHandler handler, void* context);
+
+public:
+  uint64_t records;
+  uint64_t lostRecords;    // sequence gaps
+  uint64_t badFrames;      // failed COBS, CRC or length checks
+  uint64_t textLines;
+  uint64_t bytes;
+
+  TelemetryDecoder();
+  void reset();
+  void feed(const uint8_t* data, size_t length, TelemetryRecordHandler handler, void* context);
+  // Hands out a trailing chunk with no zero after it
+  void finish(TelemetryRecordHandler handler, void* context);
+};
+
+const char* telemetryTypeName(uint8_t type);
+// CSV per record type; the first columns are always sequence,micros_us
+const char* telemetryCsvHeader(uint8_t type);
+size_t formatTelemetryRecord(char* out, size_t size, const TelemetryRecord& record);
+
+#endif // TELEMETRY_H
@@ -0,0 +1,129 @@
+#ifndef SIM_ARDUINO_H
+#define SIM_ARDUINO_H
+
+// Host stand-in for the Arduino-ESP32 core. Time, GPIO and the serial port
+// act on the SimDevice bound to the calling thread (see sim/sim_device.h).
+
+#include <math.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define RISING 0x01
+#define FALLING 0x02
+
+#define IRAM_ATTR
+#define digitalPinToInterrupt(pin) (pin)
+
+using std::min;
+using std::max;
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+void configTime(long gmtOffsetSeconds, int daylightOffsetSeconds, const char* server1,
+                const char* server2 = nullptr, const char* server3 = nullptr);
+
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t level);
+unsigned long pulseIn(uint8_t pin, uint8_t state, unsigned long timeoutMicros = 1000000UL);
+// Handlers are recorded on the device; the simulation raises those on
+// GPS_PPS_PIN and MPU_INT_PIN (see simAdvanceMicros())
+void attachInterrupt(uint8_t pin, void (*handler)(void), int mode);
+void attachInterruptArg(uint8_t pin, void (*handler)(void*), void* arg, int mode);
+void detachInterrupt(uint8_t pin);
+
+// FreeRTOS, as far as the firmware uses it outside #ifdef ESP32: the task
+// handle is the device, and ticks are CONFIG_FREERTOS_HZ = 1000 as in the
+// Arduino core
+typedef void* TaskHandle_t;
+typedef int BaseType_t;
+typedef uint32_t TickType_t;
+#define pdFALSE 0
+#define pdTRUE 1
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFFUL)
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms) / portTICK_PERIOD_MS)
+#define portYIELD_FROM_ISR(...) do {} while (0)
+TaskHandle_t xTaskGetCurrentTaskHandle();
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* higherPriorityTaskWoken);
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait);
+
+// Minimal Arduino String, only what the firmware touches
+class String {
+private:
+  std::string value;
+
+public:
+  String() {}
+  String(const char* text) : value(text ? text : "") {}
+  String(const std::string& text) : value(text) {}
+  String(int number) : value(std::to_string(number)) {}
+  String(unsigned int number) : value(std::to_string(number)) {}
+  String(long number) : value(std::to_string(number)) {}
+  String(unsigned long number) : value(std::to_string(number)) {}
+
+  const char* c_str() const { return value.c_str(); }
+  size_t length() const { return value.size(); }
+  String& operator+=(const String& other) { value += other.value; return *this; }
+  String& operator+=(const char* other) { value += other; return *this; }
+  bool operator==(const char* other) const { return value == other; }
+};
+
+// Output is counted on the device (and echoed on request); nothing is ever
+// typed at the console, and the wire always keeps up
+class HardwareSerial {
+public:
+  void begin(unsigned long baud);
+  size_t setTxBufferSize(size_t size) { return size; }
+  int available() { return 0; }
+  int read() { return -1; }
+  int availableForWrite() { return 4096; }
+  size_t print(const char* text);
+  size_t print(const String& text);
+  size_t print(char c);
+  size_t print(int number);
+  size_t print(unsigned int number);
+  size_t print(long number);
+  size_t print(unsigned long number);
+  size_t print(double number, int digits = 2);
+  size_t println();
+  size_t println(const char* text);
+  size_t println(const String& text);
+  size_t println(int number);
+  size_t println(unsigned long number);
+  size_t println(double number, int digits = 2);
+  size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+  size_t write(const uint8_t* data, size_t length);
+  operator bool() const { return true; }
+};
+
+extern HardwareSerial Serial;
+
+class EspClass {
+public:
+  uint64_t getEfuseMac();
+  uint32_t getFreeHeap();
+  void restart();
+};
+
+extern EspClass ESP;
+
+#endif // SIM_ARDUINO_H
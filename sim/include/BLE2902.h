@@ -0,0 +1,10 @@
+#ifndef SIM_BLE2902_H
+#define SIM_BLE2902_H
+
+#include <BLEDevice.h>
+
+// Client Characteristic Configuration descriptor
+class BLE2902 : public BLEDescriptor {
+};
+
+#endif // SIM_BLE2902_H
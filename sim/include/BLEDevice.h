@@ -0,0 +1,74 @@
+#ifndef SIM_BLE_DEVICE_H
+#define SIM_BLE_DEVICE_H
+
+#include <Arduino.h>
+#include <string>
+
+// ESP32 BLE library as far as BleCompanion uses it. The host has no radio:
+// createServer() fails, so begin() returns false and the companion stays
+// disconnected, which is how the firmware runs with no phone nearby.
+
+class BLEServer;
+class BLECharacteristic;
+
+class BLEServerCallbacks {
+public:
+  virtual ~BLEServerCallbacks() {}
+  virtual void onConnect(BLEServer*) {}
+  virtual void onDisconnect(BLEServer*) {}
+};
+
+class BLECharacteristicCallbacks {
+public:
+  virtual ~BLECharacteristicCallbacks() {}
+  virtual void onWrite(BLECharacteristic*) {}
+};
+
+class BLEDescriptor {
+public:
+  virtual ~BLEDescriptor() {}
+};
+
+class BLECharacteristic {
+public:
+  static const uint32_t PROPERTY_WRITE = 1 << 3;
+  static const uint32_t PROPERTY_NOTIFY = 1 << 4;
+  static const uint32_t PROPERTY_WRITE_NR = 1 << 5;
+
+  void addDescriptor(BLEDescriptor*) {}
+  void setCallbacks(BLECharacteristicCallbacks*) {}
+  void setValue(uint8_t*, size_t) {}
+  void notify() {}
+  std::string getValue() { return std::string(); }
+};
+
+class BLEService {
+public:
+  BLECharacteristic* createCharacteristic(const char*, uint32_t) { return nullptr; }
+  void start() {}
+};
+
+class BLEServer {
+public:
+  void setCallbacks(BLEServerCallbacks*) {}
+  BLEService* createService(const char*) { return nullptr; }
+  uint16_t getConnId() { return 0; }
+  uint16_t getPeerMTU(uint16_t) { return 0; }
+};
+
+class BLEAdvertising {
+public:
+  void addServiceUUID(const char*) {}
+  void setScanResponse(bool) {}
+};
+
+class BLEDevice {
+public:
+  static void init(const char*) {}
+  static void setMTU(uint16_t) {}
+  static BLEServer* createServer() { return nullptr; }
+  static BLEAdvertising* getAdvertising() { return nullptr; }
+  static void startAdvertising() {}
+};
+
+#endif // SIM_BLE_DEVICE_H
@@ -0,0 +1,7 @@
+#ifndef SIM_BLE_SERVER_H
+#define SIM_BLE_SERVER_H
+
+// Declared with the rest of the BLE stand-in
+#include <BLEDevice.h>
+
+#endif // SIM_BLE_SERVER_H
@@ -0,0 +1,80 @@
+#ifndef SIM_FIREBASE_ESP_CLIENT_H
+#define SIM_FIREBASE_ESP_CLIENT_H
+
+#include <Arduino.h>
+
+// RTDB client stand-in. Every write costs rtdbLatencyMs of virtual time (the
+// blocking TLS round trip on the real unit), or SIM_RTDB_SEND_US for the
+// *Async variants that only send, and is counted on the device.
+
+struct token_info_t {
+  int status;
+};
+
+typedef void (*TokenStatusCallback)(token_info_t);
+
+struct FirebaseSignupError {
+  String message;
+};
+
+struct FirebaseSigner {
+  FirebaseSignupError signupError;
+};
+
+struct FirebaseConfig {
+  String api_key;
+  String database_url;
+  FirebaseSigner signer;
+  TokenStatusCallback token_status_callback = nullptr;
+};
+
+struct FirebaseAuth {
+};
+
+class FirebaseData {
+public:
+  String errorReason() const { return String("simulated"); }
+};
+
+class FirebaseJson {
+private:
+  std::string body;
+  void appendKey(const char* key);
+
+public:
+  void set(const char* key, int value);
+  void set(const char* key, unsigned long value);
+  void set(const char* key, float value);
+  void set(const char* key, double value);
+  void set(const char* key, bool value);
+  void set(const char* key, const char* value);
+  size_t size() const { return body.size() + 2; }
+  const char* raw() const { return body.c_str(); }
+};
+
+class FirebaseRTDB {
+public:
+  bool setInt(FirebaseData* data, const char* path, int value);
+  bool setFloat(FirebaseData* data, const char* path, float value);
+  bool setBool(FirebaseData* data, const char* path, bool value);
+  bool setString(FirebaseData* data, const char* path, const char* value);
+  bool setJSON(FirebaseData* data, const char* path, FirebaseJson* json);
+  bool updateNode(FirebaseData* data, const char* path, FirebaseJson* json);
+  bool setIntAsync(FirebaseData* data, const char* path, int value);
+  bool setFloatAsync(FirebaseData* data, const char* path, float value);
+  bool setBoolAsync(FirebaseData* data, const char* path, bool value);
+  bool setJSONAsync(FirebaseData* data, const char* path, FirebaseJson* json);
+};
+
+class FirebaseClass {
+public:
+  FirebaseRTDB RTDB;
+  bool signUp(FirebaseConfig* config, FirebaseAuth* auth, const char* email, const char* password);
+  void begin(FirebaseConfig* config, FirebaseAuth* auth);
+  void reconnectWiFi(bool reconnect);
+  bool ready();
+};
+
+extern FirebaseClass Firebase;
+
+#endif // SIM_FIREBASE_ESP_CLIENT_H
@@ -0,0 +1,6 @@
+#ifndef SIM_I2CDEV_H
+#define SIM_I2CDEV_H
+
+#include <Arduino.h>
+
+#endif // SIM_I2CDEV_H
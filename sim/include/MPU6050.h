@@ -0,0 +1,44 @@
+#ifndef SIM_MPU6050_H
+#define SIM_MPU6050_H
+
+#include <Arduino.h>
+
+#define MPU6050_ACCEL_FS_2 0x00
+#define MPU6050_ACCEL_FS_4 0x01
+#define MPU6050_ACCEL_FS_8 0x02
+#define MPU6050_ACCEL_FS_16 0x03
+
+#define MPU6050_GYRO_FS_250 0x00
+#define MPU6050_GYRO_FS_500 0x01
+#define MPU6050_GYRO_FS_1000 0x02
+#define MPU6050_GYRO_FS_2000 0x03
+
+#define MPU6050_DLPF_BW_256 0x00
+#define MPU6050_DLPF_BW_188 0x01
+#define MPU6050_DLPF_BW_98 0x02
+#define MPU6050_DLPF_BW_42 0x03
+#define MPU6050_DLPF_BW_20 0x04
+#define MPU6050_DLPF_BW_10 0x05
+#define MPU6050_DLPF_BW_5 0x06
+
+// Register-level behavior of the sensor: raw counts follow the configured
+// full-scale range and saturate at the int16 limits, as the real part does.
+class MPU6050 {
+public:
+  MPU6050(uint8_t address = 0x68);
+  void initialize();
+  bool testConnection();
+  void setFullScaleAccelRange(uint8_t range);
+  void setFullScaleGyroRange(uint8_t range);
+  void setDLPFMode(uint8_t mode);
+  // SMPLRT_DIV: output rate = gyro rate (1 kHz with the DLPF on) / (1 + divider)
+  void setRate(uint8_t divider);
+  void setIntDataReadyEnabled(bool enabled);
+  void getMotion6(int16_t* ax, int16_t* ay, int16_t* az,
+                  int16_t* gx, int16_t* gy, int16_t* gz);
+
+private:
+  uint8_t address;
+};
+
+#endif // SIM_MPU6050_H
@@ -0,0 +1,26 @@
+#ifndef SIM_PREFERENCES_H
+#define SIM_PREFERENCES_H
+
+#include <Arduino.h>
+
+// NVS key-value store, kept on the current device (see SimDevice::nvs).
+// Only the blob calls the firmware uses.
+class Preferences {
+public:
+  Preferences();
+  bool begin(const char* name, bool readOnly = false);
+  void end();
+  bool clear();
+  bool remove(const char* key);
+  bool isKey(const char* key);
+  size_t putBytes(const char* key, const void* value, size_t length);
+  size_t getBytes(const char* key, void* buffer, size_t maxLength);
+  size_t getBytesLength(const char* key);
+
+private:
+  char name[16];
+  bool started;
+  bool readOnly;
+};
+
+#endif // SIM_PREFERENCES_H
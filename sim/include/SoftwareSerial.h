@@ -0,0 +1,16 @@
+#ifndef SIM_SOFTWARE_SERIAL_H
+#define SIM_SOFTWARE_SERIAL_H
+
+#include <Arduino.h>
+
+// The GPS UART. Bytes of the once-per-second NMEA burst become available at
+// the configured baud rate on the device's virtual clock.
+class SoftwareSerial {
+public:
+  SoftwareSerial(int rxPin, int txPin);
+  void begin(uint32_t baud);
+  int available();
+  int read();
+};
+
+#endif // SIM_SOFTWARE_SERIAL_H
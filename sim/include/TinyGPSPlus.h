@@ -0,0 +1,88 @@
+#ifndef SIM_TINY_GPS_PLUS_H
+#define SIM_TINY_GPS_PLUS_H
+
+#include <Arduino.h>
+
+// NMEA decoder covering the subset of TinyGPS++ the firmware uses
+// (GGA/RMC position, fix validity, satellite count and UTC date/time)
+// Reading a field clears isUpdated(), as in TinyGPS++
+class TinyGPSLocation {
+  friend class TinyGPSPlus;
+private:
+  bool valid;
+  bool updated;
+  double latitude;
+  double longitude;
+
+public:
+  TinyGPSLocation() : valid(false), updated(false), latitude(0), longitude(0) {}
+  bool isValid() const { return valid; }
+  bool isUpdated() const { return updated; }
+  double lat() { updated = false; return latitude; }
+  double lng() { updated = false; return longitude; }
+};
+
+class TinyGPSTime {
+  friend class TinyGPSPlus;
+private:
+  bool valid;
+  bool updated;
+  uint32_t time;   // hhmmsscc
+
+public:
+  TinyGPSTime() : valid(false), updated(false), time(0) {}
+  bool isValid() const { return valid; }
+  bool isUpdated() const { return updated; }
+  uint32_t value() { updated = false; return time; }
+  uint8_t hour() { updated = false; return time / 1000000; }
+  uint8_t minute() { updated = false; return (time / 10000) % 100; }
+  uint8_t second() { updated = false; return (time / 100) % 100; }
+  uint8_t centisecond() { updated = false; return time % 100; }
+};
+
+class TinyGPSDate {
+  friend class TinyGPSPlus;
+private:
+  bool valid;
+  bool updated;
+  uint32_t date;   // ddmmyy
+
+public:
+  TinyGPSDate() : valid(false), updated(false), date(0) {}
+  bool isValid() const { return valid; }
+  bool isUpdated() const { return updated; }
+  uint32_t value() { updated = false; return date; }
+  uint16_t year() { updated = false; return date % 100 + 2000; }
+  uint8_t month() { updated = false; return (date / 100) % 100; }
+  uint8_t day() { updated = false; return date / 10000; }
+};
+
+class TinyGPSInteger {
+  friend class TinyGPSPlus;
+private:
+  uint32_t number;
+
+public:
+  TinyGPSInteger() : number(0) {}
+  uint32_t value() const { return number; }
+};
+
+class TinyGPSPlus {
+private:
+  char sentence[96];
+  size_t length;
+  bool parseSentence();
+
+public:
+  TinyGPSLocation location;
+  TinyGPSTime time;
+  TinyGPSDate date;
+  TinyGPSInteger satellites;
+
+  TinyGPSPlus() : length(0) {}
+
+  // Feed one byte; true when it completed a valid sentence
+  bool encode(char c);
+};
+
+#endif // SIM_TINY_GPS_PLUS_H
@@ -0,0 +1,43 @@
+#ifndef SIM_WIFI_H
+#define SIM_WIFI_H
+
+#include <Arduino.h>
+
+typedef enum {
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_DISCONNECTED = 6
+} wl_status_t;
+
+class IPAddress {
+private:
+  uint8_t octets[4];
+
+public:
+  IPAddress(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0) {
+    octets[0] = a; octets[1] = b; octets[2] = c; octets[3] = d;
+  }
+  operator uint32_t() const {
+    return (uint32_t)octets[0] | ((uint32_t)octets[1] << 8) |
+           ((uint32_t)octets[2] << 16) | ((uint32_t)octets[3] << 24);
+  }
+  String toString() const;
+};
+
+// Station mode. Association completes wifiAssociateMs of virtual time after
+// begin(), if the device's access point is available; none of the calls
+// block. localIP() is 0.0.0.0 until associated.
+class WiFiClass {
+public:
+  wl_status_t begin(const char* ssid, const char* password);
+  wl_status_t status();
+  bool reconnect();
+  bool disconnect();
+  IPAddress localIP();
+};
+
+extern WiFiClass WiFi;
+
+#endif // SIM_WIFI_H
@@ -0,0 +1,26 @@
+#ifndef SIM_WIRE_H
+#define SIM_WIRE_H
+
+#include <Arduino.h>
+
+// Register-level I2C: the MPU6050s at 0x68/0x69 answer reads of their
+// motion registers, and the bus can be hung by fault injection on the
+// device (see SimDevice::i2cSdaHeldPulses)
+class TwoWire {
+public:
+  bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0);
+  bool end();
+  void setClock(uint32_t frequency);
+  uint32_t getClock() const;
+  void setTimeOut(uint16_t timeoutMs);
+  void beginTransmission(uint8_t address);
+  size_t write(uint8_t value);
+  uint8_t endTransmission(bool sendStop = true);
+  uint8_t requestFrom(uint8_t address, uint8_t length, bool sendStop = true);
+  int available();
+  int read();
+};
+
+extern TwoWire Wire;
+
+#endif // SIM_WIRE_H
@@ -0,0 +1,6 @@
+#ifndef SIM_RTDB_HELPER_H
+#define SIM_RTDB_HELPER_H
+
+#include <Firebase_ESP_Client.h>
+
+#endif // SIM_RTDB_HELPER_H
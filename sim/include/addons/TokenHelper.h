@@ -0,0 +1,9 @@
+#ifndef SIM_TOKEN_HELPER_H
+#define SIM_TOKEN_HELPER_H
+
+#include <Firebase_ESP_Client.h>
+
+inline void tokenStatusCallback(token_info_t) {
+}
+
+#endif // SIM_TOKEN_HELPER_H
@@ -0,0 +1,17 @@
+#ifndef SIM_ESP_SNTP_H
+#define SIM_ESP_SNTP_H
+
+#include <Arduino.h>
+
+// lwIP SNTP re-syncs hourly by default (CONFIG_LWIP_SNTP_UPDATE_DELAY)
+#define SIM_SNTP_INTERVAL_MS 3600000UL
+
+typedef enum {
+  SNTP_SYNC_STATUS_RESET,
+  SNTP_SYNC_STATUS_COMPLETED,
+  SNTP_SYNC_STATUS_IN_PROGRESS
+} sntp_sync_status_t;
+
+sntp_sync_status_t sntp_get_sync_status();
+
+#endif // SIM_ESP_SNTP_H
@@ -0,0 +1,18 @@
+#ifndef SIM_ESP_TASK_WDT_H
+#define SIM_ESP_TASK_WDT_H
+
+#include <Arduino.h>
+
+// Task watchdog: nothing to reset on the host, and a unit that stops
+// feeding it shows up in HealthMonitor instead
+typedef int esp_err_t;
+#ifndef ESP_OK
+#define ESP_OK 0
+#endif
+
+inline esp_err_t esp_task_wdt_init(uint32_t, bool) { return ESP_OK; }
+inline esp_err_t esp_task_wdt_add(TaskHandle_t) { return ESP_OK; }
+inline esp_err_t esp_task_wdt_delete(TaskHandle_t) { return ESP_OK; }
+inline esp_err_t esp_task_wdt_reset() { return ESP_OK; }
+
+#endif // SIM_ESP_TASK_WDT_H
@@ -0,0 +1,254 @@
+#include "scenario.h"
+#include <math.h>
+#include <algorithm>
+
+static const double PI = 3.14159265358979323846;
+static const double METERS_PER_DEGREE = 111320.0;
+
+// Stateless hash noise: same (seed, channel, step) always gives the same value
+static uint32_t mix(uint32_t a, uint32_t b, uint32_t c) {
+  uint32_t h = a * 0x9E3779B1u ^ (b + 0x7F4A7C15u) * 0x85EBCA77u ^ c * 0xC2B2AE3Du;
+  h ^= h >> 15;
+  h *= 0x2C1B3C6Du;
+  h ^= h >> 12;
+  h *= 0x297A2D39u;
+  h ^= h >> 15;
+  return h;
+}
+
+static float whiteNoise(uint32_t seed, uint32_t channel, uint32_t step) {
+  return (mix(seed, channel, step) & 0xFFFFFF) / 8388607.5f - 1.0f;
+}
+
+// Piecewise-linear noise with knots every periodMs, in [-1, 1]
+static float smoothNoise(uint32_t seed, uint32_t channel, double timeMs, double periodMs) {
+  double position = timeMs / periodMs;
+  uint32_t knot = (uint32_t)position;
+  float fraction = (float)(position - knot);
+  float a = whiteNoise(seed, channel, knot);
+  float b = whiteNoise(seed, channel, knot + 1);
+  return a + (b - a) * fraction;
+}
+
+// 0..1..0 over [start, start + duration), 0 elsewhere
+static float halfSine(double timeMs, double startMs, double durationMs) {
+  if (timeMs < startMs || timeMs >= startMs + durationMs) return 0.0f;
+  return (float)sin(PI * (timeMs - startMs) / durationMs);
+}
+
+static float uniform(uint32_t seed, uint32_t channel, float low, float high) {
+  return low + (whiteNoise(seed, channel, 0) * 0.5f + 0.5f) * (high - low);
+}
+
+Scenario makeScenario(ScenarioType type, uint32_t seed, uint32_t durationMs) {
+  Scenario scenario;
+  scenario.type = type;
+  scenario.seed = seed;
+  scenario.trace = nullptr;
+  float earliest = std::max(durationMs * 0.25f, SCENARIO_PARKED_MS + 5000.0f);
+  float latest = std::max(durationMs * 0.75f, earliest);
+  scenario.eventTimeMs = (uint32_t)uniform(seed, 100, earliest, latest);
+  scenario.headingDegrees = uniform(seed, 101, 0.0f, 360.0f);
+  scenario.speedMps = uniform(seed, 102, 8.0f, 25.0f);
+  scenario.startLatitude = 12.9716 + uniform(seed, 103, -0.2f, 0.2f);
+  scenario.startLongitude = 77.5946 + uniform(seed, 104, -0.2f, 0.2f);
+
+  switch (type) {
+    case SCENARIO_POTHOLE:
+      scenario.eventDurationMs = (uint32_t)uniform(seed, 105, 40.0f, 80.0f);
+      scenario.eventPeak = uniform(seed, 106, 2.5f, 4.5f);
+      break;
+    case SCENARIO_CRASH:
+      scenario.eventDurationMs = (uint32_t)uniform(seed, 105, 80.0f, 160.0f);
+      scenario.eventPeak = uniform(seed, 106, 10.0f, 30.0f);
+      break;
+    case SCENARIO_ROLLOVER:
+      scenario.eventDurationMs = (uint32_t)uniform(seed, 105, 1500.0f, 2500.0f);
+      scenario.eventPeak = uniform(seed, 106, 200.0f, 450.0f);
+      break;
+    case SCENARIO_DOOR_SLAM:
+      scenario.eventDurationMs = (uint32_t)uniform(seed, 105, 60.0f, 120.0f);
+      scenario.eventPeak = uniform(seed, 106, 3.0f, 5.0f);
+      break;
+    case SCENARIO_DROPPED:
+      // 0.45-1 m from a windscreen mount
+      scenario.eventDurationMs = (uint32_t)uniform(seed, 105, 300.0f, 450.0f);
+      scenario.eventPeak = uniform(seed, 106, 6.0f, 15.0f);
+      break;
+    default:
+      scenario.eventDurationMs = 0;
+      scenario.eventPeak = 0.0f;
+      break;
+  }
+  return scenario;
+}
+
+Scenario makeRecordedScenario(const RecordedTrace& trace, uint32_t seed, uint32_t offsetMs) {
+  Scenario scenario = makeScenario(SCENARIO_RECORDED, seed, 0);
+  scenario.eventTimeMs = offsetMs;
+  scenario.trace = &trace;
+  return scenario;
+}
+
+bool scenarioExpectsCrash(ScenarioType type) {
+  return type == SCENARIO_CRASH || type == SCENARIO_ROLLOVER;
+}
+
+const char* scenarioName(ScenarioType type) {
+  switch (type) {
+    case SCENARIO_NORMAL_DRIVE: return "normal";
+    case SCENARIO_POTHOLE: return "pothole";
+    case SCENARIO_CRASH: return "crash";
+    case SCENARIO_ROLLOVER: return "rollover";
+    case SCENARIO_DOOR_SLAM: return "doorslam";
+    case SCENARIO_DROPPED: return "dropped";
+    case SCENARIO_RECORDED: return "recorded";
+    default: return "unknown";
+  }
+}
+
+SimMotion sampleScenario(const Scenario& scenario, uint64_t timeMicros) {
+  if (scenario.type == SCENARIO_RECORDED) {
+    const RecordedTrace& trace = *scenario.trace;
+    uint64_t index = (timeMicros / 1000 + scenario.eventTimeMs) / trace.periodMs;
+    return trace.samples[index % trace.sampleCount];
+  }
+
+  const uint32_t seed = scenario.seed;
+  const double timeMs = timeMicros / 1000.0;
+  const uint32_t step = (uint32_t)(timeMicros / 1000);
+  const double eventMs = scenario.eventTimeMs;
+  const double eventEndMs = eventMs + scenario.eventDurationMs;
+  const bool stopsAtEvent = scenarioExpectsCrash(scenario.type);
+  const bool parked = timeMs < SCENARIO_PARKED_MS || scenario.type == SCENARIO_DOOR_SLAM;
+  const bool stopped = parked || (stopsAtEvent && timeMs >= eventEndMs);
+
+  SimMotion motion;
+
+  // Normal driving: gentle turns, throttle/brake, road and engine vibration
+  float yawRate = stopped ? 0.0f : 12.0f * smoothNoise(seed, 1, timeMs, 4000.0);
+  float speed = stopped ? 0.0f : scenario.speedMps;
+  float lateral = speed * (yawRate * (float)PI / 180.0f) / 9.81f;
+  float longitudinal = stopped ? 0.0f : 0.15f * smoothNoise(seed, 2, timeMs, 2500.0);
+  float road = stopped ? 0.005f : 0.04f;
+
+  motion.accelX = longitudinal + road * whiteNoise(seed, 3, step);
+  motion.accelY = lateral + road * whiteNoise(seed, 4, step);
+  motion.accelZ = 1.0f + road * whiteNoise(seed, 5, step) +
+                  (stopped ? 0.0f : 0.03f * (float)sin(2.0 * PI * 30.0 * timeMs / 1000.0));
+  motion.gyroX = 1.5f * whiteNoise(seed, 6, step);
+  motion.gyroY = 1.5f * whiteNoise(seed, 7, step);
+  motion.gyroZ = yawRate + 1.5f * whiteNoise(seed, 8, step);
+  motion.vibration = (!stopped && (mix(seed, 9, step / 100) % 400) == 0) ? 1 : 0;
+
+  // Traffic ahead: 1.5-4 m, or nothing in range
+  float gap = smoothNoise(seed, 10, timeMs, 8000.0);
+  motion.distance = (gap > -0.3f) ? 250.0f + 150.0f * gap : -1.0f;
+
+  // Position advances along the heading until the vehicle stops
+  double travelMs = stopsAtEvent && timeMs > eventMs ? eventMs : timeMs;
+  if (scenario.type == SCENARIO_DOOR_SLAM) travelMs = 0.0;
+  travelMs = travelMs > SCENARIO_PARKED_MS ? travelMs - SCENARIO_PARKED_MS : 0.0;
+  double travelled = scenario.speedMps * travelMs / 1000.0;
+  double heading = scenario.headingDegrees * PI / 180.0;
+  motion.latitude = scenario.startLatitude + travelled * cos(heading) / METERS_PER_DEGREE;
+  motion.longitude = scenario.startLongitude + travelled * sin(heading) /
+                     (METERS_PER_DEGREE * cos(scenario.startLatitude * PI / 180.0));
+
+  switch (scenario.type) {
+    case SCENARIO_POTHOLE: {
+      float pulse = halfSine(timeMs, eventMs, scenario.eventDurationMs);
+      motion.accelZ += scenario.eventPeak * pulse;
+      motion.gyroX += 40.0f * pulse;
+      if (timeMs >= eventMs && timeMs < eventEndMs + 150.0) motion.vibration = 1;
+      break;
+    }
+
+    case SCENARIO_CRASH: {
+      // Closing in on the obstacle over the last few seconds
+      if (timeMs < eventMs) {
+        float closing = (float)((eventMs - timeMs) / 1000.0 * scenario.speedMps * 100.0);
+        if (closing < 400.0f) motion.distance = closing < 5.0f ? 5.0f : closing;
+      } else {
+        motion.distance = 5.0f;
+      }
+
+      float pulse = halfSine(timeMs, eventMs, scenario.eventDurationMs);
+      float spin = halfSine(timeMs, eventMs, scenario.eventDurationMs * 2.0);
+      float side = (scenario.seed & 1) ? 1.0f : -1.0f;
+      motion.accelX -= scenario.eventPeak * pulse;
+      motion.accelY += side * 0.3f * scenario.eventPeak * pulse;
+      motion.accelZ += 0.2f * scenario.eventPeak * pulse;
+      motion.gyroZ += side * uniform(seed, 11, 150.0f, 300.0f) * spin;
+      if (timeMs >= eventMs && timeMs < eventEndMs + 800.0) motion.vibration = 1;
+      break;
+    }
+
+    case SCENARIO_ROLLOVER: {
+      // Roll rate is a half-sine; the roll angle is its integral
+      double duration = scenario.eventDurationMs;
+      double tau = (timeMs - eventMs) / duration;
+      if (tau < 0.0) tau = 0.0;
+      if (tau > 1.0) tau = 1.0;
+      double rollDegrees = scenario.eventPeak * duration / 1000.0 / PI * (1.0 - cos(PI * tau));
+      double roll = rollDegrees * PI / 180.0;
+
+      if (timeMs >= eventMs) {
+        motion.accelY = (float)sin(roll) + 0.01f * whiteNoise(seed, 4, step);
+        motion.accelZ = (float)cos(roll) + 0.01f * whiteNoise(seed, 5, step);
+        motion.accelX = 0.01f * whiteNoise(seed, 3, step);
+      }
+
+      float rate = halfSine(timeMs, eventMs, duration);
+      motion.gyroX += scenario.eventPeak * rate;
+      // Initial skid, then a hit every time a side or the roof meets the ground
+      motion.accelY += 1.5f * halfSine(timeMs, eventMs, 300.0);
+      double quarterTurns = rollDegrees / 90.0;
+      double toNext = quarterTurns - floor(quarterTurns);
+      if (timeMs >= eventMs && timeMs < eventEndMs && quarterTurns >= 1.0 && toNext < 0.15) {
+        motion.accelZ += uniform(seed, 12 + (uint32_t)quarterTurns, 4.0f, 6.0f);
+      }
+      if (timeMs >= eventMs && timeMs < eventEndMs + 500.0) motion.vibration = 1;
+      if (timeMs >= eventMs) motion.distance = -1.0f;
+      break;
+    }
+
+    case SCENARIO_DOOR_SLAM: {
+      // The body rocks on its suspension
+      float pulse = halfSine(timeMs, eventMs, scenario.eventDurationMs);
+      float rock = halfSine(timeMs, eventMs, scenario.eventDurationMs * 4.0);
+      motion.accelY += scenario.eventPeak * pulse;
+      motion.accelZ += 0.3f * scenario.eventPeak * pulse;
+      motion.gyroX += 25.0f * rock;
+      if (timeMs >= eventMs && timeMs < eventEndMs + 100.0) motion.vibration = 1;
+      break;
+    }
+
+    case SCENARIO_DROPPED: {
+      // Weightless and tumbling, a thump on landing, then lying on its side
+      // in the footwell while the drive goes on
+      const double landingMs = 80.0;
+      if (timeMs >= eventMs && timeMs < eventEndMs) {
+        motion.accelX = 0.02f * whiteNoise(seed, 3, step);
+        motion.accelY = 0.02f * whiteNoise(seed, 4, step);
+        motion.accelZ = 0.02f * whiteNoise(seed, 5, step);
+        motion.gyroX += 120.0f;
+        motion.gyroY += 60.0f;
+      } else if (timeMs >= eventEndMs) {
+        float x = motion.accelX;
+        motion.accelX = motion.accelZ;
+        motion.accelZ = x;
+        float pulse = halfSine(timeMs, eventEndMs, landingMs);
+        motion.accelX += scenario.eventPeak * pulse;
+        motion.gyroY += 200.0f * pulse;
+        if (timeMs < eventEndMs + landingMs + 100.0) motion.vibration = 1;
+      }
+      break;
+    }
+
+    default:
+      break;
+  }
+
+  return motion;
+}
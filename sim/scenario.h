@@ -0,0 +1,67 @@
+#ifndef SCENARIO_H
+#define SCENARIO_H
+
+#include <stdint.h>
+
+// Kinds of drive a simulated unit goes through. Exactly one event per run.
+enum ScenarioType {
+  SCENARIO_NORMAL_DRIVE = 0,
+  SCENARIO_POTHOLE,
+  SCENARIO_CRASH,
+  SCENARIO_ROLLOVER,
+  SCENARIO_DOOR_SLAM,       // parked; a door or boot lid slammed
+  SCENARIO_DROPPED,         // the unit falls off its mount while driving
+  SCENARIO_RECORDED,        // replay of a recorded trace, no labelled event
+  SCENARIO_TYPE_COUNT
+};
+
+// Vehicle is parked for this long after power-on (boot and calibration)
+#define SCENARIO_PARKED_MS 10000
+
+// Physical quantities at one instant, in the sensor frame (Z up at rest)
+struct SimMotion {
+  float accelX, accelY, accelZ;   // g
+  float gyroX, gyroY, gyroZ;      // degrees/second
+  float distance;                 // cm to the nearest obstacle, <0 for none
+  int vibration;                  // vibration switch level
+  double latitude, longitude;     // true position
+};
+
+// A recorded drive log, sampled at a fixed period and shared read-only
+// between all devices replaying it
+struct RecordedTrace {
+  uint32_t periodMs;
+  uint32_t sampleCount;
+  const SimMotion* samples;
+};
+
+// Seeded scenario parameters. All signals are pure functions of (seed, time)
+// so a run replays identically regardless of how often it is sampled.
+struct Scenario {
+  ScenarioType type;
+  uint32_t seed;
+  uint32_t eventTimeMs;     // when the pothole/impact/roll/slam/fall starts
+  uint32_t eventDurationMs; // for a drop: the fall, the landing follows
+  float eventPeak;          // g for impacts, degrees/second for rollovers
+  float headingDegrees;
+  float speedMps;
+  double startLatitude;
+  double startLongitude;
+  const RecordedTrace* trace;  // SCENARIO_RECORDED only
+};
+
+// Draw scenario parameters; the event lands between 25% and 75% of durationMs
+Scenario makeScenario(ScenarioType type, uint32_t seed, uint32_t durationMs);
+
+// True signals at timeMicros
+SimMotion sampleScenario(const Scenario& scenario, uint64_t timeMicros);
+
+// Replay a recorded trace starting offsetMs into it (wrapping around)
+Scenario makeRecordedScenario(const RecordedTrace& trace, uint32_t seed, uint32_t offsetMs);
+
+// Whether a detector should fire for this scenario
+bool scenarioExpectsCrash(ScenarioType type);
+
+const char* scenarioName(ScenarioType type);
+
+#endif // SCENARIO_H
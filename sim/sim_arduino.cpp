@@ -0,0 +1,940 @@
+// Implementations of the Arduino/ESP32 shims in sim/include. Everything acts
+// on simCurrentDevice(), so one thread can step many devices in turn.
+
+#include <Arduino.h>
+#include <ctype.h>
+#include <Firebase_ESP_Client.h>
+#include <esp_partition.h>
+#include <esp_sntp.h>
+#include <MPU6050.h>
+#include <Preferences.h>
+#include <SoftwareSerial.h>
+#include <TinyGPSPlus.h>
+#include <WiFi.h>
+#include <Wire.h>
+#include "config.h"
+#include "sim_clock.h"
+#include "sim_device.h"
+
+HardwareSerial Serial;
+EspClass ESP;
+TwoWire Wire;
+WiFiClass WiFi;
+FirebaseClass Firebase;
+
+// ---------------------------------------------------------------------------
+// Time and GPIO
+
+unsigned long millis() {
+  return SimClock::millis();
+}
+
+unsigned long micros() {
+  return SimClock::micros();
+}
+
+void delay(uint32_t ms) {
+  SimClock::delay(ms);
+}
+
+void delayMicroseconds(uint32_t us) {
+  SimClock::delayMicroseconds(us);
+}
+
+void yield() {
+}
+
+void configTime(long, int, const char*, const char*, const char*) {
+  SimDevice& device = simCurrentDevice();
+  if (device.sntpStarted) return;
+  device.sntpStarted = true;
+  device.sntpSyncedAtMicros = device.clockMicros + (uint64_t)device.sntpLatencyMs * 1000;
+}
+
+sntp_sync_status_t sntp_get_sync_status() {
+  // Like lwIP: COMPLETED once per sync, the first one sntpLatencyMs after
+  // configTime() and then every SIM_SNTP_INTERVAL_MS
+  SimDevice& device = simCurrentDevice();
+  if (!device.sntpStarted || device.clockMicros < device.sntpSyncedAtMicros) {
+    return SNTP_SYNC_STATUS_RESET;
+  }
+  uint64_t interval = (uint64_t)SIM_SNTP_INTERVAL_MS * 1000;
+  uint32_t syncs = (uint32_t)((device.clockMicros - device.sntpSyncedAtMicros) / interval) + 1;
+  if (device.sntpSyncsReported >= syncs) return SNTP_SYNC_STATUS_RESET;
+  device.sntpSyncsReported = syncs;
+  return SNTP_SYNC_STATUS_COMPLETED;
+}
+
+void attachInterrupt(uint8_t pin, void (*handler)(void), int) {
+  if (pin >= SIM_PIN_COUNT) return;
+  SimDevice& device = simCurrentDevice();
+  device.pinHandlers[pin] = handler;
+  device.pinArgHandlers[pin] = nullptr;
+}
+
+void attachInterruptArg(uint8_t pin, void (*handler)(void*), void* arg, int) {
+  if (pin >= SIM_PIN_COUNT) return;
+  SimDevice& device = simCurrentDevice();
+  device.pinHandlers[pin] = nullptr;
+  device.pinArgHandlers[pin] = handler;
+  device.pinArgs[pin] = arg;
+}
+
+void detachInterrupt(uint8_t pin) {
+  if (pin >= SIM_PIN_COUNT) return;
+  SimDevice& device = simCurrentDevice();
+  device.pinHandlers[pin] = nullptr;
+  device.pinArgHandlers[pin] = nullptr;
+}
+
+// ---------------------------------------------------------------------------
+// FreeRTOS task notifications. The device runs one task, loop(); ISRs give
+// to it and ulTaskNotifyTake() sleeps it until they do.
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+  return &simCurrentDevice();
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* higherPriorityTaskWoken) {
+  if (!task) return;
+  ((SimDevice*)task)->taskNotifications++;
+  if (higherPriorityTaskWoken) *higherPriorityTaskWoken = pdTRUE;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait) {
+  SimDevice& device = simCurrentDevice();
+  if (device.taskNotifications == 0 && ticksToWait > 0) {
+    uint64_t start = device.clockMicros;
+    simAdvanceUntilNotified((uint64_t)ticksToWait * portTICK_PERIOD_MS * 1000);
+    device.taskIdleMicros += device.clockMicros - start;
+  }
+  device.taskWakeups++;
+  uint32_t count = device.taskNotifications;
+  if (count > 0) device.taskNotifications = clearCountOnExit ? 0 : count - 1;
+  return count;
+}
+
+// Open-drain I2C line: low while driven low, otherwise pulled up
+static bool lineDrivenLow(const SimDevice& device, uint8_t pin) {
+  return device.pinModes[pin] == OUTPUT && device.pinLevels[pin] == LOW;
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  if (pin >= SIM_PIN_COUNT) return;
+  SimDevice& device = simCurrentDevice();
+  // Each released SCL low clocks a slave holding SDA one bit further
+  if (pin == SCL_PIN && lineDrivenLow(device, pin) && mode != OUTPUT &&
+      device.i2cSdaHeldPulses > 0 && !device.i2cSclHeld) {
+    device.i2cSdaHeldPulses--;
+  }
+  device.pinModes[pin] = mode;
+}
+
+int digitalRead(uint8_t pin) {
+  SimDevice& device = simCurrentDevice();
+  if (pin == VIBRATION_SENSOR_PIN) {
+    return sampleScenario(device.scenario, device.clockMicros).vibration ? HIGH : LOW;
+  }
+  if (pin == SDA_PIN) {
+    return (device.i2cSdaHeldPulses > 0 || lineDrivenLow(device, pin)) ? LOW : HIGH;
+  }
+  if (pin == SCL_PIN) {
+    return (device.i2cSclHeld || lineDrivenLow(device, pin)) ? LOW : HIGH;
+  }
+  return pin < SIM_PIN_COUNT ? device.pinLevels[pin] : LOW;
+}
+
+void digitalWrite(uint8_t pin, uint8_t level) {
+  if (pin < SIM_PIN_COUNT) simCurrentDevice().pinLevels[pin] = level;
+}
+
+unsigned long pulseIn(uint8_t pin, uint8_t state, unsigned long timeoutMicros) {
+  SimDevice& device = simCurrentDevice();
+  if (pin != ECHO_PIN || state != HIGH) {
+    simAdvanceMicros(timeoutMicros);
+    return 0;
+  }
+
+  if (device.ultrasonicStallMs > 0) simAdvanceMicros((uint64_t)device.ultrasonicStallMs * 1000);
+
+  // HC-SR04: echo high time is the round trip at 0.034 cm/us
+  float distance = sampleScenario(device.scenario, device.clockMicros).distance;
+  unsigned long echo = distance > 0 ? (unsigned long)(distance * 2.0f / 0.034f) : 0;
+  if (echo == 0 || echo > timeoutMicros) {
+    simAdvanceMicros(timeoutMicros);
+    return 0;
+  }
+  simAdvanceMicros(echo);
+  return echo;
+}
+
+// ---------------------------------------------------------------------------
+// Serial and ESP
+
+void HardwareSerial::begin(unsigned long) {
+}
+
+size_t HardwareSerial::write(const uint8_t* data, size_t length) {
+  SimDevice& device = simCurrentDevice();
+  device.serialBytes += length;
+  if (device.echoSerial) {
+    fwrite(data, 1, length, stdout);
+  }
+  return length;
+}
+
+size_t HardwareSerial::print(const char* text) {
+  return write((const uint8_t*)text, strlen(text));
+}
+
+size_t HardwareSerial::print(const String& text) {
+  return print(text.c_str());
+}
+
+size_t HardwareSerial::print(char c) {
+  return write((const uint8_t*)&c, 1);
+}
+
+size_t HardwareSerial::print(int number) {
+  return printf("%d", number);
+}
+
+size_t HardwareSerial::print(unsigned int number) {
+  return printf("%u", number);
+}
+
+size_t HardwareSerial::print(long number) {
+  return printf("%ld", number);
+}
+
+size_t HardwareSerial::print(unsigned long number) {
+  return printf("%lu", number);
+}
+
+size_t HardwareSerial::print(double number, int digits) {
+  return printf("%.*f", digits, number);
+}
+
+size_t HardwareSerial::println() {
+  return print("\r\n");
+}
+
+size_t HardwareSerial::println(const char* text) {
+  return print(text) + println();
+}
+
+size_t HardwareSerial::println(const String& text) {
+  return print(text) + println();
+}
+
+size_t HardwareSerial::println(int number) {
+  return print(number) + println();
+}
+
+size_t HardwareSerial::println(unsigned long number) {
+  return print(number) + println();
+}
+
+size_t HardwareSerial::println(double number, int digits) {
+  return print(number, digits) + println();
+}
+
+size_t HardwareSerial::printf(const char* format, ...) {
+  char buffer[256];
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(buffer, sizeof(buffer), format, args);
+  va_end(args);
+  if (length < 0) return 0;
+  if ((size_t)length >= sizeof(buffer)) length = sizeof(buffer) - 1;
+  return write((const uint8_t*)buffer, length);
+}
+
+uint64_t EspClass::getEfuseMac() {
+  return simCurrentDevice().efuseMac;
+}
+
+uint32_t EspClass::getFreeHeap() {
+  return 200000;
+}
+
+void EspClass::restart() {
+  SimDevice& device = simCurrentDevice();
+  device.clockMicros = 0;
+}
+
+// ---------------------------------------------------------------------------
+// I2C and MPU6050
+
+// IMUs are told apart by AD0: index 0 at 0x68, 1 at 0x69
+static int mpuIndex(uint8_t address) {
+  return address == 0x69 ? 1 : 0;
+}
+
+static bool mpuPresentAt(const SimDevice& device, uint8_t address) {
+  if (address != 0x68 && address != 0x69) return false;
+  return mpuIndex(address) ? device.mpuAltPresent : device.mpuPresent;
+}
+
+static bool i2cBusHung(const SimDevice& device) {
+  return device.i2cSdaHeldPulses > 0 || device.i2cSclHeld;
+}
+
+// Bus time for bits at the configured clock
+static void i2cAdvanceBits(SimDevice& device, uint32_t bits) {
+  simAdvanceMicros((uint64_t)bits * 1000000ULL / device.i2cClockHz);
+}
+
+static int16_t toCounts(float value, float countsPerUnit) {
+  float counts = value * countsPerUnit;
+  if (counts > 32767.0f) return 32767;
+  if (counts < -32768.0f) return -32768;
+  return (int16_t)lrintf(counts);
+}
+
+// MPU6050 registers 0x3B..0x48 as of the latest output sample, big-endian
+static void mpuMotionRegisters(SimDevice& device, uint8_t address, uint8_t* registers) {
+  SimMotion motion = sampleScenario(device.scenario, simMpuSampleStartMicros(device));
+  float accelScale = 16384.0f / (1 << device.accelRange[mpuIndex(address)]);
+  float gyroScale = 131.0f / (1 << device.gyroRange[mpuIndex(address)]);
+  int16_t words[7] = {
+    toCounts(motion.accelX, accelScale), toCounts(motion.accelY, accelScale),
+    toCounts(motion.accelZ, accelScale), (int16_t)lrintf((device.mpuTemperatureC - 36.53f) * 340.0f),
+    toCounts(motion.gyroX + device.mpuGyroBiasDps[0], gyroScale),
+    toCounts(motion.gyroY + device.mpuGyroBiasDps[1], gyroScale),
+    toCounts(motion.gyroZ + device.mpuGyroBiasDps[2], gyroScale)
+  };
+  for (int i = 0; i < 7; i++) {
+    registers[2 * i] = (uint8_t)((uint16_t)words[i] >> 8);
+    registers[2 * i + 1] = (uint8_t)words[i];
+  }
+}
+
+bool TwoWire::begin(int, int, uint32_t frequency) {
+  SimDevice& device = simCurrentDevice();
+  device.i2cStarted = true;
+  if (frequency) device.i2cClockHz = frequency;
+  return true;
+}
+
+bool TwoWire::end() {
+  simCurrentDevice().i2cStarted = false;
+  return true;
+}
+
+void TwoWire::setClock(uint32_t frequency) {
+  simCurrentDevice().i2cClockHz = frequency;
+}
+
+uint32_t TwoWire::getClock() const {
+  return simCurrentDevice().i2cClockHz;
+}
+
+void TwoWire::setTimeOut(uint16_t timeoutMs) {
+  simCurrentDevice().i2cTimeoutMs = timeoutMs;
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+  SimDevice& device = simCurrentDevice();
+  device.i2cAddress = address;
+  device.i2cTxLength = 0;
+}
+
+size_t TwoWire::write(uint8_t value) {
+  SimDevice& device = simCurrentDevice();
+  if (device.i2cTxLength >= sizeof(device.i2cTx)) return 0;
+  device.i2cTx[device.i2cTxLength++] = value;
+  return 1;
+}
+
+// Arduino-ESP32 codes: 0 ok, 2 address NACK, 4 other error, 5 timeout
+uint8_t TwoWire::endTransmission(bool) {
+  SimDevice& device = simCurrentDevice();
+  if (!device.i2cStarted) return 4;
+  if (i2cBusHung(device)) {
+    simAdvanceMicros((uint64_t)device.i2cTimeoutMs * 1000);
+    return 5;
+  }
+  if (!mpuPresentAt(device, device.i2cAddress)) {
+    i2cAdvanceBits(device, 11);
+    return 2;
+  }
+  i2cAdvanceBits(device, 9 * (1 + device.i2cTxLength) + 1);
+  if (device.i2cTxLength > 0) device.i2cRegister = device.i2cTx[0];
+  return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t length, bool) {
+  SimDevice& device = simCurrentDevice();
+  device.i2cRxLength = 0;
+  device.i2cRxRead = 0;
+  if (!device.i2cStarted || length > sizeof(device.i2cRx)) return 0;
+  if (i2cBusHung(device)) {
+    simAdvanceMicros((uint64_t)device.i2cTimeoutMs * 1000);
+    return 0;
+  }
+  if (!mpuPresentAt(device, address)) {
+    i2cAdvanceBits(device, 11);
+    return 0;
+  }
+
+  // Only the motion registers and WHO_AM_I read as anything but zero
+  uint8_t motion[14];
+  mpuMotionRegisters(device, address, motion);
+  for (uint8_t i = 0; i < length; i++) {
+    uint8_t reg = device.i2cRegister + i;
+    if (reg >= 0x3B && reg <= 0x48) device.i2cRx[i] = motion[reg - 0x3B];
+    else if (reg == 0x75) device.i2cRx[i] = 0x68;
+    else device.i2cRx[i] = 0;
+  }
+  device.i2cRxLength = length;
+  i2cAdvanceBits(device, 9 * (1 + length) + 2);
+  return length;
+}
+
+int TwoWire::available() {
+  SimDevice& device = simCurrentDevice();
+  return device.i2cRxLength - device.i2cRxRead;
+}
+
+int TwoWire::read() {
+  SimDevice& device = simCurrentDevice();
+  if (device.i2cRxRead >= device.i2cRxLength) return -1;
+  return device.i2cRx[device.i2cRxRead++];
+}
+
+MPU6050::MPU6050(uint8_t devAddr) {
+  address = devAddr;
+}
+
+void MPU6050::initialize() {
+  SimDevice& device = simCurrentDevice();
+  device.accelRange[mpuIndex(address)] = MPU6050_ACCEL_FS_2;
+  device.gyroRange[mpuIndex(address)] = MPU6050_GYRO_FS_250;
+}
+
+bool MPU6050::testConnection() {
+  return mpuPresentAt(simCurrentDevice(), address);
+}
+
+void MPU6050::setFullScaleAccelRange(uint8_t range) {
+  simCurrentDevice().accelRange[mpuIndex(address)] = range & 0x03;
+}
+
+void MPU6050::setFullScaleGyroRange(uint8_t range) {
+  simCurrentDevice().gyroRange[mpuIndex(address)] = range & 0x03;
+}
+
+void MPU6050::setDLPFMode(uint8_t mode) {
+  simCurrentDevice().mpuDlpfMode = mode & 0x07;
+}
+
+void MPU6050::setRate(uint8_t divider) {
+  simCurrentDevice().mpuRateDivider = divider;
+}
+
+void MPU6050::setIntDataReadyEnabled(bool enabled) {
+  simCurrentDevice().mpuDataReadyInterrupt = enabled;
+}
+
+void MPU6050::getMotion6(int16_t* ax, int16_t* ay, int16_t* az,
+                         int16_t* gx, int16_t* gy, int16_t* gz) {
+  SimDevice& device = simCurrentDevice();
+  if (!mpuPresentAt(device, address)) {
+    *ax = *ay = *az = *gx = *gy = *gz = 0;
+    return;
+  }
+
+  uint8_t registers[14];
+  mpuMotionRegisters(device, address, registers);
+  int16_t* outputs[6] = {ax, ay, az, gx, gy, gz};
+  for (int i = 0; i < 6; i++) {
+    int word = i < 3 ? i : i + 1;
+    *outputs[i] = (int16_t)((registers[2 * word] << 8) | registers[2 * word + 1]);
+  }
+
+  // 17 bytes on the bus (address, register, address, 14 data) plus
+  // start/restart/stop
+  i2cAdvanceBits(device, 17 * 9 + 3);
+}
+
+// ---------------------------------------------------------------------------
+// GPS UART and NMEA
+
+static size_t appendNmea(char* buffer, size_t bufferSize, const char* body) {
+  uint8_t checksum = 0;
+  for (const char* c = body; *c; c++) checksum ^= (uint8_t)*c;
+  int written = snprintf(buffer, bufferSize, "$%s*%02X\r\n", body, checksum);
+  return (written > 0 && (size_t)written < bufferSize) ? written : 0;
+}
+
+static void formatCoordinate(char* buffer, size_t bufferSize, double degrees, bool isLatitude) {
+  char hemisphere = isLatitude ? (degrees >= 0 ? 'N' : 'S') : (degrees >= 0 ? 'E' : 'W');
+  degrees = fabs(degrees);
+  int whole = (int)degrees;
+  double minutes = (degrees - whole) * 60.0;
+  snprintf(buffer, bufferSize, isLatitude ? "%02d%07.4f,%c" : "%03d%07.4f,%c",
+           whole, minutes, hemisphere);
+}
+
+// Civil date of a day count since 1970-01-01 (H. Hinnant), as NMEA ddmmyy
+static uint32_t nmeaDate(uint32_t days) {
+  uint32_t z = days + 719468;
+  uint32_t era = z / 146097;
+  uint32_t dayOfEra = z - era * 146097;
+  uint32_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+  uint32_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+  uint32_t mp = (5 * dayOfYear + 2) / 153;
+  uint32_t day = dayOfYear - (153 * mp + 2) / 5 + 1;
+  uint32_t month = mp < 10 ? mp + 3 : mp - 9;
+  uint32_t year = yearOfEra + era * 400 + (month <= 2);
+  return day * 10000 + month * 100 + year % 100;
+}
+
+static void refreshGpsBurst(SimDevice& device) {
+  // Each burst names the UTC second that started gpsNmeaLatencyMs earlier
+  uint64_t latency = (uint64_t)device.gpsNmeaLatencyMs * 1000;
+  if (device.clockMicros < latency) return;
+  uint32_t second = (uint32_t)((device.clockMicros - latency) / 1000000);
+  if (second == device.gpsBurstSecond) return;
+
+  SimMotion motion = sampleScenario(device.scenario, (uint64_t)second * 1000000);
+  bool fix = (uint64_t)second * 1000 >= SIM_GPS_FIX_MS;
+  char latitude[20];
+  char longitude[20];
+  formatCoordinate(latitude, sizeof(latitude), motion.latitude, true);
+  formatCoordinate(longitude, sizeof(longitude), motion.longitude, false);
+
+  uint32_t utc = (uint32_t)(SIM_EPOCH_AT_BOOT + second) % 86400;
+  uint32_t date = nmeaDate((uint32_t)(SIM_EPOCH_AT_BOOT + second) / 86400);
+  char body[96];
+  size_t length = 0;
+
+  snprintf(body, sizeof(body), "GPGGA,%02u%02u%02u.00,%s,%s,%d,%02d,1.0,920.0,M,-86.0,M,,",
+           utc / 3600, (utc / 60) % 60, utc % 60, fix ? latitude : ",",
+           fix ? longitude : ",", fix ? 1 : 0, fix ? 8 : 0);
+  length += appendNmea(device.gpsBuffer + length, SIM_GPS_BUFFER_SIZE - length, body);
+
+  snprintf(body, sizeof(body), "GPRMC,%02u%02u%02u.00,%c,%s,%s,0.0,0.0,%06u,,,A",
+           utc / 3600, (utc / 60) % 60, utc % 60, fix ? 'A' : 'V',
+           fix ? latitude : ",", fix ? longitude : ",", date);
+  length += appendNmea(device.gpsBuffer + length, SIM_GPS_BUFFER_SIZE - length, body);
+
+  // Whatever was not read from the previous burst is lost
+  device.gpsLength = length;
+  device.gpsRead = 0;
+  device.gpsBurstSecond = second;
+  device.gpsBurstStartMicros = (uint64_t)second * 1000000 + latency;
+}
+
+SoftwareSerial::SoftwareSerial(int, int) {
+}
+
+void SoftwareSerial::begin(uint32_t baud) {
+  simCurrentDevice().gpsBaudRate = baud;
+}
+
+int SoftwareSerial::available() {
+  SimDevice& device = simCurrentDevice();
+  refreshGpsBurst(device);
+
+  // 10 bits per byte on the wire
+  uint64_t elapsed = device.clockMicros - device.gpsBurstStartMicros;
+  size_t arrived = (size_t)(elapsed * device.gpsBaudRate / 10 / 1000000);
+  if (arrived > device.gpsLength) arrived = device.gpsLength;
+  return arrived > device.gpsRead ? (int)(arrived - device.gpsRead) : 0;
+}
+
+int SoftwareSerial::read() {
+  SimDevice& device = simCurrentDevice();
+  if (available() <= 0) return -1;
+  return (uint8_t)device.gpsBuffer[device.gpsRead++];
+}
+
+static double parseNmeaCoordinate(const char* value, const char* hemisphere) {
+  if (!*value) return 0.0;
+  double raw = atof(value);
+  int degrees = (int)(raw / 100);
+  double result = degrees + (raw - degrees * 100) / 60.0;
+  return (*hemisphere == 'S' || *hemisphere == 'W') ? -result : result;
+}
+
+// "hhmmss.ss" -> hhmmsscc
+static bool parseNmeaTime(const char* value, uint32_t& time) {
+  if (strlen(value) < 6) return false;
+  uint32_t centiseconds = 0;
+  const char* dot = strchr(value, '.');
+  if (dot && isdigit((unsigned char)dot[1])) {
+    centiseconds = (dot[1] - '0') * 10;
+    if (isdigit((unsigned char)dot[2])) centiseconds += dot[2] - '0';
+  }
+  time = (uint32_t)atol(value) * 100 + centiseconds;
+  return true;
+}
+
+bool TinyGPSPlus::parseSentence() {
+  // $<body>*<checksum>
+  char* star = strchr(sentence, '*');
+  if (sentence[0] != '$' || !star) return false;
+
+  uint8_t checksum = 0;
+  for (char* c = sentence + 1; c < star; c++) checksum ^= (uint8_t)*c;
+  if (strtoul(star + 1, nullptr, 16) != checksum) return false;
+  *star = '\0';
+
+  const char* fields[16];
+  int count = 0;
+  char* cursor = sentence + 1;
+  fields[count++] = cursor;
+  while ((cursor = strchr(cursor, ',')) && count < 16) {
+    *cursor++ = '\0';
+    fields[count++] = cursor;
+  }
+
+  if (!strcmp(fields[0] + 2, "GGA") && count >= 8) {
+    if (parseNmeaTime(fields[1], time.time)) {
+      time.valid = time.updated = true;
+    }
+    satellites.number = atoi(fields[7]);
+    if (atoi(fields[6]) > 0) {
+      location.latitude = parseNmeaCoordinate(fields[2], fields[3]);
+      location.longitude = parseNmeaCoordinate(fields[4], fields[5]);
+      location.valid = location.updated = true;
+    }
+    return true;
+  }
+
+  if (!strcmp(fields[0] + 2, "RMC") && count >= 7) {
+    if (parseNmeaTime(fields[1], time.time)) {
+      time.valid = time.updated = true;
+    }
+    if (count >= 10 && strlen(fields[9]) == 6) {
+      date.date = (uint32_t)atol(fields[9]);
+      date.valid = date.updated = true;
+    }
+    if (fields[2][0] == 'A') {
+      location.latitude = parseNmeaCoordinate(fields[3], fields[4]);
+      location.longitude = parseNmeaCoordinate(fields[5], fields[6]);
+      location.valid = location.updated = true;
+    }
+    return true;
+  }
+
+  return false;
+}
+
+bool TinyGPSPlus::encode(char c) {
+  if (c == '$') {
+    length = 0;
+  }
+  if (c == '\r' || c == '\n') {
+    if (length == 0) return false;
+    sentence[length] = '\0';
+    length = 0;
+    return parseSentence();
+  }
+  if (length < sizeof(sentence) - 1) {
+    sentence[length++] = c;
+  }
+  return false;
+}
+
+// ---------------------------------------------------------------------------
+// Wi-Fi, NTP and Firebase
+
+String IPAddress::toString() const {
+  char text[16];
+  snprintf(text, sizeof(text), "%u.%u.%u.%u", octets[0], octets[1], octets[2], octets[3]);
+  return String(text);
+}
+
+wl_status_t WiFiClass::begin(const char*, const char*) {
+  SimDevice& device = simCurrentDevice();
+  device.wifiStarted = true;
+  device.wifiConnectedAtMicros = device.clockMicros + (uint64_t)device.wifiAssociateMs * 1000;
+  return status();
+}
+
+wl_status_t WiFiClass::status() {
+  SimDevice& device = simCurrentDevice();
+  if (!device.wifiStarted) return WL_IDLE_STATUS;
+  if (!device.wifiAvailable) return WL_NO_SSID_AVAIL;
+  return device.clockMicros >= device.wifiConnectedAtMicros ? WL_CONNECTED : WL_DISCONNECTED;
+}
+
+bool WiFiClass::reconnect() {
+  begin(nullptr, nullptr);
+  return true;
+}
+
+bool WiFiClass::disconnect() {
+  simCurrentDevice().wifiStarted = false;
+  return true;
+}
+
+IPAddress WiFiClass::localIP() {
+  if (status() != WL_CONNECTED) return IPAddress();
+  uint32_t index = simCurrentDevice().index;
+  return IPAddress(10, (index >> 16) & 0xFF, (index >> 8) & 0xFF, index & 0xFF);
+}
+
+void FirebaseJson::appendKey(const char* key) {
+  if (!body.empty()) body += ',';
+  body += '"';
+  body += key;
+  body += "\":";
+}
+
+void FirebaseJson::set(const char* key, int value) {
+  appendKey(key);
+  body += std::to_string(value);
+}
+
+void FirebaseJson::set(const char* key, unsigned long value) {
+  appendKey(key);
+  body += std::to_string(value);
+}
+
+void FirebaseJson::set(const char* key, float value) {
+  set(key, (double)value);
+}
+
+void FirebaseJson::set(const char* key, double value) {
+  char text[32];
+  snprintf(text, sizeof(text), "%.6g", value);
+  appendKey(key);
+  body += text;
+}
+
+void FirebaseJson::set(const char* key, bool value) {
+  appendKey(key);
+  body += value ? "true" : "false";
+}
+
+void FirebaseJson::set(const char* key, const char* value) {
+  appendKey(key);
+  body += '"';
+  body += value;
+  body += '"';
+}
+
+// One RTDB write on the bound device: a blocking round trip, or only the
+// send when the reply is not waited for
+static bool rtdbWrite(const char* path, size_t payloadBytes, bool waitForReply = true) {
+  SimDevice& device = simCurrentDevice();
+  if (WiFi.status() != WL_CONNECTED) return false;
+
+  if (waitForReply) {
+    simBlockMicros((uint64_t)device.rtdbLatencyMs * 1000);
+  } else {
+    simAdvanceMicros(SIM_RTDB_SEND_US);
+  }
+  device.rtdbWrites++;
+  device.rtdbBytes += strlen(path) + payloadBytes;
+  return true;
+}
+
+static void countEmergencyAlert(const char* path, const FirebaseJson& json) {
+  SimDevice& device = simCurrentDevice();
+  if (strstr(path, "/" FB_EMERGENCY_PATH)) {
+    device.emergencyAlerts++;
+    snprintf(device.lastEmergencyPath, sizeof(device.lastEmergencyPath), "%s", path);
+    snprintf(device.lastEmergencyBody, sizeof(device.lastEmergencyBody), "%s", json.raw());
+    if (device.firstEmergencyMs < 0) {
+      device.firstEmergencyMs = (int64_t)(device.clockMicros / 1000);
+    }
+  }
+}
+
+bool FirebaseRTDB::setInt(FirebaseData*, const char* path, int) {
+  return rtdbWrite(path, sizeof(int));
+}
+
+bool FirebaseRTDB::setFloat(FirebaseData*, const char* path, float) {
+  return rtdbWrite(path, sizeof(float));
+}
+
+bool FirebaseRTDB::setBool(FirebaseData*, const char* path, bool) {
+  return rtdbWrite(path, 1);
+}
+
+bool FirebaseRTDB::setString(FirebaseData*, const char* path, const char* value) {
+  return rtdbWrite(path, strlen(value));
+}
+
+bool FirebaseRTDB::setJSON(FirebaseData*, const char* path, FirebaseJson* json) {
+  if (!rtdbWrite(path, json->size())) return false;
+  countEmergencyAlert(path, *json);
+  return true;
+}
+
+bool FirebaseRTDB::updateNode(FirebaseData*, const char* path, FirebaseJson* json) {
+  return rtdbWrite(path, json->size());
+}
+
+bool FirebaseRTDB::setIntAsync(FirebaseData*, const char* path, int) {
+  return rtdbWrite(path, sizeof(int), false);
+}
+
+bool FirebaseRTDB::setFloatAsync(FirebaseData*, const char* path, float) {
+  return rtdbWrite(path, sizeof(float), false);
+}
+
+bool FirebaseRTDB::setBoolAsync(FirebaseData*, const char* path, bool) {
+  return rtdbWrite(path, 1, false);
+}
+
+bool FirebaseRTDB::setJSONAsync(FirebaseData*, const char* path, FirebaseJson* json) {
+  if (!rtdbWrite(path, json->size(), false)) return false;
+  countEmergencyAlert(path, *json);
+  return true;
+}
+
+// Sign-up runs on its own task on the target, so it costs the main loop
+// nothing here; the token arrives one round trip after begin()
+bool FirebaseClass::signUp(FirebaseConfig*, FirebaseAuth*, const char*, const char*) {
+  return WiFi.status() == WL_CONNECTED;
+}
+
+void FirebaseClass::begin(FirebaseConfig*, FirebaseAuth*) {
+  SimDevice& device = simCurrentDevice();
+  device.firebaseStarted = true;
+  device.firebaseTokenAtMicros = device.clockMicros + (uint64_t)device.rtdbLatencyMs * 1000;
+}
+
+void FirebaseClass::reconnectWiFi(bool) {
+}
+
+bool FirebaseClass::ready() {
+  SimDevice& device = simCurrentDevice();
+  return WiFi.status() == WL_CONNECTED && device.firebaseStarted &&
+         device.clockMicros >= device.firebaseTokenAtMicros;
+}
+
+// ---------------------------------------------------------------------------
+// Preferences (NVS)
+
+Preferences::Preferences() {
+  name[0] = '\0';
+  started = false;
+  readOnly = false;
+}
+
+bool Preferences::begin(const char* nvsName, bool nvsReadOnly) {
+  if (strlen(nvsName) >= sizeof(name)) return false;
+  strcpy(name, nvsName);
+  started = true;
+  readOnly = nvsReadOnly;
+  return true;
+}
+
+void Preferences::end() {
+  started = false;
+}
+
+static SimNvsEntry* nvsFind(const char* name, const char* key) {
+  char full[SIM_NVS_KEY_SIZE];
+  snprintf(full, sizeof(full), "%s/%s", name, key);
+  SimDevice& device = simCurrentDevice();
+  for (int i = 0; i < SIM_NVS_ENTRIES; i++) {
+    if (device.nvs[i].length > 0 && strcmp(device.nvs[i].key, full) == 0) return &device.nvs[i];
+  }
+  return nullptr;
+}
+
+bool Preferences::clear() {
+  if (!started || readOnly) return false;
+  char prefix[SIM_NVS_KEY_SIZE];
+  snprintf(prefix, sizeof(prefix), "%s/", name);
+  SimDevice& device = simCurrentDevice();
+  for (int i = 0; i < SIM_NVS_ENTRIES; i++) {
+    if (strncmp(device.nvs[i].key, prefix, strlen(prefix)) == 0) device.nvs[i].length = 0;
+  }
+  return true;
+}
+
+bool Preferences::remove(const char* key) {
+  if (!started || readOnly) return false;
+  SimNvsEntry* entry = nvsFind(name, key);
+  if (!entry) return false;
+  entry->length = 0;
+  return true;
+}
+
+bool Preferences::isKey(const char* key) {
+  return started && nvsFind(name, key) != nullptr;
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t length) {
+  if (!started || readOnly || length == 0 || length > SIM_NVS_VALUE_SIZE) return 0;
+  if (strlen(name) + 1 + strlen(key) >= SIM_NVS_KEY_SIZE) return 0;
+  SimNvsEntry* entry = nvsFind(name, key);
+  if (!entry) {
+    SimDevice& device = simCurrentDevice();
+    for (int i = 0; i < SIM_NVS_ENTRIES && !entry; i++) {
+      if (device.nvs[i].length == 0) entry = &device.nvs[i];
+    }
+    if (!entry) return 0;
+    snprintf(entry->key, sizeof(entry->key), "%s/%s", name, key);
+  }
+  memcpy(entry->value, value, length);
+  entry->length = length;
+  return length;
+}
+
+size_t Preferences::getBytes(const char* key, void* buffer, size_t maxLength) {
+  SimNvsEntry* entry = started ? nvsFind(name, key) : nullptr;
+  if (!entry || entry->length > maxLength) return 0;
+  memcpy(buffer, entry->value, entry->length);
+  return entry->length;
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+  SimNvsEntry* entry = started ? nvsFind(name, key) : nullptr;
+  return entry ? entry->length : 0;
+}
+
+// ---------------------------------------------------------------------------
+// Flash partitions
+
+// One table for every device: the data lives in the bound device
+static const esp_partition_t eventPartition = {
+  ESP_PARTITION_TYPE_DATA, 0x40, 0x290000, SIM_EVENT_FLASH_SIZE, "events"
+};
+
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t type, int subtype, const char* label) {
+  if (type != eventPartition.type) return nullptr;
+  if (subtype != ESP_PARTITION_SUBTYPE_ANY && subtype != eventPartition.subtype) return nullptr;
+  if (label && strcmp(label, eventPartition.label) != 0) return nullptr;
+  return &eventPartition;
+}
+
+static bool partitionRange(const esp_partition_t* partition, size_t offset, size_t size) {
+  return partition == &eventPartition && offset <= partition->size && size <= partition->size - offset;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t* partition, size_t offset, void* dst, size_t size) {
+  if (!partitionRange(partition, offset, size)) return ESP_ERR_INVALID_SIZE;
+  memcpy(dst, simCurrentDevice().eventFlash + offset, size);
+  return ESP_OK;
+}
+
+// NOR programming only clears bits
+esp_err_t esp_partition_write(const esp_partition_t* partition, size_t offset, const void* src, size_t size) {
+  if (!partitionRange(partition, offset, size)) return ESP_ERR_INVALID_SIZE;
+  SimDevice& device = simCurrentDevice();
+  const uint8_t* bytes = (const uint8_t*)src;
+  for (size_t i = 0; i < size; i++) device.eventFlash[offset + i] &= bytes[i];
+  simAdvanceMicros((uint64_t)size * SIM_FLASH_WRITE_US);
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t* partition, size_t offset, size_t size) {
+  if (!partitionRange(partition, offset, size)) return ESP_ERR_INVALID_SIZE;
+  if (offset % SPI_FLASH_SEC_SIZE || size % SPI_FLASH_SEC_SIZE) return ESP_ERR_INVALID_ARG;
+  SimDevice& device = simCurrentDevice();
+  memset(device.eventFlash + offset, 0xFF, size);
+  device.flashErases += size / SPI_FLASH_SEC_SIZE;
+  simAdvanceMicros((uint64_t)(size / SPI_FLASH_SEC_SIZE) * SIM_FLASH_ERASE_US);
+  return ESP_OK;
+}
@@ -0,0 +1,24 @@
+#ifndef SIM_CLOCK_H
+#define SIM_CLOCK_H
+
+#include <stdint.h>
+
+// Virtual clock of the SimDevice bound to the calling thread. Time only
+// moves when the firmware waits (delay, pulseIn, simulated I/O latency), so
+// hours of operation replay in milliseconds and runs are deterministic.
+struct SimClock {
+  static uint32_t millis();
+  static uint32_t micros();
+  static uint64_t micros64();
+  static void delay(uint32_t ms);
+  static void delayMicroseconds(uint32_t us);
+  // Seconds since boot until configTime() has synced, then UTC
+  static uint32_t unixTime();
+  static int64_t utcMicros();
+
+  // Jump the bound device's clock, e.g. to just before the 2^32 ms wrap
+  static void setMicros(uint64_t micros);
+  static uint64_t nowMicros();
+};
+
+#endif // SIM_CLOCK_H
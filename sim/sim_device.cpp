@@ -0,0 +1,194 @@
+#include "sim_device.h"
+#include "sim_clock.h"
+#include "config.h"
+#include <string.h>
+
+static SimDevice defaultDevice;
+static bool defaultDeviceReady = false;
+static thread_local SimDevice* currentDevice = nullptr;
+
+void simInitDevice(SimDevice& device, uint32_t index, const Scenario& scenario) {
+  memset(&device, 0, sizeof(device));
+  device.index = index;
+  // Espressif OUI 24:0a:c4, device index in the NIC-specific octets
+  device.efuseMac = 0x24ULL | (0x0AULL << 8) | (0xC4ULL << 16) |
+                    ((uint64_t)((index >> 16) & 0xFF) << 24) |
+                    ((uint64_t)((index >> 8) & 0xFF) << 32) |
+                    ((uint64_t)(index & 0xFF) << 40);
+  device.scenario = scenario;
+  device.gpsBurstSecond = UINT32_MAX;
+  device.gpsBaudRate = 9600;
+  device.gpsNmeaLatencyMs = 80;
+  device.gpsPpsJitterState = index * 2654435761UL + 1;
+  device.mpuPresent = true;
+  device.mpuAltPresent = true;
+  device.mpuTemperatureC = 25.0f;
+  device.i2cClockHz = 100000;
+  device.i2cTimeoutMs = 50;
+  device.wifiAvailable = true;
+  device.wifiAssociateMs = 1500;
+  device.sntpLatencyMs = 300;
+  device.rtdbLatencyMs = 120;
+  device.firstEmergencyMs = -1;
+  memset(device.eventFlash, 0xFF, sizeof(device.eventFlash));
+}
+
+void simSetCurrentDevice(SimDevice* device) {
+  currentDevice = device;
+}
+
+SimDevice& simCurrentDevice() {
+  if (currentDevice) return *currentDevice;
+  if (!defaultDeviceReady) {
+    simInitDevice(defaultDevice, 0, makeScenario(SCENARIO_NORMAL_DRIVE, 1, 60000));
+    defaultDeviceReady = true;
+  }
+  return defaultDevice;
+}
+
+// Time of the first PPS edge after the given second boundary
+static uint64_t nextPpsEdge(SimDevice& device, uint64_t secondMicros) {
+  device.gpsPpsJitterState ^= device.gpsPpsJitterState << 13;
+  device.gpsPpsJitterState ^= device.gpsPpsJitterState >> 17;
+  device.gpsPpsJitterState ^= device.gpsPpsJitterState << 5;
+  uint32_t jitter = device.gpsPpsJitterUs
+                        ? device.gpsPpsJitterState % (device.gpsPpsJitterUs + 1) : 0;
+  return secondMicros + jitter;
+}
+
+static void raisePin(SimDevice& device, uint8_t pin) {
+  if (device.pinArgHandlers[pin]) device.pinArgHandlers[pin](device.pinArgs[pin]);
+  else if (device.pinHandlers[pin]) device.pinHandlers[pin]();
+}
+
+static bool pinAttached(const SimDevice& device, uint8_t pin) {
+  return device.pinHandlers[pin] || device.pinArgHandlers[pin];
+}
+
+// Next PPS edge after the clock, UINT64_MAX while none will be raised
+static uint64_t nextPpsMicros(SimDevice& device) {
+#if GPS_PPS_PIN >= 0
+  if (!device.gpsPpsWired || !pinAttached(device, GPS_PPS_PIN)) return UINT64_MAX;
+  if (device.gpsNextPpsMicros == 0) {
+    uint64_t fix = (uint64_t)SIM_GPS_FIX_MS * 1000;
+    uint64_t from = device.clockMicros > fix ? device.clockMicros : fix;
+    device.gpsNextPpsMicros = nextPpsEdge(device, (from / 1000000 + 1) * 1000000);
+  }
+  return device.gpsNextPpsMicros;
+#else
+  return UINT64_MAX;
+#endif
+}
+
+uint32_t simMpuSamplePeriodMicros(const SimDevice& device) {
+  bool filtered = device.mpuDlpfMode != 0 && device.mpuDlpfMode != 7;
+  return (filtered ? 1000 : 125) * (1 + (uint32_t)device.mpuRateDivider);
+}
+
+uint64_t simMpuSampleStartMicros(const SimDevice& device) {
+  uint32_t period = simMpuSamplePeriodMicros(device);
+  return device.clockMicros - device.clockMicros % period;
+}
+
+// Next data-ready edge after the clock, UINT64_MAX while none will be raised
+static uint64_t nextDataReadyMicros(const SimDevice& device) {
+#if MPU_INT_PIN >= 0
+  if (!device.mpuDataReadyInterrupt || !(device.mpuPresent || device.mpuAltPresent) ||
+      !pinAttached(device, MPU_INT_PIN)) {
+    return UINT64_MAX;
+  }
+  return simMpuSampleStartMicros(device) + simMpuSamplePeriodMicros(device);
+#else
+  return UINT64_MAX;
+#endif
+}
+
+// Run the clock up to target, raising each edge on the way with the clock
+// at the edge
+static void advanceTo(SimDevice& device, uint64_t target, bool untilNotified) {
+  for (;;) {
+    uint64_t pps = nextPpsMicros(device);
+    uint64_t dataReady = nextDataReadyMicros(device);
+    uint64_t edge = pps < dataReady ? pps : dataReady;
+    if (edge > target) break;
+    device.clockMicros = edge;
+#if GPS_PPS_PIN >= 0
+    if (edge == pps) {
+      raisePin(device, GPS_PPS_PIN);
+      device.gpsNextPpsMicros = nextPpsEdge(device, (device.clockMicros / 1000000 + 1) * 1000000);
+    }
+#endif
+#if MPU_INT_PIN >= 0
+    if (edge == dataReady) raisePin(device, MPU_INT_PIN);
+#endif
+    if (untilNotified && device.taskNotifications > 0) return;
+  }
+  device.clockMicros = target;
+}
+
+void simAdvanceMicros(uint64_t micros) {
+  SimDevice& device = simCurrentDevice();
+  advanceTo(device, device.clockMicros + micros, false);
+}
+
+void simAdvanceUntilNotified(uint64_t micros) {
+  SimDevice& device = simCurrentDevice();
+  uint64_t target = micros > UINT64_MAX - device.clockMicros ? UINT64_MAX : device.clockMicros + micros;
+  advanceTo(device, target, true);
+}
+
+void simBlockMicros(uint64_t micros) {
+  SimDevice& device = simCurrentDevice();
+  simAdvanceMicros(micros);
+  device.taskIdleMicros += micros;
+}
+
+uint64_t simNowMicros() {
+  return simCurrentDevice().clockMicros;
+}
+
+// ---------------------------------------------------------------------------
+// SimClock
+
+uint32_t SimClock::millis() {
+  // Wraps at 2^32 like the ESP32 counter
+  return (uint32_t)(simNowMicros() / 1000);
+}
+
+uint32_t SimClock::micros() {
+  return (uint32_t)simNowMicros();
+}
+
+uint64_t SimClock::micros64() {
+  return simNowMicros();
+}
+
+void SimClock::delay(uint32_t ms) {
+  // vTaskDelay() on the device: the task sleeps
+  simBlockMicros((uint64_t)ms * 1000);
+  simCurrentDevice().taskWakeups++;
+}
+
+void SimClock::delayMicroseconds(uint32_t us) {
+  simAdvanceMicros(us);
+}
+
+uint32_t SimClock::unixTime() {
+  return (uint32_t)(utcMicros() / 1000000);
+}
+
+int64_t SimClock::utcMicros() {
+  SimDevice& device = simCurrentDevice();
+  if (device.sntpStarted && device.clockMicros >= device.sntpSyncedAtMicros) {
+    return (int64_t)SIM_EPOCH_AT_BOOT * 1000000 + (int64_t)device.clockMicros;
+  }
+  return (int64_t)device.clockMicros;
+}
+
+void SimClock::setMicros(uint64_t micros) {
+  simCurrentDevice().clockMicros = micros;
+}
+
+uint64_t SimClock::nowMicros() {
+  return simNowMicros();
+}
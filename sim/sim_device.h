@@ -0,0 +1,175 @@
+#ifndef SIM_DEVICE_H
+#define SIM_DEVICE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "scenario.h"
+
+#define SIM_PIN_COUNT 40
+#define SIM_GPS_BUFFER_SIZE 256
+
+// GPS fix is acquired SIM_GPS_FIX_MS after boot
+#define SIM_GPS_FIX_MS 5000
+
+// UTC the virtual clocks report once SNTP has synced, plus uptime
+#define SIM_EPOCH_AT_BOOT 1700000000UL
+
+#define SIM_NVS_ENTRIES 4
+#define SIM_NVS_KEY_SIZE 32
+#define SIM_NVS_VALUE_SIZE 640
+
+// The "events" data partition, scaled down from partitions.csv so a fleet
+// fits in memory, and NOR timing (typical for the ESP32's SPI flash)
+#define SIM_EVENT_FLASH_SIZE (64 * 1024)
+
+// Emergency alert kept for inspection, path and JSON members
+#define SIM_ALERT_PATH_SIZE 96
+#define SIM_ALERT_BODY_SIZE 512
+#define SIM_FLASH_ERASE_US 45000   // per 4 KB sector
+#define SIM_FLASH_WRITE_US 3       // per byte programmed
+
+// An RTDB write that does not wait for the reply (the client's *Async
+// calls) still encrypts and sends the request on the open TLS session
+#define SIM_RTDB_SEND_US 2000
+
+struct SimNvsEntry {
+  char key[SIM_NVS_KEY_SIZE];
+  uint8_t value[SIM_NVS_VALUE_SIZE];
+  size_t length;          // 0: free
+};
+
+// State of one virtual unit. The Arduino/ESP32 shims in sim/include forward
+// every hardware access (clock, GPIO, I2C, UART, Wi-Fi, Firebase) to the
+// device bound to the calling thread, so the real firmware classes can run
+// thousands of independent instances side by side.
+struct SimDevice {
+  uint32_t index;
+  uint64_t efuseMac;
+
+  // Virtual clock, microseconds since boot. Only delay(), pulseIn(),
+  // ulTaskNotifyTake() and the simulated bus and network latencies move it
+  // forward.
+  uint64_t clockMicros;
+
+  // Motion and environment this device is driven through
+  Scenario scenario;
+
+  // GPIO
+  uint8_t pinModes[SIM_PIN_COUNT];
+  uint8_t pinLevels[SIM_PIN_COUNT];
+  void (*pinHandlers[SIM_PIN_COUNT])(void);
+  void (*pinArgHandlers[SIM_PIN_COUNT])(void*);   // attachInterruptArg()
+  void* pinArgs[SIM_PIN_COUNT];
+
+  // GPS UART: the current NMEA burst and when its first byte arrived
+  char gpsBuffer[SIM_GPS_BUFFER_SIZE];
+  size_t gpsLength;
+  size_t gpsRead;
+  uint64_t gpsBurstStartMicros;
+  uint32_t gpsBurstSecond;
+  uint32_t gpsBaudRate;
+  uint32_t gpsNmeaLatencyMs;   // burst start after the UTC second it names
+
+  // GPS PPS: when wired, the handler attached to GPS_PPS_PIN runs at each
+  // UTC second after the fix, late by up to gpsPpsJitterUs. Off by default:
+  // the firmware's ISR state is static, so units sharing a process would
+  // see each other's edges.
+  bool gpsPpsWired;
+  uint32_t gpsPpsJitterUs;
+  uint64_t gpsNextPpsMicros;
+  uint32_t gpsPpsJitterState;
+
+  // MPU6050 full-scale settings as written by the firmware, per address
+  // (0x68, 0x69); the IMUs at both see the same motion
+  uint8_t accelRange[2];
+  uint8_t gyroRange[2];
+  bool mpuPresent;        // at 0x68
+  bool mpuAltPresent;     // at 0x69
+  // Output rate: 1 kHz with the DLPF on, 8 kHz off, over (1 + divider).
+  // The motion registers change once per output period, and with the
+  // data-ready interrupt enabled MPU_INT_PIN rises as they do.
+  uint8_t mpuDlpfMode;
+  uint8_t mpuRateDivider;
+  bool mpuDataReadyInterrupt;
+  float mpuTemperatureC;         // die temperature, as TEMP_OUT reports it
+  float mpuGyroBiasDps[3];       // zero-rate offset added to every IMU's gyro
+
+  // HC-SR04 fault injection: pulseIn() on the echo pin blocks this long on
+  // top of the measurement, as a sensor that holds ECHO high would
+  uint32_t ultrasonicStallMs;
+
+  // I2C controller and bus. Transfers take bus time at i2cClockHz. Fault
+  // injection: a slave holding SDA low until that many SCL pulses have
+  // been clocked (a transaction cut short), or SCL shorted low.
+  bool i2cStarted;
+  uint32_t i2cClockHz;
+  uint32_t i2cTimeoutMs;
+  uint8_t i2cAddress;
+  uint8_t i2cTx[16];
+  uint8_t i2cTxLength;
+  uint8_t i2cRegister;          // register pointer left by the last write
+  uint8_t i2cRx[32];
+  uint8_t i2cRxLength;
+  uint8_t i2cRxRead;
+  uint32_t i2cSdaHeldPulses;
+  bool i2cSclHeld;
+
+  // Wi-Fi and Firebase
+  bool wifiAvailable;
+  bool wifiStarted;
+  uint64_t wifiConnectedAtMicros;
+  uint32_t wifiAssociateMs;
+  bool sntpStarted;
+  uint64_t sntpSyncedAtMicros;
+  uint32_t sntpSyncsReported;     // by sntp_get_sync_status()
+  uint32_t sntpLatencyMs;
+  bool firebaseStarted;
+  uint64_t firebaseTokenAtMicros;
+  uint32_t rtdbLatencyMs;
+  uint64_t rtdbWrites;
+  uint64_t rtdbBytes;
+  uint32_t emergencyAlerts;
+  int64_t firstEmergencyMs;
+  char lastEmergencyPath[SIM_ALERT_PATH_SIZE];
+  char lastEmergencyBody[SIM_ALERT_BODY_SIZE];
+
+  // NVS: Preferences entries keyed by "namespace/key"; they survive
+  // ESP.restart() and a new SensorManager, but not simInitDevice()
+  SimNvsEntry nvs[SIM_NVS_ENTRIES];
+
+  // Event log partition: erased (0xFF) at power-on, survives ESP.restart()
+  uint8_t eventFlash[SIM_EVENT_FLASH_SIZE];
+  uint32_t flashErases;
+
+  // FreeRTOS: notifications given to the loop task by ISRs and not yet
+  // taken, and the time it spent blocked (delay(), ulTaskNotifyTake(), RTDB
+  // round trips) with the CPU free for other tasks
+  uint32_t taskNotifications;
+  uint64_t taskIdleMicros;
+  uint32_t taskWakeups;
+
+  // Serial output is counted, and only echoed when requested
+  bool echoSerial;
+  uint64_t serialBytes;
+};
+
+// Reset a device to power-on state with a scenario
+void simInitDevice(SimDevice& device, uint32_t index, const Scenario& scenario);
+
+// Bind the device that the shims on this thread act on
+void simSetCurrentDevice(SimDevice* device);
+SimDevice& simCurrentDevice();
+
+// Advance the bound device's virtual clock, raising the GPS PPS and MPU
+// data-ready handlers at their edges on the way
+void simAdvanceMicros(uint64_t micros);
+// Same, but stop right after an edge that notified the loop task
+void simAdvanceUntilNotified(uint64_t micros);
+// Advance with the loop task blocked, not running
+void simBlockMicros(uint64_t micros);
+// MPU6050 output period and the start of the current one
+uint32_t simMpuSamplePeriodMicros(const SimDevice& device);
+uint64_t simMpuSampleStartMicros(const SimDevice& device);
+uint64_t simNowMicros();
+
+#endif // SIM_DEVICE_H
@@ -0,0 +1,115 @@
+#include "sim_flash.h"
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+SimFlash::SimFlash(uint32_t size, uint32_t sectorSize) {
+  bytes = size;
+  sector = sectorSize;
+  memory = new uint8_t[size];
+  memset(memory, 0xFF, size);
+  fd = -1;
+  tearBudget = -1;
+  resetCounters();
+}
+
+SimFlash::~SimFlash() {
+  delete[] memory;
+  if (fd >= 0) close(fd);
+}
+
+bool SimFlash::open(const char* path) {
+  int image = ::open(path, O_RDWR | O_CREAT, 0644);
+  if (image < 0) return false;
+
+  struct stat info;
+  if (fstat(image, &info) != 0) {
+    close(image);
+    return false;
+  }
+  uint8_t erased[4096];
+  memset(erased, 0xFF, sizeof(erased));
+  for (off_t at = info.st_size; at < (off_t)bytes; at += sizeof(erased)) {
+    size_t chunk = (off_t)bytes - at < (off_t)sizeof(erased) ? bytes - at : sizeof(erased);
+    if (pwrite(image, erased, chunk, at) != (ssize_t)chunk) {
+      close(image);
+      return false;
+    }
+  }
+  if (fd >= 0) close(fd);
+  fd = image;
+  delete[] memory;
+  memory = nullptr;
+  return true;
+}
+
+void SimFlash::tearAfter(int64_t bytesLeft) {
+  tearBudget = bytesLeft;
+}
+
+void SimFlash::resetCounters() {
+  bytesRead = 0;
+  readCalls = 0;
+  bytesWritten = 0;
+  erases = 0;
+}
+
+uint32_t SimFlash::size() const {
+  return bytes;
+}
+
+uint32_t SimFlash::sectorSize() const {
+  return sector;
+}
+
+bool SimFlash::read(uint32_t offset, void* data, uint32_t length) {
+  if (offset > bytes || length > bytes - offset) return false;
+  bytesRead += length;
+  readCalls++;
+  if (memory) {
+    memcpy(data, memory + offset, length);
+    return true;
+  }
+  return pread(fd, data, length, offset) == (ssize_t)length;
+}
+
+bool SimFlash::write(uint32_t offset, const void* data, uint32_t length) {
+  if (offset > bytes || length > bytes - offset) return false;
+  uint32_t programmed = length;
+  if (tearBudget >= 0 && tearBudget < (int64_t)length) programmed = (uint32_t)tearBudget;
+  if (tearBudget >= 0) tearBudget -= programmed;
+
+  const uint8_t* source = (const uint8_t*)data;
+  uint8_t chunk[256];
+  for (uint32_t done = 0; done < programmed; done += sizeof(chunk)) {
+    uint32_t count = programmed - done < sizeof(chunk) ? programmed - done : sizeof(chunk);
+    if (!read(offset + done, chunk, count)) return false;
+    bytesRead -= count;
+    readCalls--;
+    for (uint32_t i = 0; i < count; i++) chunk[i] &= source[done + i];
+    if (memory) {
+      memcpy(memory + offset + done, chunk, count);
+    } else if (pwrite(fd, chunk, count, offset + done) != (ssize_t)count) {
+      return false;
+    }
+  }
+  bytesWritten += programmed;
+  return programmed == length;
+}
+
+bool SimFlash::eraseSector(uint32_t offset) {
+  if (offset % sector || offset >= bytes) return false;
+  erases++;
+  if (memory) {
+    memset(memory + offset, 0xFF, sector);
+    return true;
+  }
+  uint8_t erased[4096];
+  memset(erased, 0xFF, sizeof(erased));
+  for (uint32_t done = 0; done < sector; done += sizeof(erased)) {
+    uint32_t count = sector - done < sizeof(erased) ? sector - done : sizeof(erased);
+    if (pwrite(fd, erased, count, offset + done) != (ssize_t)count) return false;
+  }
+  return true;
+}
@@ -0,0 +1,43 @@
+#ifndef SIM_FLASH_H
+#define SIM_FLASH_H
+
+#include <stdint.h>
+#include "event_log.h"
+
+// NOR flash for host tests and benchmarks, in RAM or in an image file.
+// Writes AND into what is there and erases set 0xFF, as on the chip.
+// Counts the traffic, and can tear a write short as a reset would.
+class SimFlash : public FlashRegion {
+private:
+  uint32_t bytes;
+  uint32_t sector;
+  uint8_t* memory;        // RAM image, or nullptr when file-backed
+  int fd;                 // image file, or -1
+  int64_t tearBudget;     // bytes the next writes may still program; -1: no limit
+
+public:
+  uint64_t bytesRead;
+  uint32_t readCalls;
+  uint64_t bytesWritten;
+  uint32_t erases;
+
+  SimFlash(uint32_t size, uint32_t sectorSize = 4096);
+  ~SimFlash();
+
+  // Back the region by an image file, created erased when missing or
+  // too short; the RAM image is dropped
+  bool open(const char* path);
+
+  // Let only this many more bytes be programmed; the write that crosses
+  // the limit stops part way and fails
+  void tearAfter(int64_t bytesLeft);
+  void resetCounters();
+
+  uint32_t size() const override;
+  uint32_t sectorSize() const override;
+  bool read(uint32_t offset, void* data, uint32_t length) override;
+  bool write(uint32_t offset, const void* data, uint32_t length) override;
+  bool eraseSector(uint32_t offset) override;
+};
+
+#endif // SIM_FLASH_H
@@ -0,0 +1,222 @@
+#include "bias_estimator.h"
+#include <math.h>
+#include <string.h>
+
+// A gap this long between readings (a quarter window) restarts the window
+#define BIAS_MAX_GAP_US (BIAS_WINDOW_MS * 250ULL)
+
+// Bounds on a stored model
+#define BIAS_MAX_ACCEL_OFFSET_G 2.0f
+
+static bool finite3(const float* values) {
+  return isfinite(values[0]) && isfinite(values[1]) && isfinite(values[2]);
+}
+
+static int binIndex(float tempC) {
+  int index = (int)floorf((tempC - BIAS_TEMP_MIN_C) / BIAS_TEMP_BIN_C);
+  if (index < 0) return 0;
+  if (index >= BIAS_TEMP_BINS) return BIAS_TEMP_BINS - 1;
+  return index;
+}
+
+BiasEstimator::BiasEstimator() {
+  begin();
+}
+
+void BiasEstimator::begin() {
+  memset(&model, 0, sizeof(model));
+  model.version = BIAS_MODEL_VERSION;
+  temperatureC = BIAS_REFERENCE_C;
+  stationary = false;
+  rejectedWindows = 0;
+  resetWindow();
+}
+
+void BiasEstimator::resetWindow() {
+  windowStart = 0;
+  lastMicros = 0;
+  samples = 0;
+  memset(first, 0, sizeof(first));
+  memset(sums, 0, sizeof(sums));
+  memset(squares, 0, sizeof(squares));
+  temperatureSum = 0;
+}
+
+bool BiasEstimator::load(const BiasModel& stored) {
+  if (stored.version != BIAS_MODEL_VERSION || stored.windows == 0) return false;
+  if (!finite3(stored.accel) || !finite3(stored.gyro) || !finite3(stored.gyroSlope)) return false;
+  for (int axis = 0; axis < 3; axis++) {
+    if (fabsf(stored.accel[axis]) > BIAS_MAX_ACCEL_OFFSET_G) return false;
+    if (fabsf(stored.gyroSlope[axis]) > BIAS_MAX_SLOPE_DPS_PER_C) return false;
+  }
+  for (int i = 0; i < BIAS_TEMP_BINS; i++) {
+    const BiasBin& bin = stored.bins[i];
+    if (!(bin.weight >= 0 && bin.weight <= BIAS_BIN_MAX_WEIGHT)) return false;
+    if (!isfinite(bin.temperatureC) || !finite3(bin.gyro)) return false;
+  }
+
+  begin();
+  model = stored;
+  return true;
+}
+
+const BiasModel& BiasEstimator::getModel() const {
+  return model;
+}
+
+bool BiasEstimator::update(const float* accel, const float* gyro, float tempC, uint64_t nowMicros) {
+  temperatureC = tempC;
+  if (samples > 0 && nowMicros - lastMicros > BIAS_MAX_GAP_US) resetWindow();
+
+  float values[6] = {accel[0], accel[1], accel[2], gyro[0], gyro[1], gyro[2]};
+  if (samples == 0) {
+    windowStart = nowMicros;
+    memcpy(first, values, sizeof(first));
+  }
+  // Offsets from the first reading keep the single-precision sums exact
+  // enough for a variance of a few thousand readings
+  for (int i = 0; i < 6; i++) {
+    float delta = values[i] - first[i];
+    sums[i] += delta;
+    squares[i] += delta * delta;
+  }
+  temperatureSum += tempC;
+  samples++;
+  lastMicros = nowMicros;
+
+  if (nowMicros - windowStart < BIAS_WINDOW_MS * 1000ULL) return false;
+  bool learned = finishWindow();
+  resetWindow();
+  return learned;
+}
+
+bool BiasEstimator::finishWindow() {
+  if (samples < BIAS_MIN_SAMPLES) return false;
+  stationary = false;
+
+  float mean[6];
+  bool still = true;
+  for (int i = 0; i < 6; i++) {
+    float offset = sums[i] / samples;
+    float variance = squares[i] / samples - offset * offset;
+    float limit = i < 3 ? BIAS_ACCEL_STILL_G : BIAS_GYRO_STILL_DPS;
+    mean[i] = first[i] + offset;
+    if (variance > limit * limit) still = false;
+  }
+  float gravity = sqrtf(mean[0] * mean[0] + mean[1] * mean[1] + mean[2] * mean[2]);
+  if (fabsf(gravity - 1.0f) > BIAS_GRAVITY_TOLERANCE_G) still = false;
+  if (!still) {
+    rejectedWindows = 0;
+    return false;
+  }
+
+  float windowC = temperatureSum / samples;
+  if (model.windows > 0) {
+    // A smooth, slow turn is as quiet as a stop; only a rate close to the
+    // known bias is taken for one
+    float accelOffsets[3], bias[3];
+    getOffsets(windowC, accelOffsets, bias);
+    bool far = false;
+    for (int axis = 0; axis < 3; axis++) {
+      if (fabsf(mean[3 + axis] - bias[axis]) > BIAS_MAX_JUMP_DPS) far = true;
+    }
+    if (far) {
+      if (++rejectedWindows < BIAS_RELEARN_WINDOWS) return false;
+      // No turn is this steady for this long: the model is stale, or
+      // belongs to a sensor that has since been replaced
+      begin();
+    }
+  }
+  if (model.windows == 0) {
+    for (int axis = 0; axis < 3; axis++) {
+      if (fabsf(mean[3 + axis]) > BIAS_MAX_INITIAL_DPS) return false;
+    }
+  }
+
+  rejectedWindows = 0;
+  stationary = true;
+  learn(mean, mean + 3, windowC);
+  return true;
+}
+
+void BiasEstimator::learn(const float* accel, const float* gyro, float windowC) {
+  if (model.windows == 0) {
+    memcpy(model.accel, accel, sizeof(model.accel));
+    model.accel[2] -= 1.0f;
+  }
+
+  // Running mean of the newest BIAS_BIN_MAX_WEIGHT windows in this bin,
+  // so slow ageing of the bias is followed too
+  BiasBin& bin = model.bins[binIndex(windowC)];
+  bin.weight = fminf(bin.weight + 1.0f, BIAS_BIN_MAX_WEIGHT);
+  float gain = 1.0f / bin.weight;
+  bin.temperatureC += (windowC - bin.temperatureC) * gain;
+  for (int axis = 0; axis < 3; axis++) {
+    bin.gyro[axis] += (gyro[axis] - bin.gyro[axis]) * gain;
+  }
+  model.windows++;
+  fit();
+}
+
+void BiasEstimator::fit() {
+  // Weighted least squares over the bins, temperatures relative to the
+  // reference
+  float weight = 0, x = 0, xx = 0;
+  float y[3] = {0, 0, 0}, xy[3] = {0, 0, 0};
+  for (int i = 0; i < BIAS_TEMP_BINS; i++) {
+    const BiasBin& bin = model.bins[i];
+    if (bin.weight <= 0) continue;
+    float dx = bin.temperatureC - BIAS_REFERENCE_C;
+    weight += bin.weight;
+    x += bin.weight * dx;
+    xx += bin.weight * dx * dx;
+    for (int axis = 0; axis < 3; axis++) {
+      y[axis] += bin.weight * bin.gyro[axis];
+      xy[axis] += bin.weight * dx * bin.gyro[axis];
+    }
+  }
+  if (weight <= 0) return;
+
+  float meanX = x / weight;
+  float varianceX = xx / weight - meanX * meanX;
+  for (int axis = 0; axis < 3; axis++) {
+    float meanY = y[axis] / weight;
+    if (varianceX >= BIAS_MIN_SPREAD_C * BIAS_MIN_SPREAD_C) {
+      float slope = (xy[axis] / weight - meanX * meanY) / varianceX;
+      model.gyroSlope[axis] = fmaxf(-BIAS_MAX_SLOPE_DPS_PER_C,
+                                    fminf(BIAS_MAX_SLOPE_DPS_PER_C, slope));
+    }
+    model.gyro[axis] = meanY - model.gyroSlope[axis] * meanX;
+  }
+}
+
+void BiasEstimator::getOffsets(float tempC, float* accel, float* gyro) const {
+  memcpy(accel, model.accel, sizeof(model.accel));
+  for (int axis = 0; axis < 3; axis++) {
+    gyro[axis] = model.gyro[axis] + model.gyroSlope[axis] * (tempC - BIAS_REFERENCE_C);
+  }
+}
+
+void BiasEstimator::setOffsets(const float* accel, const float* gyro, float tempC) {
+  memcpy(model.accel, accel, sizeof(model.accel));
+  memset(model.bins, 0, sizeof(model.bins));
+  BiasBin& bin = model.bins[binIndex(tempC)];
+  bin.weight = 1.0f;
+  bin.temperatureC = tempC;
+  memcpy(bin.gyro, gyro, sizeof(bin.gyro));
+  if (model.windows == 0) model.windows = 1;
+  rejectedWindows = 0;
+  fit();
+}
+
+bool BiasEstimator::isCalibrated() const {
+  return model.windows > 0;
+}
+
+bool BiasEstimator::isStationary() const {
+  return stationary;
+}
+
+float BiasEstimator::getTemperature() const {
+  return temperatureC;
+}
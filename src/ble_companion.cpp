@@ -0,0 +1,146 @@
+#include "ble_companion.h"
+#include <BLE2902.h>
+#include <string.h>
+
+BleCompanion::BleCompanion() {
+  server = nullptr;
+  streamCharacteristic = nullptr;
+  responseCharacteristic = nullptr;
+  mtu = 23;
+  streaming = false;
+  batchesSent = 0;
+  framesSent = 0;
+  connected = false;
+  commandPending = false;
+  command[0] = '\0';
+}
+
+bool BleCompanion::begin(const char* name) {
+  BLEDevice::init(name);
+  BLEDevice::setMTU(BLE_REQUESTED_MTU);
+  server = BLEDevice::createServer();
+  if (!server) return false;
+  server->setCallbacks(this);
+
+  BLEService* service = server->createService(BLE_SERVICE_UUID);
+  streamCharacteristic = service->createCharacteristic(BLE_STREAM_UUID, BLECharacteristic::PROPERTY_NOTIFY);
+  streamCharacteristic->addDescriptor(new BLE2902());
+  responseCharacteristic = service->createCharacteristic(BLE_RESPONSE_UUID,
+                                                         BLECharacteristic::PROPERTY_NOTIFY);
+  responseCharacteristic->addDescriptor(new BLE2902());
+  BLECharacteristic* control = service->createCharacteristic(
+      BLE_CONTROL_UUID, BLECharacteristic::PROPERTY_WRITE | BLECharacteristic::PROPERTY_WRITE_NR);
+  control->setCallbacks(this);
+  service->start();
+
+  BLEAdvertising* advertising = BLEDevice::getAdvertising();
+  advertising->addServiceUUID(BLE_SERVICE_UUID);
+  advertising->setScanResponse(true);
+  BLEDevice::startAdvertising();
+  Serial.printf("BleCompanion: advertising as %s\n", name);
+  return true;
+}
+
+void BleCompanion::onConnect(BLEServer*) {
+  connected = true;
+}
+
+void BleCompanion::onDisconnect(BLEServer*) {
+  connected = false;
+  // One client at a time; be findable again
+  BLEDevice::startAdvertising();
+}
+
+// Runs on the BLE task: copy the line and leave the rest to the loop
+void BleCompanion::onWrite(BLECharacteristic* characteristic) {
+  if (commandPending) return;   // the loop has not taken the last one
+  std::string value = characteristic->getValue();
+  size_t length = value.size() < sizeof(command) - 1 ? value.size() : sizeof(command) - 1;
+  memcpy(command, value.data(), length);
+  command[length] = '\0';
+  commandPending = true;
+}
+
+bool BleCompanion::isConnected() const {
+  return connected;
+}
+
+bool BleCompanion::isStreaming() const {
+  return streaming;
+}
+
+void BleCompanion::setStreaming(bool on) {
+  streaming = on;
+  batcher.setMtu(mtu);
+}
+
+void BleCompanion::sendBatch() {
+  uint8_t payload[STREAM_MAX_PAYLOAD];
+  size_t length = batcher.take(payload, sizeof(payload));
+  if (length == 0) return;
+  streamCharacteristic->setValue(payload, length);
+  streamCharacteristic->notify();
+  batchesSent++;
+  framesSent += payload[1];
+}
+
+void BleCompanion::publish(const SensorData& reading, int score, uint8_t flags, uint32_t nowMs) {
+  if (!streaming || !connected) return;
+  StreamFrame frame = makeStreamFrame(reading, 0, score, flags);
+  if (!batcher.add(frame, nowMs)) return;
+  if (batcher.isReady(nowMs)) sendBatch();
+}
+
+void BleCompanion::poll(uint32_t nowMs) {
+  if (!server || !connected) return;
+  uint16_t peerMtu = server->getPeerMTU(server->getConnId());
+  if (peerMtu && peerMtu != mtu) {
+    mtu = peerMtu;
+    batcher.setMtu(mtu);
+    Serial.printf("BleCompanion: MTU %u, %lu frames per notification\n", mtu,
+                  (unsigned long)batcher.getCapacity());
+  }
+  if (streaming && batcher.isReady(nowMs)) sendBatch();
+}
+
+bool BleCompanion::takeCommand(char* line, size_t size) {
+  if (!commandPending || size == 0) return false;
+  strncpy(line, command, size - 1);
+  line[size - 1] = '\0';
+  commandPending = false;
+  return true;
+}
+
+void BleCompanion::respond(const char* line) {
+  if (!connected || !responseCharacteristic) return;
+  size_t chunk = mtu > STREAM_ATT_OVERHEAD ? mtu - STREAM_ATT_OVERHEAD : 20;
+  uint8_t buffer[STREAM_MAX_PAYLOAD];
+  if (chunk > sizeof(buffer)) chunk = sizeof(buffer);
+  size_t length = strlen(line);
+  size_t sent = 0;
+  do {
+    size_t count = length - sent < chunk ? length - sent : chunk;
+    memcpy(buffer, line + sent, count);
+    sent += count;
+    if (sent == length && count < chunk) buffer[count++] = '\n';
+    responseCharacteristic->setValue(buffer, count);
+    responseCharacteristic->notify();
+  } while (sent < length);
+  if (length > 0 && length % chunk == 0) {
+    buffer[0] = '\n';
+    responseCharacteristic->setValue(buffer, 1);
+    responseCharacteristic->notify();
+  }
+}
+
+uint16_t BleCompanion::getMtu() const {
+  return mtu;
+}
+
+uint32_t BleCompanion::getFramesSent() const {
+  return framesSent;
+}
+
+uint32_t BleCompanion::getBatchesSent() const {
+  return batchesSent;
+}
@@ -0,0 +1,275 @@
+#include "ble_stream.h"
+#include "hal.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int16_t quantise(float value, float scale) {
+  float scaled = roundf(value * scale);
+  if (scaled > 32767.0f) return 32767;
+  if (scaled < -32767.0f) return -32767;
+  return (int16_t)scaled;
+}
+
+static void put16(uint8_t* out, uint16_t value) {
+  out[0] = value & 0xFF;
+  out[1] = value >> 8;
+}
+
+static void put32(uint8_t* out, uint32_t value) {
+  put16(out, value & 0xFFFF);
+  put16(out + 2, value >> 16);
+}
+
+static uint16_t get16(const uint8_t* in) {
+  return in[0] | (in[1] << 8);
+}
+
+static uint32_t get32(const uint8_t* in) {
+  return get16(in) | ((uint32_t)get16(in + 2) << 16);
+}
+
+StreamFrame makeStreamFrame(const SensorData& reading, uint16_t sequence, int score, uint8_t flags) {
+  StreamFrame frame;
+  frame.sequence = sequence;
+  frame.sampleMicros = (uint32_t)(reading.sampleMicros ? reading.sampleMicros
+                                                       : (uint64_t)reading.timestamp * 1000);
+  frame.accelMg[0] = quantise(reading.accelX, 1000.0f);
+  frame.accelMg[1] = quantise(reading.accelY, 1000.0f);
+  frame.accelMg[2] = quantise(reading.accelZ, 1000.0f);
+  frame.gyroDeciDps[0] = quantise(reading.gyroX, 10.0f);
+  frame.gyroDeciDps[1] = quantise(reading.gyroY, 10.0f);
+  frame.gyroDeciDps[2] = quantise(reading.gyroZ, 10.0f);
+  frame.distanceCm = (reading.missing & SENSOR_ULTRASONIC) || reading.distance < 0
+                         ? -1 : quantise(reading.distance, 1.0f);
+  frame.missing = reading.missing;
+  frame.quality = reading.quality;
+  frame.score = score < 0 ? 0 : score > 255 ? 255 : score;
+  frame.flags = flags | (reading.vibration ? STREAM_FLAG_VIBRATION : 0);
+  return frame;
+}
+
+void encodeStreamFrame(const StreamFrame& frame, uint8_t* out) {
+  put16(out, frame.sequence);
+  put32(out + 2, frame.sampleMicros);
+  for (int axis = 0; axis < 3; axis++) {
+    put16(out + 6 + axis * 2, (uint16_t)frame.accelMg[axis]);
+    put16(out + 12 + axis * 2, (uint16_t)frame.gyroDeciDps[axis]);
+  }
+  put16(out + 18, (uint16_t)frame.distanceCm);
+  out[20] = frame.missing;
+  out[21] = frame.quality;
+  out[22] = frame.score;
+  out[23] = frame.flags;
+}
+
+void decodeStreamFrame(const uint8_t* in, StreamFrame& frame) {
+  frame.sequence = get16(in);
+  frame.sampleMicros = get32(in + 2);
+  for (int axis = 0; axis < 3; axis++) {
+    frame.accelMg[axis] = (int16_t)get16(in + 6 + axis * 2);
+    frame.gyroDeciDps[axis] = (int16_t)get16(in + 12 + axis * 2);
+  }
+  frame.distanceCm = (int16_t)get16(in + 18);
+  frame.missing = in[20];
+  frame.quality = in[21];
+  frame.score = in[22];
+  frame.flags = in[23];
+}
+
+uint32_t streamFramesPerBatch(uint16_t mtu) {
+  uint32_t payload = mtu > STREAM_ATT_OVERHEAD ? mtu - STREAM_ATT_OVERHEAD : 0;
+  if (payload > STREAM_MAX_PAYLOAD) payload = STREAM_MAX_PAYLOAD;
+  if (payload < STREAM_HEADER_SIZE) return 0;
+  uint32_t frames = (payload - STREAM_HEADER_SIZE) / STREAM_FRAME_SIZE;
+  return frames > 255 ? 255 : frames;
+}
+
+StreamBatcher::StreamBatcher() {
+  capacity = 0;
+  count = 0;
+  batchSequence = 0;
+  frameSequence = 0;
+  firstFrameMs = 0;
+}
+
+void StreamBatcher::setMtu(uint16_t mtu) {
+  capacity = streamFramesPerBatch(mtu);
+  count = 0;
+}
+
+uint32_t StreamBatcher::getCapacity() const {
+  return capacity;
+}
+
+bool StreamBatcher::add(StreamFrame& frame, uint32_t nowMs) {
+  if (capacity == 0) return false;
+  if (count >= capacity) count = 0;  // not taken in time: drop it
+  if (count == 0) firstFrameMs = nowMs;
+  frame.sequence = frameSequence++;
+  encodeStreamFrame(frame, payload + STREAM_HEADER_SIZE + count * STREAM_FRAME_SIZE);
+  count++;
+  return true;
+}
+
+bool StreamBatcher::isReady(uint32_t nowMs) const {
+  return count > 0 && (count >= capacity || elapsedMillis(firstFrameMs, nowMs) >= BLE_BATCH_MAX_MS);
+}
+
+bool StreamBatcher::isEmpty() const {
+  return count == 0;
+}
+
+size_t StreamBatcher::take(uint8_t* out, size_t size) {
+  size_t length = STREAM_HEADER_SIZE + count * STREAM_FRAME_SIZE;
+  if (count == 0 || size < length) return 0;
+  payload[0] = STREAM_MAGIC;
+  payload[1] = count;
+  put16(payload + 2, batchSequence++);
+  memcpy(out, payload, length);
+  count = 0;
+  return length;
+}
+
+StreamDecoder::StreamDecoder() {
+  reset();
+}
+
+void StreamDecoder::reset() {
+  buffered = 0;
+  started = false;
+  lastSequence = 0;
+  lastMicros = 0;
+  unwrappedMicros = 0;
+  frames = 0;
+  batches = 0;
+  lostFrames = 0;
+  skippedBytes = 0;
+  firstMicros = 0;
+  lastFrameMicros = 0;
+}
+
+void StreamDecoder::feed(const uint8_t* data, size_t length, StreamFrameHandler handler, void* context) {
+  while (length > 0) {
+    size_t chunk = sizeof(buffer) - buffered < length ? sizeof(buffer) - buffered : length;
+    memcpy(buffer + buffered, data, chunk);
+    buffered += chunk;
+    data += chunk;
+    length -= chunk;
+
+    size_t at = 0;
+    while (buffered - at >= STREAM_HEADER_SIZE) {
+      uint32_t count = buffer[at + 1];
+      if (buffer[at] != STREAM_MAGIC || count == 0 ||
+          STREAM_HEADER_SIZE + count * STREAM_FRAME_SIZE > STREAM_MAX_PAYLOAD) {
+        at++;
+        skippedBytes++;
+        continue;
+      }
+      size_t batchLength = STREAM_HEADER_SIZE + count * STREAM_FRAME_SIZE;
+      if (buffered - at < batchLength) break;
+
+      batches++;
+      for (uint32_t i = 0; i < count; i++) {
+        StreamFrame frame;
+        decodeStreamFrame(buffer + at + STREAM_HEADER_SIZE + i * STREAM_FRAME_SIZE, frame);
+        if (!started) {
+          started = true;
+          unwrappedMicros = frame.sampleMicros;
+          firstMicros = unwrappedMicros;
+        } else {
+          lostFrames += (uint16_t)(frame.sequence - lastSequence - 1);
+          unwrappedMicros += (uint32_t)(frame.sampleMicros - lastMicros);
+        }
+        lastSequence = frame.sequence;
+        lastMicros = frame.sampleMicros;
+        lastFrameMicros = unwrappedMicros;
+        frames++;
+        if (handler) handler(frame, unwrappedMicros, context);
+      }
+      at += batchLength;
+    }
+    memmove(buffer, buffer + at, buffered - at);
+    buffered -= at;
+  }
+}
+
+double StreamDecoder::getFramesPerSecond() const {
+  if (frames < 2 || lastFrameMicros <= firstMicros) return 0.0;
+  return (frames - 1) * 1e6 / (double)(lastFrameMicros - firstMicros);
+}
+
+struct ConfigSetting {
+  const char* name;
+  float CrashDetectionConfig::*real;
+  int CrashDetectionConfig::*integer;
+  float minimum;
+  float maximum;
+};
+
+static const ConfigSetting settings[] = {
+  {"accel", &CrashDetectionConfig::accelThreshold, nullptr, 0.5f, 16.0f},
+  {"gyro", &CrashDetectionConfig::gyroThreshold, nullptr, 10.0f, 2000.0f},
+  {"severe_accel", &CrashDetectionConfig::severeAccelThreshold, nullptr, 0.5f, 16.0f},
+  {"severe_gyro", &CrashDetectionConfig::severeGyroThreshold, nullptr, 10.0f, 2000.0f},
+  {"jerk", &CrashDetectionConfig::jerkThreshold, nullptr, 0.1f, 200.0f},
+  {"severe_jerk", &CrashDetectionConfig::severeJerkThreshold, nullptr, 0.1f, 400.0f},
+  {"proximity", &CrashDetectionConfig::proximityThreshold, nullptr, 0.0f, 400.0f},
+  {"consecutive", nullptr, &CrashDetectionConfig::consecutiveReadings, 1.0f, 50.0f},
+  {"recovery", &CrashDetectionConfig::recoveryTime, nullptr, 0.0f, 600000.0f},
+  {"jerk_window", nullptr, &CrashDetectionConfig::jerkWindow, 2.0f, 15.0f},
+  {"vibration_flatness", &CrashDetectionConfig::vibrationFlatness, nullptr, 0.0f, 1.0f},
+  {"impact_energy", &CrashDetectionConfig::impactEnergy, nullptr, 0.0f, 100.0f},
+};
+
+bool applyConfigSetting(CrashDetectionConfig& config, const char* name, float value) {
+  for (const ConfigSetting& setting : settings) {
+    if (strcmp(setting.name, name) != 0) continue;
+    if (!(value >= setting.minimum && value <= setting.maximum)) return false;
+    if (setting.real) {
+      config.*setting.real = value;
+    } else {
+      if (value != floorf(value)) return false;
+      config.*setting.integer = (int)value;
+    }
+    return true;
+  }
+  return false;
+}
+
+bool applyConfigSettings(CrashDetectionConfig& config, const char* arguments) {
+  // All or nothing
+  CrashDetectionConfig updated = config;
+  const char* cursor = arguments;
+  bool any = false;
+  while (*cursor) {
+    while (*cursor == ' ' || *cursor == '\r' || *cursor == '\n') cursor++;
+    if (!*cursor) break;
+    const char* equals = strchr(cursor, '=');
+    if (!equals || equals == cursor || equals - cursor >= 32) return false;
+    char name[32];
+    memcpy(name, cursor, equals - cursor);
+    name[equals - cursor] = '\0';
+    char* end;
+    float value = strtof(equals + 1, &end);
+    if (end == equals + 1 || (*end && *end != ' ' && *end != '\r' && *end != '\n')) return false;
+    if (!applyConfigSetting(updated, name, value)) return false;
+    any = true;
+    cursor = end;
+  }
+  if (any) config = updated;
+  return any;
+}
+
+void formatConfigSettings(const CrashDetectionConfig& config, ConfigLineHandler handler, void* context) {
+  char line[48];
+  for (const ConfigSetting& setting : settings) {
+    if (setting.real) {
+      snprintf(line, sizeof(line), "%s=%g", setting.name, config.*setting.real);
+    } else {
+      snprintf(line, sizeof(line), "%s=%d", setting.name, config.*setting.integer);
+    }
+    handler(line, context);
+  }
+}
@@ -0,0 +1,95 @@
+#include "boot_timeline.h"
+#include <Arduino.h>
+#include <string.h>
+
+BootTimeline::BootTimeline() {
+  begin();
+}
+
+void BootTimeline::begin() {
+  memset(stageMicros, 0, sizeof(stageMicros));
+  memset(reached, 0, sizeof(reached));
+  reported = false;
+}
+
+bool BootTimeline::mark(BootStage stage, uint64_t nowMicros) {
+  if (stage >= BOOT_STAGE_COUNT || reached[stage]) return false;
+  reached[stage] = true;
+  stageMicros[stage] = nowMicros;
+  return true;
+}
+
+bool BootTimeline::isReached(BootStage stage) const {
+  return stage < BOOT_STAGE_COUNT && reached[stage];
+}
+
+uint64_t BootTimeline::getMicros(BootStage stage) const {
+  return isReached(stage) ? stageMicros[stage] : 0;
+}
+
+uint32_t BootTimeline::getMillis(BootStage stage) const {
+  return (uint32_t)(getMicros(stage) / 1000);
+}
+
+// The stage each one must not come before. Calibration may be learned at
+// any time once the sensors are up; UTC may come from GPS before Wi-Fi.
+static const int8_t prerequisite[BOOT_STAGE_COUNT] = {
+  -1,               // sensors
+  BOOT_SENSORS,     // detector
+  BOOT_DETECTOR,    // armed
+  BOOT_SENSORS,     // calibrated
+  BOOT_ARMED,       // wifi
+  BOOT_ARMED,       // utc
+  BOOT_WIFI,        // cloud
+  BOOT_CLOUD        // first upload
+};
+
+bool BootTimeline::isInOrder() const {
+  for (int stage = 0; stage < BOOT_STAGE_COUNT; stage++) {
+    int before = prerequisite[stage];
+    if (!reached[stage] || before < 0) continue;
+    if (!reached[before] || stageMicros[before] > stageMicros[stage]) return false;
+  }
+  return true;
+}
+
+bool BootTimeline::isComplete() const {
+  for (int stage = 0; stage < BOOT_STAGE_COUNT; stage++) {
+    if (!reached[stage]) return false;
+  }
+  return true;
+}
+
+bool BootTimeline::report(uint64_t nowMicros) {
+  if (reported) return false;
+  if (!isComplete() && nowMicros < BOOT_REPORT_TIMEOUT_MS * 1000ULL) return false;
+  reported = true;
+  print();
+  return true;
+}
+
+void BootTimeline::print() const {
+  Serial.println("Boot timeline (ms since start):");
+  for (int stage = 0; stage < BOOT_STAGE_COUNT; stage++) {
+    if (reached[stage]) {
+      Serial.printf("  %-12s %8lu\n", stageName((BootStage)stage),
+                    (unsigned long)getMillis((BootStage)stage));
+    } else {
+      Serial.printf("  %-12s %8s\n", stageName((BootStage)stage), "-");
+    }
+  }
+}
+
+const char* BootTimeline::stageName(BootStage stage) {
+  switch (stage) {
+    case BOOT_SENSORS: return "sensors";
+    case BOOT_DETECTOR: return "detector";
+    case BOOT_ARMED: return "armed";
+    case BOOT_CALIBRATED: return "calibrated";
+    case BOOT_WIFI: return "wifi";
+    case BOOT_UTC: return "utc";
+    case BOOT_CLOUD: return "cloud";
+    case BOOT_FIRST_UPLOAD: return "first upload";
+    default: return "unknown";
+  }
+}
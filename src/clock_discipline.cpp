@@ -0,0 +1,178 @@
+#include "clock_discipline.h"
+
+// Each frequency measurement is weighted interval / (interval + tau): closely
+// spaced references (1 Hz GPS, 64 s NTP) are mostly jitter and move the
+// estimate little, hourly ones move it most of the way
+#define FREQUENCY_TIME_CONSTANT_US 1024000000LL
+// Estimate is trusted (CLOCK_TRACKING_PPM) once built on this much time
+#define FREQUENCY_SETTLE_US (2 * FREQUENCY_TIME_CONSTANT_US)
+
+// d microseconds scaled by ppb parts per billion, without 64-bit overflow
+// for intervals of years
+static int64_t scalePpb(int64_t d, int32_t ppb) {
+  return (d / 1000000) * ppb / 1000 + (d % 1000000) * ppb / 1000000000;
+}
+
+static int64_t absolute(int64_t value) {
+  return value < 0 ? -value : value;
+}
+
+ClockDiscipline::ClockDiscipline() {
+  reset();
+}
+
+void ClockDiscipline::reset() {
+  synced = false;
+  anchorMono = 0;
+  anchorUtc = 0;
+  frequencyPpb = 0;
+  slewPpb = 0;
+  slewDuration = 0;
+  lastReferenceMono = 0;
+  referenceUncertainty = 0;
+  lastOffset = 0;
+  referenceCount = 0;
+  stepCount = 0;
+  rejectedCount = 0;
+  source = TIME_SOURCE_NONE;
+  frequencyBaseline = 0;
+}
+
+void ClockDiscipline::anchor(uint64_t monoMicros, int64_t utcMicros) {
+  anchorMono = monoMicros;
+  anchorUtc = utcMicros;
+  slewPpb = 0;
+  slewDuration = 0;
+}
+
+int64_t ClockDiscipline::remainingSlew(uint64_t monoMicros) const {
+  int64_t d = (int64_t)(monoMicros - anchorMono);
+  if (d < 0) d = 0;
+  if ((uint64_t)d >= slewDuration) return 0;
+  return scalePpb((int64_t)slewDuration - d, slewPpb);
+}
+
+bool ClockDiscipline::addReference(uint64_t monoMicros, int64_t utcMicros,
+                                   uint32_t uncertaintyMicros, TimeSource referenceSource) {
+  if (synced && uncertaintyMicros > getErrorMicros(monoMicros)) {
+    rejectedCount++;
+    return false;
+  }
+
+  referenceCount++;
+  source = referenceSource;
+
+  if (!synced) {
+    anchor(monoMicros, utcMicros);
+    synced = true;
+    lastOffset = 0;
+    lastReferenceMono = monoMicros;
+    referenceUncertainty = uncertaintyMicros;
+    return true;
+  }
+
+  int64_t predicted = toUtcMicros(monoMicros);
+  int64_t offset = utcMicros - predicted;
+  lastOffset = offset;
+
+  if (absolute(offset) > CLOCK_STEP_THRESHOLD_US) {
+    // Too far off to slew in reasonable time (first fix after a long
+    // outage, or a bad reference); keep the frequency estimate
+    anchor(monoMicros, utcMicros);
+    stepCount++;
+    lastReferenceMono = monoMicros;
+    referenceUncertainty = uncertaintyMicros;
+    return true;
+  }
+
+  // Frequency error: what accumulated since the last reference, not
+  // counting correction that is still being slewed in
+  const int64_t maxPpb = (int64_t)CLOCK_MAX_FREQ_PPM * 1000;
+  if (monoMicros > lastReferenceMono) {
+    int64_t interval = (int64_t)(monoMicros - lastReferenceMono);
+    int64_t drift = offset - remainingSlew(monoMicros);
+    int64_t measuredPpb = drift * 1000000000LL / interval;
+    if (measuredPpb > 2 * maxPpb) measuredPpb = 2 * maxPpb;
+    if (measuredPpb < -2 * maxPpb) measuredPpb = -2 * maxPpb;
+
+    int64_t frequency = frequencyPpb +
+                        measuredPpb * interval / (interval + FREQUENCY_TIME_CONSTANT_US);
+    if (frequency > maxPpb) frequency = maxPpb;
+    if (frequency < -maxPpb) frequency = -maxPpb;
+    frequencyPpb = (int32_t)frequency;
+    frequencyBaseline += interval;
+  }
+
+  // Continue from the predicted time and slew the offset out, no faster
+  // than CLOCK_MAX_SLEW_PPM
+  anchor(monoMicros, predicted);
+  uint64_t duration = (uint64_t)absolute(offset) * 1000000 / CLOCK_MAX_SLEW_PPM;
+  if (duration < CLOCK_MIN_SLEW_US) duration = CLOCK_MIN_SLEW_US;
+  slewDuration = duration;
+  slewPpb = (int32_t)(offset * 1000000000LL / (int64_t)duration);
+
+  lastReferenceMono = monoMicros;
+  referenceUncertainty = uncertaintyMicros;
+  return true;
+}
+
+bool ClockDiscipline::isSynced() const {
+  return synced;
+}
+
+int64_t ClockDiscipline::toUtcMicros(uint64_t monoMicros) const {
+  if (!synced) return 0;
+
+  int64_t d = (int64_t)(monoMicros - anchorMono);
+  int64_t utc = anchorUtc + d + scalePpb(d, frequencyPpb);
+  if (d > 0 && slewDuration > 0) {
+    int64_t slewed = ((uint64_t)d < slewDuration) ? d : (int64_t)slewDuration;
+    utc += scalePpb(slewed, slewPpb);
+  }
+  return utc;
+}
+
+uint32_t ClockDiscipline::getErrorMicros(uint64_t monoMicros) const {
+  if (!synced) return UINT32_MAX;
+
+  uint64_t sinceReference = (monoMicros > lastReferenceMono) ? monoMicros - lastReferenceMono : 0;
+  uint32_t driftPpm = (frequencyBaseline >= (uint64_t)FREQUENCY_SETTLE_US) ? CLOCK_TRACKING_PPM
+                                                                          : CLOCK_HOLDOVER_PPM;
+  uint64_t error = referenceUncertainty + (uint64_t)absolute(remainingSlew(monoMicros)) +
+                   sinceReference * driftPpm / 1000000;
+  return error > UINT32_MAX ? UINT32_MAX : (uint32_t)error;
+}
+
+int32_t ClockDiscipline::getFrequencyPpb() const {
+  return frequencyPpb;
+}
+
+int64_t ClockDiscipline::getLastOffsetMicros() const {
+  return lastOffset;
+}
+
+uint32_t ClockDiscipline::getReferenceCount() const {
+  return referenceCount;
+}
+
+uint32_t ClockDiscipline::getStepCount() const {
+  return stepCount;
+}
+
+uint32_t ClockDiscipline::getRejectedCount() const {
+  return rejectedCount;
+}
+
+TimeSource ClockDiscipline::getSource() const {
+  return source;
+}
+
+const char* ClockDiscipline::getSourceName(TimeSource timeSource) {
+  switch (timeSource) {
+    case TIME_SOURCE_NONE: return "none";
+    case TIME_SOURCE_NTP: return "ntp";
+    case TIME_SOURCE_GPS_NMEA: return "gps-nmea";
+    case TIME_SOURCE_GPS_PPS: return "gps-pps";
+  }
+  return "unknown";
+}
@@ -0,0 +1,187 @@
+#include "connection_state.h"
+#include "hal.h"
+
+ConnectionStateMachine::ConnectionStateMachine() {
+  link = nullptr;
+  state = CONN_IDLE;
+  stateSince = 0;
+  backoffDelay = 0;
+  currentBackoff = 0;
+  jitterState = 1;
+  attempts = 0;
+  failures = 0;
+  timeSynced = false;
+}
+
+void ConnectionStateMachine::begin(ConnectionLink* connectionLink,
+                                   const ConnectionTimings& connectionTimings,
+                                   uint32_t jitterSeed) {
+  link = connectionLink;
+  timings = connectionTimings;
+  state = CONN_IDLE;
+  stateSince = 0;
+  backoffDelay = 0;
+  currentBackoff = timings.backoffMin;
+  jitterState = jitterSeed ? jitterSeed : 0x9E3779B9UL;
+  attempts = 0;
+  failures = 0;
+  timeSynced = false;
+}
+
+uint32_t ConnectionStateMachine::nextJitter(uint32_t range) {
+  // xorshift32
+  jitterState ^= jitterState << 13;
+  jitterState ^= jitterState >> 17;
+  jitterState ^= jitterState << 5;
+  return range ? jitterState % (range + 1) : 0;
+}
+
+void ConnectionStateMachine::enter(ConnectionState next, uint32_t now) {
+  state = next;
+  stateSince = now;
+
+  switch (next) {
+    case CONN_ASSOCIATING:
+      attempts++;
+      link->startAssociation();
+      break;
+    case CONN_TIME_SYNC:
+      if (!timeSynced) link->startTimeSync();
+      break;
+    case CONN_AUTH:
+      link->startAuth();
+      break;
+    case CONN_READY:
+      currentBackoff = timings.backoffMin;
+      break;
+    default:
+      break;
+  }
+}
+
+void ConnectionStateMachine::fail(uint32_t now) {
+  failures++;
+  link->disconnect();
+
+  backoffDelay = currentBackoff + nextJitter(currentBackoff / 4);
+  currentBackoff = (currentBackoff > timings.backoffMax / 2) ? timings.backoffMax
+                                                             : currentBackoff * 2;
+  enter(CONN_BACKOFF, now);
+}
+
+void ConnectionStateMachine::poll(uint32_t now) {
+  if (!link) return;
+
+  uint32_t inState = elapsedMillis(stateSince, now);
+
+  switch (state) {
+    case CONN_IDLE:
+      enter(CONN_ASSOCIATING, now);
+      break;
+
+    case CONN_ASSOCIATING:
+      if (link->isAssociated()) {
+        enter(CONN_DHCP, now);
+      } else if (inState > timings.associateTimeout) {
+        fail(now);
+      }
+      break;
+
+    case CONN_DHCP:
+      if (!link->isAssociated()) {
+        fail(now);
+      } else if (link->hasAddress()) {
+        enter(CONN_TIME_SYNC, now);
+      } else if (inState > timings.dhcpTimeout) {
+        fail(now);
+      }
+      break;
+
+    case CONN_TIME_SYNC:
+      if (!link->isAssociated()) {
+        fail(now);
+      } else if (timeSynced || link->isTimeSynced()) {
+        timeSynced = true;
+        enter(CONN_AUTH, now);
+      } else if (inState > timings.timeSyncTimeout) {
+        // Not fatal: timestamps fall back to uptime and SNTP keeps trying
+        enter(CONN_AUTH, now);
+      }
+      break;
+
+    case CONN_AUTH: {
+      if (!link->isAssociated()) {
+        fail(now);
+        break;
+      }
+      AuthStatus authStatus = link->getAuthStatus();
+      if (authStatus == AUTH_OK) {
+        enter(CONN_READY, now);
+      } else if (authStatus == AUTH_FAILED || inState > timings.authTimeout) {
+        fail(now);
+      }
+      break;
+    }
+
+    case CONN_READY:
+      if (!link->isAssociated()) {
+        fail(now);
+      } else if (!timeSynced && link->isTimeSynced()) {
+        timeSynced = true;
+      }
+      break;
+
+    case CONN_BACKOFF:
+      if (inState >= backoffDelay) {
+        enter(CONN_ASSOCIATING, now);
+      }
+      break;
+  }
+}
+
+void ConnectionStateMachine::restart() {
+  if (link) link->disconnect();
+  state = CONN_IDLE;
+  currentBackoff = timings.backoffMin;
+}
+
+ConnectionState ConnectionStateMachine::getState() const {
+  return state;
+}
+
+bool ConnectionStateMachine::isReady() const {
+  return state == CONN_READY;
+}
+
+bool ConnectionStateMachine::isTimeSynced() const {
+  return timeSynced;
+}
+
+uint32_t ConnectionStateMachine::getStateSince() const {
+  return stateSince;
+}
+
+uint32_t ConnectionStateMachine::getBackoffDelay() const {
+  return backoffDelay;
+}
+
+uint32_t ConnectionStateMachine::getAttempts() const {
+  return attempts;
+}
+
+uint32_t ConnectionStateMachine::getFailures() const {
+  return failures;
+}
+
+const char* ConnectionStateMachine::getStateName(ConnectionState connectionState) {
+  switch (connectionState) {
+    case CONN_IDLE: return "IDLE";
+    case CONN_ASSOCIATING: return "ASSOCIATING";
+    case CONN_DHCP: return "DHCP";
+    case CONN_TIME_SYNC: return "TIME_SYNC";
+    case CONN_AUTH: return "AUTH";
+    case CONN_READY: return "READY";
+    case CONN_BACKOFF: return "BACKOFF";
+  }
+  return "UNKNOWN";
+}
@@ -0,0 +1,245 @@
+#include "crash_confirmer.h"
+#include "hal.h"
+#include <math.h>
+
+static const float METRES_PER_DEGREE = 111320.0f;
+static const float RADIANS_TO_DEGREES = 57.2957795f;
+static const float GRAVITY_TOLERANCE_G = 0.2f;  // readings averaged into the reference
+static const float GRAVITY_SMOOTHING = 0.05f;   // ~2 s at 10 Hz
+static const float GRAVITY_MAX_DPS = 30.0f;     // turning, not rolling over
+static const float TILT_TOLERANCE_G = 0.3f;     // readings dominated by gravity
+
+CrashConfirmer::CrashConfirmer() {
+  hasGravity = false;
+  gravity[0] = gravity[1] = 0.0f;
+  gravity[2] = 1.0f;
+  lastFixLatitude = 0.0f;
+  lastFixLongitude = 0.0f;
+  lastFixMicros = 0;
+  speedMs = 0;
+  speedFromMicros = 0;
+  speedMps = 0.0f;
+  hasSpeed = false;
+  movingMs = 0;
+  hasMoved = false;
+  falling = false;
+  fallStartMs = 0;
+  fallEndMs = 0;
+  hasFall = false;
+  reset();
+}
+
+void CrashConfirmer::reset() {
+  state = CONFIRM_IDLE;
+  reason = REASON_NONE;
+  severity = NO_CRASH;
+  triggerMs = 0;
+  triggerMicros = 0;
+  decisionMs = 0;
+  movingBefore = false;
+  trackedBefore = false;
+  resting = false;
+  restSinceMs = 0;
+  maxTiltDegrees = 0.0f;
+}
+
+void CrashConfirmer::observeFix(const SensorData& raw) {
+  if (!raw.gpsFixMicros || raw.gpsFixMicros == lastFixMicros) return;
+  if (raw.latitude == 0.0f && raw.longitude == 0.0f) return;
+
+  if (lastFixMicros && raw.gpsFixMicros > lastFixMicros) {
+    float interval = (float)(raw.gpsFixMicros - lastFixMicros) / 1000000.0f;
+    if (interval <= CONFIRM_FIX_MAX_AGE_MS / 1000.0f) {
+      float north = (raw.latitude - lastFixLatitude) * METRES_PER_DEGREE;
+      float east = (raw.longitude - lastFixLongitude) * METRES_PER_DEGREE *
+                   cosf(raw.latitude / RADIANS_TO_DEGREES);
+      speedMps = sqrtf(north * north + east * east) / interval;
+      speedMs = raw.timestamp;
+      speedFromMicros = lastFixMicros;
+      hasSpeed = true;
+      if (speedMps >= CONFIRM_MOVING_MPS) {
+        movingMs = raw.timestamp;
+        hasMoved = true;
+      }
+    }
+  }
+  lastFixLatitude = raw.latitude;
+  lastFixLongitude = raw.longitude;
+  lastFixMicros = raw.gpsFixMicros;
+}
+
+float CrashConfirmer::getSpeed(uint32_t nowMs) const {
+  if (!hasSpeed || elapsedMillis(speedMs, nowMs) > CONFIRM_FIX_MAX_AGE_MS) return -1.0f;
+  return speedMps;
+}
+
+// A fall ends at the first reading back above CONFIRM_FREEFALL_G, which is
+// usually the impact itself
+void CrashConfirmer::trackFall(float magnitude, uint32_t nowMs) {
+  if (magnitude < CONFIRM_FREEFALL_G) {
+    if (!falling) {
+      falling = true;
+      fallStartMs = nowMs;
+    }
+    return;
+  }
+  if (falling && elapsedMillis(fallStartMs, nowMs) >= CONFIRM_FREEFALL_MS) {
+    fallEndMs = nowMs;
+    hasFall = true;
+  }
+  falling = false;
+}
+
+void CrashConfirmer::trackGravity(const SensorData& reading, float magnitude) {
+  if (fabsf(magnitude - 1.0f) > GRAVITY_TOLERANCE_G) return;
+  if (fabsf(reading.gyroX) > GRAVITY_MAX_DPS || fabsf(reading.gyroY) > GRAVITY_MAX_DPS) return;
+  float sample[3] = {reading.accelX, reading.accelY, reading.accelZ};
+  for (int axis = 0; axis < 3; axis++) {
+    gravity[axis] = hasGravity ? gravity[axis] + GRAVITY_SMOOTHING * (sample[axis] - gravity[axis])
+                               : sample[axis];
+  }
+  hasGravity = true;
+}
+
+float CrashConfirmer::tiltDegrees(const SensorData& reading) const {
+  float dot = reading.accelX * gravity[0] + reading.accelY * gravity[1] + reading.accelZ * gravity[2];
+  float norms = sqrtf((reading.accelX * reading.accelX + reading.accelY * reading.accelY +
+                       reading.accelZ * reading.accelZ) *
+                      (gravity[0] * gravity[0] + gravity[1] * gravity[1] + gravity[2] * gravity[2]));
+  if (norms <= 0.0f) return 0.0f;
+  float cosine = dot / norms;
+  if (cosine > 1.0f) cosine = 1.0f;
+  if (cosine < -1.0f) cosine = -1.0f;
+  return acosf(cosine) * RADIANS_TO_DEGREES;
+}
+
+ConfirmEvent CrashConfirmer::escalate(int newSeverity, ConfirmReason why, uint32_t nowMs) {
+  state = CONFIRM_CONFIRMED;
+  severity = newSeverity > SEVERE_CRASH ? SEVERE_CRASH : newSeverity;
+  reason = why;
+  decisionMs = nowMs;
+  return CONFIRM_ESCALATE;
+}
+
+ConfirmEvent CrashConfirmer::dismiss(ConfirmReason why, uint32_t nowMs) {
+  state = CONFIRM_IDLE;
+  severity = NO_CRASH;
+  reason = why;
+  decisionMs = nowMs;
+  return CONFIRM_DISMISS;
+}
+
+ConfirmEvent CrashConfirmer::update(const SensorData& reading, int detectedSeverity, uint32_t nowMs) {
+  if (state == CONFIRM_CONFIRMED) return CONFIRM_NONE;
+
+  bool hasImu = sensorSet(reading) & SENSOR_IMU;
+  float magnitude = sqrtf(reading.accelX * reading.accelX + reading.accelY * reading.accelY +
+                          reading.accelZ * reading.accelZ);
+  float speed = getSpeed(nowMs);
+
+  if (state == CONFIRM_IDLE) {
+    if (hasImu) trackFall(magnitude, nowMs);
+    if (detectedSeverity <= NO_CRASH) {
+      if (hasImu) trackGravity(reading, magnitude);
+      return CONFIRM_NONE;
+    }
+
+    triggerMs = nowMs;
+    triggerMicros = reading.sampleMicros ? reading.sampleMicros : (uint64_t)nowMs * 1000;
+    if (hasFall && elapsedMillis(fallEndMs, nowMs) <= CONFIRM_FREEFALL_GAP_MS) {
+      // Knocked off the mount: decided before any pre-warning goes out
+      return dismiss(REASON_DROPPED, nowMs);
+    }
+    state = CONFIRM_PENDING;
+    reason = REASON_NONE;
+    severity = detectedSeverity;
+    // The fixes lag the impact: a vehicle that stopped a moment ago was
+    // still moving when it happened
+    movingBefore = speed < 0.0f || (hasMoved && elapsedMillis(movingMs, nowMs) < CONFIRM_PARKED_MS);
+    trackedBefore = speed >= 0.0f;
+    resting = false;
+    maxTiltDegrees = 0.0f;
+    return CONFIRM_TRIGGER;
+  }
+
+  ConfirmEvent event = CONFIRM_NONE;
+  if (detectedSeverity > severity) {
+    severity = detectedSeverity;
+    event = CONFIRM_UPDATE;
+  }
+
+  // A pair of fixes spanning the impact measures the drive before it
+  if (speedFromMicros < triggerMicros) speed = -1.0f;
+
+  bool quiet = false;
+  if (hasImu) {
+    if (hasGravity && fabsf(magnitude - 1.0f) < TILT_TOLERANCE_G) {
+      float tilt = tiltDegrees(reading);
+      if (tilt > maxTiltDegrees) maxTiltDegrees = tilt;
+    }
+    float rotation = sqrtf(reading.gyroX * reading.gyroX + reading.gyroY * reading.gyroY +
+                           reading.gyroZ * reading.gyroZ);
+    quiet = fabsf(magnitude - 1.0f) < CONFIRM_REST_ACCEL_G && rotation < CONFIRM_REST_GYRO_DPS &&
+            speed < CONFIRM_MOVING_MPS;
+  }
+  if (quiet && !resting) restSinceMs = nowMs;
+  resting = quiet;
+
+  uint32_t elapsed = elapsedMillis(triggerMs, nowMs);
+  bool rested = resting && movingBefore && elapsedMillis(restSinceMs, nowMs) >= CONFIRM_REST_MS;
+  if (elapsed >= CONFIRM_MIN_MS) {
+    if (maxTiltDegrees >= CONFIRM_TILT_DEG) {
+      return escalate(severity + 1, REASON_TILT, nowMs);
+    }
+    if (speed >= CONFIRM_MOVING_MPS) {
+      return severity - 1 >= MODERATE_CRASH ? escalate(severity - 1, REASON_SEVERITY, nowMs)
+                                            : dismiss(REASON_DRIVING, nowMs);
+    }
+    // Stopping is only news for a vehicle that was moving
+    if (rested && (speed >= 0.0f || !trackedBefore)) {
+      return escalate(severity, REASON_REST, nowMs);
+    }
+  }
+  if (elapsed >= CONFIRM_WINDOW_MS) {
+    if (rested) return escalate(severity, REASON_REST, nowMs);
+    return severity - 1 >= MODERATE_CRASH ? escalate(severity - 1, REASON_SEVERITY, nowMs)
+                                          : dismiss(REASON_NO_EVIDENCE, nowMs);
+  }
+  return event;
+}
+
+ConfirmState CrashConfirmer::getState() const {
+  return state;
+}
+
+int CrashConfirmer::getSeverity() const {
+  return severity;
+}
+
+ConfirmReason CrashConfirmer::getReason() const {
+  return reason;
+}
+
+uint32_t CrashConfirmer::getTriggerMs() const {
+  return triggerMs;
+}
+
+uint32_t CrashConfirmer::getDecisionMs() const {
+  return decisionMs;
+}
+
+float CrashConfirmer::getMaxTiltDegrees() const {
+  return maxTiltDegrees;
+}
+
+const char* CrashConfirmer::reasonName(ConfirmReason reason) {
+  switch (reason) {
+    case REASON_REST: return "came to rest";
+    case REASON_TILT: return "tilted";
+    case REASON_SEVERITY: return "severe impact";
+    case REASON_DRIVING: return "driving on";
+    case REASON_DROPPED: return "unit dropped";
+    case REASON_NO_EVIDENCE: return "no evidence";
+    default: return "none";
+  }
+}
@@ -1,73 +1,169 @@
 #include "crash_detector.h"
+#include <limits.h>
 #include <math.h>
 
+// Polynomial fitted by the smoothed jerk: a straight line gives the least
+// squares slope over the window, the most noise rejection per reading
+#define JERK_FIT_ORDER 1
+
+// Most each factor adds to the score
+#define SCORE_ACCEL_MAX 3
+#define SCORE_GYRO_MAX 3
+#define SCORE_JERK_MAX 3
+#define SCORE_VIBRATION_MAX 2
+#define SCORE_PROXIMITY_MAX 1
+#define SCORE_CONSECUTIVE_MAX 2
+
+// Severity cutoffs with every sensor present
+static const int fullCutoffs[3] = {8, 5, 3};
+static const int severities[3] = {SEVERE_CRASH, MODERATE_CRASH, MINOR_CRASH};
+
 CrashDetector::CrashDetector() {
-  sensorHistory = nullptr;
-  historySize = SENSOR_HISTORY_SIZE;
-  currentIndex = 0;
   crashDetected = false;
   crashDetectionTime = 0;
   currentSeverity = NO_CRASH;
-}
-
-CrashDetector::~CrashDetector() {
-  if (sensorHistory) {
-    delete[] sensorHistory;
-  }
+  lastScore = 0;
+  lastSensors = SENSOR_ALL;
+  sinceImuGap = UINT32_MAX;
+  jerkWindow = 2;
+  memset(&spectrum, 0, sizeof(spectrum));
+  designCutoffs();
 }
 
 void CrashDetector::begin(const CrashDetectionConfig& detectorConfig) {
   config = detectorConfig;
   
-  // Allocate memory for sensor history
-  if (sensorHistory) {
-    delete[] sensorHistory;
-  }
-  sensorHistory = new SensorData[historySize];
-  
-  // Initialize history with zero values
-  for (int i = 0; i < historySize; i++) {
-    memset(&sensorHistory[i], 0, sizeof(SensorData));
-  }
+  // Start from an empty (all zero) history
+  history.clear();
   
-  currentIndex = 0;
   crashDetected = false;
   crashDetectionTime = 0;
   currentSeverity = NO_CRASH;
+  lastScore = 0;
+  lastSensors = SENSOR_ALL;
+  sinceImuGap = UINT32_MAX;
+  memset(&spectrum, 0, sizeof(spectrum));
+  designJerk();
   
-  Serial.println("CrashDetector: Initialized with configuration:");
-  Serial.printf("  Accel Threshold: %.2f g\n", config.accelThreshold);
-  Serial.printf("  Gyro Threshold: %.2f °/s\n", config.gyroThreshold);
-  Serial.printf("  Jerk Threshold: %.2f\n", config.jerkThreshold);
-  Serial.printf("  Recovery Time: %.0f ms\n", config.recoveryTime);
+  // The thresholds are on the console ("get"), not formatted here
+  Serial.println("CrashDetector: Initialized");
+}
+
+void CrashDetector::designJerk() {
+  jerkWindow = 2;
+  if (config.jerkWindow <= 2) return;
+  
+  int window = min(config.jerkWindow, FILTER_MAX_TAPS);
+  if (!savitzkyGolayDerivative(window, JERK_FIT_ORDER, jerkWeights)) {
+    Serial.printf("CrashDetector: Jerk window %d unusable, using 2\n", config.jerkWindow);
+    return;
+  }
+  jerkWindow = window;
+}
+
+int CrashDetector::maxScore(uint8_t sensors) {
+  int score = 0;
+  if (sensors & SENSOR_IMU) {
+    score += SCORE_ACCEL_MAX + SCORE_GYRO_MAX + SCORE_JERK_MAX + SCORE_CONSECUTIVE_MAX;
+  }
+  if (sensors & SENSOR_VIBRATION) score += SCORE_VIBRATION_MAX;
+  if (sensors & SENSOR_ULTRASONIC) score += SCORE_PROXIMITY_MAX;
+  return score;
+}
+
+void CrashDetector::designCutoffs() {
+  int fullScore = maxScore(SENSOR_ALL);
+  for (int sensors = 0; sensors <= SENSOR_ALL; sensors++) {
+    int available = maxScore(sensors);
+    for (int level = 0; level < 3; level++) {
+      // Distance and a vibration switch alone cannot tell an impact from a
+      // pothole: without the IMU no cutoff is reachable
+      severityCutoffs[sensors][level] = (sensors & SENSOR_IMU)
+          ? (fullCutoffs[level] * available + fullScore - 1) / fullScore
+          : INT_MAX;
+    }
+  }
 }
 
 float CrashDetector::calculateMagnitude(float x, float y, float z) {
   return sqrt(x*x + y*y + z*z);
 }
 
-float CrashDetector::calculateJerk(const SensorData& current, const SensorData& previous) {
-  float deltaAccelX = current.accelX - previous.accelX;
-  float deltaAccelY = current.accelY - previous.accelY;
-  float deltaAccelZ = current.accelZ - previous.accelZ;
-  float deltaTime = (current.timestamp - previous.timestamp) / 1000.0; // Convert to seconds
+float CrashDetector::calculateJerk(const SensorData& current, uint32_t previousIndex) {
+  float deltaAccelX = current.accelX - history.accelX()[previousIndex];
+  float deltaAccelY = current.accelY - history.accelY()[previousIndex];
+  float deltaAccelZ = current.accelZ - history.accelZ()[previousIndex];
+  uint64_t previousMicros = history.sampleMicros()[previousIndex];
+  // Seconds between the IMU samples; readings without data-ready times
+  // (replays, tests) fall back to the millisecond timestamps
+  float deltaTime;
+  if (current.sampleMicros && previousMicros) {
+    deltaTime = (int64_t)(current.sampleMicros - previousMicros) / 1000000.0;
+  } else {
+    deltaTime = elapsedMillis(history.timestamp()[previousIndex], current.timestamp) / 1000.0;
+  }
   
   if (deltaTime <= 0) return 0;
   
   return calculateMagnitude(deltaAccelX, deltaAccelY, deltaAccelZ) / deltaTime;
 }
 
+// 1 when the current reading is already the newest history entry, as in
+// the main loop, which stores a sample before scoring it; the jerk terms
+// then compare against the entries behind it rather than the sample itself
+uint32_t CrashDetector::currentInHistory(const SensorData& current) {
+  uint32_t newest = history.slot(1);
+  return (history.size() > 0 &&
+          history.timestamp()[newest] == current.timestamp &&
+          history.sampleMicros()[newest] == current.sampleMicros) ? 1 : 0;
+}
+
+// Slope of a line fitted to the current reading and the jerkWindow - 1
+// before it
+bool CrashDetector::calculateSmoothedJerk(const SensorData& current, float& jerk) {
+  uint32_t skip = currentInHistory(current);
+  if (history.size() < (uint32_t)jerkWindow - 1 + skip) return false;
+  
+  // Mean step across the window
+  uint32_t oldest = history.slot(jerkWindow - 1 + skip);
+  uint64_t oldestMicros = history.sampleMicros()[oldest];
+  float span;
+  if (current.sampleMicros && oldestMicros) {
+    span = (int64_t)(current.sampleMicros - oldestMicros) / 1000000.0;
+  } else {
+    span = elapsedMillis(history.timestamp()[oldest], current.timestamp) / 1000.0;
+  }
+  float step = span / (jerkWindow - 1);
+  if (step <= 0) return false;
+  
+  const float* accelX = history.accelX();
+  const float* accelY = history.accelY();
+  const float* accelZ = history.accelZ();
+  float slopeX = jerkWeights[0] * current.accelX;
+  float slopeY = jerkWeights[0] * current.accelY;
+  float slopeZ = jerkWeights[0] * current.accelZ;
+  for (int i = 1; i < jerkWindow; i++) {
+    uint32_t idx = history.slot(i + skip);
+    slopeX += jerkWeights[i] * accelX[idx];
+    slopeY += jerkWeights[i] * accelY[idx];
+    slopeZ += jerkWeights[i] * accelZ[idx];
+  }
+  
+  jerk = calculateMagnitude(slopeX, slopeY, slopeZ) / step;
+  return true;
+}
+
 int CrashDetector::calculateConsecutiveHighReadings() {
   int consecutiveCount = 0;
-  int maxConsecutive = min(config.consecutiveReadings, historySize);
+  int maxConsecutive = min(config.consecutiveReadings, (int)DetectorHistory::DEPTH);
+  const float* accelX = history.accelX();
+  const float* accelY = history.accelY();
+  const float* accelZ = history.accelZ();
   
   for (int i = 0; i < maxConsecutive; i++) {
-    int idx = (currentIndex - i - 1 + historySize) % historySize;
-    if (idx < 0) break;
+    uint32_t idx = history.slot(i + 1);
     
-    float magnitude = calculateMagnitude(sensorHistory[idx].accelX, 
-                                       sensorHistory[idx].accelY, 
-                                       sensorHistory[idx].accelZ);
+    float magnitude = calculateMagnitude(accelX[idx], accelY[idx], accelZ[idx]);
     
     if (magnitude > config.accelThreshold * 0.7) {
       consecutiveCount++;
@@ -79,14 +175,16 @@ int CrashDetector::calculateConsecutiveHighReadings() {
   return consecutiveCount;
 }
 
-int CrashDetector::calculateCrashScore(const SensorData& currentReading) {
+// sensors: in, the set behind the reading; out, the set the score drew on
+int CrashDetector::calculateCrashScore(const SensorData& currentReading, uint8_t& sensors) {
   int crashScore = 0;
+  bool haveImu = sensors & SENSOR_IMU;
   
   // Factor 1: High acceleration (impact detection)
   float accelMagnitude = calculateMagnitude(currentReading.accelX, 
                                           currentReading.accelY, 
                                           currentReading.accelZ);
-  if (accelMagnitude > config.accelThreshold) {
+  if (haveImu && accelMagnitude > config.accelThreshold) {
     crashScore += (accelMagnitude > config.severeAccelThreshold) ? 3 : 2;
   }
   
@@ -94,33 +192,54 @@ int CrashDetector::calculateCrashScore(const SensorData& currentReading) {
   float gyroMagnitude = calculateMagnitude(currentReading.gyroX, 
                                          currentReading.gyroY, 
                                          currentReading.gyroZ);
-  if (gyroMagnitude > config.gyroThreshold) {
+  if (haveImu && gyroMagnitude > config.gyroThreshold) {
     crashScore += (gyroMagnitude > config.severeGyroThreshold) ? 3 : 2;
   }
   
-  // Factor 3: High jerk (sudden change in acceleration)
-  if (currentIndex > 0) {
-    int prevIndex = (currentIndex - 1 + historySize) % historySize;
-    float jerk = calculateJerk(currentReading, sensorHistory[prevIndex]);
-    
-    if (jerk > config.jerkThreshold) {
-      crashScore += (jerk > config.severeJerkThreshold) ? 3 : 2;
+  // Factor 3: High jerk (sudden change in acceleration). Not across a
+  // reading without the IMU: its zeros would look like a jolt.
+  bool haveJerk = false;
+  float jerk = 0;
+  bool jerkUsable = haveImu && sinceImuGap >= (uint32_t)jerkWindow;
+  if (jerkUsable && jerkWindow > 2) {
+    haveJerk = calculateSmoothedJerk(currentReading, jerk);
+  } else if (jerkUsable) {
+    uint32_t skip = currentInHistory(currentReading);
+    if (history.size() >= 1 + skip) {
+      jerk = calculateJerk(currentReading, history.slot(1 + skip));
+      haveJerk = true;
     }
   }
+  if (haveJerk && jerk > config.jerkThreshold) {
+    crashScore += (jerk > config.severeJerkThreshold) ? 3 : 2;
+  }
   
-  // Factor 4: Vibration sensor triggered
-  if (currentReading.vibration == HIGH) {
+  // Factor 4: Vibration sensor triggered. With a spectrum, periodic
+  // engine/road vibration (tonal) is told apart from an impact (broadband),
+  // and a broadband burst stands in for the switch when it is missing
+  bool vibrating = (sensors & SENSOR_VIBRATION) && currentReading.vibration == HIGH;
+  if (haveImu && spectrum.valid) {
+    if (config.impactEnergy > 0) sensors |= SENSOR_VIBRATION;
+    bool broadband = spectrum.flatness >= config.vibrationFlatness;
+    if (config.vibrationFlatness > 0 && !broadband) {
+      vibrating = false;
+    }
+    if (config.impactEnergy > 0 && broadband && spectrum.energy > config.impactEnergy) {
+      vibrating = true;
+    }
+  }
+  if (vibrating) {
     crashScore += 2;
   }
   
   // Factor 5: Proximity sensor (obstacle detection)
-  if (currentReading.distance < config.proximityThreshold && currentReading.distance > 0) {
+  if ((sensors & SENSOR_ULTRASONIC) &&
+      currentReading.distance < config.proximityThreshold && currentReading.distance > 0) {
     crashScore += 1;
   }
   
   // Factor 6: Check for consecutive high readings
-  int consecutiveHighReadings = calculateConsecutiveHighReadings();
-  if (consecutiveHighReadings >= config.consecutiveReadings) {
+  if (haveImu && calculateConsecutiveHighReadings() >= config.consecutiveReadings) {
     crashScore += 2;
   }
   
@@ -128,34 +247,43 @@ int CrashDetector::calculateCrashScore(const SensorData& currentReading) {
 }
 
 int CrashDetector::detectCrash(const SensorData& currentReading) {
-  int crashScore = calculateCrashScore(currentReading);
+  uint8_t sensors = sensorSet(currentReading);
+  int crashScore = calculateCrashScore(currentReading, sensors);
   int detectedSeverity = NO_CRASH;
+  lastScore = crashScore;
+  lastSensors = sensors;
   
-  // Determine crash severity based on score
-  if (crashScore >= 8) {
-    detectedSeverity = SEVERE_CRASH;
-  } else if (crashScore >= 5) {
-    detectedSeverity = MODERATE_CRASH;
-  } else if (crashScore >= 3) {
-    detectedSeverity = MINOR_CRASH;
+  // Determine crash severity based on score, against cutoffs scaled to
+  // what the available sensors can reach
+  const int* cutoffs = severityCutoffs[sensors];
+  for (int level = 0; level < 3; level++) {
+    if (crashScore >= cutoffs[level]) {
+      detectedSeverity = severities[level];
+      break;
+    }
   }
   
   // Update crash detection state
   if (detectedSeverity > NO_CRASH && !crashDetected) {
     crashDetected = true;
-    crashDetectionTime = millis();
+    crashDetectionTime = Clock::millis();
     currentSeverity = detectedSeverity;
-    
-    Serial.printf("CrashDetector: Crash detected with score %d, severity %d\n", 
-                  crashScore, detectedSeverity);
   }
   
   return detectedSeverity;
 }
 
 void CrashDetector::addToHistory(const SensorData& data) {
-  sensorHistory[currentIndex] = data;
-  currentIndex = (currentIndex + 1) % historySize;
+  history.push(data);
+  if (data.missing & SENSOR_IMU) {
+    sinceImuGap = 0;
+  } else if (sinceImuGap < UINT32_MAX) {
+    sinceImuGap++;
+  }
+}
+
+void CrashDetector::setSpectralFeatures(const SpectralFeatures& features) {
+  spectrum = features;
 }
 
 bool CrashDetector::isCrashDetected() const {
@@ -166,6 +294,20 @@ int CrashDetector::getCrashSeverity() const {
   return currentSeverity;
 }
 
+int CrashDetector::getLastScore() const {
+  return lastScore;
+}
+
+uint8_t CrashDetector::getLastSensorSet() const {
+  return lastSensors;
+}
+
+void CrashDetector::confirmCrash(int severity) {
+  crashDetected = true;
+  crashDetectionTime = Clock::millis();
+  currentSeverity = severity;
+}
+
 void CrashDetector::resetCrashDetection() {
   crashDetected = false;
   crashDetectionTime = 0;
@@ -177,7 +319,7 @@ void CrashDetector::resetCrashDetection() {
 bool CrashDetector::shouldAutoReset() {
   if (!crashDetected) return false;
   
-  unsigned long timeSinceCrash = millis() - crashDetectionTime;
+  uint32_t timeSinceCrash = elapsedMillis(crashDetectionTime, Clock::millis());
   
   // Auto-reset only for minor crashes after recovery time
   return (currentSeverity == MINOR_CRASH && timeSinceCrash > config.recoveryTime);
@@ -185,6 +327,7 @@ bool CrashDetector::shouldAutoReset() {
 
 void CrashDetector::updateConfig(const CrashDetectionConfig& newConfig) {
   config = newConfig;
+  designJerk();
   Serial.println("CrashDetector: Configuration updated");
 }
 
@@ -192,10 +335,10 @@ CrashDetectionConfig CrashDetector::getConfig() const {
   return config;
 }
 
-SensorData* CrashDetector::getHistory() const {
-  return sensorHistory;
+const DetectorHistory& CrashDetector::getHistory() const {
+  return history;
 }
 
 int CrashDetector::getHistoryIndex() const {
-  return currentIndex;
+  return history.head();
 }
\ No newline at end of file
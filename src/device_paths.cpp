@@ -0,0 +1,74 @@
+#include "device_paths.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char* const RELATIVE_PATHS[DEVICE_PATH_COUNT] = {
+  FirebasePaths::SENSORS,
+  FirebasePaths::ACCEL_X,
+  FirebasePaths::ACCEL_Y,
+  FirebasePaths::ACCEL_Z,
+  FirebasePaths::GYRO_X,
+  FirebasePaths::GYRO_Y,
+  FirebasePaths::GYRO_Z,
+  FirebasePaths::DISTANCE,
+  FirebasePaths::VIBRATION,
+  FirebasePaths::LATITUDE,
+  FirebasePaths::LONGITUDE,
+  FirebasePaths::CRASH_SEVERITY,
+  FirebasePaths::CRASH_DETECTED,
+  FirebasePaths::TIMESTAMP,
+  FirebasePaths::TEST,
+  FirebasePaths::CRASH_STATUS,
+  FirebasePaths::EMERGENCY_ACTIVE
+};
+
+DevicePaths::DevicePaths() {
+  deviceId[0] = '\0';
+  memset(paths, 0, sizeof(paths));
+}
+
+void DevicePaths::begin(uint64_t efuseMac) {
+  char id[DEVICE_ID_SIZE];
+  formatDeviceId(id, sizeof(id), efuseMac);
+  begin(id);
+}
+
+void DevicePaths::begin(const char* id) {
+  snprintf(deviceId, sizeof(deviceId), "%s", id);
+  
+  for (int i = 0; i < DEVICE_PATH_COUNT; i++) {
+    snprintf(paths[i], DEVICE_PATH_SIZE, "%s%s/%s",
+             FB_DEVICES_ROOT, deviceId, RELATIVE_PATHS[i]);
+  }
+}
+
+const char* DevicePaths::getDeviceId() const {
+  return deviceId;
+}
+
+const char* DevicePaths::get(DevicePath path) const {
+  if (path < 0 || path >= DEVICE_PATH_COUNT) return "";
+  return paths[path];
+}
+
+size_t DevicePaths::formatEmergencyPath(char* buffer, size_t bufferSize,
+                                        unsigned long timestamp) const {
+  int written = snprintf(buffer, bufferSize, "%s%s/%s%lu",
+                         FB_DEVICES_ROOT, deviceId, FB_EMERGENCY_PATH, timestamp);
+  if (written < 0 || bufferSize == 0) return 0;
+  return ((size_t)written >= bufferSize) ? bufferSize - 1 : (size_t)written;
+}
+
+size_t DevicePaths::formatDeviceId(char* buffer, size_t bufferSize, uint64_t efuseMac) {
+  // The eFuse MAC is stored little-endian: the first octet is the low byte
+  int written = snprintf(buffer, bufferSize, "%s%02x%02x%02x%02x%02x%02x",
+                         DEVICE_ID_PREFIX,
+                         (unsigned)(efuseMac & 0xFF),
+                         (unsigned)((efuseMac >> 8) & 0xFF),
+                         (unsigned)((efuseMac >> 16) & 0xFF),
+                         (unsigned)((efuseMac >> 24) & 0xFF),
+                         (unsigned)((efuseMac >> 32) & 0xFF),
+                         (unsigned)((efuseMac >> 40) & 0xFF));
+  if (written < 0 || bufferSize == 0) return 0;
+  return ((size_t)written >= bufferSize) ? bufferSize - 1 : (size_t)written;
+}
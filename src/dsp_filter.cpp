@@ -0,0 +1,236 @@
+#include "dsp_filter.h"
+#include <math.h>
+#include <string.h>
+
+#define DSP_PI 3.14159265358979323846
+
+// RBJ cookbook sections share the denominator; numerators differ
+static BiquadCoefficients normalise(double b0, double b1, double b2,
+                                    double a0, double a1, double a2) {
+  BiquadCoefficients c;
+  c.b0 = (float)(b0 / a0);
+  c.b1 = (float)(b1 / a0);
+  c.b2 = (float)(b2 / a0);
+  c.a1 = (float)(a1 / a0);
+  c.a2 = (float)(a2 / a0);
+  return c;
+}
+
+BiquadCoefficients designLowPass(float cutoffHz, float sampleRateHz, float q) {
+  double w0 = 2.0 * DSP_PI * cutoffHz / sampleRateHz;
+  double cosW0 = cos(w0);
+  double alpha = sin(w0) / (2.0 * q);
+  return normalise((1.0 - cosW0) / 2.0, 1.0 - cosW0, (1.0 - cosW0) / 2.0,
+                   1.0 + alpha, -2.0 * cosW0, 1.0 - alpha);
+}
+
+BiquadCoefficients designHighPass(float cutoffHz, float sampleRateHz, float q) {
+  double w0 = 2.0 * DSP_PI * cutoffHz / sampleRateHz;
+  double cosW0 = cos(w0);
+  double alpha = sin(w0) / (2.0 * q);
+  return normalise((1.0 + cosW0) / 2.0, -(1.0 + cosW0), (1.0 + cosW0) / 2.0,
+                   1.0 + alpha, -2.0 * cosW0, 1.0 - alpha);
+}
+
+BiquadCoefficients designNotch(float centreHz, float sampleRateHz, float q) {
+  double w0 = 2.0 * DSP_PI * centreHz / sampleRateHz;
+  double cosW0 = cos(w0);
+  double alpha = sin(w0) / (2.0 * q);
+  return normalise(1.0, -2.0 * cosW0, 1.0, 1.0 + alpha, -2.0 * cosW0, 1.0 - alpha);
+}
+
+float butterworthQ(int order, int index) {
+  return (float)(1.0 / (2.0 * cos(DSP_PI * (2 * index + 1) / (2.0 * order))));
+}
+
+// Output of a section held at a constant input
+static double dcGain(const BiquadCoefficients& c) {
+  double denominator = 1.0 + c.a1 + c.a2;
+  if (fabs(denominator) < 1e-12) return 0.0;
+  return (c.b0 + c.b1 + c.b2) / denominator;
+}
+
+BiquadCascade::BiquadCascade() {
+  clear();
+}
+
+void BiquadCascade::clear() {
+  memset(sections, 0, sizeof(sections));
+  memset(state, 0, sizeof(state));
+  count = 0;
+}
+
+bool BiquadCascade::add(const BiquadCoefficients& section) {
+  if (count >= FILTER_MAX_BIQUADS) return false;
+  sections[count] = section;
+  state[count][0] = state[count][1] = 0.0f;
+  count++;
+  return true;
+}
+
+int BiquadCascade::size() const {
+  return count;
+}
+
+void BiquadCascade::reset(float value) {
+  float x = value;
+  for (int i = 0; i < count; i++) {
+    const BiquadCoefficients& c = sections[i];
+    float y = (float)(dcGain(c) * x);
+    state[i][0] = y - c.b0 * x;
+    state[i][1] = c.b2 * x - c.a2 * y;
+    x = y;
+  }
+}
+
+float BiquadCascade::magnitudeAt(float frequencyHz, float sampleRateHz) const {
+  double w = 2.0 * DSP_PI * frequencyHz / sampleRateHz;
+  double cos1 = cos(w), sin1 = sin(w);
+  double cos2 = cos(2.0 * w), sin2 = sin(2.0 * w);
+  double magnitude = 1.0;
+  for (int i = 0; i < count; i++) {
+    const BiquadCoefficients& c = sections[i];
+    // e^{-jw} terms: real parts add cosines, imaginary parts subtract sines
+    double numReal = c.b0 + c.b1 * cos1 + c.b2 * cos2;
+    double numImag = -(c.b1 * sin1 + c.b2 * sin2);
+    double denReal = 1.0 + c.a1 * cos1 + c.a2 * cos2;
+    double denImag = -(c.a1 * sin1 + c.a2 * sin2);
+    magnitude *= sqrt((numReal * numReal + numImag * numImag) /
+                      (denReal * denReal + denImag * denImag));
+  }
+  return (float)magnitude;
+}
+
+static int32_t toFixed(float value) {
+  double scaled = floor((double)value * (1 << BiquadCascadeFixed::FRACTION_BITS) + 0.5);
+  if (scaled > INT32_MAX) return INT32_MAX;
+  if (scaled < INT32_MIN) return INT32_MIN;
+  return (int32_t)scaled;
+}
+
+BiquadCascadeFixed::BiquadCascadeFixed() {
+  clear();
+}
+
+void BiquadCascadeFixed::clear() {
+  memset(coefficients, 0, sizeof(coefficients));
+  memset(state, 0, sizeof(state));
+  count = 0;
+}
+
+bool BiquadCascadeFixed::add(const BiquadCoefficients& section) {
+  if (count >= FILTER_MAX_BIQUADS) return false;
+  coefficients[count][0] = toFixed(section.b0);
+  coefficients[count][1] = toFixed(section.b1);
+  coefficients[count][2] = toFixed(section.b2);
+  coefficients[count][3] = toFixed(section.a1);
+  coefficients[count][4] = toFixed(section.a2);
+  memset(state[count], 0, sizeof(state[count]));
+  count++;
+  return true;
+}
+
+int BiquadCascadeFixed::size() const {
+  return count;
+}
+
+void BiquadCascadeFixed::reset(int32_t value) {
+  int32_t x = value;
+  for (int i = 0; i < count; i++) {
+    const int32_t* c = coefficients[i];
+    double scale = (double)(1 << FRACTION_BITS);
+    double denominator = 1.0 + (c[3] + (double)c[4]) / scale;
+    double gain = fabs(denominator) < 1e-12 ? 0.0 :
+                  ((c[0] + (double)c[1] + c[2]) / scale) / denominator;
+    int32_t y = (int32_t)floor(gain * x + 0.5);
+    state[i][0] = state[i][1] = x;
+    state[i][2] = state[i][3] = y;
+    x = y;
+  }
+}
+
+FirFilter::FirFilter() {
+  memset(taps, 0, sizeof(taps));
+  memset(history, 0, sizeof(history));
+  length = 0;
+  newest = 0;
+}
+
+bool FirFilter::setTaps(const float* coefficients, int count) {
+  if (count < 1 || count > FILTER_MAX_TAPS) return false;
+  memcpy(taps, coefficients, count * sizeof(float));
+  length = count;
+  reset();
+  return true;
+}
+
+int FirFilter::size() const {
+  return length;
+}
+
+void FirFilter::reset(float value) {
+  for (int i = 0; i < FILTER_MAX_TAPS; i++) history[i] = value;
+  newest = 0;
+}
+
+float FirFilter::process(float x) {
+  if (length == 0) return x;
+  newest = (newest + 1 == length) ? 0 : newest + 1;
+  history[newest] = x;
+
+  // Newest back to the wrap, then the rest
+  float y = 0.0f;
+  int tap = 0;
+  for (int i = newest; i >= 0; i--) y += taps[tap++] * history[i];
+  for (int i = length - 1; i > newest; i--) y += taps[tap++] * history[i];
+  return y;
+}
+
+bool savitzkyGolayDerivative(int window, int order, float* coefficients) {
+  if (order < 1 || order > 3 || window <= order || window > FILTER_MAX_TAPS) return false;
+
+  // Least squares over samples at t = 0, -1, ..., -(window - 1): the
+  // derivative at t = 0 is the fitted t^1 coefficient, i.e. row 1 of
+  // (A^T A)^-1 A^T with A[i][j] = (-i)^j
+  const int n = order + 1;
+  double normal[4][5];
+  for (int r = 0; r < n; r++) {
+    for (int c = 0; c < n; c++) {
+      double sum = 0.0;
+      for (int i = 0; i < window; i++) sum += pow(-(double)i, r + c);
+      normal[r][c] = sum;
+    }
+    normal[r][n] = (r == 1) ? 1.0 : 0.0;
+  }
+
+  // Gauss-Jordan with partial pivoting; the system is tiny and well posed
+  for (int col = 0; col < n; col++) {
+    int pivot = col;
+    for (int r = col + 1; r < n; r++) {
+      if (fabs(normal[r][col]) > fabs(normal[pivot][col])) pivot = r;
+    }
+    if (fabs(normal[pivot][col]) < 1e-12) return false;
+    if (pivot != col) {
+      for (int c = 0; c <= n; c++) {
+        double swap = normal[col][c];
+        normal[col][c] = normal[pivot][c];
+        normal[pivot][c] = swap;
+      }
+    }
+    for (int r = 0; r < n; r++) {
+      if (r == col) continue;
+      double factor = normal[r][col] / normal[col][col];
+      for (int c = col; c <= n; c++) normal[r][c] -= factor * normal[col][c];
+    }
+  }
+
+  // normal[j][n] / normal[j][j] is row 1 of the inverse (it is symmetric)
+  for (int i = 0; i < window; i++) {
+    double weight = 0.0;
+    for (int j = 0; j < n; j++) {
+      weight += normal[j][n] / normal[j][j] * pow(-(double)i, j);
+    }
+    coefficients[i] = (float)weight;
+  }
+  return true;
+}
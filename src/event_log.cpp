@@ -0,0 +1,476 @@
+#include "event_log.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SEGMENT_MAGIC 0x47534C45UL   // "ELSG"
+#define FOOTER_MAGIC 0x46534C45UL    // "ELSF"
+#define SLOT_CHUNK 8                 // slots per flash read while scanning
+
+static_assert(sizeof(EventRecord) == EVENT_RECORD_SIZE, "EventRecord must fill one slot");
+
+struct SegmentHeader {
+  uint32_t magic;
+  uint32_t sequence;
+  uint32_t firstRecord;
+  uint32_t crc;
+};
+
+struct SegmentFooter {
+  uint32_t magic;
+  EventSegmentSummary summary;
+  uint32_t crc;
+};
+
+static_assert(sizeof(SegmentFooter) <= EVENT_RECORD_SIZE, "footer must fit one slot");
+
+// CRC-32 (IEEE), a byte at a time
+static uint32_t crc32(const void* data, size_t length) {
+  static const uint32_t table[256] = {
+    0x00000000, 0x77073096, 0xEE0E612C, 0x990951BA, 0x076DC419, 0x706AF48F,
+    0xE963A535, 0x9E6495A3, 0x0EDB8832, 0x79DCB8A4, 0xE0D5E91E, 0x97D2D988,
+    0x09B64C2B, 0x7EB17CBD, 0xE7B82D07, 0x90BF1D91, 0x1DB71064, 0x6AB020F2,
+    0xF3B97148, 0x84BE41DE, 0x1ADAD47D, 0x6DDDE4EB, 0xF4D4B551, 0x83D385C7,
+    0x136C9856, 0x646BA8C0, 0xFD62F97A, 0x8A65C9EC, 0x14015C4F, 0x63066CD9,
+    0xFA0F3D63, 0x8D080DF5, 0x3B6E20C8, 0x4C69105E, 0xD56041E4, 0xA2677172,
+    0x3C03E4D1, 0x4B04D447, 0xD20D85FD, 0xA50AB56B, 0x35B5A8FA, 0x42B2986C,
+    0xDBBBC9D6, 0xACBCF940, 0x32D86CE3, 0x45DF5C75, 0xDCD60DCF, 0xABD13D59,
+    0x26D930AC, 0x51DE003A, 0xC8D75180, 0xBFD06116, 0x21B4F4B5, 0x56B3C423,
+    0xCFBA9599, 0xB8BDA50F, 0x2802B89E, 0x5F058808, 0xC60CD9B2, 0xB10BE924,
+    0x2F6F7C87, 0x58684C11, 0xC1611DAB, 0xB6662D3D, 0x76DC4190, 0x01DB7106,
+    0x98D220BC, 0xEFD5102A, 0x71B18589, 0x06B6B51F, 0x9FBFE4A5, 0xE8B8D433,
+    0x7807C9A2, 0x0F00F934, 0x9609A88E, 0xE10E9818, 0x7F6A0DBB, 0x086D3D2D,
+    0x91646C97, 0xE6635C01, 0x6B6B51F4, 0x1C6C6162, 0x856530D8, 0xF262004E,
+    0x6C0695ED, 0x1B01A57B, 0x8208F4C1, 0xF50FC457, 0x65B0D9C6, 0x12B7E950,
+    0x8BBEB8EA, 0xFCB9887C, 0x62DD1DDF, 0x15DA2D49, 0x8CD37CF3, 0xFBD44C65,
+    0x4DB26158, 0x3AB551CE, 0xA3BC0074, 0xD4BB30E2, 0x4ADFA541, 0x3DD895D7,
+    0xA4D1C46D, 0xD3D6F4FB, 0x4369E96A, 0x346ED9FC, 0xAD678846, 0xDA60B8D0,
+    0x44042D73, 0x33031DE5, 0xAA0A4C5F, 0xDD0D7CC9, 0x5005713C, 0x270241AA,
+    0xBE0B1010, 0xC90C2086, 0x5768B525, 0x206F85B3, 0xB966D409, 0xCE61E49F,
+    0x5EDEF90E, 0x29D9C998, 0xB0D09822, 0xC7D7A8B4, 0x59B33D17, 0x2EB40D81,
+    0xB7BD5C3B, 0xC0BA6CAD, 0xEDB88320, 0x9ABFB3B6, 0x03B6E20C, 0x74B1D29A,
+    0xEAD54739, 0x9DD277AF, 0x04DB2615, 0x73DC1683, 0xE3630B12, 0x94643B84,
+    0x0D6D6A3E, 0x7A6A5AA8, 0xE40ECF0B, 0x9309FF9D, 0x0A00AE27, 0x7D079EB1,
+    0xF00F9344, 0x8708A3D2, 0x1E01F268, 0x6906C2FE, 0xF762575D, 0x806567CB,
+    0x196C3671, 0x6E6B06E7, 0xFED41B76, 0x89D32BE0, 0x10DA7A5A, 0x67DD4ACC,
+    0xF9B9DF6F, 0x8EBEEFF9, 0x17B7BE43, 0x60B08ED5, 0xD6D6A3E8, 0xA1D1937E,
+    0x38D8C2C4, 0x4FDFF252, 0xD1BB67F1, 0xA6BC5767, 0x3FB506DD, 0x48B2364B,
+    0xD80D2BDA, 0xAF0A1B4C, 0x36034AF6, 0x41047A60, 0xDF60EFC3, 0xA867DF55,
+    0x316E8EEF, 0x4669BE79, 0xCB61B38C, 0xBC66831A, 0x256FD2A0, 0x5268E236,
+    0xCC0C7795, 0xBB0B4703, 0x220216B9, 0x5505262F, 0xC5BA3BBE, 0xB2BD0B28,
+    0x2BB45A92, 0x5CB36A04, 0xC2D7FFA7, 0xB5D0CF31, 0x2CD99E8B, 0x5BDEAE1D,
+    0x9B64C2B0, 0xEC63F226, 0x756AA39C, 0x026D930A, 0x9C0906A9, 0xEB0E363F,
+    0x72076785, 0x05005713, 0x95BF4A82, 0xE2B87A14, 0x7BB12BAE, 0x0CB61B38,
+    0x92D28E9B, 0xE5D5BE0D, 0x7CDCEFB7, 0x0BDBDF21, 0x86D3D2D4, 0xF1D4E242,
+    0x68DDB3F8, 0x1FDA836E, 0x81BE16CD, 0xF6B9265B, 0x6FB077E1, 0x18B74777,
+    0x88085AE6, 0xFF0F6A70, 0x66063BCA, 0x11010B5C, 0x8F659EFF, 0xF862AE69,
+    0x616BFFD3, 0x166CCF45, 0xA00AE278, 0xD70DD2EE, 0x4E048354, 0x3903B3C2,
+    0xA7672661, 0xD06016F7, 0x4969474D, 0x3E6E77DB, 0xAED16A4A, 0xD9D65ADC,
+    0x40DF0B66, 0x37D83BF0, 0xA9BCAE53, 0xDEBB9EC5, 0x47B2CF7F, 0x30B5FFE9,
+    0xBDBDF21C, 0xCABAC28A, 0x53B39330, 0x24B4A3A6, 0xBAD03605, 0xCDD70693,
+    0x54DE5729, 0x23D967BF, 0xB3667A2E, 0xC4614AB8, 0x5D681B02, 0x2A6F2B94,
+    0xB40BBE37, 0xC30C8EA1, 0x5A05DF1B, 0x2D02EF8D
+  };
+  const uint8_t* bytes = (const uint8_t*)data;
+  uint32_t crc = 0xFFFFFFFF;
+  for (size_t i = 0; i < length; i++) {
+    crc = (crc >> 8) ^ table[(crc ^ bytes[i]) & 0xFF];
+  }
+  return ~crc;
+}
+
+static bool isErased(const void* data, size_t length) {
+  const uint8_t* bytes = (const uint8_t*)data;
+  for (size_t i = 0; i < length; i++) {
+    if (bytes[i] != 0xFF) return false;
+  }
+  return true;
+}
+
+bool isValidEventRecord(const EventRecord& record) {
+  return record.crc == crc32(&record, offsetof(EventRecord, crc));
+}
+
+static void clearSummary(EventSegmentSummary& summary, uint16_t sector) {
+  memset(&summary, 0, sizeof(summary));
+  summary.minUtc = UINT32_MAX;
+  summary.sector = sector;
+}
+
+EventLog::EventLog() {
+  flash = nullptr;
+  segmentCount = 0;
+  recordsPerSegment = 0;
+  activeSector = -1;
+  nextSegment = 1;
+  nextRecord = 0;
+  prunedSegments = 0;
+  lastQueryReads = 0;
+  for (uint32_t sector = 0; sector < EVENT_LOG_MAX_SEGMENTS; sector++) {
+    clearSummary(directory[sector], sector);
+  }
+}
+
+uint32_t EventLog::slotOffset(uint32_t sector, uint32_t slot) const {
+  return sector * flash->sectorSize() + slot * EVENT_RECORD_SIZE;
+}
+
+bool EventLog::begin(FlashRegion* region, uint32_t budgetBytes) {
+  flash = region;
+  uint32_t sectorSize = flash->sectorSize();
+  if (sectorSize < 4 * EVENT_RECORD_SIZE || sectorSize > 66 * EVENT_RECORD_SIZE ||
+      sectorSize % EVENT_RECORD_SIZE) {
+    return false;
+  }
+  uint32_t bytes = budgetBytes < flash->size() ? budgetBytes : flash->size();
+  segmentCount = bytes / sectorSize;
+  if (segmentCount > EVENT_LOG_MAX_SEGMENTS) segmentCount = EVENT_LOG_MAX_SEGMENTS;
+  if (segmentCount < 2) return false;
+  recordsPerSegment = sectorSize / EVENT_RECORD_SIZE - 2;
+
+  activeSector = -1;
+  nextSegment = 1;
+  nextRecord = 0;
+  prunedSegments = 0;
+  int newest = -1;
+  for (uint32_t sector = 0; sector < segmentCount; sector++) {
+    if (!readSegment(sector)) continue;
+    const EventSegmentSummary& summary = directory[sector];
+    if (summary.sequence >= nextSegment) nextSegment = summary.sequence + 1;
+    if (summary.firstRecord + summary.records > nextRecord) {
+      nextRecord = summary.firstRecord + summary.records;
+    }
+    if (newest < 0 || summary.sequence > directory[newest].sequence) newest = sector;
+  }
+
+  // Appends continue in the newest segment if it is still open. Any other
+  // open one was filled just before a reset, and is sealed now.
+  for (uint32_t sector = 0; sector < segmentCount; sector++) {
+    EventSegmentSummary& summary = directory[sector];
+    if (!summary.sequence || summary.sealed) continue;
+    if ((int)sector == newest) {
+      activeSector = sector;
+    } else {
+      seal(sector);
+    }
+  }
+  return true;
+}
+
+bool EventLog::readSegment(uint32_t sector) {
+  EventSegmentSummary& summary = directory[sector];
+  clearSummary(summary, sector);
+
+  SegmentHeader header;
+  if (!flash->read(slotOffset(sector, 0), &header, sizeof(header))) return false;
+  if (header.magic != SEGMENT_MAGIC || header.sequence == 0 ||
+      header.crc != crc32(&header, offsetof(SegmentHeader, crc))) {
+    return false;
+  }
+
+  SegmentFooter footer;
+  if (flash->read(slotOffset(sector, recordsPerSegment + 1), &footer, sizeof(footer)) &&
+      footer.magic == FOOTER_MAGIC && footer.crc == crc32(&footer, offsetof(SegmentFooter, crc)) &&
+      footer.summary.sequence == header.sequence) {
+    summary = footer.summary;
+    summary.sector = sector;
+    summary.sealed = 1;
+    return true;
+  }
+
+  // Still open: the records say what it holds
+  summary.sequence = header.sequence;
+  summary.firstRecord = header.firstRecord;
+  EventRecord chunk[SLOT_CHUNK];
+  for (uint32_t slot = 0; slot < recordsPerSegment; slot += SLOT_CHUNK) {
+    uint32_t count = recordsPerSegment - slot < SLOT_CHUNK ? recordsPerSegment - slot : SLOT_CHUNK;
+    if (!flash->read(slotOffset(sector, 1 + slot), chunk, count * EVENT_RECORD_SIZE)) break;
+    for (uint32_t i = 0; i < count; i++) {
+      if (isErased(&chunk[i], EVENT_RECORD_SIZE)) return true;
+      summary.records++;
+      if (isValidEventRecord(chunk[i])) include(summary, chunk[i]);
+    }
+  }
+  return true;
+}
+
+// The record is the newest in the segment: the slot just counted
+void EventLog::include(EventSegmentSummary& summary, const EventRecord& record) {
+  if (record.severity >= MINOR_CRASH) summary.notableSlots |= 1ULL << (summary.records - 1);
+  if (record.severity > summary.maxSeverity) summary.maxSeverity = record.severity;
+  if (record.score > summary.maxScore) summary.maxScore = record.score;
+  if (record.utcSeconds == 0) {
+    summary.unsynced = 1;
+  } else {
+    if (record.utcSeconds < summary.minUtc) summary.minUtc = record.utcSeconds;
+    if (record.utcSeconds > summary.maxUtc) summary.maxUtc = record.utcSeconds;
+  }
+}
+
+bool EventLog::seal(uint32_t sector) {
+  EventSegmentSummary& summary = directory[sector];
+  summary.sealed = 1;
+  SegmentFooter footer;
+  memset(&footer, 0xFF, sizeof(footer));
+  footer.magic = FOOTER_MAGIC;
+  footer.summary = summary;
+  footer.crc = crc32(&footer, offsetof(SegmentFooter, crc));
+  return flash->write(slotOffset(sector, recordsPerSegment + 1), &footer, sizeof(footer));
+}
+
+// The oldest segment, passing over those worth keeping while there is
+// anything else to erase
+int EventLog::pickVictim() const {
+  int oldest = -1;
+  int oldestOrdinary = -1;
+  for (uint32_t sector = 0; sector < segmentCount; sector++) {
+    const EventSegmentSummary& summary = directory[sector];
+    if (!summary.sequence || (int)sector == activeSector) continue;
+    if (oldest < 0 || summary.sequence < directory[oldest].sequence) oldest = sector;
+    if (summary.maxSeverity < EVENT_LOG_KEEP_SEVERITY &&
+        (oldestOrdinary < 0 || summary.sequence < directory[oldestOrdinary].sequence)) {
+      oldestOrdinary = sector;
+    }
+  }
+  return oldestOrdinary >= 0 ? oldestOrdinary : oldest;
+}
+
+bool EventLog::openSegment() {
+  int sector = -1;
+  for (uint32_t candidate = 0; candidate < segmentCount && sector < 0; candidate++) {
+    if (!directory[candidate].sequence) sector = candidate;
+  }
+  if (sector < 0) {
+    sector = pickVictim();
+    if (sector < 0) return false;
+    prunedSegments++;
+  }
+
+  // Free sectors may hold a torn header or old data: always erase
+  clearSummary(directory[sector], sector);
+  activeSector = -1;
+  if (!flash->eraseSector(sector * flash->sectorSize())) return false;
+
+  SegmentHeader header;
+  header.magic = SEGMENT_MAGIC;
+  header.sequence = nextSegment++;
+  header.firstRecord = nextRecord;
+  header.crc = crc32(&header, offsetof(SegmentHeader, crc));
+  if (!flash->write(slotOffset(sector, 0), &header, sizeof(header))) return false;
+
+  directory[sector].sequence = header.sequence;
+  directory[sector].firstRecord = header.firstRecord;
+  activeSector = sector;
+  return true;
+}
+
+bool EventLog::append(EventRecord& record) {
+  if (!flash || segmentCount == 0) return false;
+  if (activeSector >= 0 && directory[activeSector].records >= recordsPerSegment) {
+    seal(activeSector);
+    activeSector = -1;
+  }
+  if (activeSector < 0 && !openSegment()) return false;
+
+  EventSegmentSummary& summary = directory[activeSector];
+  record.sequence = summary.firstRecord + summary.records;
+  record.crc = crc32(&record, offsetof(EventRecord, crc));
+  uint32_t offset = slotOffset(activeSector, 1 + summary.records);
+  // The slot is spent even if the write fails part way
+  summary.records++;
+  nextRecord = record.sequence + 1;
+  if (!flash->write(offset, &record, EVENT_RECORD_SIZE)) return false;
+  include(summary, record);
+  return true;
+}
+
+bool EventLog::matches(const EventSegmentSummary& summary, const EventQuery& query) {
+  if (!summary.sequence || summary.records == 0) return false;
+  if (summary.maxSeverity < query.minSeverity || summary.maxScore < query.minScore) return false;
+  if (query.fromUtc == 0 && summary.unsynced) return true;
+  return summary.minUtc != UINT32_MAX && summary.minUtc <= query.toUtc &&
+         summary.maxUtc >= query.fromUtc;
+}
+
+bool EventLog::matches(const EventRecord& record, const EventQuery& query) {
+  if (record.severity < query.minSeverity || record.score < query.minScore) return false;
+  if (record.utcSeconds == 0) return query.fromUtc == 0;
+  return record.utcSeconds >= query.fromUtc && record.utcSeconds <= query.toUtc;
+}
+
+uint32_t EventLog::query(const EventQuery& query, EventVisitor visit, void* context) {
+  lastQueryReads = 0;
+  if (!flash) return 0;
+
+  // Candidate segments, oldest first (pruning can leave the ring out of order)
+  uint16_t order[EVENT_LOG_MAX_SEGMENTS];
+  uint32_t candidates = 0;
+  for (uint32_t sector = 0; sector < segmentCount; sector++) {
+    if (!matches(directory[sector], query)) continue;
+    uint32_t i = candidates++;
+    while (i > 0 && directory[order[i - 1]].sequence > directory[sector].sequence) {
+      order[i] = order[i - 1];
+      i--;
+    }
+    order[i] = sector;
+  }
+
+  uint32_t matched = 0;
+  EventRecord chunk[SLOT_CHUNK];
+  for (uint32_t c = 0; c < candidates; c++) {
+    const EventSegmentSummary& summary = directory[order[c]];
+    // Asking for detections, only the slots holding one are read
+    uint64_t wanted = query.minSeverity >= MINOR_CRASH ? summary.notableSlots : ~0ULL;
+    for (uint32_t slot = 0; slot < summary.records;) {
+      if (!(wanted & (1ULL << slot))) {
+        slot++;
+        continue;
+      }
+      uint32_t count = 1;
+      while (count < SLOT_CHUNK && slot + count < summary.records && (wanted & (1ULL << (slot + count)))) {
+        count++;
+      }
+      if (!flash->read(slotOffset(summary.sector, 1 + slot), chunk, count * EVENT_RECORD_SIZE)) break;
+      lastQueryReads += count;
+      slot += count;
+      for (uint32_t i = 0; i < count; i++) {
+        // The CRC only for records that would be visited
+        if (!matches(chunk[i], query) || !isValidEventRecord(chunk[i])) continue;
+        matched++;
+        if ((visit && !visit(chunk[i], context)) || matched >= query.limit) return matched;
+      }
+    }
+  }
+  return matched;
+}
+
+bool EventLog::clear() {
+  if (!flash) return false;
+  bool ok = true;
+  for (uint32_t sector = 0; sector < segmentCount; sector++) {
+    if (directory[sector].sequence && !flash->eraseSector(sector * flash->sectorSize())) ok = false;
+    clearSummary(directory[sector], sector);
+  }
+  activeSector = -1;
+  return ok;
+}
+
+uint32_t EventLog::getRecordCount() const {
+  uint32_t records = 0;
+  for (uint32_t sector = 0; sector < segmentCount; sector++) {
+    if (directory[sector].sequence) records += directory[sector].records;
+  }
+  return records;
+}
+
+uint32_t EventLog::getSegmentCount() const {
+  return segmentCount;
+}
+
+uint32_t EventLog::getUsedSegments() const {
+  uint32_t used = 0;
+  for (uint32_t sector = 0; sector < segmentCount; sector++) {
+    if (directory[sector].sequence) used++;
+  }
+  return used;
+}
+
+uint32_t EventLog::getRecordsPerSegment() const {
+  return recordsPerSegment;
+}
+
+uint32_t EventLog::getPrunedSegments() const {
+  return prunedSegments;
+}
+
+uint32_t EventLog::getLastQueryReads() const {
+  return lastQueryReads;
+}
+
+const EventSegmentSummary* EventLog::getSegment(uint32_t sector) const {
+  if (sector >= segmentCount || !directory[sector].sequence) return nullptr;
+  return &directory[sector];
+}
+
+static int16_t quantise(float value, float scale) {
+  float scaled = roundf(value * scale);
+  if (scaled > 32767.0f) return 32767;
+  if (scaled < -32767.0f) return -32767;
+  return (int16_t)scaled;
+}
+
+EventRecord makeEventRecord(EventKind kind, const SensorData& reading, int severity, int score,
+                            uint8_t sensors) {
+  EventRecord record;
+  memset(&record, 0, sizeof(record));
+  record.uptimeMs = reading.timestamp;
+  record.kind = kind;
+  record.severity = severity;
+  record.score = score;
+  record.sensors = sensors;
+  record.quality = reading.quality;
+  record.accelMg[0] = quantise(reading.accelX, 1000.0f);
+  record.accelMg[1] = quantise(reading.accelY, 1000.0f);
+  record.accelMg[2] = quantise(reading.accelZ, 1000.0f);
+  record.gyroDeciDps[0] = quantise(reading.gyroX, 10.0f);
+  record.gyroDeciDps[1] = quantise(reading.gyroY, 10.0f);
+  record.gyroDeciDps[2] = quantise(reading.gyroZ, 10.0f);
+  record.distanceCm = (reading.missing & SENSOR_ULTRASONIC) || reading.distance < 0
+                          ? -1 : quantise(reading.distance, 1.0f);
+  record.vibration = reading.vibration;
+  record.latitude = reading.latitude;
+  record.longitude = reading.longitude;
+  record.peakG = sqrtf(reading.accelX * reading.accelX + reading.accelY * reading.accelY +
+                       reading.accelZ * reading.accelZ);
+  return record;
+}
+
+bool parseEventQuery(const char* line, EventQuery& query) {
+  while (*line == ' ') line++;
+  if (strncmp(line, "events", 6) != 0 || (line[6] != '\0' && line[6] != ' ' && line[6] != '\r' &&
+                                          line[6] != '\n')) {
+    return false;
+  }
+  query = EventQuery();
+  const char* cursor = line + 6;
+  while (*cursor) {
+    while (*cursor == ' ' || *cursor == '\r' || *cursor == '\n') cursor++;
+    if (!*cursor) break;
+    const char* equals = strchr(cursor, '=');
+    if (!equals) return false;
+    size_t keyLength = equals - cursor;
+    char* end;
+    unsigned long value = strtoul(equals + 1, &end, 10);
+    if (end == equals + 1) return false;
+    if (keyLength == 4 && !strncmp(cursor, "from", 4)) query.fromUtc = value;
+    else if (keyLength == 2 && !strncmp(cursor, "to", 2)) query.toUtc = value;
+    else if (keyLength == 8 && !strncmp(cursor, "severity", 8)) query.minSeverity = value;
+    else if (keyLength == 5 && !strncmp(cursor, "score", 5)) query.minScore = value;
+    else if (keyLength == 5 && !strncmp(cursor, "limit", 5)) query.limit = value;
+    else return false;
+    cursor = end;
+  }
+  return true;
+}
+
+const char* const EVENT_CSV_HEADER =
+    "sequence,utc,uptime_ms,boot,kind,severity,score,sensors,quality,reason,"
+    "accel_x_g,accel_y_g,accel_z_g,gyro_x_dps,gyro_y_dps,gyro_z_dps,distance_cm,vibration,"
+    "latitude,longitude,spectral_energy,spectral_flatness,peak_g,delay_ms";
+
+int formatEventRecord(char* buffer, size_t size, const EventRecord& record) {
+  static const char* const kinds[] = {"scored", "trigger", "confirmed", "dismissed"};
+  return snprintf(buffer, size,
+                  "%lu,%lu,%lu,%u,%s,%u,%u,%u,%u,%u,%.3f,%.3f,%.3f,%.1f,%.1f,%.1f,%d,%u,"
+                  "%.6f,%.6f,%.4f,%.3f,%.2f,%u",
+                  (unsigned long)record.sequence, (unsigned long)record.utcSeconds,
+                  (unsigned long)record.uptimeMs, record.boot,
+                  record.kind <= EVENT_DISMISSED ? kinds[record.kind] : "unknown",
+                  record.severity, record.score, record.sensors, record.quality, record.reason,
+                  record.accelMg[0] / 1000.0, record.accelMg[1] / 1000.0, record.accelMg[2] / 1000.0,
+                  record.gyroDeciDps[0] / 10.0, record.gyroDeciDps[1] / 10.0,
+                  record.gyroDeciDps[2] / 10.0, record.distanceCm, record.vibration,
+                  record.latitude, record.longitude, record.spectralEnergy,
+                  record.spectralFlatness, record.peakG, record.delayMs);
+}
@@ -1,143 +1,143 @@
 #include "firebase_manager.h"
+#include "status_format.h"
 
 FirebaseManager::FirebaseManager() {
-  timeClient = nullptr;
-  isConnected = false;
-  signupOK = false;
-  lastConnectionCheck = 0;
+  timeBase = nullptr;
+  authResult = AUTH_PENDING;
+  authRunning = false;
+  signedUp = false;
   lastDataSend = 0;
+  statusPending = false;
+  pendingSeverity = NO_CRASH;
+  pendingEmergencyActive = false;
+  memset(alerts, 0, sizeof(alerts));
+  alertHead = 0;
+  alertCount = 0;
+  droppedAlerts = 0;
 }
 
 FirebaseManager::~FirebaseManager() {
-  if (timeClient) {
-    delete timeClient;
-  }
 }
 
-bool FirebaseManager::begin() {
+void FirebaseManager::begin(ClockDiscipline* utcClock) {
   Serial.println("FirebaseManager: Initializing...");
-  
-  // Connect to WiFi first
-  if (!connectToWiFi()) {
-    Serial.println("FirebaseManager: WiFi connection failed");
-    return false;
-  }
-  
-  // Initialize NTP client
-  timeClient = new NTPClient(ntpUDP, NTP_SERVER);
-  timeClient->begin();
-  timeClient->setTimeOffset(TIME_OFFSET);
-  timeClient->update();
-  
-  Serial.println("FirebaseManager: NTP client initialized");
-  
-  // Initialize Firebase
-  if (!initializeFirebase()) {
-    Serial.println("FirebaseManager: Firebase initialization failed");
-    return false;
-  }
-  
-  Serial.println("FirebaseManager: Initialized successfully");
-  return true;
+  timeBase = utcClock;
+  
+  // Scope all paths by this unit's eFuse MAC so fleets don't collide
+  uint64_t efuseMac = ESP.getEfuseMac();
+  paths.begin(efuseMac);
+  Serial.printf("FirebaseManager: Device ID %s\n", paths.getDeviceId());
+  
+  // Wi-Fi, SNTP and auth run from handleConnection() on the main loop;
+  // the MAC seeds the backoff jitter so a fleet spreads its retries
+  ConnectionTimings timings;
+  connection.begin(this, timings, (uint32_t)(efuseMac ^ (efuseMac >> 32)));
+  connection.poll(Clock::millis());
 }
 
-bool FirebaseManager::connectToWiFi() {
+void FirebaseManager::startAssociation() {
+  Serial.println("FirebaseManager: Connecting to WiFi");
   WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
-  Serial.print("FirebaseManager: Connecting to WiFi");
-  
-  int attempts = 0;
-  while (WiFi.status() != WL_CONNECTED && attempts < 20) {
-    delay(500);
-    Serial.print(".");
-    attempts++;
+}
+
+bool FirebaseManager::isAssociated() {
+  return WiFi.status() == WL_CONNECTED;
+}
+
+bool FirebaseManager::hasAddress() {
+  return (uint32_t)WiFi.localIP() != 0;
+}
+
+void FirebaseManager::startTimeSync() {
+  // lwIP SNTP runs in the background and keeps the system clock in UTC
+  configTime(0, 0, NTP_SERVER);
+}
+
+bool FirebaseManager::isTimeSynced() {
+  return Clock::unixTime() >= MIN_VALID_EPOCH;
+}
+
+void FirebaseManager::startAuth() {
+  // A previous attempt that timed out may still be running; its result is
+  // picked up instead of starting a second one
+  if (authRunning) return;
+  
+  // Already signed up: the client refreshes its token by itself once the
+  // link is back, so only getAuthStatus() has to wait for it
+  if (signedUp) {
+    authResult = AUTH_OK;
+    return;
   }
   
-  if (WiFi.status() == WL_CONNECTED) {
-    Serial.println();
-    Serial.printf("FirebaseManager: WiFi connected - IP: %s\n", WiFi.localIP().toString().c_str());
-    return true;
-  } else {
-    Serial.println("\nFirebaseManager: WiFi connection failed");
-    return false;
+  authResult = AUTH_PENDING;
+  authRunning = true;
+#ifdef ESP32
+  if (xTaskCreate(authTask, "fb_auth", 8192, this, 1, nullptr) != pdPASS) {
+    authRunning = false;
+    authResult = AUTH_FAILED;
   }
+#else
+  runAuth();
+#endif
+}
+
+void FirebaseManager::authTask(void* parameter) {
+  static_cast<FirebaseManager*>(parameter)->runAuth();
+#ifdef ESP32
+  vTaskDelete(nullptr);
+#endif
 }
 
-bool FirebaseManager::initializeFirebase() {
+void FirebaseManager::runAuth() {
   // Configure Firebase
   config.api_key = API_KEY;
   config.database_url = DATABASE_URL;
   
   // Attempt anonymous sign up
-  if (Firebase.signUp(&config, &auth, "", "")) {
+  bool signupOK = Firebase.signUp(&config, &auth, "", "");
+  if (signupOK) {
+    signedUp = true;
     Serial.println("FirebaseManager: Firebase SignUp OK");
-    signupOK = true;
+    
+    // Set token status callback
+    config.token_status_callback = tokenStatusCallback;
+    
+    // Reconnection is owned by the connection state machine
+    Firebase.begin(&config, &auth);
+    Firebase.reconnectWiFi(false);
   } else {
     Serial.printf("FirebaseManager: SignUp Error - %s\n", config.signer.signupError.message.c_str());
-    signupOK = false;
   }
   
-  // Set token status callback
-  config.token_status_callback = tokenStatusCallback;
-  
-  // Initialize Firebase
-  Firebase.begin(&config, &auth);
-  Firebase.reconnectWiFi(true);
-  
-  // Test connection
-  delay(1000);
-  isConnected = Firebase.ready();
-  
-  return isConnected && signupOK;
+  authResult = signupOK ? AUTH_OK : AUTH_FAILED;
+  authRunning = false;
 }
 
-void FirebaseManager::checkConnection() {
-  unsigned long currentTime = millis();
+AuthStatus FirebaseManager::getAuthStatus() {
+  if (authResult != AUTH_OK) return authResult;
   
-  // Check connection every 30 seconds
-  if (currentTime - lastConnectionCheck > 30000) {
-    lastConnectionCheck = currentTime;
-    
-    bool wifiStatus = (WiFi.status() == WL_CONNECTED);
-    bool firebaseStatus = Firebase.ready();
-    
-    if (wifiStatus != isWiFiConnected() || firebaseStatus != isConnected) {
-      Serial.printf("FirebaseManager: Connection status changed - WiFi: %s, Firebase: %s\n",
-                    wifiStatus ? "Connected" : "Disconnected",
-                    firebaseStatus ? "Connected" : "Disconnected");
-    }
-    
-    isConnected = firebaseStatus;
-    
-    // Attempt reconnection if needed
-    if (!wifiStatus) {
-      Serial.println("FirebaseManager: Attempting WiFi reconnection...");
-      WiFi.reconnect();
-    }
-  }
+  // Signed up; ready once the client holds a token
+  return Firebase.ready() ? AUTH_OK : AUTH_PENDING;
 }
 
-bool FirebaseManager::isReady() const {
-  return isConnected && signupOK && (WiFi.status() == WL_CONNECTED);
+void FirebaseManager::disconnect() {
+  WiFi.disconnect();
 }
 
-bool FirebaseManager::isWiFiConnected() const {
-  return WiFi.status() == WL_CONNECTED;
+const char* FirebaseManager::getDeviceId() const {
+  return paths.getDeviceId();
 }
 
-bool FirebaseManager::isFirebaseConnected() const {
-  return isConnected && Firebase.ready();
+bool FirebaseManager::isReady() const {
+  return connection.isReady();
 }
 
-String createPath(const char* suffix) {
-    String path = String(FB_SENSORS_PATH);
-    path += suffix;
-    return path;
+bool FirebaseManager::isWiFiConnected() const {
+  return WiFi.status() == WL_CONNECTED;
 }
 
-String createPath2(const String& suffix) {
-    String path = String(FB_EMERGENCY_PATH);
-    path += suffix;
-    return path;
+bool FirebaseManager::isFirebaseConnected() const {
+  return connection.isReady() && Firebase.ready();
 }
 
 bool FirebaseManager::sendSensorData(const SensorData& data, int crashSeverity, bool crashDetected) {
@@ -145,22 +145,22 @@ bool FirebaseManager::sendSensorData(const SensorData& data, int crashSeverity,
   
   bool success = true;
   
-  success &= sendFloat(createPath("accelX"), data.accelX);
-  success &= sendFloat(createPath("accelY"), data.accelY);
-  success &= sendFloat(createPath("accelZ"), data.accelZ);
-  success &= sendFloat(createPath("gyroX"), data.gyroX);
-  success &= sendFloat(createPath("gyroY"), data.gyroY);
-  success &= sendFloat(createPath("gyroZ"), data.gyroZ);
-  success &= sendFloat(createPath("distance"), data.distance);
-  success &= sendInt(createPath("vibration"), data.vibration);
-  success &= sendFloat(createPath("latitude"), data.latitude);
-  success &= sendFloat(createPath("longitude"), data.longitude);
-  success &= sendInt(createPath("crashSeverity"), crashSeverity);
-  success &= sendBool(createPath("crashDetected"), crashDetected);
-  success &= sendInt(createPath("timestamp"), getCurrentTimestamp());
+  success &= sendFloat(paths.get(PATH_ACCEL_X), data.accelX);
+  success &= sendFloat(paths.get(PATH_ACCEL_Y), data.accelY);
+  success &= sendFloat(paths.get(PATH_ACCEL_Z), data.accelZ);
+  success &= sendFloat(paths.get(PATH_GYRO_X), data.gyroX);
+  success &= sendFloat(paths.get(PATH_GYRO_Y), data.gyroY);
+  success &= sendFloat(paths.get(PATH_GYRO_Z), data.gyroZ);
+  success &= sendFloat(paths.get(PATH_DISTANCE), data.distance);
+  success &= sendInt(paths.get(PATH_VIBRATION), data.vibration);
+  success &= sendFloat(paths.get(PATH_LATITUDE), data.latitude);
+  success &= sendFloat(paths.get(PATH_LONGITUDE), data.longitude);
+  success &= sendInt(paths.get(PATH_CRASH_SEVERITY), crashSeverity);
+  success &= sendBool(paths.get(PATH_CRASH_DETECTED), crashDetected);
+  success &= sendInt(paths.get(PATH_TIMESTAMP), getCurrentTimestamp());
   
   if (success) {
-    lastDataSend = millis();
+    lastDataSend = Clock::millis();
   }
   
   return success;
@@ -169,12 +169,19 @@ bool FirebaseManager::sendSensorData(const SensorData& data, int crashSeverity,
 bool FirebaseManager::sendEmergencyAlert(const SensorData& data, int severity) {
   if (!isReady()) return false;
   
+  return writeEmergencyAlert(data, severity, getCurrentTimestamp());
+}
+
+bool FirebaseManager::writeEmergencyAlert(const SensorData& data, int severity, unsigned long timestamp) {
   // Create emergency data structure
   FirebaseJson emergencyData;
-  emergencyData.set("timestamp", getCurrentTimestamp());
+  emergencyData.set("timestamp", timestamp);
   emergencyData.set("severity", severity);
   emergencyData.set("latitude", data.latitude);
   emergencyData.set("longitude", data.longitude);
+  if (data.positionErrorM > 0) {
+    emergencyData.set("positionErrorM", data.positionErrorM);
+  }
   
   // Calculate magnitudes
   float accelMagnitude = sqrt(data.accelX*data.accelX + 
@@ -188,10 +195,23 @@ bool FirebaseManager::sendEmergencyAlert(const SensorData& data, int severity) {
   emergencyData.set("gyroMagnitude", gyroMagnitude);
   emergencyData.set("distance", data.distance);
   emergencyData.set("vibration", data.vibration);
+  // Which sensors the detection rested on (SENSOR_* bits)
+  emergencyData.set("sensors", (int)sensorSet(data));
+  if (data.quality) emergencyData.set("quality", (int)data.quality);
+  
+  // UTC of the impact sample itself, with its error bound and source
+  if (timeBase && timeBase->isSynced() && data.sampleMicros) {
+    char utc[UTC_TIMESTAMP_SIZE];
+    formatUtcTimestamp(utc, sizeof(utc), timeBase->toUtcMicros(data.sampleMicros));
+    emergencyData.set("utc", utc);
+    emergencyData.set("utcErrorUs", (unsigned long)timeBase->getErrorMicros(data.sampleMicros));
+    emergencyData.set("timeSource", ClockDiscipline::getSourceName(timeBase->getSource()));
+  }
   
-  String emergencyPath = createPath2(String(getCurrentTimestamp()));
+  char emergencyPath[DEVICE_PATH_SIZE];
+  paths.formatEmergencyPath(emergencyPath, sizeof(emergencyPath), timestamp);
   
-  if (Firebase.RTDB.setJSON(&fbdo, emergencyPath, &emergencyData)) {
+  if (Firebase.RTDB.setJSONAsync(&fbdo, emergencyPath, &emergencyData)) {
     Serial.println("FirebaseManager: Emergency alert sent successfully");
     return true;
   } else {
@@ -204,108 +224,162 @@ bool FirebaseManager::updateCrashStatus(int severity, bool emergencyActive) {
   if (!isReady()) return false;
   
   bool success = true;
-  success &= Firebase.RTDB.setInt(&fbdo, FB_CRASH_STATUS_PATH, severity);
-  success &= Firebase.RTDB.setBool(&fbdo, FB_EMERGENCY_ACTIVE_PATH, emergencyActive);
+  success &= Firebase.RTDB.setIntAsync(&fbdo, paths.get(PATH_CRASH_STATUS), severity);
+  success &= Firebase.RTDB.setBoolAsync(&fbdo, paths.get(PATH_EMERGENCY_ACTIVE), emergencyActive);
   
   return success;
 }
 
-bool FirebaseManager::sendFloat(const String& path, float value) {
+void FirebaseManager::queueCrashStatus(int severity, bool emergencyActive) {
+  statusPending = true;
+  pendingSeverity = severity;
+  pendingEmergencyActive = emergencyActive;
+}
+
+bool FirebaseManager::queueEmergencyAlert(const SensorData& data, int severity) {
+  if (alertCount == EMERGENCY_ALERT_QUEUE) {
+    droppedAlerts++;
+    Serial.printf("FirebaseManager: Emergency alert dropped, %u unsent\n", (unsigned)alertCount);
+    return false;
+  }
+  PendingAlert& alert = alerts[(alertHead + alertCount) % EMERGENCY_ALERT_QUEUE];
+  alert.data = data;
+  alert.severity = severity;
+  alert.timestamp = getSampleTimestamp(data);
+  alertCount++;
+  return true;
+}
+
+bool FirebaseManager::hasPending() const {
+  return statusPending || alertCount > 0;
+}
+
+uint8_t FirebaseManager::getPendingAlerts() const {
+  return alertCount;
+}
+
+uint32_t FirebaseManager::getDroppedAlerts() const {
+  return droppedAlerts;
+}
+
+void FirebaseManager::flushPending() {
+  if (!isReady()) return;
+  
+  // Alerts first: they are what emergency services act on
+  while (alertCount > 0) {
+    const PendingAlert& alert = alerts[alertHead];
+    if (!writeEmergencyAlert(alert.data, alert.severity, alert.timestamp)) break;
+    alertHead = (alertHead + 1) % EMERGENCY_ALERT_QUEUE;
+    alertCount--;
+  }
+  if (statusPending && updateCrashStatus(pendingSeverity, pendingEmergencyActive)) {
+    statusPending = false;
+  }
+}
+
+bool FirebaseManager::sendFloat(const char* path, float value) {
   if (!isReady()) return false;
   
-  if (Firebase.RTDB.setFloat(&fbdo, path, value)) {
+  if (Firebase.RTDB.setFloatAsync(&fbdo, path, value)) {
     return true;
   } else {
     Serial.printf("FirebaseManager: Failed to send float to %s - %s\n", 
-                  path.c_str(), fbdo.errorReason().c_str());
+                  path, fbdo.errorReason().c_str());
     return false;
   }
 }
 
-bool FirebaseManager::sendInt(const String& path, int value) {
+bool FirebaseManager::sendInt(const char* path, int value) {
   if (!isReady()) return false;
   
-  if (Firebase.RTDB.setInt(&fbdo, path, value)) {
+  if (Firebase.RTDB.setIntAsync(&fbdo, path, value)) {
     return true;
   } else {
     Serial.printf("FirebaseManager: Failed to send int to %s - %s\n", 
-                  path.c_str(), fbdo.errorReason().c_str());
+                  path, fbdo.errorReason().c_str());
     return false;
   }
 }
 
-bool FirebaseManager::sendBool(const String& path, bool value) {
+bool FirebaseManager::sendBool(const char* path, bool value) {
   if (!isReady()) return false;
   
-  if (Firebase.RTDB.setBool(&fbdo, path, value)) {
+  if (Firebase.RTDB.setBoolAsync(&fbdo, path, value)) {
     return true;
   } else {
     Serial.printf("FirebaseManager: Failed to send bool to %s - %s\n", 
-                  path.c_str(), fbdo.errorReason().c_str());
+                  path, fbdo.errorReason().c_str());
     return false;
   }
 }
 
-bool FirebaseManager::sendString(const String& path, const String& value) {
+bool FirebaseManager::sendString(const char* path, const char* value) {
   if (!isReady()) return false;
   
   if (Firebase.RTDB.setString(&fbdo, path, value)) {
     return true;
   } else {
     Serial.printf("FirebaseManager: Failed to send string to %s - %s\n", 
-                  path.c_str(), fbdo.errorReason().c_str());
+                  path, fbdo.errorReason().c_str());
     return false;
   }
 }
 
 unsigned long FirebaseManager::getCurrentTimestamp() {
-  if (timeClient) {
-    return timeClient->getEpochTime();
+  if (timeBase && timeBase->isSynced()) {
+    return (unsigned long)(timeBase->toUtcMicros(Clock::micros64()) / 1000000) + TIME_OFFSET;
   }
-  return millis() / 1000; // Fallback to system time
+  
+  uint32_t now = Clock::unixTime();
+  if (now >= MIN_VALID_EPOCH) {
+    return now + TIME_OFFSET;
+  }
+  return Clock::millis() / 1000; // Fallback to system time
 }
 
-void FirebaseManager::updateTime() {
-  if (timeClient) {
-    timeClient->update();
+unsigned long FirebaseManager::getSampleTimestamp(const SensorData& data) {
+  if (timeBase && timeBase->isSynced() && data.sampleMicros) {
+    return (unsigned long)(timeBase->toUtcMicros(data.sampleMicros) / 1000000) + TIME_OFFSET;
   }
+  return getCurrentTimestamp() - elapsedMillis(data.timestamp, Clock::millis()) / 1000;
 }
 
 void FirebaseManager::reconnect() {
-  Serial.println("FirebaseManager: Attempting reconnection...");
+  Serial.println("FirebaseManager: Restarting connection...");
+  connection.restart();
+}
+
+void FirebaseManager::handleConnection() {
+  ConnectionState previous = connection.getState();
+  connection.poll(Clock::millis());
   
-  if (WiFi.status() != WL_CONNECTED) {
-    connectToWiFi();
+  // lwIP has just set the system clock on a completed sync, so reading it
+  // together with the monotonic clock gives a discipline reference
+  if (timeBase && sntp_get_sync_status() == SNTP_SYNC_STATUS_COMPLETED) {
+    timeBase->addReference(Clock::micros64(), Clock::utcMicros(), NTP_UNCERTAINTY_US, TIME_SOURCE_NTP);
   }
   
-  if (WiFi.status() == WL_CONNECTED && !Firebase.ready()) {
-    Firebase.begin(&config, &auth);
-    delay(1000);
-    isConnected = Firebase.ready();
+  ConnectionState current = connection.getState();
+  if (current != previous) {
+    if (current == CONN_BACKOFF) {
+      Serial.printf("FirebaseManager: %s failed, retrying in %lu ms\n",
+                    ConnectionStateMachine::getStateName(previous),
+                    (unsigned long)connection.getBackoffDelay());
+    } else {
+      Serial.printf("FirebaseManager: %s -> %s\n",
+                    ConnectionStateMachine::getStateName(previous),
+                    ConnectionStateMachine::getStateName(current));
+    }
   }
 }
 
-void FirebaseManager::handleConnection() {
-  checkConnection();
-  
-  // Auto-reconnect if needed
-  if (!isReady()) {
-    static unsigned long lastReconnectAttempt = 0;
-    if (millis() - lastReconnectAttempt > 60000) { // Try every minute
-      lastReconnectAttempt = millis();
-      reconnect();
-    }
-  }
+ConnectionState FirebaseManager::getConnectionState() const {
+  return connection.getState();
 }
 
-String FirebaseManager::getConnectionInfo() {
-  String info = "WiFi: ";
-  info += isWiFiConnected() ? "Connected" : "Disconnected";
-  info += " | Firebase: ";
-  info += isFirebaseConnected() ? "Connected" : "Disconnected";
-  info += " | Ready: ";
-  info += isReady() ? "Yes" : "No";
-  return info;
+size_t FirebaseManager::getConnectionInfo(char* buffer, size_t bufferSize) {
+  return formatConnectionInfo(buffer, bufferSize, isWiFiConnected(),
+                              isFirebaseConnected(), isReady());
 }
 
 String FirebaseManager::getLastError() {
@@ -315,8 +389,7 @@ String FirebaseManager::getLastError() {
 bool FirebaseManager::testConnection() {
   if (!isReady()) return false;
   
-  String testPath = createPath("test");
-  bool result = Firebase.RTDB.setString(&fbdo, testPath, "connection_test");
+  bool result = Firebase.RTDB.setString(&fbdo, paths.get(PATH_TEST), "connection_test");
   
   if (result) {
     Serial.println("FirebaseManager: Connection test successful");
@@ -335,7 +408,7 @@ bool FirebaseManager::testDataSend() {
   testData.accelX = 1.0;
   testData.accelY = 0.0;
   testData.accelZ = 0.0;
-  testData.timestamp = millis();
+  testData.timestamp = Clock::millis();
   
   return sendSensorData(testData, NO_CRASH, false);
 }
\ No newline at end of file
@@ -0,0 +1,585 @@
+#include "firmware.h"
+#include <esp_task_wdt.h>
+#include "hal.h"
+#include <string.h>
+
+Firmware::Firmware() {
+  memset(&currentData, 0, sizeof(currentData));
+  memset(&triggerData, 0, sizeof(triggerData));
+  eventLogReady = false;
+  pollSampling = false;
+  lastSensorRead = 0;
+  lastFirebaseSend = 0;
+  lastDebugPrint = 0;
+  currentCrashSeverity = NO_CRASH;
+  sendImmediately = false;
+  lastEventLogMs = 0;
+  lastEventLogScore = 0;
+  lastHealthMode = HEALTH_NORMAL;
+  commandLine[0] = '\0';
+  commandLength = 0;
+  memset(&lastPass, 0, sizeof(lastPass));
+}
+
+bool Firmware::setup(ResetRecord* resetRecord, ResetReason resetReason) {
+  // A driver TX ring sent from the UART interrupt: writes that fit return
+  // at once instead of waiting on the 128-byte FIFO
+  Serial.setTxBufferSize(TELEMETRY_UART_TX_BUFFER);
+  Serial.begin(SERIAL_BAUD_RATE);
+  Serial.println("\n=== ESP32 Crash Detection System ===");
+  Serial.println("Initializing...");
+
+  // Learn from the last reset before anything can hang again: a step the
+  // watchdog caught starts out suspended
+  health.begin(resetRecord, resetReason, Clock::millis());
+  const ResetRecord& record = health.getRecord();
+  Serial.printf("Health: boot %lu, reset by %s\n", (unsigned long)record.bootCount,
+                HealthMonitor::reasonName(resetReason));
+  for (int task = 0; task < HEALTH_TASK_COUNT; task++) {
+    if (health.getHealth((HealthTask)task) == TASK_SUSPENDED) {
+      Serial.printf("Health: %s hung before the reset; suspended\n",
+                    HealthMonitor::taskName((HealthTask)task));
+    }
+  }
+  esp_task_wdt_init(WATCHDOG_TIMEOUT_S, true);
+  esp_task_wdt_add(NULL);
+
+  // Staged boot: crash detection depends only on the sensors and the
+  // calibration stored in NVS, so it is armed first. Nothing here waits on
+  // the network; Wi-Fi, SNTP and Firebase auth come up from loop().
+  Serial.println("Initializing sensors...");
+  sensors.setHealthMonitor(&health);
+  if (!sensors.begin(&utcClock)) {
+    // A loose connector or a bus held low may clear; retry from a clean
+    // boot, waiting longer after each failure
+    uint32_t retryMs = health.recordInitFailure();
+    Serial.printf("ERROR: Failed to initialize sensors! Restarting in %lu s\n",
+                  (unsigned long)(retryMs / 1000));
+    uint32_t failedAt = Clock::millis();
+    while (elapsedMillis(failedAt, Clock::millis()) < retryMs) {
+      esp_task_wdt_reset();
+      Clock::delay(1000);
+    }
+    ESP.restart();
+    return false;
+  }
+  health.recordInitSuccess();
+  bootTimeline.mark(BOOT_SENSORS, Clock::micros64());
+  Serial.println("✓ Sensors initialized successfully");
+  if (sensors.isCalibrated()) {
+    bootTimeline.mark(BOOT_CALIBRATED, Clock::micros64());
+  } else {
+    // Offsets are refined whenever the vehicle stands still
+    Serial.println("Sensors not calibrated yet; learning at the first stop");
+  }
+
+  // Design the pre-filter (pass-through unless filterConfig enables it)
+  sensorFilter.begin(filterConfig);
+
+  // Initialize crash detector
+  Serial.println("Initializing crash detector...");
+  crashDetector.begin(crashConfig);
+  bootTimeline.mark(BOOT_DETECTOR, Clock::micros64());
+  Serial.println("✓ Crash detector initialized");
+
+  // Event log: scored readings and confirmation decisions, kept in flash
+  // for retrieval after an incident
+  eventLogReady = eventFlash.begin(EVENT_LOG_PARTITION) && eventLog.begin(&eventFlash);
+  if (eventLogReady) {
+    Serial.printf("Event log: %lu records in %lu of %lu segments\n",
+                  (unsigned long)eventLog.getRecordCount(), (unsigned long)eventLog.getUsedSegments(),
+                  (unsigned long)eventLog.getSegmentCount());
+  } else {
+    Serial.println("Event log: no \"" EVENT_LOG_PARTITION "\" partition; not logging");
+  }
+
+  // Workshop diagnostics over BLE; streaming starts on "stream on"
+  ble.begin();
+
+  // Start Firebase connection; it completes from loop() without blocking
+  // sensing, and the system runs without cloud connectivity until then
+  Serial.println("Starting Firebase connection...");
+  firebase.begin(&utcClock);
+  Serial.println("✓ Firebase connection started");
+
+  if (pollSampling) {
+    Serial.printf("Sampling every %d ms by polling\n", SENSOR_READ_INTERVAL);
+  } else {
+    // From here loop() sleeps until the MPU's data-ready edge wakes it, or
+    // on a timer when INT is not wired
+    sensors.notifyOnDataReady(xTaskGetCurrentTaskHandle());
+    sampler.begin(SENSOR_READ_INTERVAL * 1000UL, sensors.hasDataReadyInterrupt(), Clock::micros64());
+    Serial.printf("Sampling every %d ms on %s\n", SENSOR_READ_INTERVAL,
+                  sampler.isInterruptDriven() ? "MPU data ready" : "a timer");
+    // The ping and the GPS UART on their own periods in between
+    SensorManager::scheduleSources(sources);
+    sources.start(Clock::micros64());
+    Serial.printf("Ultrasonic every %d ms, GPS every %d ms; %.0f%% of the CPU budgeted%s\n",
+                  ULTRASONIC_PERIOD_MS, GPS_PERIOD_MS, sources.getUtilization() * 100,
+                  sources.fitsRateMonotonicBound() ? "" : ", over the rate-monotonic bound");
+  }
+
+  Serial.println("=== System Ready ===");
+  Serial.println("Monitoring for crashes...\n");
+  return true;
+}
+
+// Append an event for the current reading, stamped with UTC when known
+void Firmware::logEvent(EventKind kind, int severity, ConfirmReason reason, uint32_t delayMs) {
+  if (!eventLogReady) return;
+  EventRecord record = makeEventRecord(kind, currentData, severity, crashDetector.getLastScore(),
+                                       crashDetector.getLastSensorSet());
+  if (utcClock.isSynced()) {
+    uint64_t sampleMicros = currentData.sampleMicros ? currentData.sampleMicros : Clock::micros64();
+    record.utcSeconds = (uint32_t)(utcClock.toUtcMicros(sampleMicros) / 1000000);
+  }
+  record.boot = (uint16_t)health.getRecord().bootCount;
+  record.reason = reason;
+  record.delayMs = delayMs > UINT16_MAX ? UINT16_MAX : delayMs;
+  const SpectralFeatures& features = spectrum.getFeatures();
+  if (features.valid) {
+    record.spectralEnergy = features.energy;
+    record.spectralFlatness = features.flatness;
+  }
+  if (!eventLog.append(record)) {
+    Serial.println("Event log: write failed");
+  }
+}
+
+// Near misses as well as crashes: one record per EVENT_LOG_HOLDOFF_MS,
+// sooner if the score rises
+void Firmware::logScoredReading(int severity) {
+  int score = crashDetector.getLastScore();
+  if (score < EVENT_LOG_MIN_SCORE) return;
+  uint32_t now = currentData.timestamp;
+  if (elapsedMillis(lastEventLogMs, now) < EVENT_LOG_HOLDOFF_MS && score <= lastEventLogScore) return;
+  lastEventLogMs = now;
+  lastEventLogScore = score;
+  logEvent(EVENT_SCORED, severity, REASON_NONE, 0);
+}
+
+// A reply line to where the command came from: the serial console or BLE
+void Firmware::reply(ReplyTo to, const char* line) {
+  if (to == REPLY_BLE) {
+    ble.respond(line);
+  } else {
+    Serial.println(line);
+  }
+}
+
+bool Firmware::replyEventRecord(const EventRecord& record, void* context) {
+  ReplyContext* target = (ReplyContext*)context;
+  char line[256];
+  formatEventRecord(line, sizeof(line), record);
+  target->firmware->reply(target->to, line);
+  esp_task_wdt_reset();
+  return true;
+}
+
+void Firmware::replyConfigLine(const char* line, void* context) {
+  ReplyContext* target = (ReplyContext*)context;
+  target->firmware->reply(target->to, line);
+}
+
+// A console command from serial or BLE (see ble_stream.h for the list)
+void Firmware::runCommand(char* line, ReplyTo to) {
+  size_t length = strlen(line);
+  while (length > 0 && (line[length - 1] == '\r' || line[length - 1] == '\n' || line[length - 1] == ' ')) {
+    line[--length] = '\0';
+  }
+  while (*line == ' ') line++;
+
+  ReplyContext target = {this, to};
+  char text[64];
+  EventQuery query;
+  if (parseEventQuery(line, query)) {
+    if (!eventLogReady) {
+      reply(to, "events: no event log");
+      return;
+    }
+    reply(to, EVENT_CSV_HEADER);
+    uint32_t matched = eventLog.query(query, replyEventRecord, &target);
+    snprintf(text, sizeof(text), "# %lu records, %lu slots read", (unsigned long)matched,
+             (unsigned long)eventLog.getLastQueryReads());
+    reply(to, text);
+  } else if (!strcmp(line, "get")) {
+    formatConfigSettings(crashConfig, replyConfigLine, &target);
+  } else if (!strncmp(line, "set ", 4)) {
+    if (applyConfigSettings(crashConfig, line + 4)) {
+      crashDetector.updateConfig(crashConfig);
+      reply(to, "ok");
+    } else {
+      reply(to, "set: unknown name or value out of range");
+    }
+  } else if (!strcmp(line, "calibrate")) {
+    if (crashConfirmer.getState() != CONFIRM_IDLE) {
+      reply(to, "calibrate: not while a crash is being handled");
+      return;
+    }
+    reply(to, "calibrate: keep the device still for 5 s");
+    // Longer than the watchdog allows the loop
+    esp_task_wdt_delete(NULL);
+    sensors.performCalibration();
+    esp_task_wdt_add(NULL);
+    reply(to, "ok");
+  } else if (!strcmp(line, "stream on") || !strcmp(line, "stream off")) {
+    ble.setStreaming(line[8] == 'n');
+    snprintf(text, sizeof(text), "stream %s, %u byte MTU", ble.isStreaming() ? "on" : "off", ble.getMtu());
+    reply(to, text);
+  } else {
+    reply(to, "Commands: get | set <name>=<value> ... | calibrate | stream on|off |");
+    reply(to, "  events [from=<utc>] [to=<utc>] [severity=<n>] [score=<n>] [limit=<n>]");
+  }
+}
+
+// Command lines from the serial console and the BLE control characteristic
+void Firmware::handleCommands() {
+  while (Serial.available() > 0) {
+    char c = Serial.read();
+    if (c != '\n' && c != '\r') {
+      if (commandLength < sizeof(commandLine) - 1) commandLine[commandLength++] = c;
+      continue;
+    }
+    if (commandLength == 0) continue;
+    commandLine[commandLength] = '\0';
+    commandLength = 0;
+    runCommand(commandLine, REPLY_SERIAL);
+  }
+
+  char bleLine[BLE_COMMAND_SIZE];
+  if (ble.takeCommand(bleLine, sizeof(bleLine))) {
+    runCommand(bleLine, REPLY_BLE);
+  }
+}
+
+// Telemetry for one detection pass: the sample and its score at debug
+// level, and the detector latching a crash
+void Firmware::recordDetection(bool wasDetected, int detectedSeverity) {
+  uint64_t now = Clock::micros64();
+  uint8_t scored = crashDetector.getLastSensorSet();
+  TELEMETRY(TELEMETRY_DEBUG, telemetry.sample(currentData, now));
+  TELEMETRY(TELEMETRY_DEBUG, telemetry.score(crashDetector.getLastScore(), CrashDetector::maxScore(scored),
+                                             detectedSeverity, scored, now));
+  if (!wasDetected && crashDetector.isCrashDetected()) {
+    TELEMETRY(TELEMETRY_INFO, telemetry.state(MACHINE_DETECTOR, NO_CRASH, detectedSeverity, REASON_NONE,
+                                              crashDetector.getLastScore(), now));
+  }
+}
+
+void Firmware::recordStats() {
+  TelemetryStats stats;
+  stats.uptimeMs = Clock::millis();
+  stats.freeHeap = ESP.getFreeHeap();
+  stats.eventRecords = eventLogReady ? eventLog.getRecordCount() : 0;
+  stats.dropped = telemetry.getDropped();
+  stats.health = health.getMode(Clock::millis());
+  stats.links = (firebase.isWiFiConnected() ? LINK_WIFI : 0) | (firebase.isFirebaseConnected() ? LINK_FIREBASE : 0) |
+                (ble.isConnected() ? LINK_BLE : 0) | (utcClock.isSynced() ? LINK_UTC : 0);
+  stats.severity = currentCrashSeverity;
+  stats.confirmState = crashConfirmer.getState();
+  telemetry.stats(stats, Clock::micros64());
+}
+
+// Whole frames into the UART driver's TX ring, as far as it has room:
+// never waits on the wire, and console text printed in between lands
+// between frames rather than inside one
+void Firmware::drainTelemetry() {
+  int room = Serial.availableForWrite();
+  const uint8_t* data;
+  size_t length;
+  while (room > 0 && (length = telemetry.peek(&data, room)) > 0) {
+    Serial.write(data, length);
+    telemetry.consume(length);
+    room -= length;
+  }
+}
+
+// Stages that complete in the background, and the timeline once they have
+void Firmware::trackBoot() {
+  uint64_t now = Clock::micros64();
+  if (sensors.isCalibrated()) bootTimeline.mark(BOOT_CALIBRATED, now);
+  if (firebase.isWiFiConnected()) bootTimeline.mark(BOOT_WIFI, now);
+  if (utcClock.isSynced()) bootTimeline.mark(BOOT_UTC, now);
+  if (firebase.isReady()) bootTimeline.mark(BOOT_CLOUD, now);
+  bootTimeline.report(now);
+}
+
+// Sleep until the next data-ready edge (one per SENSOR_READ_INTERVAL) or
+// the next ultrasonic or GPS read, whichever comes first, then read each
+// sensor that is due, the most frequent first. True when the IMU was read.
+bool Firmware::waitForSample() {
+  if (pollSampling) {
+    if (elapsedMillis(lastSensorRead, Clock::millis()) < SENSOR_READ_INTERVAL) return false;
+    lastSensorRead = Clock::millis();
+    return true;
+  }
+  uint64_t now = Clock::micros64();
+  uint32_t waitMicros = sampler.getWaitMicros(now);
+  if (sources.getWaitMicros(now) < waitMicros) waitMicros = sources.getWaitMicros(now);
+  uint32_t edges = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS((waitMicros + 999) / 1000));
+  if (sampler.onWake(edges, Clock::micros64())) sources.release(SOURCE_IMU, Clock::micros64());
+  return sensors.readDueSources(sources);
+}
+
+// Detection on one IMU reading; its time is the edge's
+void Firmware::detect(uint32_t currentMillis) {
+  // The IMU reading with the latest of the others
+  currentData = pollSampling ? sensors.readAllSensors() : sensors.takeSample();
+  health.startTask(TASK_DETECTION, Clock::millis());
+  sensorFilter.process(currentData);
+
+  // Ground speed from the raw fixes, for crash confirmation
+  crashConfirmer.observeFix(currentData);
+
+  // Replace the raw (often stale or missing) fix with the estimate at
+  // this sample
+  position.update(currentData);
+
+  // Add to crash detector history
+  crashDetector.addToHistory(currentData);
+
+  // Vibration spectrum over the newest readings, for the scoring below
+  if (spectrum.analyze(crashDetector.getHistory())) {
+    crashDetector.setSpectralFeatures(spectrum.getFeatures());
+  }
+
+  // Perform crash detection
+  bool wasDetected = crashDetector.isCrashDetected();
+  int detectedSeverity = crashDetector.detectCrash(currentData);
+  health.endTask(TASK_DETECTION, Clock::millis());
+  recordDetection(wasDetected, detectedSeverity);
+  if (bootTimeline.mark(BOOT_ARMED, Clock::micros64())) {
+    Serial.printf("Boot: crash detection armed at %lu ms\n",
+                  (unsigned long)bootTimeline.getMillis(BOOT_ARMED));
+  }
+
+  logScoredReading(detectedSeverity);
+
+  // Handle crash detection state changes: the detection is a
+  // pre-warning, and post-impact motion decides whether it escalates
+  ConfirmState confirmState = crashConfirmer.getState();
+  lastPass.sampled = true;
+  lastPass.detectedSeverity = detectedSeverity;
+  lastPass.newDetection = detectedSeverity > NO_CRASH && confirmState == CONFIRM_IDLE;
+  lastPass.confirmEvent = crashConfirmer.update(currentData, detectedSeverity, currentData.timestamp);
+  switch (lastPass.confirmEvent) {
+    case CONFIRM_TRIGGER:
+      logEvent(EVENT_TRIGGER, crashConfirmer.getSeverity(), REASON_NONE, 0);
+      Serial.println("\n⚠ Impact detected, confirming...");
+      Serial.print("Severity Level: ");
+      Serial.println(crashConfirmer.getSeverity());
+      firebase.queueCrashStatus(crashConfirmer.getSeverity(), false);
+      triggerData = currentData;
+      sendImmediately = true;
+      break;
+
+    case CONFIRM_UPDATE:
+      firebase.queueCrashStatus(crashConfirmer.getSeverity(), false);
+      break;
+
+    case CONFIRM_ESCALATE:
+      Serial.println("\n🚨 CRASH CONFIRMED! 🚨");
+      Serial.printf("Severity Level: %d (%s, %lu ms after impact)\n", crashConfirmer.getSeverity(),
+                    CrashConfirmer::reasonName(crashConfirmer.getReason()),
+                    (unsigned long)elapsedMillis(crashConfirmer.getTriggerMs(), crashConfirmer.getDecisionMs()));
+      logEvent(EVENT_CONFIRMED, crashConfirmer.getSeverity(), crashConfirmer.getReason(),
+               elapsedMillis(crashConfirmer.getTriggerMs(), crashConfirmer.getDecisionMs()));
+      crashDetector.confirmCrash(crashConfirmer.getSeverity());
+
+      // Emergency alert, sent with this pass. It describes the impact, not
+      // the sample the decision was made on up to seconds later
+      firebase.queueEmergencyAlert(triggerData, crashConfirmer.getSeverity());
+      firebase.queueCrashStatus(crashConfirmer.getSeverity(), true);
+      sendImmediately = true;
+      break;
+
+    case CONFIRM_DISMISS:
+      Serial.printf("Impact dismissed: %s\n", CrashConfirmer::reasonName(crashConfirmer.getReason()));
+      logEvent(EVENT_DISMISSED, detectedSeverity, crashConfirmer.getReason(),
+               elapsedMillis(crashConfirmer.getTriggerMs(), crashConfirmer.getDecisionMs()));
+      crashDetector.resetCrashDetection();
+      firebase.queueCrashStatus(NO_CRASH, false);
+      break;
+
+    default:
+      break;
+  }
+
+  // Check for auto-reset of minor crashes
+  if (crashConfirmer.getState() != CONFIRM_PENDING && crashDetector.shouldAutoReset()) {
+    Serial.println("Auto-resetting crash detection for minor incident");
+    crashDetector.resetCrashDetection();
+    crashConfirmer.reset();
+    firebase.queueCrashStatus(NO_CRASH, false);
+  }
+
+  currentCrashSeverity = crashConfirmer.getState() == CONFIRM_IDLE ? NO_CRASH
+                                                                  : crashConfirmer.getSeverity();
+  if (crashConfirmer.getState() != confirmState) {
+    uint32_t sinceTrigger = crashConfirmer.getState() == CONFIRM_PENDING ? 0
+        : elapsedMillis(crashConfirmer.getTriggerMs(), crashConfirmer.getDecisionMs());
+    TELEMETRY(TELEMETRY_INFO, telemetry.state(MACHINE_CONFIRMER, confirmState, crashConfirmer.getState(),
+                                              crashConfirmer.getReason(), sinceTrigger, Clock::micros64()));
+  }
+
+  DetectorState detector;
+  detector.severity = currentCrashSeverity;
+  detector.score = crashDetector.getLastScore();
+  detector.sensorSet = crashDetector.getLastSensorSet();
+  detector.confirmState = crashConfirmer.getState();
+  sensorSnapshot.publish(currentData);
+  detectorSnapshot.publish(detector);
+
+  // Live view for the BLE companion
+  ble.publish(currentData, crashDetector.getLastScore(),
+              crashConfirmer.getState() != CONFIRM_IDLE ? STREAM_FLAG_CRASH : 0, currentMillis);
+}
+
+void Firmware::loop() {
+  memset(&lastPass, 0, sizeof(lastPass));
+  bool sampleDue = waitForSample();
+  uint32_t currentMillis = Clock::millis();
+
+  // Handle Firebase connection
+  bool networkRuns = health.shouldRun(TASK_NETWORK, currentMillis);
+  if (networkRuns) {
+    health.startTask(TASK_NETWORK, Clock::millis());
+    firebase.handleConnection();
+    health.endTask(TASK_NETWORK, Clock::millis());
+  }
+
+  if (sampleDue) detect(currentMillis);
+
+  // Crash status and alert from detection, once the sample is scored; none
+  // of the writes waits for the server
+  if (networkRuns && firebase.hasPending()) {
+    health.startTask(TASK_NETWORK, Clock::millis());
+    firebase.flushPending();
+    health.endTask(TASK_NETWORK, Clock::millis());
+  }
+
+  // Send data to Firebase at specified interval (more often for confirmed
+  // moderate and severe crashes, and at once on a crash state change)
+  bool crashConfirmed = crashConfirmer.getState() == CONFIRM_CONFIRMED;
+  uint32_t sendInterval = crashConfirmed && currentCrashSeverity >= MODERATE_CRASH ? FIREBASE_CRASH_SEND_INTERVAL
+                                                                                  : FIREBASE_SEND_INTERVAL;
+  bool shouldSendData = elapsedMillis(lastFirebaseSend, currentMillis) >= sendInterval || sendImmediately;
+
+  if (shouldSendData && networkRuns && firebase.isReady()) {
+    lastFirebaseSend = currentMillis;
+    sendImmediately = false;
+    health.startTask(TASK_NETWORK, Clock::millis());
+    if (firebase.sendSensorData(currentData, currentCrashSeverity, crashConfirmed)) {
+      bootTimeline.mark(BOOT_FIRST_UPLOAD, Clock::micros64());
+    }
+    health.endTask(TASK_NETWORK, Clock::millis());
+  }
+
+  trackBoot();
+  ble.poll(Clock::millis());
+  handleCommands();
+
+  // Status at specified interval: a stats record, or the text dump when
+  // telemetry is compiled out
+  if (elapsedMillis(lastDebugPrint, currentMillis) >= DEBUG_PRINT_INTERVAL) {
+    lastDebugPrint = currentMillis;
+    if (TELEMETRY_LEVEL >= TELEMETRY_INFO) {
+      recordStats();
+    } else {
+      printDebugInfo();
+    }
+  }
+  HealthMode healthMode = health.getMode(Clock::millis());
+  if (healthMode != lastHealthMode) {
+    TELEMETRY(TELEMETRY_INFO, telemetry.state(MACHINE_HEALTH, lastHealthMode, healthMode, 0, 0, Clock::micros64()));
+    lastHealthMode = healthMode;
+  }
+  drainTelemetry();
+
+  // Feed the watchdog only while sensing and detection keep up; if either
+  // stalls, the reset that follows is the recovery
+  if (health.isAlive(Clock::millis())) {
+    esp_task_wdt_reset();
+  }
+
+  if (pollSampling) Clock::delay(10);
+}
+
+const LoopPass& Firmware::getLastPass() const {
+  return lastPass;
+}
+
+void Firmware::printDebugInfo() {
+  Serial.println("\n--- System Status ---");
+  
+  // Sensor readings, from the snapshot as another task would read them
+  SensorData data = sensorSnapshot.read();
+  DetectorState detector = detectorSnapshot.read();
+  Serial.println("Sensor Readings:");
+  Serial.printf("  Accel: X=%.2f, Y=%.2f, Z=%.2f g\n", 
+                data.accelX, data.accelY, data.accelZ);
+  Serial.printf("  Gyro: X=%.2f, Y=%.2f, Z=%.2f °/s\n", 
+                data.gyroX, data.gyroY, data.gyroZ);
+  Serial.printf("  Distance: %.2f cm\n", data.distance);
+  Serial.printf("  Vibration: %s\n", data.vibration ? "DETECTED" : "NORMAL");
+  Serial.printf("  GPS: %.6f, %.6f\n", data.latitude, data.longitude);
+  if (data.missing & (SENSOR_IMU | SENSOR_ULTRASONIC | SENSOR_VIBRATION)) {
+    Serial.printf("  Missing:%s%s%s (scoring out of %d)\n",
+                  (data.missing & SENSOR_IMU) ? " IMU" : "",
+                  (data.missing & SENSOR_ULTRASONIC) ? " ultrasonic" : "",
+                  (data.missing & SENSOR_VIBRATION) ? " vibration" : "",
+                  CrashDetector::maxScore(detector.sensorSet));
+  }
+  
+  // Crash detection status
+  Serial.println("Crash Detection:");
+  static const char* const confirmStates[] = {"MONITORING", "CONFIRMING", "ACTIVE"};
+  Serial.printf("  Status: %s\n", confirmStates[detector.confirmState]);
+  Serial.printf("  Severity: %d\n", detector.severity);
+  
+  // System status
+  Serial.println("System Status:");
+  Serial.printf("  WiFi: %s\n", firebase.isWiFiConnected() ? "Connected" : "Disconnected");
+  Serial.printf("  Firebase: %s\n", firebase.isFirebaseConnected() ? "Connected" : "Disconnected");
+  if (firebase.getPendingAlerts() > 0 || firebase.getDroppedAlerts() > 0) {
+    Serial.printf("  Emergency alerts: %u unsent, %lu dropped\n", (unsigned)firebase.getPendingAlerts(),
+                  (unsigned long)firebase.getDroppedAlerts());
+  }
+  Serial.printf("  Uptime: %lu seconds\n", (unsigned long)(Clock::millis() / 1000));
+  Serial.printf("  Sampling: %s, %lu samples, %lu missed, %lu on the timer\n",
+                sampler.isInterruptAlive() ? "data ready" : "timer", (unsigned long)sampler.getSamples(),
+                (unsigned long)sampler.getMissed(), (unsigned long)sampler.getFallbacks());
+  Serial.print("  Sources:");
+  for (uint32_t source = 0; source < sources.getTaskCount(); source++) {
+    const RateTaskStats& stats = sources.getStats(source);
+    Serial.printf(" [%s %lu late, %lu over, max %lu us]", sources.getName(source),
+                  (unsigned long)stats.deadlineMisses, (unsigned long)stats.overruns,
+                  (unsigned long)stats.maxRunMicros);
+  }
+  Serial.println();
+  if (ble.isConnected()) {
+    Serial.printf("  BLE: connected, MTU %u, stream %s (%lu frames sent)\n", ble.getMtu(),
+                  ble.isStreaming() ? "on" : "off", (unsigned long)ble.getFramesSent());
+  }
+  if (eventLogReady) {
+    Serial.printf("  Event log: %lu records, %lu segments pruned\n",
+                  (unsigned long)eventLog.getRecordCount(), (unsigned long)eventLog.getPrunedSegments());
+  }
+  static const char* const healthModes[] = {"NORMAL", "DEGRADED", "STALLED"};
+  Serial.printf("  Health: %s", healthModes[health.getMode(Clock::millis())]);
+  for (int task = 0; task < HEALTH_TASK_COUNT; task++) {
+    if (health.getHealth((HealthTask)task) != TASK_OK) {
+      Serial.printf(" [%s %s]", HealthMonitor::taskName((HealthTask)task),
+                    health.getHealth((HealthTask)task) == TASK_SUSPENDED ? "suspended" : "slow");
+    }
+  }
+  Serial.println();
+  if (utcClock.isSynced()) {
+    Serial.printf("  UTC error: +/-%lu us (%s), oscillator %ld ppb\n",
+                  (unsigned long)utcClock.getErrorMicros(Clock::micros64()),
+                  ClockDiscipline::getSourceName(utcClock.getSource()),
+                  (long)utcClock.getFrequencyPpb());
+  }
+  
+  Serial.println("----------------------\n");
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+#include "gps_time.h"
+
+GpsTimeSync::GpsTimeSync() {
+  begin(nullptr);
+}
+
+void GpsTimeSync::begin(ClockDiscipline* utcClock) {
+  discipline = utcClock;
+  lastPpsMono = 0;
+  havePps = false;
+  lastUtcSecond = -1;
+  ppsReferences = 0;
+  nmeaReferences = 0;
+}
+
+void GpsTimeSync::onPpsEdge(uint64_t monoMicros) {
+  lastPpsMono = monoMicros;
+  havePps = true;
+}
+
+void GpsTimeSync::onTime(int64_t utcSeconds, uint8_t centiseconds, uint64_t burstStartMicros) {
+  if (!discipline || utcSeconds == lastUtcSecond) return;
+  lastUtcSecond = utcSeconds;
+
+  int64_t utcMicros = utcSeconds * 1000000 + (int64_t)centiseconds * 10000;
+
+  if (havePps && centiseconds == 0 && burstStartMicros >= lastPpsMono &&
+      burstStartMicros - lastPpsMono <= GPS_PPS_MAX_AGE_US) {
+    discipline->addReference(lastPpsMono, utcMicros, GPS_PPS_UNCERTAINTY_US,
+                             TIME_SOURCE_GPS_PPS);
+    ppsReferences++;
+    return;
+  }
+
+  if (burstStartMicros < GPS_NMEA_LATENCY_US) return;
+  discipline->addReference(burstStartMicros - GPS_NMEA_LATENCY_US, utcMicros,
+                           GPS_NMEA_UNCERTAINTY_US, TIME_SOURCE_GPS_NMEA);
+  nmeaReferences++;
+}
+
+uint32_t GpsTimeSync::getPpsReferenceCount() const {
+  return ppsReferences;
+}
+
+uint32_t GpsTimeSync::getNmeaReferenceCount() const {
+  return nmeaReferences;
+}
+
+int64_t GpsTimeSync::toUnixSeconds(int year, int month, int day, int hour, int minute,
+                                   int second) {
+  // Days from civil (H. Hinnant), with March as the first month of the year
+  year -= month <= 2;
+  int64_t era = (year >= 0 ? year : year - 399) / 400;
+  int64_t yearOfEra = year - era * 400;
+  int64_t dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  int64_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+  int64_t days = era * 146097 + dayOfEra - 719468;
+  return days * 86400 + hour * 3600 + minute * 60 + second;
+}
@@ -0,0 +1,201 @@
+#include "health_monitor.h"
+#include "hal.h"
+#include <stddef.h>
+#include <string.h>
+
+// FNV-1a over everything before the checksum field
+static uint32_t recordChecksum(const ResetRecord& record) {
+  const uint8_t* bytes = (const uint8_t*)&record;
+  uint32_t hash = 2166136261UL;
+  for (size_t i = 0; i < offsetof(ResetRecord, checksum); i++) {
+    hash = (hash ^ bytes[i]) * 16777619UL;
+  }
+  return hash;
+}
+
+static uint32_t doubledDelay(uint32_t delay) {
+  return delay > HEALTH_RETRY_MAX_MS / 2 ? HEALTH_RETRY_MAX_MS : delay * 2;
+}
+
+HealthMonitor::HealthMonitor() {
+  record = nullptr;
+  stepStart = 0;
+  budgetMs[TASK_IMU] = TASK_BUDGET_IMU_MS;
+  budgetMs[TASK_DETECTION] = TASK_BUDGET_DETECTION_MS;
+  budgetMs[TASK_ULTRASONIC] = TASK_BUDGET_ULTRASONIC_MS;
+  budgetMs[TASK_GPS] = TASK_BUDGET_GPS_MS;
+  budgetMs[TASK_NETWORK] = TASK_BUDGET_NETWORK_MS;
+  for (int task = 0; task < HEALTH_TASK_COUNT; task++) {
+    health[task] = TASK_OK;
+    strikes[task] = 0;
+    lastBeat[task] = 0;
+    lastDuration[task] = 0;
+    retryDelay[task] = HEALTH_RETRY_MIN_MS;
+    retryAt[task] = 0;
+    suspensions[task] = 0;
+  }
+}
+
+void HealthMonitor::begin(ResetRecord* resetRecord, ResetReason reason, uint32_t nowMs) {
+  record = resetRecord;
+  for (int task = 0; task < HEALTH_TASK_COUNT; task++) {
+    health[task] = TASK_OK;
+    strikes[task] = 0;
+    lastBeat[task] = nowMs;
+    lastDuration[task] = 0;
+    retryDelay[task] = HEALTH_RETRY_MIN_MS;
+    retryAt[task] = 0;
+    suspensions[task] = 0;
+  }
+
+  // RTC memory holds noise after a power cycle
+  bool valid = record->magic == RESET_RECORD_MAGIC &&
+               record->checksum == recordChecksum(*record) &&
+               record->runningTask >= TASK_NONE && record->runningTask < HEALTH_TASK_COUNT;
+  if (!valid || reason == RESET_POWER_ON) {
+    memset(record, 0, sizeof(*record));
+    record->magic = RESET_RECORD_MAGIC;
+    record->runningTask = TASK_NONE;
+  }
+  record->bootCount++;
+  record->lastReason = reason;
+
+  if (reason == RESET_WATCHDOG) record->watchdogResets++;
+  if ((reason == RESET_WATCHDOG || reason == RESET_PANIC) && record->runningTask != TASK_NONE) {
+    // That step never returned. Isolate it, for longer each time it does so.
+    int task = record->runningTask;
+    record->taskHangs[task]++;
+    if (!isCritical((HealthTask)task)) {
+      for (uint32_t i = 1; i < record->taskHangs[task]; i++) {
+        retryDelay[task] = doubledDelay(retryDelay[task]);
+      }
+      suspend(task, nowMs);
+    }
+  }
+  record->runningTask = TASK_NONE;
+  seal();
+}
+
+void HealthMonitor::seal() {
+  record->checksum = recordChecksum(*record);
+}
+
+void HealthMonitor::setBudget(HealthTask task, uint32_t milliseconds) {
+  if (task < HEALTH_TASK_COUNT) budgetMs[task] = milliseconds;
+}
+
+bool HealthMonitor::isCritical(HealthTask task) {
+  return task == TASK_IMU || task == TASK_DETECTION;
+}
+
+void HealthMonitor::suspend(int task, uint32_t nowMs) {
+  health[task] = TASK_SUSPENDED;
+  retryAt[task] = nowMs + retryDelay[task];
+  retryDelay[task] = doubledDelay(retryDelay[task]);
+  strikes[task] = 0;
+  suspensions[task]++;
+}
+
+bool HealthMonitor::shouldRun(HealthTask task, uint32_t nowMs) {
+  if (health[task] != TASK_SUSPENDED) return true;
+  if ((int32_t)(nowMs - retryAt[task]) < 0) return false;
+
+  // Probation: one more overrun suspends it again, for twice as long
+  health[task] = TASK_SLOW;
+  strikes[task] = HEALTH_STRIKES - 1;
+  return true;
+}
+
+void HealthMonitor::startTask(HealthTask task, uint32_t nowMs) {
+  stepStart = nowMs;
+  record->runningTask = task;
+  seal();
+}
+
+void HealthMonitor::endTask(HealthTask task, uint32_t nowMs) {
+  record->runningTask = TASK_NONE;
+  seal();
+
+  uint32_t duration = elapsedMillis(stepStart, nowMs);
+  lastDuration[task] = duration;
+  lastBeat[task] = nowMs;
+  if (duration <= budgetMs[task]) {
+    strikes[task] = 0;
+    health[task] = TASK_OK;
+    retryDelay[task] = HEALTH_RETRY_MIN_MS;
+    return;
+  }
+
+  strikes[task]++;
+  health[task] = TASK_SLOW;
+  if (!isCritical(task) && strikes[task] >= HEALTH_STRIKES) suspend(task, nowMs);
+}
+
+bool HealthMonitor::isAlive(uint32_t nowMs) const {
+  for (int task = 0; task < HEALTH_TASK_COUNT; task++) {
+    if (!isCritical((HealthTask)task)) continue;
+    if (elapsedMillis(lastBeat[task], nowMs) > HEALTH_HEARTBEAT_TIMEOUT_MS) return false;
+  }
+  return true;
+}
+
+HealthMode HealthMonitor::getMode(uint32_t nowMs) const {
+  if (!isAlive(nowMs)) return HEALTH_STALLED;
+  for (int task = 0; task < HEALTH_TASK_COUNT; task++) {
+    if (health[task] == TASK_SUSPENDED) return HEALTH_DEGRADED;
+  }
+  return HEALTH_NORMAL;
+}
+
+uint32_t HealthMonitor::recordInitFailure() {
+  record->initFailures++;
+  seal();
+  uint32_t delay = HEALTH_RETRY_MIN_MS;
+  for (uint32_t i = 1; i < record->initFailures && delay < HEALTH_RETRY_MAX_MS; i++) {
+    delay = doubledDelay(delay);
+  }
+  return delay;
+}
+
+void HealthMonitor::recordInitSuccess() {
+  record->initFailures = 0;
+  seal();
+}
+
+TaskHealth HealthMonitor::getHealth(HealthTask task) const {
+  return health[task];
+}
+
+uint32_t HealthMonitor::getLastDuration(HealthTask task) const {
+  return lastDuration[task];
+}
+
+uint32_t HealthMonitor::getSuspensions(HealthTask task) const {
+  return suspensions[task];
+}
+
+const ResetRecord& HealthMonitor::getRecord() const {
+  return *record;
+}
+
+const char* HealthMonitor::taskName(HealthTask task) {
+  switch (task) {
+    case TASK_IMU: return "imu";
+    case TASK_DETECTION: return "detection";
+    case TASK_ULTRASONIC: return "ultrasonic";
+    case TASK_GPS: return "gps";
+    case TASK_NETWORK: return "network";
+    default: return "unknown";
+  }
+}
+
+const char* HealthMonitor::reasonName(ResetReason reason) {
+  switch (reason) {
+    case RESET_POWER_ON: return "power-on";
+    case RESET_SOFTWARE: return "software";
+    case RESET_WATCHDOG: return "watchdog";
+    case RESET_PANIC: return "panic";
+    case RESET_BROWNOUT: return "brownout";
+    default: return "other";
+  }
+}
@@ -0,0 +1,247 @@
+#include "i2c_transport.h"
+#include "hal.h"
+#include <Arduino.h>
+#include <Wire.h>
+#include <string.h>
+
+// Half a period of the 100 kHz recovery clock
+#define I2C_RECOVERY_HALF_PERIOD_US 5
+
+void decodeMotionBurst(const uint8_t* burst, ImuFrame& frame) {
+  for (int axis = 0; axis < 3; axis++) {
+    frame.accel[axis] = (int16_t)((burst[2 * axis] << 8) | burst[2 * axis + 1]);
+    frame.gyro[axis] = (int16_t)((burst[8 + 2 * axis] << 8) | burst[8 + 2 * axis + 1]);
+  }
+  frame.temperature = (int16_t)((burst[6] << 8) | burst[7]);
+}
+
+I2cTransport::I2cTransport() {
+  port = nullptr;
+  clockHz = 0;
+  consecutiveFailures = 0;
+  pending = false;
+  pendingAsync = false;
+  pendingStart = 0;
+  pendingResult = I2C_OK;
+  memset(burst, 0, sizeof(burst));
+  resetStats();
+}
+
+void I2cTransport::begin(I2cPort* i2cPort, uint32_t busClockHz) {
+  port = i2cPort;
+  clockHz = busClockHz;
+  consecutiveFailures = 0;
+  pending = false;
+  resetStats();
+
+  port->end();
+  if (!port->readSda() || !port->readScl()) {
+    stats.hangs++;
+    recover();
+  } else {
+    port->begin(clockHz);
+  }
+}
+
+void I2cTransport::record(I2cResult result, uint64_t startMicros) {
+  uint32_t elapsed = (uint32_t)(Clock::micros64() - startMicros);
+  stats.transactions++;
+  stats.lastMicros = elapsed;
+  stats.totalMicros += elapsed;
+  if (elapsed > stats.maxMicros) stats.maxMicros = elapsed;
+
+  if (result == I2C_OK) {
+    consecutiveFailures = 0;
+    return;
+  }
+  stats.failures++;
+  if (result == I2C_NACK) stats.nacks++;
+  else if (result == I2C_TIMEOUT) stats.timeouts++;
+  else stats.busErrors++;
+  consecutiveFailures++;
+  handleFailure();
+}
+
+void I2cTransport::handleFailure() {
+  if (isBusHung()) {
+    stats.hangs++;
+    recover();
+  } else if (consecutiveFailures >= I2C_REINIT_FAILURES) {
+    reinit();
+  }
+}
+
+void I2cTransport::reinit() {
+  port->end();
+  port->begin(clockHz);
+  stats.reinits++;
+  consecutiveFailures = 0;
+}
+
+bool I2cTransport::isBusHung() {
+  return !port->readSda() || !port->readScl();
+}
+
+bool I2cTransport::recover() {
+  port->end();
+
+  // A slave mid-read holds SDA low for its next 0 bit; clock it through
+  // the rest of the byte until it lets go
+  for (int pulse = 0; pulse < I2C_RECOVERY_PULSES && !port->readSda(); pulse++) {
+    port->driveScl(false);
+    Clock::delayMicroseconds(I2C_RECOVERY_HALF_PERIOD_US);
+    port->driveScl(true);
+    Clock::delayMicroseconds(I2C_RECOVERY_HALF_PERIOD_US);
+  }
+
+  // STOP: SDA rises while SCL is high, resetting every slave's bus logic
+  port->driveScl(false);
+  Clock::delayMicroseconds(I2C_RECOVERY_HALF_PERIOD_US);
+  port->driveSda(false);
+  Clock::delayMicroseconds(I2C_RECOVERY_HALF_PERIOD_US);
+  port->driveScl(true);
+  Clock::delayMicroseconds(I2C_RECOVERY_HALF_PERIOD_US);
+  port->driveSda(true);
+  Clock::delayMicroseconds(I2C_RECOVERY_HALF_PERIOD_US);
+
+  bool cleared = port->readSda() && port->readScl();
+  if (cleared) {
+    stats.recoveries++;
+  } else {
+    stats.failedRecoveries++;
+  }
+  reinit();
+  return cleared;
+}
+
+I2cResult I2cTransport::readRegisters(uint8_t address, uint8_t reg, uint8_t* data, uint8_t length) {
+  uint64_t start = Clock::micros64();
+  I2cResult result = port->readRegisters(address, reg, data, length);
+  record(result, start);
+  return result;
+}
+
+I2cResult I2cTransport::writeRegister(uint8_t address, uint8_t reg, uint8_t value) {
+  uint64_t start = Clock::micros64();
+  I2cResult result = port->writeRegister(address, reg, value);
+  record(result, start);
+  return result;
+}
+
+I2cResult I2cTransport::readMotion(uint8_t address, ImuFrame& frame) {
+  startMotion(address);
+  return finishMotion(frame);
+}
+
+void I2cTransport::startMotion(uint8_t address) {
+  pending = true;
+  pendingStart = Clock::micros64();
+  pendingAsync = port->startRead(address, MPU6050_REG_ACCEL_XOUT_H, burst, MPU6050_BURST_BYTES);
+  if (!pendingAsync) {
+    pendingResult = port->readRegisters(address, MPU6050_REG_ACCEL_XOUT_H, burst,
+                                        MPU6050_BURST_BYTES);
+  }
+}
+
+I2cResult I2cTransport::finishMotion(ImuFrame& frame) {
+  memset(&frame, 0, sizeof(frame));
+  frame.status = IMU_FRAME_FAILED;
+  if (!pending) return I2C_BUS_ERROR;
+  pending = false;
+
+  // The controller's own timeout bounds this wait
+  if (pendingAsync) {
+    while (!port->isReadDone()) {
+    }
+    pendingResult = port->finishRead();
+  }
+  record(pendingResult, pendingStart);
+
+  if (pendingResult == I2C_OK) {
+    decodeMotionBurst(burst, frame);
+    frame.status = IMU_FRAME_OK;
+  }
+  return pendingResult;
+}
+
+uint32_t I2cTransport::getClockHz() const {
+  return clockHz;
+}
+
+const I2cStats& I2cTransport::getStats() const {
+  return stats;
+}
+
+void I2cTransport::resetStats() {
+  memset(&stats, 0, sizeof(stats));
+}
+
+// ---------------------------------------------------------------------------
+// WirePort
+
+void WirePort::begin(uint32_t clockHz) {
+  Wire.begin(SDA_PIN, SCL_PIN, clockHz);
+  Wire.setTimeOut(I2C_TIMEOUT_MS);
+}
+
+void WirePort::end() {
+  Wire.end();
+  pinMode(SDA_PIN, INPUT_PULLUP);
+  pinMode(SCL_PIN, INPUT_PULLUP);
+}
+
+// Arduino endTransmission(): 2 and 3 are NACKs, 5 a timeout
+static I2cResult fromWireStatus(uint8_t status) {
+  switch (status) {
+    case 0: return I2C_OK;
+    case 2:
+    case 3: return I2C_NACK;
+    case 5: return I2C_TIMEOUT;
+    default: return I2C_BUS_ERROR;
+  }
+}
+
+I2cResult WirePort::readRegisters(uint8_t address, uint8_t reg, uint8_t* data, uint8_t length) {
+  Wire.beginTransmission(address);
+  Wire.write(reg);
+  I2cResult result = fromWireStatus(Wire.endTransmission(false));
+  if (result != I2C_OK) return result;
+
+  if (Wire.requestFrom(address, length) != length) return I2C_TIMEOUT;
+  for (uint8_t i = 0; i < length; i++) data[i] = (uint8_t)Wire.read();
+  return I2C_OK;
+}
+
+I2cResult WirePort::writeRegister(uint8_t address, uint8_t reg, uint8_t value) {
+  Wire.beginTransmission(address);
+  Wire.write(reg);
+  Wire.write(value);
+  return fromWireStatus(Wire.endTransmission());
+}
+
+bool WirePort::readSda() {
+  return digitalRead(SDA_PIN) == HIGH;
+}
+
+bool WirePort::readScl() {
+  return digitalRead(SCL_PIN) == HIGH;
+}
+
+// Open drain: low is driven, high is released to the pull-up
+void WirePort::driveSda(bool high) {
+  if (high) {
+    pinMode(SDA_PIN, INPUT_PULLUP);
+  } else {
+    digitalWrite(SDA_PIN, LOW);
+    pinMode(SDA_PIN, OUTPUT);
+  }
+}
+
+void WirePort::driveScl(bool high) {
+  if (high) {
+    pinMode(SCL_PIN, INPUT_PULLUP);
+  } else {
+    digitalWrite(SCL_PIN, LOW);
+    pinMode(SCL_PIN, OUTPUT);
+  }
+}
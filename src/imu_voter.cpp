@@ -0,0 +1,206 @@
+#include "imu_voter.h"
+#include <string.h>
+
+// Bytes on the bus per burst: address + register, address + 14 data bytes
+#define IMU_BURST_BYTES 17
+// Start, repeated start and stop conditions, in bit times
+#define IMU_BURST_CONDITION_BITS 3
+
+float imuTemperatureC(int16_t raw) {
+  return raw / 340.0f + 36.53f;
+}
+
+uint32_t imuBurstMicros(uint32_t clockHz) {
+  if (clockHz == 0) return UINT32_MAX;
+  uint32_t bits = IMU_BURST_BYTES * 9 + IMU_BURST_CONDITION_BITS;
+  return (uint32_t)(((uint64_t)bits * 1000000 + clockHz - 1) / clockHz) + I2C_TRANSACTION_OVERHEAD_US;
+}
+
+uint32_t imuReadsPerSample(uint32_t count, uint32_t clockHz, uint32_t budgetMicros) {
+  uint32_t fits = budgetMicros / imuBurstMicros(clockHz);
+  if (fits < 1) fits = 1;
+  return fits < count ? fits : count;
+}
+
+ImuVoter::ImuVoter() {
+  bool present[IMU_MAX_COUNT] = {true};
+  begin(1, present);
+}
+
+void ImuVoter::begin(uint32_t imuCount, const bool* present) {
+  count = imuCount > IMU_MAX_COUNT ? IMU_MAX_COUNT : imuCount;
+  memset(last, 0, sizeof(last));
+  memset(repeats, 0, sizeof(repeats));
+  memset(failures, 0, sizeof(failures));
+  memset(faultCounts, 0, sizeof(faultCounts));
+  memset(accelOffsets, 0, sizeof(accelOffsets));
+  memset(gyroOffsets, 0, sizeof(gyroOffsets));
+  memset(usable, 0, sizeof(usable));
+  usedCount = 0;
+  clippedAxes = 0;
+  fittedCount = 0;
+  for (uint32_t i = 0; i < IMU_MAX_COUNT; i++) {
+    health[i] = (i < count && present[i]) ? IMU_HEALTHY : IMU_ABSENT;
+    if (health[i] == IMU_HEALTHY) fittedCount++;
+  }
+}
+
+void ImuVoter::setHealth(uint32_t index, ImuHealth state) {
+  if (health[index] == IMU_HEALTHY && state != IMU_HEALTHY) faultCounts[index]++;
+  health[index] = state;
+}
+
+void ImuVoter::track(uint32_t index, const ImuFrame& frame) {
+  // Even at rest or in free fall the gyro shows noise; six exact zeros are
+  // a cleared buffer from a read that did not complete
+  bool allZero = true;
+  for (int axis = 0; axis < 3; axis++) {
+    if (frame.accel[axis] != 0 || frame.gyro[axis] != 0) allZero = false;
+  }
+
+  if (frame.status == IMU_FRAME_FAILED || allZero) {
+    repeats[index] = 0;
+    if (++failures[index] >= IMU_FAILED_READINGS) setHealth(index, IMU_DETACHED);
+    return;
+  }
+  failures[index] = 0;
+
+  // A live sensor's LSBs never repeat all six axes for long; a frame that
+  // does is a latched register file or a dead ADC
+  bool same = memcmp(last[index].accel, frame.accel, sizeof(frame.accel)) == 0 &&
+              memcmp(last[index].gyro, frame.gyro, sizeof(frame.gyro)) == 0;
+  repeats[index] = same ? repeats[index] + 1 : 0;
+  last[index] = frame;
+
+  if (repeats[index] + 1 >= IMU_STUCK_READINGS) {
+    setHealth(index, IMU_STUCK);
+  } else if (health[index] != IMU_HEALTHY) {
+    setHealth(index, IMU_HEALTHY);
+  }
+}
+
+float ImuVoter::vote(const float* values, const bool* clipped, uint32_t valueCount,
+                     bool& allClipped) const {
+  float inRange[IMU_MAX_COUNT];
+  uint32_t n = 0;
+  for (uint32_t i = 0; i < valueCount; i++) {
+    if (!clipped[i]) inRange[n++] = values[i];
+  }
+
+  allClipped = n == 0;
+  if (allClipped) {
+    float largest = values[0];
+    for (uint32_t i = 1; i < valueCount; i++) {
+      if ((values[i] < 0 ? -values[i] : values[i]) > (largest < 0 ? -largest : largest)) {
+        largest = values[i];
+      }
+    }
+    return largest;
+  }
+
+  // Insertion sort: at most IMU_MAX_COUNT values
+  for (uint32_t i = 1; i < n; i++) {
+    float value = inRange[i];
+    uint32_t j = i;
+    for (; j > 0 && inRange[j - 1] > value; j--) inRange[j] = inRange[j - 1];
+    inRange[j] = value;
+  }
+  return (n & 1) ? inRange[n / 2] : 0.5f * (inRange[n / 2 - 1] + inRange[n / 2]);
+}
+
+bool ImuVoter::update(const ImuFrame* frames, float& accelX, float& accelY, float& accelZ,
+                      float& gyroX, float& gyroY, float& gyroZ) {
+  usedCount = 0;
+  uint32_t used[IMU_MAX_COUNT];
+  for (uint32_t i = 0; i < count; i++) {
+    usable[i] = false;
+    if (health[i] == IMU_ABSENT || frames[i].status == IMU_FRAME_SKIPPED) continue;
+    track(i, frames[i]);
+    if (health[i] == IMU_HEALTHY && failures[i] == 0) {
+      usable[i] = true;
+      used[usedCount++] = i;
+    }
+  }
+
+  float fused[6] = {0, 0, 0, 0, 0, 0};
+  clippedAxes = 0;
+  if (usedCount > 0) {
+    for (int axis = 0; axis < 6; axis++) {
+      float values[IMU_MAX_COUNT];
+      bool clipped[IMU_MAX_COUNT];
+      for (uint32_t k = 0; k < usedCount; k++) {
+        const ImuFrame& frame = frames[used[k]];
+        int16_t raw = axis < 3 ? frame.accel[axis] : frame.gyro[axis - 3];
+        clipped[k] = raw >= IMU_SATURATION_COUNTS || raw <= -IMU_SATURATION_COUNTS;
+        values[k] = axis < 3
+            ? raw / MPU6050_ACCEL_LSB_PER_G - accelOffsets[used[k]][axis]
+            : raw / MPU6050_GYRO_LSB_PER_DPS - gyroOffsets[used[k]][axis - 3];
+      }
+      bool allClipped;
+      fused[axis] = vote(values, clipped, usedCount, allClipped);
+      if (allClipped) clippedAxes |= 1u << axis;
+    }
+  }
+
+  accelX = fused[0];
+  accelY = fused[1];
+  accelZ = fused[2];
+  gyroX = fused[3];
+  gyroY = fused[4];
+  gyroZ = fused[5];
+  return usedCount > 0;
+}
+
+void ImuVoter::setOffsets(uint32_t index, const float* accel, const float* gyro) {
+  if (index >= IMU_MAX_COUNT) return;
+  memcpy(accelOffsets[index], accel, sizeof(accelOffsets[index]));
+  memcpy(gyroOffsets[index], gyro, sizeof(gyroOffsets[index]));
+}
+
+void ImuVoter::getOffsets(uint32_t index, float* accel, float* gyro) const {
+  if (index >= IMU_MAX_COUNT) return;
+  memcpy(accel, accelOffsets[index], sizeof(accelOffsets[index]));
+  memcpy(gyro, gyroOffsets[index], sizeof(gyroOffsets[index]));
+}
+
+uint32_t ImuVoter::getCount() const {
+  return count;
+}
+
+uint32_t ImuVoter::getFittedCount() const {
+  return fittedCount;
+}
+
+ImuHealth ImuVoter::getHealth(uint32_t index) const {
+  return index < count ? health[index] : IMU_ABSENT;
+}
+
+uint32_t ImuVoter::getFaultCount(uint32_t index) const {
+  return index < count ? faultCounts[index] : 0;
+}
+
+uint32_t ImuVoter::getHealthyCount() const {
+  uint32_t healthy = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    if (health[i] == IMU_HEALTHY) healthy++;
+  }
+  return healthy;
+}
+
+uint32_t ImuVoter::getUsedCount() const {
+  return usedCount;
+}
+
+uint32_t ImuVoter::getClippedAxes() const {
+  return clippedAxes;
+}
+
+const char* ImuVoter::healthName(ImuHealth state) {
+  switch (state) {
+    case IMU_HEALTHY: return "healthy";
+    case IMU_ABSENT: return "absent";
+    case IMU_DETACHED: return "detached";
+    case IMU_STUCK: return "stuck";
+  }
+  return "unknown";
+}
@@ -0,0 +1,30 @@
+#include "partition_flash.h"
+
+PartitionFlash::PartitionFlash() {
+  partition = nullptr;
+}
+
+bool PartitionFlash::begin(const char* label) {
+  partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+  return partition != nullptr;
+}
+
+uint32_t PartitionFlash::size() const {
+  return partition ? partition->size : 0;
+}
+
+uint32_t PartitionFlash::sectorSize() const {
+  return SPI_FLASH_SEC_SIZE;
+}
+
+bool PartitionFlash::read(uint32_t offset, void* data, uint32_t length) {
+  return partition && esp_partition_read(partition, offset, data, length) == ESP_OK;
+}
+
+bool PartitionFlash::write(uint32_t offset, const void* data, uint32_t length) {
+  return partition && esp_partition_write(partition, offset, data, length) == ESP_OK;
+}
+
+bool PartitionFlash::eraseSector(uint32_t offset) {
+  return partition && esp_partition_erase_range(partition, offset, SPI_FLASH_SEC_SIZE) == ESP_OK;
+}
@@ -0,0 +1,275 @@
+#include "position_estimator.h"
+#include <math.h>
+#include <string.h>
+
+#define METRES_PER_DEGREE_LATITUDE 111320.0
+#define STANDARD_GRAVITY 9.80665f
+#define DEG_TO_RADIANS 0.017453293f
+#define POSITION_PI 3.14159265f
+
+// Speed assumed while the heading is unknown, to grow the position error
+#define UNKNOWN_HEADING_SPEED 10.0f
+// Fix-to-fix distance needed to initialise the heading
+#define HEADING_INIT_DISTANCE_M 5.0f
+// Longest gap integrated in one step (dropped samples)
+#define MAX_PREDICT_DT 1.0f
+
+static float wrapAngle(float angle) {
+  while (angle > POSITION_PI) angle -= 2.0f * POSITION_PI;
+  while (angle < -POSITION_PI) angle += 2.0f * POSITION_PI;
+  return angle;
+}
+
+PositionEstimator::PositionEstimator() {
+  reset();
+}
+
+void PositionEstimator::reset() {
+  hasOrigin = false;
+  headingKnown = false;
+  originLatitude = 0.0;
+  originLongitude = 0.0;
+  metresPerDegreeLongitude = METRES_PER_DEGREE_LATITUDE;
+  memset(state, 0, sizeof(state));
+  memset(covariance, 0, sizeof(covariance));
+  lastMicros = 0;
+  lastFixMicros = 0;
+  lastFixEast = 0.0f;
+  lastFixNorth = 0.0f;
+  fixCount = 0;
+}
+
+void PositionEstimator::toLocal(double latitude, double longitude, float& east, float& north) const {
+  east = (float)((longitude - originLongitude) * metresPerDegreeLongitude);
+  north = (float)((latitude - originLatitude) * METRES_PER_DEGREE_LATITUDE);
+}
+
+void PositionEstimator::startAt(double latitude, double longitude) {
+  originLatitude = latitude;
+  originLongitude = longitude;
+  metresPerDegreeLongitude = METRES_PER_DEGREE_LATITUDE * cos(latitude * M_PI / 180.0);
+  hasOrigin = true;
+
+  const float gpsVariance = POSITION_GPS_SIGMA_M * POSITION_GPS_SIGMA_M;
+  memset(state, 0, sizeof(state));
+  memset(covariance, 0, sizeof(covariance));
+  covariance[0][0] = gpsVariance;
+  covariance[1][1] = gpsVariance;
+  covariance[2][2] = UNKNOWN_HEADING_SPEED * UNKNOWN_HEADING_SPEED;
+  covariance[3][3] = POSITION_PI * POSITION_PI;
+}
+
+void PositionEstimator::recentre() {
+  // Keep float metres precise: move the origin under the estimate
+  double latitude, longitude;
+  getPosition(latitude, longitude);
+  float east = state[0];
+  float north = state[1];
+
+  originLatitude = latitude;
+  originLongitude = longitude;
+  metresPerDegreeLongitude = METRES_PER_DEGREE_LATITUDE * cos(latitude * M_PI / 180.0);
+  state[0] = 0.0f;
+  state[1] = 0.0f;
+  lastFixEast -= east;
+  lastFixNorth -= north;
+}
+
+void PositionEstimator::predict(float dt, float accel, float yawRate) {
+  float speed = state[2];
+  float heading = state[3];
+  float c = cosf(heading);
+  float s = sinf(heading);
+
+  state[2] += accel * dt;
+  state[3] = wrapAngle(heading + yawRate * dt);
+
+  if (!headingKnown) {
+    // Position is held until fixes give a direction; let its error grow
+    // as if moving at a typical speed
+    covariance[0][0] += UNKNOWN_HEADING_SPEED * UNKNOWN_HEADING_SPEED * dt * dt;
+    covariance[1][1] += UNKNOWN_HEADING_SPEED * UNKNOWN_HEADING_SPEED * dt * dt;
+    covariance[2][2] += POSITION_ACCEL_SIGMA * POSITION_ACCEL_SIGMA * dt;
+    return;
+  }
+
+  state[0] += speed * c * dt;
+  state[1] += speed * s * dt;
+
+  // P = F P F' + Q, F = I except the position rows
+  float f[4][4] = {
+    {1.0f, 0.0f, c * dt, -speed * s * dt},
+    {0.0f, 1.0f, s * dt, speed * c * dt},
+    {0.0f, 0.0f, 1.0f, 0.0f},
+    {0.0f, 0.0f, 0.0f, 1.0f}
+  };
+  float fp[4][4];
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 4; j++) {
+      float sum = 0.0f;
+      for (int k = 0; k < 4; k++) sum += f[i][k] * covariance[k][j];
+      fp[i][j] = sum;
+    }
+  }
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 4; j++) {
+      float sum = 0.0f;
+      for (int k = 0; k < 4; k++) sum += fp[i][k] * f[j][k];
+      covariance[i][j] = sum;
+    }
+  }
+
+  // Sensor errors are mostly bias, so noise is a random walk in speed and
+  // heading
+  covariance[0][0] += 0.01f * dt;
+  covariance[1][1] += 0.01f * dt;
+  covariance[2][2] += POSITION_ACCEL_SIGMA * POSITION_ACCEL_SIGMA * dt;
+  covariance[3][3] += POSITION_GYRO_SIGMA * POSITION_GYRO_SIGMA * dt;
+}
+
+void PositionEstimator::correct(float east, float north) {
+  const float gpsVariance = POSITION_GPS_SIGMA_M * POSITION_GPS_SIGMA_M;
+
+  // Innovation and its covariance S = H P H' + R (H picks east, north)
+  float innovation[2] = {east - state[0], north - state[1]};
+  float s00 = covariance[0][0] + gpsVariance;
+  float s01 = covariance[0][1];
+  float s11 = covariance[1][1] + gpsVariance;
+  float determinant = s00 * s11 - s01 * s01;
+  if (determinant <= 0.0f) return;
+  float i00 = s11 / determinant;
+  float i01 = -s01 / determinant;
+  float i11 = s00 / determinant;
+
+  // K = P H' S^-1
+  float gain[4][2];
+  for (int i = 0; i < 4; i++) {
+    gain[i][0] = covariance[i][0] * i00 + covariance[i][1] * i01;
+    gain[i][1] = covariance[i][0] * i01 + covariance[i][1] * i11;
+  }
+
+  for (int i = 0; i < 4; i++) {
+    state[i] += gain[i][0] * innovation[0] + gain[i][1] * innovation[1];
+  }
+  state[3] = wrapAngle(state[3]);
+
+  // P = (I - K H) P, then symmetrise against rounding
+  float p0[4], p1[4];
+  for (int j = 0; j < 4; j++) {
+    p0[j] = covariance[0][j];
+    p1[j] = covariance[1][j];
+  }
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 4; j++) {
+      covariance[i][j] -= gain[i][0] * p0[j] + gain[i][1] * p1[j];
+    }
+  }
+  for (int i = 0; i < 4; i++) {
+    for (int j = i + 1; j < 4; j++) {
+      float mean = 0.5f * (covariance[i][j] + covariance[j][i]);
+      covariance[i][j] = mean;
+      covariance[j][i] = mean;
+    }
+  }
+}
+
+void PositionEstimator::update(SensorData& data) {
+  uint64_t now = data.sampleMicros ? data.sampleMicros : (uint64_t)data.timestamp * 1000;
+
+  if (hasOrigin && now > lastMicros) {
+    float dt = (float)(now - lastMicros) / 1000000.0f;
+    if (dt > MAX_PREDICT_DT) dt = MAX_PREDICT_DT;
+    predict(dt, data.accelX * STANDARD_GRAVITY, data.gyroZ * DEG_TO_RADIANS);
+  }
+  if (now > lastMicros) lastMicros = now;
+
+  // GGA and RMC of one burst report the same fix
+  bool newFix = data.gpsFixMicros && data.gpsFixMicros != lastFixMicros &&
+                (data.latitude != 0.0f || data.longitude != 0.0f);
+  if (newFix) {
+    if (!hasOrigin) {
+      startAt(data.latitude, data.longitude);
+    } else {
+      float east, north;
+      toLocal(data.latitude, data.longitude, east, north);
+
+      if (!headingKnown) {
+        float dx = east - lastFixEast;
+        float dy = north - lastFixNorth;
+        float distance = sqrtf(dx * dx + dy * dy);
+        float interval = (float)(data.gpsFixMicros - lastFixMicros) / 1000000.0f;
+        if (distance >= HEADING_INIT_DISTANCE_M && interval > 0.0f) {
+          state[2] = distance / interval;
+          state[3] = atan2f(dy, dx);
+          for (int i = 0; i < 4; i++) {
+            for (int j = 2; j < 4; j++) {
+              covariance[i][j] = 0.0f;
+              covariance[j][i] = 0.0f;
+            }
+          }
+          // Two noisy fixes a few metres apart
+          float spread = POSITION_GPS_SIGMA_M * 1.414f / distance;
+          covariance[2][2] = spread * spread * state[2] * state[2] + 1.0f;
+          covariance[3][3] = spread * spread + 0.01f;
+          headingKnown = true;
+        }
+      }
+
+      lastFixEast = east;
+      lastFixNorth = north;
+
+      // The fix is for an instant in the past: move it forward to now
+      if (headingKnown && now > data.gpsFixMicros) {
+        float lag = (float)(now - data.gpsFixMicros) / 1000000.0f;
+        east += state[2] * cosf(state[3]) * lag;
+        north += state[2] * sinf(state[3]) * lag;
+      }
+      correct(east, north);
+    }
+    lastFixMicros = data.gpsFixMicros;
+    fixCount++;
+
+    if (state[0] * state[0] + state[1] * state[1] > POSITION_RECENTRE_M * POSITION_RECENTRE_M) {
+      recentre();
+    }
+  }
+
+  if (hasOrigin) {
+    double latitude, longitude;
+    getPosition(latitude, longitude);
+    data.latitude = (float)latitude;
+    data.longitude = (float)longitude;
+    data.positionErrorM = getErrorMetres();
+    data.missing &= ~SENSOR_GPS;
+    if (!newFix) data.quality |= QUALITY_POSITION_ESTIMATED;
+  }
+}
+
+bool PositionEstimator::hasPosition() const {
+  return hasOrigin;
+}
+
+void PositionEstimator::getPosition(double& latitude, double& longitude) const {
+  latitude = originLatitude + state[1] / METRES_PER_DEGREE_LATITUDE;
+  longitude = originLongitude + state[0] / metresPerDegreeLongitude;
+}
+
+float PositionEstimator::getErrorMetres() const {
+  if (!hasOrigin) return 0.0f;
+  return sqrtf(covariance[0][0] + covariance[1][1]);
+}
+
+float PositionEstimator::getSpeed() const {
+  return state[2];
+}
+
+float PositionEstimator::getHeadingDegrees() const {
+  float degrees = 90.0f - state[3] / DEG_TO_RADIANS;
+  while (degrees < 0.0f) degrees += 360.0f;
+  while (degrees >= 360.0f) degrees -= 360.0f;
+  return degrees;
+}
+
+uint32_t PositionEstimator::getFixCount() const {
+  return fixCount;
+}
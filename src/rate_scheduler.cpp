@@ -0,0 +1,144 @@
+#include "rate_scheduler.h"
+#include <math.h>
+#include <string.h>
+
+RateScheduler::RateScheduler() {
+  begin();
+}
+
+void RateScheduler::begin() {
+  memset(tasks, 0, sizeof(tasks));
+  memset(order, 0, sizeof(order));
+  count = 0;
+  started = false;
+}
+
+int RateScheduler::add(const char* name, RateRelease kind, uint32_t periodMicros, uint32_t deadlineMicros,
+                       uint32_t budgetMicros, uint32_t phaseMicros) {
+  if (count >= RATE_TASK_MAX || started) return -1;
+  int id = count++;
+  Task& task = tasks[id];
+  task.name = name;
+  task.kind = kind;
+  task.periodMicros = periodMicros;
+  task.deadlineMicros = deadlineMicros;
+  task.budgetMicros = budgetMicros;
+  task.phaseMicros = phaseMicros;
+
+  // Rate-monotonic: shorter period, higher priority; equal periods keep the
+  // order they were added in
+  int slot = id;
+  while (slot > 0 && tasks[order[slot - 1]].periodMicros > periodMicros) {
+    order[slot] = order[slot - 1];
+    slot--;
+  }
+  order[slot] = (uint8_t)id;
+  return id;
+}
+
+void RateScheduler::start(uint64_t nowMicros) {
+  for (uint32_t i = 0; i < count; i++) {
+    Task& task = tasks[i];
+    task.releaseMicros = nowMicros + task.phaseMicros;
+    task.pending = false;
+    memset(&task.stats, 0, sizeof(task.stats));
+  }
+  started = true;
+}
+
+bool RateScheduler::isStarted() const {
+  return started;
+}
+
+void RateScheduler::release(int task, uint64_t releaseMicros) {
+  if (task < 0 || (uint32_t)task >= count) return;
+  Task& t = tasks[task];
+  if (t.kind != RATE_SPORADIC) return;
+  if (t.pending) t.stats.skipped++;
+  t.releaseMicros = releaseMicros;
+  t.pending = true;
+}
+
+bool RateScheduler::isDue(const Task& task, uint64_t nowMicros) const {
+  if (task.kind == RATE_SPORADIC) return task.pending;
+  return task.periodMicros > 0 && task.releaseMicros <= nowMicros;
+}
+
+int RateScheduler::next(uint64_t nowMicros) {
+  if (!started) return -1;
+  for (uint32_t i = 0; i < count; i++) {
+    if (isDue(tasks[order[i]], nowMicros)) return order[i];
+  }
+  return -1;
+}
+
+void RateScheduler::complete(int task, uint64_t startMicros, uint64_t endMicros) {
+  if (task < 0 || (uint32_t)task >= count) return;
+  Task& t = tasks[task];
+  RateTaskStats& stats = t.stats;
+
+  uint32_t run = endMicros > startMicros ? (uint32_t)(endMicros - startMicros) : 0;
+  uint32_t response = endMicros > t.releaseMicros ? (uint32_t)(endMicros - t.releaseMicros) : 0;
+  stats.runs++;
+  stats.lastRunMicros = run;
+  if (run > stats.maxRunMicros) stats.maxRunMicros = run;
+  if (response > stats.maxResponseMicros) stats.maxResponseMicros = response;
+  if (run > t.budgetMicros) stats.overruns++;
+  if (response > t.deadlineMicros) stats.deadlineMisses++;
+
+  if (t.kind == RATE_SPORADIC) {
+    t.pending = false;
+    return;
+  }
+  // Releases that passed before this run finished are dropped; the next is
+  // the first one still ahead, on the original grid
+  if (t.periodMicros == 0) return;
+  uint64_t passed = endMicros > t.releaseMicros ? (endMicros - t.releaseMicros) / t.periodMicros : 0;
+  stats.skipped += (uint32_t)passed;
+  t.releaseMicros += (passed + 1) * t.periodMicros;
+}
+
+uint32_t RateScheduler::getWaitMicros(uint64_t nowMicros) const {
+  uint64_t wait = UINT32_MAX;
+  for (uint32_t i = 0; i < count; i++) {
+    const Task& task = tasks[i];
+    if (isDue(task, nowMicros)) return 0;
+    if (task.kind == RATE_PERIODIC && task.periodMicros > 0 && task.releaseMicros - nowMicros < wait) {
+      wait = task.releaseMicros - nowMicros;
+    }
+  }
+  return (uint32_t)wait;
+}
+
+float RateScheduler::getUtilization() const {
+  float utilization = 0.0f;
+  for (uint32_t i = 0; i < count; i++) {
+    if (tasks[i].periodMicros > 0) {
+      utilization += (float)tasks[i].budgetMicros / tasks[i].periodMicros;
+    }
+  }
+  return utilization;
+}
+
+bool RateScheduler::fitsRateMonotonicBound() const {
+  if (count == 0) return true;
+  float bound = count * (powf(2.0f, 1.0f / count) - 1.0f);
+  return getUtilization() <= bound;
+}
+
+uint32_t RateScheduler::getTaskCount() const {
+  return count;
+}
+
+const char* RateScheduler::getName(int task) const {
+  return (task >= 0 && (uint32_t)task < count) ? tasks[task].name : "";
+}
+
+uint32_t RateScheduler::getPeriodMicros(int task) const {
+  return (task >= 0 && (uint32_t)task < count) ? tasks[task].periodMicros : 0;
+}
+
+const RateTaskStats& RateScheduler::getStats(int task) const {
+  static const RateTaskStats none = {};
+  return (task >= 0 && (uint32_t)task < count) ? tasks[task].stats : none;
+}
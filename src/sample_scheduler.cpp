@@ -0,0 +1,91 @@
+#include "sample_scheduler.h"
+
+SampleScheduler::SampleScheduler() {
+  begin(0, false, 0);
+}
+
+void SampleScheduler::begin(uint32_t periodMicros, bool interruptDriven, uint64_t nowMicros) {
+  this->periodMicros = periodMicros;
+  this->interruptDriven = interruptDriven;
+  interruptAlive = interruptDriven;
+  lastSampleMicros = nowMicros;
+  samples = 0;
+  missed = 0;
+  fallbacks = 0;
+  wakeups = 0;
+}
+
+uint32_t SampleScheduler::getWaitMicros(uint64_t nowMicros) const {
+  // Waiting on an edge, allow it half a period of lateness before the timer
+  // takes over
+  uint64_t due = lastSampleMicros + periodMicros;
+  if (interruptAlive) due += periodMicros / 2;
+  return due > nowMicros ? (uint32_t)(due - nowMicros) : 0;
+}
+
+uint32_t SampleScheduler::getWaitMillis(uint64_t nowMicros) const {
+  return (getWaitMicros(nowMicros) + 999) / 1000;
+}
+
+bool SampleScheduler::onWake(uint32_t edges, uint64_t nowMicros) {
+  wakeups++;
+  if (periodMicros == 0) return false;
+
+  if (edges > 0) {
+    // Edges beyond the first are samples the MPU overwrote before the loop
+    // got to them
+    interruptAlive = true;
+    missed += edges - 1;
+    samples++;
+    lastSampleMicros = nowMicros;
+    return true;
+  }
+
+  if (interruptAlive) {
+    // Woken by the timeout: the edge is overdue, so sample now and keep
+    // sampling on the timer until edges come back
+    if (nowMicros - lastSampleMicros < periodMicros + periodMicros / 2) return false;
+    interruptAlive = false;
+    fallbacks++;
+    samples++;
+    lastSampleMicros = nowMicros;
+    return true;
+  }
+
+  // Timer: on the period grid, so a late wake does not shift later samples
+  if (nowMicros - lastSampleMicros < periodMicros) return false;
+  uint64_t periods = (nowMicros - lastSampleMicros) / periodMicros;
+  missed += (uint32_t)(periods - 1);
+  if (interruptDriven) fallbacks++;
+  samples++;
+  lastSampleMicros += periods * periodMicros;
+  return true;
+}
+
+bool SampleScheduler::isInterruptDriven() const {
+  return interruptDriven;
+}
+
+bool SampleScheduler::isInterruptAlive() const {
+  return interruptAlive;
+}
+
+uint32_t SampleScheduler::getPeriodMicros() const {
+  return periodMicros;
+}
+
+uint32_t SampleScheduler::getSamples() const {
+  return samples;
+}
+
+uint32_t SampleScheduler::getMissed() const {
+  return missed;
+}
+
+uint32_t SampleScheduler::getFallbacks() const {
+  return fallbacks;
+}
+
+uint32_t SampleScheduler::getWakeups() const {
+  return wakeups;
+}
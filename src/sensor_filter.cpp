@@ -0,0 +1,101 @@
+#include "sensor_filter.h"
+#include <math.h>
+
+// Fractional bits kept below one sensor count in the fixed-point path
+#define FIXED_SAMPLE_SHIFT 12
+
+SensorFilter::SensorFilter() {
+  primed = false;
+}
+
+static bool usableFrequency(float frequencyHz, float sampleRateHz, const char* name) {
+  if (frequencyHz <= 0) return false;
+  if (frequencyHz >= sampleRateHz / 2) {
+    Serial.printf("SensorFilter: %s %.1f Hz is not below Nyquist (%.1f Hz), ignored\n",
+                  name, frequencyHz, sampleRateHz / 2);
+    return false;
+  }
+  return true;
+}
+
+void SensorFilter::design(int axis, float lowPassHz) {
+  BiquadCascade& cascade = cascades[axis];
+  BiquadCascadeFixed& fixedCascade = fixedCascades[axis];
+  cascade.clear();
+  fixedCascade.clear();
+  float rate = config.sampleRateHz;
+
+  BiquadCoefficients sections[FILTER_MAX_BIQUADS];
+  int count = 0;
+  if (usableFrequency(config.highPassHz, rate, "high-pass")) {
+    sections[count++] = designHighPass(config.highPassHz, rate, butterworthQ(2, 0));
+  }
+  if (usableFrequency(config.notchHz, rate, "notch")) {
+    sections[count++] = designNotch(config.notchHz, rate, config.notchQ);
+  }
+  if (usableFrequency(lowPassHz, rate, "low-pass")) {
+    int order = constrain(config.lowPassOrder & ~1, 2, 2 * (FILTER_MAX_BIQUADS - count));
+    for (int i = 0; i < order / 2; i++) {
+      sections[count++] = designLowPass(lowPassHz, rate, butterworthQ(order, i));
+    }
+  }
+
+  for (int i = 0; i < count; i++) {
+    cascade.add(sections[i]);
+    fixedCascade.add(sections[i]);
+  }
+}
+
+void SensorFilter::begin(const FilterConfig& filterConfig) {
+  config = filterConfig;
+  for (int axis = 0; axis < 3; axis++) {
+    design(axis, config.accelLowPassHz);
+    design(axis + 3, config.gyroLowPassHz);
+  }
+  primed = false;
+
+  if (!isActive()) {
+    Serial.println("SensorFilter: Pass-through (no stages configured)");
+    return;
+  }
+  Serial.printf("SensorFilter: %.1f Hz, accel %d / gyro %d sections, %s\n",
+                config.sampleRateHz, cascades[0].size(), cascades[3].size(),
+                config.fixedPoint ? "fixed point" : "float");
+}
+
+float SensorFilter::step(int axis, float value, float lsbPerUnit) {
+  if (!config.fixedPoint) {
+    if (!primed) cascades[axis].reset(value);
+    return cascades[axis].process(value);
+  }
+
+  float scale = lsbPerUnit * (1 << FIXED_SAMPLE_SHIFT);
+  int32_t raw = (int32_t)lrintf(value * scale);
+  if (!primed) fixedCascades[axis].reset(raw);
+  return fixedCascades[axis].process(raw) / scale;
+}
+
+void SensorFilter::process(SensorData& data) {
+  // A zero-filled reading would ring through the filter as a step
+  if (!isActive() || (data.missing & SENSOR_IMU)) return;
+
+  data.accelX = step(0, data.accelX, MPU6050_ACCEL_LSB_PER_G);
+  data.accelY = step(1, data.accelY, MPU6050_ACCEL_LSB_PER_G);
+  data.accelZ = step(2, data.accelZ, MPU6050_ACCEL_LSB_PER_G);
+  data.gyroX = step(3, data.gyroX, MPU6050_GYRO_LSB_PER_DPS);
+  data.gyroY = step(4, data.gyroY, MPU6050_GYRO_LSB_PER_DPS);
+  data.gyroZ = step(5, data.gyroZ, MPU6050_GYRO_LSB_PER_DPS);
+  primed = true;
+}
+
+void SensorFilter::reset() {
+  primed = false;
+}
+
+bool SensorFilter::isActive() const {
+  return cascades[0].size() > 0 || cascades[3].size() > 0;
+}
+
+FilterConfig SensorFilter::getConfig() const {
+  return config;
+}
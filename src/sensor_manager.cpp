@@ -1,40 +1,131 @@
 #include "sensor_manager.h"
+#include "status_format.h"
+#include <Preferences.h>
+
+// The MPU outputs one sample per SENSOR_READ_INTERVAL, so the last edge is
+// never older than that while INT works; an older one means the pin has
+// gone quiet, and the read time is used instead
+#define DATA_READY_MAX_AGE_US ((uint32_t)SENSOR_READ_INTERVAL * 1000)
+
+// 10 bits per byte on the GPS UART
+#define GPS_BYTE_MICROS (10000000UL / GPS_BAUD_RATE)
+// Bytes arriving after a longer silence start a new NMEA burst
+#define GPS_BURST_GAP_US 200000
+
+static const uint8_t imuAddresses[] = IMU_ADDRESSES;
+static_assert(sizeof(imuAddresses) >= IMU_COUNT, "IMU_ADDRESSES needs an address per IMU");
+static_assert(SENSOR_READ_INTERVAL >= 1 && SENSOR_READ_INTERVAL <= 256,
+              "SMPLRT_DIV sets the MPU6050 output period from 1 to 256 ms");
+static_assert(MPU6050_DLPF_MODE != MPU6050_DLPF_BW_256,
+              "MPU6050_RATE_DIVIDER assumes the 1 kHz gyro rate of the DLPF");
+
+void IRAM_ATTR SensorManager::onDataReady(void* manager) {
+  SensorManager* self = (SensorManager*)manager;
+  self->dataReadyMicros = (uint32_t)Clock::micros64();
+  self->dataReadyCount = self->dataReadyCount + 1;
+  if (self->dataReadyTask) {
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(self->dataReadyTask, &woken);
+    if (woken) portYIELD_FROM_ISR();
+  }
+}
+
+volatile uint32_t SensorManager::ppsMicros = 0;
+volatile uint32_t SensorManager::ppsCount = 0;
+
+void IRAM_ATTR SensorManager::onPpsEdge() {
+  ppsMicros = (uint32_t)Clock::micros64();
+  ppsCount = ppsCount + 1;
+}
 
 SensorManager::SensorManager() {
   gpsSerial = nullptr;
+  health = nullptr;
+  dataReadyMicros = 0;
+  dataReadyCount = 0;
+  dataReadyTask = nullptr;
+  dataReadyAttached = false;
   mpuInitialized = false;
   gpsInitialized = false;
   lastSensorRead = 0;
-  
-  // Initialize calibration offsets to zero
-  accelOffsetX = accelOffsetY = accelOffsetZ = 0.0;
-  gyroOffsetX = gyroOffsetY = gyroOffsetZ = 0.0;
+  gpsBurstMicros = 0;
+  gpsLastByteMicros = 0;
+  gpsFixMicros = 0;
+  lastPpsCount = 0;
+  memset(&imuSlot, 0, sizeof(imuSlot));
+  imuSlot.missing = SENSOR_IMU;
+  rangeSlot = -1;
+  rangeSlotMicros = 0;
+  fixSlotLatitude = 0;
+  fixSlotLongitude = 0;
+  fixSlotFresh = false;
+  fixSlotMicros = 0;
+  imuReadsPerRound = 1;
+  imuNextRead = 0;
+  busResets = 0;
+  biasChanged = false;
+  lastBiasSave = 0;
+  
+  for (uint32_t i = 0; i < IMU_COUNT; i++) {
+    imus[i] = new MPU6050(imuAddresses[i]);
+  }
 }
 
 SensorManager::~SensorManager() {
+#if MPU_INT_PIN >= 0
+  if (dataReadyAttached) detachInterrupt(digitalPinToInterrupt(MPU_INT_PIN));
+#endif
   if (gpsSerial) {
     delete gpsSerial;
   }
+  for (uint32_t i = 0; i < IMU_COUNT; i++) {
+    delete imus[i];
+  }
 }
 
-bool SensorManager::begin() {
+bool SensorManager::begin(ClockDiscipline* utcClock) {
   Serial.println("SensorManager: Initializing sensors...");
   
-  // Initialize I2C for MPU6050
-  Wire.begin(SDA_PIN, SCL_PIN);
+  // Initialize I2C for the MPU6050s; fast mode keeps their bursts within
+  // one 1 kHz period. A bus left hung by a reset mid-read is cleared first.
+  i2c.begin(&i2cPort, I2C_CLOCK_HZ);
+  if (i2c.getStats().recoveries > 0) {
+    Serial.println("SensorManager: Cleared a hung I2C bus");
+  }
   
-  // Initialize MPU6050
-  mpu.initialize();
-  if (!mpu.testConnection()) {
-    Serial.println("SensorManager: MPU6050 connection failed");
-    mpuInitialized = false;
-  } else {
-    // Configure MPU6050
-    mpu.setFullScaleAccelRange(MPU6050_ACCEL_RANGE);
-    mpu.setFullScaleGyroRange(MPU6050_GYRO_RANGE);
-    mpu.setDLPFMode(MPU6050_DLPF_MODE);
-    mpuInitialized = true;
-    Serial.println("SensorManager: MPU6050 initialized successfully");
+  // Initialize each MPU6050
+  bool present[IMU_COUNT];
+  uint32_t found = 0;
+  for (uint32_t i = 0; i < IMU_COUNT; i++) {
+    present[i] = configureImu(i);
+    if (!present[i]) {
+      Serial.printf("SensorManager: MPU6050 at 0x%02X connection failed\n", imuAddresses[i]);
+      continue;
+    }
+    
+#if MPU_INT_PIN >= 0
+    // Timestamp each new sample at the first IMU's data-ready edge, which
+    // also wakes the loop to read it; the others are read right after it
+    if (found == 0) {
+      imus[i]->setIntDataReadyEnabled(true);
+      pinMode(MPU_INT_PIN, INPUT);
+      attachInterruptArg(digitalPinToInterrupt(MPU_INT_PIN), onDataReady, this, RISING);
+      dataReadyAttached = true;
+    }
+#endif
+    found++;
+    Serial.printf("SensorManager: MPU6050 at 0x%02X initialized successfully\n", imuAddresses[i]);
+  }
+  imuVoter.begin(IMU_COUNT, present);
+  mpuInitialized = found > 0;
+  loadCalibration();
+  
+  imuReadsPerRound = imuReadsPerSample(found, i2c.getClockHz(), IMU_SAMPLE_BUDGET_US);
+  imuNextRead = 0;
+  busResets = i2c.getStats().recoveries + i2c.getStats().reinits;
+  if (found > 0 && imuReadsPerRound < found) {
+    Serial.printf("SensorManager: Warning - %lu IMU reads exceed %d us, reading %lu per sample\n",
+                  (unsigned long)found, IMU_SAMPLE_BUDGET_US, (unsigned long)imuReadsPerRound);
   }
   
   // Initialize pin modes
@@ -45,6 +136,12 @@ bool SensorManager::begin() {
   // Initialize GPS
   gpsSerial = new SoftwareSerial(GPS_RX_PIN, GPS_TX_PIN);
   gpsSerial->begin(GPS_BAUD_RATE);
+  gpsTime.begin(utcClock);
+#if GPS_PPS_PIN >= 0
+  lastPpsCount = ppsCount;
+  pinMode(GPS_PPS_PIN, INPUT);
+  attachInterrupt(digitalPinToInterrupt(GPS_PPS_PIN), onPpsEdge, RISING);
+#endif
   gpsInitialized = true;
   Serial.println("SensorManager: GPS initialized");
   
@@ -64,32 +161,177 @@ bool SensorManager::begin() {
   return mpuInitialized; // Return true if at least MPU6050 is working
 }
 
+void SensorManager::setHealthMonitor(HealthMonitor* monitor) {
+  health = monitor;
+}
+
+void SensorManager::notifyOnDataReady(TaskHandle_t task) {
+  dataReadyTask = task;
+}
+
+bool SensorManager::hasDataReadyInterrupt() const {
+  return dataReadyAttached;
+}
+
+uint32_t SensorManager::getDataReadyCount() const {
+  return dataReadyCount;
+}
+
 SensorData SensorManager::readAllSensors() {
-  SensorData data;
-  memset(&data, 0, sizeof(SensorData));
-  
-  // Read MPU6050
-  if (mpuInitialized) {
-    readMPU6050(data.accelX, data.accelY, data.accelZ, 
-                data.gyroX, data.gyroY, data.gyroZ);
+  // IMU first: the sample time comes from its data-ready edge, so the
+  // slower sensors after it do not skew it
+  readSource(SOURCE_IMU);
+  readSource(SOURCE_ULTRASONIC);
+  readSource(SOURCE_GPS);
+  return takeSample();
+}
+
+void SensorManager::readSource(SensorSource source) {
+  // Each sensor that gives no reading is flagged missing rather than left
+  // to look like a quiet one
+  switch (source) {
+    case SOURCE_IMU: {
+      SensorData& data = imuSlot;
+      memset(&data, 0, sizeof(SensorData));
+      data.missing = SENSOR_IMU;
+      if (mpuInitialized) {
+        uint64_t readMicros = Clock::micros64();
+        if (health) health->startTask(TASK_IMU, Clock::millis());
+        bool fused = readMPU6050(data.accelX, data.accelY, data.accelZ,
+                                 data.gyroX, data.gyroY, data.gyroZ);
+        if (health) health->endTask(TASK_IMU, Clock::millis());
+        data.sampleMicros = imuSampleMicros(readMicros);
+        if (fused) {
+          data.missing &= ~SENSOR_IMU;
+          if (imuVoter.getUsedCount() < imuVoter.getFittedCount()) data.quality |= QUALITY_IMU_REDUCED;
+          if (imuVoter.getClippedAxes()) data.quality |= QUALITY_IMU_CLIPPED;
+        }
+      }
+      data.vibration = readVibrationSensor();
+      break;
+    }
+    
+    case SOURCE_ULTRASONIC:
+      rangeSlot = -1;
+      rangeSlotMicros = 0;
+      if (!health || health->shouldRun(TASK_ULTRASONIC, Clock::millis())) {
+        if (health) health->startTask(TASK_ULTRASONIC, Clock::millis());
+        rangeSlot = readUltrasonic();
+        if (health) health->endTask(TASK_ULTRASONIC, Clock::millis());
+        rangeSlotMicros = Clock::micros64();
+      }
+      break;
+    
+    case SOURCE_GPS:
+      if (!health || health->shouldRun(TASK_GPS, Clock::millis())) {
+        gpsFixMicros = 0;
+        float latitude, longitude;
+        if (health) health->startTask(TASK_GPS, Clock::millis());
+        bool located = readGPS(latitude, longitude);
+        if (health) health->endTask(TASK_GPS, Clock::millis());
+        if (located) {
+          fixSlotLatitude = latitude;
+          fixSlotLongitude = longitude;
+          fixSlotFresh = true;
+        }
+        if (gpsFixMicros) fixSlotMicros = gpsFixMicros;
+      }
+      break;
+    
+    default:
+      break;
+  }
+}
+
+SensorData SensorManager::takeSample() {
+  SensorData data = imuSlot;
+  
+  // The latest distance, unless the ping is suspended or too old to go
+  // with this sample
+  data.distance = -1;
+  if (rangeSlotMicros && Clock::micros64() - rangeSlotMicros <= ULTRASONIC_MAX_AGE_MS * 1000ULL) {
+    data.distance = rangeSlot;
+    if (data.distance < 0) data.quality |= QUALITY_NO_ECHO;
+  } else {
+    data.missing |= SENSOR_ULTRASONIC;
   }
   
-  // Read ultrasonic sensor
-  data.distance = readUltrasonic();
-  
-  // Read vibration sensor
-  data.vibration = readVibrationSensor();
-  
-  // Read GPS
-  readGPS(data.latitude, data.longitude);
+  // GPS only when it located since the last sample, as each fix is fed to
+  // the clock and position estimate once
+  if (fixSlotFresh) {
+    data.latitude = fixSlotLatitude;
+    data.longitude = fixSlotLongitude;
+  } else {
+    data.missing |= SENSOR_GPS;
+  }
+  data.gpsFixMicros = fixSlotMicros;
+  fixSlotFresh = false;
+  fixSlotMicros = 0;
   
-  // Add timestamp
-  data.timestamp = millis();
+  // Add timestamp (same time base: millis() is micros64() / 1000)
+  data.timestamp = data.sampleMicros ? (uint32_t)(data.sampleMicros / 1000) : Clock::millis();
   
-  lastSensorRead = millis();
+  lastSensorRead = Clock::millis();
   return data;
 }
 
+void SensorManager::scheduleSources(RateScheduler& scheduler) {
+  // Added in SensorSource order, so the task ids are the sources
+  scheduler.add("imu", RATE_SPORADIC, SENSOR_READ_INTERVAL * 1000UL,
+                SENSOR_READ_INTERVAL * 1000UL, SOURCE_BUDGET_IMU_US);
+  scheduler.add("ultrasonic", RATE_PERIODIC, ULTRASONIC_PERIOD_MS * 1000UL,
+                ULTRASONIC_PERIOD_MS * 1000UL, SOURCE_BUDGET_ULTRASONIC_US);
+  scheduler.add("gps", RATE_PERIODIC, GPS_PERIOD_MS * 1000UL,
+                GPS_PERIOD_MS * 1000UL, SOURCE_BUDGET_GPS_US);
+}
+
+bool SensorManager::readDueSources(RateScheduler& scheduler) {
+  bool imuRead = false;
+  int source;
+  while ((source = scheduler.next(Clock::micros64())) >= 0) {
+    uint64_t start = Clock::micros64();
+    readSource((SensorSource)source);
+    scheduler.complete(source, start, Clock::micros64());
+    if (source == SOURCE_IMU) imuRead = true;
+  }
+  return imuRead;
+}
+
+uint64_t SensorManager::imuSampleMicros(uint64_t readMicros) {
+#if MPU_INT_PIN >= 0
+  if (dataReadyCount > 0) {
+    // The ISR keeps 32 bits; widen against the read time (valid for 71 min)
+    uint32_t age = (uint32_t)readMicros - dataReadyMicros;
+    if (age <= DATA_READY_MAX_AGE_US) return readMicros - age;
+  }
+#endif
+  return readMicros;
+}
+
+bool SensorManager::configureImu(uint32_t index) {
+  MPU6050& mpu = *imus[index];
+  mpu.initialize();
+  if (!mpu.testConnection()) return false;
+  
+  // Configure MPU6050
+  mpu.setFullScaleAccelRange(MPU6050_ACCEL_RANGE);
+  mpu.setFullScaleGyroRange(MPU6050_GYRO_RANGE);
+  mpu.setDLPFMode(MPU6050_DLPF_MODE);
+#if MPU_INT_PIN >= 0
+  // Output (and data-ready) once per sample period: each edge is a reading
+  // to take, and the loop sleeps in between. Without INT it stays at 1 kHz,
+  // so a timed read finds a fresh sample.
+  mpu.setRate(MPU6050_RATE_DIVIDER);
+#endif
+  return true;
+}
+
+void SensorManager::readImuFrame(uint32_t index, ImuFrame& frame) {
+  // One 14-byte burst, so the six axes come from the same sample; a failed
+  // read comes back as IMU_FRAME_FAILED
+  i2c.readMotion(imuAddresses[index], frame);
+}
+
 bool SensorManager::readMPU6050(float& accelX, float& accelY, float& accelZ,
                                 float& gyroX, float& gyroY, float& gyroZ) {
   if (!mpuInitialized) {
@@ -98,18 +340,121 @@ bool SensorManager::readMPU6050(float& accelX, float& accelY, float& accelZ,
     return false;
   }
   
-  int16_t ax, ay, az, gx, gy, gz;
-  mpu.getMotion6(&ax, &ay, &az, &gx, &gy, &gz);
+  // Back to back, so all frames belong to the same or adjacent output
+  // samples. When they do not all fit the budget, rotate which are read.
+  ImuFrame frames[IMU_COUNT];
+  memset(frames, 0, sizeof(frames));
+  uint32_t reads = 0, k = 0;
+  for (; k < IMU_COUNT && reads < imuReadsPerRound; k++) {
+    uint32_t index = (imuNextRead + k) % IMU_COUNT;
+    if (imuVoter.getHealth(index) == IMU_ABSENT) continue;
+    readImuFrame(index, frames[index]);
+    reads++;
+  }
+  imuNextRead = (imuNextRead + k) % IMU_COUNT;
+  
+  // A bus clear or controller restart may follow a brown-out of the IMUs,
+  // which come back asleep at +-2 g: configure them again
+  const I2cStats& bus = i2c.getStats();
+  if (bus.recoveries + bus.reinits != busResets) {
+    busResets = bus.recoveries + bus.reinits;
+    for (uint32_t i = 0; i < IMU_COUNT; i++) {
+      if (imuVoter.getHealth(i) != IMU_ABSENT) configureImu(i);
+    }
+    Serial.println("SensorManager: I2C bus reset, IMUs reconfigured");
+  }
   
-  // Convert to real units and apply calibration
-  accelX = (ax / 16384.0) - accelOffsetX; // Convert to g
-  accelY = (ay / 16384.0) - accelOffsetY;
-  accelZ = (az / 16384.0) - accelOffsetZ;
-  gyroX = (gx / 131.0) - gyroOffsetX;     // Convert to degrees/second
-  gyroY = (gy / 131.0) - gyroOffsetY;
-  gyroZ = (gz / 131.0) - gyroOffsetZ;
+  // Learn the offsets from still periods, then vote, convert to g and
+  // degrees/second and apply them
+  trackBias(frames, Clock::micros64());
+  return imuVoter.update(frames, accelX, accelY, accelZ, gyroX, gyroY, gyroZ);
+}
+
+void SensorManager::trackBias(const ImuFrame* frames, uint64_t nowMicros) {
+  bool newlyCalibrated = false;
+  for (uint32_t i = 0; i < IMU_COUNT; i++) {
+    if (frames[i].status != IMU_FRAME_OK || imuVoter.getHealth(i) != IMU_HEALTHY) continue;
+    
+    float accel[3], gyro[3];
+    for (int axis = 0; axis < 3; axis++) {
+      accel[axis] = frames[i].accel[axis] / MPU6050_ACCEL_LSB_PER_G;
+      gyro[axis] = frames[i].gyro[axis] / MPU6050_GYRO_LSB_PER_DPS;
+    }
+    float tempC = imuTemperatureC(frames[i].temperature);
+    BiasEstimator& estimator = biasEstimators[i];
+    bool wasCalibrated = estimator.isCalibrated();
+    if (estimator.update(accel, gyro, tempC, nowMicros)) {
+      biasChanged = true;
+      if (!wasCalibrated) {
+        newlyCalibrated = true;
+        Serial.printf("SensorManager: IMU 0x%02X calibrated while stationary at %.1f C\n",
+                      imuAddresses[i], tempC);
+      }
+    }
+    
+    // The bias follows the die temperature between stops too
+    estimator.getOffsets(tempC, accel, gyro);
+    imuVoter.setOffsets(i, accel, gyro);
+  }
   
-  return true;
+  // A first calibration is kept at once; later refinements are batched to
+  // spare the flash
+  if (newlyCalibrated ||
+      (biasChanged && elapsedMillis(lastBiasSave, Clock::millis()) >= BIAS_SAVE_INTERVAL_MS)) {
+    saveCalibration();
+  }
+}
+
+static void biasKey(char* key, size_t size, uint32_t index) {
+  snprintf(key, size, "imu%lu", (unsigned long)index);
+}
+
+void SensorManager::loadCalibration() {
+  Preferences prefs;
+  prefs.begin(BIAS_NVS_NAMESPACE, true);
+  for (uint32_t i = 0; i < IMU_COUNT; i++) {
+    BiasEstimator& estimator = biasEstimators[i];
+    estimator.begin();
+    
+    char key[8];
+    biasKey(key, sizeof(key), i);
+    BiasModel stored;
+    bool loaded = prefs.getBytes(key, &stored, sizeof(stored)) == sizeof(stored) &&
+                  estimator.load(stored);
+    
+    float accel[3], gyro[3];
+    estimator.getOffsets(estimator.getTemperature(), accel, gyro);
+    imuVoter.setOffsets(i, accel, gyro);
+    
+    if (imuVoter.getHealth(i) == IMU_ABSENT) continue;
+    if (loaded) {
+      Serial.printf("SensorManager: IMU 0x%02X calibration loaded (%lu stationary windows)\n",
+                    imuAddresses[i], (unsigned long)stored.windows);
+    } else {
+      Serial.printf("SensorManager: IMU 0x%02X not calibrated yet, learning at the first stop\n",
+                    imuAddresses[i]);
+    }
+  }
+  prefs.end();
+  biasChanged = false;
+  lastBiasSave = Clock::millis();
+}
+
+void SensorManager::saveCalibration() {
+  Preferences prefs;
+  if (!prefs.begin(BIAS_NVS_NAMESPACE, false)) {
+    Serial.println("SensorManager: Warning - NVS unavailable, calibration not saved");
+    return;
+  }
+  for (uint32_t i = 0; i < IMU_COUNT; i++) {
+    if (!biasEstimators[i].isCalibrated()) continue;
+    char key[8];
+    biasKey(key, sizeof(key), i);
+    prefs.putBytes(key, &biasEstimators[i].getModel(), sizeof(BiasModel));
+  }
+  prefs.end();
+  biasChanged = false;
+  lastBiasSave = Clock::millis();
 }
 
 float SensorManager::readUltrasonic() {
@@ -118,9 +463,9 @@ float SensorManager::readUltrasonic() {
 
 float SensorManager::readUltrasonicDistance() {
   digitalWrite(TRIG_PIN, LOW);
-  delayMicroseconds(2);
+  Clock::delayMicroseconds(2);
   digitalWrite(TRIG_PIN, HIGH);
-  delayMicroseconds(10);
+  Clock::delayMicroseconds(10);
   digitalWrite(TRIG_PIN, LOW);
   
   float duration = pulseIn(ECHO_PIN, HIGH, 30000); // 30ms timeout
@@ -139,77 +484,144 @@ bool SensorManager::readGPS(float& latitude, float& longitude) {
   if (!gpsInitialized || !gpsSerial) return false;
   
   bool dataUpdated = false;
-  unsigned long startTime = millis();
+  uint32_t startTime = Clock::millis();
+  
+  // The oldest waiting byte arrived one byte time per waiting byte ago
+  int pending = gpsSerial->available();
+  if (pending > 0) {
+    uint64_t now = Clock::micros64();
+    uint64_t firstByte = now - (uint64_t)pending * GPS_BYTE_MICROS;
+    if (firstByte > gpsLastByteMicros + GPS_BURST_GAP_US) gpsBurstMicros = firstByte;
+  }
   
   // Read GPS data for up to 100ms
-  while (gpsSerial->available() > 0 && (millis() - startTime) < 100) {
+  while (gpsSerial->available() > 0 && elapsedMillis(startTime, Clock::millis()) < 100) {
     if (gps.encode(gpsSerial->read())) {
+      if (gps.location.isUpdated() && gpsBurstMicros > GPS_NMEA_LATENCY_US) {
+        // The fix is for the second the burst names
+        gpsFixMicros = gpsBurstMicros - GPS_NMEA_LATENCY_US;
+      }
       if (gps.location.isValid()) {
         latitude = gps.location.lat();
         longitude = gps.location.lng();
         dataUpdated = true;
       }
+      updateGpsTime();
     }
   }
+  if (pending > 0) gpsLastByteMicros = Clock::micros64();
   
   return dataUpdated;
 }
 
+void SensorManager::updateGpsTime() {
+#if GPS_PPS_PIN >= 0
+  uint32_t count = ppsCount;
+  if (count != lastPpsCount) {
+    lastPpsCount = count;
+    // Widen the ISR's 32 bits against now, as for data ready
+    uint64_t now = Clock::micros64();
+    gpsTime.onPpsEdge(now - (uint32_t)((uint32_t)now - ppsMicros));
+  }
+#endif
+  
+  // Only RMC updates time and date together; the time is trusted once the
+  // receiver has had a fix
+  if (gps.time.isUpdated() && gps.date.isUpdated() && gps.location.isValid()) {
+    int64_t utcSeconds = GpsTimeSync::toUnixSeconds(gps.date.year(), gps.date.month(),
+                                                    gps.date.day(), gps.time.hour(),
+                                                    gps.time.minute(), gps.time.second());
+    gpsTime.onTime(utcSeconds, gps.time.centisecond(), gpsBurstMicros);
+  }
+}
+
 bool SensorManager::isMPUReady() const {
-  return mpuInitialized;
+  return mpuInitialized && imuVoter.getHealthyCount() > 0;
 }
 
 bool SensorManager::isGPSReady() const {
   return gpsInitialized && gps.location.isValid();
 }
 
+const ImuVoter& SensorManager::getImuVoter() const {
+  return imuVoter;
+}
+
+const I2cStats& SensorManager::getI2cStats() const {
+  return i2c.getStats();
+}
+
+bool SensorManager::isCalibrated() const {
+  for (uint32_t i = 0; i < IMU_COUNT; i++) {
+    if (imuVoter.getHealth(i) != IMU_ABSENT && biasEstimators[i].isCalibrated()) return true;
+  }
+  return false;
+}
+
+const BiasEstimator& SensorManager::getBiasEstimator(uint32_t index) const {
+  return biasEstimators[index < IMU_COUNT ? index : 0];
+}
+
 void SensorManager::performCalibration() {
   if (!mpuInitialized) return;
   
   Serial.println("SensorManager: Starting calibration...");
   Serial.println("Keep the device stationary for 5 seconds");
   
-  float accelSumX = 0, accelSumY = 0, accelSumZ = 0;
-  float gyroSumX = 0, gyroSumY = 0, gyroSumZ = 0;
+  // Each IMU gets its own offsets
+  float accelSums[IMU_COUNT][3];
+  float gyroSums[IMU_COUNT][3];
+  float temperatureSums[IMU_COUNT];
+  memset(accelSums, 0, sizeof(accelSums));
+  memset(gyroSums, 0, sizeof(gyroSums));
+  memset(temperatureSums, 0, sizeof(temperatureSums));
   int samples = 100;
   
   for (int i = 0; i < samples; i++) {
-    int16_t ax, ay, az, gx, gy, gz;
-    mpu.getMotion6(&ax, &ay, &az, &gx, &gy, &gz);
-    
-    accelSumX += ax / 16384.0;
-    accelSumY += ay / 16384.0;
-    accelSumZ += az / 16384.0;
-    gyroSumX += gx / 131.0;
-    gyroSumY += gy / 131.0;
-    gyroSumZ += gz / 131.0;
+    for (uint32_t imu = 0; imu < IMU_COUNT; imu++) {
+      if (imuVoter.getHealth(imu) == IMU_ABSENT) continue;
+      ImuFrame frame;
+      readImuFrame(imu, frame);
+      for (int axis = 0; axis < 3; axis++) {
+        accelSums[imu][axis] += frame.accel[axis] / MPU6050_ACCEL_LSB_PER_G;
+        gyroSums[imu][axis] += frame.gyro[axis] / MPU6050_GYRO_LSB_PER_DPS;
+      }
+      temperatureSums[imu] += imuTemperatureC(frame.temperature);
+    }
     
-    delay(50);
+    Clock::delay(50);
   }
   
   // Calculate averages
-  accelOffsetX = accelSumX / samples;
-  accelOffsetY = accelSumY / samples;
-  accelOffsetZ = (accelSumZ / samples) - 1.0; // Subtract 1g for Z-axis
-  gyroOffsetX = gyroSumX / samples;
-  gyroOffsetY = gyroSumY / samples;
-  gyroOffsetZ = gyroSumZ / samples;
-  
   Serial.println("SensorManager: Calibration complete");
-  Serial.printf("Accel offsets: X=%.3f, Y=%.3f, Z=%.3f\n", 
-                accelOffsetX, accelOffsetY, accelOffsetZ);
-  Serial.printf("Gyro offsets: X=%.3f, Y=%.3f, Z=%.3f\n", 
-                gyroOffsetX, gyroOffsetY, gyroOffsetZ);
+  for (uint32_t imu = 0; imu < IMU_COUNT; imu++) {
+    if (imuVoter.getHealth(imu) == IMU_ABSENT) continue;
+    float accel[3], gyro[3];
+    for (int axis = 0; axis < 3; axis++) {
+      accel[axis] = accelSums[imu][axis] / samples;
+      gyro[axis] = gyroSums[imu][axis] / samples;
+    }
+    accel[2] -= 1.0; // Subtract 1g for Z-axis
+    biasEstimators[imu].setOffsets(accel, gyro, temperatureSums[imu] / samples);
+    imuVoter.setOffsets(imu, accel, gyro);
+    
+    Serial.printf("IMU 0x%02X accel offsets: X=%.3f, Y=%.3f, Z=%.3f\n",
+                  imuAddresses[imu], accel[0], accel[1], accel[2]);
+    Serial.printf("IMU 0x%02X gyro offsets: X=%.3f, Y=%.3f, Z=%.3f\n",
+                  imuAddresses[imu], gyro[0], gyro[1], gyro[2]);
+  }
+  saveCalibration();
 }
 
 void SensorManager::setCalibrationOffsets(float axOff, float ayOff, float azOff,
                                          float gxOff, float gyOff, float gzOff) {
-  accelOffsetX = axOff;
-  accelOffsetY = ayOff;
-  accelOffsetZ = azOff;
-  gyroOffsetX = gxOff;
-  gyroOffsetY = gyOff;
-  gyroOffsetZ = gzOff;
+  float accel[3] = {axOff, ayOff, azOff};
+  float gyro[3] = {gxOff, gyOff, gzOff};
+  for (uint32_t i = 0; i < IMU_COUNT; i++) {
+    biasEstimators[i].setOffsets(accel, gyro, biasEstimators[i].getTemperature());
+    imuVoter.setOffsets(i, accel, gyro);
+  }
+  saveCalibration();
   
   Serial.println("SensorManager: Calibration offsets updated");
 }
@@ -263,19 +675,28 @@ bool SensorManager::testGPS() {
 void SensorManager::printSensorInfo() {
   Serial.println("\n=== Sensor Information ===");
   Serial.printf("MPU6050: %s\n", mpuInitialized ? "Connected" : "Disconnected");
+  for (uint32_t i = 0; i < IMU_COUNT; i++) {
+    const BiasEstimator& estimator = biasEstimators[i];
+    Serial.printf("  IMU 0x%02X: %s (%lu faults), %.1f C, bias %s (%lu windows)\n",
+                  imuAddresses[i], ImuVoter::healthName(imuVoter.getHealth(i)),
+                  (unsigned long)imuVoter.getFaultCount(i), estimator.getTemperature(),
+                  estimator.isCalibrated() ? "learned" : "not learned",
+                  (unsigned long)estimator.getModel().windows);
+  }
+  const I2cStats& bus = i2c.getStats();
+  Serial.printf("I2C: %lu Hz, %lu transactions, %lu failed, %lu recoveries, max %lu us\n",
+                (unsigned long)i2c.getClockHz(), (unsigned long)bus.transactions,
+                (unsigned long)bus.failures, (unsigned long)bus.recoveries,
+                (unsigned long)bus.maxMicros);
   Serial.printf("GPS: %s\n", gpsInitialized ? "Initialized" : "Not initialized");
   Serial.printf("GPS Location Valid: %s\n", gps.location.isValid() ? "Yes" : "No");
   Serial.printf("GPS Satellites: %d\n", gps.satellites.value());
-  Serial.printf("Last sensor read: %lu ms ago\n", millis() - lastSensorRead);
+  Serial.printf("Last sensor read: %lu ms ago\n",
+                (unsigned long)elapsedMillis(lastSensorRead, Clock::millis()));
   Serial.println("========================\n");
 }
 
-String SensorManager::getSensorStatus() {
-  String status = "MPU6050:";
-  status += mpuInitialized ? "OK" : "FAIL";
-  status += ",GPS:";
-  status += gpsInitialized ? "OK" : "FAIL";
-  status += ",GPS_VALID:";
-  status += gps.location.isValid() ? "YES" : "NO";
-  return status;
+size_t SensorManager::getSensorStatus(char* buffer, size_t bufferSize) {
+  return formatSensorStatus(buffer, bufferSize, isMPUReady(), gpsInitialized,
+                            gps.location.isValid());
 }
\ No newline at end of file
@@ -0,0 +1,179 @@
+#include "spectral_features.h"
+#include <math.h>
+#include <string.h>
+
+#ifdef SPECTRUM_USE_ESP_DSP
+#include <esp_dsp.h>
+#endif
+
+#define SPECTRUM_PI 3.14159265358979323846
+// Keeps log() finite for empty bins when measuring flatness
+#define FLATNESS_FLOOR 1e-12f
+
+void fftTwiddles(float* twiddles, uint32_t size) {
+  for (uint32_t k = 0; k < size / 2; k++) {
+    double angle = -2.0 * SPECTRUM_PI * k / size;
+    twiddles[2 * k] = (float)cos(angle);
+    twiddles[2 * k + 1] = (float)sin(angle);
+  }
+}
+
+void fftComplex(float* data, uint32_t size, const float* twiddles, uint32_t twiddleStride) {
+  // Bit-reversal permutation
+  for (uint32_t i = 1, j = 0; i < size; i++) {
+    uint32_t bit = size >> 1;
+    for (; j & bit; bit >>= 1) j ^= bit;
+    j |= bit;
+    if (i < j) {
+      float re = data[2 * i], im = data[2 * i + 1];
+      data[2 * i] = data[2 * j];
+      data[2 * i + 1] = data[2 * j + 1];
+      data[2 * j] = re;
+      data[2 * j + 1] = im;
+    }
+  }
+
+  // Butterflies, doubling the span each pass
+  for (uint32_t length = 2; length <= size; length <<= 1) {
+    uint32_t half = length >> 1;
+    uint32_t step = (size / length) * twiddleStride;
+    for (uint32_t start = 0; start < size; start += length) {
+      for (uint32_t j = 0; j < half; j++) {
+        float wr = twiddles[2 * j * step];
+        float wi = twiddles[2 * j * step + 1];
+        float* a = &data[2 * (start + j)];
+        float* b = &data[2 * (start + j + half)];
+        float tr = b[0] * wr - b[1] * wi;
+        float ti = b[0] * wi + b[1] * wr;
+        b[0] = a[0] - tr;
+        b[1] = a[1] - ti;
+        a[0] += tr;
+        a[1] += ti;
+      }
+    }
+  }
+}
+
+void realFftPower(float* data, uint32_t size, const float* twiddles, float* power) {
+  // Even samples as real parts, odd as imaginary: one half-size transform
+  const uint32_t half = size / 2;
+  fftComplex(data, half, twiddles, 2);
+
+  power[0] = (data[0] + data[1]) * (data[0] + data[1]);
+  power[half] = (data[0] - data[1]) * (data[0] - data[1]);
+
+  // Split: X_k = E_k + W^k O_k, where E and O are the transforms of the
+  // even and odd samples recovered from Z_k and conj(Z_{half-k})
+  for (uint32_t k = 1; k < half; k++) {
+    float zr = data[2 * k], zi = data[2 * k + 1];
+    float cr = data[2 * (half - k)], ci = -data[2 * (half - k) + 1];
+    float er = 0.5f * (zr + cr), ei = 0.5f * (zi + ci);
+    float orr = 0.5f * (zi - ci), oi = -0.5f * (zr - cr);
+    float wr = twiddles[2 * k], wi = twiddles[2 * k + 1];
+    float xr = er + wr * orr - wi * oi;
+    float xi = ei + wr * oi + wi * orr;
+    power[k] = xr * xr + xi * xi;
+  }
+}
+
+SpectralAnalyzer::SpectralAnalyzer() {
+  begin(1000.0f / SENSOR_READ_INTERVAL);
+}
+
+void SpectralAnalyzer::begin(float readingRateHz) {
+  sampleRateHz = readingRateHz;
+
+  // Periodic Hann
+  windowPower = 0.0f;
+  for (int n = 0; n < SPECTRUM_WINDOW; n++) {
+    window[n] = (float)(0.5 - 0.5 * cos(2.0 * SPECTRUM_PI * n / SPECTRUM_WINDOW));
+    windowPower += window[n] * window[n];
+  }
+  fftTwiddles(twiddles, SPECTRUM_WINDOW);
+
+#ifdef SPECTRUM_USE_ESP_DSP
+  static bool dspReady = false;
+  if (!dspReady) {
+    dspReady = dsps_fft2r_init_fc32(NULL, CONFIG_DSP_MAX_FFT_SIZE) == ESP_OK;
+  }
+#endif
+
+  memset(work, 0, sizeof(work));
+  memset(power, 0, sizeof(power));
+  memset(&features, 0, sizeof(features));
+}
+
+void SpectralAnalyzer::transformAxis(const float* column, const DetectorHistory& history) {
+  // Oldest first, mean removed (gravity and tilt are not vibration)
+  float mean = 0.0f;
+  for (int n = 0; n < SPECTRUM_WINDOW; n++) {
+    mean += column[history.slot(SPECTRUM_WINDOW - n)];
+  }
+  mean /= SPECTRUM_WINDOW;
+
+#ifdef SPECTRUM_USE_ESP_DSP
+  for (int n = 0; n < SPECTRUM_WINDOW; n++) {
+    work[2 * n] = (column[history.slot(SPECTRUM_WINDOW - n)] - mean) * window[n];
+    work[2 * n + 1] = 0.0f;
+  }
+  dsps_fft2r_fc32(work, SPECTRUM_WINDOW);
+  dsps_bit_rev_fc32(work, SPECTRUM_WINDOW);
+  for (int k = 0; k <= SPECTRUM_WINDOW / 2; k++) {
+    axisPower[k] = work[2 * k] * work[2 * k] + work[2 * k + 1] * work[2 * k + 1];
+  }
+#else
+  for (int n = 0; n < SPECTRUM_WINDOW; n++) {
+    work[n] = (column[history.slot(SPECTRUM_WINDOW - n)] - mean) * window[n];
+  }
+  realFftPower(work, SPECTRUM_WINDOW, twiddles, axisPower);
+#endif
+}
+
+bool SpectralAnalyzer::analyze(const DetectorHistory& history) {
+  features.valid = false;
+  if (history.size() < SPECTRUM_WINDOW) return false;
+
+  const int half = SPECTRUM_WINDOW / 2;
+  memset(power, 0, sizeof(power));
+  const float* columns[3] = {history.accelX(), history.accelY(), history.accelZ()};
+  for (int axis = 0; axis < 3; axis++) {
+    transformAxis(columns[axis], history);
+    for (int k = 0; k <= half; k++) power[k] += axisPower[k];
+  }
+
+  // Scale to window-compensated mean square per bin (Parseval), folding
+  // the negative frequencies into the one-sided spectrum
+  float scale = 1.0f / (SPECTRUM_WINDOW * windowPower);
+  for (int k = 0; k <= half; k++) {
+    power[k] *= (k == 0 || k == half) ? scale : 2.0f * scale;
+  }
+
+  features.energy = 0.0f;
+  memset(features.bandEnergy, 0, sizeof(features.bandEnergy));
+  float logSum = 0.0f;
+  int peak = 1;
+  for (int k = 1; k <= half; k++) {
+    features.energy += power[k];
+    features.bandEnergy[(k - 1) * SPECTRUM_BANDS / half] += power[k];
+    logSum += logf(power[k] + FLATNESS_FLOOR);
+    if (power[k] > power[peak]) peak = k;
+  }
+
+  float arithmetic = features.energy / half + FLATNESS_FLOOR;
+  features.flatness = expf(logSum / half) / arithmetic;
+  features.peakHz = peak * getBinHz();
+  features.valid = true;
+  return true;
+}
+
+const SpectralFeatures& SpectralAnalyzer::getFeatures() const {
+  return features;
+}
+
+const float* SpectralAnalyzer::getPowerSpectrum() const {
+  return power;
+}
+
+float SpectralAnalyzer::getBinHz() const {
+  return sampleRateHz / SPECTRUM_WINDOW;
+}
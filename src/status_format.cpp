@@ -0,0 +1,50 @@
+#include "status_format.h"
+#include <stdio.h>
+
+static size_t clampWritten(int written, size_t bufferSize) {
+  if (written < 0 || bufferSize == 0) return 0;
+  if ((size_t)written >= bufferSize) return bufferSize - 1;
+  return (size_t)written;
+}
+
+size_t formatConnectionInfo(char* buffer, size_t bufferSize,
+                            bool wifiConnected, bool firebaseConnected, bool ready) {
+  int written = snprintf(buffer, bufferSize, "WiFi: %s | Firebase: %s | Ready: %s",
+                         wifiConnected ? "Connected" : "Disconnected",
+                         firebaseConnected ? "Connected" : "Disconnected",
+                         ready ? "Yes" : "No");
+  return clampWritten(written, bufferSize);
+}
+
+size_t formatSensorStatus(char* buffer, size_t bufferSize,
+                          bool mpuOk, bool gpsOk, bool gpsValid) {
+  int written = snprintf(buffer, bufferSize, "MPU6050:%s,GPS:%s,GPS_VALID:%s",
+                         mpuOk ? "OK" : "FAIL",
+                         gpsOk ? "OK" : "FAIL",
+                         gpsValid ? "YES" : "NO");
+  return clampWritten(written, bufferSize);
+}
+
+size_t formatUtcTimestamp(char* buffer, size_t bufferSize, int64_t utcMicros) {
+  if (utcMicros < 0) utcMicros = 0;
+  int64_t seconds = utcMicros / 1000000;
+  uint32_t micros = (uint32_t)(utcMicros % 1000000);
+  uint32_t secondOfDay = (uint32_t)(seconds % 86400);
+
+  // Civil from days (H. Hinnant)
+  int64_t z = seconds / 86400 + 719468;
+  int64_t era = z / 146097;
+  int64_t dayOfEra = z - era * 146097;
+  int64_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+  int64_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+  int64_t mp = (5 * dayOfYear + 2) / 153;
+  int day = (int)(dayOfYear - (153 * mp + 2) / 5 + 1);
+  int month = (int)(mp < 10 ? mp + 3 : mp - 9);
+  int year = (int)(yearOfEra + era * 400 + (month <= 2));
+
+  int written = snprintf(buffer, bufferSize, "%04d-%02d-%02dT%02u:%02u:%02u.%06uZ",
+                         year, month, day, (unsigned)(secondOfDay / 3600),
+                         (unsigned)(secondOfDay / 60 % 60), (unsigned)(secondOfDay % 60),
+                         (unsigned)micros);
+  return clampWritten(written, bufferSize);
+}
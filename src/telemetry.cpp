@@ -0,0 +1,370 @@
+#include "telemetry.h"
+#include <stdio.h>
+#include <string.h>
+
+static_assert(sizeof(TelemetryHeader) == 8, "telemetry header layout");
+static_assert(sizeof(TelemetrySample) == 40, "telemetry sample layout");
+static_assert(sizeof(TelemetryState) == 8, "telemetry state layout");
+static_assert(sizeof(TelemetryStats) == 20, "telemetry stats layout");
+
+static const size_t payloadSizes[TELEMETRY_TYPE_COUNT] = {
+  0,
+  sizeof(TelemetrySample),
+  sizeof(TelemetryScore),
+  sizeof(TelemetryState),
+  sizeof(TelemetryStats),
+};
+
+// CRC-16/CCITT-FALSE, a nibble at a time (32-byte table)
+uint16_t telemetryCrc(const uint8_t* data, size_t length) {
+  static const uint16_t table[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+  };
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < length; i++) {
+    crc = (crc << 4) ^ table[(crc >> 12) ^ (data[i] >> 4)];
+    crc = (crc << 4) ^ table[(crc >> 12) ^ (data[i] & 0x0F)];
+  }
+  return crc;
+}
+
+size_t cobsEncode(const uint8_t* in, size_t length, uint8_t* out) {
+  size_t code = 0;      // where the current block's length byte goes
+  size_t written = 1;
+  uint8_t run = 1;
+  for (size_t i = 0; i < length; i++) {
+    if (in[i] != 0) {
+      out[written++] = in[i];
+      run++;
+    }
+    if (in[i] == 0 || run == 0xFF) {
+      out[code] = run;
+      code = written++;
+      run = 1;
+    }
+  }
+  out[code] = run;
+  return written;
+}
+
+size_t cobsDecode(const uint8_t* in, size_t length, uint8_t* out, size_t size) {
+  size_t read = 0;
+  size_t written = 0;
+  while (read < length) {
+    uint8_t code = in[read++];
+    if (code == 0 || read + code - 1 > length) return 0;
+    for (uint8_t i = 1; i < code; i++) {
+      if (in[read] == 0 || written >= size) return 0;
+      out[written++] = in[read++];
+    }
+    if (code != 0xFF && read < length) {
+      if (written >= size) return 0;
+      out[written++] = 0;
+    }
+  }
+  return written;
+}
+
+Telemetry::Telemetry() {
+  head = 0;
+  tail = 0;
+  wrapAt = 0;
+  wrapped = false;
+  sequence = 0;
+  records = 0;
+  dropped = 0;
+}
+
+void Telemetry::sample(const SensorData& data, uint64_t nowMicros) {
+  TelemetrySample sample;
+  sample.accel[0] = data.accelX;
+  sample.accel[1] = data.accelY;
+  sample.accel[2] = data.accelZ;
+  sample.gyro[0] = data.gyroX;
+  sample.gyro[1] = data.gyroY;
+  sample.gyro[2] = data.gyroZ;
+  sample.distance = data.distance;
+  sample.latitude = data.latitude;
+  sample.longitude = data.longitude;
+  sample.vibration = data.vibration ? 1 : 0;
+  sample.missing = data.missing;
+  sample.quality = data.quality;
+  sample.reserved = 0;
+  record(TELEMETRY_SAMPLE, &sample, sizeof(sample), data.sampleMicros ? data.sampleMicros : nowMicros);
+}
+
+void Telemetry::score(int score, int maxScore, int severity, uint8_t sensors, uint64_t nowMicros) {
+  TelemetryScore entry;
+  entry.score = score < 0 ? 0 : score > 255 ? 255 : score;
+  entry.maxScore = maxScore < 0 ? 0 : maxScore > 255 ? 255 : maxScore;
+  entry.severity = severity;
+  entry.sensors = sensors;
+  record(TELEMETRY_SCORE, &entry, sizeof(entry), nowMicros);
+}
+
+void Telemetry::state(TelemetryMachine machine, int from, int to, int reason, uint32_t detail,
+                      uint64_t nowMicros) {
+  TelemetryState entry;
+  entry.machine = machine;
+  entry.from = from;
+  entry.to = to;
+  entry.reason = reason;
+  entry.detail = detail;
+  record(TELEMETRY_STATE, &entry, sizeof(entry), nowMicros);
+}
+
+void Telemetry::stats(const TelemetryStats& stats, uint64_t nowMicros) {
+  record(TELEMETRY_STATS, &stats, sizeof(stats), nowMicros);
+}
+
+bool Telemetry::record(TelemetryType type, const void* payload, size_t length, uint64_t nowMicros) {
+  if (length > TELEMETRY_MAX_PAYLOAD) return false;
+  uint8_t raw[sizeof(TelemetryHeader) + TELEMETRY_MAX_PAYLOAD + 2];
+  TelemetryHeader header;
+  header.type = type;
+  header.reserved = 0;
+  header.sequence = sequence++;
+  header.micros = (uint32_t)nowMicros;
+  memcpy(raw, &header, sizeof(header));
+  memcpy(raw + sizeof(header), payload, length);
+  size_t rawLength = sizeof(header) + length;
+  uint16_t crc = telemetryCrc(raw, rawLength);
+  raw[rawLength++] = crc & 0xFF;
+  raw[rawLength++] = crc >> 8;
+
+  uint8_t frame[TELEMETRY_MAX_FRAME];
+  frame[0] = 0;
+  size_t frameLength = 1 + cobsEncode(raw, rawLength, frame + 1);
+  frame[frameLength++] = 0;
+
+  // Contiguous space: after head, or from the start once head passes the end
+  size_t at;
+  if (!wrapped) {
+    if (TELEMETRY_RING_SIZE - head >= frameLength) {
+      at = head;
+    } else if (tail >= frameLength) {
+      wrapAt = head;
+      wrapped = true;
+      at = 0;
+    } else {
+      dropped++;
+      return false;
+    }
+  } else if (tail - head >= frameLength) {
+    at = head;
+  } else {
+    dropped++;
+    return false;
+  }
+  memcpy(ring + at, frame, frameLength);
+  head = at + frameLength;
+  records++;
+  return true;
+}
+
+size_t Telemetry::peek(const uint8_t** data, size_t maxLength) const {
+  size_t end = wrapped ? wrapAt : head;
+  size_t length = 0;
+  size_t at = tail;
+  // Each frame is a zero, non-zero bytes, and a closing zero
+  while (at < end) {
+    size_t close = at + 1;
+    while (close < end && ring[close] != 0) close++;
+    if (close >= end || close + 1 - tail > maxLength) break;
+    length = close + 1 - tail;
+    at = close + 1;
+  }
+  *data = ring + tail;
+  return length;
+}
+
+void Telemetry::consume(size_t length) {
+  tail += length;
+  if (wrapped && tail == wrapAt) {
+    tail = 0;
+    wrapped = false;
+  }
+  if (!wrapped && tail == head) {
+    tail = 0;
+    head = 0;
+  }
+}
+
+size_t Telemetry::getPending() const {
+  return wrapped ? wrapAt - tail + head : head - tail;
+}
+
+uint32_t Telemetry::getRecords() const {
+  return records;
+}
+
+uint32_t Telemetry::getDropped() const {
+  return dropped;
+}
+
+TelemetryDecoder::TelemetryDecoder() {
+  reset();
+}
+
+void TelemetryDecoder::reset() {
+  buffered = 0;
+  overflow = false;
+  started = false;
+  lastSequence = 0;
+  lastMicros = 0;
+  unwrappedMicros = 0;
+  records = 0;
+  lostRecords = 0;
+  badFrames = 0;
+  textLines = 0;
+  bytes = 0;
+}
+
+static bool isText(const uint8_t* data, size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    if (data[i] < 0x20 && data[i] != '\r' && data[i] != '\n' && data[i] != '\t') return false;
+  }
+  return true;
+}
+
+void TelemetryDecoder::finishChunk(TelemetryRecordHandler handler, void* context) {
+  TelemetryRecord record;
+  memset(&record, 0, sizeof(record));
+  uint8_t raw[sizeof(buffer)];
+  size_t rawLength = overflow ? 0 : cobsDecode(buffer, buffered, raw, sizeof(raw));
+  TelemetryHeader header;
+  if (rawLength >= sizeof(header) + 2) {
+    memcpy(&header, raw, sizeof(header));
+  }
+  if (rawLength >= sizeof(header) + 2 && header.type > TELEMETRY_TEXT && header.type < TELEMETRY_TYPE_COUNT &&
+      rawLength == sizeof(header) + payloadSizes[header.type] + 2 &&
+      telemetryCrc(raw, rawLength - 2) == (raw[rawLength - 2] | (raw[rawLength - 1] << 8))) {
+    if (!started) {
+      started = true;
+      unwrappedMicros = header.micros;
+    } else {
+      lostRecords += (uint16_t)(header.sequence - lastSequence - 1);
+      unwrappedMicros += (uint32_t)(header.micros - lastMicros);
+    }
+    lastSequence = header.sequence;
+    lastMicros = header.micros;
+    records++;
+    record.type = header.type;
+    record.sequence = header.sequence;
+    record.micros = unwrappedMicros;
+    memcpy(&record.sample, raw + sizeof(header), payloadSizes[header.type]);
+    if (handler) handler(record, context);
+  } else if (isText(buffer, buffered)) {
+    // Console output between frames, a record per line
+    record.type = TELEMETRY_TEXT;
+    record.sequence = lastSequence;
+    record.micros = unwrappedMicros;
+    size_t start = 0;
+    for (size_t i = 0; i <= buffered; i++) {
+      if (i < buffered && buffer[i] != '\n' && buffer[i] != '\r') continue;
+      if (i > start) {
+        record.text = (const char*)buffer + start;
+        record.textLength = i - start;
+        textLines++;
+        if (handler) handler(record, context);
+      }
+      start = i + 1;
+    }
+  } else {
+    badFrames++;
+  }
+  buffered = 0;
+  overflow = false;
+}
+
+void TelemetryDecoder::feed(const uint8_t* data, size_t length, TelemetryRecordHandler handler, void* context) {
+  bytes += length;
+  for (size_t i = 0; i < length; i++) {
+    if (data[i] == 0) {
+      if (buffered > 0) finishChunk(handler, context);
+      continue;
+    }
+    if (buffered == sizeof(buffer)) {
+      // Longer than any frame: text, or noise; hand out what there is
+      overflow = true;
+      finishChunk(handler, context);
+      overflow = true;
+    }
+    buffer[buffered++] = data[i];
+  }
+}
+
+void TelemetryDecoder::finish(TelemetryRecordHandler handler, void* context) {
+  if (buffered > 0) finishChunk(handler, context);
+}
+
+const char* telemetryTypeName(uint8_t type) {
+  static const char* const names[TELEMETRY_TYPE_COUNT] = {"text", "sample", "score", "state", "stats"};
+  return type < TELEMETRY_TYPE_COUNT ? names[type] : "unknown";
+}
+
+const char* telemetryCsvHeader(uint8_t type) {
+  switch (type) {
+    case TELEMETRY_SAMPLE:
+      return "sequence,micros_us,accel_x_g,accel_y_g,accel_z_g,gyro_x_dps,gyro_y_dps,gyro_z_dps,"
+             "distance_cm,latitude,longitude,vibration,missing,quality";
+    case TELEMETRY_SCORE:
+      return "sequence,micros_us,score,max_score,severity,sensors";
+    case TELEMETRY_STATE:
+      return "sequence,micros_us,machine,from,to,reason,detail";
+    case TELEMETRY_STATS:
+      return "sequence,micros_us,uptime_ms,free_heap,event_records,dropped,health,links,severity,confirm_state";
+    default:
+      return "sequence,micros_us,text";
+  }
+}
+
+size_t formatTelemetryRecord(char* out, size_t size, const TelemetryRecord& record) {
+  static const char* const machines[] = {"detector", "confirmer", "health"};
+  int length = snprintf(out, size, "%u,%llu,", record.sequence, (unsigned long long)record.micros);
+  if (length < 0 || (size_t)length >= size) return 0;
+  char* at = out + length;
+  size_t room = size - length;
+  switch (record.type) {
+    case TELEMETRY_SAMPLE: {
+      const TelemetrySample& s = record.sample;
+      length = snprintf(at, room, "%.4f,%.4f,%.4f,%.2f,%.2f,%.2f,%.1f,%.6f,%.6f,%u,%u,%u", s.accel[0],
+                        s.accel[1], s.accel[2], s.gyro[0], s.gyro[1], s.gyro[2], s.distance, s.latitude,
+                        s.longitude, s.vibration, s.missing, s.quality);
+      break;
+    }
+    case TELEMETRY_SCORE:
+      length = snprintf(at, room, "%u,%u,%u,%u", record.score.score, record.score.maxScore,
+                        record.score.severity, record.score.sensors);
+      break;
+    case TELEMETRY_STATE:
+      length = snprintf(at, room, "%s,%u,%u,%u,%lu",
+                        record.state.machine <= MACHINE_HEALTH ? machines[record.state.machine] : "unknown",
+                        record.state.from, record.state.to, record.state.reason,
+                        (unsigned long)record.state.detail);
+      break;
+    case TELEMETRY_STATS:
+      length = snprintf(at, room, "%lu,%lu,%lu,%lu,%u,%u,%u,%u", (unsigned long)record.stats.uptimeMs,
+                        (unsigned long)record.stats.freeHeap, (unsigned long)record.stats.eventRecords,
+                        (unsigned long)record.stats.dropped, record.stats.health, record.stats.links,
+                        record.stats.severity, record.stats.confirmState);
+      break;
+    default: {
+      // Quoted, with quotes doubled
+      size_t written = 0;
+      if (room < 3) return 0;
+      at[written++] = '"';
+      for (size_t i = 0; i < record.textLength && written + 3 < room; i++) {
+        if (record.text[i] == '"') at[written++] = '"';
+        at[written++] = record.text[i];
+      }
+      at[written++] = '"';
+      at[written] = '\0';
+      length = written;
+      break;
+    }
+  }
+  if (length < 0 || (size_t)length >= room) return 0;
+  return at - out + length;
+}
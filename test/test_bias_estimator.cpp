@@ -0,0 +1,293 @@
+#include <unity.h>
+#include <math.h>
+#include <string.h>
+#include "bias_estimator.h"
+#include "config.h"
+#include "sensor_manager.h"
+#include "sim_device.h"
+
+#define STEP_US 100000ULL   // readings at SENSOR_READ_INTERVAL
+
+enum TraceMotion {
+    MOTION_STILL = 0,    // stopped, engine idling
+    MOTION_DRIVING,      // road vibration and turns
+    MOTION_SLOW_TURN     // a steady 8 dps yaw on a glass-smooth road
+};
+
+// A synthetic MPU6050 whose gyro bias drifts linearly with die temperature
+struct DriftingImu {
+    uint32_t noiseState;
+    uint64_t nowMicros;
+    float bias[3];       // dps at BIAS_REFERENCE_C
+    float slope[3];      // dps per degree C
+
+    void begin(uint32_t seed) {
+        noiseState = seed;
+        nowMicros = 0;
+        memset(bias, 0, sizeof(bias));
+        memset(slope, 0, sizeof(slope));
+    }
+
+    // Roughly normal, unit variance
+    float noise() {
+        float sum = 0;
+        for (int i = 0; i < 4; i++) {
+            noiseState ^= noiseState << 13;
+            noiseState ^= noiseState >> 17;
+            noiseState ^= noiseState << 5;
+            sum += (noiseState & 0xFFFF) / 65535.0f - 0.5f;
+        }
+        return sum * 1.732f;
+    }
+
+    float trueBias(int axis, float tempC) const {
+        return bias[axis] + slope[axis] * (tempC - BIAS_REFERENCE_C);
+    }
+
+    // seconds of motion while the die goes linearly from startC to endC;
+    // returns the stationary windows learned
+    int run(BiasEstimator& estimator, float seconds, float startC, float endC,
+            TraceMotion motion) {
+        int learned = 0;
+        int steps = (int)(seconds * 1000000.0f / STEP_US);
+        for (int n = 0; n < steps; n++) {
+            float tempC = startC + (endC - startC) * n / steps;
+            float t = nowMicros / 1e6f;
+            float accel[3] = {0, 0, 1.0f};
+            float rate[3] = {0, 0, 0};
+            float accelNoise = 0.004f, gyroNoise = 0.05f;
+            if (motion == MOTION_DRIVING) {
+                accelNoise = 0.08f;
+                gyroNoise = 0.5f;
+                rate[2] = 15.0f * sinf(0.3f * t);
+                accel[0] = 0.1f * sinf(0.1f * t);
+            } else if (motion == MOTION_SLOW_TURN) {
+                rate[2] = 8.0f;
+                accel[1] = 0.1f;
+            }
+            float accelReading[3], gyroReading[3];
+            for (int axis = 0; axis < 3; axis++) {
+                accelReading[axis] = accel[axis] + accelNoise * noise();
+                gyroReading[axis] = rate[axis] + trueBias(axis, tempC) + gyroNoise * noise();
+            }
+            if (estimator.update(accelReading, gyroReading, tempC, nowMicros)) learned++;
+            nowMicros += STEP_US;
+        }
+        return learned;
+    }
+};
+
+static BiasEstimator estimator;
+static DriftingImu imu;
+
+static void assertBias(float tolerance, float tempC) {
+    float accel[3], gyro[3];
+    estimator.getOffsets(tempC, accel, gyro);
+    for (int axis = 0; axis < 3; axis++) {
+        TEST_ASSERT_FLOAT_WITHIN(tolerance, imu.trueBias(axis, tempC), gyro[axis]);
+    }
+}
+
+void setUp(void) {
+    estimator.begin();
+    imu.begin(12345);
+    imu.bias[0] = 1.2f;
+    imu.bias[1] = -0.7f;
+    imu.bias[2] = 0.3f;
+}
+
+void tearDown(void) {
+}
+
+void test_still_window_learns_bias(void) {
+    TEST_ASSERT_FALSE(estimator.isCalibrated());
+    TEST_ASSERT_TRUE(imu.run(estimator, 2.5f, 25.0f, 25.0f, MOTION_STILL) >= 1);
+    TEST_ASSERT_TRUE(estimator.isCalibrated());
+    TEST_ASSERT_TRUE(estimator.isStationary());
+    assertBias(0.05f, 25.0f);
+
+    // Level offsets come from the same window
+    float accel[3], gyro[3];
+    estimator.getOffsets(25.0f, accel, gyro);
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, 0.0f, accel[2]);
+}
+
+void test_driving_is_not_learned(void) {
+    TEST_ASSERT_EQUAL_INT(0, imu.run(estimator, 120.0f, 25.0f, 30.0f, MOTION_DRIVING));
+    TEST_ASSERT_FALSE(estimator.isCalibrated());
+    TEST_ASSERT_FALSE(estimator.isStationary());
+}
+
+void test_slow_turn_is_not_taken_for_bias(void) {
+    imu.run(estimator, 4.0f, 25.0f, 25.0f, MOTION_STILL);
+    TEST_ASSERT_TRUE(estimator.isCalibrated());
+
+    // As quiet as a stop, but 8 dps from the known bias
+    TEST_ASSERT_EQUAL_INT(0, imu.run(estimator, 20.0f, 25.0f, 25.0f, MOTION_SLOW_TURN));
+    assertBias(0.05f, 25.0f);
+}
+
+void test_warm_up_drift_is_modelled(void) {
+    imu.slope[0] = 0.05f;
+    imu.slope[1] = -0.03f;
+    imu.slope[2] = 0.08f;
+
+    // A 40 minute drive warming the die from 20 to 50 C, with a 30 s stop
+    // every 4 minutes
+    float startC = 20.0f;
+    for (int leg = 0; leg < 10; leg++) {
+        float endC = 50.0f - 30.0f * expf(-(leg + 1) / 3.0f);
+        imu.run(estimator, 210.0f, startC, endC, MOTION_DRIVING);
+        imu.run(estimator, 30.0f, endC, endC, MOTION_STILL);
+        startC = endC;
+    }
+
+    const BiasModel& model = estimator.getModel();
+    TEST_ASSERT_FLOAT_WITHIN(0.015f, 0.05f, model.gyroSlope[0]);
+    TEST_ASSERT_FLOAT_WITHIN(0.015f, -0.03f, model.gyroSlope[1]);
+    TEST_ASSERT_FLOAT_WITHIN(0.015f, 0.08f, model.gyroSlope[2]);
+
+    // Across the range, including a hotter die than any stop saw; a boot
+    // calibration at 20 C would be off by 2 dps on Z at 45 C
+    assertBias(0.1f, 25.0f);
+    assertBias(0.1f, 45.0f);
+    assertBias(0.2f, 55.0f);
+}
+
+void test_offset_follows_drift_without_spread(void) {
+    imu.slope[2] = 0.05f;
+    imu.run(estimator, 30.0f, 25.0f, 25.0f, MOTION_STILL);
+
+    // One degree later: too little spread for a slope, the offset moves
+    imu.run(estimator, 120.0f, 25.0f, 26.0f, MOTION_DRIVING);
+    imu.run(estimator, 30.0f, 26.0f, 26.0f, MOTION_STILL);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, estimator.getModel().gyroSlope[2]);
+    assertBias(0.05f, 25.5f);
+}
+
+void test_stale_model_is_relearned(void) {
+    imu.run(estimator, 10.0f, 25.0f, 25.0f, MOTION_STILL);
+
+    // A replacement sensor, 6 dps further off on X
+    imu.bias[0] += 6.0f;
+    TEST_ASSERT_EQUAL_INT(0, imu.run(estimator, 20.0f, 25.0f, 25.0f, MOTION_STILL));
+    imu.run(estimator, 20.0f, 25.0f, 25.0f, MOTION_STILL);
+    assertBias(0.05f, 25.0f);
+}
+
+void test_manual_offsets_keep_the_slope(void) {
+    imu.slope[0] = 0.05f;
+    imu.run(estimator, 10.0f, 20.0f, 20.0f, MOTION_STILL);
+    imu.run(estimator, 10.0f, 40.0f, 40.0f, MOTION_STILL);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.05f, estimator.getModel().gyroSlope[0]);
+
+    float accel[3] = {0.01f, -0.02f, 0.03f};
+    float gyro[3] = {2.0f, 0.0f, 0.0f};
+    estimator.setOffsets(accel, gyro, 30.0f);
+
+    float outAccel[3], outGyro[3];
+    estimator.getOffsets(30.0f, outAccel, outGyro);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 0.03f, outAccel[2]);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 2.0f, outGyro[0]);
+    estimator.getOffsets(40.0f, outAccel, outGyro);
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, 2.5f, outGyro[0]);
+}
+
+void test_model_round_trip_and_validation(void) {
+    BiasEstimator restored;
+    BiasModel model;
+
+    // Nothing learned yet: not worth keeping
+    TEST_ASSERT_FALSE(restored.load(estimator.getModel()));
+
+    imu.run(estimator, 4.0f, 25.0f, 25.0f, MOTION_STILL);
+    TEST_ASSERT_TRUE(restored.load(estimator.getModel()));
+    TEST_ASSERT_TRUE(restored.isCalibrated());
+    TEST_ASSERT_EQUAL_MEMORY(&estimator.getModel(), &restored.getModel(), sizeof(BiasModel));
+
+    model = estimator.getModel();
+    model.version = BIAS_MODEL_VERSION + 1;
+    TEST_ASSERT_FALSE(restored.load(model));
+
+    model = estimator.getModel();
+    model.gyro[1] = NAN;
+    TEST_ASSERT_FALSE(restored.load(model));
+
+    model = estimator.getModel();
+    model.gyroSlope[2] = 2 * BIAS_MAX_SLOPE_DPS_PER_C;
+    TEST_ASSERT_FALSE(restored.load(model));
+
+    // A rejected model leaves the last good one
+    TEST_ASSERT_EQUAL_MEMORY(&estimator.getModel(), &restored.getModel(), sizeof(BiasModel));
+}
+
+// Mean corrected gyro X and Z over readings taken at the sensor interval
+static void meanRates(SensorManager* sensors, int readings, float& meanX, float& meanZ) {
+    float ax, ay, az, gx, gy, gz;
+    meanX = meanZ = 0;
+    for (int n = 0; n < readings; n++) {
+        sensors->readMPU6050(ax, ay, az, gx, gy, gz);
+        meanX += gx / readings;
+        meanZ += gz / readings;
+        Clock::delay(SENSOR_READ_INTERVAL);
+    }
+}
+
+void test_sensor_manager_keeps_calibration_in_nvs(void) {
+    static SimDevice device;
+    simInitDevice(device, 7, makeScenario(SCENARIO_NORMAL_DRIVE, 7, 60000));
+    device.mpuTemperatureC = 31.0f;
+    device.mpuGyroBiasDps[0] = 2.0f;
+    device.mpuGyroBiasDps[2] = -1.5f;
+    simSetCurrentDevice(&device);
+
+    // Parked at boot: the first windows calibrate, with no blocking routine
+    SensorManager* sensors = new SensorManager();
+    TEST_ASSERT_TRUE(sensors->begin());
+    TEST_ASSERT_FALSE(sensors->isCalibrated());
+    float meanX, meanZ;
+    meanRates(sensors, 60, meanX, meanZ);
+    TEST_ASSERT_TRUE(sensors->isCalibrated());
+    TEST_ASSERT_TRUE(sensors->getBiasEstimator(0).isStationary());
+    float accel[3], learned[3];
+    sensors->getBiasEstimator(0).getOffsets(31.0f, accel, learned);
+    TEST_ASSERT_FLOAT_WITHIN(0.3f, 2.0f, learned[0]);
+    TEST_ASSERT_FLOAT_WITHIN(0.3f, -1.5f, learned[2]);
+    delete sensors;
+
+    // After a reboot the offsets saved at the first calibration are there
+    // before the first reading
+    sensors = new SensorManager();
+    TEST_ASSERT_TRUE(sensors->begin());
+    TEST_ASSERT_TRUE(sensors->isCalibrated());
+    float loaded[3];
+    sensors->getBiasEstimator(0).getOffsets(31.0f, accel, loaded);
+    TEST_ASSERT_FLOAT_WITHIN(0.3f, 2.0f, loaded[0]);
+    TEST_ASSERT_FLOAT_WITHIN(0.3f, -1.5f, loaded[2]);
+    meanRates(sensors, 10, meanX, meanZ);
+    TEST_ASSERT_FLOAT_WITHIN(0.6f, 0.0f, meanX);
+    TEST_ASSERT_FLOAT_WITHIN(0.6f, 0.0f, meanZ);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 31.0f, sensors->getBiasEstimator(1).getTemperature());
+    delete sensors;
+    simSetCurrentDevice(nullptr);
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_still_window_learns_bias);
+    RUN_TEST(test_driving_is_not_learned);
+    RUN_TEST(test_slow_turn_is_not_taken_for_bias);
+    RUN_TEST(test_warm_up_drift_is_modelled);
+    RUN_TEST(test_offset_follows_drift_without_spread);
+    RUN_TEST(test_stale_model_is_relearned);
+    RUN_TEST(test_manual_offsets_keep_the_slope);
+    RUN_TEST(test_model_round_trip_and_validation);
+    RUN_TEST(test_sensor_manager_keeps_calibration_in_nvs);
+
+    return UNITY_END();
+}
+
+int main(void) {
+    return runUnityTests();
+}
@@ -0,0 +1,315 @@
+#include <unity.h>
+#include <string.h>
+#include "config.h"
+#include "ble_stream.h"
+
+// Runs on the host (build with -DHAL_SIM)
+
+static StreamFrame received[64];
+static uint64_t receivedMicros[64];
+static int receivedCount;
+
+void setUp(void) {
+    receivedCount = 0;
+}
+
+void tearDown(void) {}
+
+static void collect(const StreamFrame& frame, uint64_t sampleMicros, void* context) {
+    (void)context;
+    if (receivedCount < 64) {
+        received[receivedCount] = frame;
+        receivedMicros[receivedCount] = sampleMicros;
+    }
+    receivedCount++;
+}
+
+static SensorData reading(uint64_t sampleMicros) {
+    SensorData data;
+    memset(&data, 0, sizeof(data));
+    data.accelX = 1.2345f;
+    data.accelY = -0.5f;
+    data.accelZ = 1.0f;
+    data.gyroX = 12.34f;
+    data.gyroY = -250.0f;
+    data.distance = 87.4f;
+    data.sampleMicros = sampleMicros;
+    data.timestamp = (uint32_t)(sampleMicros / 1000);
+    return data;
+}
+
+static StreamFrame frameAt(uint32_t sampleMicros) {
+    return makeStreamFrame(reading(sampleMicros), 0, 0, 0);
+}
+
+void test_frame_round_trip(void) {
+    SensorData data = reading(123456789);
+    data.vibration = 1;
+    data.quality = QUALITY_IMU_CLIPPED;
+    StreamFrame frame = makeStreamFrame(data, 4242, 7, STREAM_FLAG_CRASH);
+
+    uint8_t bytes[STREAM_FRAME_SIZE];
+    encodeStreamFrame(frame, bytes);
+    TEST_ASSERT_EQUAL_UINT8(4242 & 0xFF, bytes[0]);   // little-endian
+    TEST_ASSERT_EQUAL_UINT8(4242 >> 8, bytes[1]);
+
+    StreamFrame decoded;
+    decodeStreamFrame(bytes, decoded);
+    TEST_ASSERT_EQUAL_UINT16(4242, decoded.sequence);
+    TEST_ASSERT_EQUAL_UINT32(123456789, decoded.sampleMicros);
+    TEST_ASSERT_EQUAL_INT16(1235, decoded.accelMg[0]);
+    TEST_ASSERT_EQUAL_INT16(-500, decoded.accelMg[1]);
+    TEST_ASSERT_EQUAL_INT16(1000, decoded.accelMg[2]);
+    TEST_ASSERT_EQUAL_INT16(123, decoded.gyroDeciDps[0]);
+    TEST_ASSERT_EQUAL_INT16(-2500, decoded.gyroDeciDps[1]);
+    TEST_ASSERT_EQUAL_INT16(87, decoded.distanceCm);
+    TEST_ASSERT_EQUAL_UINT8(QUALITY_IMU_CLIPPED, decoded.quality);
+    TEST_ASSERT_EQUAL_UINT8(7, decoded.score);
+    TEST_ASSERT_EQUAL_UINT8(STREAM_FLAG_CRASH | STREAM_FLAG_VIBRATION, decoded.flags);
+}
+
+void test_frame_clamps_and_marks_missing(void) {
+    SensorData data = reading(0);
+    data.accelX = 100.0f;        // past 32.767 g
+    data.gyroZ = -5000.0f;
+    data.timestamp = 2000;       // no data-ready time: from the millisecond clock
+    data.missing = SENSOR_ULTRASONIC;
+    StreamFrame frame = makeStreamFrame(data, 0, 300, 0);
+
+    TEST_ASSERT_EQUAL_INT16(32767, frame.accelMg[0]);
+    TEST_ASSERT_EQUAL_INT16(-32767, frame.gyroDeciDps[2]);
+    TEST_ASSERT_EQUAL_INT16(-1, frame.distanceCm);
+    TEST_ASSERT_EQUAL_UINT8(SENSOR_ULTRASONIC, frame.missing);
+    TEST_ASSERT_EQUAL_UINT8(255, frame.score);
+    TEST_ASSERT_EQUAL_UINT32(2000000, frame.sampleMicros);
+}
+
+void test_frames_per_batch_follow_mtu(void) {
+    TEST_ASSERT_EQUAL_UINT32(0, streamFramesPerBatch(23));
+    TEST_ASSERT_EQUAL_UINT32(1, streamFramesPerBatch(STREAM_ATT_OVERHEAD + STREAM_HEADER_SIZE + STREAM_FRAME_SIZE));
+    TEST_ASSERT_EQUAL_UINT32(7, streamFramesPerBatch(185));
+    TEST_ASSERT_EQUAL_UINT32(10, streamFramesPerBatch(247));
+    TEST_ASSERT_EQUAL_UINT32(21, streamFramesPerBatch(517));
+    TEST_ASSERT_EQUAL_UINT32(21, streamFramesPerBatch(65535));   // one ATT value at most
+}
+
+void test_batcher_sends_full_and_timed_batches(void) {
+    StreamBatcher batcher;
+    StreamFrame frame = frameAt(0);
+    TEST_ASSERT_FALSE(batcher.add(frame, 0));   // no MTU yet
+    batcher.setMtu(185);
+    TEST_ASSERT_EQUAL_UINT32(7, batcher.getCapacity());
+
+    for (int i = 0; i < 6; i++) {
+        frame = frameAt(i * 1000);
+        TEST_ASSERT_TRUE(batcher.add(frame, i));
+        TEST_ASSERT_EQUAL_UINT16(i, frame.sequence);
+    }
+    TEST_ASSERT_FALSE(batcher.isReady(10));
+    frame = frameAt(6000);
+    batcher.add(frame, 10);
+    TEST_ASSERT_TRUE(batcher.isReady(10));
+
+    uint8_t payload[STREAM_MAX_PAYLOAD];
+    size_t length = batcher.take(payload, sizeof(payload));
+    TEST_ASSERT_EQUAL_UINT32(STREAM_HEADER_SIZE + 7 * STREAM_FRAME_SIZE, length);
+    TEST_ASSERT_LESS_OR_EQUAL(185 - STREAM_ATT_OVERHEAD, length);
+    TEST_ASSERT_EQUAL_UINT8(STREAM_MAGIC, payload[0]);
+    TEST_ASSERT_EQUAL_UINT8(7, payload[1]);
+    TEST_ASSERT_TRUE(batcher.isEmpty());
+
+    // A lone frame goes out after BLE_BATCH_MAX_MS
+    frame = frameAt(7000);
+    batcher.add(frame, 100);
+    TEST_ASSERT_FALSE(batcher.isReady(100 + BLE_BATCH_MAX_MS - 1));
+    TEST_ASSERT_TRUE(batcher.isReady(100 + BLE_BATCH_MAX_MS));
+    length = batcher.take(payload, sizeof(payload));
+    TEST_ASSERT_EQUAL_UINT32(STREAM_HEADER_SIZE + STREAM_FRAME_SIZE, length);
+    TEST_ASSERT_EQUAL_UINT8(1, payload[2]);     // second batch
+    TEST_ASSERT_EQUAL_UINT32(0, batcher.take(payload, sizeof(payload)));
+}
+
+void test_decoder_counts_frames_dropped_by_batcher(void) {
+    StreamBatcher batcher;
+    StreamDecoder decoder;
+    batcher.setMtu(247);
+    uint8_t payload[STREAM_MAX_PAYLOAD];
+
+    // First batch sent, the second never taken: overwritten when full
+    for (int i = 0; i < 10; i++) {
+        StreamFrame frame = frameAt(i * 1000);
+        batcher.add(frame, 0);
+    }
+    size_t length = batcher.take(payload, sizeof(payload));
+    decoder.feed(payload, length, collect, nullptr);
+    for (int i = 10; i < 23; i++) {
+        StreamFrame frame = frameAt(i * 1000);
+        batcher.add(frame, 0);
+    }
+    length = batcher.take(payload, sizeof(payload));
+    decoder.feed(payload, length, collect, nullptr);
+
+    TEST_ASSERT_EQUAL_UINT64(13, decoder.frames);
+    TEST_ASSERT_EQUAL_UINT64(2, decoder.batches);
+    TEST_ASSERT_EQUAL_UINT64(10, decoder.lostFrames);
+    TEST_ASSERT_EQUAL_UINT16(20, received[10].sequence);
+}
+
+void test_decoder_handles_chunks_and_garbage(void) {
+    StreamBatcher batcher;
+    batcher.setMtu(247);
+    uint8_t recording[2 * STREAM_MAX_PAYLOAD];
+    size_t length = 0;
+
+    const uint8_t garbage[5] = {0x00, STREAM_MAGIC, 0x00, 0xFF, 0x13};
+    memcpy(recording, garbage, sizeof(garbage));
+    length += sizeof(garbage);
+    for (int batch = 0; batch < 2; batch++) {
+        for (int i = 0; i < 3; i++) {
+            StreamFrame frame = frameAt((batch * 3 + i) * 2000);
+            batcher.add(frame, 0);
+        }
+        length += batcher.take(recording + length, sizeof(recording) - length);
+    }
+
+    // Odd-sized pieces, as a serial capture or file read would give them
+    StreamDecoder decoder;
+    for (size_t at = 0; at < length; at += 7) {
+        size_t piece = length - at < 7 ? length - at : 7;
+        decoder.feed(recording + at, piece, collect, nullptr);
+    }
+    TEST_ASSERT_EQUAL_UINT64(6, decoder.frames);
+    TEST_ASSERT_EQUAL_UINT64(0, decoder.lostFrames);
+    TEST_ASSERT_EQUAL_UINT64(sizeof(garbage), decoder.skippedBytes);
+    TEST_ASSERT_EQUAL_INT(6, receivedCount);
+    TEST_ASSERT_EQUAL_UINT64(10000, receivedMicros[5]);
+    TEST_ASSERT_EQUAL_INT16(1235, received[5].accelMg[0]);
+}
+
+void test_decoder_unwraps_sequence_and_time(void) {
+    uint8_t payload[STREAM_HEADER_SIZE + 2 * STREAM_FRAME_SIZE];
+    payload[0] = STREAM_MAGIC;
+    payload[1] = 2;
+    payload[2] = 0;
+    payload[3] = 0;
+    StreamFrame frame = frameAt(0xFFFFFC18);   // 1 ms before the u32 wrap
+    frame.sequence = 0xFFFF;
+    encodeStreamFrame(frame, payload + STREAM_HEADER_SIZE);
+    frame.sampleMicros = 1000;                 // 2 ms later
+    frame.sequence = 1;                        // frame 0 lost
+    encodeStreamFrame(frame, payload + STREAM_HEADER_SIZE + STREAM_FRAME_SIZE);
+
+    StreamDecoder decoder;
+    decoder.feed(payload, sizeof(payload), collect, nullptr);
+    TEST_ASSERT_EQUAL_UINT64(2, decoder.frames);
+    TEST_ASSERT_EQUAL_UINT64(1, decoder.lostFrames);
+    TEST_ASSERT_EQUAL_UINT64(0xFFFFFC18ULL + 2000, receivedMicros[1]);
+    TEST_ASSERT_EQUAL_UINT64(2000, decoder.lastFrameMicros - decoder.firstMicros);
+}
+
+void test_decoder_frames_per_second(void) {
+    StreamBatcher batcher;
+    StreamDecoder decoder;
+    batcher.setMtu(247);
+    uint8_t payload[STREAM_MAX_PAYLOAD];
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, (float)decoder.getFramesPerSecond());
+
+    // 1 kHz for a second
+    for (int i = 0; i <= 1000; i++) {
+        StreamFrame frame = frameAt(i * 1000);
+        batcher.add(frame, i);
+        if (batcher.isReady(i)) {
+            size_t length = batcher.take(payload, sizeof(payload));
+            decoder.feed(payload, length, nullptr, nullptr);
+        }
+    }
+    size_t length = batcher.take(payload, sizeof(payload));
+    decoder.feed(payload, length, nullptr, nullptr);
+    TEST_ASSERT_EQUAL_UINT64(1001, decoder.frames);
+    TEST_ASSERT_EQUAL_UINT64(0, decoder.lostFrames);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 1000.0f, (float)decoder.getFramesPerSecond());
+}
+
+void test_apply_config_setting(void) {
+    CrashDetectionConfig config;
+    TEST_ASSERT_TRUE(applyConfigSetting(config, "accel", 4.5f));
+    TEST_ASSERT_EQUAL_FLOAT(4.5f, config.accelThreshold);
+    TEST_ASSERT_TRUE(applyConfigSetting(config, "consecutive", 5.0f));
+    TEST_ASSERT_EQUAL_INT(5, config.consecutiveReadings);
+
+    TEST_ASSERT_FALSE(applyConfigSetting(config, "accel", 0.1f));        // below range
+    TEST_ASSERT_FALSE(applyConfigSetting(config, "gyro", 5000.0f));      // above range
+    TEST_ASSERT_FALSE(applyConfigSetting(config, "consecutive", 2.5f));  // not an integer
+    TEST_ASSERT_FALSE(applyConfigSetting(config, "colour", 1.0f));
+    TEST_ASSERT_EQUAL_FLOAT(4.5f, config.accelThreshold);
+    TEST_ASSERT_EQUAL_INT(5, config.consecutiveReadings);
+}
+
+void test_apply_config_settings_all_or_nothing(void) {
+    CrashDetectionConfig config;
+    TEST_ASSERT_TRUE(applyConfigSettings(config, " accel=3.5 gyro=300\r\n"));
+    TEST_ASSERT_EQUAL_FLOAT(3.5f, config.accelThreshold);
+    TEST_ASSERT_EQUAL_FLOAT(300.0f, config.gyroThreshold);
+
+    TEST_ASSERT_FALSE(applyConfigSettings(config, "accel=4 gyro=9999"));
+    TEST_ASSERT_EQUAL_FLOAT(3.5f, config.accelThreshold);   // the valid one not applied either
+    TEST_ASSERT_FALSE(applyConfigSettings(config, "accel=4x"));
+    TEST_ASSERT_FALSE(applyConfigSettings(config, "accel"));
+    TEST_ASSERT_FALSE(applyConfigSettings(config, "=4"));
+    TEST_ASSERT_FALSE(applyConfigSettings(config, ""));
+    TEST_ASSERT_EQUAL_FLOAT(3.5f, config.accelThreshold);
+}
+
+static char formatted[16][48];
+static int formattedCount;
+
+static void collectLine(const char* line, void* context) {
+    (void)context;
+    if (formattedCount < 16) strncpy(formatted[formattedCount], line, sizeof(formatted[0]) - 1);
+    formattedCount++;
+}
+
+void test_format_config_settings(void) {
+    CrashDetectionConfig config;
+    config.accelThreshold = 2.5f;
+    formattedCount = 0;
+    memset(formatted, 0, sizeof(formatted));
+    formatConfigSettings(config, collectLine, nullptr);
+
+    TEST_ASSERT_EQUAL_INT(12, formattedCount);
+    TEST_ASSERT_EQUAL_STRING("accel=2.5", formatted[0]);
+    bool sawConsecutive = false;
+    for (int i = 0; i < formattedCount && i < 16; i++) {
+        if (strcmp(formatted[i], "consecutive=3") == 0) sawConsecutive = true;
+    }
+    TEST_ASSERT_TRUE(sawConsecutive);
+
+    // What get prints, set takes back
+    CrashDetectionConfig copy;
+    for (int i = 0; i < formattedCount && i < 16; i++) {
+        TEST_ASSERT_TRUE(applyConfigSettings(copy, formatted[i]));
+    }
+    TEST_ASSERT_EQUAL_FLOAT(2.5f, copy.accelThreshold);
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_frame_round_trip);
+    RUN_TEST(test_frame_clamps_and_marks_missing);
+    RUN_TEST(test_frames_per_batch_follow_mtu);
+    RUN_TEST(test_batcher_sends_full_and_timed_batches);
+    RUN_TEST(test_decoder_counts_frames_dropped_by_batcher);
+    RUN_TEST(test_decoder_handles_chunks_and_garbage);
+    RUN_TEST(test_decoder_unwraps_sequence_and_time);
+    RUN_TEST(test_decoder_frames_per_second);
+    RUN_TEST(test_apply_config_setting);
+    RUN_TEST(test_apply_config_settings_all_or_nothing);
+    RUN_TEST(test_format_config_settings);
+
+    return UNITY_END();
+}
+
+int main(void) {
+    return runUnityTests();
+}
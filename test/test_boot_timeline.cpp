@@ -0,0 +1,196 @@
+#include <unity.h>
+#include <string.h>
+#include "boot_timeline.h"
+#include "clock_discipline.h"
+#include "config.h"
+#include "crash_detector.h"
+#include "firebase_manager.h"
+#include "sensor_filter.h"
+#include "sensor_manager.h"
+#include "sim_device.h"
+
+// How soon after start detection must be running
+#define ARMED_WITHIN_MS 300
+
+static BootTimeline timeline;
+
+void setUp(void) {
+    timeline.begin();
+}
+
+void tearDown(void) {
+}
+
+void test_stage_is_marked_once(void) {
+    TEST_ASSERT_FALSE(timeline.isReached(BOOT_SENSORS));
+    TEST_ASSERT_TRUE(timeline.mark(BOOT_SENSORS, 40000));
+    TEST_ASSERT_FALSE(timeline.mark(BOOT_SENSORS, 90000));
+    TEST_ASSERT_TRUE(timeline.isReached(BOOT_SENSORS));
+    TEST_ASSERT_EQUAL_UINT32(40, timeline.getMillis(BOOT_SENSORS));
+}
+
+void test_network_before_detection_is_out_of_order(void) {
+    timeline.mark(BOOT_SENSORS, 1000);
+    timeline.mark(BOOT_DETECTOR, 2000);
+    timeline.mark(BOOT_WIFI, 3000);
+    TEST_ASSERT_FALSE(timeline.isInOrder());
+    timeline.mark(BOOT_ARMED, 4000);
+    TEST_ASSERT_FALSE(timeline.isInOrder());
+}
+
+void test_background_stages_may_interleave(void) {
+    timeline.mark(BOOT_SENSORS, 1000);
+    timeline.mark(BOOT_DETECTOR, 2000);
+    timeline.mark(BOOT_ARMED, 3000);
+    // GPS time before Wi-Fi, calibration learned after the cloud is up
+    timeline.mark(BOOT_UTC, 4000);
+    timeline.mark(BOOT_WIFI, 5000);
+    timeline.mark(BOOT_CLOUD, 6000);
+    timeline.mark(BOOT_CALIBRATED, 7000);
+    TEST_ASSERT_TRUE(timeline.isInOrder());
+    TEST_ASSERT_FALSE(timeline.isComplete());
+    timeline.mark(BOOT_FIRST_UPLOAD, 8000);
+    TEST_ASSERT_TRUE(timeline.isComplete());
+}
+
+void test_report_prints_once(void) {
+    timeline.mark(BOOT_SENSORS, 1000);
+    TEST_ASSERT_FALSE(timeline.report(2000));
+    // Some stage never came: the report goes out at the timeout anyway
+    TEST_ASSERT_TRUE(timeline.report(BOOT_REPORT_TIMEOUT_MS * 1000ULL));
+    TEST_ASSERT_FALSE(timeline.report(BOOT_REPORT_TIMEOUT_MS * 1000ULL + 1));
+}
+
+// Firmware::setup() and loop() (src/firmware.cpp), reduced to what boots
+struct BootedUnit {
+    SensorManager sensors;
+    SensorFilter sensorFilter;
+    CrashDetector crashDetector;
+    FirebaseManager firebase;
+    ClockDiscipline utcClock;
+    BootTimeline boot;
+
+    void run(uint32_t durationMs) {
+        CrashDetectionConfig crashConfig;
+        FilterConfig filterConfig;
+        TEST_ASSERT_TRUE(sensors.begin(&utcClock));
+        boot.mark(BOOT_SENSORS, Clock::micros64());
+        if (sensors.isCalibrated()) boot.mark(BOOT_CALIBRATED, Clock::micros64());
+        sensorFilter.begin(filterConfig);
+        crashDetector.begin(crashConfig);
+        boot.mark(BOOT_DETECTOR, Clock::micros64());
+        firebase.begin(&utcClock);
+
+        uint32_t lastSensorRead = 0;
+        uint32_t lastFirebaseSend = 0;
+        SensorData data;
+        memset(&data, 0, sizeof(data));
+        while (Clock::millis() < durationMs) {
+            uint32_t currentMillis = Clock::millis();
+            firebase.handleConnection();
+            if (elapsedMillis(lastSensorRead, currentMillis) >= SENSOR_READ_INTERVAL) {
+                lastSensorRead = currentMillis;
+                data = sensors.readAllSensors();
+                sensorFilter.process(data);
+                crashDetector.addToHistory(data);
+                crashDetector.detectCrash(data);
+                boot.mark(BOOT_ARMED, Clock::micros64());
+            }
+            if (elapsedMillis(lastFirebaseSend, currentMillis) >= FIREBASE_SEND_INTERVAL &&
+                firebase.isReady()) {
+                lastFirebaseSend = currentMillis;
+                if (firebase.sendSensorData(data, NO_CRASH, false)) {
+                    boot.mark(BOOT_FIRST_UPLOAD, Clock::micros64());
+                }
+            }
+            uint64_t now = Clock::micros64();
+            if (sensors.isCalibrated()) boot.mark(BOOT_CALIBRATED, now);
+            if (firebase.isWiFiConnected()) boot.mark(BOOT_WIFI, now);
+            if (utcClock.isSynced()) boot.mark(BOOT_UTC, now);
+            if (firebase.isReady()) boot.mark(BOOT_CLOUD, now);
+            Clock::delay(10);
+        }
+    }
+};
+
+static SimDevice device;
+
+static BootedUnit* bootDevice(uint32_t durationMs) {
+    simSetCurrentDevice(&device);
+    BootedUnit* unit = new BootedUnit();
+    unit->run(durationMs);
+    return unit;
+}
+
+static void endBoot(BootedUnit* unit) {
+    delete unit;
+    simSetCurrentDevice(nullptr);
+}
+
+void test_detection_arms_before_the_network(void) {
+    simInitDevice(device, 11, makeScenario(SCENARIO_NORMAL_DRIVE, 11, 60000));
+    BootedUnit* unit = bootDevice(15000);
+    const BootTimeline& boot = unit->boot;
+
+    TEST_ASSERT_TRUE(boot.isReached(BOOT_ARMED));
+    TEST_ASSERT_TRUE(boot.getMillis(BOOT_ARMED) <= ARMED_WITHIN_MS);
+    TEST_ASSERT_TRUE(boot.getMicros(BOOT_SENSORS) <= boot.getMicros(BOOT_DETECTOR));
+    TEST_ASSERT_TRUE(boot.getMicros(BOOT_ARMED) < boot.getMicros(BOOT_WIFI));
+    TEST_ASSERT_TRUE(boot.getMicros(BOOT_WIFI) <= boot.getMicros(BOOT_CLOUD));
+    TEST_ASSERT_TRUE(boot.getMicros(BOOT_CLOUD) <= boot.getMicros(BOOT_FIRST_UPLOAD));
+    TEST_ASSERT_TRUE(boot.isInOrder());
+    // Parked at start: calibrated at the first stop, in the background
+    TEST_ASSERT_TRUE(boot.isComplete());
+    endBoot(unit);
+}
+
+void test_slow_or_missing_wifi_does_not_delay_detection(void) {
+    simInitDevice(device, 12, makeScenario(SCENARIO_NORMAL_DRIVE, 12, 60000));
+    device.wifiAssociateMs = 9000;
+    BootedUnit* unit = bootDevice(15000);
+    TEST_ASSERT_TRUE(unit->boot.getMillis(BOOT_ARMED) <= ARMED_WITHIN_MS);
+    TEST_ASSERT_TRUE(unit->boot.getMillis(BOOT_WIFI) >= 9000);
+    TEST_ASSERT_TRUE(unit->boot.isInOrder());
+    endBoot(unit);
+
+    simInitDevice(device, 13, makeScenario(SCENARIO_NORMAL_DRIVE, 13, 60000));
+    device.wifiAvailable = false;
+    unit = bootDevice(5000);
+    TEST_ASSERT_TRUE(unit->boot.getMillis(BOOT_ARMED) <= ARMED_WITHIN_MS);
+    TEST_ASSERT_FALSE(unit->boot.isReached(BOOT_WIFI));
+    TEST_ASSERT_FALSE(unit->boot.isReached(BOOT_CLOUD));
+    TEST_ASSERT_TRUE(unit->boot.isInOrder());
+    endBoot(unit);
+}
+
+void test_stored_calibration_is_ready_before_arming(void) {
+    simInitDevice(device, 14, makeScenario(SCENARIO_NORMAL_DRIVE, 14, 60000));
+    BootedUnit* unit = bootDevice(4000);
+    TEST_ASSERT_TRUE(unit->boot.isReached(BOOT_CALIBRATED));
+    endBoot(unit);
+
+    // Reboot, NVS kept: calibrated from the start
+    device.clockMicros = 0;
+    unit = bootDevice(1000);
+    TEST_ASSERT_TRUE(unit->boot.getMicros(BOOT_CALIBRATED) <= unit->boot.getMicros(BOOT_ARMED));
+    TEST_ASSERT_TRUE(unit->boot.getMillis(BOOT_ARMED) <= ARMED_WITHIN_MS);
+    endBoot(unit);
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_stage_is_marked_once);
+    RUN_TEST(test_network_before_detection_is_out_of_order);
+    RUN_TEST(test_background_stages_may_interleave);
+    RUN_TEST(test_report_prints_once);
+    RUN_TEST(test_detection_arms_before_the_network);
+    RUN_TEST(test_slow_or_missing_wifi_does_not_delay_detection);
+    RUN_TEST(test_stored_calibration_is_ready_before_arming);
+
+    return UNITY_END();
+}
+
+int main(void) {
+    return runUnityTests();
+}
@@ -0,0 +1,234 @@
+#include <unity.h>
+#include <string.h>
+#include "clock_discipline.h"
+#include "config.h"
+#include "crash_detector.h"
+#include "hal.h"
+#include "sensor_manager.h"
+#include "sim_device.h"
+
+// The oscillator under test runs OSCILLATOR_PPM fast: monotonic time is true
+// time scaled by (1 + OSCILLATOR_PPM * 1e-6). References arrive with
+// uniform jitter from a fixed-seed generator.
+
+static const int64_t UTC_AT_BOOT = 1700000000LL * 1000000;
+
+ClockDiscipline utcClock;
+static uint32_t noiseState;
+
+static int32_t jitter(int32_t amplitude) {
+    noiseState = noiseState * 1664525UL + 1013904223UL;
+    return (int32_t)(noiseState >> 8) % (2 * amplitude + 1) - amplitude;
+}
+
+static uint64_t monoAt(int64_t trueMicros, int32_t oscillatorPpm) {
+    return (uint64_t)(trueMicros + trueMicros / 1000000 * oscillatorPpm +
+                      trueMicros % 1000000 * oscillatorPpm / 1000000);
+}
+
+static int64_t absolute(int64_t value) {
+    return value < 0 ? -value : value;
+}
+
+void setUp(void) {
+    utcClock.reset();
+    noiseState = 1;
+}
+
+void tearDown(void) {
+}
+
+void test_unsynced_until_first_reference(void) {
+    TEST_ASSERT_FALSE(utcClock.isSynced());
+    TEST_ASSERT_EQUAL_INT64(0, utcClock.toUtcMicros(123456));
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, utcClock.getErrorMicros(123456));
+
+    utcClock.addReference(5000000, UTC_AT_BOOT + 5000000, 10000, TIME_SOURCE_NTP);
+    TEST_ASSERT_TRUE(utcClock.isSynced());
+    TEST_ASSERT_EQUAL_INT64(UTC_AT_BOOT + 5000000, utcClock.toUtcMicros(5000000));
+    TEST_ASSERT_EQUAL_INT64(UTC_AT_BOOT + 5250000, utcClock.toUtcMicros(5250000));
+    TEST_ASSERT_EQUAL_UINT32(10000, utcClock.getErrorMicros(5000000));
+}
+
+void test_learns_drift_from_ntp(void) {
+    // +40 ppm oscillator, NTP every 64 s with +/-2 ms jitter, six hours
+    const int32_t oscillatorPpm = 40;
+    const int64_t pollMicros = 64LL * 1000000;
+    const int64_t runMicros = 6LL * 3600 * 1000000;
+    int64_t worstError = 0;
+    int64_t worstUncovered = 0;
+
+    for (int64_t t = 0; t <= runMicros; t += 100000) {
+        uint64_t mono = monoAt(t, oscillatorPpm);
+        if (t % pollMicros == 0) {
+            utcClock.addReference(mono, UTC_AT_BOOT + t + jitter(2000), 2000, TIME_SOURCE_NTP);
+        }
+        if (t >= 3600LL * 1000000) {
+            int64_t error = absolute(utcClock.toUtcMicros(mono) - (UTC_AT_BOOT + t));
+            if (error > worstError) worstError = error;
+            int64_t uncovered = error - utcClock.getErrorMicros(mono);
+            if (uncovered > worstUncovered) worstUncovered = uncovered;
+        }
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(0, utcClock.getStepCount());
+    TEST_ASSERT_INT_WITHIN(5000, -oscillatorPpm * 1000, utcClock.getFrequencyPpb());
+    TEST_ASSERT_TRUE(worstError < 4000);
+    // The error estimate bounds the actual error
+    TEST_ASSERT_TRUE(worstUncovered <= 0);
+}
+
+void test_holdover_without_references(void) {
+    // Learn -25 ppm, then lose the reference for an hour
+    const int32_t oscillatorPpm = -25;
+    for (int64_t t = 0; t <= 4LL * 3600 * 1000000; t += 64LL * 1000000) {
+        utcClock.addReference(monoAt(t, oscillatorPpm), UTC_AT_BOOT + t, 1000, TIME_SOURCE_NTP);
+    }
+    int64_t lastReference = 4LL * 3600 * 1000000 - (4LL * 3600 * 1000000) % (64LL * 1000000);
+
+    int64_t t = lastReference + 3600LL * 1000000;
+    uint64_t mono = monoAt(t, oscillatorPpm);
+    int64_t error = absolute(utcClock.toUtcMicros(mono) - (UTC_AT_BOOT + t));
+
+    // Uncorrected the hour would cost 90 ms
+    TEST_ASSERT_TRUE(error < 5000);
+    TEST_ASSERT_TRUE(error <= utcClock.getErrorMicros(mono));
+}
+
+void test_jitter_is_slewed_never_stepped(void) {
+    // +/-50 ms jitter on 16 s references: per-sample conversion must stay
+    // monotonic and within the slew and frequency rate limits
+    const int32_t oscillatorPpm = 15;
+    const int64_t maxRatePpb = (int64_t)(CLOCK_MAX_SLEW_PPM + CLOCK_MAX_FREQ_PPM) * 1000;
+    int64_t previousUtc = 0;
+    uint64_t previousMono = 0;
+
+    for (int64_t t = 0; t <= 1800LL * 1000000; t += 1000) {
+        uint64_t mono = monoAt(t, oscillatorPpm);
+        if (t % (16LL * 1000000) == 0) {
+            utcClock.addReference(mono, UTC_AT_BOOT + t + jitter(50000), 50000, TIME_SOURCE_NTP);
+        }
+        int64_t utc = utcClock.toUtcMicros(mono);
+        if (previousUtc) {
+            int64_t monoStep = (int64_t)(mono - previousMono);
+            int64_t utcStep = utc - previousUtc;
+            TEST_ASSERT_TRUE(utcStep > 0);
+            // +2: integer rounding of the two conversions
+            TEST_ASSERT_TRUE(absolute(utcStep - monoStep) <= monoStep * maxRatePpb / 1000000000 + 2);
+        }
+        previousUtc = utc;
+        previousMono = mono;
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, utcClock.getStepCount());
+}
+
+void test_large_offset_steps(void) {
+    utcClock.addReference(1000000, UTC_AT_BOOT, 1000, TIME_SOURCE_NTP);
+    utcClock.addReference(11000000, UTC_AT_BOOT + 10000000 + 2000000, 1000, TIME_SOURCE_NTP);
+
+    TEST_ASSERT_EQUAL_UINT32(1, utcClock.getStepCount());
+    TEST_ASSERT_EQUAL_INT64(2000000, utcClock.getLastOffsetMicros());
+    TEST_ASSERT_EQUAL_INT64(UTC_AT_BOOT + 12000000, utcClock.toUtcMicros(11000000));
+    TEST_ASSERT_EQUAL_INT32(0, utcClock.getFrequencyPpb());
+}
+
+void test_sample_time_is_taken_at_the_imu(void) {
+    // readAllSensors() spends tens of ms on the ultrasonic echo and GPS UART
+    // after the IMU read; the sample time must not include that. It is the
+    // data-ready edge of the output the read returned, up to one sample
+    // period before the read.
+    static SimDevice device;
+    simInitDevice(device, 3, makeScenario(SCENARIO_NORMAL_DRIVE, 3, 60000));
+    simSetCurrentDevice(&device);
+
+    SensorManager sensors;
+    TEST_ASSERT_TRUE(sensors.begin());
+    Clock::delay(1000);
+
+    uint64_t before = Clock::micros64();
+    SensorData data = sensors.readAllSensors();
+    uint64_t after = Clock::micros64();
+    simSetCurrentDevice(nullptr);
+
+    TEST_ASSERT_TRUE(after - before > 1000);
+    TEST_ASSERT_EQUAL_UINT64(before - before % (SENSOR_READ_INTERVAL * 1000ULL), data.sampleMicros);
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)(data.sampleMicros / 1000), data.timestamp);
+}
+
+void test_jerk_uses_sample_times(void) {
+    // Samples 100 ms apart whose reads finished 130 ms apart: jerk from the
+    // sample times is 1.9 g / 0.1 s = 19 (score 2, plus vibration -> MINOR);
+    // from the read times it would be 14.6
+    CrashDetectionConfig config;
+    config.jerkThreshold = 18.0;
+    CrashDetector detector;
+    detector.begin(config);
+
+    SensorData previous;
+    memset(&previous, 0, sizeof(previous));
+    previous.accelZ = 1.0;
+    previous.distance = 100.0;
+    previous.timestamp = 1000;
+    previous.sampleMicros = 970000;
+
+    SensorData current = previous;
+    current.accelX = 1.9;
+    current.vibration = HIGH;
+    current.timestamp = 1130;
+    current.sampleMicros = 1070000;
+
+    SensorData before = previous;
+    before.timestamp = 900;
+    before.sampleMicros = 870000;
+
+    detector.addToHistory(before);
+    detector.addToHistory(previous);
+    TEST_ASSERT_EQUAL(MINOR_CRASH, detector.detectCrash(current));
+}
+
+void test_jerk_after_add_compares_with_previous_sample(void) {
+    // The main loop stores a sample before scoring it; the jerk term must
+    // still compare with the sample before, not with itself
+    CrashDetectionConfig config;
+    config.jerkThreshold = 18.0;
+    CrashDetector detector;
+    detector.begin(config);
+
+    SensorData previous;
+    memset(&previous, 0, sizeof(previous));
+    previous.accelZ = 1.0;
+    previous.distance = 100.0;
+    previous.timestamp = 1000;
+    previous.sampleMicros = 1000000;
+
+    SensorData current = previous;
+    current.accelX = 1.9;
+    current.vibration = HIGH;
+    current.timestamp = 1100;
+    current.sampleMicros = 1100000;
+
+    detector.addToHistory(previous);
+    TEST_ASSERT_EQUAL(NO_CRASH, detector.detectCrash(previous));
+    detector.addToHistory(current);
+    TEST_ASSERT_EQUAL(MINOR_CRASH, detector.detectCrash(current));
+    TEST_ASSERT_EQUAL_INT(4, detector.getLastScore());
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_unsynced_until_first_reference);
+    RUN_TEST(test_learns_drift_from_ntp);
+    RUN_TEST(test_holdover_without_references);
+    RUN_TEST(test_jitter_is_slewed_never_stepped);
+    RUN_TEST(test_large_offset_steps);
+    RUN_TEST(test_sample_time_is_taken_at_the_imu);
+    RUN_TEST(test_jerk_uses_sample_times);
+    RUN_TEST(test_jerk_after_add_compares_with_previous_sample);
+
+    return UNITY_END();
+}
+
+int main(void) {
+    return runUnityTests();
+}
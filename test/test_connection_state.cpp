@@ -0,0 +1,266 @@
+#include <unity.h>
+#include <string.h>
+#include <chrono>
+#include "config.h"
+#include "connection_state.h"
+#include "firebase_manager.h"
+#include "hal.h"
+#include "sim_device.h"
+
+// Scripted network: each step completes a fixed time after it was started.
+// Association can be refused for a number of attempts, and the access point
+// can vanish at a given time.
+struct ScriptedLink : public ConnectionLink {
+    uint32_t now = 0;
+
+    uint32_t associateMs = 1500;
+    uint32_t dhcpMs = 200;
+    uint32_t timeSyncMs = 300;
+    uint32_t authMs = 800;
+    int refuseAssociations = 0;
+    int failAuths = 0;
+    bool timeServerReachable = true;
+    uint32_t apLostAt = UINT32_MAX;
+    uint32_t apBackAt = UINT32_MAX;
+
+    bool started = false;
+    uint32_t associateStart = 0;
+    uint32_t timeSyncStart = 0;
+    uint32_t authStart = 0;
+    bool timeSyncStarted = false;
+    bool authFails = false;
+    int associations = 0;
+    int disconnects = 0;
+
+    bool apUp() const {
+        return now < apLostAt || now >= apBackAt;
+    }
+
+    void startAssociation() override {
+        started = true;
+        associateStart = now;
+        associations++;
+    }
+
+    bool isAssociated() override {
+        if (!started || !apUp() || associations <= refuseAssociations) return false;
+        return now - associateStart >= associateMs;
+    }
+
+    bool hasAddress() override {
+        return isAssociated() && now - associateStart >= associateMs + dhcpMs;
+    }
+
+    void startTimeSync() override {
+        timeSyncStarted = true;
+        timeSyncStart = now;
+    }
+
+    bool isTimeSynced() override {
+        return timeSyncStarted && timeServerReachable && now - timeSyncStart >= timeSyncMs;
+    }
+
+    void startAuth() override {
+        authStart = now;
+        authFails = failAuths > 0;
+        if (failAuths > 0) failAuths--;
+    }
+
+    AuthStatus getAuthStatus() override {
+        if (now - authStart < authMs) return AUTH_PENDING;
+        return authFails ? AUTH_FAILED : AUTH_OK;
+    }
+
+    void disconnect() override {
+        started = false;
+        disconnects++;
+    }
+};
+
+ScriptedLink link;
+ConnectionStateMachine connection;
+ConnectionTimings timings;
+
+// Run the state machine like the main loop does (10 ms passes) until it
+// reaches target or the deadline passes; returns the time it got there
+static uint32_t runUntil(ConnectionState target, uint32_t deadline) {
+    while (link.now < deadline) {
+        connection.poll(link.now);
+        if (connection.getState() == target) return link.now;
+        link.now += 10;
+    }
+    return UINT32_MAX;
+}
+
+void setUp(void) {
+    link = ScriptedLink();
+    timings = ConnectionTimings();
+    connection.begin(&link, timings, 12345);
+}
+
+void tearDown(void) {
+}
+
+void test_stages_in_order(void) {
+    const ConnectionState expected[] = {CONN_ASSOCIATING, CONN_DHCP, CONN_TIME_SYNC,
+                                        CONN_AUTH, CONN_READY};
+    int seen = 0;
+    ConnectionState previous = connection.getState();
+    TEST_ASSERT_EQUAL(CONN_IDLE, previous);
+
+    while (link.now < 10000 && !connection.isReady()) {
+        connection.poll(link.now);
+        if (connection.getState() != previous) {
+            previous = connection.getState();
+            TEST_ASSERT_EQUAL(expected[seen], previous);
+            seen++;
+        }
+        link.now += 10;
+    }
+
+    TEST_ASSERT_EQUAL(5, seen);
+    TEST_ASSERT_TRUE(connection.isTimeSynced());
+    TEST_ASSERT_EQUAL_UINT32(0, connection.getFailures());
+    TEST_ASSERT_TRUE(connection.getStateSince() >= 1500 + 200 + 300 + 800);
+}
+
+void test_association_backoff_doubles_to_cap(void) {
+    link.refuseAssociations = 100;
+
+    uint32_t expectedBase = timings.backoffMin;
+    for (int attempt = 0; attempt < 9; attempt++) {
+        TEST_ASSERT_NOT_EQUAL(UINT32_MAX, runUntil(CONN_BACKOFF, link.now + 200000));
+        uint32_t delay = connection.getBackoffDelay();
+        TEST_ASSERT_TRUE(delay >= expectedBase);
+        TEST_ASSERT_TRUE(delay <= expectedBase + expectedBase / 4);
+
+        uint32_t backoffStart = link.now;
+        TEST_ASSERT_NOT_EQUAL(UINT32_MAX, runUntil(CONN_ASSOCIATING, link.now + 200000));
+        TEST_ASSERT_UINT32_WITHIN(10, delay, link.now - backoffStart);
+
+        expectedBase = (expectedBase * 2 > timings.backoffMax) ? timings.backoffMax
+                                                                : expectedBase * 2;
+    }
+    TEST_ASSERT_EQUAL_UINT32(9, connection.getFailures());
+    TEST_ASSERT_EQUAL(9, link.disconnects);
+}
+
+void test_time_sync_timeout_is_not_fatal(void) {
+    link.timeServerReachable = false;
+
+    uint32_t readyAt = runUntil(CONN_READY, 60000);
+    TEST_ASSERT_NOT_EQUAL(UINT32_MAX, readyAt);
+    TEST_ASSERT_FALSE(connection.isTimeSynced());
+    TEST_ASSERT_EQUAL_UINT32(0, connection.getFailures());
+
+    // Picked up later while READY
+    link.timeServerReachable = true;
+    link.now += 10;
+    connection.poll(link.now);
+    TEST_ASSERT_TRUE(connection.isTimeSynced());
+}
+
+void test_auth_failure_retries_and_resets_backoff(void) {
+    link.failAuths = 2;
+
+    TEST_ASSERT_NOT_EQUAL(UINT32_MAX, runUntil(CONN_READY, 60000));
+    TEST_ASSERT_EQUAL_UINT32(2, connection.getFailures());
+    TEST_ASSERT_EQUAL_UINT32(3, connection.getAttempts());
+
+    // A later failure starts again from the minimum backoff
+    link.apLostAt = link.now + 100;
+    TEST_ASSERT_NOT_EQUAL(UINT32_MAX, runUntil(CONN_BACKOFF, link.now + 1000));
+    TEST_ASSERT_TRUE(connection.getBackoffDelay() <= timings.backoffMin + timings.backoffMin / 4);
+}
+
+void test_ap_loss_while_ready_reconnects(void) {
+    TEST_ASSERT_NOT_EQUAL(UINT32_MAX, runUntil(CONN_READY, 10000));
+
+    link.apLostAt = link.now + 5000;
+    link.apBackAt = link.now + 20000;
+    uint32_t lostAt = runUntil(CONN_BACKOFF, link.now + 10000);
+    TEST_ASSERT_UINT32_WITHIN(10, link.apLostAt, lostAt);
+
+    uint32_t readyAgainAt = runUntil(CONN_READY, link.now + 120000);
+    TEST_ASSERT_NOT_EQUAL(UINT32_MAX, readyAgainAt);
+    TEST_ASSERT_TRUE(readyAgainAt > link.apBackAt);
+}
+
+void test_restart_goes_back_to_idle(void) {
+    TEST_ASSERT_NOT_EQUAL(UINT32_MAX, runUntil(CONN_READY, 10000));
+
+    connection.restart();
+    TEST_ASSERT_EQUAL(CONN_IDLE, connection.getState());
+    TEST_ASSERT_EQUAL(1, link.disconnects);
+    TEST_ASSERT_NOT_EQUAL(UINT32_MAX, runUntil(CONN_READY, link.now + 10000));
+}
+
+void test_firebase_manager_never_blocks_the_loop(void) {
+    // The real manager on the simulated Wi-Fi/SNTP/Firebase stack. The
+    // access point is missing for the first 45 s, then drops again for 20 s.
+    static SimDevice device;
+    simInitDevice(device, 7, makeScenario(SCENARIO_NORMAL_DRIVE, 7, 300000));
+    device.wifiAvailable = false;
+    simSetCurrentDevice(&device);
+
+    FirebaseManager firebase;
+    firebase.begin();
+
+    uint64_t maxVirtualBlockMicros = 0;
+    double maxWallMicros = 0;
+    int32_t firstReadyMs = -1;
+    int32_t readyAgainMs = -1;
+    bool lostReady = false;
+
+    while (SimClock::nowMicros() < 180000000ULL) {
+        uint32_t nowMs = Clock::millis();
+        device.wifiAvailable = (nowMs >= 45000 && nowMs < 100000) || nowMs >= 120000;
+
+        uint64_t before = SimClock::nowMicros();
+        auto wallStart = std::chrono::steady_clock::now();
+        firebase.handleConnection();
+        double wallMicros = std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - wallStart).count();
+        uint64_t blocked = SimClock::nowMicros() - before;
+
+        if (blocked > maxVirtualBlockMicros) maxVirtualBlockMicros = blocked;
+        if (wallMicros > maxWallMicros) maxWallMicros = wallMicros;
+
+        if (firebase.isReady()) {
+            if (firstReadyMs < 0) firstReadyMs = nowMs;
+            if (lostReady && readyAgainMs < 0) readyAgainMs = nowMs;
+        } else if (firstReadyMs >= 0) {
+            lostReady = true;
+        }
+        Clock::delay(10);
+    }
+    unsigned long timestamp = firebase.getCurrentTimestamp();
+    simSetCurrentDevice(nullptr);
+
+    TEST_ASSERT_EQUAL_UINT64(0, maxVirtualBlockMicros);
+    TEST_ASSERT_TRUE(maxWallMicros < 1000.0);
+    // Up within one capped backoff period of the AP appearing
+    TEST_ASSERT_TRUE(firstReadyMs >= 45000);
+    TEST_ASSERT_TRUE(firstReadyMs < 45000 + 16000 * 5 / 4 + 2000);
+    TEST_ASSERT_TRUE(lostReady);
+    TEST_ASSERT_TRUE(readyAgainMs >= 120000);
+    TEST_ASSERT_TRUE(timestamp > MIN_VALID_EPOCH);
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_stages_in_order);
+    RUN_TEST(test_association_backoff_doubles_to_cap);
+    RUN_TEST(test_time_sync_timeout_is_not_fatal);
+    RUN_TEST(test_auth_failure_retries_and_resets_backoff);
+    RUN_TEST(test_ap_loss_while_ready_reconnects);
+    RUN_TEST(test_restart_goes_back_to_idle);
+    RUN_TEST(test_firebase_manager_never_blocks_the_loop);
+
+    return UNITY_END();
+}
+
+int main(void) {
+    return runUnityTests();
+}
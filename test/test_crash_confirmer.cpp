@@ -0,0 +1,280 @@
+#include <unity.h>
+#include <string.h>
+#include "config.h"
+#include "crash_confirmer.h"
+#include "crash_detector.h"
+#include "scenario.h"
+
+// Runs on the host (build with -DHAL_SIM)
+
+static CrashConfirmer* confirmer;
+static uint32_t now;
+static uint64_t fixMicros;
+static float fixNorth;  // metres travelled, along the meridian
+
+void setUp(void) {
+    confirmer = new CrashConfirmer();
+    now = 0;
+    fixMicros = 0;
+    fixNorth = 0.0f;
+}
+
+void tearDown(void) {
+    delete confirmer;
+}
+
+static SensorData reading(float x, float y, float z) {
+    SensorData data;
+    memset(&data, 0, sizeof(data));
+    data.accelX = x;
+    data.accelY = y;
+    data.accelZ = z;
+    data.distance = 200.0f;
+    data.timestamp = now;
+    return data;
+}
+
+// One 100 ms step; a GPS fix every second when speedMps >= 0
+static ConfirmEvent step(const SensorData& data, int severity, float speedMps = -1.0f) {
+    now += 100;
+    SensorData sample = data;
+    sample.timestamp = now;
+    if (speedMps >= 0.0f && now % 1000 == 0) {
+        fixNorth += speedMps;
+        fixMicros = (uint64_t)now * 1000;
+        sample.gpsFixMicros = fixMicros;
+        sample.latitude = 12.9716f + fixNorth / 111320.0f;
+        sample.longitude = 77.5946f;
+        confirmer->observeFix(sample);
+    }
+    return confirmer->update(sample, severity, now);
+}
+
+static void driveFor(uint32_t milliseconds, float speedMps = -1.0f) {
+    for (uint32_t t = 0; t < milliseconds; t += 100) {
+        step(reading(0.05f, 0.0f, 1.0f), NO_CRASH, speedMps);
+    }
+}
+
+// Steps until something is decided; returns the event and leaves the
+// decision time in now
+static ConfirmEvent settle(const SensorData& data, float speedMps = -1.0f) {
+    for (int i = 0; i < CONFIRM_WINDOW_MS / 100 + 1; i++) {
+        ConfirmEvent event = step(data, NO_CRASH, speedMps);
+        if (event == CONFIRM_ESCALATE || event == CONFIRM_DISMISS) return event;
+    }
+    return CONFIRM_NONE;
+}
+
+void test_rest_after_impact_confirms(void) {
+    driveFor(3000);
+    TEST_ASSERT_EQUAL(CONFIRM_TRIGGER, step(reading(-12.0f, 2.0f, 1.0f), MODERATE_CRASH));
+    TEST_ASSERT_EQUAL(CONFIRM_PENDING, confirmer->getState());
+    TEST_ASSERT_EQUAL(CONFIRM_ESCALATE, settle(reading(0.0f, 0.0f, 1.0f)));
+    TEST_ASSERT_EQUAL(MODERATE_CRASH, confirmer->getSeverity());
+    TEST_ASSERT_EQUAL(REASON_REST, confirmer->getReason());
+    // Not before the minimum, however soon it came to rest
+    TEST_ASSERT_EQUAL_UINT32(CONFIRM_MIN_MS, now - confirmer->getTriggerMs());
+    TEST_ASSERT_EQUAL(CONFIRM_NONE, step(reading(-12.0f, 0.0f, 1.0f), SEVERE_CRASH));
+    TEST_ASSERT_EQUAL(CONFIRM_CONFIRMED, confirmer->getState());
+}
+
+void test_driving_on_dismisses(void) {
+    driveFor(5000, 15.0f);
+    TEST_ASSERT_EQUAL(CONFIRM_TRIGGER, step(reading(0.0f, 0.0f, 4.0f), MINOR_CRASH, 15.0f));
+    TEST_ASSERT_EQUAL(CONFIRM_DISMISS, settle(reading(0.05f, 0.0f, 1.0f), 15.0f));
+    TEST_ASSERT_EQUAL(REASON_DRIVING, confirmer->getReason());
+    TEST_ASSERT_EQUAL(CONFIRM_IDLE, confirmer->getState());
+    TEST_ASSERT_EQUAL(NO_CRASH, confirmer->getSeverity());
+}
+
+void test_driving_on_after_a_severe_impact_downgrades(void) {
+    driveFor(5000, 15.0f);
+    step(reading(-15.0f, 0.0f, 1.0f), SEVERE_CRASH, 15.0f);
+    TEST_ASSERT_EQUAL(CONFIRM_ESCALATE, settle(reading(0.05f, 0.0f, 1.0f), 15.0f));
+    TEST_ASSERT_EQUAL(MODERATE_CRASH, confirmer->getSeverity());
+    TEST_ASSERT_EQUAL(REASON_SEVERITY, confirmer->getReason());
+}
+
+void test_rest_waits_for_fixes_after_the_impact(void) {
+    driveFor(5000, 15.0f);
+    step(reading(-12.0f, 0.0f, 1.0f), MODERATE_CRASH, 15.0f);
+    uint32_t triggerMs = now;
+    // The first fix after the impact pairs with one from before it, and
+    // still shows the approach speed; only the next pair is at rest
+    TEST_ASSERT_EQUAL(CONFIRM_ESCALATE, settle(reading(0.0f, 0.0f, 1.0f), 0.0f));
+    TEST_ASSERT_EQUAL(REASON_REST, confirmer->getReason());
+    TEST_ASSERT_TRUE(now - triggerMs > CONFIRM_MIN_MS);
+    TEST_ASSERT_TRUE(now - triggerMs <= 2000 + 100);
+}
+
+void test_lost_gps_falls_back_to_the_imu(void) {
+    driveFor(5000, 15.0f);
+    step(reading(-12.0f, 0.0f, 1.0f), MODERATE_CRASH, 15.0f);
+    TEST_ASSERT_EQUAL(CONFIRM_ESCALATE, settle(reading(0.0f, 0.0f, 1.0f)));
+    TEST_ASSERT_EQUAL(REASON_REST, confirmer->getReason());
+    TEST_ASSERT_EQUAL_UINT32(CONFIRM_WINDOW_MS, now - confirmer->getTriggerMs());
+}
+
+void test_tilt_escalates(void) {
+    driveFor(3000);
+    step(reading(0.0f, 4.0f, 1.0f), MODERATE_CRASH);
+    // On its side, still rocking
+    SensorData side = reading(0.0f, 1.0f, 0.05f);
+    side.gyroX = 30.0f;
+    TEST_ASSERT_EQUAL(CONFIRM_ESCALATE, settle(side));
+    TEST_ASSERT_EQUAL(REASON_TILT, confirmer->getReason());
+    TEST_ASSERT_EQUAL(SEVERE_CRASH, confirmer->getSeverity());
+    TEST_ASSERT_TRUE(confirmer->getMaxTiltDegrees() > 80.0f);
+}
+
+void test_parked_jolt_needs_severity(void) {
+    driveFor(5000, 0.0f);
+    step(reading(0.0f, 4.0f, 1.0f), MODERATE_CRASH, 0.0f);
+    TEST_ASSERT_EQUAL(CONFIRM_DISMISS, settle(reading(0.0f, 0.0f, 1.0f), 0.0f));
+    TEST_ASSERT_EQUAL(REASON_NO_EVIDENCE, confirmer->getReason());
+    TEST_ASSERT_EQUAL_UINT32(CONFIRM_WINDOW_MS, now - confirmer->getTriggerMs());
+
+    // Hit hard while parked: still reported, one level down
+    step(reading(0.0f, 12.0f, 1.0f), SEVERE_CRASH, 0.0f);
+    TEST_ASSERT_EQUAL(CONFIRM_ESCALATE, settle(reading(0.0f, 0.0f, 1.0f), 0.0f));
+    TEST_ASSERT_EQUAL(MODERATE_CRASH, confirmer->getSeverity());
+}
+
+void test_free_fall_before_impact_is_a_drop(void) {
+    driveFor(3000);
+    step(reading(0.0f, 0.0f, 0.02f), NO_CRASH);
+    step(reading(0.01f, 0.0f, 0.0f), NO_CRASH);
+    step(reading(0.0f, 0.01f, 0.01f), NO_CRASH);
+    // No pre-warning for a drop
+    TEST_ASSERT_EQUAL(CONFIRM_DISMISS, step(reading(0.0f, 0.0f, 9.0f), MODERATE_CRASH));
+    TEST_ASSERT_EQUAL(REASON_DROPPED, confirmer->getReason());
+    TEST_ASSERT_EQUAL(CONFIRM_IDLE, confirmer->getState());
+
+    // A single low reading is a bump, not a fall
+    driveFor(3000);
+    step(reading(0.0f, 0.0f, 0.1f), NO_CRASH);
+    TEST_ASSERT_EQUAL(CONFIRM_TRIGGER, step(reading(0.0f, 0.0f, 9.0f), MODERATE_CRASH));
+}
+
+void test_severity_rises_in_the_window(void) {
+    driveFor(3000);
+    step(reading(-4.0f, 0.0f, 1.0f), MINOR_CRASH);
+    TEST_ASSERT_EQUAL(CONFIRM_UPDATE, step(reading(-9.0f, 0.0f, 1.0f), SEVERE_CRASH));
+    TEST_ASSERT_EQUAL(SEVERE_CRASH, confirmer->getSeverity());
+    TEST_ASSERT_EQUAL(CONFIRM_NONE, step(reading(-4.0f, 0.0f, 1.0f), MINOR_CRASH));
+    TEST_ASSERT_EQUAL(SEVERE_CRASH, confirmer->getSeverity());
+    TEST_ASSERT_EQUAL(CONFIRM_ESCALATE, settle(reading(0.0f, 0.0f, 1.0f)));
+    TEST_ASSERT_EQUAL(SEVERE_CRASH, confirmer->getSeverity());
+}
+
+void test_missing_imu_is_not_rest(void) {
+    driveFor(3000);
+    step(reading(-12.0f, 0.0f, 1.0f), MODERATE_CRASH);
+    SensorData gap = reading(0.0f, 0.0f, 0.0f);
+    gap.missing = SENSOR_IMU;
+    TEST_ASSERT_EQUAL(CONFIRM_DISMISS, settle(gap));
+    TEST_ASSERT_EQUAL(REASON_NO_EVIDENCE, confirmer->getReason());
+}
+
+// Labeled scenarios through CrashDetector and CrashConfirmer at 10 Hz,
+// with a GPS fix every second, as Firmware::loop() wires them
+struct ReplayResult {
+    bool detected;
+    bool confirmed;
+    uint32_t delayMs;
+};
+
+static ReplayResult replay(ScenarioType type, uint32_t seed) {
+    const uint32_t durationMs = 40000;
+    Scenario scenario = makeScenario(type, seed, durationMs);
+    CrashDetector detector;
+    CrashDetectionConfig config;
+    detector.begin(config);
+    CrashConfirmer replayConfirmer;
+    ReplayResult result = {false, false, 0};
+
+    for (uint32_t t = SCENARIO_PARKED_MS; t < durationMs; t += SENSOR_READ_INTERVAL) {
+        SimMotion motion = sampleScenario(scenario, (uint64_t)t * 1000);
+        SensorData data;
+        memset(&data, 0, sizeof(data));
+        data.accelX = motion.accelX;
+        data.accelY = motion.accelY;
+        data.accelZ = motion.accelZ;
+        data.gyroX = motion.gyroX;
+        data.gyroY = motion.gyroY;
+        data.gyroZ = motion.gyroZ;
+        data.distance = motion.distance;
+        data.vibration = motion.vibration;
+        data.timestamp = t;
+        data.sampleMicros = (uint64_t)t * 1000;
+        if (t % 1000 == 0) {
+            data.latitude = (float)motion.latitude;
+            data.longitude = (float)motion.longitude;
+            data.gpsFixMicros = data.sampleMicros;
+        }
+        replayConfirmer.observeFix(data);
+
+        detector.addToHistory(data);
+        int severity = detector.detectCrash(data);
+        if (severity > NO_CRASH && replayConfirmer.getState() == CONFIRM_IDLE) result.detected = true;
+        ConfirmEvent event = replayConfirmer.update(data, severity, t);
+        if (event == CONFIRM_ESCALATE) {
+            result.confirmed = true;
+            result.delayMs = replayConfirmer.getDecisionMs() - replayConfirmer.getTriggerMs();
+            break;
+        }
+        if (event == CONFIRM_DISMISS) detector.resetCrashDetection();
+    }
+    return result;
+}
+
+void test_replayed_scenarios(void) {
+    const ScenarioType types[] = {SCENARIO_NORMAL_DRIVE, SCENARIO_POTHOLE, SCENARIO_CRASH,
+                                  SCENARIO_ROLLOVER, SCENARIO_DOOR_SLAM, SCENARIO_DROPPED};
+    for (ScenarioType type : types) {
+        int detections = 0;
+        int confirmations = 0;
+        for (uint32_t seed = 1; seed <= 20; seed++) {
+            ReplayResult result = replay(type, seed);
+            if (result.detected) detections++;
+            if (!result.confirmed) continue;
+            confirmations++;
+            TEST_ASSERT_TRUE(result.delayMs >= CONFIRM_MIN_MS);
+            TEST_ASSERT_TRUE(result.delayMs <= CONFIRM_WINDOW_MS);
+        }
+        if (scenarioExpectsCrash(type)) {
+            // Every crash the detector sees is still reported
+            TEST_ASSERT_TRUE(detections >= 15);
+            TEST_ASSERT_EQUAL(detections, confirmations);
+        } else {
+            TEST_ASSERT_EQUAL(0, confirmations);
+        }
+        if (type == SCENARIO_DOOR_SLAM || type == SCENARIO_DROPPED) {
+            // ...which the detector alone would have reported
+            TEST_ASSERT_TRUE(detections > 0);
+        }
+    }
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_rest_after_impact_confirms);
+    RUN_TEST(test_driving_on_dismisses);
+    RUN_TEST(test_driving_on_after_a_severe_impact_downgrades);
+    RUN_TEST(test_rest_waits_for_fixes_after_the_impact);
+    RUN_TEST(test_lost_gps_falls_back_to_the_imu);
+    RUN_TEST(test_tilt_escalates);
+    RUN_TEST(test_parked_jolt_needs_severity);
+    RUN_TEST(test_free_fall_before_impact_is_a_drop);
+    RUN_TEST(test_severity_rises_in_the_window);
+    RUN_TEST(test_missing_imu_is_not_rest);
+    RUN_TEST(test_replayed_scenarios);
+
+    return UNITY_END();
+}
+
+int main(void) {
+    return runUnityTests();
+}
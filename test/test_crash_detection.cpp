@@ -22,7 +22,7 @@ void tearDown(void) {
 }
 
 void test_no_crash_normal_conditions(void) {
-    SensorData normalData;
+    SensorData normalData = {};
     normalData.accelX = 0.1;  // Normal gravity variations
     normalData.accelY = 0.1;
     normalData.accelZ = 1.0;  // 1g due to gravity
@@ -40,7 +40,7 @@ void test_no_crash_normal_conditions(void) {
 }
 
 void test_minor_crash_detection(void) {
-    SensorData crashData;
+    SensorData crashData = {};
     crashData.accelX = 3.5;   // Above threshold
     crashData.accelY = 1.0;
     crashData.accelZ = 2.0;
@@ -58,7 +58,7 @@ void test_minor_crash_detection(void) {
 }
 
 void test_severe_crash_detection(void) {
-    SensorData severeData;
+    SensorData severeData = {};
     severeData.accelX = 8.0;   // Very high acceleration
     severeData.accelY = 6.0;
     severeData.accelZ = 4.0;
@@ -77,7 +77,7 @@ void test_severe_crash_detection(void) {
 
 void test_jerk_calculation(void) {
     // First reading
-    SensorData reading1;
+    SensorData reading1 = {};
     reading1.accelX = 1.0;
     reading1.accelY = 0.0;
     reading1.accelZ = 1.0;
@@ -85,7 +85,7 @@ void test_jerk_calculation(void) {
     detector.addToHistory(reading1);
     
     // Second reading with sudden change
-    SensorData reading2;
+    SensorData reading2 = {};
     reading2.accelX = 5.0;  // Sudden increase
     reading2.accelY = 3.0;
     reading2.accelZ = 2.0;
@@ -98,7 +98,7 @@ void test_jerk_calculation(void) {
 }
 
 void test_consecutive_readings(void) {
-    SensorData highData;
+    SensorData highData = {};
     highData.accelX = 3.2;  // Slightly above threshold
     highData.accelY = 1.0;
     highData.accelZ = 1.5;
@@ -122,7 +122,7 @@ void test_consecutive_readings(void) {
 
 void test_auto_reset_minor_crash(void) {
     // Simulate minor crash
-    SensorData minorCrash;
+    SensorData minorCrash = {};
     minorCrash.accelX = 3.5;
     minorCrash.accelY = 1.0;
     minorCrash.accelZ = 1.5;
@@ -146,7 +146,7 @@ void test_auto_reset_minor_crash(void) {
 
 void test_no_auto_reset_severe_crash(void) {
     // Simulate severe crash
-    SensorData severeCrash;
+    SensorData severeCrash = {};
     severeCrash.accelX = 8.0;
     severeCrash.accelY = 6.0;
     severeCrash.accelZ = 4.0;
@@ -0,0 +1,210 @@
+#include <unity.h>
+#include <string.h>
+#include <vector>
+#include "config.h"
+#include "crash_detector.h"
+#include "crash_sweep.h"
+#include "scenario.h"
+
+// The batch evaluator must reproduce CrashDetector's score for every sample,
+// for both call orders, including configs outside the sensible range.
+
+static std::vector<TraceColumns> traces;
+static uint32_t noiseState;
+
+static float randomIn(float low, float high) {
+    noiseState ^= noiseState << 13;
+    noiseState ^= noiseState >> 17;
+    noiseState ^= noiseState << 5;
+    return low + (high - low) * (noiseState & 0xFFFF) / 65535.0f;
+}
+
+static void buildTraces() {
+    if (!traces.empty()) return;
+    const ScenarioType types[] = {SCENARIO_NORMAL_DRIVE, SCENARIO_POTHOLE,
+                                  SCENARIO_CRASH, SCENARIO_ROLLOVER};
+    for (ScenarioType type : types) {
+        for (uint32_t seed = 1; seed <= 3; seed++) {
+            Scenario scenario = makeScenario(type, seed, 40000);
+            TraceColumns trace;
+            trace.expectsCrash = scenarioExpectsCrash(type);
+            for (uint32_t ms = SENSOR_READ_INTERVAL; ms <= 40000; ms += SENSOR_READ_INTERVAL) {
+                SimMotion motion = sampleScenario(scenario, (uint64_t)ms * 1000);
+                SensorData data;
+                memset(&data, 0, sizeof(data));
+                data.accelX = motion.accelX;
+                data.accelY = motion.accelY;
+                data.accelZ = motion.accelZ;
+                data.gyroX = motion.gyroX;
+                data.gyroY = motion.gyroY;
+                data.gyroZ = motion.gyroZ;
+                data.distance = motion.distance;
+                data.vibration = motion.vibration;
+                data.timestamp = ms;
+                // Every other trace without data-ready times
+                data.sampleMicros = (seed % 2) ? (uint64_t)ms * 1000 : 0;
+                trace.append(data);
+            }
+            traces.push_back(trace);
+        }
+    }
+}
+
+static SensorData row(const TraceColumns& trace, size_t i) {
+    SensorData data;
+    memset(&data, 0, sizeof(data));
+    data.accelX = trace.accelX[i];
+    data.accelY = trace.accelY[i];
+    data.accelZ = trace.accelZ[i];
+    data.gyroX = trace.gyroX[i];
+    data.gyroY = trace.gyroY[i];
+    data.gyroZ = trace.gyroZ[i];
+    data.distance = trace.distance[i];
+    data.vibration = trace.vibration[i];
+    data.timestamp = trace.timestamp[i];
+    data.sampleMicros = trace.sampleMicros[i];
+    return data;
+}
+
+static std::vector<CrashDetectionConfig> testConfigs() {
+    std::vector<CrashDetectionConfig> configs;
+    configs.push_back(CrashDetectionConfig());
+
+    // Low thresholds so every score term fires somewhere
+    CrashDetectionConfig sensitive;
+    sensitive.accelThreshold = 1.05f;
+    sensitive.severeAccelThreshold = 1.3f;
+    sensitive.gyroThreshold = 5.0f;
+    sensitive.severeGyroThreshold = 30.0f;
+    sensitive.jerkThreshold = 0.5f;
+    sensitive.severeJerkThreshold = 2.0f;
+    sensitive.proximityThreshold = 300.0f;
+    sensitive.consecutiveReadings = 2;
+    configs.push_back(sensitive);
+
+    // Edges: negative run threshold (unwritten slots count as high), no
+    // consecutive requirement, a requirement deeper than the history
+    CrashDetectionConfig edges = sensitive;
+    edges.accelThreshold = -1.0f;
+    configs.push_back(edges);
+    edges = sensitive;
+    edges.consecutiveReadings = 0;
+    configs.push_back(edges);
+    edges.consecutiveReadings = SENSOR_HISTORY_SIZE + 2;
+    configs.push_back(edges);
+    edges.consecutiveReadings = SENSOR_HISTORY_SIZE;
+    edges.accelThreshold = 0.5f;
+    configs.push_back(edges);
+
+    noiseState = 2463534242UL;
+    for (int n = 0; n < 40; n++) {
+        CrashDetectionConfig config;
+        config.accelThreshold = randomIn(0.8f, 4.0f);
+        config.severeAccelThreshold = randomIn(0.8f, 6.0f);
+        config.gyroThreshold = randomIn(0.0f, 300.0f);
+        config.severeGyroThreshold = randomIn(0.0f, 500.0f);
+        config.jerkThreshold = randomIn(0.0f, 60.0f);
+        config.severeJerkThreshold = randomIn(0.0f, 90.0f);
+        config.proximityThreshold = randomIn(0.0f, 400.0f);
+        config.consecutiveReadings = (int)randomIn(1.0f, 6.0f);
+        configs.push_back(config);
+    }
+    return configs;
+}
+
+static void checkOrder(ScoreOrder order) {
+    buildTraces();
+    std::vector<CrashDetectionConfig> configs = testConfigs();
+
+    for (const TraceColumns& trace : traces) {
+        TraceFeatures features;
+        computeFeatures(trace, order, features);
+        std::vector<int8_t> scores(trace.size());
+
+        for (const CrashDetectionConfig& config : configs) {
+            scoreTrace(features, config, order, scores.data());
+
+            CrashDetector detector;
+            detector.begin(config);
+            for (size_t i = 0; i < trace.size(); i++) {
+                SensorData data = row(trace, i);
+                if (order == SCORE_AFTER_ADD) {
+                    detector.addToHistory(data);
+                    detector.detectCrash(data);
+                } else {
+                    detector.detectCrash(data);
+                    detector.addToHistory(data);
+                }
+                TEST_ASSERT_EQUAL_INT(detector.getLastScore(), scores[i]);
+            }
+        }
+    }
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_scores_match_detector_after_add(void) {
+    checkOrder(SCORE_AFTER_ADD);
+}
+
+void test_scores_match_detector_before_add(void) {
+    checkOrder(SCORE_BEFORE_ADD);
+}
+
+void test_confusion_counts_match_per_trace_maximum(void) {
+    buildTraces();
+    std::vector<CrashDetectionConfig> configs = testConfigs();
+    std::vector<TraceFeatures> features(traces.size());
+    for (size_t t = 0; t < traces.size(); t++) {
+        computeFeatures(traces[t], SCORE_BEFORE_ADD, features[t]);
+    }
+
+    std::vector<ConfusionCounts> results;
+    evaluateConfigs(features, configs, SCORE_BEFORE_ADD, 3, results);
+    TEST_ASSERT_EQUAL(configs.size(), results.size());
+
+    for (size_t c = 0; c < configs.size(); c++) {
+        ConfusionCounts expected = {};
+        for (const TraceColumns& trace : traces) {
+            CrashDetector detector;
+            detector.begin(configs[c]);
+            int worst = NO_CRASH;
+            for (size_t i = 0; i < trace.size(); i++) {
+                SensorData data = row(trace, i);
+                int severity = detector.detectCrash(data);
+                detector.addToHistory(data);
+                if (severity > worst) worst = severity;
+            }
+            if (trace.expectsCrash) expected.positives++;
+            else expected.negatives++;
+            for (int level = MINOR_CRASH; level <= worst; level++) {
+                if (trace.expectsCrash) expected.truePositive[level]++;
+                else expected.falsePositive[level]++;
+            }
+        }
+        TEST_ASSERT_EQUAL_UINT32(expected.positives, results[c].positives);
+        TEST_ASSERT_EQUAL_UINT32(expected.negatives, results[c].negatives);
+        for (int level = MINOR_CRASH; level <= SEVERE_CRASH; level++) {
+            TEST_ASSERT_EQUAL_UINT32(expected.truePositive[level], results[c].truePositive[level]);
+            TEST_ASSERT_EQUAL_UINT32(expected.falsePositive[level], results[c].falsePositive[level]);
+        }
+    }
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_scores_match_detector_after_add);
+    RUN_TEST(test_scores_match_detector_before_add);
+    RUN_TEST(test_confusion_counts_match_per_trace_maximum);
+
+    return UNITY_END();
+}
+
+int main(void) {
+    return runUnityTests();
+}
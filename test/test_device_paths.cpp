@@ -0,0 +1,71 @@
+#include <unity.h>
+#include <string.h>
+#include "config.h"
+#include "device_paths.h"
+
+DevicePaths paths;
+
+void setUp(void) {
+    // MAC 24:a1:60:c3:b2:f0 as stored in eFuse (first octet in the low byte)
+    paths.begin((uint64_t)0xF0B2C360A124ULL);
+}
+
+void tearDown(void) {
+}
+
+void test_device_id_from_efuse_mac(void) {
+    TEST_ASSERT_EQUAL_STRING(DEVICE_ID_PREFIX "24a160c3b2f0", paths.getDeviceId());
+    TEST_ASSERT_EQUAL(DEVICE_ID_SIZE - 1, strlen(paths.getDeviceId()));
+}
+
+void test_paths_are_device_scoped(void) {
+    TEST_ASSERT_EQUAL_STRING(FB_DEVICES_ROOT "esp32-24a160c3b2f0/sensors/accelX",
+                             paths.get(PATH_ACCEL_X));
+    TEST_ASSERT_EQUAL_STRING(FB_DEVICES_ROOT "esp32-24a160c3b2f0/crashStatus",
+                             paths.get(PATH_CRASH_STATUS));
+    TEST_ASSERT_EQUAL_STRING(FB_DEVICES_ROOT "esp32-24a160c3b2f0/sensors",
+                             paths.get(PATH_SENSORS));
+}
+
+void test_two_devices_do_not_collide(void) {
+    DevicePaths other;
+    other.begin((uint64_t)0xF1B2C360A124ULL);
+
+    for (int i = 0; i < DEVICE_PATH_COUNT; i++) {
+        TEST_ASSERT_NOT_EQUAL(0, strcmp(paths.get((DevicePath)i),
+                                        other.get((DevicePath)i)));
+    }
+}
+
+void test_emergency_path_fits_largest_timestamp(void) {
+    char path[DEVICE_PATH_SIZE];
+    size_t written = paths.formatEmergencyPath(path, sizeof(path), 4294967295UL);
+
+    TEST_ASSERT_EQUAL_STRING(FB_DEVICES_ROOT "esp32-24a160c3b2f0/emergency/4294967295", path);
+    TEST_ASSERT_EQUAL(strlen(path), written);
+}
+
+void test_explicit_device_id(void) {
+    DevicePaths simulated;
+    simulated.begin("sim-00042");
+
+    TEST_ASSERT_EQUAL_STRING("sim-00042", simulated.getDeviceId());
+    TEST_ASSERT_EQUAL_STRING(FB_DEVICES_ROOT "sim-00042/emergencyActive",
+                             simulated.get(PATH_EMERGENCY_ACTIVE));
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_device_id_from_efuse_mac);
+    RUN_TEST(test_paths_are_device_scoped);
+    RUN_TEST(test_two_devices_do_not_collide);
+    RUN_TEST(test_emergency_path_fits_largest_timestamp);
+    RUN_TEST(test_explicit_device_id);
+
+    return UNITY_END();
+}
+
+int main(void) {
+    return runUnityTests();
+}
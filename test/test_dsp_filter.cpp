@@ -0,0 +1,241 @@
+#include <unity.h>
+#include <math.h>
+#include <string.h>
+#include "config.h"
+#include "crash_detector.h"
+#include "dsp_filter.h"
+#include "sensor_filter.h"
+
+static const float RATE_HZ = 100.0f;
+static uint32_t noiseState;
+
+static float noise() {
+    noiseState = noiseState * 1664525UL + 1013904223UL;
+    return ((noiseState >> 8) / 16777216.0f) * 2.0f - 1.0f;
+}
+
+// Steady-state gain for a sine: once the transient has died out, correlate
+// the output with sine and cosine over whole periods
+static float measuredGain(BiquadCascade& cascade, float frequencyHz) {
+    cascade.reset();
+    double inPhase = 0.0, quadrature = 0.0;
+    const int settle = 3000, length = 1000;   // 1000 samples: whole periods of each test tone
+    for (int n = 0; n < settle + length; n++) {
+        double phase = 2.0 * M_PI * frequencyHz * n / RATE_HZ;
+        float y = cascade.process((float)sin(phase));
+        if (n < settle) continue;
+        inPhase += y * sin(phase);
+        quadrature += y * cos(phase);
+    }
+    return (float)(2.0 * sqrt(inPhase * inPhase + quadrature * quadrature) / length);
+}
+
+static void addButterworth(BiquadCascade& cascade, float cutoffHz, int order) {
+    for (int i = 0; i < order / 2; i++) {
+        cascade.add(designLowPass(cutoffHz, RATE_HZ, butterworthQ(order, i)));
+    }
+}
+
+void setUp(void) {
+    noiseState = 11;
+}
+
+void tearDown(void) {
+}
+
+void test_butterworth_low_pass_response(void) {
+    BiquadCascade cascade;
+    addButterworth(cascade, 10.0f, 4);
+    TEST_ASSERT_EQUAL_INT(2, cascade.size());
+
+    // -3 dB at the cutoff, flat below, 24 dB/octave above
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, 0.7071f, cascade.magnitudeAt(10.0f, RATE_HZ));
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 1.0f, cascade.magnitudeAt(2.0f, RATE_HZ));
+    TEST_ASSERT_TRUE(cascade.magnitudeAt(40.0f, RATE_HZ) < 0.005f);
+
+    const float frequencies[] = {1.0f, 5.0f, 10.0f, 15.0f, 25.0f, 40.0f};
+    for (float f : frequencies) {
+        float expected = cascade.magnitudeAt(f, RATE_HZ);
+        TEST_ASSERT_FLOAT_WITHIN(0.01f * expected + 2e-4f, expected, measuredGain(cascade, f));
+    }
+}
+
+void test_high_pass_removes_constant(void) {
+    BiquadCascade cascade;
+    cascade.add(designHighPass(0.5f, RATE_HZ, butterworthQ(2, 0)));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.0f, cascade.magnitudeAt(0.0f, RATE_HZ));
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 1.0f, measuredGain(cascade, 10.0f));
+
+    // A step (gravity appearing) decays away
+    cascade.reset();
+    float y = 0.0f;
+    for (int n = 0; n < 1000; n++) y = cascade.process(1.0f);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 0.0f, y);
+}
+
+void test_notch_rejects_centre_only(void) {
+    BiquadCascade cascade;
+    cascade.add(designNotch(25.0f, RATE_HZ, 5.0f));
+    TEST_ASSERT_TRUE(measuredGain(cascade, 25.0f) < 0.01f);
+    TEST_ASSERT_TRUE(measuredGain(cascade, 5.0f) > 0.97f);
+    TEST_ASSERT_TRUE(measuredGain(cascade, 45.0f) > 0.97f);
+}
+
+void test_reset_settles_at_steady_state(void) {
+    BiquadCascade lowPass;
+    addButterworth(lowPass, 10.0f, 6);
+    lowPass.reset(1.0f);
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, 1.0f, lowPass.process(1.0f));
+
+    BiquadCascade highPass;
+    highPass.add(designHighPass(0.5f, RATE_HZ, butterworthQ(2, 0)));
+    highPass.reset(1.0f);
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, 0.0f, highPass.process(1.0f));
+}
+
+void test_fixed_point_tracks_float(void) {
+    BiquadCascade floating;
+    BiquadCascadeFixed fixed;
+    floating.add(designHighPass(0.5f, RATE_HZ, butterworthQ(2, 0)));
+    fixed.add(designHighPass(0.5f, RATE_HZ, butterworthQ(2, 0)));
+    for (int i = 0; i < 2; i++) {
+        BiquadCoefficients section = designLowPass(10.0f, RATE_HZ, butterworthQ(4, i));
+        floating.add(section);
+        fixed.add(section);
+    }
+
+    // Raw accel counts at ±8 g with 12 fractional bits, as the sensor
+    // filter feeds them
+    const float scale = MPU6050_ACCEL_LSB_PER_G * 4096.0f;
+    float worst = 0.0f;
+    for (int n = 0; n < 5000; n++) {
+        float x = 1.0f + 2.0f * noise();
+        float expected = floating.process(x);
+        float actual = fixed.process((int32_t)lrintf(x * scale)) / scale;
+        if (fabsf(actual - expected) > worst) worst = fabsf(actual - expected);
+    }
+    // Well under one sensor count (1/4096 g)
+    TEST_ASSERT_TRUE(worst < 0.25f / MPU6050_ACCEL_LSB_PER_G);
+}
+
+void test_savitzky_golay_derivative(void) {
+    float weights[FILTER_MAX_TAPS];
+    TEST_ASSERT_TRUE(savitzkyGolayDerivative(2, 1, weights));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 1.0f, weights[0]);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, -1.0f, weights[1]);
+    TEST_ASSERT_FALSE(savitzkyGolayDerivative(3, 3, weights));
+    TEST_ASSERT_FALSE(savitzkyGolayDerivative(FILTER_MAX_TAPS + 1, 2, weights));
+
+    // A quadratic fit differentiates a quadratic exactly at the newest sample
+    TEST_ASSERT_TRUE(savitzkyGolayDerivative(7, 2, weights));
+    FirFilter derivative;
+    TEST_ASSERT_TRUE(derivative.setTaps(weights, 7));
+    float slope = 0.0f;
+    for (int n = 0; n < 20; n++) {
+        slope = derivative.process(3.0f + 2.0f * n + 0.25f * n * n);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 2.0f + 0.5f * 19, slope);
+
+    // A straight-line fit over 9 samples has a fraction of the two-point
+    // difference's white-noise gain
+    TEST_ASSERT_TRUE(savitzkyGolayDerivative(9, 1, weights));
+    float gain = 0.0f;
+    for (int i = 0; i < 9; i++) gain += weights[i] * weights[i];
+    TEST_ASSERT_TRUE(sqrtf(gain) < sqrtf(2.0f) / 5.0f);
+}
+
+void test_sensor_filter_configuration(void) {
+    SensorData data;
+    memset(&data, 0, sizeof(data));
+    data.accelZ = 1.0f;
+    data.gyroX = 3.0f;
+    data.distance = 42.0f;
+
+    // Defaults pass readings through unchanged
+    SensorFilter filter;
+    filter.begin(FilterConfig());
+    TEST_ASSERT_FALSE(filter.isActive());
+    SensorData copy = data;
+    filter.process(copy);
+    TEST_ASSERT_EQUAL_MEMORY(&data, &copy, sizeof(data));
+
+    // Above Nyquist is ignored; a valid low-pass starts settled
+    FilterConfig config;
+    config.sampleRateHz = RATE_HZ;
+    config.notchHz = 60.0f;
+    config.accelLowPassHz = 10.0f;
+    config.lowPassOrder = 4;
+    for (int fixedPoint = 0; fixedPoint <= 1; fixedPoint++) {
+        config.fixedPoint = fixedPoint;
+        filter.begin(config);
+        TEST_ASSERT_TRUE(filter.isActive());
+        copy = data;
+        filter.process(copy);
+        TEST_ASSERT_FLOAT_WITHIN(1e-3f, 1.0f, copy.accelZ);
+        TEST_ASSERT_EQUAL_FLOAT(3.0f, copy.gyroX);
+        TEST_ASSERT_EQUAL_FLOAT(42.0f, copy.distance);
+    }
+}
+
+// Counts samples where only the jerk factor can score
+static int jerkScores(int window, bool detectFirst, float rampGPerSecond) {
+    CrashDetectionConfig config;
+    config.accelThreshold = 100.0f;
+    config.severeAccelThreshold = 200.0f;
+    config.jerkThreshold = 1.0f;
+    config.jerkWindow = window;
+    config.consecutiveReadings = 100;
+    CrashDetector detector;
+    detector.begin(config);
+
+    int scored = 0;
+    noiseState = 5;
+    for (uint32_t n = 1; n <= 300; n++) {
+        SensorData data;
+        memset(&data, 0, sizeof(data));
+        data.accelX = 0.1f * noise() + rampGPerSecond * n * 0.1f;
+        data.accelZ = 1.0f + 0.1f * noise();
+        data.timestamp = n * 100;
+        data.sampleMicros = (uint64_t)n * 100000;
+        if (detectFirst) {
+            detector.detectCrash(data);
+            detector.addToHistory(data);
+        } else {
+            detector.addToHistory(data);
+            detector.detectCrash(data);
+        }
+        if (detector.getLastScore() > 0) scored++;
+    }
+    return scored;
+}
+
+void test_smoothed_jerk_rejects_noise(void) {
+    // Road noise alone: the two-point difference fires, the fitted slope
+    // does not, in either call order
+    TEST_ASSERT_TRUE(jerkScores(2, true, 0.0f) > 30);
+    TEST_ASSERT_EQUAL_INT(0, jerkScores(9, true, 0.0f));
+    TEST_ASSERT_EQUAL_INT(0, jerkScores(9, false, 0.0f));
+
+    // A sustained 2 g/s change is still seen, including in the main loop's
+    // add-then-detect order
+    TEST_ASSERT_TRUE(jerkScores(9, false, 2.0f) > 280);
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_butterworth_low_pass_response);
+    RUN_TEST(test_high_pass_removes_constant);
+    RUN_TEST(test_notch_rejects_centre_only);
+    RUN_TEST(test_reset_settles_at_steady_state);
+    RUN_TEST(test_fixed_point_tracks_float);
+    RUN_TEST(test_savitzky_golay_derivative);
+    RUN_TEST(test_sensor_filter_configuration);
+    RUN_TEST(test_smoothed_jerk_rejects_noise);
+
+    return UNITY_END();
+}
+
+int main(void) {
+    return runUnityTests();
+}
@@ -0,0 +1,168 @@
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "config.h"
+#include "firmware.h"
+#include "sim_device.h"
+#include "status_format.h"
+
+// A unit of the real firmware on the sim shims, driven through a crash,
+// and its FirebaseManager alone for the alert queue
+static SimDevice device;
+static ResetRecord resetRecord;
+static Firmware* firmware;
+
+static bool bootFirmware(ScenarioType scenario, uint32_t seed, uint32_t durationMs) {
+    simInitDevice(device, seed, makeScenario(scenario, seed, durationMs));
+    simSetCurrentDevice(&device);
+    memset(&resetRecord, 0, sizeof(resetRecord));
+    firmware = new Firmware();
+    return firmware->setup(&resetRecord, RESET_POWER_ON);
+}
+
+static void endFirmware(void) {
+    delete firmware;
+    firmware = nullptr;
+    simSetCurrentDevice(nullptr);
+}
+
+// The member text of "key": in the last alert, or "" if absent
+static const char* alertMember(const char* key, char* value, size_t valueSize) {
+    char pattern[48];
+    snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+    value[0] = '\0';
+    const char* start = strstr(device.lastEmergencyBody, pattern);
+    if (!start) return value;
+    start += strlen(pattern);
+    size_t length = strcspn(start, ",");
+    if (length >= valueSize) length = valueSize - 1;
+    memcpy(value, start, length);
+    value[length] = '\0';
+    return value;
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_alert_carries_the_trigger_sample(void) {
+    const uint32_t durationMs = 60000;
+    TEST_ASSERT_TRUE(bootFirmware(SCENARIO_CRASH, 3, durationMs));
+
+    SensorData trigger;
+    memset(&trigger, 0, sizeof(trigger));
+    SensorData decision;
+    memset(&decision, 0, sizeof(decision));
+    bool triggered = false;
+    bool escalated = false;
+    while (Clock::millis() < durationMs && device.emergencyAlerts == 0) {
+        firmware->loop();
+        ConfirmEvent event = firmware->getLastPass().confirmEvent;
+        if (event == CONFIRM_TRIGGER) {
+            trigger = firmware->currentData;
+            triggered = true;
+        } else if (event == CONFIRM_ESCALATE) {
+            decision = firmware->currentData;
+            escalated = true;
+        }
+    }
+    TEST_ASSERT_TRUE(triggered);
+    TEST_ASSERT_TRUE(escalated);
+    TEST_ASSERT_EQUAL_UINT32(1, device.emergencyAlerts);
+    TEST_ASSERT_TRUE(elapsedMillis(trigger.timestamp, decision.timestamp) >= 1000);
+
+    // Magnitudes of the impact, not of the car at rest afterwards
+    char expected[32];
+    char value[32];
+    snprintf(expected, sizeof(expected), "%.6g",
+             sqrt(trigger.accelX * trigger.accelX + trigger.accelY * trigger.accelY +
+                  trigger.accelZ * trigger.accelZ));
+    TEST_ASSERT_EQUAL_STRING(expected, alertMember("accelMagnitude", value, sizeof(value)));
+    TEST_ASSERT_TRUE(trigger.accelX * trigger.accelX + trigger.accelY * trigger.accelY +
+                     trigger.accelZ * trigger.accelZ >
+                     4.0f * (decision.accelX * decision.accelX + decision.accelY * decision.accelY +
+                             decision.accelZ * decision.accelZ));
+    snprintf(expected, sizeof(expected), "%.6g", (double)trigger.latitude);
+    TEST_ASSERT_EQUAL_STRING(expected, alertMember("latitude", value, sizeof(value)));
+
+    // UTC of the impact sample, and the path under the impact second
+    TEST_ASSERT_TRUE(firmware->utcClock.isSynced());
+    char utc[UTC_TIMESTAMP_SIZE];
+    formatUtcTimestamp(utc, sizeof(utc), firmware->utcClock.toUtcMicros(trigger.sampleMicros));
+    snprintf(expected, sizeof(expected), "\"%s\"", utc);
+    TEST_ASSERT_EQUAL_STRING(expected, alertMember("utc", value, sizeof(value)));
+
+    unsigned long impactSecond = firmware->firebase.getSampleTimestamp(trigger);
+    snprintf(expected, sizeof(expected), "/" FB_EMERGENCY_PATH "%lu", impactSecond);
+    TEST_ASSERT_NOT_NULL(strstr(device.lastEmergencyPath, expected));
+    snprintf(expected, sizeof(expected), "%lu", impactSecond);
+    TEST_ASSERT_EQUAL_STRING(expected, alertMember("timestamp", value, sizeof(value)));
+    TEST_ASSERT_TRUE(impactSecond < firmware->firebase.getSampleTimestamp(decision));
+    endFirmware();
+}
+
+// A reading told apart by its acceleration
+static SensorData alertReading(float accelX) {
+    SensorData data;
+    memset(&data, 0, sizeof(data));
+    data.accelX = accelX;
+    data.timestamp = Clock::millis();
+    return data;
+}
+
+void test_alerts_held_offline_are_sent_in_order(void) {
+    simInitDevice(device, 4, makeScenario(SCENARIO_NORMAL_DRIVE, 4, 60000));
+    simSetCurrentDevice(&device);
+    FirebaseManager* firebase = new FirebaseManager();
+    firebase->begin();
+    TEST_ASSERT_FALSE(firebase->isReady());
+
+    // Not yet connected: the queue fills, and the one past it is refused
+    // rather than replacing an alert already held
+    for (int alert = 1; alert <= EMERGENCY_ALERT_QUEUE; alert++) {
+        TEST_ASSERT_TRUE(firebase->queueEmergencyAlert(alertReading(10.0f * alert), SEVERE_CRASH));
+    }
+    TEST_ASSERT_FALSE(firebase->queueEmergencyAlert(alertReading(99.0f), SEVERE_CRASH));
+    TEST_ASSERT_EQUAL_UINT8(EMERGENCY_ALERT_QUEUE, firebase->getPendingAlerts());
+    TEST_ASSERT_EQUAL_UINT32(1, firebase->getDroppedAlerts());
+    firebase->flushPending();
+    TEST_ASSERT_EQUAL_UINT32(0, device.emergencyAlerts);
+
+    while (!firebase->isReady() && Clock::millis() < 30000) {
+        simAdvanceMicros(10000);
+        firebase->handleConnection();
+    }
+    TEST_ASSERT_TRUE(firebase->isReady());
+
+    // All of them with one flush, the newest last
+    firebase->flushPending();
+    TEST_ASSERT_EQUAL_UINT32(EMERGENCY_ALERT_QUEUE, device.emergencyAlerts);
+    TEST_ASSERT_EQUAL_UINT8(0, firebase->getPendingAlerts());
+    TEST_ASSERT_FALSE(firebase->hasPending());
+    char expected[32];
+    char value[32];
+    snprintf(expected, sizeof(expected), "%.6g", 10.0 * EMERGENCY_ALERT_QUEUE);
+    TEST_ASSERT_EQUAL_STRING(expected, alertMember("accelMagnitude", value, sizeof(value)));
+
+    // Room again once sent
+    TEST_ASSERT_TRUE(firebase->queueEmergencyAlert(alertReading(50.0f), SEVERE_CRASH));
+    TEST_ASSERT_EQUAL_UINT32(1, firebase->getDroppedAlerts());
+    delete firebase;
+    simSetCurrentDevice(nullptr);
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_alert_carries_the_trigger_sample);
+    RUN_TEST(test_alerts_held_offline_are_sent_in_order);
+
+    return UNITY_END();
+}
+
+int main(void) {
+    return runUnityTests();
+}
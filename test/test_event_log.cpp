@@ -0,0 +1,298 @@
+#include <unity.h>
+#include <string.h>
+#include "config.h"
+#include "event_log.h"
+#include "sim_flash.h"
+
+// Runs on the host (build with -DHAL_SIM)
+
+#define SECTOR 4096
+#define SECTORS 8
+
+static SimFlash* flash;
+static EventLog* eventLog;
+
+void setUp(void) {
+    flash = new SimFlash(SECTORS * SECTOR, SECTOR);
+    eventLog = new EventLog();
+}
+
+void tearDown(void) {
+    delete eventLog;
+    delete flash;
+}
+
+static EventRecord event(uint32_t utc, int severity, int score) {
+    SensorData data;
+    memset(&data, 0, sizeof(data));
+    data.accelX = 0.5f;
+    data.accelZ = 1.0f;
+    data.gyroY = -12.34f;
+    data.distance = 150.0f;
+    data.timestamp = utc * 10;
+    EventRecord record = makeEventRecord(EVENT_SCORED, data, severity, score, SENSOR_ALL);
+    record.utcSeconds = utc;
+    return record;
+}
+
+static void appendEvents(uint32_t count, uint32_t firstUtc, int severity, int score) {
+    for (uint32_t i = 0; i < count; i++) {
+        EventRecord record = event(firstUtc + i, severity, score);
+        TEST_ASSERT_TRUE(eventLog->append(record));
+    }
+}
+
+static void remount(void) {
+    delete eventLog;
+    eventLog = new EventLog();
+    TEST_ASSERT_TRUE(eventLog->begin(flash));
+}
+
+// Collects what a query visits
+static EventRecord visited[1024];
+static uint32_t visitedCount;
+
+static bool collect(const EventRecord& record, void*) {
+    if (visitedCount < 1024) visited[visitedCount] = record;
+    visitedCount++;
+    return true;
+}
+
+static uint32_t run(const EventQuery& query) {
+    visitedCount = 0;
+    uint32_t matched = eventLog->query(query, collect, nullptr);
+    return matched == visitedCount ? matched : UINT32_MAX;
+}
+
+void test_append_and_query_in_order(void) {
+    TEST_ASSERT_TRUE(eventLog->begin(flash));
+    TEST_ASSERT_EQUAL_UINT32(SECTORS, eventLog->getSegmentCount());
+    TEST_ASSERT_EQUAL_UINT32(SECTOR / EVENT_RECORD_SIZE - 2, eventLog->getRecordsPerSegment());
+
+    appendEvents(150, 1000, MINOR_CRASH, 2);
+    TEST_ASSERT_EQUAL_UINT32(150, eventLog->getRecordCount());
+    TEST_ASSERT_EQUAL_UINT32(3, eventLog->getUsedSegments());
+
+    TEST_ASSERT_EQUAL_UINT32(150, run(EventQuery()));
+    for (uint32_t i = 0; i < 150; i++) {
+        TEST_ASSERT_EQUAL_UINT32(i, visited[i].sequence);
+        TEST_ASSERT_EQUAL_UINT32(1000 + i, visited[i].utcSeconds);
+    }
+    TEST_ASSERT_EQUAL_INT16(500, visited[0].accelMg[0]);
+    TEST_ASSERT_EQUAL_INT16(-123, visited[0].gyroDeciDps[1]);
+    TEST_ASSERT_EQUAL_INT16(150, visited[0].distanceCm);
+
+    EventQuery limited;
+    limited.limit = 5;
+    TEST_ASSERT_EQUAL_UINT32(5, run(limited));
+}
+
+void test_remount_reads_headers_and_footers_only(void) {
+    TEST_ASSERT_TRUE(eventLog->begin(flash));
+    uint32_t perSegment = eventLog->getRecordsPerSegment();
+    appendEvents(perSegment * 3 + 10, 1000, MINOR_CRASH, 1);
+
+    flash->resetCounters();
+    remount();
+    // Three sealed segments from their footers; only the open one is scanned
+    TEST_ASSERT_TRUE(flash->bytesRead < (uint64_t)(SECTORS * 2 + 16) * EVENT_RECORD_SIZE);
+    TEST_ASSERT_EQUAL_UINT32(perSegment * 3 + 10, eventLog->getRecordCount());
+
+    // Appends carry on from the open segment with the next sequence
+    appendEvents(1, 5000, MINOR_CRASH, 1);
+    TEST_ASSERT_EQUAL_UINT32(4, eventLog->getUsedSegments());
+    EventQuery latest;
+    latest.fromUtc = 5000;
+    TEST_ASSERT_EQUAL_UINT32(1, run(latest));
+    TEST_ASSERT_EQUAL_UINT32(perSegment * 3 + 10, visited[0].sequence);
+}
+
+void test_torn_write_is_skipped(void) {
+    TEST_ASSERT_TRUE(eventLog->begin(flash));
+    appendEvents(5, 1000, MINOR_CRASH, 1);
+
+    // Reset half way through the sixth record
+    flash->tearAfter(20);
+    EventRecord torn = event(1005, MINOR_CRASH, 1);
+    TEST_ASSERT_FALSE(eventLog->append(torn));
+    flash->tearAfter(-1);
+
+    remount();
+    appendEvents(3, 1006, MINOR_CRASH, 1);
+    TEST_ASSERT_EQUAL_UINT32(8, run(EventQuery()));
+    TEST_ASSERT_EQUAL_UINT32(1004, visited[4].utcSeconds);
+    TEST_ASSERT_EQUAL_UINT32(1006, visited[5].utcSeconds);
+    TEST_ASSERT_EQUAL_UINT32(6, visited[5].sequence);
+}
+
+void test_full_segment_sealed_after_reset(void) {
+    TEST_ASSERT_TRUE(eventLog->begin(flash));
+    uint32_t perSegment = eventLog->getRecordsPerSegment();
+    appendEvents(perSegment, 1000, MINOR_CRASH, 1);
+    // Full, but the footer is only written when the next record needs room
+    TEST_ASSERT_FALSE(eventLog->getSegment(0)->sealed);
+
+    remount();
+    appendEvents(1, 2000, MINOR_CRASH, 1);
+    TEST_ASSERT_TRUE(eventLog->getSegment(0)->sealed);
+    remount();
+    TEST_ASSERT_TRUE(eventLog->getSegment(0)->sealed);
+    TEST_ASSERT_EQUAL_UINT32(perSegment + 1, run(EventQuery()));
+}
+
+void test_budget_prunes_oldest_segment(void) {
+    TEST_ASSERT_TRUE(eventLog->begin(flash, 4 * SECTOR));
+    TEST_ASSERT_EQUAL_UINT32(4, eventLog->getSegmentCount());
+    uint32_t perSegment = eventLog->getRecordsPerSegment();
+
+    appendEvents(perSegment * 6, 1000, MINOR_CRASH, 1);
+    TEST_ASSERT_EQUAL_UINT32(4, eventLog->getUsedSegments());
+    TEST_ASSERT_EQUAL_UINT32(2, eventLog->getPrunedSegments());
+    // Nothing outside the budget was touched
+    uint8_t byte;
+    TEST_ASSERT_TRUE(flash->read(4 * SECTOR, &byte, 1));
+    TEST_ASSERT_EQUAL_UINT8(0xFF, byte);
+
+    TEST_ASSERT_EQUAL_UINT32(perSegment * 4, run(EventQuery()));
+    TEST_ASSERT_EQUAL_UINT32(perSegment * 2, visited[0].sequence);
+}
+
+void test_pruning_keeps_severe_segments(void) {
+    TEST_ASSERT_TRUE(eventLog->begin(flash, 4 * SECTOR));
+    uint32_t perSegment = eventLog->getRecordsPerSegment();
+
+    appendEvents(1, 500, SEVERE_CRASH, 9);
+    appendEvents(perSegment - 1, 501, NO_CRASH, 1);
+    appendEvents(perSegment * 6, 1000, MINOR_CRASH, 1);
+
+    EventQuery severe;
+    severe.minSeverity = EVENT_LOG_KEEP_SEVERITY;
+    TEST_ASSERT_EQUAL_UINT32(1, run(severe));
+    TEST_ASSERT_EQUAL_UINT32(500, visited[0].utcSeconds);
+
+    // Once every segment is worth keeping, the oldest goes after all
+    appendEvents(perSegment * 4, 5000, SEVERE_CRASH, 9);
+    TEST_ASSERT_EQUAL_UINT32(perSegment * 4, run(severe));
+    TEST_ASSERT_EQUAL_UINT32(5000, visited[0].utcSeconds);
+}
+
+void test_query_skips_segments_by_summary(void) {
+    TEST_ASSERT_TRUE(eventLog->begin(flash));
+    uint32_t perSegment = eventLog->getRecordsPerSegment();
+    // Five segments a day apart; a near miss in the third
+    for (uint32_t segment = 0; segment < 5; segment++) {
+        uint32_t utc = 1700000000 + segment * 86400;
+        appendEvents(segment == 2 ? perSegment - 1 : perSegment, utc, NO_CRASH, 1);
+        if (segment == 2) appendEvents(1, utc + 5000, MINOR_CRASH, 3);
+    }
+
+    EventQuery day;
+    day.fromUtc = 1700000000 + 3 * 86400;
+    day.toUtc = day.fromUtc + 86399;
+    TEST_ASSERT_EQUAL_UINT32(perSegment, run(day));
+    TEST_ASSERT_EQUAL_UINT32(perSegment, eventLog->getLastQueryReads());
+
+    EventQuery nearMiss;
+    nearMiss.minScore = 3;
+    TEST_ASSERT_EQUAL_UINT32(1, run(nearMiss));
+    TEST_ASSERT_EQUAL_UINT32(perSegment, eventLog->getLastQueryReads());
+    TEST_ASSERT_EQUAL_UINT8(MINOR_CRASH, visited[0].severity);
+
+    // Detections are read straight from their slots
+    EventQuery detections;
+    detections.minSeverity = MINOR_CRASH;
+    TEST_ASSERT_EQUAL_UINT32(1, run(detections));
+    TEST_ASSERT_EQUAL_UINT32(1, eventLog->getLastQueryReads());
+
+    EventQuery none;
+    none.minSeverity = SEVERE_CRASH;
+    TEST_ASSERT_EQUAL_UINT32(0, run(none));
+    TEST_ASSERT_EQUAL_UINT32(0, eventLog->getLastQueryReads());
+}
+
+void test_records_without_utc(void) {
+    TEST_ASSERT_TRUE(eventLog->begin(flash));
+    appendEvents(3, 0, MINOR_CRASH, 1);
+    for (int i = 0; i < 3; i++) {
+        EventRecord record = event(0, MINOR_CRASH, 1);
+        record.utcSeconds = 0;
+        TEST_ASSERT_TRUE(eventLog->append(record));
+    }
+    // Unsynced records are only in a query from the start
+    TEST_ASSERT_EQUAL_UINT32(6, run(EventQuery()));
+    EventQuery synced;
+    synced.fromUtc = 1;
+    TEST_ASSERT_EQUAL_UINT32(2, run(synced));
+}
+
+void test_clear_erases_everything(void) {
+    TEST_ASSERT_TRUE(eventLog->begin(flash));
+    appendEvents(100, 1000, MINOR_CRASH, 1);
+    TEST_ASSERT_TRUE(eventLog->clear());
+    TEST_ASSERT_EQUAL_UINT32(0, eventLog->getUsedSegments());
+    remount();
+    TEST_ASSERT_EQUAL_UINT32(0, run(EventQuery()));
+    appendEvents(1, 2000, MINOR_CRASH, 1);
+    TEST_ASSERT_EQUAL_UINT32(1, run(EventQuery()));
+}
+
+void test_parse_event_query(void) {
+    EventQuery query;
+    TEST_ASSERT_TRUE(parseEventQuery("events\r\n", query));
+    TEST_ASSERT_EQUAL_UINT32(0, query.fromUtc);
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, query.limit);
+
+    TEST_ASSERT_TRUE(parseEventQuery("events from=1700000000 to=1700086400 severity=2 score=3 limit=10",
+                                     query));
+    TEST_ASSERT_EQUAL_UINT32(1700000000, query.fromUtc);
+    TEST_ASSERT_EQUAL_UINT32(1700086400, query.toUtc);
+    TEST_ASSERT_EQUAL_UINT8(2, query.minSeverity);
+    TEST_ASSERT_EQUAL_UINT8(3, query.minScore);
+    TEST_ASSERT_EQUAL_UINT32(10, query.limit);
+
+    TEST_ASSERT_FALSE(parseEventQuery("eventsfrom=1", query));
+    TEST_ASSERT_FALSE(parseEventQuery("events since=1", query));
+    TEST_ASSERT_FALSE(parseEventQuery("events from=", query));
+    TEST_ASSERT_FALSE(parseEventQuery("status", query));
+}
+
+void test_format_event_record(void) {
+    EventRecord record = event(1700000000, MODERATE_CRASH, 5);
+    record.kind = EVENT_CONFIRMED;
+    record.delayMs = 1800;
+    char line[256];
+    formatEventRecord(line, sizeof(line), record);
+    TEST_ASSERT_EQUAL_INT(0, strncmp("0,1700000000,", line, 13));
+    TEST_ASSERT_NOT_NULL(strstr(line, ",confirmed,2,5,"));
+    TEST_ASSERT_NOT_NULL(strstr(line, ",0.500,0.000,1.000,0.0,-12.3,0.0,150,"));
+    TEST_ASSERT_NOT_NULL(strstr(line, ",1800"));
+
+    // As many columns as the header
+    int commas = 0;
+    int headerCommas = 0;
+    for (const char* c = line; *c; c++) commas += *c == ',';
+    for (const char* c = EVENT_CSV_HEADER; *c; c++) headerCommas += *c == ',';
+    TEST_ASSERT_EQUAL_INT(headerCommas, commas);
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_append_and_query_in_order);
+    RUN_TEST(test_remount_reads_headers_and_footers_only);
+    RUN_TEST(test_torn_write_is_skipped);
+    RUN_TEST(test_full_segment_sealed_after_reset);
+    RUN_TEST(test_budget_prunes_oldest_segment);
+    RUN_TEST(test_pruning_keeps_severe_segments);
+    RUN_TEST(test_query_skips_segments_by_summary);
+    RUN_TEST(test_records_without_utc);
+    RUN_TEST(test_clear_erases_everything);
+    RUN_TEST(test_parse_event_query);
+    RUN_TEST(test_format_event_record);
+
+    return UNITY_END();
+}
+
+int main(void) {
+    return runUnityTests();
+}
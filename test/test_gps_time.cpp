@@ -0,0 +1,207 @@
+#include <unity.h>
+#include <string.h>
+#include "clock_discipline.h"
+#include "config.h"
+#include "gps_time.h"
+#include "hal.h"
+#include "sensor_manager.h"
+#include "sim_device.h"
+#include "status_format.h"
+
+// Replayed GPS seconds: the PPS edge fires up to PPS_JITTER_US after the true
+// second, the NMEA burst naming that second starts 30-130 ms after it, and
+// the oscillator runs OSCILLATOR_PPM fast.
+
+static const int64_t EPOCH = 1700000000LL;
+static const int32_t OSCILLATOR_PPM = 30;
+static const int32_t PPS_JITTER_US = 5;
+
+ClockDiscipline utcClock;
+GpsTimeSync gpsTime;
+static uint32_t noiseState;
+
+static uint32_t noise(uint32_t range) {
+    noiseState = noiseState * 1664525UL + 1013904223UL;
+    return (noiseState >> 8) % (range + 1);
+}
+
+static uint64_t monoAt(int64_t trueMicros) {
+    return (uint64_t)(trueMicros + trueMicros / 1000000 * OSCILLATOR_PPM +
+                      trueMicros % 1000000 * OSCILLATOR_PPM / 1000000);
+}
+
+static int64_t absolute(int64_t value) {
+    return value < 0 ? -value : value;
+}
+
+// One second of GPS output; the PPS edge only if withPps
+static void replaySecond(int64_t second, bool withPps) {
+    int64_t secondMicros = second * 1000000;
+    if (withPps) {
+        gpsTime.onPpsEdge(monoAt(secondMicros + noise(PPS_JITTER_US)));
+    }
+    uint64_t burstStart = monoAt(secondMicros + 30000 + noise(100000));
+    // GGA and RMC both name the second
+    gpsTime.onTime(EPOCH + second, 0, burstStart);
+    gpsTime.onTime(EPOCH + second, 0, burstStart + 75000);
+}
+
+struct ErrorStats {
+    int64_t worst;
+    int64_t worstUncovered;
+};
+
+// Conversion error over the second that starts at second, every 10 ms
+static void measureSecond(int64_t second, ErrorStats& stats) {
+    for (int64_t t = second * 1000000; t < (second + 1) * 1000000; t += 10000) {
+        uint64_t mono = monoAt(t);
+        int64_t error = absolute(utcClock.toUtcMicros(mono) - (EPOCH * 1000000 + t));
+        if (error > stats.worst) stats.worst = error;
+        int64_t uncovered = error - utcClock.getErrorMicros(mono);
+        if (uncovered > stats.worstUncovered) stats.worstUncovered = uncovered;
+    }
+}
+
+void setUp(void) {
+    utcClock.reset();
+    gpsTime.begin(&utcClock);
+    noiseState = 1;
+}
+
+void tearDown(void) {
+}
+
+void test_unix_seconds_from_gps_date(void) {
+    TEST_ASSERT_EQUAL_INT64(0, GpsTimeSync::toUnixSeconds(1970, 1, 1, 0, 0, 0));
+    TEST_ASSERT_EQUAL_INT64(946684800LL, GpsTimeSync::toUnixSeconds(2000, 1, 1, 0, 0, 0));
+    TEST_ASSERT_EQUAL_INT64(1700000000LL, GpsTimeSync::toUnixSeconds(2023, 11, 14, 22, 13, 20));
+    TEST_ASSERT_EQUAL_INT64(1709251199LL, GpsTimeSync::toUnixSeconds(2024, 2, 29, 23, 59, 59));
+}
+
+void test_utc_timestamp_format(void) {
+    char buffer[UTC_TIMESTAMP_SIZE];
+    TEST_ASSERT_EQUAL(27, formatUtcTimestamp(buffer, sizeof(buffer), 1700000000123456LL));
+    TEST_ASSERT_EQUAL_STRING("2023-11-14T22:13:20.123456Z", buffer);
+
+    formatUtcTimestamp(buffer, sizeof(buffer), 1709251199999999LL);
+    TEST_ASSERT_EQUAL_STRING("2024-02-29T23:59:59.999999Z", buffer);
+}
+
+void test_pps_gives_tens_of_microseconds(void) {
+    ErrorStats stats = {0, 0};
+    for (int64_t second = 0; second < 600; second++) {
+        replaySecond(second, true);
+        if (second >= 60) measureSecond(second, stats);
+    }
+
+    TEST_ASSERT_EQUAL(TIME_SOURCE_GPS_PPS, utcClock.getSource());
+    TEST_ASSERT_EQUAL_UINT32(600, gpsTime.getPpsReferenceCount());
+    TEST_ASSERT_EQUAL_UINT32(0, gpsTime.getNmeaReferenceCount());
+    TEST_ASSERT_TRUE(stats.worst < 50);
+    TEST_ASSERT_TRUE(stats.worstUncovered <= 0);
+    TEST_ASSERT_TRUE(utcClock.getErrorMicros(monoAt(600LL * 1000000)) < 100);
+}
+
+void test_nmea_only_error_is_bounded(void) {
+    ErrorStats stats = {0, 0};
+    for (int64_t second = 0; second < 600; second++) {
+        replaySecond(second, false);
+        if (second >= 10) measureSecond(second, stats);
+    }
+
+    TEST_ASSERT_EQUAL(TIME_SOURCE_GPS_NMEA, utcClock.getSource());
+    TEST_ASSERT_EQUAL_UINT32(600, gpsTime.getNmeaReferenceCount());
+    TEST_ASSERT_TRUE(stats.worst < GPS_NMEA_UNCERTAINTY_US);
+    TEST_ASSERT_TRUE(stats.worstUncovered <= 0);
+}
+
+void test_stale_pps_edge_is_not_paired(void) {
+    replaySecond(0, true);
+    TEST_ASSERT_EQUAL_UINT32(1, gpsTime.getPpsReferenceCount());
+
+    // PPS lost: the edge from second 0 must not label seconds 1 and 2
+    replaySecond(1, false);
+    replaySecond(2, false);
+    TEST_ASSERT_EQUAL_UINT32(1, gpsTime.getPpsReferenceCount());
+    TEST_ASSERT_EQUAL_UINT32(2, gpsTime.getNmeaReferenceCount());
+    // ... and those NMEA references do not displace the PPS mapping
+    TEST_ASSERT_EQUAL(TIME_SOURCE_GPS_PPS, utcClock.getSource());
+    TEST_ASSERT_EQUAL_UINT32(2, utcClock.getRejectedCount());
+}
+
+void test_ntp_yields_to_pps_until_holdover_degrades(void) {
+    for (int64_t second = 0; second < 300; second++) {
+        replaySecond(second, true);
+    }
+    uint64_t mono = monoAt(300LL * 1000000 + 500000);
+    int64_t utc = (EPOCH + 300) * 1000000 + 500000;
+    TEST_ASSERT_FALSE(utcClock.addReference(mono, utc + 8000, NTP_UNCERTAINTY_US, TIME_SOURCE_NTP));
+    TEST_ASSERT_EQUAL(TIME_SOURCE_GPS_PPS, utcClock.getSource());
+
+    // Antenna lost for an hour: the bound grows past the NTP uncertainty
+    mono = monoAt(3900LL * 1000000);
+    utc = (EPOCH + 3900) * 1000000;
+    TEST_ASSERT_TRUE(utcClock.getErrorMicros(mono) > NTP_UNCERTAINTY_US);
+    TEST_ASSERT_TRUE(utcClock.addReference(mono, utc, NTP_UNCERTAINTY_US, TIME_SOURCE_NTP));
+    TEST_ASSERT_EQUAL(TIME_SOURCE_NTP, utcClock.getSource());
+}
+
+void test_sensor_manager_disciplines_offline(void) {
+    // The real SensorManager reading simulated NMEA with no network at all;
+    // PPS is wired after two minutes
+    static SimDevice device;
+    simInitDevice(device, 11, makeScenario(SCENARIO_NORMAL_DRIVE, 11, 600000));
+    device.wifiAvailable = false;
+    device.gpsPpsJitterUs = PPS_JITTER_US;
+    simSetCurrentDevice(&device);
+
+    SensorManager sensors;
+    TEST_ASSERT_TRUE(sensors.begin(&utcClock));
+
+    int64_t nmeaError = 0;
+    uint32_t nmeaBound = 0;
+    while (Clock::millis() < 120000) {
+        sensors.readAllSensors();
+        Clock::delay(SENSOR_READ_INTERVAL);
+    }
+    TimeSource nmeaSource = utcClock.getSource();
+    uint64_t mono = Clock::micros64();
+    nmeaError = absolute(utcClock.toUtcMicros(mono) - ((int64_t)SIM_EPOCH_AT_BOOT * 1000000 + (int64_t)mono));
+    nmeaBound = utcClock.getErrorMicros(mono);
+
+    device.gpsPpsWired = true;
+    while (Clock::millis() < 360000) {
+        sensors.readAllSensors();
+        Clock::delay(SENSOR_READ_INTERVAL);
+    }
+    SensorData data = sensors.readAllSensors();
+    simSetCurrentDevice(nullptr);
+
+    TEST_ASSERT_EQUAL(TIME_SOURCE_GPS_NMEA, nmeaSource);
+    TEST_ASSERT_TRUE(nmeaError < GPS_NMEA_UNCERTAINTY_US);
+    TEST_ASSERT_TRUE(nmeaError <= nmeaBound);
+
+    TEST_ASSERT_EQUAL(TIME_SOURCE_GPS_PPS, utcClock.getSource());
+    int64_t ppsError = absolute(utcClock.toUtcMicros(data.sampleMicros) -
+                                ((int64_t)SIM_EPOCH_AT_BOOT * 1000000 + (int64_t)data.sampleMicros));
+    TEST_ASSERT_TRUE(ppsError < 50);
+    TEST_ASSERT_TRUE(ppsError <= utcClock.getErrorMicros(data.sampleMicros));
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_unix_seconds_from_gps_date);
+    RUN_TEST(test_utc_timestamp_format);
+    RUN_TEST(test_pps_gives_tens_of_microseconds);
+    RUN_TEST(test_nmea_only_error_is_bounded);
+    RUN_TEST(test_stale_pps_edge_is_not_paired);
+    RUN_TEST(test_ntp_yields_to_pps_until_holdover_degrades);
+    RUN_TEST(test_sensor_manager_disciplines_offline);
+
+    return UNITY_END();
+}
+
+int main(void) {
+    return runUnityTests();
+}
@@ -0,0 +1,223 @@
+#include <unity.h>
+#include <string.h>
+#include "config.h"
+#include "health_monitor.h"
+#include "sensor_manager.h"
+#include "sim_device.h"
+
+static ResetRecord record;
+static HealthMonitor monitor;
+
+// One supervised step of the given length, ending at nowMs
+static void step(HealthTask task, uint32_t nowMs, uint32_t durationMs) {
+    monitor.startTask(task, nowMs - durationMs);
+    monitor.endTask(task, nowMs);
+}
+
+void setUp(void) {
+    memset(&record, 0xA5, sizeof(record));
+    monitor = HealthMonitor();
+    monitor.begin(&record, RESET_POWER_ON, 0);
+}
+
+void tearDown(void) {
+}
+
+void test_power_on_starts_a_fresh_record(void) {
+    TEST_ASSERT_EQUAL_UINT32(RESET_RECORD_MAGIC, record.magic);
+    TEST_ASSERT_EQUAL_UINT32(1, record.bootCount);
+    TEST_ASSERT_EQUAL_INT32(TASK_NONE, record.runningTask);
+    TEST_ASSERT_EQUAL_UINT32(0, record.watchdogResets);
+    TEST_ASSERT_EQUAL(HEALTH_NORMAL, monitor.getMode(0));
+
+    // A software restart keeps counting
+    monitor = HealthMonitor();
+    monitor.begin(&record, RESET_SOFTWARE, 0);
+    TEST_ASSERT_EQUAL_UINT32(2, record.bootCount);
+    TEST_ASSERT_EQUAL_UINT32(RESET_SOFTWARE, record.lastReason);
+}
+
+void test_overrunning_task_is_suspended_and_retried(void) {
+    uint32_t now = 1000;
+    for (int i = 0; i < HEALTH_STRIKES - 1; i++) {
+        now += 1000;
+        step(TASK_ULTRASONIC, now, TASK_BUDGET_ULTRASONIC_MS + 100);
+        TEST_ASSERT_EQUAL(TASK_SLOW, monitor.getHealth(TASK_ULTRASONIC));
+    }
+    now += 1000;
+    step(TASK_ULTRASONIC, now, TASK_BUDGET_ULTRASONIC_MS + 100);
+    step(TASK_IMU, now, 1);
+    step(TASK_DETECTION, now, 1);
+    TEST_ASSERT_EQUAL(TASK_SUSPENDED, monitor.getHealth(TASK_ULTRASONIC));
+    TEST_ASSERT_EQUAL(HEALTH_DEGRADED, monitor.getMode(now));
+    TEST_ASSERT_FALSE(monitor.shouldRun(TASK_ULTRASONIC, now + HEALTH_RETRY_MIN_MS - 1));
+
+    // Probation: a single overrun suspends it again, for twice as long
+    uint32_t retry = now + HEALTH_RETRY_MIN_MS;
+    TEST_ASSERT_TRUE(monitor.shouldRun(TASK_ULTRASONIC, retry));
+    step(TASK_ULTRASONIC, retry + 200, 200);
+    TEST_ASSERT_EQUAL(TASK_SUSPENDED, monitor.getHealth(TASK_ULTRASONIC));
+    TEST_ASSERT_FALSE(monitor.shouldRun(TASK_ULTRASONIC, retry + 200 + 2 * HEALTH_RETRY_MIN_MS - 1));
+    retry += 200 + 2 * HEALTH_RETRY_MIN_MS;
+    TEST_ASSERT_TRUE(monitor.shouldRun(TASK_ULTRASONIC, retry));
+
+    // Back within budget: healthy, and the backoff starts over
+    step(TASK_ULTRASONIC, retry + 20, 20);
+    step(TASK_IMU, retry + 20, 1);
+    step(TASK_DETECTION, retry + 20, 1);
+    TEST_ASSERT_EQUAL(TASK_OK, monitor.getHealth(TASK_ULTRASONIC));
+    TEST_ASSERT_EQUAL_UINT32(2, monitor.getSuspensions(TASK_ULTRASONIC));
+    TEST_ASSERT_EQUAL(HEALTH_NORMAL, monitor.getMode(retry + 20));
+}
+
+void test_overrun_within_strikes_recovers(void) {
+    step(TASK_GPS, 1000, TASK_BUDGET_GPS_MS + 50);
+    step(TASK_GPS, 2000, TASK_BUDGET_GPS_MS + 50);
+    step(TASK_GPS, 3000, 10);
+    step(TASK_GPS, 4000, TASK_BUDGET_GPS_MS + 50);
+    step(TASK_GPS, 5000, TASK_BUDGET_GPS_MS + 50);
+    TEST_ASSERT_EQUAL(TASK_SLOW, monitor.getHealth(TASK_GPS));
+    TEST_ASSERT_EQUAL_UINT32(0, monitor.getSuspensions(TASK_GPS));
+}
+
+void test_critical_task_is_never_suspended(void) {
+    uint32_t now = 0;
+    for (int i = 0; i < 10; i++) {
+        now += 100;
+        step(TASK_IMU, now, TASK_BUDGET_IMU_MS * 5);
+        step(TASK_DETECTION, now, 1);
+    }
+    TEST_ASSERT_EQUAL(TASK_SLOW, monitor.getHealth(TASK_IMU));
+    TEST_ASSERT_TRUE(monitor.shouldRun(TASK_IMU, now));
+    TEST_ASSERT_TRUE(monitor.isAlive(now));
+
+    // Detection stops beating: the watchdog is no longer fed
+    step(TASK_IMU, now + HEALTH_HEARTBEAT_TIMEOUT_MS, 1);
+    TEST_ASSERT_TRUE(monitor.isAlive(now + HEALTH_HEARTBEAT_TIMEOUT_MS));
+    TEST_ASSERT_FALSE(monitor.isAlive(now + HEALTH_HEARTBEAT_TIMEOUT_MS + 1));
+    TEST_ASSERT_EQUAL(HEALTH_STALLED, monitor.getMode(now + HEALTH_HEARTBEAT_TIMEOUT_MS + 1));
+}
+
+void test_task_hung_at_watchdog_reset_starts_suspended(void) {
+    // The network step never returns; the task watchdog resets the chip
+    step(TASK_NETWORK, 500, 100);
+    monitor.startTask(TASK_NETWORK, 1000);
+    TEST_ASSERT_EQUAL_INT32(TASK_NETWORK, record.runningTask);
+
+    monitor = HealthMonitor();
+    monitor.begin(&record, RESET_WATCHDOG, 0);
+    TEST_ASSERT_EQUAL_UINT32(1, record.watchdogResets);
+    TEST_ASSERT_EQUAL_UINT32(1, record.taskHangs[TASK_NETWORK]);
+    TEST_ASSERT_EQUAL_INT32(TASK_NONE, record.runningTask);
+    TEST_ASSERT_EQUAL(TASK_SUSPENDED, monitor.getHealth(TASK_NETWORK));
+    TEST_ASSERT_TRUE(monitor.shouldRun(TASK_IMU, 0));
+    TEST_ASSERT_FALSE(monitor.shouldRun(TASK_NETWORK, HEALTH_RETRY_MIN_MS - 1));
+
+    // Hangs again after its retry: suspended twice as long at the next boot
+    TEST_ASSERT_TRUE(monitor.shouldRun(TASK_NETWORK, HEALTH_RETRY_MIN_MS));
+    monitor.startTask(TASK_NETWORK, HEALTH_RETRY_MIN_MS);
+    monitor = HealthMonitor();
+    monitor.begin(&record, RESET_WATCHDOG, 0);
+    TEST_ASSERT_EQUAL_UINT32(2, record.taskHangs[TASK_NETWORK]);
+    TEST_ASSERT_FALSE(monitor.shouldRun(TASK_NETWORK, 2 * HEALTH_RETRY_MIN_MS - 1));
+    TEST_ASSERT_TRUE(monitor.shouldRun(TASK_NETWORK, 2 * HEALTH_RETRY_MIN_MS));
+
+    // A hang in a critical task is counted, but the task still runs
+    monitor.startTask(TASK_DETECTION, 100);
+    monitor = HealthMonitor();
+    monitor.begin(&record, RESET_PANIC, 0);
+    TEST_ASSERT_EQUAL_UINT32(1, record.taskHangs[TASK_DETECTION]);
+    TEST_ASSERT_EQUAL(TASK_OK, monitor.getHealth(TASK_DETECTION));
+}
+
+void test_corrupt_record_is_reinitialised(void) {
+    record.bootCount = 7;
+    record.taskHangs[TASK_GPS] = 3;
+    monitor = HealthMonitor();
+    monitor.begin(&record, RESET_WATCHDOG, 0);
+    // bootCount changed without a new checksum: not trusted
+    TEST_ASSERT_EQUAL_UINT32(1, record.bootCount);
+    TEST_ASSERT_EQUAL_UINT32(0, record.taskHangs[TASK_GPS]);
+    TEST_ASSERT_EQUAL_UINT32(1, record.watchdogResets);
+
+    record.runningTask = 42;
+    monitor = HealthMonitor();
+    monitor.begin(&record, RESET_WATCHDOG, 0);
+    TEST_ASSERT_EQUAL_INT32(TASK_NONE, record.runningTask);
+    TEST_ASSERT_EQUAL(HEALTH_NORMAL, monitor.getMode(0));
+}
+
+void test_init_failures_back_off(void) {
+    TEST_ASSERT_EQUAL_UINT32(HEALTH_RETRY_MIN_MS, monitor.recordInitFailure());
+    monitor = HealthMonitor();
+    monitor.begin(&record, RESET_SOFTWARE, 0);
+    TEST_ASSERT_EQUAL_UINT32(2 * HEALTH_RETRY_MIN_MS, monitor.recordInitFailure());
+    for (int i = 0; i < 20; i++) monitor.recordInitFailure();
+    TEST_ASSERT_EQUAL_UINT32(HEALTH_RETRY_MAX_MS, monitor.recordInitFailure());
+
+    monitor.recordInitSuccess();
+    TEST_ASSERT_EQUAL_UINT32(HEALTH_RETRY_MIN_MS, monitor.recordInitFailure());
+}
+
+void test_stalled_ultrasonic_is_isolated_from_the_imu(void) {
+    static SimDevice device;
+    simInitDevice(device, 5, makeScenario(SCENARIO_NORMAL_DRIVE, 5, 120000));
+    device.ultrasonicStallMs = 250;
+    simSetCurrentDevice(&device);
+    SensorManager* sensors = new SensorManager();
+    TEST_ASSERT_TRUE(sensors->begin());
+    monitor = HealthMonitor();
+    monitor.begin(&record, RESET_POWER_ON, Clock::millis());
+    sensors->setHealthMonitor(&monitor);
+
+    SensorData data;
+    for (int i = 0; i < HEALTH_STRIKES; i++) {
+        data = sensors->readAllSensors();
+        Clock::delay(SENSOR_READ_INTERVAL);
+    }
+    TEST_ASSERT_EQUAL(TASK_SUSPENDED, monitor.getHealth(TASK_ULTRASONIC));
+
+    // Skipped from here on: the IMU keeps its rate and stays healthy
+    uint32_t suspendedAt = Clock::millis();
+    uint64_t lastSample = 0;
+    while (elapsedMillis(suspendedAt, Clock::millis()) < HEALTH_RETRY_MIN_MS - 500) {
+        uint32_t before = Clock::millis();
+        data = sensors->readAllSensors();
+        TEST_ASSERT_EQUAL_FLOAT(-1.0f, data.distance);
+        TEST_ASSERT_TRUE(data.sampleMicros > lastSample);
+        TEST_ASSERT_TRUE(elapsedMillis(before, Clock::millis()) < 150);
+        lastSample = data.sampleMicros;
+        Clock::delay(SENSOR_READ_INTERVAL);
+    }
+    TEST_ASSERT_EQUAL(TASK_OK, monitor.getHealth(TASK_IMU));
+    TEST_ASSERT_EQUAL_UINT32(1, monitor.getSuspensions(TASK_ULTRASONIC));
+
+    // The sensor recovers; its probation read is within budget
+    device.ultrasonicStallMs = 0;
+    Clock::delay(1000);
+    sensors->readAllSensors();
+    TEST_ASSERT_EQUAL(TASK_OK, monitor.getHealth(TASK_ULTRASONIC));
+    TEST_ASSERT_EQUAL_UINT32(1, monitor.getSuspensions(TASK_ULTRASONIC));
+
+    delete sensors;
+    simSetCurrentDevice(nullptr);
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_power_on_starts_a_fresh_record);
+    RUN_TEST(test_overrunning_task_is_suspended_and_retried);
+    RUN_TEST(test_overrun_within_strikes_recovers);
+    RUN_TEST(test_critical_task_is_never_suspended);
+    RUN_TEST(test_task_hung_at_watchdog_reset_starts_suspended);
+    RUN_TEST(test_corrupt_record_is_reinitialised);
+    RUN_TEST(test_init_failures_back_off);
+    RUN_TEST(test_stalled_ultrasonic_is_isolated_from_the_imu);
+
+    return UNITY_END();
+}
+
+int main(void) {
+    return runUnityTests();
+}
@@ -0,0 +1,161 @@
+#include <unity.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+#include "device_paths.h"
+#include "firmware.h"
+#include "sim_device.h"
+#include "status_format.h"
+
+// Allocation-counting shim: malloc/calloc/realloc are interposed over glibc
+// (operator new and Arduino String both end up here) so the soak can assert
+// that the firmware's loop never touches the heap once it is running.
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void __libc_free(void* ptr);
+}
+
+static volatile unsigned long allocationCount = 0;
+
+extern "C" void* malloc(size_t size) {
+    allocationCount++;
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) {
+    allocationCount++;
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* ptr, size_t size) {
+    allocationCount++;
+    return __libc_realloc(ptr, size);
+}
+
+extern "C" void free(void* ptr) {
+    __libc_free(ptr);
+}
+
+// A unit of the real firmware (Firmware::setup() and loop(), as
+// src/main.cpp runs them) on the sim shims
+static SimDevice device;
+static ResetRecord resetRecord;
+static Firmware* firmware;
+
+static bool bootFirmware(ScenarioType scenario, uint32_t seed, uint32_t durationMs) {
+    simInitDevice(device, seed, makeScenario(scenario, seed, durationMs));
+    simSetCurrentDevice(&device);
+    memset(&resetRecord, 0, sizeof(resetRecord));
+    firmware = new Firmware();
+    return firmware->setup(&resetRecord, RESET_POWER_ON);
+}
+
+static void endFirmware(void) {
+    delete firmware;
+    firmware = nullptr;
+    simSetCurrentDevice(nullptr);
+}
+
+// Loop passes until the virtual clock reaches untilMs; samples taken
+static unsigned long runLoop(uint32_t untilMs) {
+    unsigned long samples = 0;
+    while (Clock::millis() < untilMs) {
+        firmware->loop();
+        if (firmware->getLastPass().sampled) samples++;
+    }
+    return samples;
+}
+
+static DevicePaths paths;
+
+void setUp(void) {
+    paths.begin((uint64_t)0xF0B2C360A124ULL);
+}
+
+void tearDown(void) {
+}
+
+void test_sensor_paths_are_prefixed(void) {
+    TEST_ASSERT_EQUAL_STRING(FB_SENSORS_PATH "accelX", FirebasePaths::ACCEL_X);
+    TEST_ASSERT_EQUAL_STRING(FB_SENSORS_PATH "timestamp", FirebasePaths::TIMESTAMP);
+    TEST_ASSERT_EQUAL(0, strncmp(FirebasePaths::CRASH_DETECTED, FB_SENSORS_PATH,
+                                 strlen(FB_SENSORS_PATH)));
+}
+
+void test_status_strings_match_previous_format(void) {
+    char info[CONNECTION_INFO_SIZE];
+    char status[SENSOR_STATUS_SIZE];
+
+    formatConnectionInfo(info, sizeof(info), true, false, false);
+    TEST_ASSERT_EQUAL_STRING("WiFi: Connected | Firebase: Disconnected | Ready: No", info);
+
+    formatSensorStatus(status, sizeof(status), true, true, false);
+    TEST_ASSERT_EQUAL_STRING("MPU6050:OK,GPS:OK,GPS_VALID:NO", status);
+}
+
+void test_formatting_truncates_to_buffer(void) {
+    char small[8];
+    size_t written = formatConnectionInfo(small, sizeof(small), true, true, true);
+
+    TEST_ASSERT_EQUAL(sizeof(small) - 1, written);
+    TEST_ASSERT_EQUAL_STRING("WiFi: C", small);
+}
+
+void test_zero_allocations_in_steady_state(void) {
+    const uint32_t warmupMs = 60000;
+    const uint32_t soakMs = 15 * 60000;
+    TEST_ASSERT_TRUE(bootFirmware(SCENARIO_NORMAL_DRIVE, 21, warmupMs + soakMs));
+
+    // Boot, Wi-Fi, auth, the first uploads and the boot report allocate
+    // what they keep; only what follows is counted
+    runLoop(warmupMs);
+    TEST_ASSERT_TRUE(firmware->firebase.isReady());
+    uint64_t writesBefore = device.rtdbWrites;
+
+    unsigned long before = allocationCount;
+    unsigned long samples = runLoop(warmupMs + soakMs);
+    unsigned long allocations = allocationCount - before;
+
+    TEST_ASSERT_EQUAL(soakMs / SENSOR_READ_INTERVAL, samples);
+    // Every FIREBASE_SEND_INTERVAL, one write per sensor field
+    TEST_ASSERT_TRUE(device.rtdbWrites - writesBefore >= (uint64_t)(soakMs / FIREBASE_SEND_INTERVAL) * 13);
+    TEST_ASSERT_EQUAL(0, allocations);
+    endFirmware();
+}
+
+void test_dismissed_detections_do_not_allocate(void) {
+    const uint32_t warmupMs = 20000;
+    const uint32_t durationMs = 120000;
+    TEST_ASSERT_TRUE(bootFirmware(SCENARIO_POTHOLE, 22, durationMs));
+    runLoop(warmupMs);
+
+    // The detector firing, the confirmer's status writes and event log
+    // records, and the dismissal
+    unsigned long before = allocationCount;
+    uint32_t eventsBefore = firmware->eventLog.getRecordCount();
+    runLoop(durationMs);
+    unsigned long allocations = allocationCount - before;
+
+    TEST_ASSERT_TRUE(firmware->eventLog.getRecordCount() > eventsBefore);
+    TEST_ASSERT_EQUAL(CONFIRM_IDLE, firmware->crashConfirmer.getState());
+    TEST_ASSERT_EQUAL(0, allocations);
+    endFirmware();
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_sensor_paths_are_prefixed);
+    RUN_TEST(test_status_strings_match_previous_format);
+    RUN_TEST(test_formatting_truncates_to_buffer);
+    RUN_TEST(test_zero_allocations_in_steady_state);
+    RUN_TEST(test_dismissed_detections_do_not_allocate);
+
+    return UNITY_END();
+}
+
+int main(void) {
+    return runUnityTests();
+}
@@ -0,0 +1,320 @@
+#include <unity.h>
+#include <string.h>
+#include "config.h"
+#include "hal.h"
+#include "i2c_transport.h"
+#include "sensor_manager.h"
+#include "sim_device.h"
+
+// Scripted bus: one MPU6050-like register file per address, transfers that
+// take bus time on the virtual clock, and faults queued per transaction.
+// A hang leaves a slave holding SDA for a number of SCL pulses.
+struct ScriptedBus : public I2cPort {
+    uint8_t registers[2][128];
+    bool present[2] = {true, true};
+    uint32_t clockHz = 0;
+    int begins = 0;
+    int ends = 0;
+    bool attached = false;
+
+    // Faults for the next transactions, consumed in order
+    I2cResult script[8];
+    int scripted = 0;
+    uint32_t sdaHeldPulses = 0;     // set when a scripted timeout hangs the bus
+    uint32_t hangPulses = 0;
+    bool sclShorted = false;
+
+    // Line state under GPIO control
+    bool sdaDriven = false;
+    bool sclDriven = false;
+    int sclPulses = 0;
+    bool sawStop = false;
+
+    // Split-phase support: a queued read completes after this many polls
+    bool async = false;
+    int pollsLeft = 0;
+    uint8_t* asyncData = nullptr;
+    uint8_t asyncAddress = 0, asyncReg = 0, asyncLength = 0;
+
+    int transfers = 0;
+    uint8_t lastReg = 0, lastLength = 0;
+
+    ScriptedBus() {
+        memset(registers, 0, sizeof(registers));
+    }
+
+    void queue(I2cResult result) {
+        script[scripted++] = result;
+    }
+
+    I2cResult next() {
+        if (scripted == 0) return sdaHeldPulses > 0 || sclShorted ? I2C_TIMEOUT : I2C_OK;
+        I2cResult result = script[0];
+        memmove(script, script + 1, sizeof(script) - sizeof(script[0]));
+        scripted--;
+        if (result == I2C_TIMEOUT) sdaHeldPulses = hangPulses;
+        return result;
+    }
+
+    void begin(uint32_t hz) override { clockHz = hz; begins++; attached = true; }
+    void end() override { ends++; attached = false; sdaDriven = sclDriven = false; }
+
+    I2cResult readRegisters(uint8_t address, uint8_t reg, uint8_t* data, uint8_t length) override {
+        transfers++;
+        lastReg = reg;
+        lastLength = length;
+        // 9 bits per byte at the bus clock, plus start/restart/stop
+        Clock::delayMicroseconds((9 * (length + 3) + 3) * 1000000ULL / clockHz);
+        I2cResult result = next();
+        if (result != I2C_OK) return result;
+        int index = address - 0x68;
+        if (!attached || index < 0 || index > 1 || !present[index]) return I2C_NACK;
+        memcpy(data, &registers[index][reg], length);
+        return I2C_OK;
+    }
+
+    I2cResult writeRegister(uint8_t address, uint8_t reg, uint8_t value) override {
+        transfers++;
+        I2cResult result = next();
+        if (result == I2C_OK) registers[address - 0x68][reg] = value;
+        return result;
+    }
+
+    bool startRead(uint8_t address, uint8_t reg, uint8_t* data, uint8_t length) override {
+        if (!async) return false;
+        asyncAddress = address;
+        asyncReg = reg;
+        asyncData = data;
+        asyncLength = length;
+        pollsLeft = 3;
+        return true;
+    }
+
+    bool isReadDone() override {
+        return --pollsLeft <= 0;
+    }
+
+    I2cResult finishRead() override {
+        return readRegisters(asyncAddress, asyncReg, asyncData, asyncLength);
+    }
+
+    bool readSda() override { return !sdaDriven && sdaHeldPulses == 0; }
+    bool readScl() override { return !sclDriven && !sclShorted; }
+
+    void driveSda(bool high) override {
+        // SDA rising while SCL is high is a STOP
+        if (high && sdaDriven && readScl()) sawStop = true;
+        sdaDriven = !high;
+    }
+
+    void driveScl(bool high) override {
+        if (high && sclDriven) {
+            sclPulses++;
+            if (sdaHeldPulses > 0 && !sclShorted) sdaHeldPulses--;
+        }
+        sclDriven = !high;
+    }
+
+    // Accel X..Z, temperature, gyro X..Z as the MPU6050 lays them out
+    void setMotion(int index, const int16_t* words) {
+        for (int i = 0; i < 7; i++) {
+            registers[index][MPU6050_REG_ACCEL_XOUT_H + 2 * i] = (uint8_t)((uint16_t)words[i] >> 8);
+            registers[index][MPU6050_REG_ACCEL_XOUT_H + 2 * i + 1] = (uint8_t)words[i];
+        }
+    }
+};
+
+static ScriptedBus* bus;
+static I2cTransport* transport;
+static const int16_t MOTION[7] = {4096, -2048, 32767, -1234, -32768, 655, -1};
+
+void setUp(void) {
+    bus = new ScriptedBus();
+    bus->setMotion(0, MOTION);
+    transport = new I2cTransport();
+    transport->begin(bus, 400000);
+}
+
+void tearDown(void) {
+    delete transport;
+    delete bus;
+}
+
+void test_decode_burst(void) {
+    uint8_t burst[MPU6050_BURST_BYTES] = {
+        0x10, 0x00, 0xF8, 0x00, 0x7F, 0xFF,   // accel 4096, -2048, 32767
+        0xFB, 0x2E,                           // temperature -1234: 32.9 C
+        0x80, 0x00, 0x02, 0x8F, 0xFF, 0xFF    // gyro -32768, 655, -1
+    };
+    ImuFrame frame;
+    decodeMotionBurst(burst, frame);
+    TEST_ASSERT_EQUAL_INT16(4096, frame.accel[0]);
+    TEST_ASSERT_EQUAL_INT16(-2048, frame.accel[1]);
+    TEST_ASSERT_EQUAL_INT16(32767, frame.accel[2]);
+    TEST_ASSERT_EQUAL_INT16(-32768, frame.gyro[0]);
+    TEST_ASSERT_EQUAL_INT16(655, frame.gyro[1]);
+    TEST_ASSERT_EQUAL_INT16(-1, frame.gyro[2]);
+    TEST_ASSERT_EQUAL_INT16(-1234, frame.temperature);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 32.90f, imuTemperatureC(frame.temperature));
+}
+
+void test_motion_is_one_burst_transaction(void) {
+    ImuFrame frame;
+    TEST_ASSERT_EQUAL(I2C_OK, transport->readMotion(0x68, frame));
+    TEST_ASSERT_EQUAL(IMU_FRAME_OK, frame.status);
+    TEST_ASSERT_EQUAL_INT16(4096, frame.accel[0]);
+    TEST_ASSERT_EQUAL_INT16(-1, frame.gyro[2]);
+
+    TEST_ASSERT_EQUAL_INT(1, bus->transfers);
+    TEST_ASSERT_EQUAL_UINT8(MPU6050_REG_ACCEL_XOUT_H, bus->lastReg);
+    TEST_ASSERT_EQUAL_UINT8(MPU6050_BURST_BYTES, bus->lastLength);
+    TEST_ASSERT_EQUAL_UINT32(400000, bus->clockHz);
+}
+
+void test_timing_stats(void) {
+    ImuFrame frame;
+    for (int i = 0; i < 10; i++) transport->readMotion(0x68, frame);
+    const I2cStats& stats = transport->getStats();
+    TEST_ASSERT_EQUAL_UINT32(10, stats.transactions);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.failures);
+    // 156 bit times at 400 kHz
+    TEST_ASSERT_UINT32_WITHIN(2, 390, stats.lastMicros);
+    TEST_ASSERT_UINT32_WITHIN(2, 390, stats.maxMicros);
+    TEST_ASSERT_UINT32_WITHIN(20, 3900, (uint32_t)stats.totalMicros);
+
+    // Fast-mode Plus
+    transport->begin(bus, 1000000);
+    transport->readMotion(0x68, frame);
+    TEST_ASSERT_UINT32_WITHIN(2, 156, transport->getStats().lastMicros);
+}
+
+void test_nack_marks_frame_failed(void) {
+    ImuFrame frame;
+    TEST_ASSERT_EQUAL(I2C_NACK, transport->readMotion(0x69 + 1, frame));
+    TEST_ASSERT_EQUAL(IMU_FRAME_FAILED, frame.status);
+    TEST_ASSERT_EQUAL_UINT32(1, transport->getStats().nacks);
+    TEST_ASSERT_EQUAL_UINT32(0, transport->getStats().hangs);
+}
+
+void test_hung_bus_is_clocked_free(void) {
+    // The slave was cut off mid-byte and holds SDA for 5 more bits
+    bus->hangPulses = 5;
+    bus->queue(I2C_TIMEOUT);
+    int beginsBefore = bus->begins;
+
+    ImuFrame frame;
+    TEST_ASSERT_EQUAL(I2C_TIMEOUT, transport->readMotion(0x68, frame));
+    TEST_ASSERT_EQUAL(IMU_FRAME_FAILED, frame.status);
+
+    const I2cStats& stats = transport->getStats();
+    TEST_ASSERT_EQUAL_UINT32(1, stats.timeouts);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.hangs);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.recoveries);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.failedRecoveries);
+    TEST_ASSERT_EQUAL_INT(5 + 1, bus->sclPulses);   // five to free SDA, one for the STOP
+    TEST_ASSERT_TRUE(bus->sawStop);
+    TEST_ASSERT_EQUAL_INT(beginsBefore + 1, bus->begins);
+    TEST_ASSERT_EQUAL_UINT32(400000, bus->clockHz);
+
+    // Reads work again
+    TEST_ASSERT_EQUAL(I2C_OK, transport->readMotion(0x68, frame));
+    TEST_ASSERT_EQUAL_INT16(4096, frame.accel[0]);
+}
+
+void test_shorted_clock_cannot_recover(void) {
+    bus->sclShorted = true;
+    ImuFrame frame;
+    TEST_ASSERT_EQUAL(I2C_TIMEOUT, transport->readMotion(0x68, frame));
+    TEST_ASSERT_EQUAL_UINT32(1, transport->getStats().failedRecoveries);
+    TEST_ASSERT_FALSE(bus->sawStop);   // no STOP without a clock
+    TEST_ASSERT_TRUE(transport->isBusHung());
+
+    bus->sclShorted = false;
+    TEST_ASSERT_EQUAL(I2C_OK, transport->readMotion(0x68, frame));
+}
+
+void test_repeated_failures_restart_controller(void) {
+    // Lines stay high: a wedged controller, not a held bus
+    for (int i = 0; i < I2C_REINIT_FAILURES; i++) bus->queue(I2C_BUS_ERROR);
+    int beginsBefore = bus->begins;
+
+    ImuFrame frame;
+    for (int i = 0; i < I2C_REINIT_FAILURES; i++) transport->readMotion(0x68, frame);
+    TEST_ASSERT_EQUAL_UINT32(0, transport->getStats().hangs);
+    TEST_ASSERT_EQUAL_UINT32(1, transport->getStats().reinits);
+    TEST_ASSERT_EQUAL_INT(beginsBefore + 1, bus->begins);
+    TEST_ASSERT_EQUAL(I2C_OK, transport->readMotion(0x68, frame));
+}
+
+void test_begin_clears_bus_left_hung_by_reset(void) {
+    ScriptedBus hung;
+    hung.sdaHeldPulses = 8;
+    I2cTransport fresh;
+    fresh.begin(&hung, 400000);
+    TEST_ASSERT_EQUAL_UINT32(1, fresh.getStats().recoveries);
+    TEST_ASSERT_TRUE(hung.attached);
+    TEST_ASSERT_FALSE(fresh.isBusHung());
+}
+
+void test_split_phase_read(void) {
+    bus->async = true;
+    transport->startMotion(0x68);
+    TEST_ASSERT_EQUAL_INT(0, bus->transfers);   // queued, not yet on the bus
+
+    ImuFrame frame;
+    TEST_ASSERT_EQUAL(I2C_OK, transport->finishMotion(frame));
+    TEST_ASSERT_EQUAL_INT(1, bus->transfers);
+    TEST_ASSERT_EQUAL_INT16(-2048, frame.accel[1]);
+    TEST_ASSERT_EQUAL_UINT32(1, transport->getStats().transactions);
+
+    // Finishing twice is an error, not a stale frame
+    TEST_ASSERT_EQUAL(I2C_BUS_ERROR, transport->finishMotion(frame));
+    TEST_ASSERT_EQUAL(IMU_FRAME_FAILED, frame.status);
+}
+
+void test_sensor_manager_recovers_hung_bus(void) {
+    static SimDevice device;
+    simInitDevice(device, 7, makeScenario(SCENARIO_NORMAL_DRIVE, 7, 60000));
+    simSetCurrentDevice(&device);
+
+    SensorManager sensors;
+    TEST_ASSERT_TRUE(sensors.begin());
+    Clock::delay(1000);
+    sensors.readAllSensors();
+
+    // A jolt leaves the primary IMU holding SDA
+    device.i2cSdaHeldPulses = 7;
+    float ax, ay, az, gx, gy, gz;
+    sensors.readMPU6050(ax, ay, az, gx, gy, gz);
+    uint32_t held = device.i2cSdaHeldPulses;
+    TEST_ASSERT_TRUE(sensors.readMPU6050(ax, ay, az, gx, gy, gz));
+    simSetCurrentDevice(nullptr);
+
+    const I2cStats& stats = sensors.getI2cStats();
+    TEST_ASSERT_EQUAL_UINT32(0, held);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.recoveries);
+    TEST_ASSERT_TRUE(stats.timeouts >= 1);
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, 1.0f, az);
+    TEST_ASSERT_TRUE(sensors.isMPUReady());
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_decode_burst);
+    RUN_TEST(test_motion_is_one_burst_transaction);
+    RUN_TEST(test_timing_stats);
+    RUN_TEST(test_nack_marks_frame_failed);
+    RUN_TEST(test_hung_bus_is_clocked_free);
+    RUN_TEST(test_shorted_clock_cannot_recover);
+    RUN_TEST(test_repeated_failures_restart_controller);
+    RUN_TEST(test_begin_clears_bus_left_hung_by_reset);
+    RUN_TEST(test_split_phase_read);
+    RUN_TEST(test_sensor_manager_recovers_hung_bus);
+
+    return UNITY_END();
+}
+
+int main(void) {
+    return runUnityTests();
+}
@@ -0,0 +1,261 @@
+#include <unity.h>
+#include <math.h>
+#include <string.h>
+#include "config.h"
+#include "imu_voter.h"
+#include "sensor_manager.h"
+#include "sim_device.h"
+
+enum MockFault {
+    FAULT_NONE = 0,
+    FAULT_BIAS,       // reads 2 g high on X
+    FAULT_STUCK,      // repeats the frame it had when the fault started
+    FAULT_DETACHED,   // reads fail
+    FAULT_CLEARED,    // reads return all zeros
+    FAULT_CLIPPED     // X pinned at the positive rail
+};
+
+// An MPU6050 at +-8 g / +-500 dps with a few LSB of noise, whose fault can
+// be switched at any sample
+struct MockImu {
+    uint32_t noiseState;
+    MockFault fault;
+    ImuFrame held;
+
+    void begin(uint32_t seed) {
+        noiseState = seed;
+        fault = FAULT_NONE;
+        memset(&held, 0, sizeof(held));
+    }
+
+    int16_t noise() {
+        noiseState = noiseState * 1664525UL + 1013904223UL;
+        return (int16_t)((noiseState >> 24) % 9) - 4;
+    }
+
+    int16_t counts(float value, float perUnit) {
+        float raw = value * perUnit + noise();
+        if (raw > 32767.0f) return 32767;
+        if (raw < -32768.0f) return -32768;
+        return (int16_t)lrintf(raw);
+    }
+
+    ImuFrame read(const float* accel, const float* gyro) {
+        ImuFrame frame;
+        frame.status = IMU_FRAME_OK;
+        for (int axis = 0; axis < 3; axis++) {
+            frame.accel[axis] = counts(accel[axis], MPU6050_ACCEL_LSB_PER_G);
+            frame.gyro[axis] = counts(gyro[axis], MPU6050_GYRO_LSB_PER_DPS);
+        }
+        switch (fault) {
+            case FAULT_NONE: break;
+            case FAULT_BIAS: frame.accel[0] += (int16_t)(2 * MPU6050_ACCEL_LSB_PER_G); break;
+            case FAULT_STUCK: return held;
+            case FAULT_DETACHED: memset(&frame, 0, sizeof(frame)); frame.status = IMU_FRAME_FAILED; break;
+            case FAULT_CLEARED: memset(&frame, 0, sizeof(frame)); frame.status = IMU_FRAME_OK; break;
+            case FAULT_CLIPPED: frame.accel[0] = 32767; break;
+        }
+        held = frame;
+        return frame;
+    }
+};
+
+static MockImu mocks[IMU_MAX_COUNT];
+static ImuVoter voter;
+static float fused[6];
+
+static void setUpVoter(uint32_t count) {
+    bool present[IMU_MAX_COUNT] = {true, true, true, true};
+    voter.begin(count, present);
+    for (uint32_t i = 0; i < count; i++) mocks[i].begin(i + 1);
+}
+
+// One sample of the given motion through every mock; the fused result is in fused[]
+static bool sample(uint32_t count, float accelX, float accelZ = 1.0f, float gyroZ = 10.0f) {
+    const float accel[3] = {accelX, 0.0f, accelZ};
+    const float gyro[3] = {0.0f, 0.0f, gyroZ};
+    ImuFrame frames[IMU_MAX_COUNT];
+    for (uint32_t i = 0; i < count; i++) frames[i] = mocks[i].read(accel, gyro);
+    return voter.update(frames, fused[0], fused[1], fused[2], fused[3], fused[4], fused[5]);
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_reads_fit_the_sample_budget(void) {
+    // 156 bit times at 400 kHz plus driver overhead: two IMUs fit 1 ms
+    TEST_ASSERT_EQUAL_UINT32(390 + I2C_TRANSACTION_OVERHEAD_US, imuBurstMicros(400000));
+    TEST_ASSERT_EQUAL_UINT32(2, imuReadsPerSample(2, 400000, IMU_SAMPLE_BUDGET_US));
+    TEST_ASSERT_EQUAL_UINT32(2, imuReadsPerSample(3, 400000, IMU_SAMPLE_BUDGET_US));
+
+    // At the 100 kHz default not even one does, but the primary is read
+    TEST_ASSERT_TRUE(imuBurstMicros(100000) > IMU_SAMPLE_BUDGET_US);
+    TEST_ASSERT_EQUAL_UINT32(1, imuReadsPerSample(2, 100000, IMU_SAMPLE_BUDGET_US));
+}
+
+void test_healthy_sensors_agree(void) {
+    setUpVoter(2);
+    for (int n = 0; n < 100; n++) {
+        TEST_ASSERT_TRUE(sample(2, 0.5f));
+        TEST_ASSERT_FLOAT_WITHIN(0.002f, 0.5f, fused[0]);
+        TEST_ASSERT_FLOAT_WITHIN(0.002f, 1.0f, fused[2]);
+        TEST_ASSERT_FLOAT_WITHIN(0.1f, 10.0f, fused[5]);
+    }
+    TEST_ASSERT_EQUAL_UINT32(2, voter.getUsedCount());
+    TEST_ASSERT_EQUAL_UINT32(2, voter.getHealthyCount());
+    TEST_ASSERT_EQUAL_UINT32(0, voter.getFaultCount(0) + voter.getFaultCount(1));
+}
+
+void test_median_outvotes_biased_sensor(void) {
+    setUpVoter(3);
+    mocks[1].fault = FAULT_BIAS;
+    for (int n = 0; n < 50; n++) {
+        TEST_ASSERT_TRUE(sample(3, 0.2f));
+        TEST_ASSERT_FLOAT_WITHIN(0.002f, 0.2f, fused[0]);
+    }
+    TEST_ASSERT_EQUAL_UINT32(3, voter.getUsedCount());
+}
+
+void test_stuck_sensor_is_dropped_and_recovers(void) {
+    setUpVoter(2);
+    for (int n = 0; n < 10; n++) sample(2, 0.0f);
+
+    // Sensor 1 latches on its last good frame while the vehicle brakes at
+    // -0.6 g; that frame is the first of the identical run
+    mocks[1].fault = FAULT_STUCK;
+    for (int n = 2; n < IMU_STUCK_READINGS; n++) sample(2, -0.6f);
+    TEST_ASSERT_EQUAL(IMU_HEALTHY, voter.getHealth(1));
+
+    sample(2, -0.6f);
+    TEST_ASSERT_EQUAL(IMU_STUCK, voter.getHealth(1));
+    TEST_ASSERT_EQUAL_UINT32(1, voter.getUsedCount());
+    TEST_ASSERT_FLOAT_WITHIN(0.002f, -0.6f, fused[0]);
+    TEST_ASSERT_EQUAL_UINT32(1, voter.getFaultCount(1));
+
+    mocks[1].fault = FAULT_NONE;
+    sample(2, -0.6f);
+    TEST_ASSERT_EQUAL(IMU_HEALTHY, voter.getHealth(1));
+    TEST_ASSERT_EQUAL_UINT32(2, voter.getUsedCount());
+}
+
+void test_failed_reads_detach_sensor(void) {
+    const MockFault faults[] = {FAULT_DETACHED, FAULT_CLEARED};
+    for (MockFault fault : faults) {
+        setUpVoter(2);
+        sample(2, 0.0f);
+        mocks[0].fault = fault;
+
+        // Excluded from the first failed read, detached after a few
+        for (int n = 1; n < IMU_FAILED_READINGS; n++) {
+            TEST_ASSERT_TRUE(sample(2, 3.0f));
+            TEST_ASSERT_EQUAL_UINT32(1, voter.getUsedCount());
+            TEST_ASSERT_FLOAT_WITHIN(0.002f, 3.0f, fused[0]);
+        }
+        TEST_ASSERT_EQUAL(IMU_HEALTHY, voter.getHealth(0));
+        sample(2, 3.0f);
+        TEST_ASSERT_EQUAL(IMU_DETACHED, voter.getHealth(0));
+        TEST_ASSERT_EQUAL_UINT32(1, voter.getHealthyCount());
+
+        // Reseated
+        mocks[0].fault = FAULT_NONE;
+        sample(2, 0.0f);
+        TEST_ASSERT_EQUAL(IMU_HEALTHY, voter.getHealth(0));
+    }
+}
+
+void test_clipped_axis_defers_to_sensor_in_range(void) {
+    setUpVoter(2);
+    mocks[0].fault = FAULT_CLIPPED;
+    TEST_ASSERT_TRUE(sample(2, 6.0f));
+    TEST_ASSERT_FLOAT_WITHIN(0.002f, 6.0f, fused[0]);
+    TEST_ASSERT_FLOAT_WITHIN(0.002f, 1.0f, fused[2]);
+    TEST_ASSERT_EQUAL_UINT32(0, voter.getClippedAxes());
+
+    // Both past the +-8 g range: the rail is the best lower bound
+    mocks[0].fault = FAULT_NONE;
+    TEST_ASSERT_TRUE(sample(2, 12.0f));
+    TEST_ASSERT_FLOAT_WITHIN(0.002f, 32767 / MPU6050_ACCEL_LSB_PER_G, fused[0]);
+    TEST_ASSERT_EQUAL_UINT32(1, voter.getClippedAxes());
+}
+
+void test_no_usable_sensor(void) {
+    setUpVoter(2);
+    mocks[0].fault = FAULT_DETACHED;
+    mocks[1].fault = FAULT_DETACHED;
+    TEST_ASSERT_FALSE(sample(2, 1.0f));
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, fused[0]);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, fused[2]);
+    TEST_ASSERT_EQUAL_UINT32(0, voter.getUsedCount());
+}
+
+void test_offsets_apply_per_sensor(void) {
+    setUpVoter(2);
+    mocks[1].fault = FAULT_BIAS;
+    const float accel[3] = {2.0f, 0.0f, 0.0f};
+    const float gyro[3] = {0.0f, 0.0f, 0.0f};
+    voter.setOffsets(1, accel, gyro);
+    sample(2, 0.3f);
+    TEST_ASSERT_FLOAT_WITHIN(0.002f, 0.3f, fused[0]);
+}
+
+void test_sensor_manager_with_one_imu_missing(void) {
+    static SimDevice device;
+    simInitDevice(device, 5, makeScenario(SCENARIO_NORMAL_DRIVE, 5, 60000));
+    device.mpuAltPresent = false;
+    simSetCurrentDevice(&device);
+
+    SensorManager sensors;
+    TEST_ASSERT_TRUE(sensors.begin());
+    TEST_ASSERT_EQUAL_UINT32(I2C_CLOCK_HZ, device.i2cClockHz);
+    SensorData data = sensors.readAllSensors();
+    simSetCurrentDevice(nullptr);
+
+    const ImuVoter& imus = sensors.getImuVoter();
+    TEST_ASSERT_EQUAL(IMU_HEALTHY, imus.getHealth(0));
+    TEST_ASSERT_EQUAL(IMU_ABSENT, imus.getHealth(1));
+    TEST_ASSERT_EQUAL_UINT32(1, imus.getUsedCount());
+    TEST_ASSERT_TRUE(sensors.isMPUReady());
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, 1.0f, data.accelZ);
+}
+
+void test_sensor_manager_reads_both_imus(void) {
+    static SimDevice device;
+    simInitDevice(device, 6, makeScenario(SCENARIO_NORMAL_DRIVE, 6, 60000));
+    simSetCurrentDevice(&device);
+
+    SensorManager sensors;
+    TEST_ASSERT_TRUE(sensors.begin());
+    uint64_t before = Clock::micros64();
+    float ax, ay, az, gx, gy, gz;
+    TEST_ASSERT_TRUE(sensors.readMPU6050(ax, ay, az, gx, gy, gz));
+    uint64_t spent = Clock::micros64() - before;
+    simSetCurrentDevice(nullptr);
+
+    TEST_ASSERT_EQUAL_UINT32(2, sensors.getImuVoter().getUsedCount());
+    TEST_ASSERT_TRUE(spent <= IMU_SAMPLE_BUDGET_US);
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, 1.0f, az);
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_reads_fit_the_sample_budget);
+    RUN_TEST(test_healthy_sensors_agree);
+    RUN_TEST(test_median_outvotes_biased_sensor);
+    RUN_TEST(test_stuck_sensor_is_dropped_and_recovers);
+    RUN_TEST(test_failed_reads_detach_sensor);
+    RUN_TEST(test_clipped_axis_defers_to_sensor_in_range);
+    RUN_TEST(test_no_usable_sensor);
+    RUN_TEST(test_offsets_apply_per_sensor);
+    RUN_TEST(test_sensor_manager_with_one_imu_missing);
+    RUN_TEST(test_sensor_manager_reads_both_imus);
+
+    return UNITY_END();
+}
+
+int main(void) {
+    return runUnityTests();
+}
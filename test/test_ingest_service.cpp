@@ -0,0 +1,133 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "config.h"
+#include "ingest_service.h"
+#include "ingest_store.h"
+
+static bool valid(const char* json) {
+    return IngestService::isWellFormedJson(json, strlen(json));
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_accepts_what_the_firmware_sends(void) {
+    TEST_ASSERT_TRUE(valid("1.25"));
+    TEST_ASSERT_TRUE(valid("-3"));
+    TEST_ASSERT_TRUE(valid("0"));
+    TEST_ASSERT_TRUE(valid("6.02e23"));
+    TEST_ASSERT_TRUE(valid("1E-7"));
+    TEST_ASSERT_TRUE(valid("true"));
+    TEST_ASSERT_TRUE(valid(" null\n"));
+    TEST_ASSERT_TRUE(valid("\"MPU6050:OK,GPS:OK\""));
+    TEST_ASSERT_TRUE(valid("\"tab\\t quote\\\" \\u00e9\""));
+    TEST_ASSERT_TRUE(valid("{}"));
+    TEST_ASSERT_TRUE(valid("[]"));
+    TEST_ASSERT_TRUE(valid("{\"timestamp\":1700000000,\"severity\":3,\"latitude\":52.5,"
+                           "\"utc\":\"2023-11-14T22:13:20.000000Z\",\"quality\":1}"));
+    TEST_ASSERT_TRUE(valid("{ \"1700000000\" : {\"accelX\" : [0.1, -0.2, 1e0]}, \"b\" : false }"));
+}
+
+void test_rejects_more_than_one_value(void) {
+    TEST_ASSERT_FALSE(valid("1 2"));
+    TEST_ASSERT_FALSE(valid("{}{}"));
+    TEST_ASSERT_FALSE(valid("{} []"));
+    TEST_ASSERT_FALSE(valid("\"a\" \"b\""));
+    TEST_ASSERT_FALSE(valid("true false"));
+}
+
+void test_rejects_broken_separators(void) {
+    TEST_ASSERT_FALSE(valid("{\"a\" 1}"));
+    TEST_ASSERT_FALSE(valid("{\"a\":1,}"));
+    TEST_ASSERT_FALSE(valid("{\"a\":1 \"b\":2}"));
+    TEST_ASSERT_FALSE(valid("{,}"));
+    TEST_ASSERT_FALSE(valid("{\"a\"}"));
+    TEST_ASSERT_FALSE(valid("{\"a\":}"));
+    TEST_ASSERT_FALSE(valid("{:1}"));
+    TEST_ASSERT_FALSE(valid("{1:2}"));
+    TEST_ASSERT_FALSE(valid("[1 2]"));
+    TEST_ASSERT_FALSE(valid("[1,]"));
+    TEST_ASSERT_FALSE(valid("[,1]"));
+    TEST_ASSERT_FALSE(valid("[1,,2]"));
+    TEST_ASSERT_FALSE(valid("[\"a\":1]"));
+}
+
+void test_rejects_bad_scalars(void) {
+    TEST_ASSERT_FALSE(valid(""));
+    TEST_ASSERT_FALSE(valid("  "));
+    TEST_ASSERT_FALSE(valid("nan"));
+    TEST_ASSERT_FALSE(valid("tru"));
+    TEST_ASSERT_FALSE(valid("True"));
+    TEST_ASSERT_FALSE(valid("012"));
+    TEST_ASSERT_FALSE(valid("+1"));
+    TEST_ASSERT_FALSE(valid("1."));
+    TEST_ASSERT_FALSE(valid(".5"));
+    TEST_ASSERT_FALSE(valid("1e"));
+    TEST_ASSERT_FALSE(valid("-"));
+    TEST_ASSERT_FALSE(valid("\"open"));
+    TEST_ASSERT_FALSE(valid("\"bad \\x escape\""));
+    TEST_ASSERT_FALSE(valid("\"short \\u12\""));
+    TEST_ASSERT_FALSE(valid("\"line\nbreak\""));
+    TEST_ASSERT_FALSE(valid("'single'"));
+}
+
+void test_rejects_unbalanced_and_deep_nesting(void) {
+    TEST_ASSERT_FALSE(valid("{"));
+    TEST_ASSERT_FALSE(valid("[1"));
+    TEST_ASSERT_FALSE(valid("[1]]"));
+    TEST_ASSERT_FALSE(valid("{\"a\":[1}"));
+
+    char nested[80];
+    for (int levels = 32; levels <= 33; levels++) {
+        memset(nested, '[', levels);
+        memset(nested + levels, ']', levels);
+        if (levels == 32) {
+            TEST_ASSERT_TRUE(IngestService::isWellFormedJson(nested, 2 * levels));
+        } else {
+            TEST_ASSERT_FALSE(IngestService::isWellFormedJson(nested, 2 * levels));
+        }
+    }
+}
+
+void test_malformed_bodies_are_not_stored(void) {
+    char root[] = "/tmp/ingest_testXXXXXX";
+    TEST_ASSERT_NOT_NULL(mkdtemp(root));
+    IngestStore store(root);
+    TEST_ASSERT_TRUE(store.begin());
+    IngestService service(store);
+
+    const char* target = "/" FB_DEVICES_ROOT "esp32_a1b2c3d4e5f6/sensors/accelX.json?print=silent";
+    const char* bodies[] = {"1 2", "{\"a\" 1}", "{\"a\":1,}", "[1 2]"};
+    for (const char* body : bodies) {
+        TEST_ASSERT_EQUAL_INT(400, service.handle("PUT", 3, target, strlen(target),
+                                                  body, strlen(body), 1700000000000ULL));
+    }
+    TEST_ASSERT_EQUAL_UINT64(4, service.getRejectedCount());
+    TEST_ASSERT_EQUAL_UINT64(0, store.getRecordCount());
+
+    TEST_ASSERT_EQUAL_INT(204, service.handle("PUT", 3, target, strlen(target),
+                                              "0.25", 4, 1700000000000ULL));
+    TEST_ASSERT_EQUAL_UINT64(1, store.getRecordCount());
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_accepts_what_the_firmware_sends);
+    RUN_TEST(test_rejects_more_than_one_value);
+    RUN_TEST(test_rejects_broken_separators);
+    RUN_TEST(test_rejects_bad_scalars);
+    RUN_TEST(test_rejects_unbalanced_and_deep_nesting);
+    RUN_TEST(test_malformed_bodies_are_not_stored);
+
+    return UNITY_END();
+}
+
+int main(void) {
+    return runUnityTests();
+}
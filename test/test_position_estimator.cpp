@@ -0,0 +1,257 @@
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "config.h"
+#include "position_estimator.h"
+
+// Replayed drive: the vehicle speeds up, weaves through turns and brakes.
+// The IMU (50 Hz) reads forward acceleration and yaw rate with bias and
+// noise; GPS fixes (1 Hz, 3 m noise) arrive 150 ms after the second they
+// refer to. Outages drop fixes for whole windows.
+
+static const double START_LATITUDE = 12.9716;
+static const double START_LONGITUDE = 77.5946;
+static const double METRES_PER_DEGREE = 111320.0;
+static const uint64_t SAMPLE_MICROS = 20000;
+static const uint64_t FIX_DELAY_MICROS = 150000;
+
+PositionEstimator position;
+static uint32_t noiseState;
+
+static double uniform() {
+    noiseState = noiseState * 1664525UL + 1013904223UL;
+    return ((noiseState >> 8) + 0.5) / 16777216.0;
+}
+
+static double gaussian(double sigma) {
+    return sigma * sqrt(-2.0 * log(uniform())) * cos(2.0 * M_PI * uniform());
+}
+
+struct Truth {
+    double east, north, speed, heading;   // heading CCW from east
+    double accel, yawRate;
+};
+
+static double accelAt(double t) {
+    if (t < 10.0) return 1.5;
+    if (fmod(t, 60.0) >= 40.0 && fmod(t, 60.0) < 43.0) return -2.0;
+    if (fmod(t, 60.0) >= 43.0 && fmod(t, 60.0) < 47.0) return 1.5;
+    return 0.0;
+}
+
+static double yawRateAt(double t) {
+    return t < 10.0 ? 0.0 : 0.15 * sin(2.0 * M_PI * t / 25.0);
+}
+
+static void step(Truth& truth, double t, double dt) {
+    truth.accel = accelAt(t);
+    truth.yawRate = yawRateAt(t);
+    truth.east += truth.speed * cos(truth.heading) * dt;
+    truth.north += truth.speed * sin(truth.heading) * dt;
+    truth.speed += truth.accel * dt;
+    truth.heading += truth.yawRate * dt;
+}
+
+static double toLatitude(const Truth& truth) {
+    return START_LATITUDE + truth.north / METRES_PER_DEGREE;
+}
+
+static double toLongitude(const Truth& truth) {
+    return START_LONGITUDE + truth.east / (METRES_PER_DEGREE * cos(START_LATITUDE * M_PI / 180.0));
+}
+
+static double horizontalError(const SensorData& data, const Truth& truth) {
+    double north = (data.latitude - START_LATITUDE) * METRES_PER_DEGREE;
+    double east = (data.longitude - START_LONGITUDE) *
+                  METRES_PER_DEGREE * cos(START_LATITUDE * M_PI / 180.0);
+    return hypot(east - truth.east, north - truth.north);
+}
+
+struct DriveStats {
+    double sumSquared;
+    uint32_t count;
+    double worstWithFixes;
+    double worstInOutage;
+    double worstHeldFix;       // error of simply repeating the last fix
+    double worstUncovered;     // error beyond 3 sigma of the estimate
+};
+
+static bool inOutage(double t, const double outages[][2], int outageCount) {
+    for (int i = 0; i < outageCount; i++) {
+        if (t >= outages[i][0] && t < outages[i][1]) return true;
+    }
+    return false;
+}
+
+static DriveStats drive(double seconds, const double outages[][2], int outageCount) {
+    DriveStats stats;
+    memset(&stats, 0, sizeof(stats));
+    Truth truth;
+    memset(&truth, 0, sizeof(truth));
+    truth.heading = 0.6;
+
+    const double accelBias = 0.01 * 9.80665;
+    const double gyroBias = 0.2 * M_PI / 180.0;
+    double pendingLatitude = 0, pendingLongitude = 0;
+    uint64_t pendingFixMicros = 0;
+    double heldLatitude = 0, heldLongitude = 0;
+
+    for (uint64_t micros = SAMPLE_MICROS; micros <= (uint64_t)(seconds * 1e6); micros += SAMPLE_MICROS) {
+        double t = micros / 1e6;
+        step(truth, t, SAMPLE_MICROS / 1e6);
+
+        // The receiver samples the position on the second...
+        if (micros % 1000000 == 0 && !inOutage(t, outages, outageCount)) {
+            pendingLatitude = toLatitude(truth) + gaussian(POSITION_GPS_SIGMA_M) / METRES_PER_DEGREE;
+            pendingLongitude = toLongitude(truth) + gaussian(POSITION_GPS_SIGMA_M) /
+                               (METRES_PER_DEGREE * cos(START_LATITUDE * M_PI / 180.0));
+            pendingFixMicros = micros;
+        }
+
+        SensorData data;
+        memset(&data, 0, sizeof(data));
+        data.accelX = (float)((truth.accel + accelBias + gaussian(0.3)) / 9.80665);
+        data.gyroZ = (float)((truth.yawRate + gyroBias + gaussian(0.02)) * 180.0 / M_PI);
+        data.accelZ = 1.0f;
+        data.sampleMicros = micros;
+        data.timestamp = (uint32_t)(micros / 1000);
+
+        // ... and reports it after the NMEA burst has been read
+        if (pendingFixMicros && micros >= pendingFixMicros + FIX_DELAY_MICROS) {
+            data.latitude = (float)pendingLatitude;
+            data.longitude = (float)pendingLongitude;
+            data.gpsFixMicros = pendingFixMicros;
+            heldLatitude = pendingLatitude;
+            heldLongitude = pendingLongitude;
+            pendingFixMicros = 0;
+        }
+
+        position.update(data);
+        if (t < 20.0) continue;
+
+        double error = horizontalError(data, truth);
+        SensorData held = data;
+        held.latitude = (float)heldLatitude;
+        held.longitude = (float)heldLongitude;
+        double heldError = horizontalError(held, truth);
+
+        if (inOutage(t, outages, outageCount)) {
+            if (error > stats.worstInOutage) stats.worstInOutage = error;
+            if (heldError > stats.worstHeldFix) stats.worstHeldFix = heldError;
+        } else if (!inOutage(t - 5.0, outages, outageCount)) {
+            // Settled again five seconds after an outage
+            stats.sumSquared += error * error;
+            stats.count++;
+            if (error > stats.worstWithFixes) stats.worstWithFixes = error;
+        }
+        double uncovered = error - 3.0 * data.positionErrorM;
+        if (uncovered > stats.worstUncovered) stats.worstUncovered = uncovered;
+    }
+    return stats;
+}
+
+static double rms(const DriveStats& stats) {
+    return sqrt(stats.sumSquared / (stats.count ? stats.count : 1));
+}
+
+static void report(const char* name, const DriveStats& stats) {
+    char message[160];
+    int length = snprintf(message, sizeof(message), "%s: rms %.1f m, worst %.1f m with fixes",
+                          name, rms(stats), stats.worstWithFixes);
+    if (stats.worstHeldFix > 0.0) {
+        snprintf(message + length, sizeof(message) - length,
+                 ", %.1f m in outage (held fix %.1f m)", stats.worstInOutage, stats.worstHeldFix);
+    }
+    TEST_MESSAGE(message);
+}
+
+// A single fix is off by POSITION_GPS_SIGMA_M per axis; the filter must do
+// better than that between and at fixes
+static const double RMS_LIMIT = POSITION_GPS_SIGMA_M * 1.2;
+
+void setUp(void) {
+    position.reset();
+    noiseState = 7;
+}
+
+void tearDown(void) {
+}
+
+void test_no_estimate_before_first_fix(void) {
+    SensorData data;
+    memset(&data, 0, sizeof(data));
+    data.accelX = 0.2f;
+    data.sampleMicros = 100000;
+    position.update(data);
+
+    TEST_ASSERT_FALSE(position.hasPosition());
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, data.latitude);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, data.positionErrorM);
+
+    data.latitude = (float)START_LATITUDE;
+    data.longitude = (float)START_LONGITUDE;
+    data.gpsFixMicros = 50000;
+    data.sampleMicros = 200000;
+    position.update(data);
+    TEST_ASSERT_TRUE(position.hasPosition());
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, (float)START_LATITUDE, data.latitude);
+    TEST_ASSERT_TRUE(data.positionErrorM > 0.0f);
+}
+
+void test_duplicate_fix_is_applied_once(void) {
+    SensorData data;
+    memset(&data, 0, sizeof(data));
+    data.latitude = (float)START_LATITUDE;
+    data.longitude = (float)START_LONGITUDE;
+    data.gpsFixMicros = 1000000;
+    for (uint64_t micros = 1100000; micros < 1300000; micros += SAMPLE_MICROS) {
+        data.sampleMicros = micros;
+        position.update(data);
+    }
+    TEST_ASSERT_EQUAL_UINT32(1, position.getFixCount());
+}
+
+void test_tracks_drive_between_fixes(void) {
+    DriveStats stats = drive(300.0, nullptr, 0);
+    report("fixes only", stats);
+
+    TEST_ASSERT_TRUE(rms(stats) < RMS_LIMIT);
+    TEST_ASSERT_TRUE(stats.worstWithFixes < 10.0);
+    TEST_ASSERT_TRUE(stats.worstUncovered <= 0.0);
+}
+
+void test_dead_reckons_through_outages(void) {
+    const double outages[][2] = {{60.0, 70.0}, {150.0, 180.0}};
+    DriveStats stats = drive(300.0, outages, 2);
+    report("10 s and 30 s outages", stats);
+
+    TEST_ASSERT_TRUE(rms(stats) < RMS_LIMIT);
+    TEST_ASSERT_TRUE(stats.worstInOutage < stats.worstHeldFix / 4);
+    TEST_ASSERT_TRUE(stats.worstUncovered <= 0.0);
+}
+
+void test_long_drive_recentres_origin(void) {
+    // 40 minutes at up to 30 m/s covers tens of km from the first fix
+    DriveStats stats = drive(2400.0, nullptr, 0);
+    report("40 min drive", stats);
+
+    TEST_ASSERT_TRUE(rms(stats) < RMS_LIMIT);
+    TEST_ASSERT_TRUE(stats.worstUncovered <= 0.0);
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_no_estimate_before_first_fix);
+    RUN_TEST(test_duplicate_fix_is_applied_once);
+    RUN_TEST(test_tracks_drive_between_fixes);
+    RUN_TEST(test_dead_reckons_through_outages);
+    RUN_TEST(test_long_drive_recentres_origin);
+
+    return UNITY_END();
+}
+
+int main(void) {
+    return runUnityTests();
+}
@@ -0,0 +1,265 @@
+#include <unity.h>
+#include "config.h"
+#include "rate_scheduler.h"
+#include "sample_scheduler.h"
+#include "sensor_manager.h"
+#include "sim_device.h"
+
+static RateScheduler scheduler;
+
+void setUp(void) {
+    scheduler.begin();
+}
+
+void tearDown(void) {
+}
+
+void test_shorter_period_runs_first(void) {
+    int slow = scheduler.add("slow", RATE_PERIODIC, 100000, 100000, 1000);
+    int edge = scheduler.add("edge", RATE_SPORADIC, 100000, 100000, 1000);
+    int fast = scheduler.add("fast", RATE_PERIODIC, 50000, 50000, 1000);
+    TEST_ASSERT_EQUAL_INT(0, slow);
+    TEST_ASSERT_EQUAL_INT(1, edge);
+    TEST_ASSERT_EQUAL_INT(2, fast);
+    scheduler.start(0);
+    scheduler.release(edge, 0);
+
+    // All due at once: the most frequent, then equal periods as added
+    TEST_ASSERT_EQUAL_INT(fast, scheduler.next(0));
+    scheduler.complete(fast, 0, 100);
+    TEST_ASSERT_EQUAL_INT(slow, scheduler.next(100));
+    scheduler.complete(slow, 100, 200);
+    TEST_ASSERT_EQUAL_INT(edge, scheduler.next(200));
+    scheduler.complete(edge, 200, 300);
+    TEST_ASSERT_EQUAL_INT(-1, scheduler.next(300));
+}
+
+void test_periodic_releases_keep_their_grid(void) {
+    int task = scheduler.add("task", RATE_PERIODIC, 50000, 50000, 1000, 20000);
+    scheduler.start(1000);
+    TEST_ASSERT_EQUAL_UINT32(20000, scheduler.getWaitMicros(1000));
+    TEST_ASSERT_EQUAL_INT(-1, scheduler.next(20999));
+    TEST_ASSERT_EQUAL_INT(task, scheduler.next(21000));
+    TEST_ASSERT_EQUAL_UINT32(0, scheduler.getWaitMicros(21000));
+
+    // Started late, the next release is still on the grid
+    scheduler.complete(task, 24000, 25000);
+    TEST_ASSERT_EQUAL_UINT32(46000, scheduler.getWaitMicros(25000));
+    TEST_ASSERT_EQUAL_UINT32(0, scheduler.getStats(task).deadlineMisses);
+}
+
+void test_releases_that_pass_are_skipped(void) {
+    int task = scheduler.add("task", RATE_PERIODIC, 10000, 10000, 1000);
+    scheduler.start(0);
+    // Held up 35 ms: runs once, late, and the releases at 10, 20 and 30 ms
+    // are dropped rather than run back to back
+    TEST_ASSERT_EQUAL_INT(task, scheduler.next(35000));
+    scheduler.complete(task, 35000, 35500);
+    TEST_ASSERT_EQUAL_INT(-1, scheduler.next(35500));
+    TEST_ASSERT_EQUAL_UINT32(4500, scheduler.getWaitMicros(35500));
+
+    const RateTaskStats& stats = scheduler.getStats(task);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.runs);
+    TEST_ASSERT_EQUAL_UINT32(3, stats.skipped);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.deadlineMisses);
+    TEST_ASSERT_EQUAL_UINT32(35500, stats.maxResponseMicros);
+}
+
+void test_sporadic_release_replaces_a_pending_one(void) {
+    int edge = scheduler.add("edge", RATE_SPORADIC, 10000, 10000, 1000);
+    scheduler.start(0);
+    TEST_ASSERT_EQUAL_INT(-1, scheduler.next(50000));
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, scheduler.getWaitMicros(50000));
+
+    scheduler.release(edge, 50000);
+    scheduler.release(edge, 60000);
+    TEST_ASSERT_EQUAL_UINT32(0, scheduler.getWaitMicros(60000));
+    TEST_ASSERT_EQUAL_INT(edge, scheduler.next(60000));
+    // Measured from the newest release
+    scheduler.complete(edge, 60000, 61000);
+    TEST_ASSERT_EQUAL_INT(-1, scheduler.next(61000));
+
+    const RateTaskStats& stats = scheduler.getStats(edge);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.skipped);
+    TEST_ASSERT_EQUAL_UINT32(1000, stats.maxResponseMicros);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.deadlineMisses);
+}
+
+void test_overruns_are_counted(void) {
+    int task = scheduler.add("task", RATE_PERIODIC, 10000, 10000, 1000);
+    scheduler.start(0);
+    scheduler.complete(task, 0, 1000);
+    scheduler.complete(task, 10000, 13000);
+    const RateTaskStats& stats = scheduler.getStats(task);
+    TEST_ASSERT_EQUAL_UINT32(2, stats.runs);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.overruns);
+    TEST_ASSERT_EQUAL_UINT32(3000, stats.maxRunMicros);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.deadlineMisses);
+}
+
+void test_full_schedule_refuses_more(void) {
+    for (int i = 0; i < RATE_TASK_MAX; i++) {
+        TEST_ASSERT_EQUAL_INT(i, scheduler.add("task", RATE_PERIODIC, 10000, 10000, 100));
+    }
+    TEST_ASSERT_EQUAL_INT(-1, scheduler.add("task", RATE_PERIODIC, 10000, 10000, 100));
+    scheduler.begin();
+    scheduler.add("task", RATE_PERIODIC, 10000, 10000, 100);
+    scheduler.start(0);
+    TEST_ASSERT_EQUAL_INT(-1, scheduler.add("late", RATE_PERIODIC, 10000, 10000, 100));
+}
+
+void test_utilization_bound(void) {
+    // Two tasks: bound 2(sqrt(2) - 1) = 0.83
+    scheduler.add("a", RATE_PERIODIC, 10000, 10000, 4000);
+    scheduler.add("b", RATE_PERIODIC, 20000, 20000, 8000);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.8f, scheduler.getUtilization());
+    TEST_ASSERT_TRUE(scheduler.fitsRateMonotonicBound());
+
+    scheduler.begin();
+    scheduler.add("a", RATE_PERIODIC, 10000, 10000, 5000);
+    scheduler.add("b", RATE_PERIODIC, 20000, 20000, 8000);
+    TEST_ASSERT_FALSE(scheduler.fitsRateMonotonicBound());
+
+    // The firmware's own sources fit
+    scheduler.begin();
+    SensorManager::scheduleSources(scheduler);
+    TEST_ASSERT_EQUAL_UINT32(SENSOR_SOURCE_COUNT, scheduler.getTaskCount());
+    TEST_ASSERT_TRUE(scheduler.fitsRateMonotonicBound());
+}
+
+// Synthetic load on a virtual clock: an edge-released task and two periodic
+// ones, each taking its cost per run, plus a blocking step (the network) of
+// blockMicros every blockEvery wakes. Runs like loop(): sleep to the next
+// release, run what is due, then the blocking step.
+struct LoadRun {
+    uint32_t misses[3];
+    uint32_t skipped[3];
+    uint32_t runs[3];
+};
+
+static void runLoad(uint32_t blockMicros, uint32_t blockEvery, LoadRun& run) {
+    static const uint32_t costs[] = {1500, 25000, 2000};
+    scheduler.begin();
+    SensorManager::scheduleSources(scheduler);
+    scheduler.start(0);
+
+    const uint64_t edgePeriod = SENSOR_READ_INTERVAL * 1000ULL;
+    uint64_t now = 0;
+    uint64_t nextEdge = edgePeriod / 3;
+    uint32_t wakes = 0;
+    while (true) {
+        uint64_t wake = now + scheduler.getWaitMicros(now);
+        if (nextEdge < wake) wake = nextEdge;
+        if (wake >= 60000000ULL) break;
+        if (wake > now) now = wake;
+        while (nextEdge <= now) {
+            scheduler.release(SOURCE_IMU, nextEdge);
+            nextEdge += edgePeriod;
+        }
+        int task;
+        while ((task = scheduler.next(now)) >= 0) {
+            uint64_t start = now;
+            now += costs[task];
+            scheduler.complete(task, start, now);
+        }
+        if (blockEvery && ++wakes % blockEvery == 0) now += blockMicros;
+    }
+    for (int task = 0; task < 3; task++) {
+        run.misses[task] = scheduler.getStats(task).deadlineMisses;
+        run.skipped[task] = scheduler.getStats(task).skipped;
+        run.runs[task] = scheduler.getStats(task).runs;
+    }
+}
+
+void test_sources_meet_deadlines_without_load(void) {
+    LoadRun run;
+    runLoad(0, 0, run);
+    for (int task = 0; task < 3; task++) {
+        TEST_ASSERT_EQUAL_UINT32(0, run.misses[task]);
+        TEST_ASSERT_EQUAL_UINT32(0, run.skipped[task]);
+    }
+    TEST_ASSERT_EQUAL_UINT32(60000 / SENSOR_READ_INTERVAL, run.runs[SOURCE_IMU]);
+    TEST_ASSERT_EQUAL_UINT32(60000 / ULTRASONIC_PERIOD_MS, run.runs[SOURCE_ULTRASONIC]);
+    TEST_ASSERT_EQUAL_UINT32(60000 / GPS_PERIOD_MS, run.runs[SOURCE_GPS]);
+}
+
+void test_blocking_load_shows_as_deadline_misses(void) {
+    // 80 ms of network now and then: the 50 ms GPS drain runs late, the
+    // IMU edge still makes it
+    LoadRun run;
+    runLoad(80000, 7, run);
+    TEST_ASSERT_TRUE(run.misses[SOURCE_GPS] > 0);
+    TEST_ASSERT_EQUAL_UINT32(0, run.misses[SOURCE_IMU]);
+    TEST_ASSERT_EQUAL_UINT32(0, run.skipped[SOURCE_IMU]);
+
+    // Three periods at a time: releases dropped as well, and counted. The
+    // IMU keeps the newest edge, so its losses show as skipped, not late.
+    runLoad(SENSOR_READ_INTERVAL * 3000UL, 20, run);
+    TEST_ASSERT_TRUE(run.skipped[SOURCE_IMU] > 0);
+    TEST_ASSERT_TRUE(run.misses[SOURCE_ULTRASONIC] > 0);
+    TEST_ASSERT_TRUE(run.skipped[SOURCE_ULTRASONIC] > 0);
+    TEST_ASSERT_TRUE(run.misses[SOURCE_GPS] > 0);
+    TEST_ASSERT_TRUE(run.skipped[SOURCE_GPS] > 0);
+}
+
+void test_sensors_read_at_their_own_rates(void) {
+    static SimDevice device;
+    simInitDevice(device, 31, makeScenario(SCENARIO_NORMAL_DRIVE, 31, 60000));
+    simSetCurrentDevice(&device);
+
+    SensorManager sensors;
+    TEST_ASSERT_TRUE(sensors.begin());
+    sensors.notifyOnDataReady(xTaskGetCurrentTaskHandle());
+    SampleScheduler sampler;
+    sampler.begin(SENSOR_READ_INTERVAL * 1000UL, true, Clock::micros64());
+    SensorManager::scheduleSources(scheduler);
+    scheduler.start(Clock::micros64());
+
+    // Firmware::loop() (src/firmware.cpp) for ten seconds
+    uint32_t samples = 0;
+    uint32_t withDistance = 0;
+    uint64_t start = Clock::micros64();
+    while (Clock::micros64() - start < 10000000ULL) {
+        uint64_t now = Clock::micros64();
+        uint32_t waitMicros = sampler.getWaitMicros(now);
+        if (scheduler.getWaitMicros(now) < waitMicros) waitMicros = scheduler.getWaitMicros(now);
+        uint32_t edges = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS((waitMicros + 999) / 1000));
+        if (sampler.onWake(edges, Clock::micros64())) scheduler.release(SOURCE_IMU, Clock::micros64());
+        if (!sensors.readDueSources(scheduler)) continue;
+        SensorData data = sensors.takeSample();
+        samples++;
+        if (!(data.missing & SENSOR_ULTRASONIC)) withDistance++;
+    }
+    simSetCurrentDevice(nullptr);
+
+    TEST_ASSERT_TRUE(samples >= 10000 / SENSOR_READ_INTERVAL - 1);
+    TEST_ASSERT_EQUAL_UINT32(samples, withDistance);
+    TEST_ASSERT_EQUAL_UINT32(samples, scheduler.getStats(SOURCE_IMU).runs);
+    TEST_ASSERT_TRUE(scheduler.getStats(SOURCE_ULTRASONIC).runs >= 10000 / ULTRASONIC_PERIOD_MS - 1);
+    TEST_ASSERT_TRUE(scheduler.getStats(SOURCE_GPS).runs >= 10000 / GPS_PERIOD_MS - 1);
+    for (int source = 0; source < SENSOR_SOURCE_COUNT; source++) {
+        TEST_ASSERT_EQUAL_UINT32(0, scheduler.getStats(source).deadlineMisses);
+        TEST_ASSERT_EQUAL_UINT32(0, scheduler.getStats(source).skipped);
+    }
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_shorter_period_runs_first);
+    RUN_TEST(test_periodic_releases_keep_their_grid);
+    RUN_TEST(test_releases_that_pass_are_skipped);
+    RUN_TEST(test_sporadic_release_replaces_a_pending_one);
+    RUN_TEST(test_overruns_are_counted);
+    RUN_TEST(test_full_schedule_refuses_more);
+    RUN_TEST(test_utilization_bound);
+    RUN_TEST(test_sources_meet_deadlines_without_load);
+    RUN_TEST(test_blocking_load_shows_as_deadline_misses);
+    RUN_TEST(test_sensors_read_at_their_own_rates);
+
+    return UNITY_END();
+}
+
+int main(void) {
+    return runUnityTests();
+}
@@ -0,0 +1,207 @@
+#include <unity.h>
+#include <string.h>
+#include "config.h"
+#include "sample_scheduler.h"
+#include "sensor_manager.h"
+#include "sim_device.h"
+
+#define PERIOD_US (SENSOR_READ_INTERVAL * 1000UL)
+
+static SampleScheduler scheduler;
+
+void setUp(void) {
+    scheduler.begin(PERIOD_US, true, 0);
+}
+
+void tearDown(void) {
+}
+
+void test_every_edge_is_a_sample(void) {
+    // Waiting on the edge, the timeout leaves it half a period of grace
+    TEST_ASSERT_EQUAL_UINT32(PERIOD_US + PERIOD_US / 2, scheduler.getWaitMicros(0));
+    for (uint32_t n = 1; n <= 10; n++) {
+        TEST_ASSERT_TRUE(scheduler.onWake(1, n * PERIOD_US + 40));
+    }
+    TEST_ASSERT_EQUAL_UINT32(10, scheduler.getSamples());
+    TEST_ASSERT_EQUAL_UINT32(0, scheduler.getMissed());
+    TEST_ASSERT_EQUAL_UINT32(0, scheduler.getFallbacks());
+    TEST_ASSERT_TRUE(scheduler.isInterruptAlive());
+}
+
+void test_edges_that_pile_up_are_missed_samples(void) {
+    // The loop was busy for three periods; the MPU kept only the newest
+    TEST_ASSERT_TRUE(scheduler.onWake(3, 3 * PERIOD_US + 500));
+    TEST_ASSERT_EQUAL_UINT32(1, scheduler.getSamples());
+    TEST_ASSERT_EQUAL_UINT32(2, scheduler.getMissed());
+}
+
+void test_early_timeout_is_not_a_sample(void) {
+    TEST_ASSERT_FALSE(scheduler.onWake(0, PERIOD_US + 10));
+    TEST_ASSERT_EQUAL_UINT32(0, scheduler.getSamples());
+    TEST_ASSERT_EQUAL_UINT32(1, scheduler.getWakeups());
+    TEST_ASSERT_TRUE(scheduler.isInterruptAlive());
+}
+
+void test_falls_back_to_timer_when_edges_stop(void) {
+    TEST_ASSERT_TRUE(scheduler.onWake(1, PERIOD_US));
+
+    // No edge by the end of the grace: sample anyway, then on the timer
+    uint64_t stall = 2 * PERIOD_US + PERIOD_US / 2;
+    TEST_ASSERT_TRUE(scheduler.onWake(0, stall));
+    TEST_ASSERT_FALSE(scheduler.isInterruptAlive());
+    TEST_ASSERT_EQUAL_UINT32(1, scheduler.getFallbacks());
+    TEST_ASSERT_EQUAL_UINT32(PERIOD_US, scheduler.getWaitMicros(stall));
+
+    // A late wake does not shift the grid
+    TEST_ASSERT_TRUE(scheduler.onWake(0, stall + PERIOD_US + 3000));
+    TEST_ASSERT_EQUAL_UINT32(PERIOD_US - 3000, scheduler.getWaitMicros(stall + PERIOD_US + 3000));
+    TEST_ASSERT_EQUAL_UINT32(2, scheduler.getFallbacks());
+
+    // The next edge puts it back on the interrupt
+    TEST_ASSERT_TRUE(scheduler.onWake(1, stall + PERIOD_US + 50000));
+    TEST_ASSERT_TRUE(scheduler.isInterruptAlive());
+    TEST_ASSERT_EQUAL_UINT32(4, scheduler.getSamples());
+    TEST_ASSERT_EQUAL_UINT32(0, scheduler.getMissed());
+}
+
+void test_timer_keeps_its_grid(void) {
+    scheduler.begin(PERIOD_US, false, 1000);
+    TEST_ASSERT_EQUAL_UINT32(PERIOD_US, scheduler.getWaitMicros(1000));
+    TEST_ASSERT_FALSE(scheduler.onWake(0, PERIOD_US));
+    TEST_ASSERT_TRUE(scheduler.onWake(0, PERIOD_US + 1000));
+
+    // Woken 2.5 periods late: one sample now, on the grid, one missed
+    uint64_t late = 3 * PERIOD_US + 1000 + PERIOD_US / 2;
+    TEST_ASSERT_TRUE(scheduler.onWake(0, late));
+    TEST_ASSERT_EQUAL_UINT32(1, scheduler.getMissed());
+    TEST_ASSERT_EQUAL_UINT32(PERIOD_US / 2, scheduler.getWaitMicros(late));
+    TEST_ASSERT_EQUAL_UINT32(0, scheduler.getFallbacks());
+}
+
+void test_wait_rounds_up_to_ticks(void) {
+    scheduler.begin(PERIOD_US, false, 0);
+    TEST_ASSERT_EQUAL_UINT32(SENSOR_READ_INTERVAL, scheduler.getWaitMillis(0));
+    TEST_ASSERT_EQUAL_UINT32(1, scheduler.getWaitMillis(PERIOD_US - 1));
+    TEST_ASSERT_EQUAL_UINT32(0, scheduler.getWaitMillis(PERIOD_US));
+    TEST_ASSERT_EQUAL_UINT32(0, scheduler.getWaitMillis(PERIOD_US + 5000));
+}
+
+struct LoopRun {
+    uint32_t samples;
+    uint64_t maxSpacing;    // between sample times
+    uint32_t edges;         // data-ready edges while it ran
+    uint64_t idleMicros;
+    uint64_t elapsedMicros;
+};
+
+// Firmware::loop() on a simulated unit: sleep on the data-ready
+// notification, read, then stay busy for busyMs (detection, network)
+static void runLoop(SimDevice& device, uint32_t samples, uint32_t busyMs, LoopRun& run) {
+    memset(&run, 0, sizeof(run));
+    SensorManager sensors;
+    TEST_ASSERT_TRUE(sensors.begin());
+    TEST_ASSERT_TRUE(sensors.hasDataReadyInterrupt());
+    sensors.notifyOnDataReady(xTaskGetCurrentTaskHandle());
+    uint64_t start = Clock::micros64();
+    uint32_t startEdges = sensors.getDataReadyCount();
+    uint64_t startIdle = device.taskIdleMicros;
+    scheduler.begin(PERIOD_US, true, start);
+
+    uint64_t lastSample = 0;
+    while (run.samples < samples) {
+        uint32_t edges = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(scheduler.getWaitMillis(Clock::micros64())));
+        if (!scheduler.onWake(edges, Clock::micros64())) continue;
+        SensorData data = sensors.readAllSensors();
+        if (lastSample && data.sampleMicros - lastSample > run.maxSpacing) {
+            run.maxSpacing = data.sampleMicros - lastSample;
+        }
+        lastSample = data.sampleMicros;
+        run.samples++;
+        simAdvanceMicros(busyMs * 1000ULL);
+    }
+    run.edges = sensors.getDataReadyCount() - startEdges;
+    run.idleMicros = device.taskIdleMicros - startIdle;
+    run.elapsedMicros = Clock::micros64() - start;
+}
+
+void test_loop_samples_on_the_edge(void) {
+    static SimDevice device;
+    simInitDevice(device, 21, makeScenario(SCENARIO_NORMAL_DRIVE, 21, 60000));
+    simSetCurrentDevice(&device);
+    LoopRun run;
+    runLoop(device, 50, 30, run);
+    simSetCurrentDevice(nullptr);
+
+    // Exactly one period apart, one wake per sample, asleep most of the time
+    TEST_ASSERT_EQUAL_UINT64(PERIOD_US, run.maxSpacing);
+    TEST_ASSERT_EQUAL_UINT32(50, scheduler.getWakeups());
+    TEST_ASSERT_EQUAL_UINT32(0, scheduler.getMissed());
+    TEST_ASSERT_EQUAL_UINT32(0, scheduler.getFallbacks());
+    TEST_ASSERT_TRUE(run.idleMicros > run.elapsedMicros / 4);
+}
+
+void test_loop_counts_missed_edges(void) {
+    static SimDevice device;
+    simInitDevice(device, 22, makeScenario(SCENARIO_NORMAL_DRIVE, 22, 60000));
+    simSetCurrentDevice(&device);
+    // Busy for longer than a period after every read: edges pile up
+    LoopRun run;
+    runLoop(device, 40, SENSOR_READ_INTERVAL * 3 / 2, run);
+    uint32_t pending = device.taskNotifications;
+    simSetCurrentDevice(nullptr);
+
+    // Every edge is either a sample or counted missed
+    TEST_ASSERT_TRUE(scheduler.getMissed() > 0);
+    TEST_ASSERT_EQUAL_UINT32(run.edges, scheduler.getSamples() + scheduler.getMissed() + pending);
+    TEST_ASSERT_EQUAL_UINT64(2 * PERIOD_US, run.maxSpacing);
+    TEST_ASSERT_EQUAL_UINT32(0, scheduler.getFallbacks());
+}
+
+void test_loop_survives_a_dead_interrupt(void) {
+    static SimDevice device;
+    simInitDevice(device, 23, makeScenario(SCENARIO_NORMAL_DRIVE, 23, 60000));
+    simSetCurrentDevice(&device);
+
+    SensorManager sensors;
+    TEST_ASSERT_TRUE(sensors.begin());
+    sensors.notifyOnDataReady(xTaskGetCurrentTaskHandle());
+    scheduler.begin(PERIOD_US, true, Clock::micros64());
+    // INT line broken after boot: no more edges
+    device.mpuDataReadyInterrupt = false;
+
+    uint32_t taken = 0;
+    uint64_t start = Clock::micros64();
+    while (Clock::micros64() - start < 2000000ULL) {
+        uint32_t edges = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(scheduler.getWaitMillis(Clock::micros64())));
+        if (scheduler.onWake(edges, Clock::micros64())) {
+            sensors.readAllSensors();
+            taken++;
+        }
+    }
+    simSetCurrentDevice(nullptr);
+
+    // One sample lost to the grace period, then the timer keeps the rate
+    TEST_ASSERT_FALSE(scheduler.isInterruptAlive());
+    TEST_ASSERT_TRUE(taken >= 2000000 / PERIOD_US - 1);
+    TEST_ASSERT_EQUAL_UINT32(taken, scheduler.getFallbacks());
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_every_edge_is_a_sample);
+    RUN_TEST(test_edges_that_pile_up_are_missed_samples);
+    RUN_TEST(test_early_timeout_is_not_a_sample);
+    RUN_TEST(test_falls_back_to_timer_when_edges_stop);
+    RUN_TEST(test_timer_keeps_its_grid);
+    RUN_TEST(test_wait_rounds_up_to_ticks);
+    RUN_TEST(test_loop_samples_on_the_edge);
+    RUN_TEST(test_loop_counts_missed_edges);
+    RUN_TEST(test_loop_survives_a_dead_interrupt);
+
+    return UNITY_END();
+}
+
+int main(void) {
+    return runUnityTests();
+}
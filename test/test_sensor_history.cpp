@@ -0,0 +1,123 @@
+#include <unity.h>
+#include <string.h>
+#include "config.h"
+#include "crash_detector.h"
+#include "sensor_history.h"
+
+static SensorData reading(uint32_t n) {
+    SensorData data;
+    memset(&data, 0, sizeof(data));
+    data.accelX = n * 0.5f;
+    data.accelY = -1.0f * n;
+    data.accelZ = 1.0f;
+    data.gyroX = n * 2.0f;
+    data.gyroY = 3.0f;
+    data.gyroZ = -4.0f;
+    data.distance = 100.0f + n;
+    data.vibration = n % 2;
+    data.latitude = 12.5f;
+    data.longitude = 77.25f;
+    data.positionErrorM = 4.0f;
+    data.timestamp = n * 10;
+    data.sampleMicros = (uint64_t)n * 10000 + 1;
+    data.gpsFixMicros = (uint64_t)n * 1000000;
+    data.missing = n & 0x07;
+    data.quality = (n * 3) & 0xFF;
+    return data;
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_empty_history_reads_zero(void) {
+    SensorHistory<8> history;
+    TEST_ASSERT_EQUAL_UINT32(0, history.size());
+    TEST_ASSERT_EQUAL_UINT32(0, history.head());
+    for (uint32_t back = 1; back <= 8; back++) {
+        uint32_t idx = history.slot(back);
+        TEST_ASSERT_EQUAL_FLOAT(0.0f, history.accelX()[idx]);
+        TEST_ASSERT_EQUAL_UINT32(0, history.timestamp()[idx]);
+    }
+}
+
+void test_slots_walk_back_from_newest_across_wrap(void) {
+    SensorHistory<8> history;
+    for (uint32_t n = 1; n <= 21; n++) history.push(reading(n));
+
+    TEST_ASSERT_EQUAL_UINT32(8, history.size());
+    TEST_ASSERT_EQUAL_UINT32(21 % 8, history.head());
+    for (uint32_t back = 1; back <= 8; back++) {
+        uint32_t idx = history.slot(back);
+        TEST_ASSERT_EQUAL_FLOAT(reading(22 - back).accelX, history.accelX()[idx]);
+        TEST_ASSERT_EQUAL_UINT32(reading(22 - back).timestamp, history.timestamp()[idx]);
+    }
+    // One past the depth is the slot about to be overwritten
+    TEST_ASSERT_EQUAL_UINT32(history.head(), history.slot(8));
+}
+
+void test_get_reassembles_hot_and_cold_fields(void) {
+    SensorHistory<4> history;
+    for (uint32_t n = 1; n <= 6; n++) history.push(reading(n));
+
+    SensorData expected = reading(5);
+    SensorData stored = history.get(history.slot(2));
+    TEST_ASSERT_EQUAL_FLOAT(expected.accelY, stored.accelY);
+    TEST_ASSERT_EQUAL_FLOAT(expected.gyroX, stored.gyroX);
+    TEST_ASSERT_EQUAL_FLOAT(expected.distance, stored.distance);
+    TEST_ASSERT_EQUAL_INT(expected.vibration, stored.vibration);
+    TEST_ASSERT_EQUAL_FLOAT(expected.latitude, stored.latitude);
+    TEST_ASSERT_EQUAL_FLOAT(expected.positionErrorM, stored.positionErrorM);
+    TEST_ASSERT_TRUE(expected.sampleMicros == stored.sampleMicros);
+    TEST_ASSERT_TRUE(expected.gpsFixMicros == stored.gpsFixMicros);
+    TEST_ASSERT_EQUAL_UINT8(expected.missing, stored.missing);
+    TEST_ASSERT_EQUAL_UINT8(expected.quality, stored.quality);
+
+    history.clear();
+    TEST_ASSERT_EQUAL_UINT32(0, history.size());
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, history.get(history.slot(2)).distance);
+    TEST_ASSERT_EQUAL_UINT8(0, history.get(history.slot(2)).missing);
+}
+
+void test_deep_history_masks_slots(void) {
+    static SensorHistory<4096> history;
+    history.clear();
+    for (uint32_t n = 1; n <= 10000; n++) history.push(reading(n));
+
+    TEST_ASSERT_EQUAL_UINT32(4096, history.size());
+    TEST_ASSERT_EQUAL_UINT32(10000 & 4095, history.head());
+    TEST_ASSERT_EQUAL_UINT32(reading(10000).timestamp, history.timestamp()[history.slot(1)]);
+    TEST_ASSERT_EQUAL_UINT32(reading(10000 - 4095).timestamp,
+                             history.timestamp()[history.slot(4096)]);
+}
+
+void test_detector_keeps_history_inline(void) {
+    // No heap block behind the detector any more: the ring is part of it
+    TEST_ASSERT_TRUE(sizeof(CrashDetector) >= sizeof(DetectorHistory));
+
+    CrashDetector detector;
+    detector.begin(CrashDetectionConfig());
+    for (uint32_t n = 1; n <= 3; n++) detector.addToHistory(reading(n));
+    const DetectorHistory& history = detector.getHistory();
+    TEST_ASSERT_EQUAL_UINT32(3, history.size());
+    TEST_ASSERT_EQUAL_INT(3, detector.getHistoryIndex());
+    TEST_ASSERT_EQUAL_FLOAT(reading(3).gyroX, history.gyroX()[history.slot(1)]);
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_empty_history_reads_zero);
+    RUN_TEST(test_slots_walk_back_from_newest_across_wrap);
+    RUN_TEST(test_get_reassembles_hot_and_cold_fields);
+    RUN_TEST(test_deep_history_masks_slots);
+    RUN_TEST(test_detector_keeps_history_inline);
+
+    return UNITY_END();
+}
+
+int main(void) {
+    return runUnityTests();
+}
@@ -0,0 +1,291 @@
+#include <unity.h>
+#include <string.h>
+#include <chrono>
+#include "config.h"
+#include "crash_detector.h"
+#include "health_monitor.h"
+#include "sensor_manager.h"
+#include "sim_device.h"
+
+// Runs on the host (build with -DHAL_SIM)
+
+static CrashDetector detector;
+static CrashDetectionConfig testConfig;
+
+void setUp(void) {
+    testConfig = CrashDetectionConfig();
+    detector.begin(testConfig);
+}
+
+void tearDown(void) {
+}
+
+static SensorData quietReading(uint32_t timestamp) {
+    SensorData data;
+    memset(&data, 0, sizeof(data));
+    data.accelZ = 1.0f;
+    data.distance = 200.0f;
+    data.vibration = LOW;
+    data.timestamp = timestamp;
+    return data;
+}
+
+// Three readings over the consecutive threshold, then one that scores
+// accel 2 + gyro 3 + consecutive 2 = 7 with every sensor present
+static SensorData sevenPointReading(uint8_t missing) {
+    for (uint32_t i = 0; i < 3; i++) {
+        SensorData high = quietReading(100 * i);
+        high.accelX = 4.0f;
+        detector.addToHistory(high);
+    }
+    SensorData data = quietReading(300);
+    data.accelX = 4.0f;
+    data.gyroZ = 500.0f;
+    data.missing = missing;
+    return data;
+}
+
+void test_full_set_keeps_the_original_cutoffs(void) {
+    TEST_ASSERT_EQUAL(14, CrashDetector::maxScore(SENSOR_ALL));
+    TEST_ASSERT_EQUAL(MODERATE_CRASH, detector.detectCrash(sevenPointReading(0)));
+    TEST_ASSERT_EQUAL(7, detector.getLastScore());
+    TEST_ASSERT_EQUAL_UINT8(SENSOR_ALL, detector.getLastSensorSet());
+}
+
+void test_missing_gps_changes_nothing(void) {
+    TEST_ASSERT_EQUAL(MODERATE_CRASH, detector.detectCrash(sevenPointReading(SENSOR_GPS)));
+    TEST_ASSERT_EQUAL(7, detector.getLastScore());
+    TEST_ASSERT_EQUAL(14, CrashDetector::maxScore(detector.getLastSensorSet()));
+}
+
+void test_missing_ultrasonic_ignores_distance(void) {
+    // A dead ranger's zero-filled or stale distance is not an obstacle
+    SensorData data = quietReading(0);
+    data.accelX = 4.0f;
+    data.distance = 10.0f;
+    TEST_ASSERT_EQUAL(MINOR_CRASH, detector.detectCrash(data));
+    detector.resetCrashDetection();
+
+    data.missing = SENSOR_ULTRASONIC;
+    TEST_ASSERT_EQUAL(NO_CRASH, detector.detectCrash(data));
+    TEST_ASSERT_EQUAL(2, detector.getLastScore());
+    TEST_ASSERT_EQUAL(13, CrashDetector::maxScore(detector.getLastSensorSet()));
+}
+
+void test_missing_vibration_ignores_the_pin(void) {
+    SensorData data = quietReading(0);
+    data.accelX = 4.0f;
+    data.vibration = HIGH;
+    TEST_ASSERT_EQUAL(MINOR_CRASH, detector.detectCrash(data));
+    detector.resetCrashDetection();
+
+    data.missing = SENSOR_VIBRATION;
+    TEST_ASSERT_EQUAL(NO_CRASH, detector.detectCrash(data));
+    TEST_ASSERT_EQUAL(2, detector.getLastScore());
+}
+
+void test_cutoffs_follow_the_available_sensors(void) {
+    // 7 of the 11 the IMU alone can score is severe
+    TEST_ASSERT_EQUAL(SEVERE_CRASH,
+                      detector.detectCrash(sevenPointReading(SENSOR_VIBRATION | SENSOR_ULTRASONIC)));
+    TEST_ASSERT_EQUAL(7, detector.getLastScore());
+    TEST_ASSERT_EQUAL_UINT8(SENSOR_IMU | SENSOR_GPS, detector.getLastSensorSet());
+
+    // Without the switch: 12 reachable, severe from 7, moderate from 5
+    detector.begin(testConfig);
+    SensorData data = quietReading(0);
+    data.accelX = 6.0f;
+    data.gyroZ = 300.0f;
+    data.missing = SENSOR_VIBRATION;
+    TEST_ASSERT_EQUAL(MODERATE_CRASH, detector.detectCrash(data));
+    TEST_ASSERT_EQUAL(5, detector.getLastScore());
+}
+
+void test_missing_imu_never_detects(void) {
+    SensorData data = quietReading(0);
+    data.accelX = 10.0f;
+    data.gyroZ = 600.0f;
+    data.vibration = HIGH;
+    data.distance = 10.0f;
+    data.missing = SENSOR_IMU | SENSOR_GPS;
+    for (int i = 0; i < 5; i++) {
+        data.timestamp += 100;
+        detector.addToHistory(data);
+        TEST_ASSERT_EQUAL(NO_CRASH, detector.detectCrash(data));
+    }
+    // Switch and ranger still scored, for the record
+    TEST_ASSERT_EQUAL(3, detector.getLastScore());
+    TEST_ASSERT_EQUAL_UINT8(SENSOR_ULTRASONIC | SENSOR_VIBRATION, detector.getLastSensorSet());
+    TEST_ASSERT_FALSE(detector.isCrashDetected());
+}
+
+// Each reading scored, then added, so the jerk is against the one before
+static int scoreAfterImuGap(bool flagged) {
+    testConfig.jerkThreshold = 5.0f;
+    detector.begin(testConfig);
+    uint32_t t = 0;
+    for (int i = 0; i < 4; i++) {
+        SensorData data = quietReading(t += 100);
+        detector.detectCrash(data);
+        detector.addToHistory(data);
+    }
+    SensorData gap;
+    memset(&gap, 0, sizeof(gap));
+    gap.timestamp = (t += 100);
+    gap.distance = 200.0f;
+    gap.missing = flagged ? SENSOR_IMU : 0;
+    detector.detectCrash(gap);
+    detector.addToHistory(gap);
+
+    SensorData back = quietReading(t += 100);
+    detector.detectCrash(back);
+    return detector.getLastScore();
+}
+
+void test_imu_gap_is_not_a_jolt(void) {
+    // Unflagged, the zeros are a 1 g step in 100 ms
+    TEST_ASSERT_EQUAL(2, scoreAfterImuGap(false));
+    TEST_ASSERT_EQUAL(0, scoreAfterImuGap(true));
+}
+
+void test_spectrum_stands_in_for_a_missing_switch(void) {
+    testConfig.impactEnergy = 0.5f;
+    detector.begin(testConfig);
+    SpectralFeatures features;
+    memset(&features, 0, sizeof(features));
+    features.valid = true;
+    features.energy = 1.0f;
+    features.flatness = 0.9f;
+    detector.setSpectralFeatures(features);
+
+    SensorData data = quietReading(0);
+    data.missing = SENSOR_VIBRATION;
+    detector.detectCrash(data);
+    TEST_ASSERT_EQUAL(2, detector.getLastScore());
+    TEST_ASSERT_TRUE(detector.getLastSensorSet() & SENSOR_VIBRATION);
+}
+
+void test_readings_report_their_sensors(void) {
+    static SimDevice device;
+    simInitDevice(device, 9, makeScenario(SCENARIO_NORMAL_DRIVE, 9, 60000));
+    simSetCurrentDevice(&device);
+    SensorManager* sensors = new SensorManager();
+    TEST_ASSERT_TRUE(sensors->begin());
+
+    SensorData data = sensors->readAllSensors();
+    TEST_ASSERT_EQUAL_UINT8(SENSOR_IMU | SENSOR_ULTRASONIC | SENSOR_VIBRATION,
+                           sensorSet(data) & ~SENSOR_GPS);
+    TEST_ASSERT_FALSE(data.quality & QUALITY_IMU_REDUCED);
+
+    // GPS contributes to the readings that carry a fix
+    TEST_ASSERT_FALSE(sensorSet(data) & SENSOR_GPS);
+    bool located = false;
+    for (int i = 0; i < (SIM_GPS_FIX_MS + 2000) / SENSOR_READ_INTERVAL && !located; i++) {
+        Clock::delay(SENSOR_READ_INTERVAL);
+        data = sensors->readAllSensors();
+        located = sensorSet(data) & SENSOR_GPS;
+    }
+    TEST_ASSERT_TRUE(located);
+    TEST_ASSERT_TRUE(data.latitude != 0.0f);
+
+    // A suspended ranger is missing, not out of range
+    static ResetRecord record;
+    HealthMonitor health;
+    health.begin(&record, RESET_POWER_ON, Clock::millis());
+    sensors->setHealthMonitor(&health);
+    device.ultrasonicStallMs = 100;
+    for (int i = 0; i < HEALTH_STRIKES + 1; i++) {
+        Clock::delay(SENSOR_READ_INTERVAL);
+        data = sensors->readAllSensors();
+    }
+    TEST_ASSERT_TRUE(data.missing & SENSOR_ULTRASONIC);
+    TEST_ASSERT_FALSE(data.quality & QUALITY_NO_ECHO);
+    TEST_ASSERT_TRUE(sensorSet(data) & SENSOR_IMU);
+    delete sensors;
+
+    // One IMU of two lost in use: still a reading, flagged as voted from fewer
+    simInitDevice(device, 10, makeScenario(SCENARIO_NORMAL_DRIVE, 10, 60000));
+    sensors = new SensorManager();
+    TEST_ASSERT_TRUE(sensors->begin());
+    device.mpuAltPresent = false;
+    Clock::delay(SENSOR_READ_INTERVAL);
+    data = sensors->readAllSensors();
+    TEST_ASSERT_TRUE(sensorSet(data) & SENSOR_IMU);
+    if (IMU_COUNT > 1) TEST_ASSERT_TRUE(data.quality & QUALITY_IMU_REDUCED);
+    delete sensors;
+    simSetCurrentDevice(nullptr);
+}
+
+void test_single_imu_board_is_not_reduced(void) {
+    // The second address never answers: a board with one MPU6050 fitted
+    static SimDevice device;
+    simInitDevice(device, 11, makeScenario(SCENARIO_NORMAL_DRIVE, 11, 60000));
+    device.mpuAltPresent = false;
+    simSetCurrentDevice(&device);
+    SensorManager* sensors = new SensorManager();
+    TEST_ASSERT_TRUE(sensors->begin());
+    TEST_ASSERT_EQUAL_UINT32(1, sensors->getImuVoter().getFittedCount());
+
+    for (int i = 0; i < 50; i++) {
+        Clock::delay(SENSOR_READ_INTERVAL);
+        SensorData data = sensors->readAllSensors();
+        TEST_ASSERT_TRUE(sensorSet(data) & SENSOR_IMU);
+        TEST_ASSERT_FALSE(data.quality & QUALITY_IMU_REDUCED);
+    }
+    delete sensors;
+    simSetCurrentDevice(nullptr);
+}
+
+static double nanosPerReading(uint8_t missing) {
+    const int readings = 20000;
+    double best = 1e30;
+    for (int trial = 0; trial < 5; trial++) {
+        detector.begin(testConfig);
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < readings; i++) {
+            SensorData data = quietReading(i * 100);
+            data.accelX = (i % 7) * 0.1f;
+            data.missing = missing;
+            detector.addToHistory(data);
+            detector.detectCrash(data);
+        }
+        double nanos = std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - start).count() / readings;
+        if (nanos < best) best = nanos;
+    }
+    return best;
+}
+
+void test_degraded_scoring_costs_no_more(void) {
+    // Cutoffs for every sensor set are worked out in begin(); a degraded
+    // reading only skips factors
+    double full = nanosPerReading(0);
+    uint8_t degraded[] = {SENSOR_ULTRASONIC, SENSOR_VIBRATION, SENSOR_GPS,
+                          SENSOR_ULTRASONIC | SENSOR_VIBRATION, SENSOR_IMU};
+    for (uint8_t missing : degraded) {
+        double nanos = nanosPerReading(missing);
+        TEST_ASSERT_TRUE(nanos <= full * 1.25 + 20.0);
+    }
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_full_set_keeps_the_original_cutoffs);
+    RUN_TEST(test_missing_gps_changes_nothing);
+    RUN_TEST(test_missing_ultrasonic_ignores_distance);
+    RUN_TEST(test_missing_vibration_ignores_the_pin);
+    RUN_TEST(test_cutoffs_follow_the_available_sensors);
+    RUN_TEST(test_missing_imu_never_detects);
+    RUN_TEST(test_imu_gap_is_not_a_jolt);
+    RUN_TEST(test_spectrum_stands_in_for_a_missing_switch);
+    RUN_TEST(test_readings_report_their_sensors);
+    RUN_TEST(test_single_imu_board_is_not_reduced);
+    RUN_TEST(test_degraded_scoring_costs_no_more);
+
+    return UNITY_END();
+}
+
+int main(void) {
+    return runUnityTests();
+}
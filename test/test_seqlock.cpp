@@ -0,0 +1,161 @@
+#include <unity.h>
+#include <string.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "config.h"
+#include "seqlock.h"
+
+#define READERS 4
+#define WRITES 400000
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+// Every field follows from n, so a reading mixing two writes is caught
+static SensorData reading(uint32_t n) {
+    SensorData data;
+    memset(&data, 0, sizeof(data));
+    data.accelX = (float)n;
+    data.accelY = (float)n * 2;
+    data.accelZ = (float)n * 3;
+    data.gyroX = (float)n * 4;
+    data.gyroY = (float)n * 5;
+    data.gyroZ = (float)n * 6;
+    data.distance = (float)(n % 400);
+    data.vibration = n & 1;
+    data.latitude = (float)(n % 1000);
+    data.longitude = (float)(n % 1000) * 2;
+    data.timestamp = n;
+    data.sampleMicros = (uint64_t)n * 100000;
+    data.gpsFixMicros = (uint64_t)n * 7;
+    data.missing = n & 0x0F;
+    data.quality = (n >> 4) & 0xFF;
+    return data;
+}
+
+static bool isWhole(const SensorData& data) {
+    SensorData expected = reading(data.timestamp);
+    return memcmp(&data, &expected, sizeof(data)) == 0;
+}
+
+// A struct too big to copy in one go on any core
+struct Block {
+    uint32_t words[64];
+};
+
+void test_reads_zero_before_the_first_write(void) {
+    Seqlock<SensorData> snapshot;
+    SensorData data = snapshot.read();
+    TEST_ASSERT_EQUAL_UINT32(0, snapshot.getVersion());
+    TEST_ASSERT_TRUE(isWhole(data));
+    TEST_ASSERT_EQUAL_UINT32(0, data.timestamp);
+}
+
+void test_reads_the_latest_write(void) {
+    Seqlock<SensorData> snapshot;
+    for (uint32_t n = 1; n <= 5; n++) {
+        snapshot.publish(reading(n));
+        SensorData data = snapshot.read();
+        TEST_ASSERT_EQUAL_UINT32(n, data.timestamp);
+        TEST_ASSERT_TRUE(isWhole(data));
+    }
+    TEST_ASSERT_EQUAL_UINT32(5, snapshot.getVersion());
+}
+
+void test_odd_sized_values(void) {
+    struct Small {
+        uint8_t bytes[5];
+    };
+    Seqlock<Small> snapshot;
+    Small value = {{1, 2, 3, 4, 5}};
+    snapshot.publish(value);
+    Small copy = snapshot.read();
+    TEST_ASSERT_EQUAL_MEMORY(value.bytes, copy.bytes, sizeof(value.bytes));
+}
+
+void test_no_torn_sensor_data_under_contention(void) {
+    static Seqlock<SensorData> snapshot;
+    std::atomic<bool> done(false);
+    std::atomic<uint32_t> torn(0);
+    std::atomic<uint32_t> backwards(0);
+    std::atomic<uint64_t> reads(0);
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < READERS; r++) {
+        readers.emplace_back([&]() {
+            uint32_t last = 0;
+            uint64_t count = 0;
+            while (!done.load(std::memory_order_relaxed)) {
+                SensorData data = snapshot.read();
+                if (!isWhole(data)) torn++;
+                if (data.timestamp < last) backwards++;
+                last = data.timestamp;
+                count++;
+            }
+            reads += count;
+        });
+    }
+    for (uint32_t n = 1; n <= WRITES; n++) snapshot.publish(reading(n));
+    done = true;
+    for (std::thread& reader : readers) reader.join();
+
+    TEST_ASSERT_EQUAL_UINT32(0, torn.load());
+    TEST_ASSERT_EQUAL_UINT32(0, backwards.load());
+    TEST_ASSERT_TRUE(reads.load() > 0);
+    TEST_ASSERT_EQUAL_UINT32(WRITES, snapshot.getVersion());
+    TEST_ASSERT_EQUAL_UINT32(WRITES, snapshot.read().timestamp);
+}
+
+void test_no_torn_blocks_under_contention(void) {
+    // 256 bytes: a long copy, so writes land in the middle of reads often
+    static Seqlock<Block> snapshot;
+    std::atomic<bool> done(false);
+    std::atomic<uint32_t> torn(0);
+    Block block;
+    for (int i = 0; i < 64; i++) block.words[i] = i;
+    snapshot.publish(block);
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < READERS; r++) {
+        readers.emplace_back([&]() {
+            while (!done.load(std::memory_order_relaxed)) {
+                Block block = snapshot.read();
+                for (int i = 1; i < 64; i++) {
+                    if (block.words[i] != block.words[0] + i) {
+                        torn++;
+                        break;
+                    }
+                }
+            }
+        });
+    }
+    for (uint32_t n = 1; n <= WRITES; n++) {
+        for (int i = 0; i < 64; i++) block.words[i] = n * 64 + i;
+        snapshot.publish(block);
+    }
+    done = true;
+    for (std::thread& reader : readers) reader.join();
+
+    TEST_ASSERT_EQUAL_UINT32(0, torn.load());
+    TEST_ASSERT_EQUAL_UINT32(WRITES + 1, snapshot.getVersion());
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_reads_zero_before_the_first_write);
+    RUN_TEST(test_reads_the_latest_write);
+    RUN_TEST(test_odd_sized_values);
+    RUN_TEST(test_no_torn_sensor_data_under_contention);
+    RUN_TEST(test_no_torn_blocks_under_contention);
+
+    return UNITY_END();
+}
+
+int main(void) {
+    return runUnityTests();
+}
@@ -0,0 +1,183 @@
+#include <unity.h>
+#include <math.h>
+#include <string.h>
+#include "config.h"
+#include "crash_detector.h"
+#include "spectral_features.h"
+
+static const float RATE_HZ = 1000.0f / SENSOR_READ_INTERVAL;
+static uint32_t noiseState;
+
+static float gaussian() {
+    float sum = 0.0f;
+    for (int i = 0; i < 12; i++) {
+        noiseState = noiseState * 1664525UL + 1013904223UL;
+        sum += (noiseState >> 8) / 16777216.0f;
+    }
+    return sum - 6.0f;
+}
+
+static SensorData reading(uint32_t n, float accelX, float accelY, float accelZ) {
+    SensorData data;
+    memset(&data, 0, sizeof(data));
+    data.accelX = accelX;
+    data.accelY = accelY;
+    data.accelZ = accelZ;
+    data.timestamp = n * SENSOR_READ_INTERVAL;
+    data.sampleMicros = (uint64_t)data.timestamp * 1000;
+    return data;
+}
+
+// A bin-centred tone on X over a resting 1 g on Z
+static void fillTone(DetectorHistory& history, int bin, float amplitude) {
+    history.clear();
+    for (uint32_t n = 0; n < SPECTRUM_WINDOW; n++) {
+        float tone = amplitude * sinf(2.0f * (float)M_PI * bin * n / SPECTRUM_WINDOW);
+        history.push(reading(n, tone, 0.0f, 1.0f));
+    }
+}
+
+static void fillNoise(DetectorHistory& history, float sigma) {
+    history.clear();
+    for (uint32_t n = 0; n < SPECTRUM_WINDOW; n++) {
+        history.push(reading(n, sigma * gaussian(), sigma * gaussian(), 1.0f + sigma * gaussian()));
+    }
+}
+
+void setUp(void) {
+    noiseState = 3;
+}
+
+void tearDown(void) {
+}
+
+void test_real_fft_matches_dft(void) {
+    static float input[256], data[256], twiddles[256], power[129];
+    const uint32_t sizes[] = {8, 16, 64, 256};
+    for (uint32_t size : sizes) {
+        for (uint32_t n = 0; n < size; n++) input[n] = gaussian();
+        memcpy(data, input, size * sizeof(float));
+        fftTwiddles(twiddles, size);
+        realFftPower(data, size, twiddles, power);
+
+        for (uint32_t k = 0; k <= size / 2; k++) {
+            double re = 0.0, im = 0.0;
+            for (uint32_t n = 0; n < size; n++) {
+                re += input[n] * cos(2.0 * M_PI * k * n / size);
+                im -= input[n] * sin(2.0 * M_PI * k * n / size);
+            }
+            double expected = re * re + im * im;
+            TEST_ASSERT_FLOAT_WITHIN(1e-4f * size + 1e-4f * (float)expected, (float)expected, power[k]);
+        }
+    }
+}
+
+void test_invalid_until_window_is_full(void) {
+    DetectorHistory history;
+    SpectralAnalyzer analyzer;
+    for (uint32_t n = 0; n + 1 < SPECTRUM_WINDOW; n++) {
+        history.push(reading(n, 0.1f, 0.0f, 1.0f));
+        TEST_ASSERT_FALSE(analyzer.analyze(history));
+        TEST_ASSERT_FALSE(analyzer.getFeatures().valid);
+    }
+    history.push(reading(SPECTRUM_WINDOW, 0.1f, 0.0f, 1.0f));
+    TEST_ASSERT_TRUE(analyzer.analyze(history));
+    TEST_ASSERT_TRUE(analyzer.getFeatures().valid);
+}
+
+void test_tone_is_tonal_and_located(void) {
+    DetectorHistory history;
+    SpectralAnalyzer analyzer;
+    analyzer.begin(RATE_HZ);
+    const int bin = 3;
+    fillTone(history, bin, 0.5f);
+    TEST_ASSERT_TRUE(analyzer.analyze(history));
+    const SpectralFeatures& features = analyzer.getFeatures();
+
+    // Hann is exact for a bin-centred tone: mean square A^2 / 2, no DC
+    TEST_ASSERT_FLOAT_WITHIN(0.002f, 0.125f, features.energy);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, bin * RATE_HZ / SPECTRUM_WINDOW, features.peakHz);
+    TEST_ASSERT_TRUE(features.flatness < 0.05f);
+
+    // Hann leaves 2/3 in the bin and a sixth in each neighbour; bins 3
+    // and 4 share a band
+    int band = (bin - 1) * SPECTRUM_BANDS / (SPECTRUM_WINDOW / 2);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.8333f * features.energy, features.bandEnergy[band]);
+}
+
+void test_noise_and_impact_are_broadband(void) {
+    DetectorHistory history;
+    SpectralAnalyzer analyzer;
+    fillNoise(history, 0.2f);
+    TEST_ASSERT_TRUE(analyzer.analyze(history));
+    TEST_ASSERT_TRUE(analyzer.getFeatures().flatness > 0.4f);
+    TEST_ASSERT_FLOAT_WITHIN(0.06f, 3 * 0.04f, analyzer.getFeatures().energy);
+
+    // A single 4 g spike mid-window
+    history.clear();
+    for (uint32_t n = 0; n < SPECTRUM_WINDOW; n++) {
+        history.push(reading(n, n == SPECTRUM_WINDOW / 2 ? 4.0f : 0.0f, 0.0f, 1.0f));
+    }
+    TEST_ASSERT_TRUE(analyzer.analyze(history));
+    TEST_ASSERT_TRUE(analyzer.getFeatures().flatness > 0.5f);
+    TEST_ASSERT_TRUE(analyzer.getFeatures().energy > 0.5f);
+}
+
+// Score with only the vibration factor able to fire
+static int vibrationScore(const CrashDetectionConfig& base, const DetectorHistory& history,
+                          int pin) {
+    CrashDetectionConfig config = base;
+    config.accelThreshold = 100.0f;
+    config.severeAccelThreshold = 200.0f;
+    config.gyroThreshold = 1000.0f;
+    config.jerkThreshold = 1000.0f;
+    config.consecutiveReadings = 100;
+    CrashDetector detector;
+    detector.begin(config);
+
+    SpectralAnalyzer analyzer;
+    analyzer.analyze(history);
+    detector.setSpectralFeatures(analyzer.getFeatures());
+
+    SensorData data = reading(100, 0.0f, 0.0f, 1.0f);
+    data.vibration = pin;
+    detector.detectCrash(data);
+    return detector.getLastScore();
+}
+
+void test_spectrum_gates_vibration_factor(void) {
+    DetectorHistory tone, noise;
+    fillTone(tone, 5, 0.3f);
+    fillNoise(noise, 0.3f);
+
+    // Defaults: the pin alone decides, as before
+    CrashDetectionConfig config;
+    TEST_ASSERT_EQUAL_INT(2, vibrationScore(config, tone, HIGH));
+    TEST_ASSERT_EQUAL_INT(0, vibrationScore(config, noise, LOW));
+
+    // Engine tone no longer scores; broadband shaking does
+    config.vibrationFlatness = 0.3f;
+    TEST_ASSERT_EQUAL_INT(0, vibrationScore(config, tone, HIGH));
+    TEST_ASSERT_EQUAL_INT(2, vibrationScore(config, noise, HIGH));
+
+    // Broadband energy scores without the pin
+    config.impactEnergy = 0.1f;
+    TEST_ASSERT_EQUAL_INT(2, vibrationScore(config, noise, LOW));
+    TEST_ASSERT_EQUAL_INT(0, vibrationScore(config, tone, LOW));
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_real_fft_matches_dft);
+    RUN_TEST(test_invalid_until_window_is_full);
+    RUN_TEST(test_tone_is_tonal_and_located);
+    RUN_TEST(test_noise_and_impact_are_broadband);
+    RUN_TEST(test_spectrum_gates_vibration_factor);
+
+    return UNITY_END();
+}
+
+int main(void) {
+    return runUnityTests();
+}
@@ -0,0 +1,301 @@
+#include <unity.h>
+#include <string.h>
+#include "config.h"
+#include "crash_confirmer.h"
+#include "telemetry.h"
+
+// Runs on the host (build with -DHAL_SIM)
+
+static Telemetry* telemetry;
+static TelemetryRecord received[64];
+static char receivedText[8][64];
+static int receivedCount;
+
+void setUp(void) {
+    telemetry = new Telemetry();
+    receivedCount = 0;
+}
+
+void tearDown(void) {
+    delete telemetry;
+}
+
+static void collect(const TelemetryRecord& record, void* context) {
+    (void)context;
+    if (receivedCount < 64) received[receivedCount] = record;
+    if (record.type == TELEMETRY_TEXT && receivedCount < 8) {
+        size_t length = record.textLength < 63 ? record.textLength : 63;
+        memcpy(receivedText[receivedCount], record.text, length);
+        receivedText[receivedCount][length] = '\0';
+    }
+    receivedCount++;
+}
+
+// Everything queued, as the UART would have sent it
+static size_t drainAll(uint8_t* out, size_t size) {
+    size_t total = 0;
+    const uint8_t* data;
+    size_t length;
+    while ((length = telemetry->peek(&data, size - total)) > 0) {
+        memcpy(out + total, data, length);
+        total += length;
+        telemetry->consume(length);
+    }
+    return total;
+}
+
+static SensorData reading(void) {
+    SensorData data;
+    memset(&data, 0, sizeof(data));
+    data.accelX = 0.25f;
+    data.accelZ = 1.0f;
+    data.gyroY = -42.5f;
+    data.distance = 120.0f;
+    data.latitude = 12.9716f;
+    data.longitude = 77.5946f;
+    data.vibration = 1;
+    data.missing = SENSOR_ULTRASONIC;
+    data.sampleMicros = 5000123;
+    return data;
+}
+
+void test_cobs_round_trip(void) {
+    uint8_t input[600];
+    uint8_t encoded[620];
+    uint8_t decoded[600];
+
+    // Zeros at the ends and in a row, and runs longer than one block
+    for (size_t i = 0; i < sizeof(input); i++) input[i] = (i % 300 == 0 || i == 599) ? 0 : (uint8_t)(i * 7 + 1);
+    input[301] = 0;
+    input[302] = 0;
+    size_t encodedLength = cobsEncode(input, sizeof(input), encoded);
+    TEST_ASSERT_LESS_OR_EQUAL(sizeof(input) + sizeof(input) / 254 + 1, encodedLength);
+    for (size_t i = 0; i < encodedLength; i++) TEST_ASSERT_NOT_EQUAL(0, encoded[i]);
+    TEST_ASSERT_EQUAL_UINT32(sizeof(input), cobsDecode(encoded, encodedLength, decoded, sizeof(decoded)));
+    TEST_ASSERT_EQUAL_MEMORY(input, decoded, sizeof(input));
+
+    // Exactly one full block
+    uint8_t block[254];
+    for (size_t i = 0; i < sizeof(block); i++) block[i] = 0x55;
+    encodedLength = cobsEncode(block, sizeof(block), encoded);
+    TEST_ASSERT_EQUAL_UINT8(0xFF, encoded[0]);
+    TEST_ASSERT_EQUAL_UINT32(sizeof(block), cobsDecode(encoded, encodedLength, decoded, sizeof(decoded)));
+
+    // A zero inside, or a length past the end, is not COBS
+    const uint8_t bad1[] = {0x03, 0x11, 0x00};
+    const uint8_t bad2[] = {0x05, 0x11, 0x22};
+    TEST_ASSERT_EQUAL_UINT32(0, cobsDecode(bad1, sizeof(bad1), decoded, sizeof(decoded)));
+    TEST_ASSERT_EQUAL_UINT32(0, cobsDecode(bad2, sizeof(bad2), decoded, sizeof(decoded)));
+}
+
+void test_crc_matches_ccitt(void) {
+    const uint8_t check[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+    TEST_ASSERT_EQUAL_UINT16(0x29B1, telemetryCrc(check, sizeof(check)));
+}
+
+void test_records_round_trip(void) {
+    telemetry->sample(reading(), 1);
+    telemetry->score(7, 11, MODERATE_CRASH, SENSOR_IMU, 5000200);
+    telemetry->state(MACHINE_CONFIRMER, CONFIRM_PENDING, CONFIRM_CONFIRMED, REASON_TILT, 1800, 5000300);
+    TelemetryStats stats;
+    memset(&stats, 0, sizeof(stats));
+    stats.uptimeMs = 5000;
+    stats.links = LINK_WIFI | LINK_UTC;
+    telemetry->stats(stats, 5000400);
+
+    uint8_t wire[1024];
+    size_t length = drainAll(wire, sizeof(wire));
+    TEST_ASSERT_EQUAL_UINT32(0, telemetry->getPending());
+    TEST_ASSERT_EQUAL_UINT8(0, wire[0]);
+    TEST_ASSERT_EQUAL_UINT8(0, wire[length - 1]);
+
+    TelemetryDecoder decoder;
+    decoder.feed(wire, length, collect, nullptr);
+    TEST_ASSERT_EQUAL_UINT64(4, decoder.records);
+    TEST_ASSERT_EQUAL_UINT64(0, decoder.badFrames);
+    TEST_ASSERT_EQUAL_INT(4, receivedCount);
+
+    TEST_ASSERT_EQUAL_UINT8(TELEMETRY_SAMPLE, received[0].type);
+    TEST_ASSERT_EQUAL_UINT64(5000123, received[0].micros);   // the sample's own time
+    TEST_ASSERT_EQUAL_FLOAT(-42.5f, received[0].sample.gyro[1]);
+    TEST_ASSERT_EQUAL_FLOAT(77.5946f, received[0].sample.longitude);
+    TEST_ASSERT_EQUAL_UINT8(SENSOR_ULTRASONIC, received[0].sample.missing);
+    TEST_ASSERT_EQUAL_UINT8(TELEMETRY_SCORE, received[1].type);
+    TEST_ASSERT_EQUAL_UINT8(7, received[1].score.score);
+    TEST_ASSERT_EQUAL_UINT8(MODERATE_CRASH, received[1].score.severity);
+    TEST_ASSERT_EQUAL_UINT8(TELEMETRY_STATE, received[2].type);
+    TEST_ASSERT_EQUAL_UINT8(CONFIRM_CONFIRMED, received[2].state.to);
+    TEST_ASSERT_EQUAL_UINT32(1800, received[2].state.detail);
+    TEST_ASSERT_EQUAL_UINT8(TELEMETRY_STATS, received[3].type);
+    TEST_ASSERT_EQUAL_UINT8(LINK_WIFI | LINK_UTC, received[3].stats.links);
+    TEST_ASSERT_EQUAL_UINT16(3, received[3].sequence);
+}
+
+void test_corrupt_frame_rejected(void) {
+    telemetry->score(3, 11, MINOR_CRASH, SENSOR_ALL, 100);
+    telemetry->score(4, 11, MINOR_CRASH, SENSOR_ALL, 200);
+    uint8_t wire[256];
+    size_t length = drainAll(wire, sizeof(wire));
+    wire[5] ^= 0x10;   // inside the first frame, and not to zero
+
+    TelemetryDecoder decoder;
+    decoder.feed(wire, length, collect, nullptr);
+    TEST_ASSERT_EQUAL_UINT64(1, decoder.records);
+    TEST_ASSERT_EQUAL_UINT64(1, decoder.badFrames);
+    TEST_ASSERT_EQUAL_UINT8(4, received[0].score.score);
+}
+
+void test_console_text_between_frames(void) {
+    telemetry->score(1, 11, NO_CRASH, SENSOR_ALL, 100);
+    uint8_t wire[256];
+    size_t length = drainAll(wire, sizeof(wire));
+    const char* text = "Impact dismissed: driving\r\nok\r\n";
+    memcpy(wire + length, text, strlen(text));
+    length += strlen(text);
+    telemetry->score(2, 11, NO_CRASH, SENSOR_ALL, 200);
+    length += drainAll(wire + length, sizeof(wire) - length);
+
+    // Fed a byte at a time, as from a serial port
+    TelemetryDecoder decoder;
+    for (size_t i = 0; i < length; i++) decoder.feed(wire + i, 1, collect, nullptr);
+    TEST_ASSERT_EQUAL_UINT64(2, decoder.records);
+    TEST_ASSERT_EQUAL_UINT64(2, decoder.textLines);
+    TEST_ASSERT_EQUAL_UINT64(0, decoder.badFrames);
+    TEST_ASSERT_EQUAL_INT(4, receivedCount);
+    TEST_ASSERT_EQUAL_UINT8(TELEMETRY_TEXT, received[1].type);
+    TEST_ASSERT_EQUAL_STRING("Impact dismissed: driving", receivedText[1]);
+    TEST_ASSERT_EQUAL_STRING("ok", receivedText[2]);
+    TEST_ASSERT_EQUAL_UINT8(2, received[3].score.score);
+}
+
+void test_full_ring_drops_whole_records(void) {
+    TelemetryStats stats;
+    memset(&stats, 0, sizeof(stats));
+    int accepted = 0;
+    for (int i = 0; i < 1000; i++) {
+        if (telemetry->record(TELEMETRY_STATS, &stats, sizeof(stats), i)) accepted++;
+    }
+    TEST_ASSERT_GREATER_THAN(0, accepted);
+    TEST_ASSERT_EQUAL_UINT32(1000 - accepted, telemetry->getDropped());
+    TEST_ASSERT_LESS_OR_EQUAL(TELEMETRY_RING_SIZE, telemetry->getPending());
+
+    // Send a few frames, then keep writing: the ring wraps early rather
+    // than splitting a frame, and peek never returns part of one
+    const uint8_t* data;
+    size_t frameSize = telemetry->peek(&data, TELEMETRY_MAX_FRAME);
+    size_t sent = telemetry->peek(&data, 100);
+    TEST_ASSERT_EQUAL_UINT32(3 * frameSize, sent);
+    TEST_ASSERT_EQUAL_UINT8(0, data[sent - 1]);
+    telemetry->consume(sent);
+    TEST_ASSERT_TRUE(telemetry->record(TELEMETRY_STATS, &stats, sizeof(stats), 1000));
+
+    TelemetryDecoder decoder;
+    size_t length;
+    while ((length = telemetry->peek(&data, 64)) > 0) {
+        decoder.feed(data, length, nullptr, nullptr);
+        telemetry->consume(length);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, telemetry->getPending());
+    TEST_ASSERT_EQUAL_UINT64(0, decoder.badFrames);
+    TEST_ASSERT_EQUAL_UINT64(accepted - 3 + 1, decoder.records);
+    TEST_ASSERT_EQUAL_UINT64(1000 - accepted, decoder.lostRecords);   // the dropped ones
+}
+
+void test_peek_stops_at_frame_boundary(void) {
+    telemetry->score(1, 11, NO_CRASH, SENSOR_ALL, 100);
+    const uint8_t* data;
+    size_t frame = telemetry->peek(&data, 1000);
+    telemetry->score(2, 11, NO_CRASH, SENSOR_ALL, 200);
+
+    TEST_ASSERT_EQUAL_UINT32(0, telemetry->peek(&data, frame - 1));   // not even one fits
+    TEST_ASSERT_EQUAL_UINT32(frame, telemetry->peek(&data, 2 * frame - 1));
+    TEST_ASSERT_EQUAL_UINT32(2 * frame, telemetry->peek(&data, 2 * frame));
+}
+
+static int evaluated;
+
+static int sideEffect(void) {
+    evaluated++;
+    return 1;
+}
+
+void test_levels_compiled_out(void) {
+    evaluated = 0;
+    TELEMETRY(TELEMETRY_LEVEL, telemetry->score(sideEffect(), 11, NO_CRASH, SENSOR_ALL, 0));
+    TELEMETRY(TELEMETRY_LEVEL + 1, telemetry->score(sideEffect(), 11, NO_CRASH, SENSOR_ALL, 0));
+    TEST_ASSERT_EQUAL_INT(1, evaluated);
+    TEST_ASSERT_EQUAL_UINT32(1, telemetry->getRecords());
+}
+
+void test_decoder_unwraps_time_and_counts_gaps(void) {
+    uint8_t wire[256];
+    size_t length = 0;
+    telemetry->score(1, 11, NO_CRASH, SENSOR_ALL, 0xFFFFFF00ULL);
+    length += drainAll(wire + length, sizeof(wire) - length);
+    telemetry->score(2, 11, NO_CRASH, SENSOR_ALL, 0x100000100ULL);   // dropped on the way
+    const uint8_t* data;
+    telemetry->consume(telemetry->peek(&data, 1000));
+    telemetry->score(3, 11, NO_CRASH, SENSOR_ALL, 0x100000200ULL);
+    length += drainAll(wire + length, sizeof(wire) - length);
+
+    TelemetryDecoder decoder;
+    decoder.feed(wire, length, collect, nullptr);
+    TEST_ASSERT_EQUAL_UINT64(2, decoder.records);
+    TEST_ASSERT_EQUAL_UINT64(1, decoder.lostRecords);
+    TEST_ASSERT_EQUAL_UINT64(0xFFFFFF00ULL, received[0].micros);
+    TEST_ASSERT_EQUAL_UINT64(0x100000200ULL, received[1].micros);
+}
+
+void test_format_records(void) {
+    TelemetryRecord record;
+    memset(&record, 0, sizeof(record));
+    char line[256];
+
+    record.type = TELEMETRY_STATE;
+    record.sequence = 9;
+    record.micros = 1234;
+    record.state.machine = MACHINE_CONFIRMER;
+    record.state.from = CONFIRM_IDLE;
+    record.state.to = CONFIRM_PENDING;
+    TEST_ASSERT_GREATER_THAN(0, formatTelemetryRecord(line, sizeof(line), record));
+    TEST_ASSERT_EQUAL_STRING("9,1234,confirmer,0,1,0,0", line);
+
+    record.type = TELEMETRY_TEXT;
+    record.text = "say \"hi\"";
+    record.textLength = strlen(record.text);
+    formatTelemetryRecord(line, sizeof(line), record);
+    TEST_ASSERT_EQUAL_STRING("9,1234,\"say \"\"hi\"\"\"", line);
+
+    // As many columns as the header, for every type
+    for (uint8_t type = TELEMETRY_SAMPLE; type < TELEMETRY_TYPE_COUNT; type++) {
+        record.type = type;
+        TEST_ASSERT_GREATER_THAN(0, formatTelemetryRecord(line, sizeof(line), record));
+        int commas = 0;
+        int headerCommas = 0;
+        for (const char* c = line; *c; c++) commas += *c == ',';
+        for (const char* c = telemetryCsvHeader(type); *c; c++) headerCommas += *c == ',';
+        TEST_ASSERT_EQUAL_INT(headerCommas, commas);
+    }
+    TEST_ASSERT_EQUAL_INT(0, formatTelemetryRecord(line, 4, record));
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_cobs_round_trip);
+    RUN_TEST(test_crc_matches_ccitt);
+    RUN_TEST(test_records_round_trip);
+    RUN_TEST(test_corrupt_frame_rejected);
+    RUN_TEST(test_console_text_between_frames);
+    RUN_TEST(test_full_ring_drops_whole_records);
+    RUN_TEST(test_peek_stops_at_frame_boundary);
+    RUN_TEST(test_levels_compiled_out);
+    RUN_TEST(test_decoder_unwraps_time_and_counts_gaps);
+    RUN_TEST(test_format_records);
+
+    return UNITY_END();
+}
+
+int main(void) {
+    return runUnityTests();
+}
@@ -0,0 +1,122 @@
+#include <unity.h>
+#include <string.h>
+#include <chrono>
+#include "config.h"
+#include "crash_detector.h"
+#include "hal.h"
+
+// Runs on the host against SimClock (build with -DHAL_SIM). Time only moves
+// through Clock::delay(), so the wraparound cases below are exact.
+
+static const uint64_t WRAP_MICROS = 4294967296ULL * 1000;  // 2^32 ms
+
+CrashDetector detector;
+CrashDetectionConfig testConfig;
+
+static SensorData quietReading(uint32_t timestamp) {
+    SensorData data;
+    memset(&data, 0, sizeof(data));
+    data.accelZ = 1.0;
+    data.distance = 100.0;
+    data.vibration = LOW;
+    data.timestamp = timestamp;
+    return data;
+}
+
+void setUp(void) {
+    SimClock::setMicros(0);
+    detector.begin(testConfig);
+}
+
+void tearDown(void) {
+    detector.resetCrashDetection();
+}
+
+void test_millis_wraps_like_esp32(void) {
+    SimClock::setMicros(WRAP_MICROS - 5000);
+    uint32_t before = Clock::millis();
+    TEST_ASSERT_EQUAL_UINT32(0xFFFFFFFBUL, before);
+
+    Clock::delay(20);
+    uint32_t after = Clock::millis();
+    TEST_ASSERT_EQUAL_UINT32(15, after);
+    TEST_ASSERT_EQUAL_UINT32(20, elapsedMillis(before, after));
+}
+
+void test_auto_reset_across_wrap(void) {
+    // Minor crash (score 4) detected 1 s before the counter wraps
+    SimClock::setMicros(WRAP_MICROS - 1000000);
+    SensorData impact = quietReading(Clock::millis());
+    impact.accelX = 3.5;
+    impact.accelY = 1.0;
+    impact.accelZ = 1.5;
+    impact.vibration = HIGH;
+
+    TEST_ASSERT_EQUAL(MINOR_CRASH, detector.detectCrash(impact));
+    TEST_ASSERT_TRUE(detector.isCrashDetected());
+
+    Clock::delay(4000);
+    TEST_ASSERT_FALSE(detector.shouldAutoReset());
+
+    Clock::delay(1100);
+    TEST_ASSERT_TRUE(detector.shouldAutoReset());
+}
+
+void test_jerk_across_wrap(void) {
+    // 2 g change over 40 ms straddling the wrap: jerk 50 g/s, score 2
+    SensorData previous = quietReading(0xFFFFFFECUL);
+    SensorData current = quietReading(0x00000014UL);
+    current.accelX = 2.0;
+    current.vibration = HIGH;
+
+    detector.addToHistory(quietReading(0xFFFFFF6CUL));
+    detector.addToHistory(previous);
+    TEST_ASSERT_EQUAL(MINOR_CRASH, detector.detectCrash(current));
+}
+
+void test_replay_hours_across_wrap(void) {
+    // Six virtual hours of the main loop schedule, centred on the wrap
+    const uint32_t replayMs = 6UL * 3600 * 1000;
+    SimClock::setMicros(WRAP_MICROS - (uint64_t)replayMs / 2 * 1000);
+    const uint64_t endMicros = SimClock::nowMicros() + (uint64_t)replayMs * 1000;
+
+    auto wallStart = std::chrono::steady_clock::now();
+    uint32_t lastSensorRead = Clock::millis() - SENSOR_READ_INTERVAL;
+    uint32_t samples = 0;
+    int detections = 0;
+
+    while (SimClock::nowMicros() < endMicros) {
+        uint32_t currentMillis = Clock::millis();
+        if (elapsedMillis(lastSensorRead, currentMillis) >= SENSOR_READ_INTERVAL) {
+            lastSensorRead = currentMillis;
+            SensorData data = quietReading(currentMillis);
+            detector.addToHistory(data);
+            if (detector.detectCrash(data) > NO_CRASH) detections++;
+            samples++;
+        }
+        Clock::delay(10);
+    }
+    double wallMs = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - wallStart).count();
+
+    // A stalled schedule at the wrap would drop samples; a spurious jerk
+    // spike would show up as a detection
+    TEST_ASSERT_EQUAL_UINT32(replayMs / SENSOR_READ_INTERVAL, samples);
+    TEST_ASSERT_EQUAL(0, detections);
+    TEST_ASSERT_TRUE(wallMs < 2000.0);
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_millis_wraps_like_esp32);
+    RUN_TEST(test_auto_reset_across_wrap);
+    RUN_TEST(test_jerk_across_wrap);
+    RUN_TEST(test_replay_hours_across_wrap);
+
+    return UNITY_END();
+}
+
+int main(void) {
+    return runUnityTests();
+}
@@ -0,0 +1,108 @@
+// Decoder for recordings of the BLE companion stream (see ble_stream.h).
+//
+// Input is the stream characteristic's notification payloads back to back,
+// as raw bytes (default), or as hex text with --hex: one notification per
+// line, either bare hex bytes or the "... value: 0a 1b ..." lines printed
+// by gatttool --listen and btmon. Reports frames, lost frames and the
+// sustained frame rate over the recording's sample time; --csv writes every
+// frame in engineering units.
+//
+//   ble_decoder [--hex] [--csv frames.csv] [recording | -]
+
+#include "ble_stream.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void writeFrame(const StreamFrame& frame, uint64_t sampleMicros, void* context) {
+  FILE* csv = (FILE*)context;
+  if (!csv) return;
+  fprintf(csv, "%u,%llu,%.3f,%.3f,%.3f,%.1f,%.1f,%.1f,%d,%u,%u,%u,%u\n", frame.sequence,
+          (unsigned long long)sampleMicros, frame.accelMg[0] / 1000.0, frame.accelMg[1] / 1000.0,
+          frame.accelMg[2] / 1000.0, frame.gyroDeciDps[0] / 10.0, frame.gyroDeciDps[1] / 10.0,
+          frame.gyroDeciDps[2] / 10.0, frame.distanceCm, frame.missing, frame.quality, frame.score,
+          frame.flags);
+}
+
+// Hex bytes in a line, after "value:" when there is one
+static size_t parseHexLine(const char* line, uint8_t* out, size_t size) {
+  const char* value = strstr(line, "value:");
+  const char* cursor = value ? value + 6 : line;
+  size_t length = 0;
+  while (*cursor && length < size) {
+    if (!isxdigit((unsigned char)cursor[0])) {
+      cursor++;
+      continue;
+    }
+    if (!isxdigit((unsigned char)cursor[1])) break;
+    char digits[3] = {cursor[0], cursor[1], '\0'};
+    out[length++] = (uint8_t)strtoul(digits, nullptr, 16);
+    cursor += 2;
+  }
+  return length;
+}
+
+int main(int argc, char** argv) {
+  bool hex = false;
+  const char* csvPath = nullptr;
+  const char* inputPath = "-";
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--hex")) hex = true;
+    else if (!strcmp(argv[i], "--csv") && i + 1 < argc) csvPath = argv[++i];
+    else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+      fprintf(stderr, "usage: ble_decoder [--hex] [--csv frames.csv] [recording | -]\n");
+      return 2;
+    } else inputPath = argv[i];
+  }
+
+  FILE* input = strcmp(inputPath, "-") ? fopen(inputPath, hex ? "r" : "rb") : stdin;
+  if (!input) {
+    fprintf(stderr, "ble_decoder: cannot read %s\n", inputPath);
+    return 1;
+  }
+  FILE* csv = nullptr;
+  if (csvPath) {
+    csv = fopen(csvPath, "w");
+    if (!csv) {
+      fprintf(stderr, "ble_decoder: cannot write %s\n", csvPath);
+      return 1;
+    }
+    fprintf(csv, "sequence,sample_us,accel_x_g,accel_y_g,accel_z_g,gyro_x_dps,gyro_y_dps,gyro_z_dps,"
+                 "distance_cm,missing,quality,score,flags\n");
+  }
+
+  StreamDecoder decoder;
+  uint64_t bytes = 0;
+  if (hex) {
+    char line[4096];
+    uint8_t payload[STREAM_MAX_PAYLOAD];
+    while (fgets(line, sizeof(line), input)) {
+      size_t length = parseHexLine(line, payload, sizeof(payload));
+      bytes += length;
+      decoder.feed(payload, length, writeFrame, csv);
+    }
+  } else {
+    uint8_t chunk[4096];
+    size_t length;
+    while ((length = fread(chunk, 1, sizeof(chunk), input)) > 0) {
+      bytes += length;
+      decoder.feed(chunk, length, writeFrame, csv);
+    }
+  }
+  if (input != stdin) fclose(input);
+  if (csv) fclose(csv);
+
+  double seconds = decoder.lastFrameMicros > decoder.firstMicros
+                       ? (decoder.lastFrameMicros - decoder.firstMicros) / 1e6 : 0.0;
+  printf("Bytes:         %llu (%llu skipped)\n", (unsigned long long)bytes,
+         (unsigned long long)decoder.skippedBytes);
+  printf("Notifications: %llu (%.1f frames each)\n", (unsigned long long)decoder.batches,
+         decoder.batches ? (double)decoder.frames / decoder.batches : 0.0);
+  printf("Frames:        %llu, %llu lost (%.2f%%)\n", (unsigned long long)decoder.frames,
+         (unsigned long long)decoder.lostFrames,
+         decoder.frames ? 100.0 * decoder.lostFrames / (decoder.frames + decoder.lostFrames) : 0.0);
+  printf("Sample time:   %.3f s\n", seconds);
+  printf("Sustained:     %.1f frames/s\n", decoder.getFramesPerSecond());
+  return decoder.frames ? 0 : 1;
+}
@@ -0,0 +1,208 @@
+// Benchmark: event log index on a file-backed flash image.
+//
+// Fills an image the size of the "events" partition with a synthetic event
+// stream (mostly near misses, the odd crash, a few a minute while driving),
+// wrapping the ring so pruning runs, then times:
+//
+//   append    records per second, with the erases and footers they cost
+//   mount     begin(): the directory from headers and footers, against
+//             reading the whole image as an index-less log would have to
+//   query     one-day windows and "severity >= moderate", through the
+//             directory against a scan of every slot; both must agree
+//
+// Build with -DEVENT_LOG_MAX_SEGMENTS=1024 (as the event_log_bench
+// environment does) so the directory covers the whole image.
+//
+//   event_log_bench [--image /tmp/event_log_bench.img] [--size-kb 1472]
+//                   [--fill 1.5] [--queries 200] [--seed 1]
+
+#include "config.h"
+#include "event_log.h"
+#include "sim_flash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+#define SECTOR 4096
+#define BASE_UTC 1700000000UL
+
+static uint32_t randomState;
+
+static uint32_t nextRandom() {
+  randomState = randomState * 1664525u + 1013904223u;
+  return randomState >> 8;
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// A reading the detector scored: 1-2 points and no crash nine times in ten
+static EventRecord syntheticEvent(uint32_t utc) {
+  SensorData data;
+  memset(&data, 0, sizeof(data));
+  uint32_t roll = nextRandom() % 1000;
+  int severity = roll < 900 ? NO_CRASH : roll < 970 ? MINOR_CRASH : roll < 995 ? MODERATE_CRASH : SEVERE_CRASH;
+  int score = severity == NO_CRASH ? 1 + nextRandom() % 2 : 3 + severity * 2;
+  data.accelX = (nextRandom() % 4000) / 1000.0f;
+  data.accelZ = 1.0f;
+  data.gyroX = (nextRandom() % 3000) / 10.0f;
+  data.distance = 50.0f + nextRandom() % 300;
+  data.latitude = 12.9716f;
+  data.longitude = 77.5946f;
+  data.timestamp = (utc - BASE_UTC) * 1000;
+  EventRecord record = makeEventRecord(EVENT_SCORED, data, severity, score, SENSOR_ALL);
+  record.utcSeconds = utc;
+  return record;
+}
+
+static bool matchesQuery(const EventRecord& record, const EventQuery& query) {
+  if (record.severity < query.minSeverity || record.score < query.minScore) return false;
+  if (record.utcSeconds == 0) return query.fromUtc == 0;
+  return record.utcSeconds >= query.fromUtc && record.utcSeconds <= query.toUtc;
+}
+
+// Without the directory: every record slot of every sector
+static uint32_t scanQuery(SimFlash& flash, uint32_t sectors, const EventQuery& query) {
+  static uint8_t sector[SECTOR];
+  uint32_t matched = 0;
+  for (uint32_t s = 0; s < sectors; s++) {
+    if (!flash.read(s * SECTOR, sector, SECTOR)) break;
+    for (uint32_t slot = 1; slot + 1 < SECTOR / EVENT_RECORD_SIZE; slot++) {
+      const EventRecord* record = (const EventRecord*)(sector + slot * EVENT_RECORD_SIZE);
+      if (record->sequence == 0xFFFFFFFF) break;
+      if (matchesQuery(*record, query) && isValidEventRecord(*record)) matched++;
+    }
+  }
+  return matched;
+}
+
+int main(int argc, char** argv) {
+  const char* imagePath = "/tmp/event_log_bench.img";
+  uint32_t sizeKb = 1472;   // the "events" partition in partitions.csv
+  double fill = 1.5;
+  uint32_t queries = 200;
+  randomState = 1;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "--image")) imagePath = argv[i + 1];
+    else if (!strcmp(argv[i], "--size-kb")) sizeKb = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "--fill")) fill = atof(argv[i + 1]);
+    else if (!strcmp(argv[i], "--queries")) queries = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "--seed")) randomState = strtoul(argv[i + 1], nullptr, 10);
+  }
+
+  remove(imagePath);
+  SimFlash flash(sizeKb * 1024, SECTOR);
+  if (!flash.open(imagePath)) {
+    fprintf(stderr, "event_log_bench: cannot open %s\n", imagePath);
+    return 1;
+  }
+  EventLog* eventLog = new EventLog();
+  if (!eventLog->begin(&flash, flash.size())) {
+    fprintf(stderr, "event_log_bench: cannot mount the image\n");
+    return 1;
+  }
+  uint32_t sectors = eventLog->getSegmentCount();
+  uint32_t capacity = sectors * eventLog->getRecordsPerSegment();
+  uint32_t records = (uint32_t)(capacity * fill);
+  printf("Image %s: %u KB, %u segments of %u records (%u records), directory %zu bytes\n",
+         imagePath, sizeKb, sectors, eventLog->getRecordsPerSegment(), capacity,
+         sizeof(EventSegmentSummary) * sectors);
+  if (sectors * SECTOR < flash.size()) {
+    printf("  only %u segments indexed: rebuild with a larger EVENT_LOG_MAX_SEGMENTS\n", sectors);
+  }
+
+  // Append, one event every 20 s on average
+  uint32_t utc = BASE_UTC;
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < records; i++) {
+    utc += 1 + nextRandom() % 40;
+    EventRecord record = syntheticEvent(utc);
+    eventLog->append(record);
+  }
+  double appendSeconds = secondsSince(start);
+  uint32_t lastUtc = utc;
+  printf("\nappend  %u records in %.3f s (%.0f records/s), %u erases, %u segments pruned\n",
+         records, appendSeconds, records / appendSeconds, flash.erases, eventLog->getPrunedSegments());
+
+  // Mount from the directory, against reading every byte
+  delete eventLog;
+  eventLog = new EventLog();
+  flash.resetCounters();
+  start = std::chrono::steady_clock::now();
+  eventLog->begin(&flash, flash.size());
+  double mountSeconds = secondsSince(start);
+  uint64_t mountBytes = flash.bytesRead;
+  flash.resetCounters();
+  start = std::chrono::steady_clock::now();
+  scanQuery(flash, sectors, EventQuery());
+  double scanSeconds = secondsSince(start);
+  printf("mount   %8.1f us, %7.1f KB read   (full scan %8.1f us, %7.1f KB)\n",
+         mountSeconds * 1e6, mountBytes / 1024.0, scanSeconds * 1e6, flash.bytesRead / 1024.0);
+
+  // Queries: one-day windows over what is still held, and the severe ones
+  const EventSegmentSummary* oldest = nullptr;
+  for (uint32_t s = 0; s < sectors; s++) {
+    const EventSegmentSummary* segment = eventLog->getSegment(s);
+    if (segment && (!oldest || segment->sequence < oldest->sequence)) oldest = segment;
+  }
+  uint32_t firstUtc = oldest ? oldest->minUtc : BASE_UTC;
+  std::vector<EventQuery> workload;
+  for (uint32_t q = 0; q < queries; q++) {
+    EventQuery query;
+    if (q % 4 == 3) {
+      query.minSeverity = MODERATE_CRASH;
+    } else {
+      query.fromUtc = firstUtc + nextRandom() % (lastUtc - firstUtc + 1);
+      query.toUtc = query.fromUtc + 86399;
+    }
+    workload.push_back(query);
+  }
+
+  printf("\n%-10s %8s %9s %9s %8s %9s %9s %8s\n", "query", "matched", "index us", "index KB", "reads",
+         "scan us", "scan KB", "reads");
+  const char* names[2] = {"one day", "severe"};
+  for (int kind = 0; kind < 2; kind++) {
+    uint64_t matched = 0;
+    uint64_t indexBytes = 0;
+    uint64_t scanBytes = 0;
+    uint64_t indexReads = 0;
+    uint64_t scanReads = 0;
+    double indexSeconds = 0.0;
+    double scanSeconds = 0.0;
+    uint32_t count = 0;
+    for (uint32_t q = 0; q < queries; q++) {
+      if ((q % 4 == 3) != (kind == 1)) continue;
+      count++;
+      flash.resetCounters();
+      start = std::chrono::steady_clock::now();
+      uint32_t indexed = eventLog->query(workload[q], nullptr, nullptr);
+      indexSeconds += secondsSince(start);
+      indexBytes += flash.bytesRead;
+      indexReads += flash.readCalls;
+
+      flash.resetCounters();
+      start = std::chrono::steady_clock::now();
+      uint32_t scanned = scanQuery(flash, sectors, workload[q]);
+      scanSeconds += secondsSince(start);
+      scanBytes += flash.bytesRead;
+      scanReads += flash.readCalls;
+      if (indexed != scanned) {
+        fprintf(stderr, "event_log_bench: query %u: index %u, scan %u records\n", q, indexed, scanned);
+        return 1;
+      }
+      matched += indexed;
+    }
+    if (count == 0) continue;
+    printf("%-10s %8.1f %9.1f %9.1f %8.1f %9.1f %9.1f %8.1f\n", names[kind], (double)matched / count,
+           indexSeconds * 1e6 / count, indexBytes / 1024.0 / count, (double)indexReads / count,
+           scanSeconds * 1e6 / count, scanBytes / 1024.0 / count, (double)scanReads / count);
+  }
+  printf("\nPer query, averaged. Host times are mostly CRC checks and one syscall per read;\n"
+         "on the ESP32 SPI flash transfers dominate, so compare KB read and reads.\n");
+
+  delete eventLog;
+  return 0;
+}
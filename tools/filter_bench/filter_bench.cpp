@@ -0,0 +1,125 @@
+// Microbenchmark: pre-filter cost in ns per sample per axis.
+//
+// Times the configurations the sensor filter can run on one axis (float
+// and fixed-point biquad cascades of growing length) and the jerk
+// differentiators (two-point difference and Savitzky-Golay FIRs). A full
+// SensorFilter pass is six axes of the cascade.
+//
+//   filter_bench [--samples 20000000] [--rate-hz 1000]
+
+#include "dsp_filter.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+static volatile float sinkFloat;
+static volatile int32_t sinkFixed;
+
+// Engine-like tone plus broadband noise around 1 g
+static std::vector<float> makeSignal(size_t count, float rateHz) {
+  std::vector<float> signal(count);
+  uint32_t state = 1;
+  for (size_t n = 0; n < count; n++) {
+    state = state * 1664525UL + 1013904223UL;
+    float noise = ((state >> 8) / 16777216.0f - 0.5f) * 0.2f;
+    signal[n] = 1.0f + 0.3f * sinf(2.0f * 3.14159265f * 45.0f * n / rateHz) + noise;
+  }
+  return signal;
+}
+
+template <typename Body>
+static double nanosPerSample(size_t count, Body body) {
+  auto start = std::chrono::steady_clock::now();
+  body();
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+         count;
+}
+
+static void buildCascade(int sections, float rateHz, BiquadCascade& cascade,
+                         BiquadCascadeFixed& fixed) {
+  cascade.clear();
+  fixed.clear();
+  int added = 0;
+  if (sections >= 3) {
+    BiquadCoefficients highPass = designHighPass(0.5f, rateHz, butterworthQ(2, 0));
+    BiquadCoefficients notch = designNotch(45.0f, rateHz, 5.0f);
+    cascade.add(highPass);
+    fixed.add(highPass);
+    cascade.add(notch);
+    fixed.add(notch);
+    added = 2;
+  }
+  int order = 2 * (sections - added);
+  for (int i = 0; i < order / 2; i++) {
+    BiquadCoefficients lowPass = designLowPass(rateHz / 10.0f, rateHz, butterworthQ(order, i));
+    cascade.add(lowPass);
+    fixed.add(lowPass);
+  }
+}
+
+int main(int argc, char** argv) {
+  size_t samples = 20000000;
+  float rateHz = 1000.0f;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "--samples")) samples = strtoul(argv[i + 1], nullptr, 10);
+    else if (!strcmp(argv[i], "--rate-hz")) rateHz = atof(argv[i + 1]);
+  }
+
+  std::vector<float> signal = makeSignal(samples, rateHz);
+  std::vector<int32_t> counts(samples);
+  for (size_t n = 0; n < samples; n++) counts[n] = (int32_t)lrintf(signal[n] * 4096.0f * 4096.0f);
+
+  printf("%-34s %10s\n", "stage (one axis)", "ns/sample");
+
+  const int sectionCounts[] = {1, 2, 4, 6};
+  const char* names[] = {"low-pass 2nd order", "low-pass 4th order",
+                         "high-pass + notch + low-pass 4th", "high-pass + notch + low-pass 8th"};
+  for (int k = 0; k < 4; k++) {
+    BiquadCascade cascade;
+    BiquadCascadeFixed fixed;
+    buildCascade(sectionCounts[k], rateHz, cascade, fixed);
+
+    double floatNs = nanosPerSample(samples, [&]() {
+      float last = 0;
+      for (size_t n = 0; n < samples; n++) last = cascade.process(signal[n]);
+      sinkFloat = last;
+    });
+    double fixedNs = nanosPerSample(samples, [&]() {
+      int32_t last = 0;
+      for (size_t n = 0; n < samples; n++) last = fixed.process(counts[n]);
+      sinkFixed = last;
+    });
+    printf("%-34s %10.2f  float\n", names[k], floatNs);
+    printf("%-34s %10.2f  fixed\n", names[k], fixedNs);
+  }
+
+  double differenceNs = nanosPerSample(samples, [&]() {
+    float previous = 0, last = 0;
+    for (size_t n = 0; n < samples; n++) {
+      last = (signal[n] - previous) * rateHz;
+      previous = signal[n];
+    }
+    sinkFloat = last;
+  });
+  printf("%-34s %10.2f\n", "jerk: two-point difference", differenceNs);
+
+  const int windows[] = {5, 9, 15};
+  for (int window : windows) {
+    float weights[FILTER_MAX_TAPS];
+    savitzkyGolayDerivative(window, 1, weights);
+    FirFilter derivative;
+    derivative.setTaps(weights, window);
+    double firNs = nanosPerSample(samples, [&]() {
+      float last = 0;
+      for (size_t n = 0; n < samples; n++) last = derivative.process(signal[n]) * rateHz;
+      sinkFloat = last;
+    });
+    char name[64];
+    snprintf(name, sizeof(name), "jerk: Savitzky-Golay %d taps", window);
+    printf("%-34s %10.2f\n", name, firNs);
+  }
+  return 0;
+}
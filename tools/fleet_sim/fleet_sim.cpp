@@ -0,0 +1,493 @@
+// Fleet simulator: runs thousands of virtual units of the real firmware
+// (Firmware::setup() and loop(), as src/main.cpp runs them) on Linux.
+//
+// Hardware is provided by the shims in sim/include, bound per thread to a
+// SimDevice with its own virtual clock, so each unit runs as fast as the CPU
+// allows while seeing exactly the timing the firmware would (blocking
+// ultrasonic pings, GPS UART polling, RTDB round trips, delay()).
+//
+// Each unit gets a seeded scenario (normal drive, pothole, crash, rollover,
+// door slam, dropped unit) or replays a recorded trace; the simulator only
+// reads the results off each unit between loop() passes.
+//
+//   fleet_sim [--devices 1000] [--duration-s 120] [--threads N] [--seed 1]
+//             [--mix normal:pothole:crash:rollover[:doorslam:dropped]]
+//             [--rtdb-latency-ms 120] [--sampling edge|poll]
+//             [--trace drive.csv] [--echo INDEX] [--min-sampling PERCENT]
+//
+// --sampling poll runs the loop as it was before data-ready sampling (poll
+// millis(), delay(10), MPU at 1 kHz) to compare sample jitter and how much
+// of the time the loop task is awake.
+//
+// --min-sampling exits with status 1 if any unit took less than that share
+// of its samples, e.g. 100 to check that RTDB writes, crash confirmation
+// included, never cost a sample at the given latency.
+
+#include <Arduino.h>
+#include "config.h"
+#include "firmware.h"
+#include "hal.h"
+#include "scenario.h"
+#include "sim_device.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Sample spacing histogram: 250 us bins up to four periods, the last bin
+// holds everything longer
+#define SPACING_BIN_US 250
+#define SPACING_BINS (4 * SENSOR_READ_INTERVAL * 1000 / SPACING_BIN_US + 1)
+
+struct UnitResult {
+  ScenarioType scenario;
+  uint32_t eventTimeMs;
+  int64_t firstDetectionMs;   // -1 when never detected
+  int64_t firstConfirmMs;     // -1 when never confirmed
+  int64_t confirmDelayMs;     // first confirmation after its trigger
+  int maxSeverity;            // confirmed
+  uint32_t detections;        // detector firings: pre-warnings, and drops dismissed at once
+  uint32_t confirmations;
+  uint32_t emergencyAlerts;
+  uint64_t samples;
+  uint64_t lostSamples;       // periods between consecutive samples without one
+  uint64_t rtdbWrites;
+  uint64_t simulatedMs;
+  int64_t armedMs;            // boot timeline: detection armed, -1 if never
+  int64_t cloudMs;            // Firebase authenticated, -1 if never
+  bool bootInOrder;
+  uint32_t suspensions;       // supervised steps suspended for overrunning
+  uint32_t eventsLogged;      // records in the event log at the end
+  uint32_t nearMisses;        // of them, scored readings below a crash
+  uint64_t loopMicros;        // time spent in loop()
+  uint64_t idleMicros;        // of it, asleep in delay() or on a notification
+  uint32_t wakeups;
+  uint32_t spacing[SPACING_BINS];   // between consecutive sample times
+  RateTaskStats sources[SENSOR_SOURCE_COUNT];   // per sensor, not polling
+};
+
+// One unit: its hardware and the firmware running on it
+struct VirtualUnit {
+  SimDevice device;
+  ResetRecord resetRecord;
+  Firmware firmware;
+};
+
+struct SimOptions {
+  unsigned devices = 1000;
+  unsigned durationSeconds = 120;
+  unsigned threads = 0;
+  uint32_t seed = 1;
+  unsigned mix[6] = {1, 1, 1, 1, 1, 1};
+  uint32_t rtdbLatencyMs = 120;
+  long echoIndex = -1;
+  bool pollSampling = false;
+  double minSampling = 0;
+  std::string tracePath;
+};
+
+static ScenarioType pickScenario(const SimOptions& options, uint32_t index) {
+  unsigned total = 0;
+  for (unsigned share : options.mix) total += share;
+  unsigned slot = index % (total ? total : 1);
+  for (int type = 0; type < 6; type++) {
+    if (slot < options.mix[type]) return (ScenarioType)type;
+    slot -= options.mix[type];
+  }
+  return SCENARIO_NORMAL_DRIVE;
+}
+
+static bool countNearMiss(const EventRecord& record, void* context) {
+  if (record.kind == EVENT_SCORED && record.severity == NO_CRASH) (*(uint32_t*)context)++;
+  return true;
+}
+
+static UnitResult runUnit(const SimOptions& options, uint32_t index, const RecordedTrace* trace) {
+  std::unique_ptr<VirtualUnit> unit(new VirtualUnit());
+  const uint32_t durationMs = options.durationSeconds * 1000;
+  const uint32_t seed = options.seed * 2654435761u + index;
+
+  Scenario scenario = trace ? makeRecordedScenario(*trace, seed, (seed % trace->sampleCount) * trace->periodMs)
+                            : makeScenario(pickScenario(options, index), seed, durationMs);
+  simInitDevice(unit->device, index, scenario);
+  unit->device.rtdbLatencyMs = options.rtdbLatencyMs;
+  unit->device.echoSerial = (options.echoIndex == (long)index);
+  simSetCurrentDevice(&unit->device);
+
+  UnitResult result;
+  memset(&result, 0, sizeof(result));
+  result.scenario = scenario.type;
+  result.eventTimeMs = scenario.eventTimeMs;
+  result.bootInOrder = true;
+  result.firstDetectionMs = -1;
+  result.firstConfirmMs = -1;
+  result.confirmDelayMs = -1;
+  result.armedMs = -1;
+  result.cloudMs = -1;
+
+  Firmware& firmware = unit->firmware;
+  firmware.pollSampling = options.pollSampling;
+  if (!firmware.setup(&unit->resetRecord, RESET_POWER_ON)) {
+    unit.reset();
+    simSetCurrentDevice(nullptr);
+    return result;
+  }
+  // The IMU as it was configured before data-ready sampling: 1 kHz
+  if (options.pollSampling) unit->device.mpuRateDivider = 0;
+  uint64_t loopStartMicros = Clock::micros64();
+  uint64_t loopStartIdle = unit->device.taskIdleMicros;
+  uint32_t loopStartWakeups = unit->device.taskWakeups;
+  uint64_t lastSampleMicros = 0;
+
+  while (Clock::nowMicros() / 1000 < durationMs) {
+    firmware.loop();
+    const LoopPass& pass = firmware.getLastPass();
+    if (!pass.sampled) continue;
+
+    const SensorData& data = firmware.currentData;
+    result.samples++;
+    if (data.sampleMicros) {
+      if (lastSampleMicros) {
+        uint64_t gap = data.sampleMicros - lastSampleMicros;
+        uint64_t bin = gap / SPACING_BIN_US;
+        result.spacing[bin < SPACING_BINS ? bin : SPACING_BINS - 1]++;
+        uint64_t periods = (gap + SENSOR_READ_INTERVAL * 500) / (SENSOR_READ_INTERVAL * 1000);
+        if (periods > 1) result.lostSamples += periods - 1;
+      }
+      lastSampleMicros = data.sampleMicros;
+    }
+    if (pass.newDetection) {
+      result.detections++;
+      if (result.firstDetectionMs < 0) result.firstDetectionMs = data.timestamp;
+    }
+    if (pass.confirmEvent == CONFIRM_ESCALATE) {
+      const CrashConfirmer& confirmer = firmware.crashConfirmer;
+      result.confirmations++;
+      if (result.firstConfirmMs < 0) {
+        result.firstConfirmMs = data.timestamp;
+        result.confirmDelayMs = elapsedMillis(confirmer.getTriggerMs(), confirmer.getDecisionMs());
+      }
+      result.maxSeverity = std::max(result.maxSeverity, confirmer.getSeverity());
+    }
+  }
+
+  result.emergencyAlerts = unit->device.emergencyAlerts;
+  result.rtdbWrites = unit->device.rtdbWrites;
+  result.simulatedMs = Clock::nowMicros() / 1000;
+  result.idleMicros = unit->device.taskIdleMicros - loopStartIdle;
+  result.wakeups = unit->device.taskWakeups - loopStartWakeups;
+  result.loopMicros = Clock::micros64() - loopStartMicros;
+  for (int source = 0; source < SENSOR_SOURCE_COUNT; source++) {
+    result.sources[source] = firmware.sources.getStats(source);
+  }
+  const BootTimeline& boot = firmware.bootTimeline;
+  if (boot.isReached(BOOT_ARMED)) result.armedMs = boot.getMillis(BOOT_ARMED);
+  if (boot.isReached(BOOT_CLOUD)) result.cloudMs = boot.getMillis(BOOT_CLOUD);
+  result.bootInOrder = boot.isInOrder();
+  for (int task = 0; task < HEALTH_TASK_COUNT; task++) {
+    result.suspensions += firmware.health.getSuspensions((HealthTask)task);
+  }
+  if (firmware.eventLogReady) {
+    result.eventsLogged = firmware.eventLog.getRecordCount();
+    firmware.eventLog.query(EventQuery(), countNearMiss, &result.nearMisses);
+  }
+  // Detaches the unit's interrupts from its own device
+  unit.reset();
+  simSetCurrentDevice(nullptr);
+  return result;
+}
+
+// CSV: t_ms,accelX,accelY,accelZ,gyroX,gyroY,gyroZ,distance,vibration,lat,lon
+static bool loadTrace(const std::string& path, std::vector<SimMotion>& samples, uint32_t& periodMs) {
+  FILE* file = fopen(path.c_str(), "r");
+  if (!file) return false;
+
+  char line[512];
+  double firstTime = -1;
+  double secondTime = -1;
+  while (fgets(line, sizeof(line), file)) {
+    SimMotion motion;
+    double timeMs;
+    int fields = sscanf(line, "%lf,%f,%f,%f,%f,%f,%f,%f,%d,%lf,%lf", &timeMs,
+                        &motion.accelX, &motion.accelY, &motion.accelZ,
+                        &motion.gyroX, &motion.gyroY, &motion.gyroZ,
+                        &motion.distance, &motion.vibration,
+                        &motion.latitude, &motion.longitude);
+    if (fields < 9) continue; // header or malformed
+    if (fields < 11) motion.latitude = motion.longitude = 0.0;
+    if (firstTime < 0) firstTime = timeMs;
+    else if (secondTime < 0) secondTime = timeMs;
+    samples.push_back(motion);
+  }
+  fclose(file);
+
+  periodMs = (secondTime > firstTime) ? (uint32_t)(secondTime - firstTime) : 10;
+  if (periodMs == 0) periodMs = 1;
+  return !samples.empty();
+}
+
+static double percentile(std::vector<double>& values, double fraction) {
+  if (values.empty()) return 0.0;
+  std::sort(values.begin(), values.end());
+  size_t index = (size_t)(fraction * (values.size() - 1) + 0.5);
+  return values[index];
+}
+
+// Lower edge of the histogram bin holding that fraction of the samples, ms
+static double spacingPercentile(const std::vector<uint64_t>& histogram, double fraction) {
+  uint64_t total = 0;
+  for (uint64_t count : histogram) total += count;
+  if (total == 0) return 0.0;
+  uint64_t rank = (uint64_t)(fraction * (total - 1) + 0.5);
+  uint64_t seen = 0;
+  for (size_t bin = 0; bin < histogram.size(); bin++) {
+    seen += histogram[bin];
+    if (seen > rank) return bin * SPACING_BIN_US / 1000.0;
+  }
+  return (histogram.size() - 1) * SPACING_BIN_US / 1000.0;
+}
+
+// Share of the whole sample periods a unit ran for that got a sample,
+// percent: lost edges as well as a polled loop drifting late
+static double sampledShare(const UnitResult& result) {
+  uint64_t periods = std::max(result.samples + result.lostSamples,
+                              result.loopMicros / (SENSOR_READ_INTERVAL * 1000));
+  return periods ? 100.0 * result.samples / periods : 100.0;
+}
+
+// True when every unit took at least options.minSampling of its samples
+static bool printReport(const SimOptions& options, const std::vector<UnitResult>& results,
+                        double wallSeconds, unsigned threads) {
+  uint64_t samples = 0;
+  uint64_t lostSamples = 0;
+  double worstSampling = 100.0;
+  unsigned belowMinimum = 0;
+  uint64_t simulatedMs = 0;
+  uint64_t rtdbWrites = 0;
+  unsigned outOfOrder = 0;
+  unsigned degraded = 0;
+  uint64_t eventsLogged = 0;
+  uint64_t nearMisses = 0;
+  uint64_t loopMicros = 0;
+  uint64_t idleMicros = 0;
+  uint64_t wakeups = 0;
+  std::vector<uint64_t> spacing(SPACING_BINS, 0);
+  RateTaskStats sourceTotals[SENSOR_SOURCE_COUNT];
+  memset(sourceTotals, 0, sizeof(sourceTotals));
+  std::vector<double> armed, cloud;
+  for (const UnitResult& result : results) {
+    samples += result.samples;
+    lostSamples += result.lostSamples;
+    worstSampling = std::min(worstSampling, sampledShare(result));
+    if (sampledShare(result) < options.minSampling) belowMinimum++;
+    simulatedMs += result.simulatedMs;
+    rtdbWrites += result.rtdbWrites;
+    if (!result.bootInOrder) outOfOrder++;
+    if (result.suspensions) degraded++;
+    eventsLogged += result.eventsLogged;
+    nearMisses += result.nearMisses;
+    loopMicros += result.loopMicros;
+    idleMicros += result.idleMicros;
+    wakeups += result.wakeups;
+    for (int bin = 0; bin < SPACING_BINS; bin++) spacing[bin] += result.spacing[bin];
+    for (int source = 0; source < SENSOR_SOURCE_COUNT; source++) {
+      RateTaskStats& total = sourceTotals[source];
+      const RateTaskStats& stats = result.sources[source];
+      total.runs += stats.runs;
+      total.overruns += stats.overruns;
+      total.deadlineMisses += stats.deadlineMisses;
+      total.skipped += stats.skipped;
+      if (stats.maxRunMicros > total.maxRunMicros) total.maxRunMicros = stats.maxRunMicros;
+      if (stats.maxResponseMicros > total.maxResponseMicros) total.maxResponseMicros = stats.maxResponseMicros;
+    }
+    if (result.armedMs >= 0) armed.push_back((double)result.armedMs);
+    if (result.cloudMs >= 0) cloud.push_back((double)result.cloudMs);
+  }
+
+  printf("\n=== Fleet simulation ===\n");
+  printf("Devices:            %u (%u threads)\n", options.devices, threads);
+  printf("Simulated per unit: %u s\n", options.durationSeconds);
+  printf("Wall time:          %.2f s\n", wallSeconds);
+  printf("Simulated time:     %.1f device-hours (%.0fx real time)\n",
+         simulatedMs / 3.6e6, simulatedMs / 1000.0 / wallSeconds);
+  printf("Sensor samples:     %llu (%.0f samples/s)\n",
+         (unsigned long long)samples, samples / wallSeconds);
+  printf("RTDB writes:        %llu (%.1f per device-minute)\n",
+         (unsigned long long)rtdbWrites, rtdbWrites / (simulatedMs / 60000.0));
+  printf("Boot to armed:      p50 %.0f ms, p95 %.0f ms (%zu units)\n",
+         percentile(armed, 0.5), percentile(armed, 0.95), armed.size());
+  printf("Boot to cloud:      p50 %.0f ms, p95 %.0f ms (%zu units)\n",
+         percentile(cloud, 0.5), percentile(cloud, 0.95), cloud.size());
+  printf("Event log:          %llu records (%.1f per device-minute), %llu near misses\n",
+         (unsigned long long)eventsLogged, eventsLogged / (simulatedMs / 60000.0),
+         (unsigned long long)nearMisses);
+  double nominal = loopMicros / (SENSOR_READ_INTERVAL * 1000.0);
+  printf("Sampling:           %s, %.1f%% of the nominal %d ms samples taken\n",
+         options.pollSampling ? "polled" : "MPU data ready", nominal > 0 ? 100.0 * samples / nominal : 0.0,
+         SENSOR_READ_INTERVAL);
+  printf("Samples lost:       %llu (%.2f%% of the periods), worst unit took %.2f%%\n",
+         (unsigned long long)lostSamples, samples ? 100.0 * lostSamples / (samples + lostSamples) : 0.0,
+         worstSampling);
+  printf("Sample spacing:     p1 %.2f ms, p50 %.2f ms, p99 %.2f ms, max %.2f ms\n",
+         spacingPercentile(spacing, 0.01), spacingPercentile(spacing, 0.5), spacingPercentile(spacing, 0.99),
+         spacingPercentile(spacing, 1.0));
+  printf("Loop task:          awake %.1f%% of the time, %.1f wakeups/s\n",
+         loopMicros ? 100.0 * (loopMicros - idleMicros) / loopMicros : 0.0,
+         loopMicros ? wakeups / (loopMicros / 1e6) : 0.0);
+  if (!options.pollSampling) {
+    static const char* const sourceNames[] = {"imu", "ultrasonic", "gps"};
+    static const int sourcePeriods[] = {SENSOR_READ_INTERVAL, ULTRASONIC_PERIOD_MS, GPS_PERIOD_MS};
+    for (int source = 0; source < SENSOR_SOURCE_COUNT; source++) {
+      const RateTaskStats& total = sourceTotals[source];
+      printf("Source %-11s every %3d ms: %.2f%% late, %.2f%% over budget, %.2f%% skipped, max run %.1f ms, "
+             "max response %.1f ms\n", sourceNames[source], sourcePeriods[source],
+             total.runs ? 100.0 * total.deadlineMisses / total.runs : 0.0,
+             total.runs ? 100.0 * total.overruns / total.runs : 0.0,
+             total.runs + total.skipped ? 100.0 * total.skipped / (total.runs + total.skipped) : 0.0,
+             total.maxRunMicros / 1000.0, total.maxResponseMicros / 1000.0);
+    }
+  }
+  if (outOfOrder) printf("Boot out of order:  %u units\n", outOfOrder);
+  if (degraded) printf("Tasks suspended:    %u units\n", degraded);
+  if (options.minSampling > 0) {
+    printf("Sampling check:     %s, %u units below %.2f%% at %lu ms RTDB latency\n", belowMinimum ? "FAILED" : "passed",
+           belowMinimum, options.minSampling, (unsigned long)options.rtdbLatencyMs);
+  }
+
+  printf("\n%-10s %6s %9s %9s %7s %7s %7s %7s %8s %8s %9s %7s\n", "scenario", "runs", "detected",
+         "confirmed", "rate", "minor", "mod", "severe", "lat p50", "lat p95", "delay p95", "alerts");
+  for (int type = 0; type < SCENARIO_TYPE_COUNT; type++) {
+    unsigned runs = 0;
+    unsigned detected = 0;
+    unsigned confirmed = 0;
+    unsigned bySeverity[4] = {0, 0, 0, 0};
+    uint64_t alerts = 0;
+    std::vector<double> latencies, delays;
+
+    for (const UnitResult& result : results) {
+      if (result.scenario != type) continue;
+      runs++;
+      alerts += result.emergencyAlerts;
+      bySeverity[result.maxSeverity & 3]++;
+      if (result.firstDetectionMs >= 0) detected++;
+      if (result.firstConfirmMs >= 0) {
+        confirmed++;
+        delays.push_back((double)result.confirmDelayMs);
+        if (scenarioExpectsCrash((ScenarioType)type) &&
+            result.firstConfirmMs >= (int64_t)result.eventTimeMs) {
+          latencies.push_back((double)(result.firstConfirmMs - result.eventTimeMs));
+        }
+      }
+    }
+    if (runs == 0) continue;
+
+    char p50[16] = "-";
+    char p95[16] = "-";
+    char delay[16] = "-";
+    if (!latencies.empty()) {
+      snprintf(p50, sizeof(p50), "%.0fms", percentile(latencies, 0.5));
+      snprintf(p95, sizeof(p95), "%.0fms", percentile(latencies, 0.95));
+    }
+    if (!delays.empty()) snprintf(delay, sizeof(delay), "%.0fms", percentile(delays, 0.95));
+    printf("%-10s %6u %9u %9u %6.1f%% %7u %7u %7u %8s %8s %9s %7llu\n",
+           scenarioName((ScenarioType)type), runs, detected, confirmed, 100.0 * confirmed / runs,
+           bySeverity[MINOR_CRASH], bySeverity[MODERATE_CRASH], bySeverity[SEVERE_CRASH],
+           p50, p95, delay, (unsigned long long)alerts);
+  }
+  printf("\nDetected units had the detector fire (an alert before confirmation), confirmed\n"
+         "ones sent an emergency alert. Latency is impact to confirmation, delay what\n"
+         "confirmation added. Confirmations outside crash/rollover are false alarms;\n"
+         "crash/rollover units not confirmed are missed.\n");
+  return belowMinimum == 0;
+}
+
+static bool parseOptions(int argc, char** argv, SimOptions& options) {
+  for (int i = 1; i < argc; i++) {
+    if (i + 1 >= argc) {
+      fprintf(stderr, "fleet_sim: missing value for %s\n", argv[i]);
+      return false;
+    }
+    const char* value = argv[++i];
+    if (!strcmp(argv[i - 1], "--devices")) options.devices = atoi(value);
+    else if (!strcmp(argv[i - 1], "--duration-s")) options.durationSeconds = atoi(value);
+    else if (!strcmp(argv[i - 1], "--threads")) options.threads = atoi(value);
+    else if (!strcmp(argv[i - 1], "--seed")) options.seed = strtoul(value, nullptr, 10);
+    else if (!strcmp(argv[i - 1], "--rtdb-latency-ms")) options.rtdbLatencyMs = atoi(value);
+    else if (!strcmp(argv[i - 1], "--echo")) options.echoIndex = atol(value);
+    else if (!strcmp(argv[i - 1], "--trace")) options.tracePath = value;
+    else if (!strcmp(argv[i - 1], "--min-sampling")) options.minSampling = atof(value);
+    else if (!strcmp(argv[i - 1], "--sampling")) {
+      if (strcmp(value, "edge") && strcmp(value, "poll")) {
+        fprintf(stderr, "fleet_sim: --sampling expects edge or poll\n");
+        return false;
+      }
+      options.pollSampling = !strcmp(value, "poll");
+    }
+    else if (!strcmp(argv[i - 1], "--mix")) {
+      // Four shares leave out the door slam and dropped-unit scenarios
+      options.mix[4] = options.mix[5] = 0;
+      int shares = sscanf(value, "%u:%u:%u:%u:%u:%u", &options.mix[0], &options.mix[1],
+                          &options.mix[2], &options.mix[3], &options.mix[4], &options.mix[5]);
+      if (shares != 4 && shares != 6) {
+        fprintf(stderr, "fleet_sim: --mix expects normal:pothole:crash:rollover[:doorslam:dropped]\n");
+        return false;
+      }
+    } else {
+      fprintf(stderr, "fleet_sim: unknown option %s\n", argv[i - 1]);
+      return false;
+    }
+  }
+  return options.devices > 0 && options.durationSeconds > 0;
+}
+
+int main(int argc, char** argv) {
+  SimOptions options;
+  if (!parseOptions(argc, argv, options)) return 2;
+
+  std::vector<SimMotion> traceSamples;
+  RecordedTrace trace;
+  const RecordedTrace* tracePointer = nullptr;
+  if (!options.tracePath.empty()) {
+    if (!loadTrace(options.tracePath, traceSamples, trace.periodMs)) {
+      fprintf(stderr, "fleet_sim: cannot read trace %s\n", options.tracePath.c_str());
+      return 1;
+    }
+    trace.sampleCount = traceSamples.size();
+    trace.samples = traceSamples.data();
+    tracePointer = &trace;
+  }
+
+  unsigned threads = options.threads ? options.threads : std::thread::hardware_concurrency();
+  if (threads == 0) threads = 1;
+
+  std::vector<UnitResult> results(options.devices);
+  std::atomic<uint32_t> nextUnit(0);
+  std::atomic<uint32_t> finished(0);
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> pool;
+  for (unsigned t = 0; t < threads; t++) {
+    pool.emplace_back([&]() {
+      uint32_t index;
+      while ((index = nextUnit++) < options.devices) {
+        results[index] = runUnit(options, index, tracePointer);
+        finished++;
+      }
+    });
+  }
+
+  while (finished < options.devices) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    fprintf(stderr, "\rfleet_sim: %u/%u units", finished.load(), options.devices);
+  }
+  for (auto& thread : pool) {
+    thread.join();
+  }
+  fprintf(stderr, "\n");
+  double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  return printReport(options, results, wallSeconds, threads) ? 0 : 1;
+}
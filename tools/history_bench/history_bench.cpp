@@ -0,0 +1,175 @@
+// Microbenchmark: sensor history scans, array-of-structs versus columns.
+//
+// The legacy layout is the one CrashDetector used before SensorHistory: a
+// heap SensorData[] ring indexed with %. Each depth is timed on three
+// operations the detector or a high-rate feature pass performs:
+//
+//   push      append one reading
+//   run       walk back from the newest reading while |accel| is over a
+//             threshold (every reading is over it, so the walk covers the
+//             whole depth: calculateConsecutiveHighReadings at its worst)
+//   window    count readings over an |accel| and a |gyro| threshold
+//             across the whole history (a high-rate feature pass)
+//
+// Build with -fno-math-errno (as the history_bench environment does) so
+// sqrtf does not block vectorisation of the column loops.
+//
+//   history_bench [--iterations-scale 1.0]
+
+#include "config.h"
+#include "sensor_history.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <memory>
+
+static volatile float sink;
+
+class LegacyHistory {
+private:
+  SensorData* entries;
+  int size;
+  int currentIndex;
+
+public:
+  explicit LegacyHistory(int depth) : entries(new SensorData[depth]), size(depth), currentIndex(0) {
+    memset(entries, 0, sizeof(SensorData) * depth);
+  }
+  ~LegacyHistory() { delete[] entries; }
+
+  void push(const SensorData& data) {
+    entries[currentIndex] = data;
+    currentIndex = (currentIndex + 1) % size;
+  }
+
+  int run(float threshold) const {
+    int count = 0;
+    for (int i = 0; i < size; i++) {
+      const SensorData& entry = entries[(currentIndex - i - 1 + size) % size];
+      float magnitude = sqrtf(entry.accelX * entry.accelX + entry.accelY * entry.accelY +
+                              entry.accelZ * entry.accelZ);
+      if (magnitude <= threshold) break;
+      count++;
+    }
+    return count;
+  }
+
+  int window(float accelThreshold, float gyroThreshold) const {
+    int count = 0;
+    for (int i = 0; i < size; i++) {
+      const SensorData& entry = entries[i];
+      count += sqrtf(entry.accelX * entry.accelX + entry.accelY * entry.accelY +
+                     entry.accelZ * entry.accelZ) > accelThreshold;
+      count += sqrtf(entry.gyroX * entry.gyroX + entry.gyroY * entry.gyroY +
+                     entry.gyroZ * entry.gyroZ) > gyroThreshold;
+    }
+    return count;
+  }
+};
+
+template <uint32_t Depth>
+static int columnRun(const SensorHistory<Depth>& history, float threshold) {
+  const float* ax = history.accelX();
+  const float* ay = history.accelY();
+  const float* az = history.accelZ();
+  int count = 0;
+  for (uint32_t back = 1; back <= Depth; back++) {
+    uint32_t idx = history.slot(back);
+    float magnitude = sqrtf(ax[idx] * ax[idx] + ay[idx] * ay[idx] + az[idx] * az[idx]);
+    if (magnitude <= threshold) break;
+    count++;
+  }
+  return count;
+}
+
+// Order does not matter for a count, so the columns are read straight
+template <uint32_t Depth>
+static int columnWindow(const SensorHistory<Depth>& history, float accelThreshold,
+                        float gyroThreshold) {
+  const float* ax = history.accelX();
+  const float* ay = history.accelY();
+  const float* az = history.accelZ();
+  const float* gx = history.gyroX();
+  const float* gy = history.gyroY();
+  const float* gz = history.gyroZ();
+  int count = 0;
+  for (uint32_t i = 0; i < Depth; i++) {
+    count += sqrtf(ax[i] * ax[i] + ay[i] * ay[i] + az[i] * az[i]) > accelThreshold;
+  }
+  for (uint32_t i = 0; i < Depth; i++) {
+    count += sqrtf(gx[i] * gx[i] + gy[i] * gy[i] + gz[i] * gz[i]) > gyroThreshold;
+  }
+  return count;
+}
+
+static SensorData reading(uint32_t n) {
+  SensorData data;
+  memset(&data, 0, sizeof(data));
+  data.accelX = 0.5f + (n % 7) * 0.01f;
+  data.accelY = 0.1f;
+  data.accelZ = 1.0f;
+  data.gyroX = 2.0f;
+  data.gyroY = (n % 5) * 0.5f;
+  data.gyroZ = 1.0f;
+  data.distance = 150.0f;
+  data.timestamp = n * 10;
+  data.sampleMicros = (uint64_t)n * 10000;
+  return data;
+}
+
+template <typename Body>
+static double nanosPer(uint32_t iterations, Body body) {
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < iterations; i++) body(i);
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+         iterations;
+}
+
+template <uint32_t Depth>
+static void benchDepth(double scale) {
+  // Roughly the same number of slots touched at every depth
+  uint32_t scans = (uint32_t)(scale * 4e7 / Depth) + 1;
+  uint32_t pushes = (uint32_t)(scale * 2e7) + 1;
+
+  LegacyHistory legacy(Depth);
+  std::unique_ptr<SensorHistory<Depth>> columns(new SensorHistory<Depth>());
+  for (uint32_t n = 0; n < Depth; n++) {
+    legacy.push(reading(n));
+    columns->push(reading(n));
+  }
+
+  double legacyPush = nanosPer(pushes, [&](uint32_t n) { legacy.push(reading(n)); });
+  double columnPush = nanosPer(pushes, [&](uint32_t n) { columns->push(reading(n)); });
+
+  float result = 0;
+  double legacyRun = nanosPer(scans, [&](uint32_t) { result += legacy.run(0.5f); });
+  double columnRun_ = nanosPer(scans, [&](uint32_t) { result += columnRun(*columns, 0.5f); });
+  double legacyWindow = nanosPer(scans, [&](uint32_t) { result += legacy.window(1.1f, 2.5f); });
+  double columnWindow_ = nanosPer(scans, [&](uint32_t) { result += columnWindow(*columns, 1.1f, 2.5f); });
+  sink = result;
+
+  printf("%6u  %-6s %8.1f %8.1f %6.2fx\n", Depth, "push", legacyPush, columnPush,
+         legacyPush / columnPush);
+  printf("%6u  %-6s %8.1f %8.1f %6.2fx\n", Depth, "run", legacyRun, columnRun_,
+         legacyRun / columnRun_);
+  printf("%6u  %-6s %8.1f %8.1f %6.2fx\n", Depth, "window", legacyWindow, columnWindow_,
+         legacyWindow / columnWindow_);
+}
+
+int main(int argc, char** argv) {
+  double scale = 1.0;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "--iterations-scale")) scale = atof(argv[i + 1]);
+  }
+
+  printf("SensorData %zu bytes, hot columns %zu bytes per reading\n", sizeof(SensorData),
+         6 * sizeof(float) + sizeof(uint32_t) + sizeof(uint64_t));
+  printf(" depth  op       legacy  columns speedup   (ns per call)\n");
+  benchDepth<16>(scale);
+  benchDepth<256>(scale);
+  benchDepth<4096>(scale);
+  benchDepth<65536>(scale);
+  return 0;
+}
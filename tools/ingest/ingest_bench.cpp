@@ -0,0 +1,594 @@
+// Load benchmark for the ingestion stand-in, over its TCP front end.
+//
+// Forks an IngestServer onto a loopback port in a child process, so each
+// side of the 10,000 connections has its own descriptor limit, and connects
+// a fleet of simulated FirebaseManager clients to it, one keep-alive
+// connection each as a unit holds one session. Every send interval a client
+// issues what FirebaseManager::sendSensorData() does: one PUT per sensor
+// field (DevicePaths PATH_ACCEL_X .. PATH_TIMESTAMP) with the bare value as
+// the body, the ID token in the query and print=silent, each written on its
+// own without waiting for the reply. A small fraction first sends what a
+// confirmed crash queues: the emergency alert object, then crashStatus and
+// emergencyActive.
+//
+// --batch N sends the same data the batched way instead: the frames of N
+// intervals as one PATCH of the sensors node, keyed by timestamp, and each
+// alert as a POST to the emergency node.
+//
+// Connections are plain HTTP: on the road a TLS-terminating proxy sits in
+// front of the server (see ingest_server.h), and its cost is not measured.
+//
+//   ingest_bench [--clients 10000] [--seconds 10] [--threads N]
+//                [--workers N] [--interval-ms 5000] [--batch N]
+//                [--store DIR] [--keep]
+//
+// --interval-ms 0 sends back to back to find the server's ceiling.
+
+#include "config.h"
+#include "device_paths.h"
+#include "ingest_server.h"
+#include "ingest_service.h"
+#include "ingest_store.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <ftw.h>
+#include <math.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+// An anonymous user's Firebase ID token (a signed JWT) is about this long;
+// the client sends it as ?auth= on every request
+#define ID_TOKEN_LENGTH 940
+
+// The fields sendSensorData() writes, in its order
+static const DevicePath SENSOR_FIELDS[] = {
+  PATH_ACCEL_X, PATH_ACCEL_Y, PATH_ACCEL_Z, PATH_GYRO_X, PATH_GYRO_Y, PATH_GYRO_Z,
+  PATH_DISTANCE, PATH_VIBRATION, PATH_LATITUDE, PATH_LONGITUDE,
+  PATH_CRASH_SEVERITY, PATH_CRASH_DETECTED, PATH_TIMESTAMP,
+};
+static const unsigned SENSOR_FIELD_COUNT = sizeof(SENSOR_FIELDS) / sizeof(SENSOR_FIELDS[0]);
+
+static char idToken[ID_TOKEN_LENGTH + 1];
+
+struct SimulatedClient {
+  DevicePaths paths;
+  SensorData data;
+  unsigned long timestamp;
+  uint32_t rng;
+  int fd;
+  uint64_t nextSendUs;
+  std::string frames;        // --batch: frames not yet sent, as object members
+  unsigned frameCount;
+  unsigned framesDue;        // sent at this count; fewer the first time, to stagger the fleet
+};
+
+// What the bench threads add up
+struct BenchTotals {
+  std::atomic<uint64_t> requests;
+  std::atomic<uint64_t> acknowledged;  // 2xx replies, read while running
+  std::atomic<uint64_t> failures;
+  std::atomic<uint64_t> uploads;
+  std::atomic<uint64_t> lateUploads;   // started over an interval behind
+  BenchTotals() : requests(0), acknowledged(0), failures(0), uploads(0), lateUploads(0) {}
+};
+
+// What the server process reports once stopped
+struct ServerReport {
+  uint64_t records;
+  uint64_t bytes;
+  uint64_t rejected;
+  uint64_t writeErrors;
+};
+
+struct ServerProcess {
+  pid_t pid;
+  int control;   // closed to stop the server
+  int report;    // the port, then a ServerReport
+  int port;
+};
+
+static uint32_t nextRandom(uint32_t& state) {
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+static float randomUnit(uint32_t& state) {
+  return (nextRandom(state) & 0xFFFF) / 65535.0f;
+}
+
+static uint64_t monotonicUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static int connectClient(int port) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) return -1;
+  sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons(port);
+  if (connect(fd, (sockaddr*)&address, sizeof(address)) < 0) {
+    close(fd);
+    return -1;
+  }
+  int noDelay = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+  return fd;
+}
+
+static void initClient(SimulatedClient& client, unsigned index) {
+  // Espressif OUI with the client index in the NIC-specific bytes
+  uint64_t mac = 0x24 | (0xA1ULL << 8) | (0x60ULL << 16) |
+                 ((uint64_t)(index & 0xFF) << 40) |
+                 ((uint64_t)((index >> 8) & 0xFF) << 32) |
+                 ((uint64_t)((index >> 16) & 0xFF) << 24);
+  client.paths.begin(mac);
+
+  memset(&client.data, 0, sizeof(client.data));
+  client.data.accelZ = 1.0f;
+  client.data.distance = 150.0f;
+  client.data.latitude = 12.9716f + index * 1e-5f;
+  client.data.longitude = 77.5946f;
+  client.timestamp = 1700000000UL;
+  client.rng = 0x9E3779B9u ^ (index * 2654435761u);
+  client.fd = -1;
+  client.frameCount = 0;
+}
+
+static bool sendAll(int fd, const char* data, size_t length) {
+  while (length > 0) {
+    ssize_t sent = send(fd, data, length, MSG_NOSIGNAL);
+    if (sent < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    data += sent;
+    length -= sent;
+  }
+  return true;
+}
+
+static bool readAll(int fd, void* data, size_t length) {
+  char* bytes = (char*)data;
+  while (length > 0) {
+    ssize_t received = read(fd, bytes, length);
+    if (received < 0 && errno == EINTR) continue;
+    if (received <= 0) return false;
+    bytes += received;
+    length -= received;
+  }
+  return true;
+}
+
+// Run the server in a child process until the parent closes the control
+// pipe; the child reports its port once listening and its counts at exit
+static bool startServerProcess(ServerProcess& server, const std::string& storeDir, unsigned workerCount) {
+  int control[2];
+  int report[2];
+  if (pipe(control) < 0 || pipe(report) < 0) return false;
+  fflush(stdout);
+  server.pid = fork();
+  if (server.pid < 0) return false;
+
+  if (server.pid == 0) {
+    close(control[1]);
+    close(report[0]);
+    IngestStore store(storeDir, 60, 64);
+    IngestService service(store);
+    IngestServer listener(service);
+    int port = (store.begin() && listener.start(0, workerCount)) ? listener.getPort() : -1;
+    if (write(report[1], &port, sizeof(port)) != sizeof(port) || port < 0) _exit(1);
+
+    char byte;
+    while (read(control[0], &byte, 1) < 0 && errno == EINTR) {
+    }
+    listener.stop();
+    store.flush();
+    ServerReport counts = {store.getRecordCount(), store.getByteCount(),
+                           service.getRejectedCount(), store.getWriteErrors()};
+    _exit(write(report[1], &counts, sizeof(counts)) == sizeof(counts) ? 0 : 1);
+  }
+
+  close(control[0]);
+  close(report[1]);
+  server.control = control[1];
+  server.report = report[0];
+  return readAll(server.report, &server.port, sizeof(server.port)) && server.port > 0;
+}
+
+static bool stopServerProcess(ServerProcess& server, ServerReport& counts) {
+  close(server.control);
+  bool reported = readAll(server.report, &counts, sizeof(counts));
+  close(server.report);
+  int status = 0;
+  waitpid(server.pid, &status, 0);
+  return reported && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+// One RTDB REST write as the client puts it on the wire
+static bool sendWrite(int fd, std::string& request, const char* method, const char* path,
+                      const char* body, size_t bodyLength) {
+  char header[160];
+  request.clear();
+  request.append(method).append(" /").append(path).append(".json?auth=").append(idToken, ID_TOKEN_LENGTH);
+  request.append("&print=silent HTTP/1.1\r\nHost: localhost\r\nUser-Agent: ESP\r\n");
+  int headerLength = snprintf(header, sizeof(header),
+                              "Connection: keep-alive\r\nKeep-Alive: timeout=30, max=100\r\n"
+                              "Content-Length: %zu\r\n\r\n", bodyLength);
+  request.append(header, headerLength).append(body, bodyLength);
+  return sendAll(fd, request.data(), request.size());
+}
+
+// Read until that many replies are in; counts the ones that are not 2xx.
+// input keeps bytes past the last reply between calls.
+static bool readReplies(int fd, std::string& input, unsigned expected, uint64_t& rejected) {
+  char buffer[4096];
+  while (expected > 0) {
+    size_t headerEnd = input.find("\r\n\r\n");
+    if (headerEnd != std::string::npos) {
+      int status = atoi(input.c_str() + 9);   // "HTTP/1.1 204 ..."
+      size_t contentLength = 0;
+      size_t field = input.find("Content-Length:");
+      if (field != std::string::npos && field < headerEnd) contentLength = strtoul(input.c_str() + field + 15, nullptr, 10);
+      if (input.size() >= headerEnd + 4 + contentLength) {
+        if (status < 200 || status >= 300) rejected++;
+        input.erase(0, headerEnd + 4 + contentLength);
+        expected--;
+        continue;
+      }
+    }
+    ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+    if (received < 0 && errno == EINTR) continue;
+    if (received <= 0) return false;
+    input.append(buffer, received);
+  }
+  return true;
+}
+
+// A sensor field's value as sendSensorData() writes it
+static int formatField(char* body, size_t bodySize, DevicePath field, const SensorData& data,
+                       bool crash, unsigned long timestamp) {
+  switch (field) {
+    case PATH_ACCEL_X: return snprintf(body, bodySize, "%.6g", data.accelX);
+    case PATH_ACCEL_Y: return snprintf(body, bodySize, "%.6g", data.accelY);
+    case PATH_ACCEL_Z: return snprintf(body, bodySize, "%.6g", data.accelZ);
+    case PATH_GYRO_X: return snprintf(body, bodySize, "%.6g", data.gyroX);
+    case PATH_GYRO_Y: return snprintf(body, bodySize, "%.6g", data.gyroY);
+    case PATH_GYRO_Z: return snprintf(body, bodySize, "%.6g", data.gyroZ);
+    case PATH_DISTANCE: return snprintf(body, bodySize, "%.6g", data.distance);
+    case PATH_VIBRATION: return snprintf(body, bodySize, "%d", data.vibration);
+    case PATH_LATITUDE: return snprintf(body, bodySize, "%.6g", data.latitude);
+    case PATH_LONGITUDE: return snprintf(body, bodySize, "%.6g", data.longitude);
+    case PATH_CRASH_SEVERITY: return snprintf(body, bodySize, "%d", crash ? MODERATE_CRASH : NO_CRASH);
+    case PATH_CRASH_DETECTED: return snprintf(body, bodySize, "%s", crash ? "true" : "false");
+    default: return snprintf(body, bodySize, "%lu", timestamp);
+  }
+}
+
+// Add this interval's frame to the client's batch: "<timestamp>":{fields},
+// named by the last component of each field's path
+static void appendFrame(SimulatedClient& client, bool crash) {
+  char text[32];
+  int length = snprintf(text, sizeof(text), "%s\"%lu\":{", client.frameCount ? "," : "", client.timestamp);
+  client.frames.append(text, length);
+  for (unsigned field = 0; field < SENSOR_FIELD_COUNT; field++) {
+    const char* path = client.paths.get(SENSOR_FIELDS[field]);
+    client.frames.append(field ? ",\"" : "\"").append(strrchr(path, '/') + 1).append("\":");
+    length = formatField(text, sizeof(text), SENSOR_FIELDS[field], client.data, crash, client.timestamp);
+    client.frames.append(text, length);
+  }
+  client.frames.append("}");
+  client.frameCount++;
+}
+
+// One send interval for one client; returns requests issued. batch 0 sends
+// each field on its own, as the firmware does.
+static unsigned runClientTick(SimulatedClient& client, unsigned batch, std::string& request,
+                              std::string& input, uint64_t& rejected, uint64_t& failures) {
+  char body[320];
+  char path[DEVICE_PATH_SIZE];
+  unsigned sent = 0;
+  SensorData& data = client.data;
+  data.accelX = (randomUnit(client.rng) - 0.5f) * 0.4f;
+  data.accelY = (randomUnit(client.rng) - 0.5f) * 0.4f;
+  data.accelZ = 1.0f + (randomUnit(client.rng) - 0.5f) * 0.2f;
+  data.gyroX = (randomUnit(client.rng) - 0.5f) * 20.0f;
+  data.gyroY = (randomUnit(client.rng) - 0.5f) * 20.0f;
+  data.gyroZ = (randomUnit(client.rng) - 0.5f) * 20.0f;
+  data.distance = 50.0f + randomUnit(client.rng) * 300.0f;
+  client.timestamp += FIREBASE_SEND_INTERVAL / 1000;
+
+  // Roughly one confirmed crash per 2000 uploads across the fleet: what
+  // FirebaseManager::flushPending() sends, ahead of the upload
+  bool crash = (nextRandom(client.rng) % 2000) == 0;
+  if (crash) {
+    float accelMagnitude = 6.5f;
+    int length = snprintf(body, sizeof(body),
+                          "{\"timestamp\":%lu,\"severity\":%d,\"latitude\":%.6f,\"longitude\":%.6f,"
+                          "\"accelMagnitude\":%.2f,\"gyroMagnitude\":%.2f,\"distance\":%.1f,"
+                          "\"vibration\":%d,\"sensors\":%d}",
+                          client.timestamp, MODERATE_CRASH, data.latitude, data.longitude,
+                          accelMagnitude, 180.0, data.distance, 1, 7);
+    if (batch) {
+      snprintf(path, sizeof(path), "%s%s/%.*s", FB_DEVICES_ROOT, client.paths.getDeviceId(),
+               (int)sizeof(FB_EMERGENCY_PATH) - 2, FB_EMERGENCY_PATH);
+      sent += sendWrite(client.fd, request, "POST", path, body, length);
+    } else {
+      client.paths.formatEmergencyPath(path, sizeof(path), client.timestamp);
+      sent += sendWrite(client.fd, request, "PUT", path, body, length);
+    }
+    sent += sendWrite(client.fd, request, "PUT", client.paths.get(PATH_CRASH_STATUS), "2", 1);
+    sent += sendWrite(client.fd, request, "PUT", client.paths.get(PATH_EMERGENCY_ACTIVE), "true", 4);
+  }
+
+  if (batch) {
+    appendFrame(client, crash);
+    if (client.frameCount >= client.framesDue) {
+      client.frames.insert(0, "{").append("}");
+      sent += sendWrite(client.fd, request, "PATCH", client.paths.get(PATH_SENSORS),
+                        client.frames.data(), client.frames.size());
+      client.frames.clear();
+      client.frameCount = 0;
+      client.framesDue = batch;
+    }
+  } else {
+    // sendSensorData(): setFloat/setInt/setBool per field
+    for (unsigned field = 0; field < SENSOR_FIELD_COUNT; field++) {
+      int length = formatField(body, sizeof(body), SENSOR_FIELDS[field], data, crash, client.timestamp);
+      sent += sendWrite(client.fd, request, "PUT", client.paths.get(SENSOR_FIELDS[field]), body, length);
+    }
+  }
+
+  if (!readReplies(client.fd, input, sent, rejected)) {
+    failures++;
+    close(client.fd);
+    client.fd = -1;
+  }
+  return sent;
+}
+
+// Drive clients [first, last) until running clears
+static void runBenchThread(std::vector<SimulatedClient>& clients, size_t first, size_t last,
+                           uint64_t intervalUs, unsigned batch, std::atomic<bool>& running,
+                           BenchTotals& totals, std::vector<uint32_t>& latencies) {
+  std::string request;
+  std::string input;
+  uint64_t requests = 0;
+  uint64_t rejected = 0;
+  uint64_t failures = 0;
+  uint64_t uploads = 0;
+  uint64_t late = 0;
+  while (running) {
+    // Clients are staggered evenly over the interval, so they fall due in order
+    bool any = false;
+    for (size_t c = first; c < last && running; c++) {
+      SimulatedClient& client = clients[c];
+      if (client.fd < 0) continue;
+      any = true;
+      uint64_t now = monotonicUs();
+      if (intervalUs) {
+        if (client.nextSendUs > now) {
+          std::this_thread::sleep_for(std::chrono::microseconds(client.nextSendUs - now));
+          now = monotonicUs();
+        } else if (now - client.nextSendUs > intervalUs) {
+          late++;
+        }
+        client.nextSendUs += intervalUs;
+      }
+      input.clear();
+      uint64_t rejectedBefore = rejected;
+      unsigned sent = runClientTick(client, batch, request, input, rejected, failures);
+      requests += sent;
+      uploads++;
+      if (sent == 0) continue;
+      totals.acknowledged += sent - (rejected - rejectedBefore);
+      latencies.push_back((uint32_t)std::min<uint64_t>(monotonicUs() - now, UINT32_MAX));
+    }
+    if (!any) break;
+  }
+  totals.requests += requests;
+  totals.failures += failures + rejected;
+  totals.uploads += uploads;
+  totals.lateUploads += late;
+}
+
+static int removeEntry(const char* path, const struct stat*, int, struct FTW*) {
+  return remove(path);
+}
+
+static double percentileMs(std::vector<uint32_t>& values, double fraction) {
+  if (values.empty()) return 0.0;
+  size_t index = (size_t)(fraction * (values.size() - 1) + 0.5);
+  std::nth_element(values.begin(), values.begin() + index, values.end());
+  return values[index] / 1000.0;
+}
+
+int main(int argc, char** argv) {
+  unsigned clientCount = 10000;
+  double seconds = 10.0;
+  unsigned threadCount = std::thread::hardware_concurrency();
+  unsigned workerCount = std::thread::hardware_concurrency();
+  unsigned intervalMs = FIREBASE_SEND_INTERVAL;
+  unsigned batch = 0;
+  std::string storeDir;
+  bool keep = false;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--keep")) { keep = true; continue; }
+    if (i + 1 >= argc) {
+      fprintf(stderr, "ingest_bench: missing value for %s\n", argv[i]);
+      return 2;
+    }
+    if (!strcmp(argv[i], "--clients")) clientCount = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--seconds")) seconds = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--threads")) threadCount = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--workers")) workerCount = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--interval-ms")) intervalMs = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--batch")) batch = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--store")) storeDir = argv[++i];
+    else {
+      fprintf(stderr, "ingest_bench: unknown option %s\n", argv[i]);
+      return 2;
+    }
+  }
+  if (threadCount == 0) threadCount = 1;
+  if (workerCount == 0) workerCount = 1;
+  if (clientCount == 0) clientCount = 1;
+
+  // One end of every connection in each process; the server's child
+  // inherits the raised limit
+  rlimit files;
+  getrlimit(RLIMIT_NOFILE, &files);
+  files.rlim_cur = files.rlim_max;
+  setrlimit(RLIMIT_NOFILE, &files);
+  unsigned maxClients = files.rlim_cur > 64 ? (unsigned)(files.rlim_cur - 64) : 1;
+  if (clientCount > maxClients) {
+    fprintf(stderr, "ingest_bench: %u clients need %u descriptors per process; running %u\n",
+            clientCount, clientCount + 64, maxClients);
+    clientCount = maxClients;
+  }
+  threadCount = std::min(threadCount, clientCount);
+
+  if (storeDir.empty()) {
+    char tempDir[] = "/tmp/ingest-bench-XXXXXX";
+    if (!mkdtemp(tempDir)) {
+      perror("ingest_bench: mkdtemp");
+      return 1;
+    }
+    storeDir = tempDir;
+  }
+
+  // Before any thread is started, so the child is a clean copy
+  ServerProcess server;
+  if (!startServerProcess(server, storeDir, workerCount)) {
+    fprintf(stderr, "ingest_bench: cannot start the server with a store at %s\n", storeDir.c_str());
+    return 1;
+  }
+
+  for (int i = 0; i < ID_TOKEN_LENGTH; i++) {
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+    idToken[i] = (i % 300 == 299) ? '.' : alphabet[(i * 37) % 64];
+  }
+
+  uint64_t intervalUs = (uint64_t)intervalMs * 1000;
+  std::vector<SimulatedClient> clients(clientCount);
+  for (unsigned i = 0; i < clientCount; i++) {
+    initClient(clients[i], i);
+    clients[i].framesDue = batch ? 1 + i % batch : 0;
+    clients[i].fd = connectClient(server.port);
+    if (clients[i].fd < 0) {
+      perror("ingest_bench: connect");
+      return 1;
+    }
+  }
+  uint64_t firstSend = monotonicUs();
+  for (unsigned t = 0; t < threadCount; t++) {
+    size_t first = (size_t)clientCount * t / threadCount;
+    size_t last = (size_t)clientCount * (t + 1) / threadCount;
+    for (size_t c = first; c < last; c++) {
+      clients[c].nextSendUs = firstSend + intervalUs * (c - first) / (last - first);
+    }
+  }
+
+  char mode[48];
+  if (batch) {
+    snprintf(mode, sizeof(mode), "%u frames per PATCH", batch);
+  } else {
+    snprintf(mode, sizeof(mode), "a PUT per field");
+  }
+  printf("ingest_bench: %u clients over loopback HTTP to %u workers in pid %d, %u threads, "
+         "every %u ms, %s, %.1f s, store %s\n",
+         clientCount, workerCount, (int)server.pid, threadCount, intervalMs, mode, seconds,
+         storeDir.c_str());
+
+  std::atomic<bool> running(true);
+  BenchTotals totals;
+  std::vector<std::vector<uint32_t>> latencies(threadCount);
+  std::vector<std::thread> threads;
+
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned t = 0; t < threadCount; t++) {
+    size_t first = (size_t)clientCount * t / threadCount;
+    size_t last = (size_t)clientCount * (t + 1) / threadCount;
+    threads.emplace_back(runBenchThread, std::ref(clients), first, last, intervalUs, batch,
+                         std::ref(running), std::ref(totals), std::ref(latencies[t]));
+  }
+
+  // Sample once per second so a sustained rate is visible, not just an
+  // average; the store is in the other process, so count acknowledged writes
+  std::vector<double> perSecond;
+  uint64_t lastAcknowledged = 0;
+  auto lastSample = start;
+  while (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() < seconds) {
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    auto now = std::chrono::steady_clock::now();
+    uint64_t acknowledged = totals.acknowledged.load();
+    double elapsed = std::chrono::duration<double>(now - lastSample).count();
+    perSecond.push_back((acknowledged - lastAcknowledged) / elapsed);
+    printf("  t=%5.1fs  %10.0f writes/s\n",
+           std::chrono::duration<double>(now - start).count(), perSecond.back());
+    fflush(stdout);
+    lastAcknowledged = acknowledged;
+    lastSample = now;
+  }
+  running = false;
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  for (SimulatedClient& client : clients) {
+    if (client.fd >= 0) close(client.fd);
+  }
+  ServerReport report;
+  memset(&report, 0, sizeof(report));
+  if (!stopServerProcess(server, report)) {
+    fprintf(stderr, "ingest_bench: the server process did not report\n");
+    totals.failures++;
+  }
+
+  std::vector<uint32_t> all;
+  for (auto& thread : latencies) all.insert(all.end(), thread.begin(), thread.end());
+  std::sort(perSecond.begin(), perSecond.end());
+  printf("\nrequests      %llu (%llu failed, %llu rejected, %llu write errors)\n",
+         (unsigned long long)totals.requests.load(), (unsigned long long)totals.failures.load(),
+         (unsigned long long)report.rejected, (unsigned long long)report.writeErrors);
+  printf("writes        %llu in %.2f s  = %.0f writes/s, %.0f uploads/s\n",
+         (unsigned long long)report.records, elapsed, report.records / elapsed,
+         totals.uploads.load() / elapsed);
+  printf("bytes         %.1f MB stored  = %.1f MB/s\n",
+         report.bytes / 1e6, report.bytes / 1e6 / elapsed);
+  if (!perSecond.empty()) {
+    printf("per second    min %.0f  median %.0f  max %.0f writes/s\n",
+           perSecond.front(), perSecond[perSecond.size() / 2], perSecond.back());
+  }
+  printf("%s p50 %.2f ms  p99 %.2f ms  max %.2f ms, first write to last reply\n",
+         batch ? "request      " : "upload       ",
+         percentileMs(all, 0.5), percentileMs(all, 0.99), percentileMs(all, 1.0));
+  if (intervalMs) {
+    printf("per client    %.3f uploads/s (firmware sends every %u ms), %llu started over an interval late\n",
+           totals.uploads.load() / elapsed / clientCount, intervalMs,
+           (unsigned long long)totals.lateUploads.load());
+  }
+
+  if (!keep) {
+    nftw(storeDir.c_str(), removeEntry, 16, FTW_DEPTH | FTW_PHYS);
+  }
+  return totals.failures.load() ? 1 : 0;
+}
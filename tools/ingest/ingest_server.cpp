@@ -0,0 +1,284 @@
+#include "ingest_server.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <chrono>
+#include <string>
+#include <unordered_map>
+
+static const size_t MAX_REQUEST_SIZE = 512 * 1024;
+static const int MAX_EVENTS = 256;
+
+struct Connection {
+  std::string input;
+};
+
+static uint64_t wallClockMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static const char* reasonPhrase(int status) {
+  switch (status) {
+    case 200: return "OK";
+    case 204: return "No Content";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 413: return "Payload Too Large";
+    default: return "Internal Server Error";
+  }
+}
+
+static bool sendAll(int fd, const char* data, size_t length) {
+  while (length > 0) {
+    ssize_t sent = send(fd, data, length, MSG_NOSIGNAL);
+    if (sent < 0) {
+      if (errno == EINTR) continue;
+      if (errno == EAGAIN) {
+        // Replies are tiny; briefly wait rather than queueing output
+        std::this_thread::yield();
+        continue;
+      }
+      return false;
+    }
+    data += sent;
+    length -= sent;
+  }
+  return true;
+}
+
+static bool sendResponse(int fd, int status, bool keepAlive) {
+  char response[160];
+  const char* body = (status == 200) ? "null" : "";
+  if (status >= 400) body = "{\"error\":\"rejected\"}";
+  int length = snprintf(response, sizeof(response),
+                        "HTTP/1.1 %d %s\r\nContent-Type: application/json\r\n"
+                        "Content-Length: %zu\r\nConnection: %s\r\n\r\n%s",
+                        status, reasonPhrase(status), (status == 204) ? 0 : strlen(body),
+                        keepAlive ? "keep-alive" : "close", (status == 204) ? "" : body);
+  return sendAll(fd, response, length);
+}
+
+static bool headerEquals(const char* name, size_t nameLength, const char* expected) {
+  if (strlen(expected) != nameLength) return false;
+  for (size_t i = 0; i < nameLength; i++) {
+    char c = name[i];
+    if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+    if (c != expected[i]) return false;
+  }
+  return true;
+}
+
+// Handle every complete request buffered on the connection.
+// Returns false when the connection should be closed.
+static bool processInput(int fd, Connection& connection, IngestService& service) {
+  std::string& input = connection.input;
+  size_t offset = 0;
+
+  while (true) {
+    size_t headerEnd = input.find("\r\n\r\n", offset);
+    if (headerEnd == std::string::npos) break;
+
+    const char* request = input.data() + offset;
+    const char* requestEnd = input.data() + headerEnd;
+    const char* lineEnd = (const char*)memchr(request, '\r', requestEnd - request + 1);
+    const char* methodEnd = (const char*)memchr(request, ' ', lineEnd - request);
+    if (!methodEnd) {
+      sendResponse(fd, 400, false);
+      return false;
+    }
+    const char* target = methodEnd + 1;
+    const char* targetEnd = (const char*)memchr(target, ' ', lineEnd - target);
+    if (!targetEnd) {
+      sendResponse(fd, 400, false);
+      return false;
+    }
+
+    size_t contentLength = 0;
+    bool keepAlive = true;
+    const char* header = lineEnd + 2;
+    while (header < requestEnd) {
+      const char* headerLineEnd = (const char*)memchr(header, '\r', requestEnd - header + 1);
+      const char* colon = (const char*)memchr(header, ':', headerLineEnd - header);
+      if (colon) {
+        const char* value = colon + 1;
+        while (value < headerLineEnd && *value == ' ') value++;
+        if (headerEquals(header, colon - header, "content-length")) {
+          contentLength = strtoul(value, nullptr, 10);
+        } else if (headerEquals(header, colon - header, "connection")) {
+          keepAlive = !(headerLineEnd - value >= 5 && strncasecmp(value, "close", 5) == 0);
+        }
+      }
+      header = headerLineEnd + 2;
+    }
+
+    if (contentLength > MAX_REQUEST_SIZE) {
+      sendResponse(fd, 413, false);
+      return false;
+    }
+
+    size_t bodyStart = headerEnd + 4;
+    if (input.size() - bodyStart < contentLength) break; // wait for the rest
+
+    int status = service.handle(request, methodEnd - request,
+                                target, targetEnd - target,
+                                input.data() + bodyStart, contentLength,
+                                wallClockMs());
+    if (!sendResponse(fd, status, keepAlive) || !keepAlive) return false;
+
+    offset = bodyStart + contentLength;
+  }
+
+  input.erase(0, offset);
+  return input.size() <= MAX_REQUEST_SIZE;
+}
+
+// Returns the socket, or -1
+static int openListener(int port) {
+  int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  if (fd < 0) return -1;
+
+  int enable = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+  setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable));
+
+  sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  address.sin_port = htons(port);
+
+  if (bind(fd, (sockaddr*)&address, sizeof(address)) < 0 || listen(fd, 4096) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+IngestServer::IngestServer(IngestService& service)
+    : service(service), running(false), port(0) {
+}
+
+IngestServer::~IngestServer() {
+  stop();
+}
+
+bool IngestServer::start(int requestedPort, unsigned workerCount) {
+  if (running) return false;
+  if (workerCount == 0) workerCount = 1;
+
+  // The first listener settles the port when any will do; the rest share it
+  port = requestedPort;
+  for (unsigned i = 0; i < workerCount; i++) {
+    int listener = openListener(port);
+    if (listener < 0) {
+      for (int fd : listeners) close(fd);
+      listeners.clear();
+      return false;
+    }
+    if (port == 0) {
+      sockaddr_in address;
+      socklen_t length = sizeof(address);
+      getsockname(listener, (sockaddr*)&address, &length);
+      port = ntohs(address.sin_port);
+    }
+    listeners.push_back(listener);
+  }
+
+  running = true;
+  for (int listener : listeners) {
+    workers.emplace_back(&IngestServer::runWorker, this, listener);
+  }
+  return true;
+}
+
+void IngestServer::stop() {
+  running = false;
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  workers.clear();
+  listeners.clear();
+}
+
+int IngestServer::getPort() const {
+  return port;
+}
+
+void IngestServer::runWorker(int listener) {
+  int epoll = epoll_create1(0);
+  if (epoll < 0) {
+    perror("ingest_server: epoll");
+    close(listener);
+    return;
+  }
+
+  epoll_event event;
+  event.events = EPOLLIN;
+  event.data.fd = listener;
+  epoll_ctl(epoll, EPOLL_CTL_ADD, listener, &event);
+
+  std::unordered_map<int, Connection> connections;
+  epoll_event events[MAX_EVENTS];
+  char readBuffer[16 * 1024];
+
+  while (running) {
+    int ready = epoll_wait(epoll, events, MAX_EVENTS, 200);
+    for (int i = 0; i < ready; i++) {
+      int fd = events[i].data.fd;
+
+      if (fd == listener) {
+        int client;
+        while ((client = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK)) >= 0) {
+          int noDelay = 1;
+          setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+          event.events = EPOLLIN | EPOLLRDHUP;
+          event.data.fd = client;
+          epoll_ctl(epoll, EPOLL_CTL_ADD, client, &event);
+          connections[client];
+        }
+        continue;
+      }
+
+      bool keep = true;
+      Connection& connection = connections[fd];
+      while (keep) {
+        ssize_t received = recv(fd, readBuffer, sizeof(readBuffer), 0);
+        if (received > 0) {
+          connection.input.append(readBuffer, received);
+        } else if (received == 0) {
+          keep = false;
+        } else if (errno == EAGAIN) {
+          break;
+        } else if (errno != EINTR) {
+          keep = false;
+        }
+      }
+
+      if (keep) {
+        keep = processInput(fd, connection, service);
+      }
+
+      if (!keep) {
+        epoll_ctl(epoll, EPOLL_CTL_DEL, fd, nullptr);
+        close(fd);
+        connections.erase(fd);
+      }
+    }
+  }
+
+  for (auto& entry : connections) {
+    close(entry.first);
+  }
+  close(epoll);
+  close(listener);
+}
+
@@ -0,0 +1,41 @@
+#ifndef INGEST_SERVER_H
+#define INGEST_SERVER_H
+
+#include "ingest_service.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// HTTP/1.1 front end for IngestService: keep-alive, Content-Length bodies
+// and pipelining, as the Firebase client uses them.
+//
+// Plain HTTP only. Units always connect to DATABASE_URL over TLS, so one
+// pointed here needs a TLS-terminating proxy in front (nginx, haproxy,
+// stunnel) forwarding to this port; simulators and ingest_bench connect
+// directly. The handshake and record encryption are the proxy's cost and
+// are not in any number measured against this server.
+//
+// Each worker thread owns a SO_REUSEPORT listener and an epoll set, so the
+// kernel spreads connections across workers without a shared accept queue.
+class IngestServer {
+private:
+  IngestService& service;
+  std::atomic<bool> running;
+  std::vector<int> listeners;
+  std::vector<std::thread> workers;
+  int port;
+
+  void runWorker(int listener);
+
+public:
+  explicit IngestServer(IngestService& service);
+  ~IngestServer();
+
+  // Listen on port (0: any free one) with that many workers; false if the
+  // port could not be bound
+  bool start(int port, unsigned workerCount);
+  void stop();
+  int getPort() const;
+};
+
+#endif // INGEST_SERVER_H
@@ -0,0 +1,82 @@
+// Local stand-in for the Firebase Realtime Database (see ingest_server.h).
+//
+// Serves plain HTTP for simulators and ingest_bench; units, which always
+// use TLS, reach it through a TLS-terminating proxy forwarding to --port.
+//
+//   ingest_server [--port 8085] [--store ./ingest-data] [--workers N]
+//                 [--partition-seconds 3600] [--shards 16]
+
+#include "ingest_server.h"
+#include "ingest_service.h"
+#include "ingest_store.h"
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+static std::atomic<bool> running(true);
+
+static void handleSignal(int) {
+  running = false;
+}
+
+int main(int argc, char** argv) {
+  int port = 8085;
+  std::string storeDir = "ingest-data";
+  unsigned workers = std::thread::hardware_concurrency();
+  unsigned partitionSeconds = 3600;
+  unsigned shards = 16;
+
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "--port")) port = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "--store")) storeDir = argv[i + 1];
+    else if (!strcmp(argv[i], "--workers")) workers = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "--partition-seconds")) partitionSeconds = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "--shards")) shards = atoi(argv[i + 1]);
+    else {
+      fprintf(stderr, "ingest_server: unknown option %s\n", argv[i]);
+      return 2;
+    }
+  }
+  if (workers == 0) workers = 1;
+
+  IngestStore store(storeDir, partitionSeconds, shards);
+  if (!store.begin()) {
+    fprintf(stderr, "ingest_server: cannot create store at %s\n", storeDir.c_str());
+    return 1;
+  }
+  IngestService service(store);
+
+  signal(SIGINT, handleSignal);
+  signal(SIGTERM, handleSignal);
+
+  IngestServer server(service);
+  if (!server.start(port, workers)) {
+    perror("ingest_server: listener");
+    return 1;
+  }
+  printf("ingest_server: listening on :%d (plain HTTP) with %u workers, store %s\n",
+         server.getPort(), workers, storeDir.c_str());
+
+  uint64_t lastRecords = 0;
+  while (running) {
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    store.flush();
+    uint64_t records = store.getRecordCount();
+    if (records != lastRecords) {
+      printf("ingest_server: %llu records/s (total %llu, rejected %llu)\n",
+             (unsigned long long)(records - lastRecords), (unsigned long long)records,
+             (unsigned long long)service.getRejectedCount());
+      fflush(stdout);
+      lastRecords = records;
+    }
+  }
+
+  server.stop();
+  store.flush();
+  return 0;
+}
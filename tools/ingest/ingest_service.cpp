@@ -0,0 +1,278 @@
+#include "ingest_service.h"
+#include "config.h"
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+static const size_t MAX_BODY_SIZE = 256 * 1024;
+static const int MAX_JSON_DEPTH = 32;
+
+static bool equals(const char* text, size_t length, const char* literal) {
+  size_t literalLength = strlen(literal);
+  return length == literalLength && memcmp(text, literal, length) == 0;
+}
+
+static bool contains(const char* text, size_t length, const char* needle) {
+  size_t needleLength = strlen(needle);
+  for (size_t i = 0; i + needleLength <= length; i++) {
+    if (memcmp(text + i, needle, needleLength) == 0) return true;
+  }
+  return false;
+}
+
+static bool isPathChar(char c, bool allowSlash) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+         c == '-' || c == '_' || (allowSlash && c == '/');
+}
+
+IngestService::IngestService(IngestStore& store)
+    : store(store), requestCount(0), rejectedCount(0) {
+}
+
+// Recursive descent over RFC 8259 JSON, depth-limited; pos is advanced
+// past what was accepted
+struct JsonCursor {
+  const char* text;
+  size_t length;
+  size_t pos;
+};
+
+static void skipSpace(JsonCursor& json) {
+  while (json.pos < json.length) {
+    char c = json.text[json.pos];
+    if (c != ' ' && c != '\t' && c != '\r' && c != '\n') return;
+    json.pos++;
+  }
+}
+
+static bool isDigit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+static bool isHexDigit(char c) {
+  return isDigit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+static bool parseLiteral(JsonCursor& json, const char* literal) {
+  size_t literalLength = strlen(literal);
+  if (json.length - json.pos < literalLength ||
+      memcmp(json.text + json.pos, literal, literalLength) != 0) {
+    return false;
+  }
+  json.pos += literalLength;
+  return true;
+}
+
+static bool parseString(JsonCursor& json) {
+  json.pos++; // opening quote
+  while (json.pos < json.length) {
+    char c = json.text[json.pos++];
+    if ((unsigned char)c < 0x20) return false;
+    if (c == '"') return true;
+    if (c != '\\') continue;
+    if (json.pos == json.length) return false;
+    char escape = json.text[json.pos++];
+    if (escape == 'u') {
+      if (json.length - json.pos < 4) return false;
+      for (int i = 0; i < 4; i++) {
+        if (!isHexDigit(json.text[json.pos++])) return false;
+      }
+    } else if (escape == '\0' || !strchr("\"\\/bfnrt", escape)) {
+      return false;
+    }
+  }
+  return false;
+}
+
+static bool parseDigits(JsonCursor& json) {
+  size_t start = json.pos;
+  while (json.pos < json.length && isDigit(json.text[json.pos])) json.pos++;
+  return json.pos > start;
+}
+
+static bool parseNumber(JsonCursor& json) {
+  if (json.text[json.pos] == '-') json.pos++;
+  if (json.pos < json.length && json.text[json.pos] == '0') {
+    json.pos++; // no leading zeros
+  } else if (!parseDigits(json)) {
+    return false;
+  }
+  if (json.pos < json.length && json.text[json.pos] == '.') {
+    json.pos++;
+    if (!parseDigits(json)) return false;
+  }
+  if (json.pos < json.length && (json.text[json.pos] == 'e' || json.text[json.pos] == 'E')) {
+    json.pos++;
+    if (json.pos < json.length && (json.text[json.pos] == '+' || json.text[json.pos] == '-')) {
+      json.pos++;
+    }
+    if (!parseDigits(json)) return false;
+  }
+  return true;
+}
+
+static bool parseValue(JsonCursor& json, int depth);
+
+// Object or array: members separated by commas, no trailing comma
+static bool parseContainer(JsonCursor& json, int depth, bool isObject) {
+  if (depth == MAX_JSON_DEPTH) return false;
+  char close = isObject ? '}' : ']';
+  json.pos++; // opening bracket
+  skipSpace(json);
+  if (json.pos < json.length && json.text[json.pos] == close) {
+    json.pos++;
+    return true;
+  }
+  while (true) {
+    if (isObject) {
+      if (json.pos == json.length || json.text[json.pos] != '"' || !parseString(json)) return false;
+      skipSpace(json);
+      if (json.pos == json.length || json.text[json.pos] != ':') return false;
+      json.pos++;
+    }
+    if (!parseValue(json, depth + 1)) return false;
+    skipSpace(json);
+    if (json.pos == json.length) return false;
+    char c = json.text[json.pos++];
+    if (c == close) return true;
+    if (c != ',') return false;
+    skipSpace(json);
+  }
+}
+
+static bool parseValue(JsonCursor& json, int depth) {
+  skipSpace(json);
+  if (json.pos == json.length) return false;
+  switch (json.text[json.pos]) {
+    case '{': return parseContainer(json, depth, true);
+    case '[': return parseContainer(json, depth, false);
+    case '"': return parseString(json);
+    case 't': return parseLiteral(json, "true");
+    case 'f': return parseLiteral(json, "false");
+    case 'n': return parseLiteral(json, "null");
+    default: return parseNumber(json);
+  }
+}
+
+bool IngestService::isWellFormedJson(const char* body, size_t length) {
+  JsonCursor json = {body, length, 0};
+  if (!parseValue(json, 0)) return false;
+  // Exactly one value: only whitespace may follow it
+  skipSpace(json);
+  return json.pos == length;
+}
+
+int IngestService::handle(const char* method, size_t methodLength,
+                          const char* target, size_t targetLength,
+                          const char* body, size_t bodyLength,
+                          uint64_t receivedMs) {
+  requestCount++;
+
+  bool isPut = equals(method, methodLength, "PUT");
+  bool isPatch = equals(method, methodLength, "PATCH");
+  bool isPost = equals(method, methodLength, "POST");
+  if (!isPut && !isPatch && !isPost) {
+    rejectedCount++;
+    return 405;
+  }
+
+  // Split off the query string
+  const char* query = (const char*)memchr(target, '?', targetLength);
+  size_t pathLength = query ? (size_t)(query - target) : targetLength;
+  bool silent = query && contains(query, targetLength - pathLength, "print=silent");
+
+  // /devices/<id>/<relative>.json
+  static const size_t rootLength = sizeof(FB_DEVICES_ROOT) - 1;
+  static const size_t suffixLength = sizeof(".json") - 1;
+  if (pathLength < 1 + rootLength + suffixLength || target[0] != '/' ||
+      memcmp(target + 1, FB_DEVICES_ROOT, rootLength) != 0 ||
+      memcmp(target + pathLength - suffixLength, ".json", suffixLength) != 0) {
+    rejectedCount++;
+    return 404;
+  }
+
+  const char* deviceId = target + 1 + rootLength;
+  const char* pathEnd = target + pathLength - suffixLength;
+  const char* idEnd = deviceId;
+  while (idEnd < pathEnd && *idEnd != '/') {
+    if (!isPathChar(*idEnd, false)) {
+      rejectedCount++;
+      return 400;
+    }
+    idEnd++;
+  }
+  size_t deviceIdLength = idEnd - deviceId;
+  if (deviceIdLength == 0 || idEnd == pathEnd) {
+    rejectedCount++;
+    return 404;
+  }
+
+  const char* relative = idEnd + 1;
+  size_t relativeLength = pathEnd - relative;
+  for (size_t i = 0; i < relativeLength; i++) {
+    if (!isPathChar(relative[i], true)) {
+      rejectedCount++;
+      return 400;
+    }
+  }
+
+  if (bodyLength == 0 || bodyLength > MAX_BODY_SIZE || !isWellFormedJson(body, bodyLength)) {
+    rejectedCount++;
+    return 400;
+  }
+
+  // RTDB only accepts objects for PATCH
+  if (isPatch) {
+    size_t first = 0;
+    while (first < bodyLength && (body[first] == ' ' || body[first] == '\n' ||
+                                  body[first] == '\r' || body[first] == '\t')) {
+      first++;
+    }
+    if (first == bodyLength || body[first] != '{') {
+      rejectedCount++;
+      return 400;
+    }
+  }
+
+  static const size_t emergencyLength = sizeof(FB_EMERGENCY_PATH) - 2; // without '/'
+  RecordKind kind = (relativeLength >= emergencyLength &&
+                     memcmp(relative, FB_EMERGENCY_PATH, emergencyLength) == 0 &&
+                     (relativeLength == emergencyLength || relative[emergencyLength] == '/'))
+                        ? RECORD_ALERT : RECORD_TELEMETRY;
+
+  // {"rx":<ms>,"dev":"<id>","op":"<method>","path":"<relative>","data":<body>}
+  // Line buffers are reused per thread so steady-state ingest doesn't allocate
+  thread_local std::string line;
+  line.clear();
+  char receivedText[24];
+  int receivedLength = snprintf(receivedText, sizeof(receivedText), "%llu",
+                                (unsigned long long)receivedMs);
+
+  line.append("{\"rx\":").append(receivedText, receivedLength);
+  line.append(",\"dev\":\"").append(deviceId, deviceIdLength);
+  line.append("\",\"op\":\"").append(method, methodLength);
+  line.append("\",\"path\":\"").append(relative, relativeLength);
+  line.append("\",\"data\":");
+  size_t dataStart = line.size();
+  line.append(body, bodyLength);
+  // NDJSON: one record per line. Raw newlines are only legal as whitespace
+  // between tokens here (strings were checked above), so blank them.
+  for (size_t i = dataStart; i < line.size(); i++) {
+    if (line[i] == '\n' || line[i] == '\r') line[i] = ' ';
+  }
+  line.push_back('}');
+
+  if (!store.append(kind, deviceId, deviceIdLength, receivedMs, line.data(), line.size())) {
+    return 500;
+  }
+
+  return silent ? 204 : 200;
+}
+
+uint64_t IngestService::getRequestCount() const {
+  return requestCount.load();
+}
+
+uint64_t IngestService::getRejectedCount() const {
+  return rejectedCount.load();
+}
@@ -0,0 +1,41 @@
+#ifndef INGEST_SERVICE_H
+#define INGEST_SERVICE_H
+
+#include "ingest_store.h"
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Request handling for the RTDB stand-in, independent of the transport.
+//
+// Accepts the subset of the Realtime Database REST API the firmware uses,
+// restricted to device-scoped paths:
+//   PUT   /devices/<id>/<path>.json   single value (sendFloat/sendInt/...)
+//   PATCH /devices/<id>/<path>.json   batched object update (one frame or many)
+//   POST  /devices/<id>/<path>.json   push, e.g. a batch of alerts
+// Anything under <id>/emergency is stored as an alert, the rest as telemetry.
+// A "?print=silent" query selects a 204 reply, as RTDB does.
+class IngestService {
+private:
+  IngestStore& store;
+  std::atomic<uint64_t> requestCount;
+  std::atomic<uint64_t> rejectedCount;
+
+public:
+  explicit IngestService(IngestStore& store);
+
+  // Returns the HTTP status code. receivedMs is the wall-clock receive time.
+  int handle(const char* method, size_t methodLength,
+             const char* target, size_t targetLength,
+             const char* body, size_t bodyLength,
+             uint64_t receivedMs);
+
+  uint64_t getRequestCount() const;
+  uint64_t getRejectedCount() const;
+
+  // Exactly one RFC 8259 value, whitespace around it allowed, nested at
+  // most 32 levels deep; anything else is rejected
+  static bool isWellFormedJson(const char* body, size_t length);
+};
+
+#endif // INGEST_SERVICE_H
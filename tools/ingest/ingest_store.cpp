@@ -0,0 +1,151 @@
+#include "ingest_store.h"
+#include <errno.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+static const char* const KIND_DIRS[RECORD_KIND_COUNT] = {
+  "telemetry",
+  "alerts"
+};
+
+static const size_t SHARD_BUFFER_SIZE = 64 * 1024;
+
+// FNV-1a, stable across runs so a device always lands in the same shard
+static uint32_t hashDeviceId(const char* id, size_t length) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < length; i++) {
+    hash ^= (uint8_t)id[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+static bool makeDirectory(const std::string& path) {
+  if (mkdir(path.c_str(), 0755) == 0 || errno == EEXIST) return true;
+  return false;
+}
+
+static bool makeDirectories(const std::string& path) {
+  for (size_t pos = path.find('/', 1); pos != std::string::npos; pos = path.find('/', pos + 1)) {
+    if (!makeDirectory(path.substr(0, pos))) return false;
+  }
+  return makeDirectory(path);
+}
+
+IngestStore::IngestStore(const std::string& root, unsigned partitionSeconds, unsigned shardCount)
+    : rootDir(root),
+      partitionSeconds(partitionSeconds ? partitionSeconds : 3600),
+      shardCount(shardCount ? shardCount : 1),
+      recordCount(0),
+      byteCount(0),
+      partitionCount(0),
+      writeErrors(0) {
+  for (unsigned i = 0; i < RECORD_KIND_COUNT * this->shardCount; i++) {
+    std::unique_ptr<Shard> shard(new Shard());
+    shard->file = nullptr;
+    shard->partition = UINT64_MAX;
+    shards.push_back(std::move(shard));
+  }
+}
+
+IngestStore::~IngestStore() {
+  for (auto& shard : shards) {
+    if (shard->file) {
+      fclose(shard->file);
+    }
+  }
+}
+
+bool IngestStore::begin() {
+  if (!makeDirectories(rootDir)) return false;
+  for (int kind = 0; kind < RECORD_KIND_COUNT; kind++) {
+    if (!makeDirectory(rootDir + "/" + KIND_DIRS[kind])) return false;
+  }
+  return true;
+}
+
+void IngestStore::formatPartitionName(char* buffer, size_t bufferSize, uint64_t partitionStartSeconds) {
+  time_t seconds = (time_t)partitionStartSeconds;
+  struct tm utc;
+  gmtime_r(&seconds, &utc);
+  strftime(buffer, bufferSize, "%Y%m%dT%H%M", &utc);
+}
+
+bool IngestStore::openPartition(Shard& shard, RecordKind kind, unsigned shardIndex, uint64_t partition) {
+  if (shard.file) {
+    fclose(shard.file);
+    shard.file = nullptr;
+  }
+
+  char partitionName[32];
+  formatPartitionName(partitionName, sizeof(partitionName), partition * partitionSeconds);
+
+  std::string dir = rootDir + "/" + KIND_DIRS[kind] + "/" + partitionName;
+  if (!makeDirectory(dir)) return false;
+
+  char fileName[32];
+  snprintf(fileName, sizeof(fileName), "/shard-%03u.ndjson", shardIndex);
+
+  shard.file = fopen((dir + fileName).c_str(), "a");
+  if (!shard.file) return false;
+
+  shard.buffer.resize(SHARD_BUFFER_SIZE);
+  setvbuf(shard.file, shard.buffer.data(), _IOFBF, shard.buffer.size());
+  shard.partition = partition;
+  partitionCount++;
+  return true;
+}
+
+bool IngestStore::append(RecordKind kind, const char* deviceId, size_t deviceIdLength,
+                         uint64_t receivedMs, const char* line, size_t length) {
+  if (kind < 0 || kind >= RECORD_KIND_COUNT) return false;
+
+  unsigned shardIndex = hashDeviceId(deviceId, deviceIdLength) % shardCount;
+  Shard& shard = *shards[kind * shardCount + shardIndex];
+  uint64_t partition = (receivedMs / 1000) / partitionSeconds;
+
+  std::lock_guard<std::mutex> guard(shard.lock);
+
+  // Partitions only move forward; a late record goes into the open one
+  if (!shard.file || partition > shard.partition) {
+    if (!openPartition(shard, kind, shardIndex, partition)) {
+      writeErrors++;
+      return false;
+    }
+  }
+
+  if (fwrite(line, 1, length, shard.file) != length || fputc('\n', shard.file) == EOF) {
+    writeErrors++;
+    return false;
+  }
+
+  recordCount++;
+  byteCount += length + 1;
+  return true;
+}
+
+void IngestStore::flush() {
+  for (auto& shard : shards) {
+    std::lock_guard<std::mutex> guard(shard->lock);
+    if (shard->file) {
+      fflush(shard->file);
+    }
+  }
+}
+
+uint64_t IngestStore::getRecordCount() const {
+  return recordCount.load();
+}
+
+uint64_t IngestStore::getByteCount() const {
+  return byteCount.load();
+}
+
+uint64_t IngestStore::getPartitionCount() const {
+  return partitionCount.load();
+}
+
+uint64_t IngestStore::getWriteErrors() const {
+  return writeErrors.load();
+}
@@ -0,0 +1,73 @@
+#ifndef INGEST_STORE_H
+#define INGEST_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Kind of record, each kind gets its own directory tree
+enum RecordKind {
+  RECORD_TELEMETRY = 0,
+  RECORD_ALERT = 1,
+  RECORD_KIND_COUNT
+};
+
+// Append-only, time-partitioned store.
+//
+// Layout: <root>/<kind>/<YYYYMMDDTHHMM>/shard-<n>.ndjson
+//
+// One line per record. A partition covers partitionSeconds of receive time;
+// inside a partition devices are hashed onto shardCount files, each with its
+// own lock, so concurrent writers for different devices rarely contend.
+// Files are only ever opened for append.
+class IngestStore {
+private:
+  struct Shard {
+    std::mutex lock;
+    FILE* file;
+    uint64_t partition;
+    std::vector<char> buffer;
+  };
+
+  std::string rootDir;
+  unsigned partitionSeconds;
+  unsigned shardCount;
+  std::vector<std::unique_ptr<Shard>> shards; // RECORD_KIND_COUNT * shardCount
+
+  std::atomic<uint64_t> recordCount;
+  std::atomic<uint64_t> byteCount;
+  std::atomic<uint64_t> partitionCount;
+  std::atomic<uint64_t> writeErrors;
+
+  bool openPartition(Shard& shard, RecordKind kind, unsigned shardIndex, uint64_t partition);
+
+public:
+  IngestStore(const std::string& root, unsigned partitionSeconds = 3600, unsigned shardCount = 16);
+  ~IngestStore();
+
+  // Create the root directory; false if it cannot be created
+  bool begin();
+
+  // Append one line (newline is added). receivedMs is wall-clock receive time
+  // in milliseconds since the epoch and selects the partition.
+  bool append(RecordKind kind, const char* deviceId, size_t deviceIdLength,
+              uint64_t receivedMs, const char* line, size_t length);
+
+  // Flush all open shard files
+  void flush();
+
+  uint64_t getRecordCount() const;
+  uint64_t getByteCount() const;
+  uint64_t getPartitionCount() const;
+  uint64_t getWriteErrors() const;
+
+  // Directory name of the partition containing receivedMs
+  static void formatPartitionName(char* buffer, size_t bufferSize, uint64_t partitionStartSeconds);
+};
+
+#endif // INGEST_STORE_H
@@ -0,0 +1,187 @@
+// Benchmark: sharing the current SensorData between tasks, Seqlock against
+// a mutex and against a plain shared struct.
+//
+//   publish, read          one thread, ns per call
+//   busy publish, read     a writer publishing flat out while --readers
+//                          threads read flat out, ns of wall time per call
+//   torn                   of those reads, the ones that mixed two writes
+//
+// The plain copy is the baseline cost, and shows what goes wrong once a
+// second task reads it. With fewer cores than threads the busy figures
+// include time each thread spends descheduled.
+//
+//   seqlock_bench [--readers 3] [--seconds 1.0]
+
+#include "config.h"
+#include "seqlock.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+static volatile float sink;
+
+static SensorData reading(uint32_t n) {
+  SensorData data;
+  memset(&data, 0, sizeof(data));
+  data.accelX = (float)n;
+  data.accelY = (float)n * 2;
+  data.accelZ = (float)n * 3;
+  data.gyroX = (float)n * 4;
+  data.gyroY = (float)n * 5;
+  data.gyroZ = (float)n * 6;
+  data.timestamp = n;
+  data.sampleMicros = (uint64_t)n * 100000;
+  return data;
+}
+
+static bool isWhole(const SensorData& data) {
+  float n = (float)data.timestamp;
+  return data.accelX == n && data.accelY == n * 2 && data.accelZ == n * 3 && data.gyroX == n * 4 &&
+         data.gyroY == n * 5 && data.gyroZ == n * 6 && data.sampleMicros == (uint64_t)data.timestamp * 100000;
+}
+
+// The three ways of sharing, behind the same two calls
+struct SeqlockShare {
+  Seqlock<SensorData> snapshot;
+  void publish(const SensorData& data) { snapshot.publish(data); }
+  SensorData read() { return snapshot.read(); }
+};
+
+struct MutexShare {
+  std::mutex lock;
+  SensorData data;
+  MutexShare() { memset(&data, 0, sizeof(data)); }
+  void publish(const SensorData& value) {
+    std::lock_guard<std::mutex> guard(lock);
+    data = value;
+  }
+  SensorData read() {
+    std::lock_guard<std::mutex> guard(lock);
+    return data;
+  }
+};
+
+// What the loop did before the seqlock: a global struct, copied in and
+// out. Volatile words keep the compiler from hoisting the copies out of the
+// loops; it is still a data race, which is the point.
+struct PlainShare {
+  static const size_t WORDS = sizeof(SensorData) / sizeof(uint32_t);
+  volatile uint32_t words[WORDS];
+  PlainShare() {
+    for (size_t i = 0; i < WORDS; i++) words[i] = 0;
+  }
+  void publish(const SensorData& value) {
+    uint32_t from[WORDS];
+    memcpy(from, &value, sizeof(from));
+    for (size_t i = 0; i < WORDS; i++) words[i] = from[i];
+  }
+  SensorData read() {
+    uint32_t to[WORDS];
+    for (size_t i = 0; i < WORDS; i++) to[i] = words[i];
+    SensorData value;
+    memcpy(&value, to, sizeof(value));
+    return value;
+  }
+};
+
+struct Result {
+  double publishNanos;
+  double readNanos;
+  double contendedPublishNanos;
+  double contendedReadNanos;
+  uint64_t reads;
+  uint64_t torn;
+};
+
+static double nanosSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+template <typename Share>
+static Result measure(unsigned readers, double seconds) {
+  Result result;
+  memset(&result, 0, sizeof(result));
+  Share* share = new Share();
+  const uint32_t calls = 2000000;
+
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t n = 0; n < calls; n++) share->publish(reading(n));
+  result.publishNanos = nanosSince(start) / calls;
+  start = std::chrono::steady_clock::now();
+  for (uint32_t n = 0; n < calls; n++) sink = share->read().accelX;
+  result.readNanos = nanosSince(start) / calls;
+
+  std::atomic<bool> done(false);
+  std::atomic<uint64_t> reads(0);
+  std::atomic<uint64_t> torn(0);
+  std::atomic<uint64_t> readNanos(0);
+  std::vector<std::thread> threads;
+  for (unsigned r = 0; r < readers; r++) {
+    threads.emplace_back([&]() {
+      uint64_t count = 0;
+      uint64_t bad = 0;
+      auto begin = std::chrono::steady_clock::now();
+      while (!done.load(std::memory_order_relaxed)) {
+        if (!isWhole(share->read())) bad++;
+        count++;
+      }
+      readNanos += (uint64_t)nanosSince(begin);
+      reads += count;
+      torn += bad;
+    });
+  }
+  uint64_t writes = 0;
+  start = std::chrono::steady_clock::now();
+  while (nanosSince(start) < seconds * 1e9) {
+    for (int i = 0; i < 1000; i++) share->publish(reading((uint32_t)++writes));
+  }
+  double writeNanos = nanosSince(start);
+  done = true;
+  for (std::thread& thread : threads) thread.join();
+
+  result.contendedPublishNanos = writeNanos / writes;
+  result.reads = reads.load();
+  result.torn = torn.load();
+  result.contendedReadNanos = result.reads ? (double)readNanos.load() / result.reads : 0.0;
+  delete share;
+  return result;
+}
+
+int main(int argc, char** argv) {
+  unsigned readers = 3;
+  double seconds = 1.0;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "--readers")) readers = strtoul(argv[i + 1], nullptr, 10);
+    else if (!strcmp(argv[i], "--seconds")) seconds = atof(argv[i + 1]);
+  }
+  if (readers == 0 || seconds <= 0) {
+    fprintf(stderr, "usage: seqlock_bench [--readers 3] [--seconds 1.0]\n");
+    return 2;
+  }
+
+  printf("SensorData %zu bytes, %u readers against one writer, %u cores\n\n", sizeof(SensorData), readers,
+         std::thread::hardware_concurrency());
+  const char* names[3] = {"seqlock", "mutex", "plain"};
+  Result results[3];
+  results[0] = measure<SeqlockShare>(readers, seconds);
+  results[1] = measure<MutexShare>(readers, seconds);
+  results[2] = measure<PlainShare>(readers, seconds);
+
+  printf("%-8s %10s %10s %12s %12s %12s %10s\n", "share", "publish", "read", "busy publish", "busy read",
+         "reads", "torn");
+  for (int s = 0; s < 3; s++) {
+    const Result& result = results[s];
+    printf("%-8s %8.1fns %8.1fns %10.1fns %10.1fns %12llu %10llu\n", names[s], result.publishNanos,
+           result.readNanos, result.contendedPublishNanos, result.contendedReadNanos,
+           (unsigned long long)result.reads, (unsigned long long)result.torn);
+  }
+  printf("\npublish/read: one thread, no contention. busy: the writer publishing\n"
+         "flat out (the firmware publishes once per sample) while the readers\n"
+         "read flat out. torn: reads mixing two samples.\n");
+  return 0;
+}
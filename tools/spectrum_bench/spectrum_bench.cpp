@@ -0,0 +1,97 @@
+// Microbenchmark: spectral feature cost.
+//
+// Times the portable real FFT at growing sizes against a direct DFT of the
+// same length, then one SpectralAnalyzer::analyze() over a full detector
+// history (three windowed axes plus features) at SPECTRUM_WINDOW.
+//
+//   spectrum_bench [--iterations 200000]
+
+#include "spectral_features.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+static volatile float sinkFloat;
+
+template <typename Body>
+static double nanosPerCall(size_t count, Body body) {
+  auto start = std::chrono::steady_clock::now();
+  body();
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+         count;
+}
+
+static void directPower(const float* input, uint32_t size, float* power) {
+  for (uint32_t k = 0; k <= size / 2; k++) {
+    float re = 0.0f, im = 0.0f;
+    for (uint32_t n = 0; n < size; n++) {
+      float angle = -2.0f * 3.14159265f * (float)((k * n) % size) / size;
+      re += input[n] * cosf(angle);
+      im += input[n] * sinf(angle);
+    }
+    power[k] = re * re + im * im;
+  }
+}
+
+int main(int argc, char** argv) {
+  size_t iterations = 200000;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "--iterations")) iterations = strtoul(argv[i + 1], nullptr, 10);
+  }
+
+  printf("%-28s %12s %12s\n", "transform", "fft ns", "dft ns");
+
+  const uint32_t sizes[] = {16, 32, 64, 128, 256, 1024};
+  for (uint32_t size : sizes) {
+    std::vector<float> input(size), data(size), twiddles(size), power(size / 2 + 1);
+    uint32_t state = 1;
+    for (uint32_t n = 0; n < size; n++) {
+      state = state * 1664525UL + 1013904223UL;
+      input[n] = (state >> 8) / 16777216.0f - 0.5f;
+    }
+    fftTwiddles(twiddles.data(), size);
+
+    // Keep the total work per size roughly constant
+    size_t calls = iterations * 16 / size;
+    if (calls == 0) calls = 1;
+    double fftNs = nanosPerCall(calls, [&]() {
+      for (size_t i = 0; i < calls; i++) {
+        memcpy(data.data(), input.data(), size * sizeof(float));
+        realFftPower(data.data(), size, twiddles.data(), power.data());
+      }
+      sinkFloat = power[1];
+    });
+    size_t dftCalls = calls / 16 + 1;
+    double dftNs = nanosPerCall(dftCalls, [&]() {
+      for (size_t i = 0; i < dftCalls; i++) directPower(input.data(), size, power.data());
+      sinkFloat = power[1];
+    });
+
+    char name[64];
+    snprintf(name, sizeof(name), "real, %u points", size);
+    printf("%-28s %12.1f %12.1f\n", name, fftNs, dftNs);
+  }
+
+  DetectorHistory history;
+  for (uint32_t n = 0; n < SENSOR_HISTORY_SIZE; n++) {
+    SensorData data;
+    memset(&data, 0, sizeof(data));
+    data.accelX = 0.3f * sinf(0.7f * n);
+    data.accelY = 0.1f * cosf(1.3f * n);
+    data.accelZ = 1.0f;
+    data.timestamp = n * SENSOR_READ_INTERVAL;
+    history.push(data);
+  }
+  SpectralAnalyzer analyzer;
+  double analyzeNs = nanosPerCall(iterations, [&]() {
+    for (size_t i = 0; i < iterations; i++) analyzer.analyze(history);
+    sinkFloat = analyzer.getFeatures().flatness;
+  });
+  char name[64];
+  snprintf(name, sizeof(name), "analyze(), %d-point window", SPECTRUM_WINDOW);
+  printf("%-28s %12.1f\n", name, analyzeNs);
+  return 0;
+}
@@ -0,0 +1,196 @@
+#include "crash_sweep.h"
+#include <math.h>
+#include <algorithm>
+#include <thread>
+
+// CrashDetector's ring depth: bounds the consecutive run and decides which
+// samples skip the jerk term
+static const int HISTORY_SIZE = SENSOR_HISTORY_SIZE;
+
+void TraceColumns::append(const SensorData& data) {
+  accelX.push_back(data.accelX);
+  accelY.push_back(data.accelY);
+  accelZ.push_back(data.accelZ);
+  gyroX.push_back(data.gyroX);
+  gyroY.push_back(data.gyroY);
+  gyroZ.push_back(data.gyroZ);
+  distance.push_back(data.distance);
+  vibration.push_back(data.vibration);
+  timestamp.push_back(data.timestamp);
+  sampleMicros.push_back(data.sampleMicros);
+}
+
+// CrashDetector::calculateJerk on two rows, same operations in the same order
+static float jerkBetween(const TraceColumns& trace, size_t current, size_t previous) {
+  float deltaAccelX = trace.accelX[current] - trace.accelX[previous];
+  float deltaAccelY = trace.accelY[current] - trace.accelY[previous];
+  float deltaAccelZ = trace.accelZ[current] - trace.accelZ[previous];
+  float deltaTime;
+  if (trace.sampleMicros[current] && trace.sampleMicros[previous]) {
+    deltaTime = (int64_t)(trace.sampleMicros[current] - trace.sampleMicros[previous]) / 1000000.0;
+  } else {
+    deltaTime = (uint32_t)(trace.timestamp[current] - trace.timestamp[previous]) / 1000.0;
+  }
+
+  if (deltaTime <= 0) return 0;
+
+  return sqrtf(deltaAccelX * deltaAccelX + deltaAccelY * deltaAccelY +
+               deltaAccelZ * deltaAccelZ) / deltaTime;
+}
+
+void computeFeatures(const TraceColumns& trace, ScoreOrder order, TraceFeatures& features) {
+  const size_t count = trace.size();
+  features.expectsCrash = trace.expectsCrash;
+  features.accelMagnitude.resize(count);
+  features.gyroMagnitude.resize(count);
+  features.jerk.resize(count);
+  features.distance = trace.distance;
+  features.fixedScore.resize(count);
+
+  const float* ax = trace.accelX.data();
+  const float* ay = trace.accelY.data();
+  const float* az = trace.accelZ.data();
+  const float* gx = trace.gyroX.data();
+  const float* gy = trace.gyroY.data();
+  const float* gz = trace.gyroZ.data();
+  const int32_t* vibration = trace.vibration.data();
+  float* accelMagnitude = features.accelMagnitude.data();
+  float* gyroMagnitude = features.gyroMagnitude.data();
+  int8_t* fixedScore = features.fixedScore.data();
+
+  // Straight-line loops over contiguous columns: these vectorise
+  for (size_t i = 0; i < count; i++) {
+    accelMagnitude[i] = sqrtf(ax[i] * ax[i] + ay[i] * ay[i] + az[i] * az[i]);
+  }
+  for (size_t i = 0; i < count; i++) {
+    gyroMagnitude[i] = sqrtf(gx[i] * gx[i] + gy[i] * gy[i] + gz[i] * gz[i]);
+  }
+  for (size_t i = 0; i < count; i++) {
+    fixedScore[i] = (vibration[i] == 1) ? 2 : 0;   // HIGH
+  }
+
+  // The detector compares with the newest ring entry that is not the sample
+  // itself (same timestamps), and skips the term while there is none
+  const uint32_t* timestamp = trace.timestamp.data();
+  const uint64_t* sampleMicros = trace.sampleMicros.data();
+  for (size_t i = 0; i < count; i++) {
+    size_t held = (order == SCORE_AFTER_ADD) ? i + 1 : i;   // newest is row held - 1
+    size_t skip = (held > 0 && timestamp[held - 1] == timestamp[i] &&
+                   sampleMicros[held - 1] == sampleMicros[i]) ? 1 : 0;
+    features.jerk[i] = (held < 1 + skip) ? 0.0f : jerkBetween(trace, i, held - 1 - skip);
+  }
+}
+
+int severityFromScore(int score) {
+  if (score >= 8) return SEVERE_CRASH;
+  if (score >= 5) return MODERATE_CRASH;
+  if (score >= 3) return MINOR_CRASH;
+  return NO_CRASH;
+}
+
+void scoreTrace(const TraceFeatures& features, const CrashDetectionConfig& config,
+                ScoreOrder order, int8_t* scores) {
+  const size_t count = features.size();
+  const float* accelMagnitude = features.accelMagnitude.data();
+  const float* gyroMagnitude = features.gyroMagnitude.data();
+  const float* jerk = features.jerk.data();
+  const float* distance = features.distance.data();
+  const int8_t* fixedScore = features.fixedScore.data();
+
+  const float accelThreshold = config.accelThreshold;
+  const float severeAccel = config.severeAccelThreshold;
+  const float gyroThreshold = config.gyroThreshold;
+  const float severeGyro = config.severeGyroThreshold;
+  const float jerkThreshold = config.jerkThreshold;
+  const float severeJerk = config.severeJerkThreshold;
+  const float proximity = config.proximityThreshold;
+
+  for (size_t i = 0; i < count; i++) {
+    float accel = accelMagnitude[i];
+    float gyro = gyroMagnitude[i];
+    float j = jerk[i];
+    float d = distance[i];
+    int score = fixedScore[i];
+    score += (accel > accelThreshold) ? ((accel > severeAccel) ? 3 : 2) : 0;
+    score += (gyro > gyroThreshold) ? ((gyro > severeGyro) ? 3 : 2) : 0;
+    score += (j > jerkThreshold) ? ((j > severeJerk) ? 3 : 2) : 0;
+    score += (d < proximity && d > 0) ? 1 : 0;
+    scores[i] = (int8_t)score;
+  }
+
+  // Consecutive high readings: the detector walks back from the newest
+  // slot, so this is the run length ending at the newest sample it holds,
+  // capped at the ring depth. Slots never written read as zero.
+  const double runThreshold = config.accelThreshold * 0.7;
+  const int span = std::min(config.consecutiveReadings, HISTORY_SIZE);
+  int run = (0.0f > runThreshold) ? HISTORY_SIZE : 0;
+  for (size_t i = 0; i < count; i++) {
+    bool high = accelMagnitude[i] > runThreshold;
+    int consecutive;
+    if (order == SCORE_AFTER_ADD) {
+      run = high ? std::min(run + 1, HISTORY_SIZE) : 0;
+      consecutive = span > 0 ? std::min(span, run) : 0;
+    } else {
+      consecutive = span > 0 ? std::min(span, run) : 0;
+      run = high ? std::min(run + 1, HISTORY_SIZE) : 0;
+    }
+    if (consecutive >= config.consecutiveReadings) scores[i] += 2;
+  }
+}
+
+static int8_t maxScore(const int8_t* scores, size_t count) {
+  int8_t best = 0;
+  for (size_t i = 0; i < count; i++) {
+    best = std::max(best, scores[i]);
+  }
+  return best;
+}
+
+static void evaluateBlock(const std::vector<TraceFeatures>& traces,
+                          const std::vector<CrashDetectionConfig>& configs,
+                          ScoreOrder order, size_t begin, size_t end,
+                          std::vector<ConfusionCounts>& results) {
+  size_t longest = 0;
+  for (const TraceFeatures& trace : traces) longest = std::max(longest, trace.size());
+  std::vector<int8_t> scores(longest);
+
+  for (const TraceFeatures& trace : traces) {
+    for (size_t c = begin; c < end; c++) {
+      scoreTrace(trace, configs[c], order, scores.data());
+      int severity = severityFromScore(maxScore(scores.data(), trace.size()));
+
+      ConfusionCounts& counts = results[c];
+      if (trace.expectsCrash) counts.positives++;
+      else counts.negatives++;
+      for (int level = MINOR_CRASH; level <= SEVERE_CRASH; level++) {
+        if (severity < level) break;
+        if (trace.expectsCrash) counts.truePositive[level]++;
+        else counts.falsePositive[level]++;
+      }
+    }
+  }
+}
+
+void evaluateConfigs(const std::vector<TraceFeatures>& traces,
+                     const std::vector<CrashDetectionConfig>& configs,
+                     ScoreOrder order, unsigned threads,
+                     std::vector<ConfusionCounts>& results) {
+  ConfusionCounts zero = {};
+  results.assign(configs.size(), zero);
+  if (configs.empty()) return;
+
+  if (threads == 0) threads = 1;
+  if (threads > configs.size()) threads = configs.size();
+
+  // Each config belongs to one thread, so results need no locking
+  std::vector<std::thread> workers;
+  size_t perThread = (configs.size() + threads - 1) / threads;
+  for (unsigned t = 0; t < threads; t++) {
+    size_t begin = t * perThread;
+    size_t end = std::min(configs.size(), begin + perThread);
+    if (begin >= end) break;
+    workers.emplace_back(evaluateBlock, std::cref(traces), std::cref(configs), order,
+                         begin, end, std::ref(results));
+  }
+  for (std::thread& worker : workers) worker.join();
+}
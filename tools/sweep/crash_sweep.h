@@ -0,0 +1,82 @@
+#ifndef CRASH_SWEEP_H
+#define CRASH_SWEEP_H
+
+#include "config.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Batch evaluation of CrashDetectionConfig sets over recorded drives.
+//
+// Traces are stored column-wise. The config-independent features (accel
+// and gyro magnitude, jerk against the sample the detector would compare
+// with) are computed once per trace in plain loops over contiguous floats
+// that the compiler vectorises; each config then only needs compares and
+// adds per sample, plus one scan for the consecutive-reading run. Scores are
+// bit-identical to CrashDetector::calculateCrashScore as long as both are
+// built without floating-point contraction (-ffp-contract=off), which keeps
+// x*x + y*y + z*z from becoming FMAs in one build and not the other.
+// Jerk is the two-point difference (jerkWindow 2); traces are scored as
+// given, so sweep a pre-filter by recording filtered traces.
+
+// When detectCrash() runs relative to addToHistory() for the same sample.
+// Firmware::loop() adds first, so the consecutive run includes the sample;
+// the jerk term compares with the previous sample either way.
+enum ScoreOrder {
+  SCORE_AFTER_ADD = 0,
+  SCORE_BEFORE_ADD
+};
+
+// One drive, one column per SensorData field detection reads
+struct TraceColumns {
+  std::string name;
+  bool expectsCrash;
+  std::vector<float> accelX, accelY, accelZ;
+  std::vector<float> gyroX, gyroY, gyroZ;
+  std::vector<float> distance;
+  std::vector<int32_t> vibration;
+  std::vector<uint32_t> timestamp;
+  std::vector<uint64_t> sampleMicros;
+
+  size_t size() const { return accelX.size(); }
+  void append(const SensorData& data);
+};
+
+struct TraceFeatures {
+  bool expectsCrash;
+  std::vector<float> accelMagnitude;
+  std::vector<float> gyroMagnitude;
+  std::vector<float> jerk;            // 0 where the detector skips the term
+  std::vector<float> distance;
+  std::vector<int8_t> fixedScore;     // vibration points, config independent
+
+  size_t size() const { return accelMagnitude.size(); }
+};
+
+void computeFeatures(const TraceColumns& trace, ScoreOrder order, TraceFeatures& features);
+
+// Per-sample crash scores of one config; scores must hold features.size()
+void scoreTrace(const TraceFeatures& features, const CrashDetectionConfig& config,
+                ScoreOrder order, int8_t* scores);
+
+// Outcome of one config over all traces. A trace counts as detected at a
+// severity if any of its samples reaches it.
+struct ConfusionCounts {
+  uint32_t truePositive[SEVERE_CRASH + 1];
+  uint32_t falsePositive[SEVERE_CRASH + 1];
+  uint32_t positives;
+  uint32_t negatives;
+};
+
+// Scores every config against every trace on up to threads threads; each
+// thread takes a contiguous block of configs and runs all of them over one
+// trace before moving on, so the trace's features stay in cache
+void evaluateConfigs(const std::vector<TraceFeatures>& traces,
+                     const std::vector<CrashDetectionConfig>& configs,
+                     ScoreOrder order, unsigned threads,
+                     std::vector<ConfusionCounts>& results);
+
+int severityFromScore(int score);
+
+#endif // CRASH_SWEEP_H
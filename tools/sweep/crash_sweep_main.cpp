@@ -0,0 +1,279 @@
+// Threshold sweep: scores a grid of CrashDetectionConfig sets over recorded
+// or simulated drives and prints one ROC row per config.
+//
+//   crash_sweep [--manifest traces.csv] [--synthetic 200] [--duration-s 60]
+//               [--grid accel=2:4:0.5,gyro=150:350:50,jerk=40,proximity=30,consecutive=3]
+//               [--order after|before] [--threads N]
+//
+// A manifest line is "path,label" with label 1 for drives that should
+// trigger; each path is a CSV in the fleet_sim --trace format
+// (timeMs,ax,ay,az,gx,gy,gz,distance,vibration[,lat,lon]). --synthetic adds
+// that many drives of each sim scenario. Grid axes not given keep the
+// CrashDetectionConfig default; severe thresholds keep their default ratio
+// to the base threshold.
+
+#include "config.h"
+#include "crash_sweep.h"
+#include "scenario.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct GridAxis {
+  const char* name;
+  double first;
+  double last;
+  double step;
+};
+
+struct SweepOptions {
+  std::string manifestPath;
+  unsigned syntheticPerType = 0;
+  unsigned durationSeconds = 60;
+  unsigned threads = 0;
+  ScoreOrder order = SCORE_AFTER_ADD;
+  GridAxis axes[5] = {
+    {"accel", 3.0, 3.0, 1.0},
+    {"gyro", 250.0, 250.0, 1.0},
+    {"jerk", 40.0, 40.0, 1.0},
+    {"proximity", 30.0, 30.0, 1.0},
+    {"consecutive", 3.0, 3.0, 1.0},
+  };
+};
+
+static bool loadTrace(const char* path, bool expectsCrash, TraceColumns& trace) {
+  FILE* file = fopen(path, "r");
+  if (!file) return false;
+
+  trace.name = path;
+  trace.expectsCrash = expectsCrash;
+  char line[512];
+  while (fgets(line, sizeof(line), file)) {
+    SensorData data;
+    memset(&data, 0, sizeof(data));
+    double timeMs;
+    int fields = sscanf(line, "%lf,%f,%f,%f,%f,%f,%f,%f,%d", &timeMs,
+                        &data.accelX, &data.accelY, &data.accelZ,
+                        &data.gyroX, &data.gyroY, &data.gyroZ,
+                        &data.distance, &data.vibration);
+    if (fields < 9) continue; // header or malformed
+    data.timestamp = (uint32_t)timeMs;
+    data.sampleMicros = (uint64_t)(timeMs * 1000.0);
+    trace.append(data);
+  }
+  fclose(file);
+  return trace.size() > 0;
+}
+
+static bool loadManifest(const std::string& path, std::vector<TraceColumns>& traces) {
+  FILE* file = fopen(path.c_str(), "r");
+  if (!file) return false;
+
+  char line[512];
+  bool ok = true;
+  while (fgets(line, sizeof(line), file)) {
+    char* comma = strrchr(line, ',');
+    if (!comma || line[0] == '#') continue;
+    *comma = '\0';
+    TraceColumns trace;
+    if (!loadTrace(line, atoi(comma + 1) != 0, trace)) {
+      fprintf(stderr, "crash_sweep: cannot read trace %s\n", line);
+      ok = false;
+      continue;
+    }
+    traces.push_back(std::move(trace));
+  }
+  fclose(file);
+  return ok;
+}
+
+// Sampled like the firmware loop, every SENSOR_READ_INTERVAL
+static void addSyntheticTraces(unsigned perType, unsigned durationSeconds,
+                               std::vector<TraceColumns>& traces) {
+  const ScenarioType types[] = {SCENARIO_NORMAL_DRIVE, SCENARIO_POTHOLE,
+                                SCENARIO_CRASH, SCENARIO_ROLLOVER};
+  uint32_t durationMs = durationSeconds * 1000;
+  for (ScenarioType type : types) {
+    for (unsigned n = 0; n < perType; n++) {
+      Scenario scenario = makeScenario(type, 1000 * type + n + 1, durationMs);
+      TraceColumns trace;
+      trace.name = scenarioName(type);
+      trace.expectsCrash = scenarioExpectsCrash(type);
+      for (uint32_t ms = SENSOR_READ_INTERVAL; ms <= durationMs; ms += SENSOR_READ_INTERVAL) {
+        SimMotion motion = sampleScenario(scenario, (uint64_t)ms * 1000);
+        SensorData data;
+        memset(&data, 0, sizeof(data));
+        data.accelX = motion.accelX;
+        data.accelY = motion.accelY;
+        data.accelZ = motion.accelZ;
+        data.gyroX = motion.gyroX;
+        data.gyroY = motion.gyroY;
+        data.gyroZ = motion.gyroZ;
+        data.distance = motion.distance;
+        data.vibration = motion.vibration;
+        data.timestamp = ms;
+        data.sampleMicros = (uint64_t)ms * 1000;
+        trace.append(data);
+      }
+      traces.push_back(std::move(trace));
+    }
+  }
+}
+
+static bool parseGrid(const char* spec, SweepOptions& options) {
+  std::string text(spec);
+  size_t start = 0;
+  while (start < text.size()) {
+    size_t end = text.find(',', start);
+    if (end == std::string::npos) end = text.size();
+    std::string item = text.substr(start, end - start);
+    start = end + 1;
+
+    size_t equals = item.find('=');
+    if (equals == std::string::npos) return false;
+    std::string name = item.substr(0, equals);
+    GridAxis* axis = nullptr;
+    for (GridAxis& candidate : options.axes) {
+      if (name == candidate.name) axis = &candidate;
+    }
+    if (!axis) return false;
+
+    double first, last, step;
+    int fields = sscanf(item.c_str() + equals + 1, "%lf:%lf:%lf", &first, &last, &step);
+    if (fields == 1) {
+      last = first;
+      step = 1.0;
+    } else if (fields != 3 || step <= 0.0 || last < first) {
+      return false;
+    }
+    axis->first = first;
+    axis->last = last;
+    axis->step = step;
+  }
+  return true;
+}
+
+// Accel and consecutive outermost, so neighbouring configs share the
+// consecutive-run inputs
+static void buildGrid(const SweepOptions& options, std::vector<CrashDetectionConfig>& configs) {
+  const CrashDetectionConfig defaults;
+  const GridAxis& accel = options.axes[0];
+  const GridAxis& gyro = options.axes[1];
+  const GridAxis& jerk = options.axes[2];
+  const GridAxis& proximity = options.axes[3];
+  const GridAxis& consecutive = options.axes[4];
+  const double epsilon = 1e-9;
+
+  for (double a = accel.first; a <= accel.last + epsilon; a += accel.step) {
+    for (double c = consecutive.first; c <= consecutive.last + epsilon; c += consecutive.step) {
+      for (double g = gyro.first; g <= gyro.last + epsilon; g += gyro.step) {
+        for (double j = jerk.first; j <= jerk.last + epsilon; j += jerk.step) {
+          for (double p = proximity.first; p <= proximity.last + epsilon; p += proximity.step) {
+            CrashDetectionConfig config;
+            config.accelThreshold = (float)a;
+            config.severeAccelThreshold = (float)(a * defaults.severeAccelThreshold /
+                                                  defaults.accelThreshold);
+            config.gyroThreshold = (float)g;
+            config.severeGyroThreshold = (float)(g * defaults.severeGyroThreshold /
+                                                 defaults.gyroThreshold);
+            config.jerkThreshold = (float)j;
+            config.severeJerkThreshold = (float)(j * defaults.severeJerkThreshold /
+                                                 defaults.jerkThreshold);
+            config.proximityThreshold = (float)p;
+            config.consecutiveReadings = (int)(c + 0.5);
+            configs.push_back(config);
+          }
+        }
+      }
+    }
+  }
+}
+
+static void printRoc(const std::vector<CrashDetectionConfig>& configs,
+                     const std::vector<ConfusionCounts>& results) {
+  printf("config,accel,gyro,jerk,proximity,consecutive");
+  const char* levels[] = {"", "minor", "moderate", "severe"};
+  for (int level = MINOR_CRASH; level <= SEVERE_CRASH; level++) {
+    printf(",%s_tp,%s_fp,%s_tpr,%s_fpr", levels[level], levels[level], levels[level], levels[level]);
+  }
+  printf("\n");
+
+  for (size_t c = 0; c < configs.size(); c++) {
+    const CrashDetectionConfig& config = configs[c];
+    const ConfusionCounts& counts = results[c];
+    printf("%zu,%.3f,%.1f,%.2f,%.1f,%d", c, config.accelThreshold, config.gyroThreshold,
+           config.jerkThreshold, config.proximityThreshold, config.consecutiveReadings);
+    for (int level = MINOR_CRASH; level <= SEVERE_CRASH; level++) {
+      double tpr = counts.positives ? (double)counts.truePositive[level] / counts.positives : 0.0;
+      double fpr = counts.negatives ? (double)counts.falsePositive[level] / counts.negatives : 0.0;
+      printf(",%u,%u,%.4f,%.4f", counts.truePositive[level], counts.falsePositive[level], tpr, fpr);
+    }
+    printf("\n");
+  }
+}
+
+int main(int argc, char** argv) {
+  SweepOptions options;
+  for (int i = 1; i < argc; i++) {
+    const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+    if (!value) {
+      fprintf(stderr, "crash_sweep: %s needs a value\n", argv[i]);
+      return 2;
+    }
+    if (!strcmp(argv[i], "--manifest")) options.manifestPath = value;
+    else if (!strcmp(argv[i], "--synthetic")) options.syntheticPerType = atoi(value);
+    else if (!strcmp(argv[i], "--duration-s")) options.durationSeconds = atoi(value);
+    else if (!strcmp(argv[i], "--threads")) options.threads = atoi(value);
+    else if (!strcmp(argv[i], "--order")) {
+      options.order = !strcmp(value, "before") ? SCORE_BEFORE_ADD : SCORE_AFTER_ADD;
+    } else if (!strcmp(argv[i], "--grid")) {
+      if (!parseGrid(value, options)) {
+        fprintf(stderr, "crash_sweep: bad grid %s\n", value);
+        return 2;
+      }
+    } else {
+      fprintf(stderr, "crash_sweep: unknown option %s\n", argv[i]);
+      return 2;
+    }
+    i++;
+  }
+  if (options.threads == 0) options.threads = std::thread::hardware_concurrency();
+
+  std::vector<TraceColumns> traces;
+  if (!options.manifestPath.empty() && !loadManifest(options.manifestPath, traces)) {
+    fprintf(stderr, "crash_sweep: cannot read manifest %s\n", options.manifestPath.c_str());
+    return 1;
+  }
+  if (options.syntheticPerType) {
+    addSyntheticTraces(options.syntheticPerType, options.durationSeconds, traces);
+  }
+  if (traces.empty()) {
+    fprintf(stderr, "crash_sweep: no traces (use --manifest or --synthetic)\n");
+    return 2;
+  }
+
+  std::vector<CrashDetectionConfig> configs;
+  buildGrid(options, configs);
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<TraceFeatures> features(traces.size());
+  size_t samples = 0;
+  for (size_t t = 0; t < traces.size(); t++) {
+    computeFeatures(traces[t], options.order, features[t]);
+    samples += traces[t].size();
+  }
+  std::vector<ConfusionCounts> results;
+  evaluateConfigs(features, configs, options.order, options.threads, results);
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  printRoc(configs, results);
+  fprintf(stderr, "crash_sweep: %zu configs x %zu traces (%zu samples) in %.2f s, "
+          "%.1f M config-samples/s on %u threads\n",
+          configs.size(), traces.size(), samples, seconds,
+          configs.size() * (double)samples / seconds / 1e6, options.threads);
+  return 0;
+}
@@ -0,0 +1,88 @@
+// Decoder for the binary serial telemetry (see telemetry.h).
+//
+// Reads a capture of the serial console (a file, or the port itself once
+// set up with stty) and checks every frame. With --prefix, each record type
+// goes to its own CSV (<prefix>_sample.csv, _score, _state, _stats); --text
+// passes the console text between frames through to stderr.
+//
+//   telemetry_decoder [--prefix capture] [--text] [capture.bin | -]
+
+#include "telemetry.h"
+#include <stdio.h>
+#include <string.h>
+
+struct Output {
+  const char* prefix;
+  bool text;
+  FILE* files[TELEMETRY_TYPE_COUNT];
+  uint64_t counts[TELEMETRY_TYPE_COUNT];
+  bool failed;
+};
+
+static void writeRecord(const TelemetryRecord& record, void* context) {
+  Output* output = (Output*)context;
+  output->counts[record.type]++;
+  if (record.type == TELEMETRY_TEXT) {
+    if (output->text) fprintf(stderr, "%.*s\n", (int)record.textLength, record.text);
+    return;
+  }
+  if (!output->prefix || output->failed) return;
+
+  FILE*& file = output->files[record.type];
+  if (!file) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s_%s.csv", output->prefix, telemetryTypeName(record.type));
+    file = fopen(path, "w");
+    if (!file) {
+      fprintf(stderr, "telemetry_decoder: cannot write %s\n", path);
+      output->failed = true;
+      return;
+    }
+    fprintf(file, "%s\n", telemetryCsvHeader(record.type));
+  }
+  char line[512];
+  if (formatTelemetryRecord(line, sizeof(line), record) > 0) fprintf(file, "%s\n", line);
+}
+
+int main(int argc, char** argv) {
+  Output output;
+  memset(&output, 0, sizeof(output));
+  const char* inputPath = "-";
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--prefix") && i + 1 < argc) output.prefix = argv[++i];
+    else if (!strcmp(argv[i], "--text")) output.text = true;
+    else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+      fprintf(stderr, "usage: telemetry_decoder [--prefix capture] [--text] [capture.bin | -]\n");
+      return 2;
+    } else inputPath = argv[i];
+  }
+
+  FILE* input = strcmp(inputPath, "-") ? fopen(inputPath, "rb") : stdin;
+  if (!input) {
+    fprintf(stderr, "telemetry_decoder: cannot read %s\n", inputPath);
+    return 1;
+  }
+  TelemetryDecoder decoder;
+  uint8_t chunk[4096];
+  size_t length;
+  while ((length = fread(chunk, 1, sizeof(chunk), input)) > 0) {
+    decoder.feed(chunk, length, writeRecord, &output);
+  }
+  decoder.finish(writeRecord, &output);
+  if (input != stdin) fclose(input);
+  for (int type = 0; type < TELEMETRY_TYPE_COUNT; type++) {
+    if (output.files[type]) fclose(output.files[type]);
+  }
+
+  printf("Bytes:    %llu\n", (unsigned long long)decoder.bytes);
+  printf("Records:  %llu (", (unsigned long long)decoder.records);
+  for (int type = TELEMETRY_SAMPLE; type < TELEMETRY_TYPE_COUNT; type++) {
+    printf("%s%llu %s", type > TELEMETRY_SAMPLE ? ", " : "", (unsigned long long)output.counts[type],
+           telemetryTypeName(type));
+  }
+  printf(")\n");
+  printf("Lost:     %llu records (sequence gaps)\n", (unsigned long long)decoder.lostRecords);
+  printf("Bad:      %llu frames\n", (unsigned long long)decoder.badFrames);
+  printf("Text:     %llu lines\n", (unsigned long long)decoder.textLines);
+  return output.failed ? 1 : 0;
+}